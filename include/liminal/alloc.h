@@ -0,0 +1,57 @@
+#ifndef LIMINAL_ALLOC_H
+#define LIMINAL_ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Counting allocator for the front end, the IR and the value runtime. The
+// lm_* functions behave like their libc namesakes (memory from them can go
+// to free and the other way round) and also count calls and heap bytes, as
+// malloc_usable_size reports them, for the calling thread. A thread that
+// joins another adds the counters the other gathered meanwhile
+// (alloc_since, alloc_merge), so the counters of the thread that runs a
+// program cover its workers, oracle calls and recording writer too.
+// `--time-phases` reads the counters around each phase. Memory freed with
+// plain free is not subtracted, so live bytes are an upper bound.
+typedef struct {
+  uint64_t allocs;  // malloc, calloc, strdup and moving reallocs
+  uint64_t frees;
+  uint64_t bytes;   // allocated in total
+  uint64_t live;    // allocated and not yet freed
+  uint64_t peak;    // most live bytes since the last alloc_reset_peak
+} AllocStats;
+
+void *lm_malloc(size_t n);
+void *lm_calloc(size_t count, size_t n);
+void *lm_realloc(void *p, size_t n);
+char *lm_strdup(const char *s);
+char *lm_strndup(const char *s, size_t n);
+void lm_free(void *p);
+
+// This thread's counters
+AllocStats alloc_stats(void);
+// Restarts the peak from the bytes live now
+void alloc_reset_peak(void);
+
+// Restarts the peak and returns this thread's counters, to pass to
+// alloc_since later on the same thread
+AllocStats alloc_mark(void);
+// What this thread counted since mark; peak is the most bytes live above
+// the bytes live at the mark
+AllocStats alloc_since(AllocStats mark);
+// Adds counters from alloc_since to into: the peak grows by the other
+// thread's peak above into's live bytes
+void alloc_add(AllocStats *into, AllocStats delta);
+// Adds counters from alloc_since, gathered on a thread this one joined, to
+// this thread's
+void alloc_merge(AllocStats delta);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_ALLOC_H
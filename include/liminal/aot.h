@@ -0,0 +1,29 @@
+#ifndef LIMINAL_AOT_H
+#define LIMINAL_AOT_H
+
+#include "liminal/ir.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Ahead-of-time C backend. Each IrFunc becomes a C function over the
+// liminal_rt value runtime (value.h): labels become gotos, calls become
+// direct C calls, and temps that provably hold an Integer/Boolean become
+// plain C ints. Oracle operations are rejected.
+
+// Returns malloc'd C source, or NULL with *errmsg (malloc'd) set
+char *aot_emit_c(const IrProgram *prog, const char *source_name, char **errmsg);
+// Builds an executable from generated C with $LIMINAL_CC (default cc),
+// linked against the liminal_rt library. Returns 0 on success.
+int aot_build_executable(const char *c_src, const char *out_path, char **errmsg);
+
+// `liminal compile`: writes C (emit_c) or a native executable to out_path,
+// optimized with the profile at profile_in when it is not NULL (pgo.h)
+int liminal_compile_file(const char *in_path, const char *out_path, int emit_c, const char *profile_in);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_AOT_H
@@ -103,6 +103,7 @@ typedef enum {
   STMT_TRY,
   STMT_BLOCK,
   STMT_FOR_IN,
+  STMT_STREAM,
   STMT_EXPR
 } StmtKind;
 
@@ -356,6 +357,7 @@ typedef struct ASTStmt {
     struct { ASTExpr *cond; ASTStmt *body; } while_stmt;
     struct { ASTExpr *init; ASTExpr *to; ASTStmt *body; ASTIdent var; int descending; } for_stmt;
     struct { ASTIdent var; ASTExpr *iterable; ASTStmt *body; } for_in_stmt;
+    struct { ASTIdent oracle; ASTExpr *prompt; ASTIdent chunk; ASTStmt *body; } stream_stmt;
     struct { ASTStmt *body; ASTExpr *cond; } repeat_stmt;
     struct { ASTExpr *expr; ASTStmtVec branches; ASTExprVec patterns; ASTStmt *else_branch; } case_stmt;
     struct { ASTStmtVec body; } loop_stmt;
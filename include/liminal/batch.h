@@ -0,0 +1,49 @@
+#ifndef LIMINAL_BATCH_H
+#define LIMINAL_BATCH_H
+
+#include <stddef.h>
+#include "liminal/context.h"
+#include "liminal/value.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Batch runs (`liminal run --batch`): one program over a JSONL file of input
+// records, compiled once and run as one instance per record, all on one
+// thread and sharing one oracle (ir_execute_many). A record is an object
+// whose fields are set as the program's variables before it starts, except
+// "id", which names the record in completion-order output (default: its
+// line number), and "stdin", the text its ReadLn calls read. A record that
+// is a JSON string is only that text. Field values are strings, numbers and
+// booleans; null leaves the variable unset.
+typedef struct {
+  size_t jobs;          // instances alive at once (0: all)
+  int completion_order; // 1: each record's output as it finishes, as a JSON
+                        // line {"id":...,"output":"..."}; 0: raw, in input order
+} BatchOptions;
+
+typedef struct {
+  char *id;         // the id as JSON text
+  char *stdin_text; // what ReadLn reads ("" if none)
+  Env vars;
+} BatchRecord;
+
+// Reads a JSONL file of records; blank lines are skipped. NULL with *errmsg
+// set (malloc'd, "<path>:<line>: ...") if it cannot be read or a record is
+// malformed; *n is the number of records.
+BatchRecord *batch_read_records(LiminalContext *ctx, const char *path, size_t *n, char **errmsg);
+void batch_records_free(LiminalContext *ctx, BatchRecord *rs, size_t n);
+
+// Runs the program at path once per record of inputs and writes the outputs
+// to ctx->out. Asks go through ctx's oracle (from the environment if it has
+// none), behind a response cache (oracle_with_cache) when ctx owns it, so a
+// prompt asked by several records reaches the provider once. Reports errors
+// on stderr and returns 1 if the program or the records cannot be read.
+int liminal_run_batch(LiminalContext *ctx, const char *path, const char *inputs, const BatchOptions *opt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_BATCH_H
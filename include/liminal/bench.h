@@ -0,0 +1,67 @@
+#ifndef LIMINAL_BENCH_H
+#define LIMINAL_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Benchmark harness (`liminal_bench`). Runs each program in-process through
+// liminal_run_file_ctx, output discarded, `warmup` times untimed and then
+// `iterations` times against CLOCK_MONOTONIC. Every iteration is a whole
+// run: read, compile and execute. Allocations are the counting allocator's
+// (alloc.h) for one iteration; instructions come from one extra run under
+// the profiler, which is not timed.
+typedef struct {
+  size_t warmup;
+  size_t iterations;
+  int jit;
+} BenchOptions;
+
+typedef struct {
+  char *name;           // file name without directory and .lim
+  size_t iterations;
+  double mean_ns;
+  double stddev_ns;
+  uint64_t min_ns;
+  uint64_t p50_ns;
+  uint64_t p90_ns;
+  uint64_t p99_ns;
+  uint64_t max_ns;
+  uint64_t allocs;
+  uint64_t bytes;
+  uint64_t instructions;
+} BenchResult;
+
+// Summary statistics of n timings (sorted in place); percentiles are
+// nearest-rank, stddev is the sample standard deviation
+void bench_summarize(uint64_t *ns, size_t n, BenchResult *r);
+
+// Benchmarks one program; returns 0 and reports on stderr if a run fails
+int bench_run(const char *path, const BenchOptions *opt, BenchResult *r);
+void bench_result_free(BenchResult *r);
+
+// Table on out, one row per program
+void bench_report(const BenchResult *rs, size_t n, FILE *out);
+// {"benchmarks":[...]} with one program per line, which bench_read_json
+// reads back
+void bench_write_json(const BenchResult *rs, size_t n, const BenchOptions *opt, FILE *out);
+// Reads a file written by bench_write_json; returns NULL if it cannot be
+// opened. *n is the number of results.
+BenchResult *bench_read_json(const char *path, size_t *n);
+
+// Compares against a baseline: a program regresses when its median time or
+// its allocation count grows by more than threshold_pct percent. Writes a
+// table on out and returns the number of regressions. Programs missing
+// from the baseline are listed but never regress.
+size_t bench_compare(const BenchResult *base, size_t nbase, const BenchResult *rs, size_t n,
+                     double threshold_pct, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_BENCH_H
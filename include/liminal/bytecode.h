@@ -0,0 +1,37 @@
+#ifndef LIMINAL_BYTECODE_H
+#define LIMINAL_BYTECODE_H
+
+#include <stddef.h>
+#include "liminal/ir.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Serialized IrProgram ("bytecode image"): a relocation-free layout of
+// function/instruction tables, schema metadata and a deduplicated string
+// pool, in host byte order so it can be mapped read-only and used in place.
+// Bump BYTECODE_FORMAT_VERSION on any layout change; it is part of the
+// cache key.
+#define BYTECODE_MAGIC "LIMBC"
+#define BYTECODE_FORMAT_VERSION 3
+
+// Serialization; returns a malloc'd buffer
+unsigned char *bytecode_serialize(const IrProgram *prog, size_t *len_out);
+// Returns NULL and sets *errmsg (malloc'd) on malformed input
+IrProgram *bytecode_deserialize(const unsigned char *data, size_t len, char **errmsg);
+// Maps an image file read-only; the program's strings borrow from the
+// mapping, which ir_program_free unmaps
+IrProgram *bytecode_map_file(const char *path, char **errmsg);
+
+// Cache: <dir>/<sha256(source, compiler version, format version)>.limbc
+void bytecode_cache_key(const char *src, size_t len, char out_hex[65]);
+char *bytecode_cache_path(const char *dir, const char *src, size_t len);
+IrProgram *bytecode_cache_load(const char *dir, const char *src, size_t len);
+int bytecode_cache_store(const char *dir, const char *src, size_t len, const IrProgram *prog);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_BYTECODE_H
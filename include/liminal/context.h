@@ -0,0 +1,143 @@
+#ifndef LIMINAL_CONTEXT_H
+#define LIMINAL_CONTEXT_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct Oracle;
+struct JitState;
+struct OpNgrams;
+struct QuickState;
+struct ExecStreams;
+struct WorkerPool;
+struct PgoProfile;
+struct Profiler;
+struct Sampler;
+struct Env;
+
+// Per-run state shared by the parser, typechecker, lowering and executor.
+// Debug flags are sampled from LIMINAL_DEBUG_* once at init so hot paths
+// only test an int; nothing in the pipeline reads the environment again.
+typedef struct LiminalContext {
+  // Debug flags
+  int debug_exec;     // LIMINAL_DEBUG_EXEC
+  int debug_ir;       // LIMINAL_DEBUG_IR (dump IR before execution)
+  int debug_ir_log;   // LIMINAL_DEBUG_IR_LOG
+  int debug_ir_call;  // LIMINAL_DEBUG_IR_CALL
+  int debug_tc;       // LIMINAL_DEBUG_TC
+  int debug_parser;   // LIMINAL_DEBUG_PARSER
+
+  // Streams; output is buffered here and flushed at exit / before ReadLn.
+  // Without out it stays buffered (a `parallel` task's output until join)
+  FILE *in;
+  FILE *out;
+  char *outbuf;
+  size_t outbuf_len;
+  size_t outbuf_cap;
+
+  // Executor value allocation counters
+  size_t allocs;
+  size_t frees;
+
+  // Superinstruction pass before interpretation (LIMINAL_NO_FUSE disables)
+  int fuse;
+  // Op-sequence mining for `liminal ngrams`; NULL otherwise
+  struct OpNgrams *ngrams;
+
+  // Quickening: instructions rewrite themselves into kind-specialized
+  // variants (LIMINAL_NO_QUICKEN disables); quick_state lives for one
+  // ir_execute
+  int quicken;
+  struct QuickState *quick_state;
+  size_t quickened; // variants installed
+  size_t deopts;    // guard misses that reverted to the generic op
+
+  // Streams opened by `stream` statements, indexed by their handles; lives
+  // for one ir_execute, which closes any a return left open
+  struct ExecStreams *streams;
+
+  // Asks started by ASK_START and not awaited yet, indexed by their
+  // handles; lives for one ir_execute
+  struct ExecAsks *asks;
+
+  // Variables set before the program's first instruction (a batch record,
+  // batch.h); ir_execute copies them into the globals. NULL: none
+  struct Env *bindings;
+
+  // `parallel` blocks: up to parallel_workers tasks run at once
+  // (LIMINAL_PARALLEL_WORKERS, default 8), the interpreter's thread being
+  // one of them; workers is started by the first block and lives for one
+  // ir_execute
+  long parallel_workers;
+  struct WorkerPool *workers;
+
+  // Baseline JIT (`liminal run --jit`). jit_threshold is LIMINAL_JIT_THRESHOLD
+  // (-1: built-in default); jit_state lives for one ir_execute
+  int jit;
+  long jit_threshold;
+  struct JitState *jit_state;
+  size_t jit_compiled; // functions compiled to machine code
+
+  // Profile-guided optimization (pgo.h): pgo_out is the file this run's
+  // profile is recorded into (`run --profile-out`), pgo_in one to optimize
+  // with (`--profile-in`); pgo holds the counters while recording
+  const char *pgo_in;
+  const char *pgo_out;
+  struct PgoProfile *pgo;
+
+  // Timing profiler (`run --profile`, profiler.h): the report goes to
+  // stderr after the run and, with profile_json set, to that file as JSON;
+  // annotate_out receives the IR annotated with source lines and counts;
+  // profiler lives for one run
+  int profile;
+  const char *profile_json;
+  const char *annotate_out;
+  struct Profiler *profiler;
+
+  // Sampling profiler (`run --sample`, sampler.h): collapsed stacks are
+  // written to sample_out; sample_hz is LIMINAL_SAMPLE_HZ (default 1000)
+  const char *sample_out;
+  long sample_hz;
+  struct Sampler *sampler;
+
+  // Timeline trace (`run --trace`, trace.h): Chrome trace-event JSON is
+  // written to trace_out; calls shorter than trace_min_us
+  // (LIMINAL_TRACE_MIN_US, default 10) are left out
+  const char *trace_out;
+  long trace_min_us;
+  struct Tracer *tracer;
+
+  // Phase report (`run --time-phases`, phases.h): time and allocations per
+  // phase go to stderr after the run and, with time_phases_json set, to
+  // that file as JSON; phases lives for one run
+  int time_phases;
+  const char *time_phases_json;
+  struct PhaseLog *phases;
+
+  // Compiled bytecode cache directory (LIMINAL_CACHE_DIR); NULL disables it
+  char *cache_dir;
+
+  // Oracle used by ask/consult; released with the context when owns_oracle.
+  // Installed via liminal_context_set_oracle (oracles.h), which supplies the
+  // release hook so the runtime library does not depend on the providers.
+  struct Oracle *oracle;
+  int owns_oracle;
+  void (*oracle_release)(struct Oracle *oracle);
+} LiminalContext;
+
+void liminal_context_init(LiminalContext *ctx);
+void liminal_context_free(LiminalContext *ctx);
+
+// Buffered output
+void liminal_context_write(LiminalContext *ctx, const char *data, size_t len);
+void liminal_context_flush(LiminalContext *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_CONTEXT_H
@@ -4,15 +4,34 @@
 #include <stdio.h>
 #include "liminal/ir.h"
 #include "liminal/oracles.h"
+#include "liminal/context.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-int ir_execute(const IrProgram *prog, FILE *in, FILE *out, struct Oracle *oracle);
+int ir_execute(const IrProgram *prog, LiminalContext *ctx);
+
+// Runs prog once per context on the calling thread, each run an instance
+// with a VM stack of its own instead of C recursion. An instance that asks
+// suspends until the answer is in, and the thread meanwhile runs the others,
+// so thousands of asks can be in flight against one oracle (oracles.h).
+// At most `active` instances are alive at once (0: all of them); the next
+// starts, in index order, as one finishes, and on_done (if any) is told
+// the instance's index and status right after its output is flushed. The
+// contexts may share an oracle but nothing else; each has its own in and
+// out. Instances run without JIT or profilers, and `parallel` blocks and
+// streams block the thread as they do in ir_execute. Returns 1 if prog has
+// no functions, else 0.
+typedef void (*ExecDoneFn)(void *user, size_t index, int rc);
+int ir_execute_many(const IrProgram *prog, LiminalContext **ctxs, size_t n, size_t active, ExecDoneFn on_done,
+                    void *user);
+// Reads, compiles (or loads from the bytecode cache) and validates a program;
+// reports errors on stderr and returns NULL on failure
+IrProgram *liminal_load_program(LiminalContext *ctx, const char *path);
+int liminal_run_file_ctx(LiminalContext *ctx, const char *path);
 int liminal_run_file_streams(const char *path, FILE *in, FILE *out);
 int liminal_run_file(const char *path);
-void exec_set_global_oracle(struct Oracle *o);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,66 @@
+#ifndef LIMINAL_HTTP_H
+#define LIMINAL_HTTP_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Minimal HTTP/1.1 client for oracle providers: plain TCP (no TLS), one
+// request at a time per connection. Each pool serves one endpoint and keeps
+// up to HTTP_POOL_IDLE connections open between requests, so a run's asks
+// share a handshake. A request on a kept connection that the server has
+// meanwhile closed is sent again on a new one. Bodies may come with
+// Content-Length, chunked, or until the server closes.
+#define HTTP_POOL_IDLE 4
+
+typedef struct {
+  int status;
+  char *body;           // NUL-terminated, chunked framing removed
+  size_t len;
+} HttpResponse;
+
+typedef struct HttpPool {
+  char *host;
+  char *port;
+  char *prefix;         // path of the endpoint URL, without a trailing '/'
+  long connect_timeout_ms;
+  long io_timeout_ms;   // longest wait for the server to accept or send data
+  int idle[HTTP_POOL_IDLE];
+  size_t nidle;
+  uint64_t connects;    // connections opened so far
+  pthread_mutex_t lock; // guards idle, nidle and connects
+} HttpPool;
+
+// Parses http://host[:port][/prefix]; returns NULL and sets *errmsg
+// (malloc'd) for other schemes or a malformed URL
+HttpPool *http_pool_new(const char *url, char **errmsg);
+// Closes the idle connections; no request may be in flight
+void http_pool_free(HttpPool *p);
+
+// POSTs body to prefix + path. Returns 1 with *out filled for any status,
+// or 0 with *errmsg set (malloc'd) when no response arrived. Safe to call
+// from several threads on one pool.
+int http_post(HttpPool *p, const char *path, const char *content_type, const char *body, size_t len,
+              HttpResponse *out, char **errmsg);
+void http_response_free(HttpResponse *r);
+
+// Receives body bytes of a response with the given status as they arrive,
+// chunked framing removed; returns 0 to stop reading
+typedef int (*HttpDataFn)(void *user, int status, const char *data, size_t len);
+
+// http_post for answers that trickle in: the body goes to on_data as it is
+// received instead of being collected. Returns 1 with *status set once the
+// body has ended or on_data stopped it (the connection is then dropped), or
+// 0 with *errmsg set as http_post; on_data may have seen part of the body.
+int http_post_stream(HttpPool *p, const char *path, const char *content_type, const char *body, size_t len,
+                     HttpDataFn on_data, void *user, int *status, char **errmsg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_HTTP_H
@@ -0,0 +1,56 @@
+#ifndef LIMINAL_HTTP_LOOP_H
+#define LIMINAL_HTTP_LOOP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "liminal/http.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Event loop for oracle requests: one thread owns the sockets and runs any
+// number of requests at once over epoll, with non-blocking connects, sends
+// and reads, so hundreds of asks in flight cost one thread, not hundreds.
+// Requests are posted from any thread and come back as a handle that the
+// poster, or whichever thread it hands the handle to, waits on.
+//
+// The pools describe the endpoints and their timeouts; the loop keeps its
+// own connections alive per pool, up to HTTP_LOOP_IDLE each. As with
+// http_post, a request on a kept connection that the server has meanwhile
+// closed is sent again on a new one, and bodies may come with
+// Content-Length, chunked, or until the server closes. Linux only: elsewhere
+// http_loop_new fails and callers keep to the blocking client.
+#define HTTP_LOOP_IDLE 64
+
+typedef struct HttpLoop HttpLoop;
+typedef struct HttpCall HttpCall;
+
+typedef struct {
+  uint64_t requests;    // posted so far
+  uint64_t connects;    // connections opened so far
+  size_t in_flight;     // posted and not finished
+  size_t peak;          // most in flight at once
+} HttpLoopStats;
+
+// Starts the loop's thread; NULL with *errmsg set (malloc'd) if it cannot
+HttpLoop *http_loop_new(char **errmsg);
+// Stops the thread and closes the kept connections. Every call must have
+// been waited on; the pools may be freed after.
+void http_loop_free(HttpLoop *l);
+void http_loop_stats(HttpLoop *l, HttpLoopStats *out);
+
+// Queues a POST of body to p's prefix + path and returns at once; p must
+// outlive the loop
+HttpCall *http_loop_post(HttpLoop *l, HttpPool *p, const char *path, const char *content_type, const char *body,
+                         size_t len);
+// 1 once the response (or the failure) is in; never blocks
+int http_call_done(HttpCall *c);
+// Blocks until the call is done and frees it; results as http_post
+int http_call_wait(HttpCall *c, HttpResponse *out, char **errmsg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_HTTP_LOOP_H
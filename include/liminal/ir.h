@@ -2,8 +2,10 @@
 #define LIMINAL_IR_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include "liminal/ast.h"
 #include "liminal/types.h"
+#include "liminal/context.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -49,7 +51,20 @@ typedef enum {
   IR_OR,
   IR_CONST_BOOL,
   IR_CONST_OPTIONAL_NONE,
-  IR_INDEX
+  IR_INDEX,
+  IR_STREAM_OPEN,     // dest = handle of oracle s streaming its answer to arg1
+  IR_STREAM_NEXT,     // dest = ok(next chunk) of stream arg1, err once it ended
+  IR_FORK,            // a `parallel` task: the instructions up to label s
+  IR_JOIN,            // ends the run of FORK tasks just before it
+  IR_ASK_START,       // ASK issued without waiting: dest = handle of the ask
+  IR_AWAIT,           // dest = answer of the ask started as handle arg1
+  // Superinstructions (peephole.h): made before interpretation only, never
+  // serialized or seen by the AOT backend
+  IR_ARITH_CONST,     // dest = arg1 <fused> arg2 (an Integer literal)
+  IR_INC_VAR,         // dest = arg1 + arg2 (literal); s := dest
+  IR_ADD_STORE,       // dest = arg1 + arg2; s := dest
+  IR_CMP_BRANCH,      // if !(arg1 <fused> arg2) goto s
+  IR_CMP_CONST_BRANCH // if !(arg1 <fused> arg2 (literal)) goto s
 } IrOp;
 
 typedef struct {
@@ -60,6 +75,7 @@ typedef struct {
   double f; // for reals / flags
   char *s; // for strings/var names/labels/oracle name
   char *s2; // auxiliary string (schema type name)
+  IrOp fused; // superinstructions: the arithmetic or comparison performed
 } IrInstr;
 
 typedef struct {
@@ -68,6 +84,21 @@ typedef struct {
   size_t cap;
 } IrInstrVec;
 
+// Line table: maps instruction indices back to the source. Run-length
+// encoded; an entry covers instructions from start up to the next entry's
+// start. A zero span (line 0) means no source position: hand-built IR, or
+// code before the first statement.
+typedef struct {
+  uint32_t start;
+  LiminalSpan span;
+} IrLine;
+
+typedef struct {
+  IrLine *items;
+  size_t len;
+  size_t cap;
+} IrLineVec;
+
 typedef struct {
   char *name;
   char **params;
@@ -75,6 +106,8 @@ typedef struct {
   IrInstrVec instrs;
   int next_temp;
   int next_label;
+  IrLineVec lines;
+  LiminalSpan span; // builder: span given to instructions emitted next
 } IrFunc;
 
 typedef struct {
@@ -86,6 +119,9 @@ typedef struct {
 typedef struct {
   IrFuncVec funcs;
   TypeVec schemas; // schema metadata
+  TypeVec owned_types; // nested field types owned by a deserialized program
+  void *image; // mapped bytecode image the strings borrow from (NULL if owned)
+  size_t image_len;
 } IrProgram;
 
 // Core
@@ -93,6 +129,29 @@ IrProgram *ir_program_new(void);
 void ir_program_add_func(IrProgram *prog, IrFunc func);
 void ir_program_free(IrProgram *prog);
 char *ir_program_print(const IrProgram *prog);
+// Mnemonic used by ir_program_print ("CONST_INT", "JUMP_IF_FALSE", ...)
+const char *ir_op_name(IrOp op);
+// Points refs at the instruction's temp operands (dest first, then args;
+// literal operands are left out) and returns how many; unused (-1) operands
+// are included, so callers filter them
+int ir_instr_temp_refs(IrInstr *ins, int *refs[3]);
+// Copies a mapped image's strings into the program and drops the mapping,
+// so passes may replace and free them like any compiled program's
+void ir_program_own_strings(IrProgram *prog);
+
+// Line table. ir_func_set_span returns the previous span, so lowering can
+// restore it after a nested statement.
+LiminalSpan ir_func_set_span(IrFunc *f, LiminalSpan span);
+LiminalSpan ir_func_span_at(const IrFunc *f, size_t ip);
+// Passes that move or drop instructions work on one span per instruction
+// (malloc'd, instrs.len entries) and re-encode the table afterwards
+LiminalSpan *ir_func_spans(const IrFunc *f);
+void ir_func_set_spans(IrFunc *f, const LiminalSpan *spans, size_t n);
+// ir_program_print with each source line that starts a run of instructions
+// shown above them ("; 12: <text>", text only when source is given), and
+// each instruction prefixed with its count when counts (one array per
+// function) is given
+char *ir_program_print_annotated(const IrProgram *prog, const char *source, uint64_t *const *counts);
 
 // Builder API
 IrFunc ir_func_create(const char *name);
@@ -112,17 +171,35 @@ void ir_emit_readln(IrFunc *f, const char *name);
 int ir_emit_read_file(IrFunc *f, int path_temp);
 void ir_emit_write_file(IrFunc *f, int path_temp, int content_temp);
 int ir_emit_ask(IrFunc *f, int prompt_temp, int fallback_temp, const char *oracle_name, const char *schema_name);
+int ir_emit_stream_open(IrFunc *f, int prompt_temp, const char *oracle_name);
+int ir_emit_stream_next(IrFunc *f, int stream_temp);
 int ir_emit_result_unwrap(IrFunc *f, int result_temp, int fallback_temp);
 int ir_emit_result_is_ok(IrFunc *f, int result_temp);
 int ir_emit_concat(IrFunc *f, int a_temp, int b_temp);
 int ir_emit_result_or_fallback(IrFunc *f, int result_temp, int fallback_temp);
 int ir_emit_call(IrFunc *f, const char *fname, int arg0_temp, int arg1_temp);
+void ir_emit_fork(IrFunc *f, const char *end_label);
+void ir_emit_join(IrFunc *f);
+
+// A `parallel` block is a run of FORK <end>; <task>; LABEL <end> groups
+// closed by JOIN, so run in order it is plain sequential code. Returns the
+// index of the JOIN closing the run whose first FORK is at ip, or -1 if the
+// run is malformed
+long ir_fork_join(const IrFunc *f, size_t ip);
+
+// Asynchronous asks, run by the lowering on each program it builds. An ask
+// whose answer is not needed at once becomes ASK_START (dest = a new handle
+// temp) and AWAIT (the ask's old dest = answer), and the AWAIT sinks down
+// the basic block to the first instruction that needs the answer, taking a
+// store of the answer into a variable along. Returns the asks split.
+size_t ir_defer_awaits(IrProgram *prog);
 
 // Validator
 int ir_validate(const IrProgram *prog, char **errmsg);
 
 // Translator
 IrProgram *ir_from_ast(const ASTNode *prog);
+IrProgram *ir_from_ast_ctx(const ASTNode *prog, const LiminalContext *ctx);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,53 @@
+#ifndef LIMINAL_JIT_H
+#define LIMINAL_JIT_H
+
+#include "liminal/context.h"
+#include "liminal/ir.h"
+#include "liminal/value.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Baseline template JIT (x86-64). The interpreter counts calls and loop
+// back-edges per IrFunc; a hot function is translated once into machine code
+// by stitching a template per instruction. Integer constants, arithmetic,
+// comparisons and branches run inline behind kind guards; every other
+// opcode (and every failed guard) calls exec_step, the interpreter itself.
+// Compiled code shares the interpreter's frame, so it can be entered at a
+// loop header in the middle of a running function.
+
+// Interpreter activation record, read by compiled code
+typedef struct ExecFrame {
+  LiminalContext *ctx;
+  const IrProgram *prog;
+  const IrFunc *f;
+  Env *env;
+  Value *temps;
+  Value *ret_out;
+  Value retval;
+  int had_ret;
+  struct ExecLabel *labels;
+  size_t nlab;
+  struct QuickFunc *quick; // quickening tables for f (NULL: off)
+} ExecFrame;
+
+// Runs instruction ip in the interpreter; returns the next ip, or -1 after RET
+long exec_step(ExecFrame *fr, size_t ip);
+
+typedef struct JitState JitState;
+
+JitState *jit_state_new(LiminalContext *ctx, const IrProgram *prog);
+void jit_state_free(JitState *jit);
+// Counts a call (at_call, ip 0) or a back-edge to ip. When fr's function is
+// compiled, or has just become hot and compiles, runs it natively from ip to
+// the end and returns 1; otherwise returns 0 and the interpreter continues.
+int jit_enter(JitState *jit, ExecFrame *fr, size_t ip, int at_call);
+// Whether this build can generate code for the host
+int jit_supported(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_JIT_H
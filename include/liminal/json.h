@@ -0,0 +1,33 @@
+#ifndef LIMINAL_JSON_H
+#define LIMINAL_JSON_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The bits of JSON the JSONL files (recordings, batch records), bench
+// results and Ollama's answers need
+
+// The string at *pp (its opening quote), unescaped, \u escapes and surrogate
+// pairs as UTF-8 (half a pair as U+FFFD); advances *pp past the closing
+// quote. NULL if malformed or if it holds \u0000, which a C string cannot.
+char *json_parse_string(const char **pp);
+// The value of key, as written without escapes, among the members of the
+// object at p; NULL if p is not an object or key is not there
+const char *json_object_member(const char *p, const char *key);
+// The member's value unescaped, when it is a string; NULL otherwise
+char *json_object_string(const char *p, const char *key);
+// Past the string, number, literal, object or array at p; NULL if malformed
+const char *json_skip_value(const char *p);
+const char *json_skip_ws(const char *p);
+// len bytes of s as the inside of a JSON string
+void json_escape(FILE *f, const char *s, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_JSON_H
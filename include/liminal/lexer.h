@@ -58,6 +58,7 @@ typedef enum {
   TK_NOT,
   TK_QMARK,
   TK_BANG,
+  TK_PIPE,
 
   TK_ERROR
 } TokenKind;
@@ -0,0 +1,32 @@
+#ifndef LIMINAL_NGRAMS_H
+#define LIMINAL_NGRAMS_H
+
+#include <stdio.h>
+#include "liminal/ir.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Superinstruction mining (`liminal ngrams`). Each time the interpreter
+// executes instruction ip it counts the op sequences of length 2..n that
+// start there in the function body: the static shapes a fusion would
+// replace, weighted by how often they run. Sequences stop before a label
+// (a jump target) and after a jump or return.
+typedef struct OpNgrams OpNgrams;
+
+OpNgrams *op_ngrams_new(int max_len);
+void op_ngrams_free(OpNgrams *ng);
+void op_ngrams_count(OpNgrams *ng, const IrFunc *f, size_t ip);
+// Writes the `top` most frequent sequences, most frequent first
+void op_ngrams_report(const OpNgrams *ng, size_t top, FILE *out);
+
+// Runs each program with mining enabled (output discarded) and reports.
+// raw skips the superinstruction pass, showing the lowering's own shapes.
+int liminal_ngrams_files(const char **paths, size_t count, int max_len, size_t top, int raw, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_NGRAMS_H
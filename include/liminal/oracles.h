@@ -2,6 +2,7 @@
 #define LIMINAL_ORACLES_H
 
 #include <stddef.h>
+#include "liminal/context.h"
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -20,30 +21,135 @@ typedef struct {
   size_t embedding_len;
 } OracleResult;
 
+// Receives one piece of a streamed answer, in order; returns 0 to stop the
+// stream early
+typedef int (*OracleChunkFn)(void *user, const char *chunk, size_t len);
+
+// Concurrency contract: one Oracle may be shared by runs on several threads.
+// call_text and stream_text must be safe to invoke concurrently on the same
+// impl, so providers guard any mutable state themselves (the mock queue, the
+// record writer). Results are owned by the caller. oracle_mock_queue may run
+// while calls are in flight; destroy must only run once none are.
+struct OracleGate;
 typedef struct Oracle {
   OracleKind kind;
   void *impl;
   OracleResult (*call_text)(void *impl, const char *prompt);
+  // Optional: delivers the answer to on_chunk as it is generated and returns
+  // the whole text; NULL for providers that only answer at once
+  OracleResult (*stream_text)(void *impl, const char *prompt, OracleChunkFn on_chunk, void *user);
+  // Optional pair for providers whose requests run on an event loop:
+  // start_text sends the request and returns its handle at once (NULL if it
+  // cannot, and the call then goes through call_text); finish_text waits for
+  // the answer and frees the handle. ready_text, if set, tells without
+  // blocking whether finish_text would return at once. Safe to invoke
+  // concurrently, as above.
+  void *(*start_text)(void *impl, const char *prompt);
+  OracleResult (*finish_text)(void *impl, void *call);
+  int (*ready_text)(void *impl, void *call);
   void (*destroy)(void *impl);
+  // Concurrency cap (oracle_set_max_concurrency); NULL: unlimited
+  struct OracleGate *gate;
+  // The oracle a wrapper (recording, cache) forwards to; NULL for providers
+  struct Oracle *inner;
 } Oracle;
 
 // Core
 OracleResult oracle_call_text(Oracle *o, const char *prompt);
+// Streams the answer through on_chunk; providers without stream_text deliver
+// it as a single chunk. The result carries the full text (what had arrived
+// when on_chunk stopped the stream) or the error.
+OracleResult oracle_stream_text(Oracle *o, const char *prompt, OracleChunkFn on_chunk, void *user);
+// start_text within the concurrency cap: the handle, or NULL when o has no
+// start_text, every slot is taken or the start failed. finish returns the
+// result and gives the slot back.
+void *oracle_start_text(Oracle *o, const char *prompt);
+OracleResult oracle_finish_text(Oracle *o, void *call);
+// 1 once finish would not block (always, for providers without ready_text)
+int oracle_ready_text(Oracle *o, void *call);
+// 1 while every slot of o's concurrency cap, or of a cap below it, is taken
+int oracle_saturated(Oracle *o);
 void oracle_result_free(OracleResult r);
 void oracle_free(Oracle *o);
+// Per-provider concurrency cap: at most max calls and streams are in flight
+// on o at once, and further ones wait their turn (max <= 0: no cap). Wrappers
+// forward to the inner oracle through oracle_call_text, so a cap on the
+// provider holds below any recording. Set before o is shared.
+void oracle_set_max_concurrency(Oracle *o, int max);
+// Installs the run's oracle; owned oracles are freed with the context
+void liminal_context_set_oracle(LiminalContext *ctx, Oracle *oracle, int owns);
+
+// Pull side of oracle_stream_text for callers that consume chunks in a loop
+// of their own (the `stream` statement): a thread runs the stream and queues
+// the chunks. next blocks for the next chunk and returns 1 with it
+// (malloc'd), or 0 once the stream has ended; result is then valid. close
+// stops the stream, waiting for the provider to deliver its next chunk.
+typedef struct OracleStream OracleStream;
+OracleStream *oracle_stream_open(Oracle *o, const char *prompt);
+int oracle_stream_next(OracleStream *s, char **chunk, size_t *len);
+const OracleResult *oracle_stream_result(const OracleStream *s);
+void oracle_stream_close(OracleStream *s);
+
+// An ask whose answer is needed later (see ir_defer_awaits): wait blocks
+// until the call is done, frees it and returns its result. Providers with
+// start_text get the request in flight without a thread; others run
+// oracle_call_text on a thread of its own, or, without a thread to spare,
+// in start.
+typedef struct OracleCall OracleCall;
+OracleCall *oracle_call_start(Oracle *o, const char *prompt);
+OracleResult oracle_call_wait(OracleCall *c);
+// 1 once wait would not block
+int oracle_call_done(OracleCall *c);
 
-// Mock provider
+// Mock provider: streams a queued text a word at a time (each word with the
+// whitespace after it)
 Oracle *oracle_create_mock(void);
 void oracle_mock_queue(Oracle *o, const char *text_or_null, const char *error_or_null);
+// Answers prompt with this text or error every time it is asked, ahead of
+// the queue; concurrent asks then get their answers whatever order they
+// arrive in
+void oracle_mock_answer(Oracle *o, const char *prompt, const char *text_or_null, const char *error_or_null);
+// Every answer takes ms milliseconds to arrive, as a model's would; set
+// before the oracle is shared. Calls started through start_text wait out
+// the latency in finish instead of on a thread.
+void oracle_mock_set_latency(Oracle *o, long ms);
 
-// Ollama provider (text only)
+// Ollama provider (text only), over the built-in HTTP client with
+// connections kept alive between asks. Whole answers go through an event
+// loop (http_loop.h) the oracle starts with its first ask, so any number of
+// them can be in flight on its one thread; streaming reads the NDJSON answer
+// line by line as it arrives, on the caller's thread (http.h). Capped at ORACLE_OLLAMA_MAX_CONCURRENCY
+// requests in flight, the number a default Ollama server handles at once.
+#define ORACLE_OLLAMA_MAX_CONCURRENCY 4
 Oracle *oracle_create_ollama(const char *endpoint, const char *model);
 int oracle_ollama_available(void);
+// Connect and read/write timeouts in milliseconds; <= 0 keeps the default
+// (5 s to connect, 120 s waiting on the server)
+void oracle_ollama_set_timeouts(Oracle *o, long connect_ms, long io_ms);
 
-// Recording/replay wrapper: mode = "live"|"record"|"replay"
+// Recording/replay wrapper: mode = "live"|"record"|"replay". Record mode
+// keeps the file open and writes answers behind the ask, through a
+// RecordWriter (recordings.h); freeing the oracle writes what is left.
 Oracle *oracle_with_recording(Oracle *inner, const char *mode, const char *path);
+// Longest an answer waits before it is written (default
+// RECORD_WRITER_FLUSH_MS); <= 0 writes each answer as it comes, on the
+// asking thread. Set before the first ask.
+void oracle_recording_set_flush_ms(Oracle *o, long ms);
+// Waits until every answer recorded so far is in the file, for o or the
+// recording it wraps; -1 if a write failed, 0 otherwise and for oracles
+// that do not record
+int oracle_recording_flush(Oracle *o);
+// Response cache: a prompt asked again (canonicalized, as recordings key
+// them) gets the first successful answer back without reaching inner. Asks
+// of the same prompt already in flight are not merged. Owns inner.
+Oracle *oracle_with_cache(Oracle *inner);
+// Asks answered from the cache and asks passed on; 0 for other oracles
+void oracle_cache_stats(Oracle *o, size_t *hits, size_t *misses);
 
-// Config loader (env + liminal.ini if present)
+// Config loader (env + liminal.ini if present). LIMINAL_ORACLE_MAX_CONCURRENCY
+// (ini: max_concurrency) overrides the provider's cap, 0 lifting it;
+// LIMINAL_ORACLE_RECORD_FLUSH_MS (ini: record_flush_ms) sets the recording's
+// flush interval.
 Oracle *oracle_from_env(void);
 
 // Internal helper
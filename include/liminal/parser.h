@@ -2,6 +2,7 @@
 #define LIMINAL_PARSER_H
 
 #include "liminal/ast.h"
+#include "liminal/context.h"
 #include "liminal/lexer.h"
 
 #ifdef __cplusplus
@@ -22,6 +23,7 @@ typedef struct {
 } ParseErrorVec;
 
 Parser *parser_create(const char *src, size_t len);
+Parser *parser_create_ctx(const LiminalContext *ctx, const char *src, size_t len);
 void parser_destroy(Parser *p);
 ASTNode *parse_program(Parser *p);
 int parser_has_errors(Parser *p);
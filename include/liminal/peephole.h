@@ -0,0 +1,28 @@
+#ifndef LIMINAL_PEEPHOLE_H
+#define LIMINAL_PEEPHOLE_H
+
+#include <stddef.h>
+#include "liminal/ir.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Superinstruction pass, run on a validated program right before it is
+// interpreted. Fuses the lowering's most frequent shapes (chosen with
+// `liminal ngrams`) so the interpreter dispatches once instead of 2-3 times:
+//   CONST_INT k; t = ADD a, k; STORE_VAR x, t    -> INC_VAR
+//   CONST_INT k; c = <cmp> a, k; JUMP_IF_FALSE c  -> CMP_CONST_BRANCH
+//   c = <cmp> a, b; JUMP_IF_FALSE c               -> CMP_BRANCH
+//   CONST_INT k; t = <arith> a, k                 -> ARITH_CONST
+//   t = ADD a, b; STORE_VAR x, t                  -> ADD_STORE
+// A temp is only dropped when nothing outside the fused group mentions it;
+// every other temp is still written, so behaviour is unchanged.
+// Returns the number of superinstructions formed.
+size_t ir_fuse_superinstructions(IrProgram *prog);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_PEEPHOLE_H
@@ -0,0 +1,89 @@
+#ifndef LIMINAL_PGO_H
+#define LIMINAL_PGO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "liminal/ir.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Profile-guided optimization. `liminal run --profile-out` records, per
+// function, how often it was called, how often each conditional branch was
+// taken, and how often each call site ran and what it called. Branches and
+// call sites are numbered in instruction order within their function, which
+// the superinstruction pass preserves, so a profile taken from the fused
+// program applies to the freshly lowered one. A profile belongs to the
+// program whose unoptimized IR hashes to its checksum.
+//
+// `--profile-in` (run and compile) feeds it to pgo_apply, which runs on the
+// lowered IR before superinstructions are formed.
+#define PGO_MAGIC "LIMPGO"
+#define PGO_FORMAT_VERSION 1
+
+typedef struct {
+  uint64_t taken;     // jumped to the target label
+  uint64_t not_taken; // fell through
+} PgoBranch;
+
+typedef struct {
+  char *target; // callee name
+  uint64_t count;
+} PgoSite;
+
+typedef struct {
+  char *name;
+  uint64_t calls;
+  PgoBranch *branches;
+  size_t branch_count;
+  PgoSite *sites;
+  size_t site_count;
+  int *ordinal; // recording: branch or site number of each instruction, -1 for others
+} PgoFunc;
+
+typedef struct PgoProfile {
+  uint64_t checksum;
+  PgoFunc *funcs;
+  size_t func_count;
+  const IrProgram *prog; // recording: the program being executed
+} PgoProfile;
+
+typedef struct {
+  size_t inlined;         // call sites replaced by the callee's body
+  size_t cases_reordered; // case statements whose arms were sorted by hits
+  size_t blocks_moved;    // cold else blocks moved to the end of the function
+} PgoStats;
+
+// Hash of the unoptimized IR a profile is keyed to
+uint64_t pgo_checksum(const IrProgram *prog);
+
+// Recording: zeroed counters shaped like prog (the program that will run)
+PgoProfile *pgo_profile_new(const IrProgram *prog, uint64_t checksum);
+void pgo_profile_free(PgoProfile *profile);
+// Interpreter hooks: a call of f, and instruction ip of f having run with
+// next as its successor
+void pgo_enter(PgoProfile *profile, const IrFunc *f);
+void pgo_count(PgoProfile *profile, const IrFunc *f, size_t ip, long next);
+// Adds from's counts into profile; 0 when from belongs to another program
+int pgo_profile_merge(PgoProfile *profile, const PgoProfile *from);
+
+// Files are written in host byte order, through a temp file and a rename
+int pgo_profile_save(const PgoProfile *profile, const char *path, char **errmsg);
+// Returns NULL and sets *errmsg (malloc'd) on a missing or malformed file
+PgoProfile *pgo_profile_load(const char *path, char **errmsg);
+
+// Rewrites prog using the profile:
+//   - hot call sites to small leaf functions are inlined;
+//   - `case` arms over distinct constants are tried most-frequent first;
+//   - an else block that almost never runs moves to the end of the
+//     function, so the hot path falls through instead of jumping over it.
+// Returns 0 and sets *errmsg (malloc'd), leaving prog untouched, when the
+// profile was recorded for a different program.
+int pgo_apply(IrProgram *prog, const PgoProfile *profile, PgoStats *stats, char **errmsg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_PGO_H
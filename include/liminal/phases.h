@@ -0,0 +1,55 @@
+#ifndef LIMINAL_PHASES_H
+#define LIMINAL_PHASES_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "liminal/alloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Phase report (`liminal run --time-phases`): wall time, allocations and
+// peak heap for each step of a run (read, parse, typecheck, lower,
+// validate, ..., execute). Allocation figures come from the counting
+// allocator (alloc.h) on the running thread; peak is the most heap live at
+// once during the phase, counting what earlier phases still hold.
+typedef struct {
+  const char *name;     // static string
+  uint64_t ns;
+  uint64_t allocs;
+  uint64_t frees;
+  uint64_t bytes;       // allocated during the phase
+  uint64_t peak;
+} PhaseStat;
+
+// Where a phase started
+typedef struct {
+  uint64_t ns;
+  AllocStats alloc;
+} PhaseMark;
+
+typedef struct PhaseLog {
+  PhaseStat *items;
+  size_t len;
+  size_t cap;
+} PhaseLog;
+
+PhaseLog *phase_log_new(void);
+void phase_log_free(PhaseLog *log);
+
+// Starts a phase: reads the clock and counters and restarts the peak
+PhaseMark phase_mark(void);
+// Records the phase that started at mark and ends now
+void phase_log_add(PhaseLog *log, const char *name, PhaseMark mark);
+
+// Table on out, one row per phase plus a total
+void phase_log_report(const PhaseLog *log, FILE *out);
+// The same as a JSON object
+void phase_log_write_json(const PhaseLog *log, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_PHASES_H
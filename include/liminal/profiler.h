@@ -0,0 +1,82 @@
+#ifndef LIMINAL_PROFILER_H
+#define LIMINAL_PROFILER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "liminal/ir.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Instrumenting profiler (`liminal run --profile`). The interpreter reports
+// every function entry and exit, every executed instruction and every
+// oracle call; the profiler keeps a shadow call stack so each function gets
+// inclusive time (first entry to matching exit, counted once across
+// recursion) and exclusive time (inclusive minus callees and oracle calls).
+// Times come from CLOCK_MONOTONIC. Instruction counts are kept per
+// instruction, so the report can map them back to source lines through
+// each function's line table. When ctx->profiler is NULL the interpreter
+// pays one pointer test per instruction.
+typedef struct {
+  uint64_t calls;
+  uint64_t inclusive_ns;
+  uint64_t exclusive_ns;
+  uint64_t oracle_ns;   // oracle calls made directly by this function
+  uint64_t instructions;
+  unsigned depth;       // live activations, so recursion is timed once
+} ProfFunc;
+
+typedef struct {
+  size_t func;
+  uint64_t start_ns;
+  uint64_t child_ns;    // time in callees and oracle calls
+} ProfFrame;
+
+typedef struct Profiler {
+  const IrProgram *prog;
+  ProfFunc *funcs;      // parallel to prog->funcs
+  ProfFrame *stack;
+  size_t depth;
+  size_t stack_cap;
+  uint64_t *ops;        // dynamic count per IrOp
+  uint64_t **counts;    // per function, per instruction
+  const char *source;   // path shown with source lines; may be NULL
+  uint64_t start_ns;
+  uint64_t total_ns;    // set by profiler_finish
+  uint64_t oracle_ns;
+  uint64_t oracle_calls;
+} Profiler;
+
+uint64_t profiler_now_ns(void);
+
+Profiler *profiler_new(const IrProgram *prog);
+void profiler_free(Profiler *p);
+
+void profiler_enter(Profiler *p, const IrFunc *f);
+void profiler_exit(Profiler *p);
+static inline void profiler_count(Profiler *p, const IrInstr *ins, size_t ip) {
+  size_t func = p->stack[p->depth - 1].func;
+  p->ops[ins->op]++;
+  p->funcs[func].instructions++;
+  p->counts[func][ip]++;
+}
+// Charges an oracle call that started at start_ns to the running function
+void profiler_oracle(Profiler *p, uint64_t start_ns);
+// Charges time spent waiting on an oracle without counting a call (the
+// waits of a stream between its chunks)
+void profiler_oracle_wait(Profiler *p, uint64_t start_ns);
+// Stops the clock; call once after the program returns
+void profiler_finish(Profiler *p);
+
+// Human-readable report: functions by exclusive time, the hottest source
+// lines, then ops by count
+void profiler_report(const Profiler *p, FILE *out);
+// The same data as a JSON object
+void profiler_write_json(const Profiler *p, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_PROFILER_H
@@ -0,0 +1,98 @@
+#ifndef LIMINAL_RECORDINGS_H
+#define LIMINAL_RECORDINGS_H
+
+#include <stddef.h>
+#include "liminal/oracles.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Recordings come in two formats. JSONL, one {"hash","prompt","response",
+// "ok"} object per line, is the default. The binary format (files named
+// *.lrec when recording starts them) keeps each answer as a raw 32-byte key,
+// an ok flag and the answer's bytes, appended to a data file, with an
+// open-addressing index of the keys in a sidecar <file>.idx that replay maps
+// instead of reading. Records appended after the index was written are
+// still found; `liminal recordings compact` folds them into a new index.
+// `liminal recordings convert` turns one format into the other.
+#define RECORDING_BINARY_EXT ".lrec"
+
+// 1 if path is a binary recording
+int recording_is_binary(const char *path);
+
+// Recorded answers for replay, read once and indexed by prompt hash, so
+// finding an answer costs a probe instead of a scan of the file. JSONL lines
+// may be of any length and their fields in any order; lines that are not
+// records are skipped. When a hash is recorded more than once, the first
+// record wins. A store does not change once open, so any number of threads
+// may look answers up at once.
+typedef struct ReplayStore ReplayStore;
+
+// NULL with *errmsg set (malloc'd) if the file cannot be read
+ReplayStore *replay_store_open(const char *path, char **errmsg);
+void replay_store_close(ReplayStore *s);
+// Distinct hashes in the store
+size_t replay_store_count(const ReplayStore *s);
+// The answer recorded for a prompt hash (64 hex digits): 1 with *out set
+// (the recorded text, or for "ok":false the recorded error), 0 if the hash
+// was never recorded
+int replay_store_find(const ReplayStore *s, const char *hash, OracleResult *out);
+
+// Appends records to a recording file held open between them, in the
+// file's format (a new or empty file: binary if it is named *.lrec). Each record
+// is formatted whole before it is queued, and the queue goes to the file in
+// one write() under an advisory lock (fcntl F_SETLKW), so records from
+// threads or processes recording to the same file never interleave and a
+// crash loses only what is queued, never part of a line.
+//
+// With flush_ms > 0 a writer thread of its own does the writes, so
+// recording adds no file I/O to the ask that produced the record: it writes
+// once RECORD_WRITER_BUFFER bytes are queued, once the oldest queued record
+// is flush_ms old, when asked to flush and when the writer is closed. With
+// flush_ms <= 0 each record is written as it is appended.
+#define RECORD_WRITER_BUFFER (64 * 1024)
+#define RECORD_WRITER_FLUSH_MS 1000
+typedef struct RecordWriter RecordWriter;
+
+// Creates path if need be; NULL with *errmsg set (malloc'd) if it cannot
+// be opened
+RecordWriter *record_writer_open(const char *path, long flush_ms, char **errmsg);
+// One JSONL record: the prompt's hash and canonical text, and r's text or,
+// for a failure, its error
+void record_writer_append(RecordWriter *w, const char *hash, const char *prompt, const OracleResult *r);
+// Waits until every record appended so far is written; -1 if a write has
+// failed since the writer was opened
+int record_writer_flush(RecordWriter *w);
+// Flushes, stops the writer thread and closes the file; -1 as for flush
+int record_writer_close(RecordWriter *w);
+
+// What `liminal recordings stats` reports
+typedef struct {
+  int binary;
+  size_t records;      // whole records, repeats included
+  size_t distinct;     // distinct prompt hashes
+  size_t failures;     // records of failed asks
+  size_t skipped;      // JSONL: lines that are not records; binary: bytes of a torn last record
+  size_t file_bytes;
+  size_t answer_bytes; // answers and errors, unescaped
+  int indexed;         // binary: the sidecar index is usable
+  size_t unindexed;    // binary: records appended after the index was written
+} RecordingStats;
+
+// These return 0, or -1 with *errmsg set (malloc'd)
+int recordings_stats(const char *path, RecordingStats *st, char **errmsg);
+// Writes in's records to out in the other format, every record kept; a
+// binary out gets its index. Binary records have no prompt, so JSONL
+// written from one has none either.
+int recordings_convert(const char *in, const char *out, char **errmsg);
+// Rewrites a binary recording with only the first record of each hash and
+// without a torn last record, and writes its index afresh. Nothing may be
+// recording to it meanwhile.
+int recordings_compact(const char *path, char **errmsg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_RECORDINGS_H
@@ -40,7 +40,7 @@ struct LArray {
   LValue *items;
 };
 
-// Allocation counters (for tests)
+// Allocation counters (for tests); counted per calling thread
 void runtime_reset_counters(void);
 size_t runtime_alloc_count(void);
 size_t runtime_free_count(void);
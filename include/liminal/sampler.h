@@ -0,0 +1,77 @@
+#ifndef LIMINAL_SAMPLER_H
+#define LIMINAL_SAMPLER_H
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "liminal/ir.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Sampling profiler (`liminal run --sample <file>`). An ITIMER_PROF timer
+// raises SIGPROF at a fixed rate of CPU time; the handler only bumps a tick
+// counter. The interpreter polls it after each instruction and, when it
+// moved, records the Liminal call stack: the function of every active frame
+// plus the source line the innermost one just ran (the instruction, for IR
+// without a line table). Stacks are aggregated and written in the collapsed
+// format flamegraph tools read:
+//   Main;Route;Score;route.lim:14 37
+//   Main;Route;Score;ADD@14 37
+// Only one sampler can run per process, since the timer is process-wide.
+typedef struct {
+  uint32_t func; // index into prog->funcs
+  uint32_t ip;   // instruction running in this frame (a CALL for callers)
+} SampleFrame;
+
+// Callers are told apart by function only, so the two sites that call the
+// same function merge into one stack
+typedef struct {
+  uint64_t hash;
+  uint32_t *funcs; // outermost first; NULL marks a free slot
+  uint32_t depth;
+  uint32_t ip;     // the innermost frame's instruction
+  uint32_t line;   // its source line; 0 when unknown, and then ip tells apart
+  uint64_t count;
+} SampleStack;
+
+typedef struct Sampler {
+  const IrProgram *prog;
+  const char *source; // path shown with source lines; may be NULL
+  SampleFrame *stack;
+  size_t depth;
+  size_t stack_cap;
+  const volatile sig_atomic_t *ticks;
+  sig_atomic_t seen;
+  SampleStack *stacks; // open addressing by hash
+  size_t cap;
+  size_t used;
+  uint64_t samples;
+  int running;
+} Sampler;
+
+Sampler *sampler_new(const IrProgram *prog);
+void sampler_free(Sampler *s);
+
+// Arms the timer at hz samples per second of CPU time; returns 0 and sets
+// *errmsg (malloc'd) when it cannot
+int sampler_start(Sampler *s, long hz, char **errmsg);
+void sampler_stop(Sampler *s);
+
+// Interpreter hooks: frame push/pop, the instruction about to run, and a
+// poll after it ran
+void sampler_enter(Sampler *s, const IrFunc *f);
+static inline void sampler_exit(Sampler *s) { s->depth--; }
+static inline void sampler_at(Sampler *s, size_t ip) { s->stack[s->depth - 1].ip = (uint32_t)ip; }
+void sampler_take(Sampler *s);
+static inline void sampler_poll(Sampler *s) { if (*s->ticks != s->seen) sampler_take(s); }
+
+// One line per distinct stack, most samples first
+void sampler_write_folded(const Sampler *s, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_SAMPLER_H
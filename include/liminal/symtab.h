@@ -19,6 +19,7 @@ typedef struct Scope Scope;
 
 typedef struct Symtab {
   Scope *top;
+  int debug; // trace lookups (LIMINAL_DEBUG_TC), set by the owner
 } Symtab;
 
 Symtab *symtab_create(void);
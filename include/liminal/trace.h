@@ -0,0 +1,67 @@
+#ifndef LIMINAL_TRACE_H
+#define LIMINAL_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "liminal/ir.h"
+#include "liminal/oracles.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Timeline tracer (`liminal run --trace <file>`). Writes Chrome trace-event
+// JSON, which chrome://tracing and Perfetto open, as the run goes:
+//   - compile phases (read, parse, typecheck, lower, ...), category "compile"
+//   - function calls lasting at least min_ns, category "call"
+//   - every ask, category "oracle", with the oracle's name, a hash of the
+//     prompt and the size of the response; asks made by a consult are named
+//     "consult", and its retries "consult retry", with the attempt number
+// All are complete ("X") events timed with CLOCK_MONOTONIC from when the
+// tracer opened. Events are formatted into an in-memory buffer that goes to
+// the file in large writes, so a traced run costs a clock read per call.
+typedef struct {
+  const IrFunc *func;
+  uint64_t start_ns;
+  size_t consult_ip;    // last consult ask in this frame, and its state
+  long consult_left;
+  int consult_attempt;
+} TraceFrame;
+
+typedef struct Tracer {
+  FILE *out;
+  char *buf;
+  size_t len;
+  size_t cap;
+  uint64_t start_ns;
+  uint64_t min_ns;
+  const char *source;   // path shown with function spans; may be NULL
+  TraceFrame *stack;
+  size_t depth;
+  size_t stack_cap;
+  uint64_t events;
+  int failed;           // a write failed; the file is incomplete
+} Tracer;
+
+// Opens path and writes the header; returns NULL and sets *errmsg
+// (malloc'd) when it cannot
+Tracer *tracer_open(const char *path, uint64_t min_ns, char **errmsg);
+// Writes the footer and closes the file; returns 0 if any write failed
+int tracer_close(Tracer *t);
+
+// A span from start_ns (profiler_now_ns) until now
+void tracer_span(Tracer *t, const char *name, const char *cat, uint64_t start_ns);
+
+// Interpreter hooks: frame push/pop, and an ask that started at start_ns.
+// left is what a consult has left of its attempts, counting this one, or
+// -1 for a plain ask.
+void tracer_enter(Tracer *t, const IrFunc *f);
+void tracer_exit(Tracer *t);
+void tracer_ask(Tracer *t, uint64_t start_ns, size_t ip, const char *oracle, const char *prompt,
+                const OracleResult *r, long left);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_TRACE_H
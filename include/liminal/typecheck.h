@@ -4,6 +4,7 @@
 #include "liminal/ast.h"
 #include "liminal/types.h"
 #include "liminal/symtab.h"
+#include "liminal/context.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,6 +29,7 @@ typedef struct {
 } TypeCheckResult;
 
 TypeCheckResult typecheck_program(ASTNode *prog);
+TypeCheckResult typecheck_program_ctx(ASTNode *prog, const LiminalContext *ctx);
 void typecheck_result_free(TypeCheckResult *res);
 
 #ifdef __cplusplus
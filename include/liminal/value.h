@@ -0,0 +1,111 @@
+#ifndef LIMINAL_VALUE_H
+#define LIMINAL_VALUE_H
+
+#include <stddef.h>
+#include "liminal/context.h"
+#include "liminal/ir.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Runtime values and environments (liminal_rt). Shared by the interpreter
+// and by programs built with `liminal compile`: each rt_* helper implements
+// one IR opcode, so both execution modes produce identical output.
+
+typedef enum { VINT, VREAL, VSTRING, VRESULT, VBOOL, VOPTIONAL } ValKind;
+typedef struct {
+  int ok;
+  char *text;
+  char *error;
+} VRes;
+typedef struct Value Value;
+typedef struct Value {
+  ValKind kind;
+  int i;
+  double f;
+  char *s;
+  int owns;
+  char *ref; // optional reference name
+  int ref_interned;
+  VRes res;
+  struct { int is_some; Value *inner; } opt;
+} Value;
+
+typedef struct { char *name; Value val; } Var;
+typedef struct Env Env;
+typedef struct Env { Var *items; size_t len; size_t cap; Env *parent; char **refs; size_t refs_len; size_t refs_cap; } Env;
+
+static inline Value v_int(int x){ Value v={0}; v.kind=VINT; v.i=x; return v; }
+static inline Value v_bool(int x){ Value v={0}; v.kind=VBOOL; v.i=x?1:0; return v; }
+static inline Value v_real(double x){ Value v={0}; v.kind=VREAL; v.f=x; return v; }
+static inline Value v_optional_none(void){ Value v={0}; v.kind=VOPTIONAL; v.opt.is_some=0; v.opt.inner=NULL; return v; }
+Value v_string(LiminalContext *ctx, const char *s);
+Value v_result_ok(LiminalContext *ctx, const char *text);
+Value v_result_err(LiminalContext *ctx, const char *err);
+Value v_optional_some(LiminalContext *ctx, Value inner);
+Value v_copy(LiminalContext *ctx, Value v);
+void v_free(LiminalContext *ctx, Value v);
+void print_value(LiminalContext *ctx, Value v);
+Value parse_value(LiminalContext *ctx, const char *s);
+
+// Environments are name-keyed; dotted names address record fields and
+// array elements, and values loaded from a variable carry its name in ref
+Value *env_find(Env *env, const char *name);
+void env_set(LiminalContext *ctx, Env *env, const char *name, Value v);
+Value env_get(LiminalContext *ctx, Env *env, const char *name);
+void env_free(LiminalContext *ctx, Env *env);
+
+// Slot-cached access for compiled code. *slot starts at -1 and remembers the
+// variable's index in env, which is stable for the env's lifetime.
+// rt_peek_var returns a borrowed shallow view (scratch holds it when the
+// variable is not local); rt_store_var is env_set for undotted names.
+Value rt_peek_var(LiminalContext *ctx, Env *env, const char *name, long *slot, Value *scratch);
+void rt_store_var(LiminalContext *ctx, Env *env, const char *name, long *slot, Value v);
+
+// Integer arithmetic exactly as the interpreter has always done it (in double)
+static inline int rt_int_arith(IrOp op, int a, int b){
+  double da=a, db=b, r=0;
+  switch(op){ case IR_ADD: r=da+db; break; case IR_SUB: r=da-db; break; case IR_MUL: r=da*db; break; case IR_DIV: r=db!=0?da/db:0; break; case IR_MOD: r=a % b; break; default: break; }
+  return (int)r;
+}
+// rt_compare on Integer/Boolean operands
+static inline int rt_int_compare(IrOp op, int a, int b){
+  switch(op){ case IR_EQ: return a==b; case IR_NEQ: return a!=b; case IR_LT: return a<b; case IR_GT: return a>b; case IR_LE: return a<=b; case IR_GE: return a>=b; default: return 0; }
+}
+// Arithmetic once either operand is a Real (both widened to double)
+static inline double rt_num_arith(IrOp op, double da, double db){
+  switch(op){ case IR_ADD: return da+db; case IR_SUB: return da-db; case IR_MUL: return da*db; case IR_DIV: return db!=0?da/db:0; case IR_MOD: return (int)da % (int)db; default: return 0; }
+}
+static inline int rt_compare(IrOp op, Value a, Value b){
+  double da=(a.kind==VREAL)?a.f:a.i, db=(b.kind==VREAL)?b.f:b.i;
+  switch(op){ case IR_EQ: return da==db; case IR_NEQ: return da!=db; case IR_LT: return da<db; case IR_GT: return da>db; case IR_LE: return da<=db; case IR_GE: return da>=db; default: return 0; }
+}
+// Condition truthiness (JUMP_IF_FALSE, AND, OR)
+static inline int rt_truthy(Value v){ if(v.kind==VINT||v.kind==VBOOL) return v.i!=0; if(v.kind==VREAL) return v.f!=0; return v.s && v.s[0]; }
+static inline int rt_result_is_ok(Value rv){ return rv.kind==VRESULT && rv.res.ok; }
+
+// Opcode helpers: each computes its result, then releases and replaces *dst
+void rt_arith_slow(LiminalContext *ctx, IrOp op, Value *dst, Value a, Value b);
+static inline void rt_arith(LiminalContext *ctx, IrOp op, Value *dst, Value a, Value b){
+  if (a.kind==VINT && b.kind==VINT) { int r=rt_int_arith(op, a.i, b.i); v_free(ctx, *dst); *dst=v_int(r); return; }
+  rt_arith_slow(ctx, op, dst, a, b);
+}
+void rt_load_var(LiminalContext *ctx, Env *env, Value *dst, const char *name);
+void rt_readln(LiminalContext *ctx, Env *env, const char *name);
+void rt_read_file(LiminalContext *ctx, Value *dst, Value path);
+void rt_write_file(Value path, Value content);
+void rt_result_unwrap(LiminalContext *ctx, Value *dst, Value rv, const Value *fallback);
+void rt_result_unwrap_err(LiminalContext *ctx, Value *dst, Value rv);
+void rt_make_result(LiminalContext *ctx, Value *dst, Value v, int ok);
+void rt_concat(LiminalContext *ctx, Value *dst, Value a, Value b);
+void rt_result_or_fallback(LiminalContext *ctx, Value *dst, Value rv, const Value *fallback);
+void rt_index(LiminalContext *ctx, Env *env, Value *dst, const char *base, Value idx);
+// Function epilogue: hands RET's value, or the Result variable, to ret_out
+void rt_finish(LiminalContext *ctx, Env *env, Value *ret_out, Value retval, int had_ret);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_VALUE_H
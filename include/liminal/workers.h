@@ -0,0 +1,31 @@
+#ifndef LIMINAL_WORKERS_H
+#define LIMINAL_WORKERS_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fixed-size worker pool for `parallel` blocks. The threads start with the
+// pool and sleep between batches; the thread running a batch works on it
+// too, so a pool of size n runs up to n items at once with n - 1 threads.
+// Items are handed out in index order. One batch runs at a time per pool.
+typedef struct WorkerPool WorkerPool;
+
+typedef void (*WorkFn)(void *arg, size_t index);
+
+// size < 1 counts as 1 (no threads: batches run on the caller). Threads
+// that fail to start are done without.
+WorkerPool *worker_pool_new(size_t size);
+// Runs fn(arg, i) for every i < n and returns once all have finished
+void worker_pool_run(WorkerPool *p, WorkFn fn, void *arg, size_t n);
+// Threads started, not counting the caller
+size_t worker_pool_threads(const WorkerPool *p);
+void worker_pool_free(WorkerPool *p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMINAL_WORKERS_H
@@ -0,0 +1,80 @@
+#define _GNU_SOURCE
+#include "liminal/alloc.h"
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Per thread, like the runtime's counters, so concurrent runs never share
+// mutable state
+static _Thread_local AllocStats stats;
+
+static void *counted(void *p){
+  if (!p) return NULL;
+  size_t n = malloc_usable_size(p);
+  stats.allocs++;
+  stats.bytes += n;
+  stats.live += n;
+  if (stats.live > stats.peak) stats.peak = stats.live;
+  return p;
+}
+
+static void uncount(void *p){
+  size_t n = malloc_usable_size(p);
+  stats.frees++;
+  stats.live = stats.live > n ? stats.live - n : 0;
+}
+
+void *lm_malloc(size_t n){ return counted(malloc(n)); }
+void *lm_calloc(size_t count, size_t n){ return counted(calloc(count, n)); }
+char *lm_strdup(const char *s){ return counted(strdup(s)); }
+char *lm_strndup(const char *s, size_t n){ return counted(strndup(s, n)); }
+
+void lm_free(void *p){
+  if (!p) return;
+  uncount(p);
+  free(p);
+}
+
+void *lm_realloc(void *p, size_t n){
+  if (!p) return lm_malloc(n);
+  size_t old = malloc_usable_size(p);
+  void *q = realloc(p, n);
+  if (!q) return NULL;
+  size_t now = malloc_usable_size(q);
+  if (q != p) stats.allocs++;
+  if (now > old) stats.bytes += now - old;
+  stats.live = stats.live + now > old ? stats.live + now - old : 0;
+  if (stats.live > stats.peak) stats.peak = stats.live;
+  return q;
+}
+
+AllocStats alloc_stats(void){ return stats; }
+
+void alloc_reset_peak(void){ stats.peak = stats.live; }
+
+AllocStats alloc_mark(void){
+  alloc_reset_peak();
+  return stats;
+}
+
+AllocStats alloc_since(AllocStats mark){
+  AllocStats d;
+  d.allocs = stats.allocs - mark.allocs;
+  d.frees = stats.frees - mark.frees;
+  d.bytes = stats.bytes - mark.bytes;
+  d.live = stats.live - mark.live; // wraps when the thread freed more than it allocated
+  d.peak = stats.peak > mark.live ? stats.peak - mark.live : 0;
+  return d;
+}
+
+void alloc_add(AllocStats *into, AllocStats delta){
+  into->allocs += delta.allocs;
+  into->frees += delta.frees;
+  into->bytes += delta.bytes;
+  if (into->live + delta.peak > into->peak) into->peak = into->live + delta.peak;
+  int64_t live = (int64_t)delta.live;
+  into->live = live >= 0 || into->live > (uint64_t)-live ? into->live + (uint64_t)live : 0;
+}
+
+void alloc_merge(AllocStats delta){ alloc_add(&stats, delta); }
@@ -0,0 +1,457 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/aot.h"
+#include "liminal/exec.h"
+#include "liminal/version.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// Toolchain defaults baked in by the build (src/CMakeLists.txt); the
+// LIMINAL_CC, LIMINAL_CFLAGS, LIMINAL_RT_LIBRARY and LIMINAL_INCLUDE_DIR
+// environment variables override them.
+#ifndef LIMINAL_AOT_CC
+#define LIMINAL_AOT_CC "cc"
+#endif
+#ifndef LIMINAL_AOT_FLAGS
+#define LIMINAL_AOT_FLAGS ""
+#endif
+#ifndef LIMINAL_RT_LIBRARY
+#define LIMINAL_RT_LIBRARY "libliminal_rt.a"
+#endif
+#ifndef LIMINAL_RT_INCLUDE_DIR
+#define LIMINAL_RT_INCLUDE_DIR "include"
+#endif
+
+// How a temp is represented in generated code
+typedef enum {
+  TEMP_DYN,    // Value in t[], released on overwrite
+  TEMP_INT,    // C int; proven Integer, defined before every use
+  TEMP_BOOL,   // C int holding 0/1; proven Boolean
+  TEMP_BORROW  // LOAD_VAR result read in place: a shallow view of the variable
+} TempKind;
+
+typedef struct {
+  const IrProgram *prog;
+  const IrFunc *f;
+  int ntemps;
+  TempKind *kind;
+  int *slot;          // index into t[] for DYN/BORROW temps, -1 otherwise
+  int nslots;
+  long *target;       // per instruction: first LABEL with the referenced name, or -1
+  const char **vars;  // variables with slot caches (s0, s1, ...)
+  size_t nvars;
+  int has_ret;
+} FuncGen;
+
+static long find_func_index(const IrProgram *prog, const char *name){
+  for (size_t i=0;i<prog->funcs.len;++i) if (strcmp(prog->funcs.items[i].name, name ? name : "")==0) return (long)i;
+  return -1;
+}
+
+static int defines_temp(IrOp op){
+  switch(op){
+  case IR_CONST_INT: case IR_CONST_REAL: case IR_CONST_STRING: case IR_CONST_BOOL: case IR_CONST_OPTIONAL_NONE:
+  case IR_LOAD_VAR: case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_MOD:
+  case IR_EQ: case IR_NEQ: case IR_LT: case IR_GT: case IR_LE: case IR_GE: case IR_AND: case IR_OR:
+  case IR_READ_FILE: case IR_ASK: case IR_RESULT_UNWRAP: case IR_RESULT_IS_OK: case IR_RESULT_UNWRAP_ERR:
+  case IR_MAKE_RESULT_OK: case IR_MAKE_RESULT_ERR: case IR_CONCAT: case IR_RESULT_OR_FALLBACK: case IR_CALL: case IR_INDEX:
+  case IR_STREAM_OPEN: case IR_STREAM_NEXT: case IR_ASK_START: case IR_AWAIT:
+    return 1;
+  default: return 0;
+  }
+}
+
+// Temps an instruction reads, mirroring what execute_func touches
+static int temp_uses(const IrProgram *prog, const IrInstr *ins, int out[2]){
+  int n=0;
+  switch(ins->op){
+  case IR_STORE_VAR: case IR_JUMP_IF_FALSE: case IR_RET: case IR_PRINT: case IR_READ_FILE:
+  case IR_RESULT_IS_OK: case IR_RESULT_UNWRAP_ERR: case IR_MAKE_RESULT_OK: case IR_MAKE_RESULT_ERR:
+  case IR_STREAM_OPEN: case IR_STREAM_NEXT: case IR_AWAIT:
+    out[n++]=ins->arg1; break;
+  case IR_PRINTLN: if (ins->arg1>=0) out[n++]=ins->arg1; break;
+  case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_MOD: case IR_EQ: case IR_NEQ: case IR_LT: case IR_GT:
+  case IR_LE: case IR_GE: case IR_AND: case IR_OR: case IR_WRITE_FILE: case IR_CONCAT:
+    out[n++]=ins->arg1; out[n++]=ins->arg2; break;
+  case IR_ASK: case IR_ASK_START: case IR_RESULT_UNWRAP: case IR_RESULT_OR_FALLBACK:
+    out[n++]=ins->arg1; if (ins->arg2>=0) out[n++]=ins->arg2; break;
+  case IR_CALL: {
+    long k = find_func_index(prog, ins->s);
+    if (k<0) break;
+    const IrFunc *cf = &prog->funcs.items[k];
+    if (cf->param_count>0 && ins->arg1>=0) out[n++]=ins->arg1;
+    if (cf->param_count>1 && ins->arg2>=0) out[n++]=ins->arg2;
+    break; }
+  case IR_INDEX: out[n++]=ins->arg2; break;
+  default: break;
+  }
+  return n;
+}
+
+// Consumers that keep the operand's ref (variable aliasing) need an owned copy
+static int keeps_ref(IrOp op){ return op==IR_STORE_VAR || op==IR_RET || op==IR_CALL || op==IR_ASK || op==IR_ASK_START; }
+
+// Every jump into (def, last] comes from inside [def, last]: the definition
+// then dominates each use and nothing outside the range runs in between
+static int confined(const FuncGen *g, long def, long last){
+  for (size_t i=0;i<g->f->instrs.len;++i) {
+    long q = g->target[i];
+    IrOp op = g->f->instrs.items[i].op;
+    if (q<0 || (op!=IR_JUMP && op!=IR_JUMP_IF_FALSE)) continue;
+    if (q>def && q<=last && ((long)i<def || (long)i>last)) return 0;
+  }
+  return 1;
+}
+
+static int clobbers_var(const FuncGen *g, const char *name, long def, long last){
+  for (long i=def+1;i<=last;++i) {
+    const IrInstr *ins = &g->f->instrs.items[i];
+    if ((ins->op==IR_STORE_VAR || ins->op==IR_READLN) && ins->s && strcmp(ins->s, name)==0) return 1;
+  }
+  return 0;
+}
+
+static int is_typed(TempKind k){ return k==TEMP_INT || k==TEMP_BOOL; }
+
+static void analyze(FuncGen *g){
+  const IrFunc *f = g->f;
+  size_t n = f->instrs.len;
+  int nt = f->next_temp + 16;
+  for (size_t i=0;i<n;++i) {
+    const IrInstr *ins = &f->instrs.items[i];
+    int u[2]; int nu = temp_uses(g->prog, ins, u);
+    for (int k=0;k<nu;++k) if (u[k]>=nt) nt=u[k]+1;
+    if (defines_temp(ins->op) && ins->dest>=nt) nt=ins->dest+1;
+  }
+  g->ntemps = nt;
+  g->kind = calloc((size_t)nt, sizeof(TempKind));
+  g->slot = malloc((size_t)nt*sizeof(int));
+  g->target = malloc((n?n:1)*sizeof(long));
+  int *defs = calloc((size_t)nt, sizeof(int)), *bad = calloc((size_t)nt, sizeof(int)), *refd = calloc((size_t)nt, sizeof(int)), *seen = calloc((size_t)nt, sizeof(int));
+  long *last = calloc((size_t)nt, sizeof(long));
+
+  for (size_t i=0;i<n;++i) {
+    const IrInstr *ins = &f->instrs.items[i];
+    g->target[i] = -1;
+    if ((ins->op==IR_JUMP || ins->op==IR_JUMP_IF_FALSE || ins->op==IR_LABEL) && ins->s) {
+      for (size_t j=0;j<n;++j) if (f->instrs.items[j].op==IR_LABEL && strcmp(f->instrs.items[j].s, ins->s)==0) { g->target[i]=(long)j; break; }
+    }
+    if (ins->op==IR_RET) g->has_ret = 1;
+    int u[2]; int nu = temp_uses(g->prog, ins, u);
+    for (int k=0;k<nu;++k) {
+      int t=u[k]; if (t<0) continue;
+      seen[t]=1;
+      if (defs[t]!=1) bad[t]=1; // read before (or without) its only definition
+      last[t]=(long)i;
+      if (keeps_ref(ins->op)) refd[t]=1;
+    }
+    if (defines_temp(ins->op) && ins->dest>=0) { defs[ins->dest]++; seen[ins->dest]=1; if (defs[ins->dest]>1) bad[ins->dest]=1; }
+  }
+
+  for (size_t i=0;i<n;++i) {
+    const IrInstr *ins = &f->instrs.items[i];
+    if (!defines_temp(ins->op) || ins->dest<0) continue;
+    int d = ins->dest;
+    if (bad[d]) continue;
+    long end = last[d] > (long)i ? last[d] : (long)i;
+    if (!confined(g, (long)i, end)) continue;
+    switch(ins->op){
+    case IR_CONST_INT: case IR_RESULT_IS_OK: g->kind[d]=TEMP_INT; break;
+    case IR_CONST_BOOL: case IR_EQ: case IR_NEQ: case IR_LT: case IR_GT: case IR_LE: case IR_GE: case IR_AND: case IR_OR:
+      g->kind[d]=TEMP_BOOL; break;
+    case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_MOD:
+      if (is_typed(g->kind[ins->arg1]) && is_typed(g->kind[ins->arg2])) g->kind[d]=TEMP_INT;
+      break;
+    case IR_LOAD_VAR:
+      if (!refd[d] && !clobbers_var(g, ins->s, (long)i, end)) g->kind[d]=TEMP_BORROW;
+      break;
+    default: break;
+    }
+  }
+
+  g->nslots = 0;
+  for (int t=0;t<nt;++t) g->slot[t] = (seen[t] && !is_typed(g->kind[t])) ? g->nslots++ : -1;
+  free(defs); free(bad); free(refd); free(seen); free(last);
+}
+
+static long var_cache(FuncGen *g, const char *name){
+  for (size_t i=0;i<g->nvars;++i) if (strcmp(g->vars[i], name)==0) return (long)i;
+  g->vars = realloc(g->vars, (g->nvars+1)*sizeof(char*));
+  g->vars[g->nvars] = name;
+  return (long)g->nvars++;
+}
+
+static void emit_cstr(FILE *out, const char *s){
+  fputc('"', out);
+  for (const unsigned char *p=(const unsigned char *)(s?s:""); *p; ++p) {
+    if (*p=='"' || *p=='\\' || *p=='?') fprintf(out, "\\%c", *p);
+    else if (*p<0x20 || *p>=0x7f) fprintf(out, "\\%03o", *p);
+    else fputc(*p, out);
+  }
+  fputc('"', out);
+}
+
+static void emit_real(FILE *out, double x){
+  if (isnan(x)) fputs("NAN", out);
+  else if (isinf(x)) fputs(x<0 ? "(-HUGE_VAL)" : "HUGE_VAL", out);
+  else fprintf(out, "%a", x);
+}
+
+// Operand as a Value expression
+static void emit_val(FILE *out, const FuncGen *g, int t){
+  switch(g->kind[t]){
+  case TEMP_INT: fprintf(out, "v_int(i%d)", t); break;
+  case TEMP_BOOL: fprintf(out, "v_bool(i%d)", t); break;
+  case TEMP_BORROW: fprintf(out, "b%d", t); break;
+  default: fprintf(out, "t[%d]", g->slot[t]); break;
+  }
+}
+
+// Optional operand as a const Value * expression
+static void emit_ptr(FILE *out, const FuncGen *g, int t){
+  if (t<0) { fputs("NULL", out); return; }
+  switch(g->kind[t]){
+  case TEMP_INT: fprintf(out, "&(Value){.kind=VINT, .i=i%d}", t); break;
+  case TEMP_BOOL: fprintf(out, "&(Value){.kind=VBOOL, .i=i%d}", t); break;
+  case TEMP_BORROW: fprintf(out, "&b%d", t); break;
+  default: fprintf(out, "&t[%d]", g->slot[t]); break;
+  }
+}
+
+static const char *op_name(IrOp op){
+  switch(op){
+  case IR_ADD: return "IR_ADD"; case IR_SUB: return "IR_SUB"; case IR_MUL: return "IR_MUL"; case IR_DIV: return "IR_DIV"; case IR_MOD: return "IR_MOD";
+  case IR_EQ: return "IR_EQ"; case IR_NEQ: return "IR_NEQ"; case IR_LT: return "IR_LT"; case IR_GT: return "IR_GT"; case IR_LE: return "IR_LE"; case IR_GE: return "IR_GE";
+  default: return "IR_NOP";
+  }
+}
+
+// Starts "release dest, then assign" for a DYN destination
+static void emit_set_dyn(FILE *out, const FuncGen *g, int d){ fprintf(out, "v_free(ctx, t[%d]); t[%d]=", g->slot[d], g->slot[d]); }
+
+static int emit_instr(FILE *out, FuncGen *g, size_t i, char **errmsg){
+  const IrInstr *ins = &g->f->instrs.items[i];
+  int d = ins->dest;
+  fputs("  ", out);
+  switch(ins->op){
+  case IR_NOP: fputs(";\n", out); return 1;
+  case IR_CONST_INT: case IR_CONST_BOOL: {
+    int k = ins->op==IR_CONST_BOOL ? ins->arg1!=0 : ins->arg1;
+    if (is_typed(g->kind[d])) fprintf(out, "i%d = %d;\n", d, k);
+    else { emit_set_dyn(out, g, d); fprintf(out, "%s(%d);\n", ins->op==IR_CONST_BOOL ? "v_bool" : "v_int", k); }
+    return 1; }
+  case IR_CONST_REAL: emit_set_dyn(out, g, d); fputs("v_real(", out); emit_real(out, ins->f); fputs(");\n", out); return 1;
+  case IR_CONST_STRING: emit_set_dyn(out, g, d); fputs("v_string(ctx, ", out); emit_cstr(out, ins->s); fputs(");\n", out); return 1;
+  case IR_CONST_OPTIONAL_NONE: emit_set_dyn(out, g, d); fputs("v_optional_none();\n", out); return 1;
+  case IR_LOAD_VAR:
+    if (g->kind[d]==TEMP_BORROW) { fprintf(out, "b%d = rt_peek_var(ctx, env, ", d); emit_cstr(out, ins->s); fprintf(out, ", &s%ld, &t[%d]);\n", var_cache(g, ins->s), g->slot[d]); }
+    else { fprintf(out, "rt_load_var(ctx, env, &t[%d], ", g->slot[d]); emit_cstr(out, ins->s); fputs(");\n", out); }
+    return 1;
+  case IR_STORE_VAR:
+    if (!strchr(ins->s, '.')) { fputs("rt_store_var(ctx, env, ", out); emit_cstr(out, ins->s); fprintf(out, ", &s%ld, ", var_cache(g, ins->s)); }
+    else { fputs("env_set(ctx, env, ", out); emit_cstr(out, ins->s); fputs(", ", out); }
+    emit_val(out, g, ins->arg1); fputs(");\n", out);
+    return 1;
+  case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_MOD:
+    if (g->kind[d]==TEMP_INT) fprintf(out, "i%d = rt_int_arith(%s, i%d, i%d);\n", d, op_name(ins->op), ins->arg1, ins->arg2);
+    else { fprintf(out, "rt_arith(ctx, %s, &t[%d], ", op_name(ins->op), g->slot[d]); emit_val(out, g, ins->arg1); fputs(", ", out); emit_val(out, g, ins->arg2); fputs(");\n", out); }
+    return 1;
+  case IR_EQ: case IR_NEQ: case IR_LT: case IR_GT: case IR_LE: case IR_GE: case IR_AND: case IR_OR: {
+    if (is_typed(g->kind[d])) fprintf(out, "i%d = ", d);
+    else { emit_set_dyn(out, g, d); fputs("v_bool(", out); }
+    if (ins->op==IR_AND || ins->op==IR_OR) {
+      fputs("rt_truthy(", out); emit_val(out, g, ins->arg1); fputs(ins->op==IR_AND ? ") && rt_truthy(" : ") || rt_truthy(", out); emit_val(out, g, ins->arg2); fputs(")", out);
+    } else {
+      fprintf(out, "rt_compare(%s, ", op_name(ins->op)); emit_val(out, g, ins->arg1); fputs(", ", out); emit_val(out, g, ins->arg2); fputs(")", out);
+    }
+    fputs(is_typed(g->kind[d]) ? ";\n" : ");\n", out);
+    return 1; }
+  case IR_JUMP:
+    if (g->target[i]>=0) fprintf(out, "goto L%ld;\n", g->target[i]); else fputs(";\n", out);
+    return 1;
+  case IR_JUMP_IF_FALSE:
+    if (g->target[i]>=0) { fputs("if (!rt_truthy(", out); emit_val(out, g, ins->arg1); fprintf(out, ")) goto L%ld;\n", g->target[i]); }
+    else fputs(";\n", out);
+    return 1;
+  case IR_LABEL:
+    if (g->target[i]==(long)i) fprintf(out, "L%zu:;\n", i); else fputs(";\n", out);
+    return 1;
+  case IR_RET:
+    fputs("if (ret_out) { v_free(ctx, retval); retval=v_copy(ctx, ", out); emit_val(out, g, ins->arg1); fputs("); had_ret=1; }\n  goto done;\n", out);
+    return 1;
+  case IR_PRINT: fputs("print_value(ctx, ", out); emit_val(out, g, ins->arg1); fputs(");\n", out); return 1;
+  case IR_PRINTLN:
+    if (ins->arg1>=0) { fputs("print_value(ctx, ", out); emit_val(out, g, ins->arg1); fputs("); ", out); }
+    fputs("liminal_context_write(ctx, \"\\n\", 1);\n", out);
+    return 1;
+  case IR_READLN: fputs("rt_readln(ctx, env, ", out); emit_cstr(out, ins->s); fputs(");\n", out); return 1;
+  case IR_READ_FILE: fprintf(out, "rt_read_file(ctx, &t[%d], ", g->slot[d]); emit_val(out, g, ins->arg1); fputs(");\n", out); return 1;
+  case IR_WRITE_FILE: fputs("rt_write_file(", out); emit_val(out, g, ins->arg1); fputs(", ", out); emit_val(out, g, ins->arg2); fputs(");\n", out); return 1;
+  case IR_ASK: case IR_ASK_START: case IR_AWAIT: case IR_STREAM_OPEN: case IR_STREAM_NEXT: {
+    const char *fmt = "function %s uses ask/consult/stream: oracle calls are not supported in AOT mode (use `liminal run`)";
+    size_t len = strlen(fmt)+strlen(g->f->name)+1;
+    *errmsg = malloc(len); snprintf(*errmsg, len, fmt, g->f->name);
+    return 0; }
+  case IR_FORK: case IR_JOIN: {
+    const char *fmt = "function %s uses parallel: parallel blocks are not supported in AOT mode (use `liminal run`)";
+    size_t len = strlen(fmt)+strlen(g->f->name)+1;
+    *errmsg = malloc(len); snprintf(*errmsg, len, fmt, g->f->name);
+    return 0; }
+  case IR_RESULT_UNWRAP: case IR_RESULT_OR_FALLBACK:
+    fprintf(out, "%s(ctx, &t[%d], ", ins->op==IR_RESULT_UNWRAP ? "rt_result_unwrap" : "rt_result_or_fallback", g->slot[d]);
+    emit_val(out, g, ins->arg1); fputs(", ", out); emit_ptr(out, g, ins->arg2); fputs(");\n", out);
+    return 1;
+  case IR_RESULT_IS_OK:
+    if (is_typed(g->kind[d])) fprintf(out, "i%d = rt_result_is_ok(", d); else { emit_set_dyn(out, g, d); fputs("v_int(rt_result_is_ok(", out); }
+    emit_val(out, g, ins->arg1); fputs(is_typed(g->kind[d]) ? ");\n" : "));\n", out);
+    return 1;
+  case IR_RESULT_UNWRAP_ERR: fprintf(out, "rt_result_unwrap_err(ctx, &t[%d], ", g->slot[d]); emit_val(out, g, ins->arg1); fputs(");\n", out); return 1;
+  case IR_MAKE_RESULT_OK: case IR_MAKE_RESULT_ERR:
+    fprintf(out, "rt_make_result(ctx, &t[%d], ", g->slot[d]); emit_val(out, g, ins->arg1); fprintf(out, ", %d);\n", ins->op==IR_MAKE_RESULT_OK);
+    return 1;
+  case IR_CONCAT: fprintf(out, "rt_concat(ctx, &t[%d], ", g->slot[d]); emit_val(out, g, ins->arg1); fputs(", ", out); emit_val(out, g, ins->arg2); fputs(");\n", out); return 1;
+  case IR_CALL: {
+    long k = find_func_index(g->prog, ins->s);
+    if (k<0) { emit_set_dyn(out, g, d); fputs("v_int(0);\n", out); return 1; }
+    const IrFunc *cf = &g->prog->funcs.items[k];
+    fputs("{ Value rv=v_int(0); Env callee={0}; callee.parent=env;\n", out);
+    int args[2] = {ins->arg1, ins->arg2};
+    for (int p=0;p<2 && p<cf->param_count;++p) {
+      if (args[p]<0) continue;
+      fputs("    env_set(ctx, &callee, ", out); emit_cstr(out, cf->params[p]); fputs(", ", out); emit_val(out, g, args[p]); fputs(");\n", out);
+    }
+    fprintf(out, "    f%ld(ctx, &callee, &rv); env_free(ctx, &callee);\n", k);
+    fprintf(out, "    v_free(ctx, t[%d]); t[%d]=v_copy(ctx, rv); v_free(ctx, rv); }\n", g->slot[d], g->slot[d]);
+    return 1; }
+  case IR_INDEX:
+    fprintf(out, "rt_index(ctx, env, &t[%d], ", g->slot[d]);
+    if (ins->s) emit_cstr(out, ins->s); else fputs("NULL", out);
+    fputs(", ", out); emit_val(out, g, ins->arg2); fputs(");\n", out);
+    return 1;
+  // Superinstructions are formed right before interpretation, never here
+  case IR_ARITH_CONST: case IR_INC_VAR: case IR_ADD_STORE: case IR_CMP_BRANCH: case IR_CMP_CONST_BRANCH:
+    break;
+  }
+  const char *fmt = "function %s: opcode %d has no C translation";
+  size_t len = strlen(fmt)+strlen(g->f->name)+16;
+  *errmsg = malloc(len); snprintf(*errmsg, len, fmt, g->f->name, (int)ins->op);
+  return 0;
+}
+
+static int emit_func(FILE *out, const IrProgram *prog, size_t fi, char **errmsg){
+  FuncGen g = {0};
+  g.prog = prog; g.f = &prog->funcs.items[fi];
+  analyze(&g);
+  // Body first: it discovers the variables that get slot caches
+  char *body=NULL; size_t body_len=0;
+  FILE *b = open_memstream(&body, &body_len);
+  int ok = 1;
+  for (size_t i=0;i<g.f->instrs.len && ok;++i) ok = emit_instr(b, &g, i, errmsg);
+  fclose(b);
+  if (ok) {
+    fprintf(out, "// func %s\nstatic int f%zu(LiminalContext *ctx, Env *env, Value *ret_out){\n", g.f->name, fi);
+    if (g.nslots) fprintf(out, "  Value t[%d]; for (int k=0;k<%d;k++) t[k]=v_int(0);\n", g.nslots, g.nslots);
+    fputs("  int had_ret=0; Value retval=v_int(0);\n", out);
+    for (size_t v=0;v<g.nvars;++v) { fprintf(out, "  long s%zu=-1; // ", v); fputs(g.vars[v], out); fputc('\n', out); }
+    for (int t=0;t<g.ntemps;++t) {
+      if (is_typed(g.kind[t])) fprintf(out, "  int i%d=0;\n", t);
+      else if (g.kind[t]==TEMP_BORROW) fprintf(out, "  Value b%d={0};\n", t);
+    }
+    fwrite(body, 1, body_len, out);
+    if (g.has_ret) fputs("done:\n", out);
+    fputs("  rt_finish(ctx, env, ret_out, retval, had_ret);\n", out);
+    if (g.nslots) fprintf(out, "  for (int k=0;k<%d;k++) v_free(ctx, t[k]);\n", g.nslots);
+    fputs("  return 0;\n}\n\n", out);
+  }
+  free(body); free(g.kind); free(g.slot); free(g.target); free(g.vars);
+  return ok;
+}
+
+char *aot_emit_c(const IrProgram *prog, const char *source_name, char **errmsg){
+  if (!prog || prog->funcs.len==0) { if (errmsg) *errmsg = strdup("empty program"); return NULL; }
+  char *src=NULL; size_t len=0;
+  FILE *out = open_memstream(&src, &len);
+  fprintf(out, "// Generated by liminal %s from %s; do not edit.\n", LIMINAL_VERSION, source_name ? source_name : "<input>");
+  fputs("#include <math.h>\n#include \"liminal/value.h\"\n\n", out);
+  for (size_t fi=0;fi<prog->funcs.len;++fi) fprintf(out, "static int f%zu(LiminalContext *ctx, Env *env, Value *ret_out);\n", fi);
+  fputc('\n', out);
+  char *err=NULL;
+  for (size_t fi=0;fi<prog->funcs.len;++fi) if (!emit_func(out, prog, fi, &err)) break;
+  fputs("int main(void){\n"
+        "  LiminalContext ctx; liminal_context_init(&ctx);\n"
+        "  Env env={0};\n"
+        "  int rc = f0(&ctx, &env, NULL);\n"
+        "  env_free(&ctx, &env);\n"
+        "  liminal_context_free(&ctx);\n"
+        "  return rc;\n"
+        "}\n", out);
+  fclose(out);
+  if (err) { free(src); if (errmsg) *errmsg = err; else free(err); return NULL; }
+  return src;
+}
+
+// Appends s to buf single-quoted for /bin/sh
+static void sh_quote(FILE *buf, const char *s){
+  fputc('\'', buf);
+  for (; *s; ++s) { if (*s=='\'') fputs("'\\''", buf); else fputc(*s, buf); }
+  fputc('\'', buf);
+}
+
+static const char *env_or(const char *name, const char *dflt){ const char *v = getenv(name); return v && *v ? v : dflt; }
+
+int aot_build_executable(const char *c_src, const char *out_path, char **errmsg){
+  const char *tmpdir = env_or("TMPDIR", "/tmp");
+  size_t plen = strlen(tmpdir)+32;
+  char *tmp = malloc(plen); snprintf(tmp, plen, "%s/liminal_aot_XXXXXX", tmpdir);
+  int fd = mkstemp(tmp);
+  if (fd<0) { if (errmsg) *errmsg = strdup("cannot create temporary C file"); free(tmp); return 1; }
+  size_t len = strlen(c_src);
+  int wrote = write(fd, c_src, len) == (ssize_t)len;
+  close(fd);
+  if (!wrote) { unlink(tmp); free(tmp); if (errmsg) *errmsg = strdup("cannot write temporary C file"); return 1; }
+
+  char *cmd=NULL; size_t cmd_len=0;
+  FILE *c = open_memstream(&cmd, &cmd_len);
+  fprintf(c, "%s -std=c11 %s %s -I", env_or("LIMINAL_CC", LIMINAL_AOT_CC), env_or("LIMINAL_CFLAGS", "-O2"), LIMINAL_AOT_FLAGS);
+  sh_quote(c, env_or("LIMINAL_INCLUDE_DIR", LIMINAL_RT_INCLUDE_DIR));
+  fputs(" -x c ", c); sh_quote(c, tmp);
+  fputs(" -x none ", c); sh_quote(c, env_or("LIMINAL_RT_LIBRARY", LIMINAL_RT_LIBRARY));
+  fputs(" -o ", c); sh_quote(c, out_path);
+  fclose(c);
+  int status = system(cmd);
+  unlink(tmp); free(tmp);
+  int rc = 0;
+  if (status==-1 || !WIFEXITED(status) || WEXITSTATUS(status)!=0) {
+    if (errmsg) { size_t n = cmd_len+64; *errmsg = malloc(n); snprintf(*errmsg, n, "C compiler failed: %s", cmd); }
+    rc = 1;
+  }
+  free(cmd);
+  return rc;
+}
+
+int liminal_compile_file(const char *in_path, const char *out_path, int emit_c, const char *profile_in){
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  ctx.pgo_in = profile_in;
+  IrProgram *ir = liminal_load_program(&ctx, in_path);
+  liminal_context_free(&ctx);
+  if (!ir) return 1;
+  char *errmsg=NULL;
+  char *c_src = aot_emit_c(ir, in_path, &errmsg);
+  ir_program_free(ir);
+  if (!c_src) { fprintf(stderr, "%s: %s\n", in_path, errmsg ? errmsg : "compilation failed"); free(errmsg); return 1; }
+  int rc = 0;
+  if (emit_c) {
+    FILE *f = fopen(out_path, "wb");
+    if (!f || fputs(c_src, f)==EOF) { fprintf(stderr, "Unable to write %s\n", out_path); rc = 1; }
+    if (f && fclose(f)!=0) rc = 1;
+  } else if (aot_build_executable(c_src, out_path, &errmsg)!=0) {
+    fprintf(stderr, "%s: %s\n", in_path, errmsg ? errmsg : "build failed");
+    rc = 1;
+  }
+  free(errmsg); free(c_src);
+  return rc;
+}
@@ -1,12 +1,13 @@
 #define _POSIX_C_SOURCE 200809L
 #include "liminal/ast.h"
+#include "liminal/alloc.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 static void *xmalloc(size_t n) {
-  void *p = malloc(n);
+  void *p = lm_malloc(n);
   if (!p) { fprintf(stderr, "Out of memory\n"); exit(1); }
   memset(p, 0, n);
   return p;
@@ -213,7 +214,7 @@ static ASTType *type_clone(const ASTType *t) {
     c->as.constrained_type.has_min = t->as.constrained_type.has_min;
     c->as.constrained_type.has_max = t->as.constrained_type.has_max;
     c->as.constrained_type.length_constraint = t->as.constrained_type.length_constraint;
-    c->as.constrained_type.pattern = t->as.constrained_type.pattern ? strdup(t->as.constrained_type.pattern) : NULL;
+    c->as.constrained_type.pattern = t->as.constrained_type.pattern ? lm_strdup(t->as.constrained_type.pattern) : NULL;
     break;
   case TYPE_SCHEMA:
     c->as.schema_type.name = string_clone(t->as.schema_type.name);
@@ -233,7 +234,7 @@ static ASTType *type_clone(const ASTType *t) {
 void ast_node_vec_push(ASTNodeVec *vec, ASTNode *node) {
   if (vec->len == vec->cap) {
     vec->cap = vec->cap ? vec->cap * 2 : 4;
-    vec->items = (ASTNode **)realloc(vec->items, vec->cap * sizeof(ASTNode *));
+    vec->items = (ASTNode **)lm_realloc(vec->items, vec->cap * sizeof(ASTNode *));
   }
   vec->items[vec->len++] = node;
 }
@@ -241,7 +242,7 @@ void ast_node_vec_push(ASTNodeVec *vec, ASTNode *node) {
 void ast_expr_vec_push(ASTExprVec *vec, ASTExpr *expr) {
   if (vec->len == vec->cap) {
     vec->cap = vec->cap ? vec->cap * 2 : 4;
-    vec->items = (ASTExpr **)realloc(vec->items, vec->cap * sizeof(ASTExpr *));
+    vec->items = (ASTExpr **)lm_realloc(vec->items, vec->cap * sizeof(ASTExpr *));
   }
   vec->items[vec->len++] = expr;
 }
@@ -249,7 +250,7 @@ void ast_expr_vec_push(ASTExprVec *vec, ASTExpr *expr) {
 void ast_stmt_vec_push(ASTStmtVec *vec, ASTStmt *stmt) {
   if (vec->len == vec->cap) {
     vec->cap = vec->cap ? vec->cap * 2 : 4;
-    vec->items = (ASTStmt **)realloc(vec->items, vec->cap * sizeof(ASTStmt *));
+    vec->items = (ASTStmt **)lm_realloc(vec->items, vec->cap * sizeof(ASTStmt *));
   }
   vec->items[vec->len++] = stmt;
 }
@@ -257,7 +258,7 @@ void ast_stmt_vec_push(ASTStmtVec *vec, ASTStmt *stmt) {
 void ast_type_vec_push(ASTTypeVec *vec, ASTType *type) {
   if (vec->len == vec->cap) {
     vec->cap = vec->cap ? vec->cap * 2 : 4;
-    vec->items = (ASTType **)realloc(vec->items, vec->cap * sizeof(ASTType *));
+    vec->items = (ASTType **)lm_realloc(vec->items, vec->cap * sizeof(ASTType *));
   }
   vec->items[vec->len++] = type;
 }
@@ -265,7 +266,7 @@ void ast_type_vec_push(ASTTypeVec *vec, ASTType *type) {
 void ast_field_vec_push(ASTFieldVec *vec, ASTField field) {
   if (vec->len == vec->cap) {
     vec->cap = vec->cap ? vec->cap * 2 : 4;
-    vec->items = (ASTField *)realloc(vec->items, vec->cap * sizeof(ASTField));
+    vec->items = (ASTField *)lm_realloc(vec->items, vec->cap * sizeof(ASTField));
   }
   vec->items[vec->len++] = field;
 }
@@ -273,7 +274,7 @@ void ast_field_vec_push(ASTFieldVec *vec, ASTField field) {
 void ast_param_vec_push(ASTParamVec *vec, ASTParam param) {
   if (vec->len == vec->cap) {
     vec->cap = vec->cap ? vec->cap * 2 : 4;
-    vec->items = (ASTParam *)realloc(vec->items, vec->cap * sizeof(ASTParam));
+    vec->items = (ASTParam *)lm_realloc(vec->items, vec->cap * sizeof(ASTParam));
   }
   vec->items[vec->len++] = param;
 }
@@ -281,7 +282,7 @@ void ast_param_vec_push(ASTParamVec *vec, ASTParam param) {
 void ast_var_decl_vec_push(ASTVarDeclVec *vec, ASTVarDecl decl) {
   if (vec->len == vec->cap) {
     vec->cap = vec->cap ? vec->cap * 2 : 4;
-    vec->items = (ASTVarDecl *)realloc(vec->items, vec->cap * sizeof(ASTVarDecl));
+    vec->items = (ASTVarDecl *)lm_realloc(vec->items, vec->cap * sizeof(ASTVarDecl));
   }
   vec->items[vec->len++] = decl;
 }
@@ -289,14 +290,14 @@ void ast_var_decl_vec_push(ASTVarDeclVec *vec, ASTVarDecl decl) {
 void ast_field_decl_vec_push(ASTFieldDeclVec *vec, ASTFieldDecl decl) {
   if (vec->len == vec->cap) {
     vec->cap = vec->cap ? vec->cap * 2 : 4;
-    vec->items = (ASTFieldDecl *)realloc(vec->items, vec->cap * sizeof(ASTFieldDecl));
+    vec->items = (ASTFieldDecl *)lm_realloc(vec->items, vec->cap * sizeof(ASTFieldDecl));
   }
   vec->items[vec->len++] = decl;
 }
 void ast_enum_vec_push(ASTEnumType *vec, String item) {
   if (vec->len == vec->cap) {
     vec->cap = vec->cap ? vec->cap * 2 : 4;
-    vec->items = realloc(vec->items, vec->cap * sizeof(String));
+    vec->items = lm_realloc(vec->items, vec->cap * sizeof(String));
   }
   vec->items[vec->len++] = item;
 }
@@ -308,7 +309,7 @@ ASTStmt *ast_make_block(ASTStmtVec *stmts, LiminalSpan span) {
   return s;
 }
 
-static void free_string(String *s) { if (s && s->data) free(s->data); }
+static void free_string(String *s) { if (s && s->data) lm_free(s->data); }
 
 static void free_expr(ASTExpr *e);
 static void free_type(ASTType *t);
@@ -335,12 +336,12 @@ static void free_expr(ASTExpr *e) {
   case EXPR_CALL:
     free_expr(e->as.call.callee);
     for (size_t i = 0; i < e->as.call.args.len; ++i) free_expr(e->as.call.args.items[i]);
-    free(e->as.call.args.items);
+    lm_free(e->as.call.args.items);
     break;
   case EXPR_INDEX:
     free_expr(e->as.index.base);
     for (size_t i = 0; i < e->as.index.indices.len; ++i) free_expr(e->as.index.indices.items[i]);
-    free(e->as.index.indices.items);
+    lm_free(e->as.index.indices.items);
     break;
   case EXPR_SLICE:
     free_expr(e->as.slice.base);
@@ -354,14 +355,14 @@ static void free_expr(ASTExpr *e) {
   case EXPR_TUPLE:
   case EXPR_ARRAY:
     for (size_t i = 0; i < e->as.tuple.elements.len; ++i) free_expr(e->as.tuple.elements.items[i]);
-    free(e->as.tuple.elements.items);
+    lm_free(e->as.tuple.elements.items);
     break;
   case EXPR_RECORD:
     for (size_t i = 0; i < e->as.record.fields.len; ++i) {
       free_string(&e->as.record.fields.items[i].key);
       free_expr(e->as.record.fields.items[i].value);
     }
-    free(e->as.record.fields.items);
+    lm_free(e->as.record.fields.items);
     break;
   case EXPR_ASK:
     free_expr(e->as.ask.oracle);
@@ -388,10 +389,10 @@ static void free_expr(ASTExpr *e) {
   case EXPR_CONTEXT:
     free_expr(e->as.context.ctx);
     for (size_t i = 0; i < e->as.context.methods.len; ++i) free_expr(e->as.context.methods.items[i]);
-    free(e->as.context.methods.items);
+    lm_free(e->as.context.methods.items);
     break;
   }
-  free(e);
+  lm_free(e);
 }
 
 static void free_type(ASTType *t) {
@@ -406,23 +407,23 @@ static void free_type(ASTType *t) {
   case TYPE_ARRAY:
     free_type(t->as.array_type.elem);
     for (size_t i = 0; i < t->as.array_type.dims.len; ++i) free_expr(t->as.array_type.dims.items[i]);
-    free(t->as.array_type.dims.items);
+    lm_free(t->as.array_type.dims.items);
     free_expr(t->as.array_type.len_constraint);
     break;
   case TYPE_TUPLE:
     for (size_t i = 0; i < t->as.tuple_type.elements.len; ++i) free_type(t->as.tuple_type.elements.items[i]);
-    free(t->as.tuple_type.elements.items);
+    lm_free(t->as.tuple_type.elements.items);
     break;
   case TYPE_RECORD:
     for (size_t i = 0; i < t->as.record_type.fields.len; ++i) {
       free_string(&t->as.record_type.fields.items[i].name);
       free_type(t->as.record_type.fields.items[i].type);
     }
-    free(t->as.record_type.fields.items);
+    lm_free(t->as.record_type.fields.items);
     break;
   case TYPE_ENUM:
     for (size_t i = 0; i < t->as.enum_type.len; ++i) free_string(&t->as.enum_type.items[i]);
-    free(t->as.enum_type.items);
+    lm_free(t->as.enum_type.items);
     break;
   case TYPE_OPTIONAL:
     free_type(t->as.optional_type.option);
@@ -433,7 +434,7 @@ static void free_type(ASTType *t) {
     break;
   case TYPE_CONSTRAINED:
     free_string(&t->as.constrained_type.base);
-    free(t->as.constrained_type.pattern);
+    lm_free(t->as.constrained_type.pattern);
     break;
   case TYPE_SCHEMA:
     free_string(&t->as.schema_type.name);
@@ -442,10 +443,10 @@ static void free_type(ASTType *t) {
       free_type(t->as.schema_type.fields.items[i].type);
       free_string(&t->as.schema_type.fields.items[i].describe);
     }
-    free(t->as.schema_type.fields.items);
+    lm_free(t->as.schema_type.fields.items);
     break;
   }
-  free(t);
+  lm_free(t);
 }
 
 static void free_stmt(ASTStmt *s) {
@@ -475,6 +476,12 @@ static void free_stmt(ASTStmt *s) {
     free_stmt(s->as.for_in_stmt.body);
     free_string(&s->as.for_in_stmt.var.name);
     break;
+  case STMT_STREAM:
+    free_expr(s->as.stream_stmt.prompt);
+    free_stmt(s->as.stream_stmt.body);
+    free_string(&s->as.stream_stmt.oracle.name);
+    free_string(&s->as.stream_stmt.chunk.name);
+    break;
   case STMT_REPEAT:
     free_stmt(s->as.repeat_stmt.body);
     free_expr(s->as.repeat_stmt.cond);
@@ -483,17 +490,17 @@ static void free_stmt(ASTStmt *s) {
     free_expr(s->as.case_stmt.expr);
     for (size_t i = 0; i < s->as.case_stmt.patterns.len; ++i) free_expr(s->as.case_stmt.patterns.items[i]);
     for (size_t i = 0; i < s->as.case_stmt.branches.len; ++i) free_stmt(s->as.case_stmt.branches.items[i]);
-    free(s->as.case_stmt.patterns.items);
-    free(s->as.case_stmt.branches.items);
+    lm_free(s->as.case_stmt.patterns.items);
+    lm_free(s->as.case_stmt.branches.items);
     free_stmt(s->as.case_stmt.else_branch);
     break;
   case STMT_LOOP:
     for (size_t i = 0; i < s->as.loop_stmt.body.len; ++i) free_stmt(s->as.loop_stmt.body.items[i]);
-    free(s->as.loop_stmt.body.items);
+    lm_free(s->as.loop_stmt.body.items);
     break;
   case STMT_PARALLEL:
     for (size_t i = 0; i < s->as.parallel_stmt.body.len; ++i) free_stmt(s->as.parallel_stmt.body.items[i]);
-    free(s->as.parallel_stmt.body.items);
+    lm_free(s->as.parallel_stmt.body.items);
     break;
   case STMT_BREAK:
   case STMT_CONTINUE:
@@ -507,13 +514,13 @@ static void free_stmt(ASTStmt *s) {
     break;
   case STMT_BLOCK:
     for (size_t i = 0; i < s->as.block.stmts.len; ++i) free_stmt(s->as.block.stmts.items[i]);
-    free(s->as.block.stmts.items);
+    lm_free(s->as.block.stmts.items);
     break;
   case STMT_EXPR:
     free_expr(s->as.expr_stmt.expr);
     break;
   }
-  free(s);
+  lm_free(s);
 }
 
 static void free_node(ASTNode *n) {
@@ -527,12 +534,12 @@ static void free_node(ASTNode *n) {
     for (size_t i = 0; i < n->as.program.oracles.len; ++i) free_node(n->as.program.oracles.items[i]);
     for (size_t i = 0; i < n->as.program.vars.len; ++i) free_node(n->as.program.vars.items[i]);
     for (size_t i = 0; i < n->as.program.functions.len; ++i) free_node(n->as.program.functions.items[i]);
-    free(n->as.program.uses.items);
-    free(n->as.program.config_items.items);
-    free(n->as.program.types.items);
-    free(n->as.program.oracles.items);
-    free(n->as.program.vars.items);
-    free(n->as.program.functions.items);
+    lm_free(n->as.program.uses.items);
+    lm_free(n->as.program.config_items.items);
+    lm_free(n->as.program.types.items);
+    lm_free(n->as.program.oracles.items);
+    lm_free(n->as.program.vars.items);
+    lm_free(n->as.program.functions.items);
     free_stmt(n->as.program.body);
     break;
   case AST_CONFIG_ITEM:
@@ -560,7 +567,7 @@ static void free_node(ASTNode *n) {
       free_string(&n->as.func_decl.params.items[i].name);
       free_type(n->as.func_decl.params.items[i].type);
     }
-    free(n->as.func_decl.params.items);
+    lm_free(n->as.func_decl.params.items);
     free_type(n->as.func_decl.result_type);
     if (n->as.func_decl.locals) {
       for (size_t i = 0; i < n->as.func_decl.locals->vars.len; ++i) {
@@ -568,15 +575,15 @@ static void free_node(ASTNode *n) {
         free_type(n->as.func_decl.locals->vars.items[i].type);
         free_expr(n->as.func_decl.locals->vars.items[i].init);
       }
-      free(n->as.func_decl.locals->vars.items);
-      free(n->as.func_decl.locals);
+      lm_free(n->as.func_decl.locals->vars.items);
+      lm_free(n->as.func_decl.locals);
     }
     free_stmt(n->as.func_decl.body);
     break;
   default:
     break;
   }
-  free(n);
+  lm_free(n);
 }
 
 void ast_free(ASTNode *node) { free_node(node); }
@@ -763,6 +770,11 @@ static void print_stmt(const ASTStmt *s, FILE *out, int level) {
     print_expr(s->as.for_in_stmt.iterable, out, level + 1);
     print_stmt(s->as.for_in_stmt.body, out, level + 1);
     break;
+  case STMT_STREAM:
+    fputs("Stream\n", out);
+    print_expr(s->as.stream_stmt.prompt, out, level + 1);
+    print_stmt(s->as.stream_stmt.body, out, level + 1);
+    break;
   case STMT_REPEAT:
     fputs("Repeat\n", out);
     print_stmt(s->as.repeat_stmt.body, out, level + 1);
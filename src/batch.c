@@ -0,0 +1,233 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/batch.h"
+#include "liminal/exec.h"
+#include "liminal/json.h"
+#include "liminal/oracles.h"
+#include "liminal/peephole.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A number, boolean or null at *pp: 1 with *v set (null: v->kind is
+// VOPTIONAL), 0 if there is none
+static int json_scalar(const char **pp, Value *v){
+  const char *p = *pp;
+  if (strncmp(p, "true", 4) == 0) { *v = v_bool(1); *pp = p + 4; return 1; }
+  if (strncmp(p, "false", 5) == 0) { *v = v_bool(0); *pp = p + 5; return 1; }
+  if (strncmp(p, "null", 4) == 0) { *v = v_optional_none(); *pp = p + 4; return 1; }
+  char *end;
+  errno = 0;
+  double d = strtod(p, &end);
+  if (end == p || errno) return 0;
+  int integral = 1;
+  for (const char *q = p; q < end; q++) if (*q == '.' || *q == 'e' || *q == 'E') integral = 0;
+  *v = integral && d >= INT32_MIN && d <= INT32_MAX ? v_int((int)d) : v_real(d);
+  *pp = end;
+  return 1;
+}
+
+static char *line_error(const char *path, size_t line, const char *what){
+  size_t n = strlen(path) + strlen(what) + 32;
+  char *msg = malloc(n);
+  snprintf(msg, n, "%s:%zu: %s", path, line, what);
+  return msg;
+}
+
+// One record from a line; NULL on success, else what is wrong with it
+static const char *parse_record(LiminalContext *ctx, const char *p, size_t line, BatchRecord *r){
+  p = json_skip_ws(p);
+  if (*p == '"') {
+    r->stdin_text = json_parse_string(&p);
+    if (!r->stdin_text) return "malformed string";
+  } else if (*p == '{') {
+    p = json_skip_ws(p + 1);
+    while (*p != '}') {
+      if (*p != '"') return "expected a field name";
+      char *key = json_parse_string(&p);
+      if (!key) return "malformed field name";
+      p = json_skip_ws(p);
+      if (*p != ':') { free(key); return "expected ':'"; }
+      p = json_skip_ws(p + 1);
+      const char *start = p;
+      Value v;
+      if (*p == '"') {
+        char *s = json_parse_string(&p);
+        if (!s) { free(key); return "malformed string"; }
+        v = v_string(ctx, s);
+        if (strcmp(key, "stdin") == 0) { free(r->stdin_text); r->stdin_text = s; }
+        else free(s);
+      } else if (!json_scalar(&p, &v)) {
+        free(key);
+        return *p == '{' || *p == '[' ? "only strings, numbers, booleans and null are supported" : "expected a value";
+      }
+      if (strcmp(key, "id") == 0) { free(r->id); r->id = strndup(start, (size_t)(p - start)); }
+      else if (strcmp(key, "stdin") != 0 && v.kind != VOPTIONAL) env_set(ctx, &r->vars, key, v);
+      v_free(ctx, v);
+      free(key);
+      p = json_skip_ws(p);
+      if (*p == ',') p = json_skip_ws(p + 1);
+      else if (*p != '}') return "expected ',' or '}'";
+    }
+    p++;
+  } else {
+    return "expected an object or a string";
+  }
+  if (*json_skip_ws(p)) return "trailing characters after the record";
+  if (!r->stdin_text) r->stdin_text = strdup("");
+  if (!r->id) {
+    char num[32];
+    snprintf(num, sizeof(num), "%zu", line);
+    r->id = strdup(num);
+  }
+  return NULL;
+}
+
+BatchRecord *batch_read_records(LiminalContext *ctx, const char *path, size_t *n, char **errmsg){
+  *n = 0;
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    size_t len = strlen(path) + strlen(strerror(errno)) + 8;
+    *errmsg = malloc(len);
+    snprintf(*errmsg, len, "%s: %s", path, strerror(errno));
+    return NULL;
+  }
+  BatchRecord *rs = NULL;
+  size_t cap = 0, lineno = 0;
+  char *line = NULL;
+  size_t linecap = 0;
+  while (getline(&line, &linecap, f) >= 0) {
+    lineno++;
+    if (!*json_skip_ws(line)) continue;
+    if (*n == cap) { cap = cap ? cap * 2 : 64; rs = realloc(rs, cap * sizeof(BatchRecord)); }
+    BatchRecord *r = &rs[*n];
+    memset(r, 0, sizeof(*r));
+    (*n)++;
+    const char *bad = parse_record(ctx, line, lineno, r);
+    if (bad) {
+      *errmsg = line_error(path, lineno, bad);
+      free(line);
+      fclose(f);
+      batch_records_free(ctx, rs, *n);
+      *n = 0;
+      return NULL;
+    }
+  }
+  free(line);
+  fclose(f);
+  if (!rs) rs = calloc(1, sizeof(BatchRecord));
+  return rs;
+}
+
+void batch_records_free(LiminalContext *ctx, BatchRecord *rs, size_t n){
+  if (!rs) return;
+  for (size_t i = 0; i < n; i++) {
+    free(rs[i].id);
+    free(rs[i].stdin_text);
+    env_free(ctx, &rs[i].vars);
+  }
+  free(rs);
+}
+
+typedef struct {
+  LiminalContext *ctx;    // where the outputs go
+  const BatchOptions *opt;
+  BatchRecord *records;
+  LiminalContext *runs;   // one per record
+  char *done;             // finished, output not yet written (input order)
+  size_t next;            // first record whose output is not written
+} Batch;
+
+static void release_output(LiminalContext *run){
+  free(run->outbuf);
+  run->outbuf = NULL;
+  run->outbuf_len = run->outbuf_cap = 0;
+}
+
+// Writes what has become writable: the record's own line in completion
+// order, else every finished record up to the first still running
+static void record_done(void *user, size_t index, int rc){
+  (void)rc;
+  Batch *b = (Batch *)user;
+  FILE *out = b->ctx->out;
+  if (b->opt->completion_order) {
+    LiminalContext *run = &b->runs[index];
+    fprintf(out, "{\"id\":%s,\"output\":\"", b->records[index].id);
+    json_escape(out, run->outbuf ? run->outbuf : "", run->outbuf_len);
+    fputs("\"}\n", out);
+    fflush(out);
+    release_output(run);
+    return;
+  }
+  b->done[index] = 1;
+  while (b->done[b->next]) {
+    LiminalContext *run = &b->runs[b->next];
+    if (run->outbuf_len) fwrite(run->outbuf, 1, run->outbuf_len, out);
+    release_output(run);
+    b->done[b->next++] = 0;
+  }
+  fflush(out);
+}
+
+// What a record's run takes from the batch's context
+static void run_context(LiminalContext *run, const LiminalContext *ctx, BatchRecord *r){
+  memset(run, 0, sizeof(*run));
+  run->debug_exec = ctx->debug_exec;
+  run->debug_ir = ctx->debug_ir;
+  run->debug_ir_log = ctx->debug_ir_log;
+  run->debug_ir_call = ctx->debug_ir_call;
+  run->debug_tc = ctx->debug_tc;
+  run->debug_parser = ctx->debug_parser;
+  run->quicken = ctx->quicken;
+  run->parallel_workers = ctx->parallel_workers;
+  run->oracle = ctx->oracle;
+  run->bindings = &r->vars;
+  run->in = fmemopen(r->stdin_text, strlen(r->stdin_text), "r");
+}
+
+int liminal_run_batch(LiminalContext *ctx, const char *path, const char *inputs, const BatchOptions *opt){
+  char *errmsg = NULL;
+  size_t n = 0;
+  BatchRecord *records = batch_read_records(ctx, inputs, &n, &errmsg);
+  if (!records) {
+    fprintf(stderr, "Unable to read records: %s\n", errmsg ? errmsg : "");
+    free(errmsg);
+    return 1;
+  }
+  IrProgram *ir = liminal_load_program(ctx, path);
+  if (!ir) { batch_records_free(ctx, records, n); return 1; }
+  if (ctx->fuse) ir_fuse_superinstructions(ir);
+  if (!ctx->oracle) liminal_context_set_oracle(ctx, oracle_from_env(), 1);
+  if (ctx->owns_oracle) {
+    Oracle *inner = ctx->oracle;
+    ctx->owns_oracle = 0;
+    liminal_context_set_oracle(ctx, oracle_with_cache(inner), 1);
+  }
+  Batch b = { ctx, opt, records, calloc(n ? n : 1, sizeof(LiminalContext)), calloc(n + 1, 1), 0 };
+  LiminalContext **runs = calloc(n ? n : 1, sizeof(LiminalContext *));
+  for (size_t i = 0; i < n; i++) {
+    run_context(&b.runs[i], ctx, &records[i]);
+    runs[i] = &b.runs[i];
+  }
+  int rc = ir_execute_many(ir, runs, n, opt->jobs, record_done, &b);
+  for (size_t i = 0; i < n; i++) {
+    fclose(b.runs[i].in);
+    ctx->allocs += b.runs[i].allocs;
+    ctx->frees += b.runs[i].frees;
+    b.runs[i].oracle = NULL;
+    liminal_context_free(&b.runs[i]);
+  }
+  if (ctx->debug_exec) {
+    size_t hits = 0, misses = 0;
+    oracle_cache_stats(ctx->oracle, &hits, &misses);
+    fprintf(stderr, "[exec] batch records=%zu cache hits=%zu misses=%zu\n", n, hits, misses);
+  }
+  free(runs);
+  free(b.runs);
+  free(b.done);
+  ir_program_free(ir);
+  batch_records_free(ctx, records, n);
+  return rc;
+}
@@ -0,0 +1,229 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/bench.h"
+#include "liminal/alloc.h"
+#include "liminal/exec.h"
+#include "liminal/json.h"
+#include "liminal/peephole.h"
+#include "liminal/profiler.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int by_ns(const void *a, const void *b){
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+// Nearest rank: the smallest timing with at least pct% of them at or below
+static uint64_t percentile(const uint64_t *sorted, size_t n, size_t pct){
+  size_t rank = (pct * n + 99) / 100;
+  return sorted[rank ? rank - 1 : 0];
+}
+
+void bench_summarize(uint64_t *ns, size_t n, BenchResult *r){
+  r->iterations = n;
+  if (!n) return;
+  qsort(ns, n, sizeof(uint64_t), by_ns);
+  double sum = 0;
+  for (size_t i = 0; i < n; i++) sum += (double)ns[i];
+  r->mean_ns = sum / (double)n;
+  double sq = 0;
+  for (size_t i = 0; i < n; i++) sq += ((double)ns[i] - r->mean_ns) * ((double)ns[i] - r->mean_ns);
+  r->stddev_ns = n > 1 ? sqrt(sq / (double)(n - 1)) : 0;
+  r->min_ns = ns[0];
+  r->p50_ns = percentile(ns, n, 50);
+  r->p90_ns = percentile(ns, n, 90);
+  r->p99_ns = percentile(ns, n, 99);
+  r->max_ns = ns[n - 1];
+}
+
+// dir/prog.lim -> prog
+static char *bench_name(const char *path){
+  const char *base = strrchr(path, '/');
+  base = base ? base + 1 : path;
+  size_t len = strlen(base);
+  if (len > 4 && strcmp(base + len - 4, ".lim") == 0) len -= 4;
+  return strndup(base, len);
+}
+
+// One untimed run with the profiler attached, on the IR the timed runs
+// execute (superinstructions included)
+static uint64_t count_instructions(const char *path, FILE *in, FILE *sink){
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  ctx.in = in;
+  ctx.out = sink;
+  uint64_t n = 0;
+  IrProgram *ir = liminal_load_program(&ctx, path);
+  if (ir) {
+    if (!ctx.oracle) liminal_context_set_oracle(&ctx, oracle_from_env(), 1);
+    if (ctx.fuse) ir_fuse_superinstructions(ir);
+    ctx.profiler = profiler_new(ir);
+    ir_execute(ir, &ctx);
+    for (size_t i = 0; i < ir->funcs.len; i++) n += ctx.profiler->funcs[i].instructions;
+    profiler_free(ctx.profiler);
+    ctx.profiler = NULL;
+    ir_program_free(ir);
+  }
+  liminal_context_free(&ctx);
+  return n;
+}
+
+int bench_run(const char *path, const BenchOptions *opt, BenchResult *r){
+  memset(r, 0, sizeof(*r));
+  r->name = bench_name(path);
+  FILE *in = fopen("/dev/null", "r"), *sink = fopen("/dev/null", "w");
+  if (!in || !sink) { fprintf(stderr, "Unable to open /dev/null\n"); if (in) fclose(in); if (sink) fclose(sink); return 0; }
+  uint64_t *ns = malloc((opt->iterations ? opt->iterations : 1) * sizeof(uint64_t));
+  int ok = 1;
+  for (size_t i = 0; i < opt->warmup + opt->iterations && ok; i++) {
+    LiminalContext ctx;
+    liminal_context_init(&ctx);
+    ctx.in = in;
+    ctx.out = sink;
+    ctx.jit = opt->jit;
+    AllocStats a = alloc_stats();
+    uint64_t t0 = profiler_now_ns();
+    int rc = liminal_run_file_ctx(&ctx, path);
+    uint64_t t = profiler_now_ns() - t0;
+    AllocStats b = alloc_stats();
+    liminal_context_free(&ctx);
+    if (rc != 0) { fprintf(stderr, "%s: run failed\n", path); ok = 0; break; }
+    if (i < opt->warmup) continue;
+    ns[i - opt->warmup] = t;
+    // Every iteration does the same work, so the last one stands for all
+    r->allocs = b.allocs - a.allocs;
+    r->bytes = b.bytes - a.bytes;
+  }
+  if (ok) {
+    bench_summarize(ns, opt->iterations, r);
+    r->instructions = count_instructions(path, in, sink);
+  }
+  free(ns);
+  fclose(in);
+  fclose(sink);
+  return ok;
+}
+
+void bench_result_free(BenchResult *r){
+  if (!r) return;
+  free(r->name);
+  r->name = NULL;
+}
+
+void bench_report(const BenchResult *rs, size_t n, FILE *out){
+  fprintf(out, "%-32s %6s %10s %10s %10s %10s %10s %12s %14s\n",
+          "program", "runs", "mean ms", "stddev", "p50 ms", "p90 ms", "p99 ms", "allocs", "instructions");
+  for (size_t i = 0; i < n; i++) {
+    const BenchResult *r = &rs[i];
+    fprintf(out, "%-32s %6zu %10.3f %10.3f %10.3f %10.3f %10.3f %12llu %14llu\n", r->name, r->iterations,
+            r->mean_ns / 1e6, r->stddev_ns / 1e6, (double)r->p50_ns / 1e6, (double)r->p90_ns / 1e6,
+            (double)r->p99_ns / 1e6, (unsigned long long)r->allocs, (unsigned long long)r->instructions);
+  }
+}
+
+void bench_write_json(const BenchResult *rs, size_t n, const BenchOptions *opt, FILE *out){
+  fprintf(out, "{\"warmup\":%zu,\"iterations\":%zu,\"jit\":%s,\"benchmarks\":[", opt->warmup, opt->iterations,
+          opt->jit ? "true" : "false");
+  for (size_t i = 0; i < n; i++) {
+    const BenchResult *r = &rs[i];
+    fprintf(out, "%s\n{\"name\":\"", i ? "," : "");
+    json_escape(out, r->name, strlen(r->name));
+    fprintf(out, "\",\"iterations\":%zu,\"mean_ns\":%.0f,\"stddev_ns\":%.0f,"
+            "\"min_ns\":%llu,\"p50_ns\":%llu,\"p90_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu,"
+            "\"allocs\":%llu,\"bytes\":%llu,\"instructions\":%llu}",
+            r->iterations, r->mean_ns, r->stddev_ns,
+            (unsigned long long)r->min_ns, (unsigned long long)r->p50_ns, (unsigned long long)r->p90_ns,
+            (unsigned long long)r->p99_ns, (unsigned long long)r->max_ns, (unsigned long long)r->allocs,
+            (unsigned long long)r->bytes, (unsigned long long)r->instructions);
+  }
+  fputs("\n]}\n", out);
+}
+
+static void set_field(BenchResult *r, const char *key, double v){
+  if (strcmp(key, "iterations") == 0) r->iterations = (size_t)v;
+  else if (strcmp(key, "mean_ns") == 0) r->mean_ns = v;
+  else if (strcmp(key, "stddev_ns") == 0) r->stddev_ns = v;
+  else if (strcmp(key, "min_ns") == 0) r->min_ns = (uint64_t)v;
+  else if (strcmp(key, "p50_ns") == 0) r->p50_ns = (uint64_t)v;
+  else if (strcmp(key, "p90_ns") == 0) r->p90_ns = (uint64_t)v;
+  else if (strcmp(key, "p99_ns") == 0) r->p99_ns = (uint64_t)v;
+  else if (strcmp(key, "max_ns") == 0) r->max_ns = (uint64_t)v;
+  else if (strcmp(key, "allocs") == 0) r->allocs = (uint64_t)v;
+  else if (strcmp(key, "bytes") == 0) r->bytes = (uint64_t)v;
+  else if (strcmp(key, "instructions") == 0) r->instructions = (uint64_t)v;
+}
+
+// The program object on a line of bench_write_json's output; 0 if the line
+// holds none (the header and the closing line)
+static int parse_result(const char *p, BenchResult *r){
+  memset(r, 0, sizeof(*r));
+  p = json_skip_ws(p);
+  if (*p != '{') return 0;
+  p = json_skip_ws(p + 1);
+  while (p && *p == '"') {
+    char *key = json_parse_string(&p);
+    if (!key) break;
+    p = json_skip_ws(p);
+    if (*p != ':') { free(key); break; }
+    p = json_skip_ws(p + 1);
+    if (strcmp(key, "name") == 0 && *p == '"') {
+      free(r->name);
+      r->name = json_parse_string(&p);
+    } else {
+      const char *value = p;
+      p = json_skip_value(p);
+      if (p && (*value == '-' || (*value >= '0' && *value <= '9'))) set_field(r, key, strtod(value, NULL));
+    }
+    free(key);
+    if (p) p = json_skip_ws(p);
+    if (p && *p == ',') p = json_skip_ws(p + 1);
+  }
+  return r->name != NULL;
+}
+
+BenchResult *bench_read_json(const char *path, size_t *n){
+  FILE *f = fopen(path, "r");
+  if (!f) return NULL;
+  size_t cap = 8;
+  BenchResult *rs = calloc(cap, sizeof(BenchResult));
+  *n = 0;
+  char *line = NULL;
+  size_t line_cap = 0;
+  while (getline(&line, &line_cap, f) > 0) {
+    if (*n == cap) { cap *= 2; rs = realloc(rs, cap * sizeof(BenchResult)); }
+    if (parse_result(line, &rs[*n])) (*n)++;
+  }
+  free(line);
+  fclose(f);
+  return rs;
+}
+
+static double change_pct(double base, double now){
+  return base > 0 ? (now - base) / base * 100.0 : 0;
+}
+
+size_t bench_compare(const BenchResult *base, size_t nbase, const BenchResult *rs, size_t n,
+                     double threshold_pct, FILE *out){
+  size_t regressions = 0;
+  fprintf(out, "%-32s %10s %10s %8s %12s %12s %8s  %s\n",
+          "program", "base p50", "p50 ms", "change", "base allocs", "allocs", "change", "verdict");
+  for (size_t i = 0; i < n; i++) {
+    const BenchResult *r = &rs[i], *b = NULL;
+    for (size_t j = 0; j < nbase && !b; j++) if (strcmp(base[j].name, r->name) == 0) b = &base[j];
+    if (!b) {
+      fprintf(out, "%-32s %10s %10.3f %8s %12s %12llu %8s  new\n", r->name, "-", (double)r->p50_ns / 1e6, "-", "-",
+              (unsigned long long)r->allocs, "-");
+      continue;
+    }
+    double dt = change_pct((double)b->p50_ns, (double)r->p50_ns);
+    double da = change_pct((double)b->allocs, (double)r->allocs);
+    int regressed = dt > threshold_pct || da > threshold_pct;
+    if (regressed) regressions++;
+    fprintf(out, "%-32s %10.3f %10.3f %+7.1f%% %12llu %12llu %+7.1f%%  %s\n", r->name, (double)b->p50_ns / 1e6,
+            (double)r->p50_ns / 1e6, dt, (unsigned long long)b->allocs, (unsigned long long)r->allocs, da,
+            regressed ? "REGRESSED" : dt < -threshold_pct ? "faster" : "ok");
+  }
+  return regressions;
+}
@@ -0,0 +1,116 @@
+#include "liminal/bench.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char *USAGE =
+    "Usage: liminal_bench [--warmup <n>] [--iterations <n>] [--jit] [--json <out>]\n"
+    "                     [--compare <baseline.json>] [--threshold <pct>] [<file>...]\n"
+    "\n"
+    "Runs each program in-process, <n> untimed warmup runs (default 2) and then\n"
+    "<n> timed ones (default 10), and reports mean, stddev and percentiles of the\n"
+    "run time with allocations and instructions per run. Without files it runs\n"
+    "the Opus benchmarks.\n"
+    "  --json <out>    also write the results as JSON to <out> ('-' for stdout)\n"
+    "  --compare <baseline.json>\n"
+    "                  compare with a saved --json file; exits 1 if a median time\n"
+    "                  or an allocation count grew by more than the threshold\n"
+    "  --threshold <pct>\n"
+    "                  regression threshold in percent (default 5)\n";
+
+static const char *DEFAULT_PROGRAMS[] = {
+  "t29_bench_int_hotloop",
+  "t30_bench_function_calls",
+  "c12_bench_event_aggregation",
+  "c13_bench_rule_routing",
+};
+
+int main(int argc, char **argv) {
+  BenchOptions opt = { 2, 10, 0 };
+  const char *json = NULL;
+  const char *baseline = NULL;
+  double threshold = 5.0;
+  const char **files = malloc(sizeof(char *) * (size_t)(argc > 4 ? argc : 4));
+  char defaults[4][512];
+  size_t nfiles = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+      opt.warmup = (size_t)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      opt.iterations = (size_t)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--jit") == 0) {
+      opt.jit = 1;
+    } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      json = argv[++i];
+    } else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+      baseline = argv[++i];
+    } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+      threshold = strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+      fputs(USAGE, stdout);
+      free(files);
+      return 0;
+    } else if (argv[i][0] != '-') {
+      files[nfiles++] = argv[i];
+    } else {
+      fprintf(stderr, "Unknown option: %s\n%s", argv[i], USAGE);
+      free(files);
+      return 1;
+    }
+  }
+  if (opt.iterations == 0) {
+    fprintf(stderr, "--iterations must be at least 1\n");
+    free(files);
+    return 1;
+  }
+  if (nfiles == 0) {
+    for (size_t i = 0; i < sizeof(DEFAULT_PROGRAMS) / sizeof(*DEFAULT_PROGRAMS); i++) {
+      snprintf(defaults[i], sizeof(defaults[i]), "%s/%s.lim", LIMINAL_BENCH_DIR, DEFAULT_PROGRAMS[i]);
+      files[nfiles++] = defaults[i];
+    }
+  }
+
+  int rc = 0;
+  BenchResult *results = calloc(nfiles, sizeof(BenchResult));
+  size_t done = 0;
+  for (size_t i = 0; i < nfiles; i++) {
+    if (bench_run(files[i], &opt, &results[done])) done++;
+    else { bench_result_free(&results[done]); rc = 1; }
+  }
+
+  // The table goes to stderr when stdout carries the JSON
+  FILE *table = json && strcmp(json, "-") == 0 ? stderr : stdout;
+  bench_report(results, done, table);
+  if (json) {
+    FILE *f = strcmp(json, "-") == 0 ? stdout : fopen(json, "w");
+    if (!f) {
+      fprintf(stderr, "Unable to write %s\n", json);
+      rc = 1;
+    } else {
+      bench_write_json(results, done, &opt, f);
+      if (f != stdout && fclose(f) != 0) { fprintf(stderr, "Unable to write %s\n", json); rc = 1; }
+    }
+  }
+  if (baseline) {
+    size_t nbase = 0;
+    BenchResult *base = bench_read_json(baseline, &nbase);
+    if (!base) {
+      fprintf(stderr, "Unable to read %s\n", baseline);
+      rc = 1;
+    } else {
+      fputc('\n', table);
+      size_t regressions = bench_compare(base, nbase, results, done, threshold, table);
+      if (regressions) {
+        fprintf(stderr, "%zu regression(s) beyond %.1f%%\n", regressions, threshold);
+        rc = 1;
+      }
+      for (size_t i = 0; i < nbase; i++) bench_result_free(&base[i]);
+      free(base);
+    }
+  }
+
+  for (size_t i = 0; i < done; i++) bench_result_free(&results[i]);
+  free(results);
+  free(files);
+  return rc;
+}
@@ -0,0 +1,498 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/bytecode.h"
+#include "liminal/sha256.h"
+#include "liminal/version.h"
+#include "liminal/alloc.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define NO_STR 0xFFFFFFFFu
+#define TYPE_NULL 0xFF
+#define MAX_TYPE_DEPTH 64
+#define BYTE_ORDER_MARK 0x01020304u
+
+static void *xmalloc(size_t n) { void *p = lm_malloc(n); if (!p) { fprintf(stderr,"OOM\n"); exit(1);} memset(p,0,n); return p; }
+
+// ---- Image layout ----
+// Every reference is an offset from the image start (or into the string
+// pool), so the file can be mapped anywhere without relocation. Tables are
+// 8-byte aligned fixed-size records; the pool holds each distinct string
+// once, NUL-terminated, so loaded instructions point straight into it.
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t func_count;
+  uint32_t schema_count;
+  uint64_t func_off;   // ImageFunc[func_count]
+  uint64_t param_off;  // uint32_t pool refs
+  uint64_t instr_off;  // ImageInstr[]
+  uint64_t line_off;   // ImageLine[]
+  uint64_t schema_off; // schema stream
+  uint64_t schema_len;
+  uint64_t pool_off;   // string pool
+  uint64_t pool_len;
+  uint64_t image_len;
+} ImageHeader;
+
+typedef struct {
+  uint32_t name;
+  uint32_t param_count;
+  uint32_t param_start;
+  int32_t next_temp;
+  int32_t next_label;
+  uint32_t instr_count;
+  uint64_t instr_start;
+  uint32_t line_count;
+  uint32_t line_start;
+} ImageFunc;
+
+typedef struct {
+  uint32_t op;
+  int32_t dest;
+  int32_t arg1;
+  int32_t arg2;
+  double f;
+  uint32_t s;
+  uint32_t s2;
+} ImageInstr;
+
+// A line table entry (IrLine)
+typedef struct {
+  uint32_t start;
+  int32_t line;
+  int32_t column;
+  int32_t offset;
+  int32_t length;
+  uint32_t reserved;
+} ImageLine;
+
+_Static_assert(sizeof(ImageHeader) == 96, "ImageHeader must have no padding");
+_Static_assert(sizeof(ImageFunc) == 40, "ImageFunc must have no padding");
+_Static_assert(sizeof(ImageInstr) == 32, "ImageInstr must have no padding");
+_Static_assert(sizeof(ImageLine) == 24, "ImageLine must have no padding");
+
+// ---- Writer ----
+
+typedef struct {
+  unsigned char *data;
+  size_t len;
+  size_t cap;
+} Buf;
+
+static void buf_put(Buf *b, const void *p, size_t n) {
+  if (n == 0) return;
+  if (b->len + n > b->cap) {
+    size_t cap = b->cap ? b->cap : 256;
+    while (cap < b->len + n) cap *= 2;
+    b->data = lm_realloc(b->data, cap);
+    b->cap = cap;
+  }
+  memcpy(b->data + b->len, p, n);
+  b->len += n;
+}
+
+static void buf_align(Buf *b) { static const unsigned char zero[8] = {0}; if (b->len % 8) buf_put(b, zero, 8 - b->len % 8); }
+static void put_u8(Buf *b, uint8_t v) { buf_put(b, &v, 1); }
+static void put_u32(Buf *b, uint32_t v) { buf_put(b, &v, 4); }
+
+// Deduplicating string pool: open addressing over pool offsets
+typedef struct {
+  Buf bytes;
+  uint32_t *slots; // offset + 1, 0 = empty
+  size_t cap;
+  size_t count;
+} Pool;
+
+static uint32_t str_hash(const char *s) { uint32_t h = 2166136261u; for (; *s; ++s) { h ^= (unsigned char)*s; h *= 16777619u; } return h; }
+
+static void pool_grow(Pool *p) {
+  size_t cap = p->cap ? p->cap * 2 : 64;
+  uint32_t *slots = xmalloc(cap * sizeof(uint32_t));
+  for (size_t i = 0; i < p->cap; ++i) {
+    if (!p->slots[i]) continue;
+    size_t j = str_hash((const char *)p->bytes.data + p->slots[i] - 1) & (cap - 1);
+    while (slots[j]) j = (j + 1) & (cap - 1);
+    slots[j] = p->slots[i];
+  }
+  lm_free(p->slots);
+  p->slots = slots;
+  p->cap = cap;
+}
+
+static uint32_t pool_ref(Pool *p, const char *s) {
+  if (!s) return NO_STR;
+  if ((p->count + 1) * 2 > p->cap) pool_grow(p);
+  size_t j = str_hash(s) & (p->cap - 1);
+  while (p->slots[j]) {
+    if (strcmp((const char *)p->bytes.data + p->slots[j] - 1, s) == 0) return p->slots[j] - 1;
+    j = (j + 1) & (p->cap - 1);
+  }
+  uint32_t off = (uint32_t)p->bytes.len;
+  buf_put(&p->bytes, s, strlen(s) + 1);
+  p->slots[j] = off + 1;
+  p->count++;
+  return off;
+}
+
+static int schema_index(const IrProgram *prog, const Type *t) {
+  for (size_t i = 0; i < prog->schemas.len; ++i) if (prog->schemas.items[i] == t) return (int)i;
+  return -1;
+}
+
+static void put_type(Buf *b, Pool *pool, const IrProgram *prog, const Type *t);
+
+static void put_fields(Buf *b, Pool *pool, const IrProgram *prog, const Type *t) {
+  put_u32(b, (uint32_t)t->as.schema.len);
+  for (size_t i = 0; i < t->as.schema.len; ++i) {
+    put_u32(b, pool_ref(pool, t->as.schema.items[i].name));
+    put_type(b, pool, prog, t->as.schema.items[i].type);
+  }
+}
+
+// Schemas declared by the program are written by index so field types that
+// refer to another schema (or to themselves) round-trip to the same pointer.
+static void put_type(Buf *b, Pool *pool, const IrProgram *prog, const Type *t) {
+  if (!t) { put_u8(b, TYPE_NULL); return; }
+  put_u8(b, (uint8_t)t->kind);
+  switch (t->kind) {
+  case TYPEK_ARRAY: put_type(b, pool, prog, t->as.array.elem); break;
+  case TYPEK_TUPLE:
+    put_u32(b, (uint32_t)t->as.tuple.len);
+    for (size_t i = 0; i < t->as.tuple.len; ++i) put_type(b, pool, prog, t->as.tuple.items[i]);
+    break;
+  case TYPEK_ALIAS: put_u32(b, pool_ref(pool, t->as.alias.name)); put_type(b, pool, prog, t->as.alias.target); break;
+  case TYPEK_OPTIONAL: put_type(b, pool, prog, t->as.optional.inner); break;
+  case TYPEK_RESULT: put_type(b, pool, prog, t->as.result.ok); put_type(b, pool, prog, t->as.result.err); break;
+  case TYPEK_SCHEMA:
+  case TYPEK_RECORD:
+  case TYPEK_ENUM: {
+    int idx = schema_index(prog, t);
+    put_u32(b, (uint32_t)idx);
+    if (idx < 0) { put_u32(b, pool_ref(pool, t->as.schema.name)); put_fields(b, pool, prog, t); }
+    break;
+  }
+  default: break;
+  }
+}
+
+unsigned char *bytecode_serialize(const IrProgram *prog, size_t *len_out) {
+  Pool pool = {0};
+  Buf funcs = {0}, params = {0}, instrs = {0}, lines = {0}, schema = {0};
+  size_t instr_count = 0;
+  for (size_t i = 0; i < prog->funcs.len; ++i) {
+    const IrFunc *f = &prog->funcs.items[i];
+    ImageFunc fr = {pool_ref(&pool, f->name), (uint32_t)f->param_count, (uint32_t)(params.len / 4),
+                    f->next_temp, f->next_label, (uint32_t)f->instrs.len, instr_count,
+                    (uint32_t)f->lines.len, (uint32_t)(lines.len / sizeof(ImageLine))};
+    for (int j = 0; j < f->param_count; ++j) put_u32(&params, pool_ref(&pool, f->params[j]));
+    for (size_t j = 0; j < f->instrs.len; ++j) {
+      const IrInstr *ins = &f->instrs.items[j];
+      ImageInstr ir = {(uint32_t)ins->op, ins->dest, ins->arg1, ins->arg2, ins->f, pool_ref(&pool, ins->s), pool_ref(&pool, ins->s2)};
+      buf_put(&instrs, &ir, sizeof(ir));
+    }
+    for (size_t j = 0; j < f->lines.len; ++j) {
+      const IrLine *ln = &f->lines.items[j];
+      ImageLine il = {ln->start, ln->span.line, ln->span.column, ln->span.offset, ln->span.length, 0};
+      buf_put(&lines, &il, sizeof(il));
+    }
+    instr_count += f->instrs.len;
+    buf_put(&funcs, &fr, sizeof(fr));
+  }
+  // schemas: kinds and names first so fields can reference any of them
+  for (size_t i = 0; i < prog->schemas.len; ++i) {
+    put_u8(&schema, (uint8_t)prog->schemas.items[i]->kind);
+    put_u32(&schema, pool_ref(&pool, prog->schemas.items[i]->as.schema.name));
+  }
+  for (size_t i = 0; i < prog->schemas.len; ++i) put_fields(&schema, &pool, prog, prog->schemas.items[i]);
+  put_u8(&pool.bytes, 0); // the pool always ends in NUL
+
+  ImageHeader h = {0};
+  memcpy(h.magic, BYTECODE_MAGIC, sizeof(BYTECODE_MAGIC));
+  h.version = BYTECODE_FORMAT_VERSION;
+  h.byte_order = BYTE_ORDER_MARK;
+  h.func_count = (uint32_t)prog->funcs.len;
+  h.schema_count = (uint32_t)prog->schemas.len;
+  Buf out = {0};
+  buf_put(&out, &h, sizeof(h));
+  h.func_off = out.len; buf_put(&out, funcs.data, funcs.len); buf_align(&out);
+  h.param_off = out.len; buf_put(&out, params.data, params.len); buf_align(&out);
+  h.instr_off = out.len; buf_put(&out, instrs.data, instrs.len); buf_align(&out);
+  h.line_off = out.len; buf_put(&out, lines.data, lines.len); buf_align(&out);
+  h.schema_off = out.len; h.schema_len = schema.len; buf_put(&out, schema.data, schema.len); buf_align(&out);
+  h.pool_off = out.len; h.pool_len = pool.bytes.len; buf_put(&out, pool.bytes.data, pool.bytes.len); buf_align(&out);
+  h.image_len = out.len;
+  memcpy(out.data, &h, sizeof(h));
+  lm_free(funcs.data); lm_free(params.data); lm_free(instrs.data); lm_free(lines.data); lm_free(schema.data);
+  lm_free(pool.bytes.data); lm_free(pool.slots);
+  if (len_out) *len_out = out.len;
+  return out.data;
+}
+
+// ---- Reader ----
+
+typedef struct {
+  const unsigned char *data;
+  size_t len;
+  ImageHeader h;
+  const char *pool;
+  int borrow; // strings point into data instead of being copied
+  const char *err;
+  IrProgram *prog;
+  size_t pos; // cursor into the schema stream
+} Reader;
+
+static int range_ok(const Reader *r, uint64_t off, uint64_t n) { return off <= r->len && n <= r->len - off; }
+
+static const char *pool_str(Reader *r, uint32_t ref) {
+  if (ref == NO_STR || r->err) return NULL;
+  if (ref >= r->h.pool_len) { r->err = "bad string ref"; return NULL; }
+  return r->pool + ref;
+}
+
+static char *get_str(Reader *r, uint32_t ref) {
+  const char *s = pool_str(r, ref);
+  if (!s) return NULL;
+  return r->borrow ? (char *)s : lm_strdup(s);
+}
+
+static int schema_need(Reader *r, size_t n) {
+  if (r->err) return 0;
+  if (r->h.schema_len - r->pos < n) { r->err = "truncated schema table"; return 0; }
+  return 1;
+}
+static uint8_t schema_u8(Reader *r) { if (!schema_need(r, 1)) return 0; return r->data[r->h.schema_off + r->pos++]; }
+static uint32_t schema_u32(Reader *r) { uint32_t v = 0; if (!schema_need(r, 4)) return 0; memcpy(&v, r->data + r->h.schema_off + r->pos, 4); r->pos += 4; return v; }
+
+static Type *get_type(Reader *r, int depth);
+
+static void get_fields(Reader *r, Type *t, int depth) {
+  uint32_t n = schema_u32(r);
+  if (!r->err && n > (r->h.schema_len - r->pos) / 5) { r->err = "bad field count"; return; }
+  for (uint32_t i = 0; i < n && !r->err; ++i) {
+    const char *name = pool_str(r, schema_u32(r));
+    Type *ft = get_type(r, depth + 1);
+    if (!r->err) schema_add_field(t, name ? name : "", ft);
+  }
+}
+
+// Nested types the program does not otherwise own are tracked in owned_types
+static Type *own(Reader *r, Type *t) { typevec_push(&r->prog->owned_types, t); return t; }
+
+static Type *get_type(Reader *r, int depth) {
+  if (depth > MAX_TYPE_DEPTH) { r->err = "type nesting too deep"; return NULL; }
+  uint8_t k = schema_u8(r);
+  if (r->err || k == TYPE_NULL) return NULL;
+  if (k > TYPEK_UNKNOWN) { r->err = "bad type kind"; return NULL; }
+  switch ((TypeKindSem)k) {
+  case TYPEK_ARRAY: { Type *elem = get_type(r, depth + 1); return r->err ? NULL : own(r, type_array(elem)); }
+  case TYPEK_TUPLE: {
+    TypeVec vec = {0};
+    uint32_t n = schema_u32(r);
+    if (!r->err && n > r->h.schema_len - r->pos) r->err = "bad tuple length";
+    for (uint32_t i = 0; i < n && !r->err; ++i) typevec_push(&vec, get_type(r, depth + 1));
+    if (r->err) { lm_free(vec.items); return NULL; }
+    return own(r, type_tuple(vec));
+  }
+  case TYPEK_ALIAS: {
+    const char *name = pool_str(r, schema_u32(r));
+    Type *target = get_type(r, depth + 1);
+    return r->err ? NULL : own(r, type_alias(name ? name : "", target));
+  }
+  case TYPEK_OPTIONAL: {
+    Type *inner = get_type(r, depth + 1);
+    if (r->err) return NULL;
+    // Optional<unknown> is a shared singleton
+    if (inner == type_primitive(TYPEK_UNKNOWN)) return type_optional(inner);
+    return own(r, type_optional(inner));
+  }
+  case TYPEK_RESULT: {
+    Type *ok = get_type(r, depth + 1);
+    Type *err = get_type(r, depth + 1);
+    return r->err ? NULL : own(r, type_result(ok, err));
+  }
+  case TYPEK_SCHEMA:
+  case TYPEK_RECORD:
+  case TYPEK_ENUM: {
+    uint32_t idx = schema_u32(r);
+    if (r->err) return NULL;
+    if (idx != NO_STR) {
+      if (idx >= r->prog->schemas.len) { r->err = "bad schema index"; return NULL; }
+      return r->prog->schemas.items[idx];
+    }
+    Type *t = own(r, type_schema(pool_str(r, schema_u32(r))));
+    t->kind = (TypeKindSem)k;
+    get_fields(r, t, depth);
+    return r->err ? NULL : t;
+  }
+  default:
+    return type_primitive((TypeKindSem)k);
+  }
+}
+
+static void get_func(Reader *r, const ImageFunc *fr, IrFunc *f) {
+  uint64_t instr_count = (r->h.line_off - r->h.instr_off) / sizeof(ImageInstr);
+  uint64_t param_count = (r->h.instr_off - r->h.param_off) / 4;
+  uint64_t line_count = (r->h.schema_off - r->h.line_off) / sizeof(ImageLine);
+  if ((uint64_t)fr->param_start + fr->param_count > param_count || fr->instr_start + fr->instr_count > instr_count ||
+      (uint64_t)fr->line_start + fr->line_count > line_count) { r->err = "bad function table"; return; }
+  f->name = get_str(r, fr->name);
+  f->params = xmalloc(sizeof(char *) * (fr->param_count ? fr->param_count : 1));
+  for (uint32_t j = 0; j < fr->param_count && !r->err; ++j) {
+    uint32_t ref; memcpy(&ref, r->data + r->h.param_off + 4 * ((uint64_t)fr->param_start + j), 4);
+    f->params[j] = get_str(r, ref);
+    f->param_count = (int)j + 1;
+  }
+  f->next_temp = fr->next_temp;
+  f->next_label = fr->next_label;
+  f->instrs.items = xmalloc(sizeof(IrInstr) * (fr->instr_count ? fr->instr_count : 1));
+  f->instrs.cap = fr->instr_count ? fr->instr_count : 1;
+  const unsigned char *base = r->data + r->h.instr_off + fr->instr_start * sizeof(ImageInstr);
+  for (uint32_t j = 0; j < fr->instr_count && !r->err; ++j) {
+    ImageInstr ir; memcpy(&ir, base + (size_t)j * sizeof(ImageInstr), sizeof(ir));
+    if (ir.op > IR_AWAIT) { r->err = "bad opcode"; return; }
+    IrInstr *ins = &f->instrs.items[j];
+    ins->op = (IrOp)ir.op;
+    ins->dest = ir.dest;
+    ins->arg1 = ir.arg1;
+    ins->arg2 = ir.arg2;
+    ins->f = ir.f;
+    ins->s = get_str(r, ir.s);
+    ins->s2 = get_str(r, ir.s2);
+    f->instrs.len = j + 1;
+  }
+  // Line tables are copied: passes rewrite them along with the instructions
+  f->lines.items = xmalloc(sizeof(IrLine) * (fr->line_count ? fr->line_count : 1));
+  f->lines.cap = fr->line_count ? fr->line_count : 1;
+  const unsigned char *lbase = r->data + r->h.line_off + (size_t)fr->line_start * sizeof(ImageLine);
+  for (uint32_t j = 0; j < fr->line_count; ++j) {
+    ImageLine il; memcpy(&il, lbase + (size_t)j * sizeof(ImageLine), sizeof(il));
+    if (il.start >= fr->instr_count || (j && il.start <= f->lines.items[j - 1].start)) { r->err = "bad line table"; return; }
+    f->lines.items[j] = (IrLine){il.start, {il.line, il.column, il.offset, il.length}};
+    f->lines.len = j + 1;
+  }
+}
+
+static int check_header(Reader *r) {
+  if (r->len < sizeof(ImageHeader)) { r->err = "truncated header"; return 0; }
+  memcpy(&r->h, r->data, sizeof(ImageHeader));
+  const ImageHeader *h = &r->h;
+  if (memcmp(h->magic, BYTECODE_MAGIC, sizeof(BYTECODE_MAGIC)) != 0) { r->err = "bad magic"; return 0; }
+  if (h->version != BYTECODE_FORMAT_VERSION) { r->err = "format version mismatch"; return 0; }
+  if (h->byte_order != BYTE_ORDER_MARK) { r->err = "byte order mismatch"; return 0; }
+  if (h->image_len != r->len) { r->err = "truncated image"; return 0; }
+  // Sections are laid out in order; checking the chain bounds every table
+  if (!(sizeof(ImageHeader) <= h->func_off && h->func_off <= h->param_off && h->param_off <= h->instr_off &&
+        h->instr_off <= h->line_off && h->line_off <= h->schema_off && h->schema_off + h->schema_len <= h->pool_off &&
+        range_ok(r, h->pool_off, h->pool_len) && h->pool_len > 0 &&
+        (h->param_off - h->func_off) / sizeof(ImageFunc) >= h->func_count &&
+        h->schema_count <= h->schema_len / 5)) { r->err = "bad section table"; return 0; }
+  r->pool = (const char *)r->data + h->pool_off;
+  // Every pool ref is < pool_len, so a trailing NUL bounds every string
+  if (r->pool[h->pool_len - 1] != '\0') { r->err = "unterminated string pool"; return 0; }
+  return 1;
+}
+
+static IrProgram *read_image(const unsigned char *data, size_t len, int borrow, char **errmsg) {
+  Reader r = {0};
+  r.data = data; r.len = len; r.borrow = borrow;
+  r.prog = ir_program_new();
+  // A borrowing program owns the mapping from here on, even on error
+  if (borrow) { r.prog->image = (void *)data; r.prog->image_len = len; }
+  if (check_header(&r)) {
+    for (uint32_t i = 0; i < r.h.schema_count && !r.err; ++i) {
+      uint8_t k = schema_u8(&r);
+      Type *t = type_schema(pool_str(&r, schema_u32(&r)));
+      if (k == TYPEK_RECORD || k == TYPEK_ENUM) t->kind = (TypeKindSem)k;
+      typevec_push(&r.prog->schemas, t);
+    }
+    for (uint32_t i = 0; i < r.h.schema_count && !r.err; ++i) get_fields(&r, r.prog->schemas.items[i], 0);
+    for (uint32_t i = 0; i < r.h.func_count && !r.err; ++i) {
+      ImageFunc fr; memcpy(&fr, data + r.h.func_off + (size_t)i * sizeof(ImageFunc), sizeof(fr));
+      IrFunc f = {0};
+      get_func(&r, &fr, &f);
+      ir_program_add_func(r.prog, f);
+    }
+  }
+  if (r.err) {
+    if (errmsg) *errmsg = lm_strdup(r.err);
+    ir_program_free(r.prog);
+    return NULL;
+  }
+  return r.prog;
+}
+
+IrProgram *bytecode_deserialize(const unsigned char *data, size_t len, char **errmsg) {
+  return read_image(data, len, 0, errmsg);
+}
+
+IrProgram *bytecode_map_file(const char *path, char **errmsg) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) { if (errmsg) *errmsg = lm_strdup("cannot open image"); return NULL; }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) { close(fd); if (errmsg) *errmsg = lm_strdup("empty image"); return NULL; }
+  size_t len = (size_t)st.st_size;
+  void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) { if (errmsg) *errmsg = lm_strdup("mmap failed"); return NULL; }
+  return read_image(map, len, 1, errmsg);
+}
+
+// ---- Cache ----
+
+void bytecode_cache_key(const char *src, size_t len, char out_hex[65]) {
+  char tag[64];
+  int tn = snprintf(tag, sizeof(tag), "\nliminal " LIMINAL_VERSION " bytecode %d", BYTECODE_FORMAT_VERSION);
+  unsigned char *buf = xmalloc(len + (size_t)tn);
+  memcpy(buf, src, len);
+  memcpy(buf + len, tag, (size_t)tn);
+  uint8_t digest[32];
+  sha256(buf, len + (size_t)tn, digest);
+  sha256_hex(digest, out_hex);
+  lm_free(buf);
+}
+
+char *bytecode_cache_path(const char *dir, const char *src, size_t len) {
+  char key[65];
+  bytecode_cache_key(src, len, key);
+  size_t n = strlen(dir) + 64 + 16;
+  char *path = xmalloc(n);
+  snprintf(path, n, "%s/%s.limbc", dir, key);
+  return path;
+}
+
+// A missing, stale or corrupt entry is a cache miss; the caller recompiles
+IrProgram *bytecode_cache_load(const char *dir, const char *src, size_t len) {
+  char *path = bytecode_cache_path(dir, src, len);
+  IrProgram *prog = bytecode_map_file(path, NULL);
+  lm_free(path);
+  return prog;
+}
+
+// Written to a temp file and renamed so concurrent runs never see a torn
+// entry, and processes still mapping a replaced image keep their pages.
+int bytecode_cache_store(const char *dir, const char *src, size_t len, const IrProgram *prog) {
+  char *path = bytecode_cache_path(dir, src, len);
+  size_t tn = strlen(path) + 8;
+  char *tmp = xmalloc(tn);
+  snprintf(tmp, tn, "%s.XXXXXX", path);
+  int fd = mkstemp(tmp);
+  if (fd < 0) { lm_free(tmp); lm_free(path); return 0; }
+  size_t n = 0;
+  unsigned char *data = bytecode_serialize(prog, &n);
+  FILE *f = fdopen(fd, "wb");
+  int ok = f && fwrite(data, 1, n, f) == n;
+  if (f) ok = (fclose(f) == 0) && ok; else close(fd);
+  if (ok) ok = rename(tmp, path) == 0;
+  if (!ok) unlink(tmp);
+  lm_free(data); lm_free(tmp); lm_free(path);
+  return ok;
+}
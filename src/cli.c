@@ -1,5 +1,10 @@
 #include "liminal/cli.h"
 #include "liminal/exec.h"
+#include "liminal/aot.h"
+#include "liminal/batch.h"
+#include "liminal/ngrams.h"
+#include "liminal/recordings.h"
+#include <stdlib.h>
 #include <string.h>
 
 static const char *HELP_TEXT =
@@ -7,11 +12,55 @@ static const char *HELP_TEXT =
     "\n"
     "Usage:\n"
     "  liminal [--help] [--version]\n"
-    "  liminal run <file>\n"
+    "  liminal run [--jit] [--profile-out <prof>|--profile-in <prof>]\n"
+    "              [--profile] [--profile-json <json>] [--annotate <out>]\n"
+    "              [--sample <out>] [--trace <out>] [--time-phases]\n"
+    "              [--time-phases-json <json>] <file>\n"
+    "  liminal run --batch <inputs.jsonl> [--jobs <n>] [--completion-order] <file>\n"
+    "  liminal compile <file> [-o <output>] [--emit-c] [--profile-in <prof>]\n"
+    "  liminal ngrams [-n <len>] [--top <k>] [--raw] <file>...\n"
+    "  liminal recordings stats <recording>\n"
+    "  liminal recordings convert <in> <out>\n"
+    "  liminal recordings compact <recording>\n"
     "\n"
     "Options:\n"
     "  --help, -h      Show this help message\n"
-    "  --version, -v   Show version information\n";
+    "  --version, -v   Show version information\n"
+    "  --jit           run: compile hot functions to machine code (x86-64)\n"
+    "  --profile-out <prof>\n"
+    "                  run: record call and branch counts into <prof>\n"
+    "  --profile-in <prof>\n"
+    "                  run, compile: optimize with a recorded profile\n"
+    "  --profile       run: print time per function and counts per op to stderr\n"
+    "  --profile-json <json>\n"
+    "                  run: --profile, also written to <json>\n"
+    "  --annotate <out>\n"
+    "                  run: --profile, also write the IR with source lines and\n"
+    "                  execution counts to <out>\n"
+    "  --sample <out>  run: sample the call stack (LIMINAL_SAMPLE_HZ, default 1000)\n"
+    "                  and write collapsed stacks for flamegraphs to <out>\n"
+    "  --trace <out>   run: write a Chrome trace of compile phases, calls\n"
+    "                  (LIMINAL_TRACE_MIN_US, default 10) and oracle calls to <out>\n"
+    "  --time-phases   run: print time, allocations and peak heap per phase to stderr\n"
+    "  --time-phases-json <json>\n"
+    "                  run: --time-phases, also written to <json>\n"
+    "  --batch <inputs.jsonl>\n"
+    "                  run: compile once and run once per JSON record, fields\n"
+    "                  bound to variables (\"stdin\": ReadLn input), outputs in\n"
+    "                  input order\n"
+    "  --jobs <n>      run --batch: records in flight at once (default 8)\n"
+    "  --completion-order\n"
+    "                  run --batch: write {\"id\",\"output\"} lines as records finish\n"
+    "  -o <output>     compile: output path (default: <file> without .lim)\n"
+    "  --emit-c        compile: write the generated C instead of an executable\n"
+    "  -n <len>        ngrams: longest op sequence to count (2-6, default 4)\n"
+    "  --top <k>       ngrams: sequences to report (default 30)\n"
+    "  --raw           ngrams: mine the IR without superinstructions\n"
+    "\n"
+    "Recordings (LIMINAL_ORACLE_RECORDING):\n"
+    "  stats           records, distinct prompts, failures and index coverage\n"
+    "  convert         JSONL to binary (with its .idx index) or binary to JSONL\n"
+    "  compact         binary: drop repeated prompts and rebuild the index\n";
 
 const char *liminal_help_text(void) {
   return HELP_TEXT;
@@ -32,6 +81,217 @@ static int print_version(void) {
   return 0;
 }
 
+static int run_command(int argc, char **argv) {
+  const char *input = NULL;
+  const char *profile_in = NULL;
+  const char *profile_out = NULL;
+  const char *profile_json = NULL;
+  const char *annotate_out = NULL;
+  const char *sample_out = NULL;
+  const char *trace_out = NULL;
+  const char *time_phases_json = NULL;
+  const char *batch = NULL;
+  BatchOptions batch_opt = { 8, 0 };
+  int batch_only = 0;
+  int jit = 0;
+  int profile = 0;
+  int time_phases = 0;
+  for (int i = 0; i < argc; ++i) {
+    if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+      batch = argv[++i];
+    } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+      char *end;
+      long jobs = strtol(argv[++i], &end, 10);
+      if (*end || jobs < 1) {
+        fprintf(stderr, "--jobs needs a positive count: %s\n", argv[i]);
+        return 1;
+      }
+      batch_opt.jobs = (size_t)jobs;
+      batch_only = 1;
+    } else if (strcmp(argv[i], "--completion-order") == 0) {
+      batch_opt.completion_order = 1;
+      batch_only = 1;
+    } else if (strcmp(argv[i], "--jit") == 0) {
+      jit = 1;
+    } else if (strcmp(argv[i], "--profile") == 0) {
+      profile = 1;
+    } else if (strcmp(argv[i], "--profile-json") == 0 && i + 1 < argc) {
+      profile = 1;
+      profile_json = argv[++i];
+    } else if (strcmp(argv[i], "--annotate") == 0 && i + 1 < argc) {
+      profile = 1;
+      annotate_out = argv[++i];
+    } else if (strcmp(argv[i], "--sample") == 0 && i + 1 < argc) {
+      sample_out = argv[++i];
+    } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      trace_out = argv[++i];
+    } else if (strcmp(argv[i], "--time-phases") == 0) {
+      time_phases = 1;
+    } else if (strcmp(argv[i], "--time-phases-json") == 0 && i + 1 < argc) {
+      time_phases = 1;
+      time_phases_json = argv[++i];
+    } else if (strcmp(argv[i], "--profile-in") == 0 && i + 1 < argc) {
+      profile_in = argv[++i];
+    } else if (strcmp(argv[i], "--profile-out") == 0 && i + 1 < argc) {
+      profile_out = argv[++i];
+    } else if (!input && argv[i][0] != '-') {
+      input = argv[i];
+    } else {
+      fprintf(stderr, "Unknown run option: %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (!input) {
+    fprintf(stderr, "Usage: liminal run [--jit] [--profile-out <prof>|--profile-in <prof>] [--profile] [--profile-json <json>] [--annotate <out>] [--sample <out>] [--trace <out>] [--time-phases] [--time-phases-json <json>] <file>\n");
+    fprintf(stderr, "       liminal run --batch <inputs.jsonl> [--jobs <n>] [--completion-order] <file>\n");
+    return 1;
+  }
+  // A profile describes the unoptimized program, so it is never recorded
+  // from an optimized run
+  if (profile_in && profile_out) {
+    fprintf(stderr, "--profile-in and --profile-out cannot be combined\n");
+    return 1;
+  }
+  if (batch_only && !batch) {
+    fprintf(stderr, "--jobs and --completion-order need --batch\n");
+    return 1;
+  }
+  // Batch instances run interpreted, without the per-run instrumentation
+  if (batch && (jit || profile_out || profile || sample_out || trace_out || time_phases)) {
+    fprintf(stderr, "--batch cannot be combined with --jit, --profile-out, --profile, --sample, --trace or --time-phases\n");
+    return 1;
+  }
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  if (batch) {
+    ctx.pgo_in = profile_in;
+    int rc = liminal_run_batch(&ctx, input, batch, &batch_opt);
+    liminal_context_free(&ctx);
+    return rc;
+  }
+  ctx.jit = jit;
+  ctx.pgo_in = profile_in;
+  ctx.pgo_out = profile_out;
+  ctx.profile = profile;
+  ctx.profile_json = profile_json;
+  ctx.annotate_out = annotate_out;
+  ctx.sample_out = sample_out;
+  ctx.trace_out = trace_out;
+  ctx.time_phases = time_phases;
+  ctx.time_phases_json = time_phases_json;
+  int rc = liminal_run_file_ctx(&ctx, input);
+  liminal_context_free(&ctx);
+  return rc;
+}
+
+static int compile_command(int argc, char **argv) {
+  const char *input = NULL;
+  const char *output = NULL;
+  const char *profile_in = NULL;
+  int emit_c = 0;
+  for (int i = 0; i < argc; ++i) {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (strcmp(argv[i], "--profile-in") == 0 && i + 1 < argc) {
+      profile_in = argv[++i];
+    } else if (strcmp(argv[i], "--emit-c") == 0) {
+      emit_c = 1;
+    } else if (!input && argv[i][0] != '-') {
+      input = argv[i];
+    } else {
+      fprintf(stderr, "Unknown compile option: %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (!input) {
+    fprintf(stderr, "Usage: liminal compile <file> [-o <output>] [--emit-c] [--profile-in <prof>]\n");
+    return 1;
+  }
+  char *derived = NULL;
+  if (!output) {
+    // prog.lim -> prog (or prog.c with --emit-c)
+    size_t len = strlen(input);
+    if (len > 4 && strcmp(input + len - 4, ".lim") == 0) len -= 4;
+    derived = malloc(len + 3);
+    memcpy(derived, input, len);
+    strcpy(derived + len, emit_c ? ".c" : "");
+    if (!emit_c && strcmp(derived, input) == 0) strcpy(derived + len, ".out");
+    output = derived;
+  }
+  int rc = liminal_compile_file(input, output, emit_c, profile_in);
+  free(derived);
+  return rc;
+}
+
+static int ngrams_command(int argc, char **argv) {
+  int max_len = 4;
+  size_t top = 30;
+  int raw = 0;
+  const char **files = malloc(sizeof(char *) * (size_t)(argc ? argc : 1));
+  size_t nfiles = 0;
+  for (int i = 0; i < argc; ++i) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      max_len = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+      top = (size_t)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--raw") == 0) {
+      raw = 1;
+    } else if (argv[i][0] != '-') {
+      files[nfiles++] = argv[i];
+    } else {
+      fprintf(stderr, "Unknown ngrams option: %s\n", argv[i]);
+      free(files);
+      return 1;
+    }
+  }
+  if (nfiles == 0) {
+    fprintf(stderr, "Usage: liminal ngrams [-n <len>] [--top <k>] [--raw] <file>...\n");
+    free(files);
+    return 1;
+  }
+  int rc = liminal_ngrams_files(files, nfiles, max_len, top, raw, stdout);
+  free(files);
+  return rc;
+}
+
+static void print_recording_stats(const char *path, const RecordingStats *st) {
+  printf("%s: %s recording\n", path, st->binary ? "binary" : "JSONL");
+  printf("  records:  %zu (%zu distinct prompts, %zu failures)\n", st->records, st->distinct, st->failures);
+  printf("  size:     %zu bytes, %zu of them answers\n", st->file_bytes, st->answer_bytes);
+  if (st->binary) {
+    if (!st->indexed) printf("  index:    none; run compact to build it\n");
+    else if (st->unindexed) printf("  index:    %zu records appended since; run compact to fold them in\n", st->unindexed);
+    else printf("  index:    covers every record\n");
+    if (st->skipped) printf("  skipped:  %zu bytes of a torn last record\n", st->skipped);
+  } else if (st->skipped) {
+    printf("  skipped:  %zu lines that are not records\n", st->skipped);
+  }
+}
+
+static int recordings_command(int argc, char **argv) {
+  const char *usage = "Usage: liminal recordings stats <recording> | convert <in> <out> | compact <recording>\n";
+  char *errmsg = NULL;
+  int rc;
+  if (argc == 2 && strcmp(argv[0], "stats") == 0) {
+    RecordingStats st;
+    rc = recordings_stats(argv[1], &st, &errmsg);
+    if (rc == 0) print_recording_stats(argv[1], &st);
+  } else if (argc == 3 && strcmp(argv[0], "convert") == 0) {
+    rc = recordings_convert(argv[1], argv[2], &errmsg);
+  } else if (argc == 2 && strcmp(argv[0], "compact") == 0) {
+    rc = recordings_compact(argv[1], &errmsg);
+  } else {
+    fputs(usage, stderr);
+    return 1;
+  }
+  if (rc != 0) {
+    fprintf(stderr, "%s\n", errmsg ? errmsg : "recordings: failed");
+    free(errmsg);
+    return 1;
+  }
+  return 0;
+}
+
 int liminal_main(int argc, char **argv) {
   if (argc <= 1) {
     // default: show help
@@ -48,7 +308,19 @@ int liminal_main(int argc, char **argv) {
   }
 
   if (argc >= 3 && strcmp(argv[1], "run") == 0) {
-    return liminal_run_file(argv[2]);
+    return run_command(argc - 2, argv + 2);
+  }
+
+  if (argc >= 3 && strcmp(argv[1], "ngrams") == 0) {
+    return ngrams_command(argc - 2, argv + 2);
+  }
+
+  if (argc >= 3 && strcmp(argv[1], "recordings") == 0) {
+    return recordings_command(argc - 2, argv + 2);
+  }
+
+  if (argc >= 3 && strcmp(argv[1], "compile") == 0) {
+    return compile_command(argc - 2, argv + 2);
   }
 
   fprintf(stderr, "Unknown option: %s\n", argv[1]);
@@ -0,0 +1,69 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/context.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CONTEXT_OUTBUF_FLUSH 65536
+
+static int env_flag(const char *name) {
+  const char *v = getenv(name);
+  return v && *v;
+}
+
+void liminal_context_init(LiminalContext *ctx) {
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->debug_exec = env_flag("LIMINAL_DEBUG_EXEC");
+  // LIMINAL_DEBUG_IR historically triggered on presence, even when empty
+  ctx->debug_ir = getenv("LIMINAL_DEBUG_IR") != NULL;
+  ctx->debug_ir_log = env_flag("LIMINAL_DEBUG_IR_LOG");
+  ctx->debug_ir_call = env_flag("LIMINAL_DEBUG_IR_CALL");
+  ctx->debug_tc = env_flag("LIMINAL_DEBUG_TC");
+  ctx->debug_parser = env_flag("LIMINAL_DEBUG_PARSER");
+  ctx->fuse = !env_flag("LIMINAL_NO_FUSE");
+  ctx->quicken = !env_flag("LIMINAL_NO_QUICKEN");
+  const char *hot = getenv("LIMINAL_JIT_THRESHOLD");
+  ctx->jit_threshold = hot && *hot ? strtol(hot, NULL, 10) : -1;
+  const char *hz = getenv("LIMINAL_SAMPLE_HZ");
+  ctx->sample_hz = hz && *hz ? strtol(hz, NULL, 10) : 1000;
+  const char *min_us = getenv("LIMINAL_TRACE_MIN_US");
+  ctx->trace_min_us = min_us && *min_us ? strtol(min_us, NULL, 10) : 10;
+  const char *workers = getenv("LIMINAL_PARALLEL_WORKERS");
+  ctx->parallel_workers = workers && *workers ? strtol(workers, NULL, 10) : 8;
+  const char *cache = getenv("LIMINAL_CACHE_DIR");
+  if (cache && *cache) ctx->cache_dir = strdup(cache);
+  ctx->in = stdin;
+  ctx->out = stdout;
+}
+
+void liminal_context_free(LiminalContext *ctx) {
+  if (!ctx) return;
+  liminal_context_flush(ctx);
+  free(ctx->outbuf);
+  ctx->outbuf = NULL;
+  ctx->outbuf_len = ctx->outbuf_cap = 0;
+  free(ctx->cache_dir);
+  ctx->cache_dir = NULL;
+  if (ctx->owns_oracle && ctx->oracle_release) ctx->oracle_release(ctx->oracle);
+  ctx->oracle = NULL;
+  ctx->owns_oracle = 0;
+}
+
+void liminal_context_write(LiminalContext *ctx, const char *data, size_t len) {
+  if (ctx->outbuf_len + len > ctx->outbuf_cap) {
+    size_t cap = ctx->outbuf_cap ? ctx->outbuf_cap : 4096;
+    while (cap < ctx->outbuf_len + len) cap *= 2;
+    ctx->outbuf = realloc(ctx->outbuf, cap);
+    ctx->outbuf_cap = cap;
+  }
+  memcpy(ctx->outbuf + ctx->outbuf_len, data, len);
+  ctx->outbuf_len += len;
+  if (ctx->outbuf_len >= CONTEXT_OUTBUF_FLUSH) liminal_context_flush(ctx);
+}
+
+void liminal_context_flush(LiminalContext *ctx) {
+  if (ctx->outbuf_len == 0 || !ctx->out) return;
+  fwrite(ctx->outbuf, 1, ctx->outbuf_len, ctx->out);
+  fflush(ctx->out);
+  ctx->outbuf_len = 0;
+}
@@ -1,474 +1,695 @@
 #define _POSIX_C_SOURCE 200809L
 #include "liminal/exec.h"
+#include "liminal/alloc.h"
 #include "liminal/parser.h"
 #include "liminal/typecheck.h"
+#include "liminal/bytecode.h"
+#include "liminal/value.h"
+#include "liminal/jit.h"
+#include "liminal/ngrams.h"
+#include "liminal/peephole.h"
+#include "liminal/pgo.h"
+#include "liminal/phases.h"
+#include "liminal/profiler.h"
+#include "liminal/sampler.h"
+#include "liminal/trace.h"
+#include "liminal/workers.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
 
-static int debug_exec(void) {
-  const char *dbg = getenv("LIMINAL_DEBUG_EXEC");
-  return dbg && *dbg;
+typedef struct ExecLabel { char *name; size_t idx; } Label;
+
+static long find_label(Label *labels, size_t n, const char *name){ for(size_t i=0;i<n;i++) if(strcmp(labels[i].name,name)==0) return (long)labels[i].idx; return -1; }
+
+static Type *find_schema(const IrProgram *prog, const char *name) {
+  for (size_t i=0;i<prog->schemas.len;++i) {
+    if (prog->schemas.items[i]->as.schema.name && strcmp(prog->schemas.items[i]->as.schema.name, name)==0)
+      return prog->schemas.items[i];
+  }
+  return NULL;
+}
+
+static int validate_json_against_schema(const char *json, Type *schema, char **errmsg);
+
+static const IrFunc *find_func(const IrProgram *prog, const char *name) {
+  for (size_t i=0;i<prog->funcs.len;++i) if (strcmp(prog->funcs.items[i].name,name)==0) return &prog->funcs.items[i];
+  return NULL;
+}
+
+static int execute_func(LiminalContext *ctx, const IrProgram *prog, const IrFunc *f, Env *env, Value *ret_out);
+static long run_parallel(ExecFrame *fr, size_t ip);
+
+static const char *oracle_kind_name(const Oracle *o){
+  switch (o ? o->kind : ORACLE_KIND_NONE) {
+  case ORACLE_KIND_MOCK: return "mock";
+  case ORACLE_KIND_OLLAMA: return "ollama";
+  case ORACLE_KIND_NONE: break;
+  }
+  return "none";
+}
+
+// Traces an ask. A consult's ask reads its prompt from __consult_prompt_<n>
+// (see the lowering), and __consult_retries_<n> holds the attempts it has
+// left, this one included.
+static void trace_ask(ExecFrame *fr, size_t ip, const char *prompt, const OracleResult *r, uint64_t started){
+  const IrInstr *ins = &fr->f->instrs.items[ip];
+  const IrInstr *prev = ip ? &fr->f->instrs.items[ip - 1] : NULL;
+  const char *tag = prev && prev->op == IR_LOAD_VAR && prev->s ? strstr(prev->s, "__consult_prompt_") : NULL;
+  long left = -1;
+  if (tag) {
+    char name[256];
+    snprintf(name, sizeof(name), "%.*s__consult_retries_%s", (int)(tag - prev->s), prev->s, tag + strlen("__consult_prompt_"));
+    Value *v = env_find(fr->env, name);
+    if (v && v->kind == VINT) left = v->i;
+  }
+  tracer_ask(fr->ctx->tracer, started, ip, ins->s ? ins->s : oracle_kind_name(fr->ctx->oracle), prompt, r, left);
 }
 
-typedef enum { VINT, VREAL, VSTRING, VRESULT, VBOOL, VOPTIONAL } ValKind;
+// Open streams of `stream` statements; a handle is an index into items
 typedef struct {
-  int ok;
-  char *text;
-  char *error;
-} VRes;
-typedef struct Value Value;
-static size_t _allocs=0, _frees=0;
-typedef struct Value {
-  ValKind kind;
-  int i;
-  double f;
-  char *s;
-  int owns;
-  char *ref; // optional reference name
-  int ref_interned;
-  VRes res;
-  struct { int is_some; Value *inner; } opt;
-} Value;
-
-static Value v_int(int x){ Value v={0}; v.kind=VINT; v.i=x; return v; }
-static Value v_bool(int x){ Value v={0}; v.kind=VBOOL; v.i=x?1:0; return v; }
-static Value v_real(double x){ Value v={0}; v.kind=VREAL; v.f=x; return v; }
-static Value v_string(const char *s){ Value v={0}; v.kind=VSTRING; v.s=strdup(s?s:"" ); v.owns=1; _allocs++; return v; }
-static Value v_result_ok(const char *text){ Value v={0}; v.kind=VRESULT; v.res.ok=1; v.res.text=strdup(text?text:""); v.owns=1; _allocs++; return v; }
-static Value v_result_err(const char *err){ Value v={0}; v.kind=VRESULT; v.res.ok=0; v.res.error=strdup(err?err:""); v.owns=1; _allocs++; return v; }
-static Value v_optional_none(void){ Value v={0}; v.kind=VOPTIONAL; v.opt.is_some=0; v.opt.inner=NULL; return v; }
-static Value v_copy(Value v);
-static Value v_optional_some(Value inner){ Value v={0}; v.kind=VOPTIONAL; v.opt.is_some=1; v.opt.inner=malloc(sizeof(Value)); *v.opt.inner = v_copy(inner); return v; }
-static Value v_copy(Value v){
-  Value out = v;
-  if (v.kind==VSTRING) { out = v_string(v.s); }
-  else if (v.kind==VRESULT) { if (v.res.ok) out = v_result_ok(v.res.text); else out = v_result_err(v.res.error);} 
-  else if (v.kind==VOPTIONAL) { if (v.opt.is_some && v.opt.inner) out = v_optional_some(*v.opt.inner); else out = v_optional_none(); }
-  else if (v.kind==VBOOL) out = v_bool(v.i);
-  if (v.ref) {
-    out.ref = strdup(v.ref);
-    out.ref_interned = 0;
-    _allocs++;
-  } else {
-    out.ref = NULL;
-    out.ref_interned = 0;
-  }
-  return out;
-}
-static void v_free(Value v){ if (v.ref && !v.ref_interned) { free(v.ref); _frees++; } if (v.kind==VSTRING){ if (v.owns && v.s) { free(v.s); _frees++; } } else if (v.kind==VRESULT){ if (v.res.text){ free(v.res.text); _frees++; } if (v.res.error){ free(v.res.error); _frees++; } } else if (v.kind==VOPTIONAL){ if (v.opt.inner){ v_free(*v.opt.inner); free(v.opt.inner);} } }
-static void print_value(FILE *out, Value v){
-  switch(v.kind){
-  case VINT: fprintf(out, "%d", v.i); break;
-  case VBOOL: fprintf(out, "%s", v.i?"True":"False"); break;
-  case VREAL: fprintf(out, "%g", v.f); break;
-  case VSTRING: fprintf(out, "%s", v.s?v.s:"" ); break;
-  case VRESULT:
-    if (v.res.ok) fprintf(out, "Ok(%s)", v.res.text ? v.res.text : "");
-    else fprintf(out, "Err(%s)", v.res.error ? v.res.error : "");
-    break;
-  case VOPTIONAL:
-    if (v.opt.is_some && v.opt.inner) print_value(out, *v.opt.inner);
-    else fprintf(out, "Nothing");
-    break;
+  OracleStream *stream; // NULL once the slot is free
+  char *prompt;
+  size_t open_ip;
+  uint64_t started;
+} ExecStream;
+
+struct ExecStreams {
+  ExecStream *items;
+  size_t len;
+};
+
+static void stream_close(ExecStream *es){
+  oracle_stream_close(es->stream);
+  free(es->prompt);
+  memset(es, 0, sizeof(*es));
+}
+
+static void stream_open(ExecFrame *fr, size_t ip, const IrInstr *ins){
+  LiminalContext *ctx = fr->ctx;
+  if (!ctx->streams) ctx->streams = calloc(1, sizeof(struct ExecStreams));
+  struct ExecStreams *ss = ctx->streams;
+  size_t h = 0;
+  while (h < ss->len && ss->items[h].stream) h++;
+  if (h == ss->len) {
+    ss->items = realloc(ss->items, ++ss->len * sizeof(ExecStream));
+    memset(&ss->items[h], 0, sizeof(ExecStream));
   }
+  Value pv = fr->temps[ins->arg1];
+  ExecStream *es = &ss->items[h];
+  es->prompt = strdup(pv.kind==VSTRING && pv.s ? pv.s : "");
+  es->open_ip = ip;
+  es->started = ctx->profiler || ctx->tracer ? profiler_now_ns() : 0;
+  es->stream = oracle_stream_open(ctx->oracle, es->prompt);
+  v_free(ctx, fr->temps[ins->dest]);
+  fr->temps[ins->dest] = v_int((int)h);
 }
 
-static int is_number(const char *s){ if(!s||!*s) return 0; size_t i=0; if(s[0]=='-'||s[0]=='+') i++; int hasdigit=0; for(;s[i];i++){ if(s[i]>='0'&&s[i]<='9'){hasdigit=1;continue;} if(s[i]=='.') continue; return 0;} return hasdigit; }
-static int is_integer(const char *s){ if(!s||!*s) return 0; size_t i=0; if(s[0]=='-'||s[0]=='+') i++; int hasdigit=0; for(;s[i];i++){ if(s[i]>='0'&&s[i]<='9'){hasdigit=1;continue;} return 0;} return hasdigit; }
-static Value parse_value(const char *s){ if(is_integer(s)) return v_int(atoi(s)); if(is_number(s)) return v_real(strtod(s,NULL)); return v_string(s); }
-
-typedef struct { char *name; Value val; } Var;
-typedef struct Env Env;
-typedef struct Env { Var *items; size_t len; size_t cap; Env *parent; char **refs; size_t refs_len; size_t refs_cap; } Env;
-static char *env_intern_ref(Env *env, const char *s){
-  if (!env || !s) return NULL;
-  for(size_t i=0;i<env->refs_len;i++) if (strcmp(env->refs[i], s)==0) return env->refs[i];
-  if (env->refs_len==env->refs_cap){ env->refs_cap = env->refs_cap? env->refs_cap*2:8; env->refs=realloc(env->refs, env->refs_cap*sizeof(char*)); }
-  char *dup = strdup(s); _allocs++; env->refs[env->refs_len++] = dup; return dup;
-}
-static Value* env_find(Env *env, const char *name){ for(size_t i=0;i<env->len;i++){ if(strcmp(env->items[i].name,name)==0) return &env->items[i].val;} return NULL; }
-static void env_set_raw(Env *env, const char *name, Value vc){
-  for(size_t i=0;i<env->len;i++){ if(strcmp(env->items[i].name,name)==0){ v_free(env->items[i].val); env->items[i].val=vc; return; }}
-  if(env->len==env->cap){ env->cap=env->cap?env->cap*2:8; env->items=realloc(env->items, env->cap*sizeof(Var)); }
-  env->items[env->len].name=strdup(name); env->items[env->len].val=vc; env->len++;
-}
-static void env_ensure_base_ref(Env *env, const char *name){
-  const char *dot = strchr(name, '.');
-  if (!dot) return;
-  char base[128]; size_t blen = (size_t)(dot - name); if (blen >= sizeof(base)) blen = sizeof(base)-1; strncpy(base, name, blen); base[blen]=0;
-  Value *bv = env_find(env, base);
-  if (!bv) {
-    Value v = v_int(0);
-    v.ref = env_intern_ref(env, base);
-    v.ref_interned = 1;
-    env_set_raw(env, base, v);
-  } else if (!bv->ref) {
-    bv->ref = env_intern_ref(env, base);
-    bv->ref_interned = 1;
-  }
-}
-static void env_set(Env *env, const char *name, Value v){
-  if (debug_exec()) fprintf(stderr,"[env_set] %s kind=%d i=%d ref=%s\n", name, v.kind, v.i, v.ref?v.ref:"<null>");
-  Value vc = v_copy(v);
-  if (v.kind==VSTRING && vc.s && !vc.owns) { vc.s = strdup(vc.s); vc.owns=1; _allocs++; }
-  if (vc.ref && strchr(vc.ref, '.')) {
-    if (!vc.ref_interned) { free(vc.ref); _frees++; }
-    vc.ref = env_intern_ref(env, v.ref);
-    vc.ref_interned = 1;
-  }
-  env_ensure_base_ref(env, name);
-  env_set_raw(env, name, vc);
-}
-static Value env_get_local(Env *env, const char *name){ Value *v = env_find(env,name); if (debug_exec()) fprintf(stderr,"[env_get_local] %s -> %s%s\n", name, v?"hit":"miss", v?"":""); if (v && debug_exec()) fprintf(stderr,"  val kind=%d i=%d ref=%s\n", v->kind, v->i, v->ref?v->ref:"<null>"); if (!v) return v_int(0); return v_copy(*v); }
-static Value env_get(Env *env, const char *name){
-  Value *vloc = env_find(env, name);
-  if (vloc) return v_copy(*vloc);
-  const char *dot = strchr(name, '.');
-  if (dot) {
-    // base name before dot
-    char base[128]; size_t blen = (size_t)(dot - name); if (blen >= sizeof(base)) blen = sizeof(base)-1; strncpy(base, name, blen); base[blen]=0;
-    Value basev = env_get_local(env, base);
-    if (debug_exec()) fprintf(stderr,"[env_get] base=%s ref=%s\n", base, basev.ref?basev.ref:"<null>");
-    if (basev.ref) {
-      char buf[256]; snprintf(buf,sizeof(buf),"%s%s", basev.ref, dot);
-      Value lv2 = env_get_local(env, buf);
-      if (!(lv2.kind==VINT && lv2.i==0)) { v_free(basev); return lv2; }
-      v_free(lv2);
-      if (env->parent) {
-        Value pv2 = env_get(env->parent, buf);
-        if (!(pv2.kind==VINT && pv2.i==0)) { v_free(basev); return pv2; }
-        v_free(pv2);
-      }
-    }
-    v_free(basev);
-  }
-  if (env->parent) {
-    Value pv = env_get(env->parent, name);
-    if (env_find(env->parent, name)) return pv;
-    v_free(pv);
-    if (dot) {
-      char base[128]; size_t blen = (size_t)(dot - name); if (blen >= sizeof(base)) blen = sizeof(base)-1; strncpy(base, name, blen); base[blen]=0;
-      Value basev = env_get_local(env, base);
-      if (basev.ref) {
-        char buf[256]; snprintf(buf,sizeof(buf),"%s%s", basev.ref, dot);
-        Value pv2 = env_get(env->parent, buf);
-        if (env_find(env->parent, buf)) { v_free(basev); return pv2; }
-        v_free(pv2);
+// The body's output so far is flushed before waiting, so each chunk shows as
+// soon as it has been handled. Waits are charged to the oracle; the stream
+// counts as one call and traces as one ask from open to end.
+static void stream_next(ExecFrame *fr, const IrInstr *ins){
+  LiminalContext *ctx = fr->ctx;
+  Value hv = fr->temps[ins->arg1];
+  ExecStream *es = ctx->streams && hv.kind==VINT && hv.i >= 0 && (size_t)hv.i < ctx->streams->len ? &ctx->streams->items[hv.i] : NULL;
+  Value *dest = &fr->temps[ins->dest];
+  v_free(ctx, *dest);
+  if (!es || !es->stream) { *dest = v_result_err(ctx, "stream closed"); return; }
+  liminal_context_flush(ctx);
+  uint64_t waited = ctx->profiler ? profiler_now_ns() : 0;
+  char *chunk;
+  size_t len;
+  int got = oracle_stream_next(es->stream, &chunk, &len);
+  if (got) {
+    if (ctx->profiler) profiler_oracle_wait(ctx->profiler, waited);
+    *dest = v_result_ok(ctx, chunk);
+    free(chunk);
+    return;
+  }
+  const OracleResult *r = oracle_stream_result(es->stream);
+  if (ctx->profiler) { profiler_oracle_wait(ctx->profiler, waited); profiler_oracle(ctx->profiler, profiler_now_ns()); }
+  if (ctx->tracer) trace_ask(fr, es->open_ip, es->prompt, r, es->started);
+  if (ctx->debug_exec && !r->ok) fprintf(stderr, "[exec] stream failed: %s\n", r->error ? r->error : "oracle error");
+  *dest = v_result_err(ctx, r->ok ? "end of stream" : r->error ? r->error : "oracle error");
+  stream_close(es);
+}
+
+// Answer of an ask (ASK or ASK_START instruction) into dest: checked against
+// the ask's schema, or replaced by its fallback when the oracle failed
+static void ask_answer(ExecFrame *fr, const IrInstr *ask, Value *dest, OracleResult r){
+  LiminalContext *ctx = fr->ctx;
+  v_free(ctx, *dest);
+  if (r.ok) {
+    if (ask->s2) {
+      Type *schema = find_schema(fr->prog, ask->s2);
+      char *errmsg=NULL;
+      int valid = schema ? validate_json_against_schema(r.text ? r.text : "", schema, &errmsg) : 0;
+      if (ctx->debug_exec) {
+        fprintf(stderr, "[exec] ask schema=%s found=%s valid=%d err=%s (schemas len=%zu)\n", ask->s2, schema?"yes":"no", valid, errmsg?errmsg:"(null)", fr->prog->schemas.len);
+        for (size_t ii=0; ii<fr->prog->schemas.len; ++ii) {
+          fprintf(stderr, "[exec] schema[%zu]=%s\n", ii, fr->prog->schemas.items[ii]->as.schema.name ? fr->prog->schemas.items[ii]->as.schema.name : "(null)");
+        }
       }
-      v_free(basev);
-      for(size_t i=0;i<env->parent->len;i++){
-        const char *pname = env->parent->items[i].name;
-        const char *pdot = strchr(pname, '.');
-        if (!pdot) continue;
-        if (strcmp(pdot, dot)==0) return v_copy(env->parent->items[i].val);
+      if (schema && valid) {
+        *dest = v_result_ok(ctx, r.text ? r.text : "");
+      } else {
+        *dest = v_result_err(ctx, errmsg ? errmsg : (schema?"extraction failed":"schema not found"));
       }
+      free(errmsg);
+    } else {
+      *dest = v_result_ok(ctx, r.text ? r.text : "");
+    }
+  } else {
+    if (ask->arg2 >= 0) {
+      Value fb = fr->temps[ask->arg2];
+      if (fb.kind == VSTRING) *dest = v_result_ok(ctx, fb.s ? fb.s : "");
+      else if (fb.kind == VRESULT && fb.res.ok) *dest = v_result_ok(ctx, fb.res.text ? fb.res.text : "");
+      else *dest = v_result_ok(ctx, "");
+    } else {
+      *dest = v_result_err(ctx, r.error ? r.error : "oracle error");
     }
   }
-  // also suffix fallback in local env
-  if (dot) {
-    for(size_t i=0;i<env->len;i++){
-      const char *pname = env->items[i].name;
-      const char *pdot = strchr(pname, '.');
-      if (!pdot) continue;
-      if (strcmp(pdot, dot)==0) { Value rv=v_copy(env->items[i].val); if (debug_exec()) fprintf(stderr,"[env_get suffix local] %s -> %s\n", name, pname); return rv; }
+  oracle_result_free(r);
+}
+
+// Asks in flight between ASK_START and AWAIT; a handle is an index into items
+typedef struct {
+  OracleCall *call; // NULL once the slot is free
+  char *prompt;
+  size_t start_ip;
+  uint64_t started;
+} ExecAsk;
+
+struct ExecAsks {
+  ExecAsk *items;
+  size_t len;
+};
+
+static void ask_start(ExecFrame *fr, size_t ip, const IrInstr *ins){
+  LiminalContext *ctx = fr->ctx;
+  if (!ctx->asks) ctx->asks = calloc(1, sizeof(struct ExecAsks));
+  struct ExecAsks *as = ctx->asks;
+  size_t h = 0;
+  while (h < as->len && as->items[h].call) h++;
+  if (h == as->len) {
+    as->items = realloc(as->items, ++as->len * sizeof(ExecAsk));
+    memset(&as->items[h], 0, sizeof(ExecAsk));
+  }
+  Value pv = fr->temps[ins->arg1];
+  ExecAsk *ea = &as->items[h];
+  ea->prompt = strdup(pv.kind==VSTRING && pv.s ? pv.s : "");
+  ea->start_ip = ip;
+  ea->started = ctx->tracer ? profiler_now_ns() : 0;
+  ea->call = oracle_call_start(ctx->oracle, ea->prompt);
+  v_free(ctx, fr->temps[ins->dest]);
+  fr->temps[ins->dest] = v_int((int)h);
+}
+
+// Like stream_next, flushes the output so far before it blocks. Only the
+// time spent blocked is charged to the oracle; the tracer shows the ask
+// from start to answer.
+static void ask_await(ExecFrame *fr, const IrInstr *ins){
+  LiminalContext *ctx = fr->ctx;
+  Value hv = fr->temps[ins->arg1];
+  ExecAsk *ea = ctx->asks && hv.kind==VINT && hv.i >= 0 && (size_t)hv.i < ctx->asks->len ? &ctx->asks->items[hv.i] : NULL;
+  Value *dest = &fr->temps[ins->dest];
+  if (!ea || !ea->call) { v_free(ctx, *dest); *dest = v_result_err(ctx, "ask not started"); return; }
+  liminal_context_flush(ctx);
+  uint64_t waited = ctx->profiler ? profiler_now_ns() : 0;
+  OracleResult r = oracle_call_wait(ea->call);
+  if (ctx->profiler) profiler_oracle(ctx->profiler, waited);
+  if (ctx->tracer) trace_ask(fr, ea->start_ip, ea->prompt, &r, ea->started);
+  ask_answer(fr, &fr->f->instrs.items[ea->start_ip], dest, r);
+  free(ea->prompt);
+  memset(ea, 0, sizeof(*ea));
+}
+
+// Executes instruction ip of the frame's function; returns the next ip, or -1
+// after RET.
+static long step_generic(ExecFrame *fr, size_t ip){
+  LiminalContext *ctx = fr->ctx; const IrProgram *prog = fr->prog; Env *env = fr->env; Value *temps = fr->temps;
+  const IrInstr *ins = &fr->f->instrs.items[ip];
+  switch(ins->op){
+  case IR_CONST_INT: v_free(ctx, temps[ins->dest]); temps[ins->dest]=v_int(ins->arg1); break;
+  case IR_CONST_BOOL: v_free(ctx, temps[ins->dest]); temps[ins->dest]=v_bool(ins->arg1); break;
+  case IR_CONST_REAL: v_free(ctx, temps[ins->dest]); temps[ins->dest]=v_real(ins->f); break;
+  case IR_CONST_STRING: v_free(ctx, temps[ins->dest]); temps[ins->dest]=v_string(ctx, ins->s?ins->s:""); break;
+  case IR_CONST_OPTIONAL_NONE: v_free(ctx, temps[ins->dest]); temps[ins->dest]=v_optional_none(); break;
+  case IR_LOAD_VAR: rt_load_var(ctx, env, &temps[ins->dest], ins->s); break;
+  case IR_STORE_VAR: env_set(ctx, env, ins->s, temps[ins->arg1]); break;
+  case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_MOD: rt_arith(ctx, ins->op, &temps[ins->dest], temps[ins->arg1], temps[ins->arg2]); break;
+  case IR_EQ: case IR_NEQ: case IR_LT: case IR_GT: case IR_LE: case IR_GE: {
+    int res = rt_compare(ins->op, temps[ins->arg1], temps[ins->arg2]);
+    v_free(ctx, temps[ins->dest]); temps[ins->dest]=v_bool(res); break; }
+  case IR_AND: case IR_OR: {
+    int ta = rt_truthy(temps[ins->arg1]), tb = rt_truthy(temps[ins->arg2]);
+    int res = (ins->op==IR_AND) ? (ta && tb) : (ta || tb);
+    v_free(ctx, temps[ins->dest]); temps[ins->dest]=v_bool(res); break; }
+  case IR_JUMP: {
+    long idx = find_label(fr->labels, fr->nlab, ins->s);
+    if(idx>=0) return idx;
+    break; }
+  case IR_JUMP_IF_FALSE:
+    if(!rt_truthy(temps[ins->arg1])){ long idx=find_label(fr->labels,fr->nlab,ins->s); if(idx>=0) return idx; }
+    break;
+  case IR_LABEL: break;
+  case IR_RET:
+    if (fr->ret_out) { v_free(ctx, fr->retval); fr->retval = v_copy(ctx, temps[ins->arg1]); fr->had_ret=1; }
+    return -1;
+  case IR_PRINT: print_value(ctx, temps[ins->arg1]); break;
+  case IR_PRINTLN: if(ins->arg1>=0) print_value(ctx, temps[ins->arg1]); liminal_context_write(ctx, "\n", 1); break;
+  case IR_READLN: rt_readln(ctx, env, ins->s); break;
+  case IR_READ_FILE: rt_read_file(ctx, &temps[ins->dest], temps[ins->arg1]); break;
+  case IR_WRITE_FILE: rt_write_file(temps[ins->arg1], temps[ins->arg2]); break;
+  case IR_ASK: {
+    Value pv = temps[ins->arg1];
+    const char *prompt = (pv.kind==VSTRING && pv.s)?pv.s:"";
+    uint64_t started = ctx->profiler || ctx->tracer ? profiler_now_ns() : 0;
+    OracleResult r = oracle_call_text(ctx->oracle, prompt);
+    if (ctx->profiler) profiler_oracle(ctx->profiler, started);
+    if (ctx->tracer) trace_ask(fr, ip, prompt, &r, started);
+    ask_answer(fr, ins, &temps[ins->dest], r);
+    break; }
+  case IR_ASK_START: ask_start(fr, ip, ins); break;
+  case IR_AWAIT: ask_await(fr, ins); break;
+  case IR_RESULT_UNWRAP: rt_result_unwrap(ctx, &temps[ins->dest], temps[ins->arg1], ins->arg2>=0 ? &temps[ins->arg2] : NULL); break;
+  case IR_RESULT_IS_OK: { int ok = rt_result_is_ok(temps[ins->arg1]); v_free(ctx, temps[ins->dest]); temps[ins->dest] = v_int(ok); break; }
+  case IR_RESULT_UNWRAP_ERR: rt_result_unwrap_err(ctx, &temps[ins->dest], temps[ins->arg1]); break;
+  case IR_MAKE_RESULT_OK: rt_make_result(ctx, &temps[ins->dest], temps[ins->arg1], 1); break;
+  case IR_MAKE_RESULT_ERR: rt_make_result(ctx, &temps[ins->dest], temps[ins->arg1], 0); break;
+  case IR_CONCAT: rt_concat(ctx, &temps[ins->dest], temps[ins->arg1], temps[ins->arg2]); break;
+  case IR_RESULT_OR_FALLBACK: rt_result_or_fallback(ctx, &temps[ins->dest], temps[ins->arg1], ins->arg2>=0 ? &temps[ins->arg2] : NULL); break;
+  case IR_CALL: {
+    const IrFunc *cf = find_func(prog, ins->s ? ins->s : "");
+    Value rv = v_int(0);
+    if (cf) {
+      Env newenv={0}; newenv.parent = env;
+      if (cf->param_count >0 && ins->arg1>=0) { env_set(ctx, &newenv, cf->params[0], temps[ins->arg1]); }
+      if (cf->param_count >1 && ins->arg2>=0) { env_set(ctx, &newenv, cf->params[1], temps[ins->arg2]); }
+      execute_func(ctx, prog, cf, &newenv, &rv);
+      env_free(ctx, &newenv);
     }
+    v_free(ctx, temps[ins->dest]);
+    temps[ins->dest] = v_copy(ctx, rv);
+    v_free(ctx, rv);
+    break; }
+  case IR_INDEX: rt_index(ctx, env, &temps[ins->dest], ins->s, temps[ins->arg2]); break;
+  case IR_STREAM_OPEN: stream_open(fr, ip, ins); break;
+  case IR_STREAM_NEXT: stream_next(fr, ins); break;
+  case IR_FORK: return run_parallel(fr, ip);
+  case IR_JOIN: break;
+  case IR_ARITH_CONST: rt_arith(ctx, ins->fused, &temps[ins->dest], temps[ins->arg1], v_int(ins->arg2)); break;
+  case IR_INC_VAR: case IR_ADD_STORE:
+    rt_arith(ctx, IR_ADD, &temps[ins->dest], temps[ins->arg1], ins->op==IR_INC_VAR ? v_int(ins->arg2) : temps[ins->arg2]);
+    env_set(ctx, env, ins->s, temps[ins->dest]); break;
+  case IR_CMP_BRANCH: case IR_CMP_CONST_BRANCH:
+    if(!rt_compare(ins->fused, temps[ins->arg1], ins->op==IR_CMP_CONST_BRANCH ? v_int(ins->arg2) : temps[ins->arg2])){ long idx=find_label(fr->labels,fr->nlab,ins->s); if(idx>=0) return idx; }
+    break;
+  default: break;
   }
-  if (debug_exec()) fprintf(stderr,"[env_get] %s -> miss\n", name);
-  return v_int(0);
+  return (long)ip + 1;
 }
-static void env_free(Env *env){ if (debug_exec()) fprintf(stderr,"[env_free] len=%zu\n", env->len); for(size_t i=0;i<env->len;i++){ if (debug_exec()) fprintf(stderr,"[env_free] %s\n", env->items[i].name); free(env->items[i].name); v_free(env->items[i].val);} free(env->items); for(size_t i=0;i<env->refs_len;i++){ free(env->refs[i]); _frees++; } free(env->refs); }
 
-typedef struct { char *name; size_t idx; } Label;
+// Quickening. Per run, every instruction has a dispatch byte that starts as
+// its own opcode. The first time it runs, it rewrites the byte into a variant
+// specialized for the operand kinds it sees (values from ReadLn or an oracle
+// have no static kind), and variable accesses and jumps cache their env slot
+// or target in aux. A variant re-checks its guard on every execution; a miss
+// deoptimizes it back to the generic opcode, which may quicken again until
+// it has missed QUICK_MAX_MISSES times.
+enum {
+  Q_LOAD_SCALAR = 128, // LOAD_VAR of an Integer/Boolean/Real local at slot aux
+  Q_STORE_SLOT,        // STORE_VAR to the local at slot aux
+  Q_ARITH_INT,         // Integer operands
+  Q_ARITH_REAL,        // Integer/Real operands, at least one Real
+  Q_CMP_INT,           // Integer/Boolean operands
+  Q_JUMP,              // JUMP to aux
+  Q_JIF_INT,           // JUMP_IF_FALSE on an Integer/Boolean, target aux
+  Q_CMP_BRANCH_INT,    // CMP_BRANCH/CMP_CONST_BRANCH on Integers/Booleans, target aux
+  Q_ARITH_CONST_INT,   // ARITH_CONST on an Integer
+  Q_ADD_STORE_INT,     // INC_VAR/ADD_STORE on Integers, local at slot aux
+  Q_PRINT_INT,         // PRINT/PRINTLN of an Integer
+  Q_PRINT_STRING       // PRINT/PRINTLN of a String
+};
+#define QUICK_MAX_MISSES 4
+#define QUICK_MISS (-2)
 
-static long find_label(Label *labels, size_t n, const char *name){ for(size_t i=0;i<n;i++) if(strcmp(labels[i].name,name)==0) return (long)labels[i].idx; return -1; }
+typedef struct QuickFunc {
+  unsigned char *ops;
+  unsigned char *misses;
+  long *aux;
+} QuickFunc;
 
-static Type *find_schema(const IrProgram *prog, const char *name) {
-  for (size_t i=0;i<prog->schemas.len;++i) {
-    if (prog->schemas.items[i]->as.schema.name && strcmp(prog->schemas.items[i]->as.schema.name, name)==0)
-      return prog->schemas.items[i];
+typedef struct QuickState QuickState;
+struct QuickState {
+  const IrProgram *prog;
+  QuickFunc *funcs;
+};
+
+static QuickState *quick_state_new(const IrProgram *prog){
+  QuickState *qs = calloc(1, sizeof(QuickState));
+  qs->prog = prog;
+  qs->funcs = calloc(prog->funcs.len ? prog->funcs.len : 1, sizeof(QuickFunc));
+  return qs;
+}
+
+static void quick_state_free(QuickState *qs){
+  if (!qs) return;
+  for (size_t i=0;i<qs->prog->funcs.len;++i) { free(qs->funcs[i].ops); free(qs->funcs[i].misses); free(qs->funcs[i].aux); }
+  free(qs->funcs);
+  free(qs);
+}
+
+// The function's tables, created on its first call in this run
+static QuickFunc *quick_func(QuickState *qs, const IrFunc *f){
+  const IrFunc *base = qs->prog->funcs.items;
+  if (f < base || f >= base + qs->prog->funcs.len) return NULL;
+  QuickFunc *q = &qs->funcs[f - base];
+  if (!q->ops) {
+    size_t n = f->instrs.len ? f->instrs.len : 1;
+    q->ops = malloc(n); q->misses = calloc(n, 1); q->aux = malloc(n * sizeof(long));
+    for (size_t i=0;i<f->instrs.len;++i) { q->ops[i] = (unsigned char)f->instrs.items[i].op; q->aux[i] = -1; }
   }
-  return NULL;
+  return q;
 }
 
-static int validate_json_against_schema(const char *json, Type *schema, char **errmsg);
+static int intlike(Value v){ return v.kind==VINT || v.kind==VBOOL; }
+static int scalar(Value v){ return v.kind==VINT || v.kind==VBOOL || v.kind==VREAL; }
 
-static const IrFunc *find_func(const IrProgram *prog, const char *name) {
-  for (size_t i=0;i<prog->funcs.len;++i) if (strcmp(prog->funcs.items[i].name,name)==0) return &prog->funcs.items[i];
+// The local `name` at slot aux; slots are shared by every activation of the
+// function, so a stale one is looked up again and the cache refilled
+static Var *cached_var(Env *env, const char *name, long *slot){
+  if (*slot >= 0 && (size_t)*slot < env->len && strcmp(env->items[*slot].name, name) == 0) return &env->items[*slot];
+  for (size_t i=0;i<env->len;++i) if (strcmp(env->items[i].name, name) == 0) { *slot = (long)i; return &env->items[i]; }
   return NULL;
 }
 
-static int execute_func(const IrProgram *prog, const IrFunc *f, Env *env, FILE *in, FILE *out, Oracle *oracle, Value *ret_out){
+// Picks a variant for instruction ip from the kinds it is about to see
+static void quicken(ExecFrame *fr, QuickFunc *q, size_t ip){
+  const IrInstr *ins = &fr->f->instrs.items[ip];
+  Value *temps = fr->temps;
+  int op = -1;
+  switch (ins->op) {
+  case IR_LOAD_VAR: {
+    Var *var = cached_var(fr->env, ins->s, &q->aux[ip]);
+    if (var && scalar(var->val)) op = Q_LOAD_SCALAR;
+    break; }
+  case IR_STORE_VAR:
+    if (!strchr(ins->s, '.') && cached_var(fr->env, ins->s, &q->aux[ip])) op = Q_STORE_SLOT;
+    break;
+  case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_MOD: {
+    Value a = temps[ins->arg1], b = temps[ins->arg2];
+    if (a.kind==VINT && b.kind==VINT) op = Q_ARITH_INT;
+    else if ((a.kind==VINT || a.kind==VREAL) && (b.kind==VINT || b.kind==VREAL)) op = Q_ARITH_REAL;
+    break; }
+  case IR_EQ: case IR_NEQ: case IR_LT: case IR_GT: case IR_LE: case IR_GE:
+    if (intlike(temps[ins->arg1]) && intlike(temps[ins->arg2])) op = Q_CMP_INT;
+    break;
+  case IR_JUMP:
+    if ((q->aux[ip] = find_label(fr->labels, fr->nlab, ins->s)) >= 0) op = Q_JUMP;
+    break;
+  case IR_JUMP_IF_FALSE:
+    if (intlike(temps[ins->arg1]) && (q->aux[ip] = find_label(fr->labels, fr->nlab, ins->s)) >= 0) op = Q_JIF_INT;
+    break;
+  case IR_CMP_BRANCH: case IR_CMP_CONST_BRANCH:
+    if (intlike(temps[ins->arg1]) && (ins->op==IR_CMP_CONST_BRANCH || intlike(temps[ins->arg2])) &&
+        (q->aux[ip] = find_label(fr->labels, fr->nlab, ins->s)) >= 0) op = Q_CMP_BRANCH_INT;
+    break;
+  case IR_ARITH_CONST:
+    if (temps[ins->arg1].kind==VINT) op = Q_ARITH_CONST_INT;
+    break;
+  case IR_INC_VAR: case IR_ADD_STORE:
+    if (temps[ins->arg1].kind==VINT && (ins->op==IR_INC_VAR || temps[ins->arg2].kind==VINT) &&
+        !strchr(ins->s, '.') && cached_var(fr->env, ins->s, &q->aux[ip])) op = Q_ADD_STORE_INT;
+    break;
+  case IR_PRINT: case IR_PRINTLN:
+    if (ins->arg1 >= 0 && temps[ins->arg1].kind==VINT) op = Q_PRINT_INT;
+    else if (ins->arg1 >= 0 && temps[ins->arg1].kind==VSTRING) op = Q_PRINT_STRING;
+    break;
+  default:
+    // Nothing to specialize
+    q->misses[ip] = QUICK_MAX_MISSES;
+    return;
+  }
+  if (op < 0) { q->misses[ip]++; return; }
+  q->ops[ip] = (unsigned char)op;
+  fr->ctx->quickened++;
+}
+
+// Runs instruction ip's quickened variant; QUICK_MISS sends it to the
+// generic implementation (a guard failed, or there is no variant)
+static long step_quick(ExecFrame *fr, QuickFunc *q, size_t ip){
+  if (q->ops[ip] < Q_LOAD_SCALAR) {
+    if (q->misses[ip] >= QUICK_MAX_MISSES) return QUICK_MISS;
+    quicken(fr, q, ip);
+    if (q->ops[ip] < Q_LOAD_SCALAR) return QUICK_MISS;
+  }
+  LiminalContext *ctx = fr->ctx; Value *temps = fr->temps;
+  const IrInstr *ins = &fr->f->instrs.items[ip];
+  switch (q->ops[ip]) {
+  case Q_LOAD_SCALAR: {
+    Var *var = cached_var(fr->env, ins->s, &q->aux[ip]);
+    if (!var || !scalar(var->val)) break;
+    // rt_load_var's result, with the ref borrowed from the instruction
+    Value v = var->val.kind==VINT ? v_int(var->val.i) : var->val.kind==VBOOL ? v_bool(var->val.i) : v_real(var->val.f);
+    v.ref = ins->s; v.ref_interned = 1;
+    v_free(ctx, temps[ins->dest]); temps[ins->dest] = v;
+    return (long)ip + 1; }
+  case Q_STORE_SLOT:
+    if (!cached_var(fr->env, ins->s, &q->aux[ip])) break;
+    rt_store_var(ctx, fr->env, ins->s, &q->aux[ip], temps[ins->arg1]);
+    return (long)ip + 1;
+  case Q_ARITH_INT: {
+    Value a = temps[ins->arg1], b = temps[ins->arg2];
+    if (a.kind!=VINT || b.kind!=VINT) break;
+    int r = rt_int_arith(ins->op, a.i, b.i);
+    v_free(ctx, temps[ins->dest]); temps[ins->dest] = v_int(r);
+    return (long)ip + 1; }
+  case Q_ARITH_REAL: {
+    Value a = temps[ins->arg1], b = temps[ins->arg2];
+    if (!((a.kind==VREAL && (b.kind==VINT || b.kind==VREAL)) || (b.kind==VREAL && a.kind==VINT))) break;
+    double r = rt_num_arith(ins->op, a.kind==VREAL ? a.f : a.i, b.kind==VREAL ? b.f : b.i);
+    v_free(ctx, temps[ins->dest]); temps[ins->dest] = v_real(r);
+    return (long)ip + 1; }
+  case Q_CMP_INT: {
+    Value a = temps[ins->arg1], b = temps[ins->arg2];
+    if (!intlike(a) || !intlike(b)) break;
+    int res = rt_int_compare(ins->op, a.i, b.i);
+    v_free(ctx, temps[ins->dest]); temps[ins->dest] = v_bool(res);
+    return (long)ip + 1; }
+  case Q_JUMP:
+    return q->aux[ip];
+  case Q_JIF_INT: {
+    Value c = temps[ins->arg1];
+    if (!intlike(c)) break;
+    return c.i ? (long)ip + 1 : q->aux[ip]; }
+  case Q_CMP_BRANCH_INT: {
+    Value a = temps[ins->arg1];
+    Value b = ins->op==IR_CMP_CONST_BRANCH ? v_int(ins->arg2) : temps[ins->arg2];
+    if (!intlike(a) || !intlike(b)) break;
+    return rt_int_compare(ins->fused, a.i, b.i) ? (long)ip + 1 : q->aux[ip]; }
+  case Q_ARITH_CONST_INT: {
+    Value a = temps[ins->arg1];
+    if (a.kind!=VINT) break;
+    int r = rt_int_arith(ins->fused, a.i, ins->arg2);
+    v_free(ctx, temps[ins->dest]); temps[ins->dest] = v_int(r);
+    return (long)ip + 1; }
+  case Q_ADD_STORE_INT: {
+    Value a = temps[ins->arg1];
+    Value b = ins->op==IR_INC_VAR ? v_int(ins->arg2) : temps[ins->arg2];
+    Var *var = cached_var(fr->env, ins->s, &q->aux[ip]);
+    if (a.kind!=VINT || b.kind!=VINT || !var) break;
+    int r = rt_int_arith(IR_ADD, a.i, b.i);
+    v_free(ctx, temps[ins->dest]); temps[ins->dest] = v_int(r);
+    // What env_set stores for a ref-less Integer
+    v_free(ctx, var->val); var->val = v_int(r);
+    return (long)ip + 1; }
+  case Q_PRINT_INT: case Q_PRINT_STRING: {
+    Value v = temps[ins->arg1];
+    if (v.kind != (q->ops[ip]==Q_PRINT_INT ? VINT : VSTRING)) break;
+    if (v.kind==VINT) { char buf[16]; int n = snprintf(buf, sizeof(buf), "%d", v.i); liminal_context_write(ctx, buf, (size_t)n); }
+    else if (v.s) liminal_context_write(ctx, v.s, strlen(v.s));
+    if (ins->op==IR_PRINTLN) liminal_context_write(ctx, "\n", 1);
+    return (long)ip + 1; }
+  default: return QUICK_MISS;
+  }
+  // Guard miss: deoptimize
+  q->ops[ip] = (unsigned char)ins->op;
+  q->misses[ip]++;
+  ctx->deopts++;
+  return QUICK_MISS;
+}
+
+// Shared by the interpreter loop and JIT fallback stubs
+static long step(ExecFrame *fr, size_t ip){
+  if (fr->quick) { long next = step_quick(fr, fr->quick, ip); if (next != QUICK_MISS) return next; }
+  return step_generic(fr, ip);
+}
+
+long exec_step(ExecFrame *fr, size_t ip){ return step(fr, ip); }
+
+// Lowered code awaits every ask it starts; this only drops the table
+static void asks_close_all(LiminalContext *ctx){
+  if (!ctx->asks) return;
+  for (size_t i=0;i<ctx->asks->len;++i) if (ctx->asks->items[i].call) { oracle_result_free(oracle_call_wait(ctx->asks->items[i].call)); free(ctx->asks->items[i].prompt); }
+  free(ctx->asks->items);
+  free(ctx->asks);
+  ctx->asks = NULL;
+}
+
+static void streams_close_all(LiminalContext *ctx){
+  if (!ctx->streams) return;
+  for (size_t i=0;i<ctx->streams->len;++i) if (ctx->streams->items[i].stream) stream_close(&ctx->streams->items[i]);
+  free(ctx->streams->items);
+  free(ctx->streams);
+  ctx->streams = NULL;
+}
+
+// `parallel` blocks. A task runs one statement of the block, from its FORK to
+// its end label, in a frame of its own: fresh temps, an env whose parent is
+// the block's, so it reads the variables around it while its writes stay
+// its own, and a context of its own that buffers its output and counts its
+// allocations. Tasks share only the program, the oracle (safe by contract)
+// and the block's env, which nothing writes before the join. The join then
+// goes through the tasks in source order, storing each one's writes and
+// appending its output, so the outcome does not depend on which task
+// finished first and a later statement's write wins. Tasks run without
+// quickening, JIT or profilers; their time is the FORK's.
+typedef struct {
+  ExecFrame *parent;
+  size_t start;          // first instruction
+  size_t end;            // the task's end label
+  LiminalContext ctx;
+  Env env;
+} ExecTask;
+
+// Only what a task needs; nested blocks run their tasks in turn
+static void task_context(LiminalContext *tc, const LiminalContext *ctx){
+  memset(tc, 0, sizeof(*tc));
+  tc->debug_exec = ctx->debug_exec;
+  tc->debug_ir = ctx->debug_ir;
+  tc->debug_ir_log = ctx->debug_ir_log;
+  tc->debug_ir_call = ctx->debug_ir_call;
+  tc->debug_tc = ctx->debug_tc;
+  tc->debug_parser = ctx->debug_parser;
+  tc->in = ctx->in;
+  tc->oracle = ctx->oracle;
+}
+
+static void run_task(void *arg, size_t i){
+  ExecTask *t = &((ExecTask *)arg)[i];
+  const IrFunc *f = t->parent->f;
+  size_t maxt = f->next_temp + 16; Value *temps = calloc(maxt, sizeof(Value));
+  for(size_t k=0;k<maxt;k++) temps[k]=v_int(0);
+  ExecFrame fr = { &t->ctx, t->parent->prog, f, &t->env, temps, NULL, v_int(0), 0, t->parent->labels, t->parent->nlab, NULL };
+  size_t ip = t->start;
+  while (ip < t->end) {
+    long next = step(&fr, ip);
+    if (next < 0) break;
+    ip = (size_t)next;
+  }
+  for(size_t k=0;k<maxt;k++) v_free(&t->ctx, temps[k]);
+  free(temps);
+  streams_close_all(&t->ctx);
+  asks_close_all(&t->ctx);
+}
+
+// Runs the block whose first FORK is at ip; returns its JOIN
+static long run_parallel(ExecFrame *fr, size_t ip){
+  LiminalContext *ctx = fr->ctx;
+  const IrFunc *f = fr->f;
+  long join = ir_fork_join(f, ip);
+  if (join < 0) return (long)ip + 1; // not a well-formed block: run it in place
+  size_t n = 0;
+  for (size_t at = ip; at < (size_t)join; at = (size_t)find_label(fr->labels, fr->nlab, f->instrs.items[at].s) + 1) n++;
+  ExecTask *tasks = calloc(n, sizeof(ExecTask));
+  size_t at = ip;
+  for (size_t k=0;k<n;++k) {
+    tasks[k].parent = fr;
+    tasks[k].start = at + 1;
+    tasks[k].end = (size_t)find_label(fr->labels, fr->nlab, f->instrs.items[at].s);
+    task_context(&tasks[k].ctx, ctx);
+    tasks[k].env.parent = fr->env;
+    at = tasks[k].end + 1;
+  }
+  if (!ctx->workers && n > 1 && ctx->parallel_workers > 1) ctx->workers = worker_pool_new((size_t)ctx->parallel_workers);
+  if (ctx->workers && n > 1) worker_pool_run(ctx->workers, run_task, tasks, n);
+  else for (size_t k=0;k<n;++k) run_task(tasks, k);
+  for (size_t k=0;k<n;++k) {
+    ExecTask *t = &tasks[k];
+    for (size_t v=0;v<t->env.len;++v) env_set(ctx, fr->env, t->env.items[v].name, t->env.items[v].val);
+    env_free(&t->ctx, &t->env);
+    if (t->ctx.outbuf_len) liminal_context_write(ctx, t->ctx.outbuf, t->ctx.outbuf_len);
+    free(t->ctx.outbuf);
+    ctx->allocs += t->ctx.allocs;
+    ctx->frees += t->ctx.frees;
+  }
+  free(tasks);
+  return join;
+}
+
+// Labels and fresh temps for a run of f
+static void frame_open(ExecFrame *fr, LiminalContext *ctx, const IrProgram *prog, const IrFunc *f, Env *env, Value *ret_out, QuickFunc *quick){
   // collect labels
   Label *labels=NULL; size_t nlab=0, clab=0;
   for(size_t i=0;i<f->instrs.len;i++) if(f->instrs.items[i].op==IR_LABEL){ if(nlab==clab){ clab=clab?clab*2:8; labels=realloc(labels, clab*sizeof(Label)); } labels[nlab].name=f->instrs.items[i].s; labels[nlab].idx=i; nlab++; }
   // temps
   size_t maxt= f->next_temp + 16; Value *temps = calloc(maxt, sizeof(Value));
   for(size_t i=0;i<maxt;i++) temps[i]=v_int(0);
-  int had_ret=0; Value retval=v_int(0);
+  ExecFrame init = { ctx, prog, f, env, temps, ret_out, v_int(0), 0, labels, nlab, quick };
+  *fr = init;
+}
+
+static void frame_close(ExecFrame *fr){
+  size_t maxt = fr->f->next_temp + 16;
+  for(size_t i=0;i<maxt;i++) v_free(fr->ctx, fr->temps[i]);
+  free(fr->temps);
+  free(fr->labels);
+  fr->temps = NULL;
+  fr->labels = NULL;
+}
+
+static int execute_func(LiminalContext *ctx, const IrProgram *prog, const IrFunc *f, Env *env, Value *ret_out){
+  ExecFrame fr;
+  frame_open(&fr, ctx, prog, f, env, ret_out, ctx->quick_state ? quick_func(ctx->quick_state, f) : NULL);
+  JitState *jit = ctx->jit_state;
+  PgoProfile *pgo = ctx->pgo;
+  if (pgo) pgo_enter(pgo, f);
+  Profiler *prof = ctx->profiler;
+  if (prof) profiler_enter(prof, f);
+  Sampler *smp = ctx->sampler;
+  if (smp) sampler_enter(smp, f);
+  Tracer *tr = ctx->tracer;
+  if (tr) tracer_enter(tr, f);
+  // Calls and loop back-edges feed the JIT's hotness counters; once the
+  // function is compiled it runs natively from here to the end
+  if (jit && jit_enter(jit, &fr, 0, 1)) goto done;
   size_t ip=0;
   while(ip < f->instrs.len){
-    const IrInstr *ins = &f->instrs.items[ip];
-    switch(ins->op){
-    case IR_CONST_INT: v_free(temps[ins->dest]); temps[ins->dest]=v_int(ins->arg1); break;
-    case IR_CONST_BOOL: v_free(temps[ins->dest]); temps[ins->dest]=v_bool(ins->arg1); break;
-    case IR_CONST_REAL: v_free(temps[ins->dest]); temps[ins->dest]=v_real(ins->f); break;
-    case IR_CONST_STRING: v_free(temps[ins->dest]); temps[ins->dest]=v_string(ins->s?ins->s:""); break;
-    case IR_CONST_OPTIONAL_NONE: v_free(temps[ins->dest]); temps[ins->dest]=v_optional_none(); break;
-    case IR_LOAD_VAR: v_free(temps[ins->dest]); temps[ins->dest]=env_get(env, ins->s); if (temps[ins->dest].ref) { free(temps[ins->dest].ref); _frees++; } temps[ins->dest].ref=strdup(ins->s); temps[ins->dest].ref_interned=0; _allocs++; break;
-    case IR_STORE_VAR: env_set(env, ins->s, temps[ins->arg1]); break;
-    case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_MOD: {
-      Value a=temps[ins->arg1], b=temps[ins->arg2];
-      if (ins->op==IR_ADD && (a.kind==VSTRING || b.kind==VSTRING)) {
-        char buf_a[64], buf_b[64];
-        const char *sa = (a.kind==VSTRING)? (a.s?a.s:"") : (snprintf(buf_a,sizeof(buf_a),"%g", (a.kind==VREAL)?a.f:(double)a.i), buf_a);
-        const char *sb = (b.kind==VSTRING)? (b.s?b.s:"") : (snprintf(buf_b,sizeof(buf_b),"%g", (b.kind==VREAL)?b.f:(double)b.i), buf_b);
-        size_t lena=strlen(sa), lenb=strlen(sb);
-        char *res=malloc(lena+lenb+1); memcpy(res, sa, lena); memcpy(res+lena, sb, lenb); res[lena+lenb]='\0';
-        v_free(temps[ins->dest]); temps[ins->dest]=v_string(res); free(res);
-        break;
-      }
-      double da=(a.kind==VREAL)?a.f:a.i; double db=(b.kind==VREAL)?b.f:b.i;
-      double r=0; switch(ins->op){ case IR_ADD:r=da+db;break; case IR_SUB:r=da-db;break; case IR_MUL:r=da*db;break; case IR_DIV:r=db!=0?da/db:0;break; case IR_MOD:r=(int)da % (int)db;break; default:break; }
-      int any_real = (a.kind==VREAL || b.kind==VREAL);
-      v_free(temps[ins->dest]); temps[ins->dest]= any_real ? v_real(r) : v_int((int)r);
-      break; }
-    case IR_EQ: case IR_NEQ: case IR_LT: case IR_GT: case IR_LE: case IR_GE: {
-      Value a=temps[ins->arg1], b=temps[ins->arg2]; double da=(a.kind==VREAL)?a.f:a.i; double db=(b.kind==VREAL)?b.f:b.i; int res=0;
-      switch(ins->op){ case IR_EQ: res = (da==db); break; case IR_NEQ: res=(da!=db); break; case IR_LT: res=(da<db); break; case IR_GT: res=(da>db); break; case IR_LE: res=(da<=db); break; case IR_GE: res=(da>=db); break; default: break; }
-      v_free(temps[ins->dest]); temps[ins->dest]=v_bool(res); break; }
-    case IR_AND: case IR_OR: {
-      Value a=temps[ins->arg1], b=temps[ins->arg2];
-      int ta = (a.kind==VINT||a.kind==VREAL||a.kind==VBOOL) ? ((a.kind==VREAL)?(a.f!=0):a.i!=0) : (a.kind==VSTRING? (a.s && a.s[0]):0);
-      int tb = (b.kind==VINT||b.kind==VREAL||b.kind==VBOOL) ? ((b.kind==VREAL)?(b.f!=0):b.i!=0) : (b.kind==VSTRING? (b.s && b.s[0]):0);
-      int res = (ins->op==IR_AND) ? (ta && tb) : (ta || tb);
-      v_free(temps[ins->dest]); temps[ins->dest]=v_bool(res); break; }
-    case IR_JUMP: {
-      long idx = find_label(labels, nlab, ins->s);
-      if(idx>=0){ ip = (size_t)idx; continue; }
-      break; }
-    case IR_JUMP_IF_FALSE: {
-      Value c = temps[ins->arg1]; int truthy=0;
-      if(c.kind==VINT) truthy = c.i!=0; else if(c.kind==VREAL) truthy = c.f!=0; else if (c.kind==VBOOL) truthy = c.i!=0; else truthy = c.s && c.s[0];
-      if(!truthy){ long idx=find_label(labels,nlab,ins->s); if(idx>=0){ ip=(size_t)idx; continue; }}
-      break; }
-    case IR_LABEL: break;
-    case IR_RET:
-      if (ret_out) { v_free(retval); retval = v_copy(temps[ins->arg1]); had_ret=1; }
-      goto done;
-    case IR_PRINT: print_value(out, temps[ins->arg1]); fflush(out); break;
-    case IR_PRINTLN: if(ins->arg1>=0) print_value(out, temps[ins->arg1]); fputc('\n', out); fflush(out); break;
-    case IR_READLN: {
-      char *line=NULL; size_t n=0; ssize_t r=getline(&line, &n, in);
-      if(r>0 && line[r-1]=='\n') line[r-1]='\0';
-      Value v = parse_value(line?line:"" ); env_set(env, ins->s, v); v_free(v); free(line);
-      break; }
-    case IR_READ_FILE: {
-      Value pathv = temps[ins->arg1]; const char *path = (pathv.kind==VSTRING && pathv.s)?pathv.s:"";
-      FILE *fpy = fopen(path, "rb"); if(!fpy){ v_free(temps[ins->dest]); temps[ins->dest]=v_string(""); break; }
-      fseek(fpy,0,SEEK_END); long len=ftell(fpy); rewind(fpy);
-      char *buf = malloc(len+1); if(!buf){ fclose(fpy); v_free(temps[ins->dest]); temps[ins->dest]=v_string(""); break; }
-      size_t read_n = fread(buf,1,(size_t)len,fpy);
-      buf[read_n]='\0';
-      fclose(fpy);
-      v_free(temps[ins->dest]); temps[ins->dest]=v_string(buf); free(buf);
-      break; }
-    case IR_WRITE_FILE: {
-      Value pathv = temps[ins->arg1]; Value contentv = temps[ins->arg2];
-      const char *path = (pathv.kind==VSTRING && pathv.s)?pathv.s:"";
-      const char *content = (contentv.kind==VSTRING && contentv.s)?contentv.s:"";
-      FILE *fpy = fopen(path, "wb"); if(fpy){ fwrite(content,1,strlen(content),fpy); fclose(fpy);} break; }
-    case IR_ASK: {
-      Value pv = temps[ins->arg1];
-      const char *prompt = (pv.kind==VSTRING && pv.s)?pv.s:"";
-      OracleResult r = oracle_call_text(oracle, prompt);
-      v_free(temps[ins->dest]);
-      if (r.ok) {
-        if (ins->s2) {
-          Type *schema = find_schema(prog, ins->s2);
-          char *errmsg=NULL;
-          int valid = schema ? validate_json_against_schema(r.text ? r.text : "", schema, &errmsg) : 0;
-          if (debug_exec()) {
-            fprintf(stderr, "[exec] ask schema=%s found=%s valid=%d err=%s (schemas len=%zu)\n", ins->s2, schema?"yes":"no", valid, errmsg?errmsg:"(null)", prog->schemas.len);
-            for (size_t ii=0; ii<prog->schemas.len; ++ii) {
-              fprintf(stderr, "[exec] schema[%zu]=%s\n", ii, prog->schemas.items[ii]->as.schema.name ? prog->schemas.items[ii]->as.schema.name : "(null)");
-            }
-          }
-          if (schema && valid) {
-            temps[ins->dest] = v_result_ok(r.text ? r.text : "");
-          } else {
-            temps[ins->dest] = v_result_err(errmsg ? errmsg : (schema?"extraction failed":"schema not found"));
-          }
-          free(errmsg);
-        } else {
-          temps[ins->dest] = v_result_ok(r.text ? r.text : "");
-        }
-      } else {
-        if (ins->arg2 >= 0) {
-          Value fb = temps[ins->arg2];
-          if (fb.kind == VSTRING) temps[ins->dest] = v_result_ok(fb.s ? fb.s : "");
-          else if (fb.kind == VRESULT && fb.res.ok) temps[ins->dest] = v_result_ok(fb.res.text ? fb.res.text : "");
-          else temps[ins->dest] = v_result_ok("");
-        } else {
-          temps[ins->dest] = v_result_err(r.error ? r.error : "oracle error");
-        }
-      }
-      oracle_result_free(r);
-      break; }
-    case IR_RESULT_UNWRAP: {
-      Value rv = temps[ins->arg1];
-      Value fb = ins->arg2 >=0 ? temps[ins->arg2] : v_int(0);
-      v_free(temps[ins->dest]);
-      if (rv.kind == VRESULT) {
-        if (rv.res.ok) {
-          temps[ins->dest] = v_string(rv.res.text ? rv.res.text : "");
-        } else {
-          if (ins->arg2 >=0 && fb.kind==VSTRING) temps[ins->dest] = v_string(fb.s ? fb.s : "");
-          else temps[ins->dest] = v_string("");
-        }
-      } else if (rv.kind == VSTRING) {
-        temps[ins->dest] = v_string(rv.s ? rv.s : "");
-      } else {
-        temps[ins->dest] = v_string("");
-      }
-      break; }
-    case IR_RESULT_IS_OK: {
-      Value rv = temps[ins->arg1];
-      v_free(temps[ins->dest]);
-      if (rv.kind == VRESULT) temps[ins->dest] = v_int(rv.res.ok ? 1 : 0);
-      else temps[ins->dest] = v_int(0);
-      break; }
-    case IR_RESULT_UNWRAP_ERR: {
-      Value rv = temps[ins->arg1];
-      v_free(temps[ins->dest]);
-      if (rv.kind == VRESULT) {
-        if (rv.res.ok) temps[ins->dest] = v_string("");
-        else temps[ins->dest] = v_string(rv.res.error ? rv.res.error : "");
-      } else {
-        temps[ins->dest] = v_string("");
-      }
-      break; }
-    case IR_MAKE_RESULT_OK: {
-      Value rv = temps[ins->arg1];
-      v_free(temps[ins->dest]);
-      char buf[64]; const char *s = NULL; char *tmp=NULL;
-      if (rv.kind==VSTRING) s = rv.s ? rv.s : "";
-      else if (rv.kind==VINT) { snprintf(buf,sizeof(buf), "%d", rv.i); tmp=strdup(buf); s=tmp; }
-      else if (rv.kind==VREAL) { snprintf(buf,sizeof(buf), "%g", rv.f); tmp=strdup(buf); s=tmp; }
-      else if (rv.kind==VBOOL) { tmp=strdup(rv.i?"True":"False"); s=tmp; }
-      else s = "";
-      temps[ins->dest] = v_result_ok(s);
-      if (tmp) free(tmp);
-      break; }
-    case IR_MAKE_RESULT_ERR: {
-      Value rv = temps[ins->arg1];
-      v_free(temps[ins->dest]);
-      char buf[64]; const char *s = NULL; char *tmp=NULL;
-      if (rv.kind==VSTRING) s = rv.s ? rv.s : "";
-      else if (rv.kind==VINT) { snprintf(buf,sizeof(buf), "%d", rv.i); tmp=strdup(buf); s=tmp; }
-      else if (rv.kind==VREAL) { snprintf(buf,sizeof(buf), "%g", rv.f); tmp=strdup(buf); s=tmp; }
-      else if (rv.kind==VBOOL) { tmp=strdup(rv.i?"True":"False"); s=tmp; }
-      else s = "";
-      temps[ins->dest] = v_result_err(s);
-      if (tmp) free(tmp);
-      break; }
-    case IR_CONCAT: {
-      Value a = temps[ins->arg1];
-      Value b = temps[ins->arg2];
-      char buf[64];
-      const char *sa=NULL, *sb=NULL;
-      char *sa_tmp=NULL, *sb_tmp=NULL;
-      if (a.kind==VSTRING) sa = a.s ? a.s : "";
-      else if (a.kind==VINT) { snprintf(buf,sizeof(buf),"%d",a.i); sa_tmp=strdup(buf); sa=sa_tmp; }
-      else if (a.kind==VREAL) { snprintf(buf,sizeof(buf),"%g",a.f); sa_tmp=strdup(buf); sa=sa_tmp; }
-      else if (a.kind==VBOOL) { sa_tmp=strdup(a.i?"True":"False"); sa=sa_tmp; }
-      else if (a.kind==VRESULT) sa = a.res.ok && a.res.text ? a.res.text : (a.res.error ? a.res.error : "");
-      else sa = "";
-      if (b.kind==VSTRING) sb = b.s ? b.s : "";
-      else if (b.kind==VINT) { snprintf(buf,sizeof(buf),"%d",b.i); sb_tmp=strdup(buf); sb=sb_tmp; }
-      else if (b.kind==VREAL) { snprintf(buf,sizeof(buf),"%g",b.f); sb_tmp=strdup(buf); sb=sb_tmp; }
-      else if (b.kind==VBOOL) { sb_tmp=strdup(b.i?"True":"False"); sb=sb_tmp; }
-      else if (b.kind==VRESULT) sb = b.res.ok && b.res.text ? b.res.text : (b.res.error ? b.res.error : "");
-      else sb = "";
-      size_t lena=strlen(sa), lenb=strlen(sb);
-      char *res = malloc(lena+lenb+1);
-      memcpy(res, sa, lena); memcpy(res+lena, sb, lenb); res[lena+lenb]='\0';
-      v_free(temps[ins->dest]);
-      temps[ins->dest] = v_string(res);
-      if (sa_tmp) free(sa_tmp);
-      if (sb_tmp) free(sb_tmp);
-      free(res);
-      break; }
-    case IR_RESULT_OR_FALLBACK: {
-      Value rv = temps[ins->arg1];
-      Value fb = ins->arg2 >=0 ? temps[ins->arg2] : v_int(0);
-      v_free(temps[ins->dest]);
-      if (rv.kind == VRESULT) {
-        if (rv.res.ok) temps[ins->dest] = v_result_ok(rv.res.text ? rv.res.text : "");
-        else {
-          if (ins->arg2 >=0 && fb.kind==VSTRING) temps[ins->dest] = v_result_ok(fb.s ? fb.s : "");
-          else temps[ins->dest] = v_result_err(rv.res.error ? rv.res.error : "");
-        }
-      } else if (rv.kind == VSTRING) {
-        temps[ins->dest] = v_result_ok(rv.s ? rv.s : "");
-      } else {
-        temps[ins->dest] = v_result_err("invalid result");
-      }
-      break; }
-    case IR_CALL: {
-      const IrFunc *cf = find_func(prog, ins->s ? ins->s : "");
-      Value rv = v_int(0);
-      if (cf) {
-        Env newenv={0}; newenv.parent = env;
-        if (cf->param_count >0 && ins->arg1>=0) { env_set(&newenv, cf->params[0], temps[ins->arg1]); }
-        if (cf->param_count >1 && ins->arg2>=0) { env_set(&newenv, cf->params[1], temps[ins->arg2]); }
-        execute_func(prog, cf, &newenv, in, out, oracle, &rv);
-        env_free(&newenv);
-      }
-      v_free(temps[ins->dest]);
-      temps[ins->dest] = v_copy(rv);
-      v_free(rv);
-      break; }
-    case IR_INDEX: {
-      Value idxv = temps[ins->arg2]; int idx = (idxv.kind==VREAL)?(int)idxv.f: idxv.i;
-      // fallback: env lookup base.idx
-      if (ins->s) {
-        char buf[256]; snprintf(buf,sizeof(buf),"%s.%d", ins->s, idx);
-        v_free(temps[ins->dest]); temps[ins->dest]=env_get(env, buf);
-        if (temps[ins->dest].ref) { free(temps[ins->dest].ref); _frees++; }
-        temps[ins->dest].ref = strdup(buf);
-        temps[ins->dest].ref_interned = 0;
-        _allocs++;
-      } else {
-        v_free(temps[ins->dest]); temps[ins->dest]=v_int(0);
-      }
-      break; }
-    default: break;
-    }
-    ip++;
+    if (ctx->ngrams) op_ngrams_count(ctx->ngrams, f, ip);
+    if (prof) profiler_count(prof, &f->instrs.items[ip], ip);
+    if (smp) sampler_at(smp, ip);
+    long next = step(&fr, ip);
+    if (smp) sampler_poll(smp);
+    if (pgo) pgo_count(pgo, f, ip, next);
+    if (next < 0) break;
+    if (jit && (size_t)next <= ip && jit_enter(jit, &fr, (size_t)next, 0)) break;
+    ip = (size_t)next;
   }
 
 done:
-  if (labels) free(labels);
-  labels = NULL;
-  if (debug_exec() && f && f->name && strcmp(f->name,"Average")==0) {
-    Value vt=env_get(env,"Total"); Value vc=env_get(env,"Count"); Value vr=env_get(env,"Result");
+  if (ctx->debug_exec && f && f->name && strcmp(f->name,"Average")==0) {
+    Value vt=env_get(ctx, env,"Total"); Value vc=env_get(ctx, env,"Count"); Value vr=env_get(ctx, env,"Result");
     fprintf(stderr,"[exec] Average Total=%d Count=%d Result kind=%d i=%d\n", vt.i, vc.i, vr.kind, vr.i);
-    v_free(vt); v_free(vc); v_free(vr);
-  }
-  if (ret_out) {
-    if (!had_ret) {
-      Value rv = env_get(env, "Result");
-      v_free(retval);
-      retval = rv;
-    }
-    *ret_out = retval;
-  } else {
-    v_free(retval);
+    v_free(ctx, vt); v_free(ctx, vc); v_free(ctx, vr);
   }
-  for(size_t i=0;i<maxt;i++) v_free(temps[i]);
-  free(temps);
+  rt_finish(ctx, env, ret_out, fr.retval, fr.had_ret);
+  frame_close(&fr);
+  if (prof) profiler_exit(prof);
+  if (smp) sampler_exit(smp);
+  if (tr) tracer_exit(tr);
   return 0;
 }
 
@@ -512,36 +733,408 @@ static int validate_json_against_schema(const char *json, Type *schema, char **e
 fail:
   if(fields){ for(size_t j=0;j<len;++j){ free(fields[j].key); free(fields[j].val);} free(fields);} return 0; }
 
-int ir_execute(const IrProgram *prog, FILE *in, FILE *out, Oracle *oracle){ if(!prog||prog->funcs.len==0) return 1; Env env={0}; int rc= execute_func(prog, &prog->funcs.items[0], &env, in, out, oracle, NULL); env_free(&env); if (debug_exec()) fprintf(stderr,"[allocs] allocs=%zu frees=%zu\n", _allocs, _frees); return rc; }
+// The context's bindings, as the program's first variables
+static void bind_globals(LiminalContext *ctx, Env *env){
+  if (!ctx->bindings) return;
+  for (size_t i=0;i<ctx->bindings->len;++i) env_set(ctx, env, ctx->bindings->items[i].name, ctx->bindings->items[i].val);
+}
+
+int ir_execute(const IrProgram *prog, LiminalContext *ctx){
+  if(!prog||prog->funcs.len==0) return 1;
+  Env env={0};
+  bind_globals(ctx, &env);
+  // Native code would bypass the profile counters
+  if (ctx->jit && !ctx->pgo && !ctx->profiler && !ctx->sampler && !ctx->tracer) ctx->jit_state = jit_state_new(ctx, prog);
+  if (ctx->quicken) ctx->quick_state = quick_state_new(prog);
+  int rc= execute_func(ctx, prog, &prog->funcs.items[0], &env, NULL);
+  env_free(ctx, &env);
+  streams_close_all(ctx);
+  asks_close_all(ctx);
+  if (ctx->workers) { worker_pool_free(ctx->workers); ctx->workers = NULL; }
+  if (ctx->jit_state) { jit_state_free(ctx->jit_state); ctx->jit_state = NULL; }
+  if (ctx->quick_state) { quick_state_free(ctx->quick_state); ctx->quick_state = NULL; }
+  if (ctx->debug_exec && ctx->quicken) fprintf(stderr,"[exec] quickened=%zu deopts=%zu\n", ctx->quickened, ctx->deopts);
+  liminal_context_flush(ctx);
+  if (ctx->debug_exec) fprintf(stderr,"[allocs] allocs=%zu frees=%zu\n", ctx->allocs, ctx->frees);
+  return rc;
+}
 
-static char *read_file(const char *path, size_t *len_out){ FILE *f=fopen(path, "rb"); if(!f) return NULL; fseek(f,0,SEEK_END); long len=ftell(f); rewind(f); char *buf=malloc(len+1); size_t read_n=fread(buf,1,(size_t)len,f); buf[read_n]='\0'; fclose(f); if(len_out) *len_out=read_n; return buf; }
+// Suspendable runs (ir_execute_many). An instance keeps its activations on
+// a stack of its own: a CALL pushes one and RET pops it, so the C stack is
+// the same depth whatever the program's, and an instance can stop between
+// any two instructions and pick up again later. It stops at an ASK, which
+// it starts and leaves in flight, at an AWAIT whose answer is not in yet,
+// and before starting an ask while the oracle's cap is full (parked).
+typedef struct {
+  ExecFrame fr;
+  size_t ip;
+  Env env;    // locals of a callee; main runs in the instance's globals
+  Value ret;  // a callee's return value, for the caller's CALL
+} ExecActivation;
 
-static Oracle *g_oracle = NULL;
-void exec_set_global_oracle(Oracle *o){ g_oracle = o; }
+typedef struct {
+  LiminalContext *ctx;
+  size_t index;
+  Env globals;
+  ExecActivation **stack;
+  size_t depth, cap;
+  OracleCall *asking;   // the ASK at the top's ip, in flight
+  OracleCall *waiting;  // the AWAIT at the top's ip waits on this
+  int parked;           // an ask at the top's ip waits for a slot
+} ExecInstance;
 
-int liminal_run_file_streams(const char *path, FILE *in, FILE *out){ size_t len=0; char *src = read_file(path, &len); if(!src){ fprintf(stderr, "Unable to read %s\n", path); return 1; }
-  if (debug_exec()) fprintf(stderr, "[exec] read file ok len=%zu\n", len);
-  Parser *p = parser_create(src, len); ASTNode *ast = parse_program(p);
-  if (debug_exec()) fprintf(stderr, "[exec] parse done\n");
-  TypeCheckResult tcr = typecheck_program(ast);
-  if (debug_exec()) fprintf(stderr, "[exec] typecheck ok=%d\n", tcr.ok ? 1 : 0);
-  if(!tcr.ok){ for(size_t i=0;i<tcr.errors.len;i++){ fprintf(stderr, "Type error: %s\n", tcr.errors.items[i].message); } typecheck_result_free(&tcr); ast_free(ast); parser_destroy(p); free(src); return 1; }
+static void instance_push(ExecInstance *in, const IrProgram *prog, const IrFunc *f, Env *env, QuickState *qs){
+  if (in->depth == in->cap) { in->cap = in->cap ? in->cap * 2 : 8; in->stack = realloc(in->stack, in->cap * sizeof(*in->stack)); }
+  ExecActivation *a = calloc(1, sizeof(ExecActivation));
+  a->ret = v_int(0);
+  if (!env) { env = &a->env; }
+  frame_open(&a->fr, in->ctx, prog, f, env, env == &a->env ? &a->ret : NULL, qs ? quick_func(qs, f) : NULL);
+  in->stack[in->depth++] = a;
+}
+
+// Ends the top activation; a callee hands its value to the caller's CALL
+static void instance_pop(ExecInstance *in){
+  LiminalContext *ctx = in->ctx;
+  ExecActivation *a = in->stack[--in->depth];
+  rt_finish(ctx, a->fr.env, a->fr.ret_out, a->fr.retval, a->fr.had_ret);
+  frame_close(&a->fr);
+  if (in->depth) {
+    ExecActivation *caller = in->stack[in->depth - 1];
+    const IrInstr *call = &caller->fr.f->instrs.items[caller->ip];
+    env_free(ctx, &a->env);
+    v_free(ctx, caller->fr.temps[call->dest]);
+    caller->fr.temps[call->dest] = v_copy(ctx, a->ret);
+    v_free(ctx, a->ret);
+    caller->ip++;
+  }
+  free(a);
+}
+
+static OracleCall *await_call(LiminalContext *ctx, Value hv){
+  if (!ctx->asks || hv.kind != VINT || hv.i < 0 || (size_t)hv.i >= ctx->asks->len) return NULL;
+  return ctx->asks->items[hv.i].call;
+}
+
+// Runs the instance until it suspends (0) or ends (1). The instruction it
+// resumes at runs whether or not it would suspend again, blocking if it
+// must: the scheduler resumes an instance that is not ready only when none
+// is.
+static int instance_run(ExecInstance *in, QuickState *qs){
+  LiminalContext *ctx = in->ctx;
+  int resumed = 1;
+  in->waiting = NULL;
+  in->parked = 0;
+  while (in->depth) {
+    ExecActivation *a = in->stack[in->depth - 1];
+    ExecFrame *fr = &a->fr;
+    if (a->ip >= fr->f->instrs.len) { instance_pop(in); continue; }
+    const IrInstr *ins = &fr->f->instrs.items[a->ip];
+    if (in->asking) {
+      OracleResult r = oracle_call_wait(in->asking);
+      in->asking = NULL;
+      ask_answer(fr, ins, &fr->temps[ins->dest], r);
+      a->ip++;
+      resumed = 0;
+      continue;
+    }
+    if (!resumed) {
+      if ((ins->op == IR_ASK || ins->op == IR_ASK_START) && oracle_saturated(ctx->oracle)) { in->parked = 1; return 0; }
+      if (ins->op == IR_AWAIT) {
+        OracleCall *c = await_call(ctx, fr->temps[ins->arg1]);
+        if (c && !oracle_call_done(c)) { in->waiting = c; return 0; }
+      }
+    }
+    resumed = 0;
+    if (ins->op == IR_ASK) {
+      Value pv = fr->temps[ins->arg1];
+      in->asking = oracle_call_start(ctx->oracle, pv.kind==VSTRING && pv.s ? pv.s : "");
+      return 0;
+    }
+    const IrFunc *cf = ins->op == IR_CALL ? find_func(fr->prog, ins->s ? ins->s : "") : NULL;
+    if (cf) {
+      instance_push(in, fr->prog, cf, NULL, qs);
+      ExecActivation *callee = in->stack[in->depth - 1];
+      callee->env.parent = fr->env;
+      if (cf->param_count >0 && ins->arg1>=0) { env_set(ctx, &callee->env, cf->params[0], fr->temps[ins->arg1]); }
+      if (cf->param_count >1 && ins->arg2>=0) { env_set(ctx, &callee->env, cf->params[1], fr->temps[ins->arg2]); }
+      continue;
+    }
+    long next = step(fr, a->ip);
+    if (next < 0) { instance_pop(in); continue; }
+    a->ip = (size_t)next;
+  }
+  return 1;
+}
+
+// Whether resuming would not block
+static int instance_ready(ExecInstance *in){
+  if (in->asking) return oracle_call_done(in->asking);
+  if (in->waiting) return oracle_call_done(in->waiting);
+  if (in->parked) return !oracle_saturated(in->ctx->oracle);
+  return 1;
+}
+
+static ExecInstance *instance_new(const IrProgram *prog, LiminalContext *ctx, size_t index, QuickState *qs){
+  ExecInstance *in = calloc(1, sizeof(ExecInstance));
+  in->ctx = ctx;
+  in->index = index;
+  bind_globals(ctx, &in->globals);
+  instance_push(in, prog, &prog->funcs.items[0], &in->globals, qs);
+  return in;
+}
+
+static void instance_free(ExecInstance *in){
+  LiminalContext *ctx = in->ctx;
+  env_free(ctx, &in->globals);
+  streams_close_all(ctx);
+  asks_close_all(ctx);
+  if (ctx->workers) { worker_pool_free(ctx->workers); ctx->workers = NULL; }
+  liminal_context_flush(ctx);
+  free(in->stack);
+  free(in);
+}
+
+int ir_execute_many(const IrProgram *prog, LiminalContext **ctxs, size_t n, size_t active, ExecDoneFn on_done, void *user){
+  if(!prog||prog->funcs.len==0) return 1;
+  if (active == 0 || active > n) active = n;
+  QuickState *qs = NULL;
+  for (size_t i=0;i<n && !qs;++i) if (ctxs[i]->quicken) qs = quick_state_new(prog);
+  // Suspended instances, oldest first: the first that is ready runs next,
+  // or, when none is, the oldest not parked, which blocks
+  ExecInstance **queue = calloc(active ? active : 1, sizeof(ExecInstance *));
+  size_t len = 0, next = 0;
+  while (len || next < n) {
+    ExecInstance *in;
+    if (len < active && next < n) {
+      in = instance_new(prog, ctxs[next], next, ctxs[next]->quicken ? qs : NULL);
+      next++;
+    } else {
+      size_t pick = 0;
+      while (pick < len && !instance_ready(queue[pick])) pick++;
+      if (pick == len) { pick = 0; while (pick < len && queue[pick]->parked) pick++; }
+      if (pick == len) pick = 0;
+      in = queue[pick];
+      memmove(&queue[pick], &queue[pick + 1], (len - pick - 1) * sizeof(*queue));
+      len--;
+    }
+    if (!instance_run(in, in->ctx->quicken ? qs : NULL)) { queue[len++] = in; continue; }
+    size_t index = in->index;
+    instance_free(in);
+    if (on_done) on_done(user, index, 0);
+  }
+  free(queue);
+  quick_state_free(qs);
+  return 0;
+}
+
+static char *read_file(const char *path, size_t *len_out){ FILE *f=fopen(path, "rb"); if(!f) return NULL; fseek(f,0,SEEK_END); long len=ftell(f); rewind(f); char *buf=lm_malloc(len+1); size_t read_n=fread(buf,1,(size_t)len,f); buf[read_n]='\0'; fclose(f); if(len_out) *len_out=read_n; return buf; }
+
+// Phases show up as trace spans and in the --time-phases report
+static PhaseMark phase_start(const LiminalContext *ctx){ PhaseMark m = {0, {0, 0, 0, 0, 0}}; return ctx->tracer || ctx->phases ? phase_mark() : m; }
+static void phase_end(LiminalContext *ctx, const char *name, const char *cat, PhaseMark start){
+  if (ctx->tracer) tracer_span(ctx->tracer, name, cat, start.ns);
+  if (ctx->phases) phase_log_add(ctx->phases, name, start);
+}
+
+// Front end: parse, typecheck and lower. Returns NULL after reporting errors,
+// each prefixed with path:line:col when its position is known.
+static IrProgram *compile_source(LiminalContext *ctx, const char *path, const char *src, size_t len){
+  PhaseMark t0 = phase_start(ctx);
+  Parser *p = parser_create_ctx(ctx, src, len); ASTNode *ast = parse_program(p);
+  phase_end(ctx, "parse", "compile", t0);
+  if (ctx->debug_exec) fprintf(stderr, "[exec] parse done\n");
+  t0 = phase_start(ctx);
+  TypeCheckResult tcr = typecheck_program_ctx(ast, ctx);
+  phase_end(ctx, "typecheck", "compile", t0);
+  if (ctx->debug_exec) fprintf(stderr, "[exec] typecheck ok=%d\n", tcr.ok ? 1 : 0);
+  if(!tcr.ok){ for(size_t i=0;i<tcr.errors.len;i++){ const TypeCheckError *e=&tcr.errors.items[i]; if (e->span.line>0) fprintf(stderr, "%s:%d:%d: ", path, e->span.line, e->span.column); fprintf(stderr, "Type error: %s\n", e->message); } typecheck_result_free(&tcr); ast_free(ast); parser_destroy(p); return NULL; }
   typecheck_result_free(&tcr);
-  IrProgram *ir = ir_from_ast(ast);
-  if (debug_exec()) fprintf(stderr, "[exec] ir_from_ast done\n");
-  char *errmsg=NULL; if(!ir_validate(ir,&errmsg)){ fprintf(stderr, "IR invalid: %s\n", errmsg?errmsg:""); free(errmsg); ir_program_free(ir); ast_free(ast); parser_destroy(p); free(src); return 1; }
-  if (debug_exec()) fprintf(stderr, "[exec] ir validated\n");
-  const char *dbg = getenv("LIMINAL_DEBUG_IR");
-  if (dbg) {
-    char *irstr = ir_program_print(ir);
+  t0 = phase_start(ctx);
+  IrProgram *ir = ir_from_ast_ctx(ast, ctx);
+  phase_end(ctx, "lower", "compile", t0);
+  if (ctx->debug_exec) fprintf(stderr, "[exec] ir_from_ast done\n");
+  ast_free(ast); parser_destroy(p);
+  return ir; }
+
+// A profile that cannot be read or belongs to another program is a warning;
+// the program still runs, unoptimized
+static void apply_profile(LiminalContext *ctx, IrProgram *ir){
+  char *errmsg=NULL;
+  PgoStats stats={0};
+  PgoProfile *profile = pgo_profile_load(ctx->pgo_in, &errmsg);
+  if (!profile || !pgo_apply(ir, profile, &stats, &errmsg)) fprintf(stderr, "warning: %s: %s; profile ignored\n", ctx->pgo_in, errmsg?errmsg:"");
+  else if (ctx->debug_exec) fprintf(stderr, "[exec] pgo: inlined=%zu cases=%zu cold=%zu\n", stats.inlined, stats.cases_reordered, stats.blocks_moved);
+  free(errmsg);
+  pgo_profile_free(profile);
+}
+
+// Adds to an existing profile of the same program; any other file is replaced
+static int save_profile(LiminalContext *ctx){
+  PgoProfile *old = pgo_profile_load(ctx->pgo_out, NULL);
+  if (old && !pgo_profile_merge(ctx->pgo, old) && ctx->debug_exec) fprintf(stderr, "[exec] pgo: replacing profile of another program\n");
+  pgo_profile_free(old);
+  char *errmsg=NULL;
+  int ok = pgo_profile_save(ctx->pgo, ctx->pgo_out, &errmsg);
+  if (!ok) fprintf(stderr, "Unable to write profile %s: %s\n", ctx->pgo_out, errmsg?errmsg:"");
+  free(errmsg);
+  return ok;
+}
+
+// Report on stderr, JSON to the requested file
+static int report_timing(LiminalContext *ctx){
+  profiler_finish(ctx->profiler);
+  profiler_report(ctx->profiler, stderr);
+  if (!ctx->profile_json) return 1;
+  FILE *f = fopen(ctx->profile_json, "w");
+  if (!f) { fprintf(stderr, "Unable to write %s: %s\n", ctx->profile_json, strerror(errno)); return 0; }
+  profiler_write_json(ctx->profiler, f);
+  return fclose(f) == 0;
+}
+
+// The program's IR with source lines and how often each instruction ran
+static int write_annotated(LiminalContext *ctx, const IrProgram *ir, const char *path){
+  char *src = read_file(path, NULL);
+  char *text = ir_program_print_annotated(ir, src, ctx->profiler->counts);
+  lm_free(src);
+  FILE *f = fopen(ctx->annotate_out, "w");
+  if (!f) { fprintf(stderr, "Unable to write %s: %s\n", ctx->annotate_out, strerror(errno)); free(text); return 0; }
+  fputs(text, f);
+  free(text);
+  return fclose(f) == 0;
+}
+
+static int write_samples(LiminalContext *ctx){
+  FILE *f = fopen(ctx->sample_out, "w");
+  if (!f) { fprintf(stderr, "Unable to write %s: %s\n", ctx->sample_out, strerror(errno)); return 0; }
+  sampler_write_folded(ctx->sampler, f);
+  if (ctx->debug_exec) fprintf(stderr, "[exec] samples=%llu\n", (unsigned long long)ctx->sampler->samples);
+  return fclose(f) == 0;
+}
+
+IrProgram *liminal_load_program(LiminalContext *ctx, const char *path){ size_t len=0;
+  PhaseMark t0 = phase_start(ctx);
+  char *src = read_file(path, &len);
+  phase_end(ctx, "read", "compile", t0);
+  if(!src){ fprintf(stderr, "Unable to read %s\n", path); return NULL; }
+  if (ctx->debug_exec) fprintf(stderr, "[exec] read file ok len=%zu\n", len);
+  t0 = phase_start(ctx);
+  IrProgram *ir = ctx->cache_dir ? bytecode_cache_load(ctx->cache_dir, src, len) : NULL;
+  if (ctx->cache_dir) phase_end(ctx, "cache load", "compile", t0);
+  int cached = ir != NULL;
+  if (ctx->debug_exec && ctx->cache_dir) fprintf(stderr, "[exec] bytecode cache %s\n", cached ? "hit" : "miss");
+  if (!ir) ir = compile_source(ctx, path, src, len);
+  if (!ir) { lm_free(src); return NULL; }
+  t0 = phase_start(ctx);
+  char *errmsg=NULL; int valid = ir_validate(ir,&errmsg);
+  phase_end(ctx, "validate", "compile", t0);
+  if(!valid){ fprintf(stderr, "IR invalid: %s\n", errmsg?errmsg:""); free(errmsg); ir_program_free(ir); lm_free(src); return NULL; }
+  if (ctx->debug_exec) fprintf(stderr, "[exec] ir validated\n");
+  if (ctx->cache_dir && !cached) {
+    t0 = phase_start(ctx);
+    if (!bytecode_cache_store(ctx->cache_dir, src, len, ir) && ctx->debug_exec) fprintf(stderr, "[exec] bytecode cache store failed\n");
+    phase_end(ctx, "cache store", "compile", t0);
+  }
+  if (ctx->pgo_in && !ctx->pgo_out) { t0 = phase_start(ctx); apply_profile(ctx, ir); phase_end(ctx, "pgo", "compile", t0); }
+  if (ctx->debug_ir) {
+    char *irstr = ir_program_print_annotated(ir, src, NULL);
     fprintf(stderr, "IR:\n%s\n", irstr);
     free(irstr);
   }
-  if (debug_exec()) fprintf(stderr, "[exec] executing\n");
-  Oracle *oracle = g_oracle ? g_oracle : oracle_from_env();
-  int rc = ir_execute(ir, in?in:stdin, out?out:stdout, oracle);
-  if (!g_oracle && oracle) oracle_free(oracle);
-  if (debug_exec()) fprintf(stderr, "[exec] done rc=%d\n", rc);
-  ir_program_free(ir); ast_free(ast); parser_destroy(p); free(src); return rc; }
+  lm_free(src); return ir; }
+
+// Phase report on stderr, JSON to the requested file
+static int report_phases(LiminalContext *ctx){
+  phase_log_report(ctx->phases, stderr);
+  if (!ctx->time_phases_json) return 1;
+  FILE *f = fopen(ctx->time_phases_json, "w");
+  if (!f) { fprintf(stderr, "Unable to write %s: %s\n", ctx->time_phases_json, strerror(errno)); return 0; }
+  phase_log_write_json(ctx->phases, f);
+  return fclose(f) == 0;
+}
+
+// Writes out the rest of the trace and the phase report, also after a
+// failed compile; a run that fails only here still fails
+static int finish_run(LiminalContext *ctx, int rc){
+  if (ctx->tracer) {
+    if (ctx->debug_exec) fprintf(stderr, "[exec] trace events=%llu\n", (unsigned long long)ctx->tracer->events);
+    if (!tracer_close(ctx->tracer)) { fprintf(stderr, "Unable to write %s\n", ctx->trace_out); if (rc == 0) rc = 1; }
+    ctx->tracer = NULL;
+  }
+  if (ctx->phases) {
+    if (!report_phases(ctx) && rc == 0) rc = 1;
+    phase_log_free(ctx->phases);
+    ctx->phases = NULL;
+  }
+  return rc;
+}
+
+int liminal_run_file_ctx(LiminalContext *ctx, const char *path){
+  if (ctx->trace_out) {
+    char *errmsg = NULL;
+    ctx->tracer = tracer_open(ctx->trace_out, ctx->trace_min_us > 0 ? (uint64_t)ctx->trace_min_us * 1000 : 0, &errmsg);
+    if (!ctx->tracer) { fprintf(stderr, "Unable to write %s: %s\n", ctx->trace_out, errmsg?errmsg:""); free(errmsg); return 1; }
+    ctx->tracer->source = path;
+  }
+  if (ctx->time_phases) ctx->phases = phase_log_new();
+  IrProgram *ir = liminal_load_program(ctx, path);
+  if (!ir) return finish_run(ctx, 1);
+  if (ctx->debug_exec) fprintf(stderr, "[exec] executing\n");
+  if (!ctx->oracle) liminal_context_set_oracle(ctx, oracle_from_env(), 1);
+  // Profiles are keyed to the IR before superinstructions
+  uint64_t checksum = ctx->pgo_out ? pgo_checksum(ir) : 0;
+  if (ctx->fuse) {
+    PhaseMark t0 = phase_start(ctx);
+    size_t fused = ir_fuse_superinstructions(ir);
+    phase_end(ctx, "fuse", "compile", t0);
+    if (ctx->debug_exec) fprintf(stderr, "[exec] superinstructions: %zu\n", fused);
+  }
+  if (ctx->sample_out) {
+    ctx->sampler = sampler_new(ir);
+    ctx->sampler->source = path;
+    char *errmsg = NULL;
+    if (!sampler_start(ctx->sampler, ctx->sample_hz, &errmsg)) {
+      fprintf(stderr, "Unable to start sampler: %s\n", errmsg?errmsg:"");
+      free(errmsg);
+      sampler_free(ctx->sampler);
+      ctx->sampler = NULL;
+      ir_program_free(ir);
+      return finish_run(ctx, 1);
+    }
+  }
+  if (ctx->pgo_out) ctx->pgo = pgo_profile_new(ir, checksum);
+  if (ctx->profile) { ctx->profiler = profiler_new(ir); ctx->profiler->source = path; }
+  PhaseMark t0 = phase_start(ctx);
+  int rc = ir_execute(ir, ctx);
+  phase_end(ctx, "execute", "run", t0);
+  if (ctx->sampler) {
+    sampler_stop(ctx->sampler);
+    if (!write_samples(ctx) && rc == 0) rc = 1;
+    sampler_free(ctx->sampler);
+    ctx->sampler = NULL;
+  }
+  if (ctx->profiler) {
+    if (!report_timing(ctx) && rc == 0) rc = 1;
+    if (ctx->annotate_out && !write_annotated(ctx, ir, path) && rc == 0) rc = 1;
+    profiler_free(ctx->profiler);
+    ctx->profiler = NULL;
+  }
+  if (ctx->pgo) {
+    if (!save_profile(ctx) && rc == 0) rc = 1;
+    pgo_profile_free(ctx->pgo);
+    ctx->pgo = NULL;
+  }
+  rc = finish_run(ctx, rc);
+  if (ctx->debug_exec) fprintf(stderr, "[exec] done rc=%d\n", rc);
+  ir_program_free(ir); return rc; }
+
+int liminal_run_file_streams(const char *path, FILE *in, FILE *out){
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  if (in) ctx.in = in;
+  if (out) ctx.out = out;
+  int rc = liminal_run_file_ctx(&ctx, path);
+  liminal_context_free(&ctx);
+  return rc;
+}
 
 int liminal_run_file(const char *path){ return liminal_run_file_streams(path, stdin, stdout); }
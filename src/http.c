@@ -0,0 +1,353 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/http.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define HTTP_CONNECT_TIMEOUT_MS 5000
+#define HTTP_IO_TIMEOUT_MS 120000
+#define HTTP_LINE_MAX 8192
+
+static char *message(const char *what, const char *detail){
+  size_t n = strlen(what) + strlen(detail) + 3;
+  char *m = malloc(n);
+  snprintf(m, n, "%s: %s", what, detail);
+  return m;
+}
+
+static const char *error_text(int err){
+  return err == EAGAIN || err == EWOULDBLOCK || err == ETIMEDOUT ? "timed out" : strerror(err);
+}
+
+HttpPool *http_pool_new(const char *url, char **errmsg){
+  if (strncmp(url, "http://", 7) != 0) { if (errmsg) *errmsg = message(url, "only http:// endpoints are supported"); return NULL; }
+  const char *host = url + 7;
+  const char *slash = strchr(host, '/');
+  size_t hostlen = slash ? (size_t)(slash - host) : strlen(host);
+  char *hostport = strndup(host, hostlen);
+  char *colon = strrchr(hostport, ':');
+  const char *port = "80";
+  if (colon) {
+    *colon = '\0';
+    port = colon + 1;
+  }
+  if (!*hostport || !*port || strspn(port, "0123456789") != strlen(port)) {
+    free(hostport);
+    if (errmsg) *errmsg = message(url, "malformed URL");
+    return NULL;
+  }
+  HttpPool *p = calloc(1, sizeof(HttpPool));
+  p->host = strdup(hostport);
+  p->port = strdup(port);
+  free(hostport);
+  size_t plen = slash ? strlen(slash) : 0;
+  while (plen && slash[plen - 1] == '/') plen--;
+  p->prefix = strndup(slash ? slash : "", plen);
+  p->connect_timeout_ms = HTTP_CONNECT_TIMEOUT_MS;
+  p->io_timeout_ms = HTTP_IO_TIMEOUT_MS;
+  pthread_mutex_init(&p->lock, NULL);
+  return p;
+}
+
+void http_pool_free(HttpPool *p){
+  if (!p) return;
+  for (size_t i = 0; i < p->nidle; i++) close(p->idle[i]);
+  pthread_mutex_destroy(&p->lock);
+  free(p->host);
+  free(p->port);
+  free(p->prefix);
+  free(p);
+}
+
+void http_response_free(HttpResponse *r){
+  if (!r) return;
+  free(r->body);
+  r->body = NULL;
+  r->len = 0;
+}
+
+// Non-blocking connect bounded by connect_timeout_ms; returns 0 or an errno
+static int connect_within(int fd, const struct sockaddr *addr, socklen_t len, long timeout_ms){
+  int flags = fcntl(fd, F_GETFL, 0);
+  fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  int err = 0;
+  if (connect(fd, addr, len) != 0) {
+    err = errno;
+    if (err == EINPROGRESS) {
+      struct pollfd pfd = { fd, POLLOUT, 0 };
+      int n;
+      do n = poll(&pfd, 1, (int)timeout_ms); while (n < 0 && errno == EINTR);
+      if (n == 0) err = ETIMEDOUT;
+      else if (n < 0) err = errno;
+      else {
+        socklen_t elen = sizeof(err);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &elen) != 0) err = errno;
+      }
+    }
+  }
+  fcntl(fd, F_SETFL, flags);
+  return err;
+}
+
+static int open_connection(HttpPool *p, char **errmsg){
+  struct addrinfo hints, *res = NULL;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  char where[320];
+  snprintf(where, sizeof(where), "connect to %s:%s", p->host, p->port);
+  int rc = getaddrinfo(p->host, p->port, &hints, &res);
+  if (rc != 0) { if (errmsg) *errmsg = message(where, gai_strerror(rc)); return -1; }
+  int fd = -1, err = ECONNREFUSED;
+  for (struct addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) { err = errno; continue; }
+    err = connect_within(fd, ai->ai_addr, ai->ai_addrlen, p->connect_timeout_ms);
+    if (err) { close(fd); fd = -1; }
+  }
+  freeaddrinfo(res);
+  if (fd < 0) { if (errmsg) *errmsg = message(where, error_text(err)); return -1; }
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  struct timeval tv = { p->io_timeout_ms / 1000, (p->io_timeout_ms % 1000) * 1000 };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  pthread_mutex_lock(&p->lock);
+  p->connects++;
+  pthread_mutex_unlock(&p->lock);
+  return fd;
+}
+
+static int take_idle(HttpPool *p){
+  pthread_mutex_lock(&p->lock);
+  int fd = p->nidle ? p->idle[--p->nidle] : -1;
+  pthread_mutex_unlock(&p->lock);
+  return fd;
+}
+
+static void give_back(HttpPool *p, int fd){
+  pthread_mutex_lock(&p->lock);
+  if (p->nidle < HTTP_POOL_IDLE) { p->idle[p->nidle++] = fd; fd = -1; }
+  pthread_mutex_unlock(&p->lock);
+  if (fd >= 0) close(fd);
+}
+
+static int send_all(int fd, const char *s, size_t n){
+  while (n) {
+    ssize_t w = send(fd, s, n, MSG_NOSIGNAL);
+    if (w < 0) { if (errno == EINTR) continue; return errno; }
+    s += w;
+    n -= (size_t)w;
+  }
+  return 0;
+}
+
+typedef struct {
+  int fd;
+  char buf[8192];
+  size_t pos, len;
+  size_t received;      // bytes of the response so far
+  int err;              // errno of a failed read; 0 at end of stream
+} Reader;
+
+static int fill(Reader *r){
+  ssize_t n;
+  do n = recv(r->fd, r->buf, sizeof(r->buf), 0); while (n < 0 && errno == EINTR);
+  if (n <= 0) { r->err = n < 0 ? errno : 0; return 0; }
+  r->pos = 0;
+  r->len = (size_t)n;
+  r->received += (size_t)n;
+  return 1;
+}
+
+// One line without its CRLF; 0 at end of stream or past HTTP_LINE_MAX
+static int read_line(Reader *r, char *line){
+  size_t n = 0;
+  for (;;) {
+    if (r->pos == r->len && !fill(r)) return 0;
+    char c = r->buf[r->pos++];
+    if (c == '\n') {
+      if (n && line[n - 1] == '\r') n--;
+      line[n] = '\0';
+      return 1;
+    }
+    if (n + 1 >= HTTP_LINE_MAX) return 0;
+    line[n++] = c;
+  }
+}
+
+// Where body bytes go: appended to out->body, or handed to on_data as they
+// arrive when streaming
+typedef struct {
+  HttpResponse *out;
+  size_t cap;
+  HttpDataFn on_data;
+  void *user;
+  int stopped;          // on_data asked to stop
+} Sink;
+
+static void append(HttpResponse *out, size_t *cap, const char *s, size_t n){
+  if (out->len + n + 1 > *cap) {
+    while (out->len + n + 1 > *cap) *cap = *cap ? *cap * 2 : 1024;
+    out->body = realloc(out->body, *cap);
+  }
+  memcpy(out->body + out->len, s, n);
+  out->len += n;
+  out->body[out->len] = '\0';
+}
+
+static int deliver(Sink *s, const char *data, size_t n){
+  if (!s->on_data) { append(s->out, &s->cap, data, n); return 1; }
+  if (!s->on_data(s->user, s->out->status, data, n)) s->stopped = 1;
+  return !s->stopped;
+}
+
+// Exactly n bytes of body, or (n == SIZE_MAX) everything until the server closes
+static int read_body(Reader *r, Sink *s, size_t n){
+  while (n) {
+    if (r->pos == r->len && !fill(r)) return n == SIZE_MAX && r->err == 0;
+    size_t take = r->len - r->pos;
+    if (n != SIZE_MAX && take > n) take = n;
+    r->pos += take;
+    if (n != SIZE_MAX) n -= take;
+    if (!deliver(s, r->buf + r->pos - take, take)) return 0;
+  }
+  return 1;
+}
+
+static int read_chunked(Reader *r, Sink *s, char *line){
+  for (;;) {
+    if (!read_line(r, line)) return 0;
+    char *end;
+    unsigned long long size = strtoull(line, &end, 16);
+    if (end == line) return 0;
+    if (size == 0) break;
+    if (!read_body(r, s, (size_t)size) || !read_line(r, line) || *line) return 0;
+  }
+  // Trailers up to the blank line
+  do if (!read_line(r, line)) return 0; while (*line);
+  return 1;
+}
+
+enum { EXCHANGE_OK, EXCHANGE_STALE, EXCHANGE_FAILED };
+
+// Sends one request and reads its response. STALE means nothing of the
+// response arrived, which on a kept connection means the server closed it.
+static int exchange(int fd, const char *head, size_t hlen, const char *body, size_t len,
+                    Sink *sink, int *keep, char **errmsg){
+  HttpResponse *out = sink->out;
+  int err = send_all(fd, head, hlen);
+  if (!err) err = send_all(fd, body, len);
+  if (err) { *errmsg = message("sending request", error_text(err)); return EXCHANGE_STALE; }
+  Reader *r = malloc(sizeof(Reader));
+  r->fd = fd;
+  r->pos = r->len = r->received = 0;
+  r->err = 0;
+  char *line = malloc(HTTP_LINE_MAX);
+  int rc = EXCHANGE_FAILED;
+  long length = -1;
+  int chunked = 0, minor = 0;
+  *keep = 1;
+  // 1xx responses precede the real one
+  do {
+    if (!read_line(r, line)) goto bad;
+    if (sscanf(line, "HTTP/1.%d %d", &minor, &out->status) != 2) goto bad;
+    for (;;) {
+      if (!read_line(r, line)) goto bad;
+      if (!*line) break;
+      char *colon = strchr(line, ':');
+      if (!colon) continue;
+      *colon = '\0';
+      char *value = colon + 1;
+      while (*value == ' ' || *value == '\t') value++;
+      if (strcasecmp(line, "Content-Length") == 0) length = strtol(value, NULL, 10);
+      else if (strcasecmp(line, "Transfer-Encoding") == 0) chunked = strstr(value, "chunked") != NULL;
+      else if (strcasecmp(line, "Connection") == 0) {
+        if (strcasecmp(value, "close") == 0) *keep = 0;
+        else if (strcasecmp(value, "keep-alive") == 0) minor = 1;
+      }
+    }
+  } while (out->status >= 100 && out->status < 200);
+  if (minor < 1) *keep = 0;
+  int ok;
+  if (out->status == 204 || out->status == 304) ok = 1;
+  else if (chunked) ok = read_chunked(r, sink, line);
+  else if (length >= 0) ok = read_body(r, sink, (size_t)length);
+  else { ok = read_body(r, sink, SIZE_MAX); *keep = 0; }
+  // A reader that stopped early leaves the rest of the body on the wire
+  if (sink->stopped) { *keep = 0; rc = EXCHANGE_OK; goto done; }
+  if (!ok) goto bad;
+  if (!out->body && !sink->on_data) append(out, &sink->cap, "", 0);
+  // Anything past the response means the framing is off; start afresh
+  if (r->pos != r->len) *keep = 0;
+  rc = EXCHANGE_OK;
+  goto done;
+bad:
+  if (r->received == 0) rc = EXCHANGE_STALE;
+  *errmsg = message("reading response", r->err ? error_text(r->err) : r->received ? "malformed or truncated" : "connection closed");
+  http_response_free(out);
+done:
+  free(line);
+  free(r);
+  return rc;
+}
+
+static int request(HttpPool *p, const char *path, const char *content_type, const char *body, size_t len,
+                   Sink *sink, char **errmsg){
+  HttpResponse *out = sink->out;
+  memset(out, 0, sizeof(*out));
+  int hlen = snprintf(NULL, 0,
+                      "POST %s%s HTTP/1.1\r\nHost: %s:%s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                      "Connection: keep-alive\r\n\r\n", p->prefix, path, p->host, p->port, content_type, len);
+  char *head = malloc((size_t)hlen + 1);
+  snprintf(head, (size_t)hlen + 1,
+           "POST %s%s HTTP/1.1\r\nHost: %s:%s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+           "Connection: keep-alive\r\n\r\n", p->prefix, path, p->host, p->port, content_type, len);
+  for (;;) {
+    int fd = take_idle(p);
+    int reused = fd >= 0;
+    if (!reused && (fd = open_connection(p, errmsg)) < 0) { free(head); return 0; }
+    int keep = 0;
+    char *why = NULL;
+    int rc = exchange(fd, head, (size_t)hlen, body, len, sink, &keep, &why);
+    if (rc == EXCHANGE_OK) {
+      if (keep) give_back(p, fd);
+      else close(fd);
+      free(head);
+      return 1;
+    }
+    close(fd);
+    // A kept connection the server dropped; try the next one or a new one
+    if (rc == EXCHANGE_STALE && reused) { free(why); continue; }
+    if (errmsg) *errmsg = why;
+    else free(why);
+    free(head);
+    return 0;
+  }
+}
+
+int http_post(HttpPool *p, const char *path, const char *content_type, const char *body, size_t len,
+              HttpResponse *out, char **errmsg){
+  Sink sink = { out, 0, NULL, NULL, 0 };
+  return request(p, path, content_type, body, len, &sink, errmsg);
+}
+
+int http_post_stream(HttpPool *p, const char *path, const char *content_type, const char *body, size_t len,
+                     HttpDataFn on_data, void *user, int *status, char **errmsg){
+  HttpResponse head;
+  Sink sink = { &head, 0, on_data, user, 0 };
+  int ok = request(p, path, content_type, body, len, &sink, errmsg);
+  if (ok && status) *status = head.status;
+  return ok;
+}
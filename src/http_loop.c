@@ -0,0 +1,664 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/http_loop.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct HttpCall {
+  HttpLoop *loop;
+  HttpPool *pool;
+  char *request;            // head and body, as sent
+  size_t len;
+  HttpResponse response;    // filled by the loop thread until done
+  size_t cap;
+  char *error;              // why it failed (malloc'd)
+  int done;                 // guarded by the loop's lock
+  pthread_cond_t finished;  // on the loop's lock
+  HttpCall *next;           // in the loop's queue of posted calls
+};
+
+static char *message(const char *what, const char *detail){
+  size_t n = strlen(what) + strlen(detail) + 3;
+  char *m = malloc(n);
+  snprintf(m, n, "%s: %s", what, detail);
+  return m;
+}
+
+#ifdef __linux__
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HTTP_LINE_MAX 8192
+#define HTTP_READ_CHUNK 16384
+#define HTTP_LOOP_EVENTS 64
+
+typedef enum { CONN_CONNECTING, CONN_SENDING, CONN_READING, CONN_IDLE } ConnState;
+
+// Where the response parser is; the body states take bytes, the others lines
+typedef enum {
+  PARSE_STATUS,
+  PARSE_HEADERS,
+  PARSE_LENGTH,
+  PARSE_CHUNK_SIZE,
+  PARSE_CHUNK_DATA,
+  PARSE_CHUNK_END,
+  PARSE_TRAILER,
+  PARSE_UNTIL_CLOSE,
+  PARSE_DONE
+} ParseState;
+
+typedef struct Endpoint Endpoint;
+
+typedef struct Conn {
+  int fd;
+  Endpoint *ep;
+  ConnState state;
+  HttpCall *call;           // NULL while idle
+  int reused;               // kept from an earlier request
+  struct addrinfo *addr;    // being connected to; the next ones follow
+  size_t sent;
+  char *in;                 // received and not parsed yet
+  size_t pos, in_len, in_cap;
+  size_t received;          // bytes of this response so far
+  ParseState parse;
+  size_t remaining;         // of the Content-Length body or the chunk
+  long length;
+  int chunked, minor, keep;
+  uint64_t deadline;        // monotonic ns; 0 while idle
+  struct Conn *prev, *next; // the loop's open connections
+} Conn;
+
+struct Endpoint {
+  HttpPool *pool;
+  struct addrinfo *addrs;   // resolved with the first connection
+  Conn *idle[HTTP_LOOP_IDLE];
+  size_t nidle;
+  Endpoint *next;
+};
+
+struct HttpLoop {
+  int epfd;
+  int wake;                 // eventfd: calls were posted or the loop is closing
+  pthread_t thread;
+  pthread_mutex_t lock;     // guards posted, closing, stats and the calls' done
+  HttpCall *posted;
+  HttpCall **posted_tail;
+  int closing;
+  HttpLoopStats stats;
+  Endpoint *endpoints;      // the rest belongs to the loop thread
+  Conn *conns;
+};
+
+static uint64_t now_ns(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static const char *error_text(int err){
+  return err == EAGAIN || err == EWOULDBLOCK || err == ETIMEDOUT ? "timed out" : strerror(err);
+}
+
+static uint64_t after_ms(long ms){
+  return now_ns() + (uint64_t)ms * 1000000ull;
+}
+
+static void watch(HttpLoop *l, Conn *c, int op, uint32_t events){
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = events;
+  ev.data.ptr = c;
+  epoll_ctl(l->epfd, op, c->fd, &ev);
+}
+
+// Hands the call back to its waiter; the loop must not touch it after
+static void finish(HttpLoop *l, HttpCall *call, char *error){
+  call->error = error;
+  if (!error && !call->response.body) {
+    call->response.body = malloc(1);
+    call->response.body[0] = '\0';
+  }
+  if (error) http_response_free(&call->response);
+  pthread_mutex_lock(&l->lock);
+  call->done = 1;
+  l->stats.in_flight--;
+  pthread_cond_signal(&call->finished);
+  pthread_mutex_unlock(&l->lock);
+}
+
+static void conn_free(HttpLoop *l, Conn *c){
+  if (c->fd >= 0) close(c->fd);
+  if (c->state == CONN_IDLE) {
+    Endpoint *ep = c->ep;
+    for (size_t i = 0; i < ep->nidle; i++)
+      if (ep->idle[i] == c) { ep->idle[i] = ep->idle[--ep->nidle]; break; }
+  }
+  if (c->prev) c->prev->next = c->next;
+  else l->conns = c->next;
+  if (c->next) c->next->prev = c->prev;
+  free(c->in);
+  free(c);
+}
+
+static Endpoint *endpoint_for(HttpLoop *l, HttpPool *pool){
+  for (Endpoint *ep = l->endpoints; ep; ep = ep->next)
+    if (ep->pool == pool) return ep;
+  Endpoint *ep = calloc(1, sizeof(Endpoint));
+  ep->pool = pool;
+  ep->next = l->endpoints;
+  l->endpoints = ep;
+  return ep;
+}
+
+static void append(HttpCall *call, const char *s, size_t n){
+  HttpResponse *out = &call->response;
+  if (out->len + n + 1 > call->cap) {
+    while (out->len + n + 1 > call->cap) call->cap = call->cap ? call->cap * 2 : 1024;
+    out->body = realloc(out->body, call->cap);
+  }
+  memcpy(out->body + out->len, s, n);
+  out->len += n;
+  out->body[out->len] = '\0';
+}
+
+// One line without its CRLF: 1, 0 until it is complete, -1 past HTTP_LINE_MAX
+static int take_line(Conn *c, char **line){
+  char *start = c->in + c->pos;
+  char *nl = memchr(start, '\n', c->in_len - c->pos);
+  if (!nl) return c->in_len - c->pos >= HTTP_LINE_MAX ? -1 : 0;
+  if ((size_t)(nl - start) >= HTTP_LINE_MAX) return -1;
+  *nl = '\0';
+  if (nl > start && nl[-1] == '\r') nl[-1] = '\0';
+  c->pos = (size_t)(nl - c->in) + 1;
+  *line = start;
+  return 1;
+}
+
+static void header(Conn *c, char *line){
+  char *colon = strchr(line, ':');
+  if (!colon) return;
+  *colon = '\0';
+  char *value = colon + 1;
+  while (*value == ' ' || *value == '\t') value++;
+  if (strcasecmp(line, "Content-Length") == 0) c->length = strtol(value, NULL, 10);
+  else if (strcasecmp(line, "Transfer-Encoding") == 0) c->chunked = strstr(value, "chunked") != NULL;
+  else if (strcasecmp(line, "Connection") == 0) {
+    if (strcasecmp(value, "close") == 0) c->keep = 0;
+    else if (strcasecmp(value, "keep-alive") == 0) c->minor = 1;
+  }
+}
+
+// Parses what has arrived: 1 once the response is complete, 0 while more
+// is needed, -1 when it is malformed
+static int parse(Conn *c){
+  HttpCall *call = c->call;
+  HttpResponse *out = &call->response;
+  int rc = 0;
+  while (rc == 0) {
+    if (c->parse == PARSE_DONE) { rc = 1; break; }
+    if (c->parse == PARSE_LENGTH || c->parse == PARSE_CHUNK_DATA || c->parse == PARSE_UNTIL_CLOSE) {
+      size_t take = c->in_len - c->pos;
+      if (c->parse != PARSE_UNTIL_CLOSE && take > c->remaining) take = c->remaining;
+      append(call, c->in + c->pos, take);
+      c->pos += take;
+      if (c->parse == PARSE_UNTIL_CLOSE) break;
+      c->remaining -= take;
+      if (c->remaining) break;
+      c->parse = c->parse == PARSE_LENGTH ? PARSE_DONE : PARSE_CHUNK_END;
+      continue;
+    }
+    char *line;
+    int got = take_line(c, &line);
+    if (got <= 0) { rc = got; break; }
+    char *end;
+    unsigned long long size;
+    switch (c->parse) {
+    case PARSE_STATUS:
+      c->length = -1;
+      c->chunked = 0;
+      if (sscanf(line, "HTTP/1.%d %d", &c->minor, &out->status) != 2) rc = -1;
+      else c->parse = PARSE_HEADERS;
+      break;
+    case PARSE_HEADERS:
+      if (*line) { header(c, line); break; }
+      // 1xx responses precede the real one
+      if (out->status >= 100 && out->status < 200) { c->parse = PARSE_STATUS; break; }
+      if (c->minor < 1) c->keep = 0;
+      if (out->status == 204 || out->status == 304) c->parse = PARSE_DONE;
+      else if (c->chunked) c->parse = PARSE_CHUNK_SIZE;
+      else if (c->length >= 0) { c->remaining = (size_t)c->length; c->parse = PARSE_LENGTH; }
+      else { c->parse = PARSE_UNTIL_CLOSE; c->keep = 0; }
+      break;
+    case PARSE_CHUNK_SIZE:
+      size = strtoull(line, &end, 16);
+      if (end == line) rc = -1;
+      else if (size == 0) c->parse = PARSE_TRAILER;
+      else { c->remaining = (size_t)size; c->parse = PARSE_CHUNK_DATA; }
+      break;
+    case PARSE_CHUNK_END:
+      if (*line) rc = -1;
+      else c->parse = PARSE_CHUNK_SIZE;
+      break;
+    case PARSE_TRAILER:
+      if (!*line) c->parse = PARSE_DONE;
+      break;
+    default:
+      break;
+    }
+  }
+  c->in_len -= c->pos;
+  memmove(c->in, c->in + c->pos, c->in_len);
+  c->pos = 0;
+  return rc;
+}
+
+static void start_call(HttpLoop *l, HttpCall *call);
+
+static void begin_send(HttpLoop *l, Conn *c, HttpCall *call);
+
+// The call failed on c. A kept connection the server closed or reset
+// before answering (end of stream, ECONNRESET, EPIPE) was closed meanwhile:
+// the call goes out again on another one. A timeout is not retried; the
+// server may still be working on the request.
+static void conn_failed(HttpLoop *l, Conn *c, const char *what, int err){
+  HttpCall *call = c->call;
+  int stale = c->reused && c->received == 0 && (err == 0 || err == ECONNRESET || err == EPIPE);
+  char *why = stale ? NULL
+                    : message(what, err ? error_text(err) : c->received ? "malformed or truncated" : "connection closed");
+  conn_free(l, c);
+  if (stale) {
+    free(call->response.body);
+    memset(&call->response, 0, sizeof(call->response));
+    call->cap = 0;
+    start_call(l, call);
+  } else {
+    finish(l, call, why);
+  }
+}
+
+// Keeps the connection for the endpoint's next call, or closes it
+static void complete(HttpLoop *l, Conn *c){
+  HttpCall *call = c->call;
+  Endpoint *ep = c->ep;
+  c->call = NULL;
+  // Anything past the response means the framing is off; start afresh
+  if (c->keep && c->in_len == 0 && ep->nidle < HTTP_LOOP_IDLE) {
+    c->state = CONN_IDLE;
+    c->deadline = 0;
+    ep->idle[ep->nidle++] = c;
+    watch(l, c, EPOLL_CTL_MOD, EPOLLIN);
+  } else {
+    conn_free(l, c);
+  }
+  finish(l, call, NULL);
+}
+
+static void do_send(HttpLoop *l, Conn *c){
+  HttpCall *call = c->call;
+  while (c->sent < call->len) {
+    ssize_t w = send(c->fd, call->request + c->sent, call->len - c->sent, MSG_NOSIGNAL);
+    if (w < 0) {
+      if (errno == EINTR) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) conn_failed(l, c, "sending request", errno);
+      return;
+    }
+    c->sent += (size_t)w;
+    c->deadline = after_ms(call->pool->io_timeout_ms);
+  }
+  c->state = CONN_READING;
+  watch(l, c, EPOLL_CTL_MOD, EPOLLIN);
+}
+
+static void do_read(HttpLoop *l, Conn *c){
+  if (c->in_len + HTTP_READ_CHUNK > c->in_cap) {
+    c->in_cap = c->in_len + HTTP_READ_CHUNK;
+    c->in = realloc(c->in, c->in_cap);
+  }
+  ssize_t n;
+  do n = recv(c->fd, c->in + c->in_len, c->in_cap - c->in_len, 0); while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK) conn_failed(l, c, "reading response", errno);
+    return;
+  }
+  if (n == 0) {
+    // The server closes to end a body without a length
+    if (c->parse == PARSE_UNTIL_CLOSE) { c->keep = 0; complete(l, c); }
+    else conn_failed(l, c, "reading response", 0);
+    return;
+  }
+  c->in_len += (size_t)n;
+  c->received += (size_t)n;
+  c->deadline = after_ms(c->call->pool->io_timeout_ms);
+  int rc = parse(c);
+  if (rc > 0) complete(l, c);
+  else if (rc < 0) conn_failed(l, c, "reading response", 0);
+}
+
+static void begin_send(HttpLoop *l, Conn *c, HttpCall *call){
+  c->call = call;
+  c->state = CONN_SENDING;
+  c->sent = 0;
+  c->received = 0;
+  c->pos = c->in_len = 0;
+  c->parse = PARSE_STATUS;
+  c->keep = 1;
+  c->deadline = after_ms(call->pool->io_timeout_ms);
+  watch(l, c, EPOLL_CTL_MOD, EPOLLOUT);
+  do_send(l, c);
+}
+
+// Starts a non-blocking connect to c->addr or, failing that, the addresses
+// after it; fails the call once none is left
+static void try_connect(HttpLoop *l, Conn *c, int err){
+  HttpPool *p = c->ep->pool;
+  for (; c->addr; c->addr = c->addr->ai_next) {
+    struct addrinfo *ai = c->addr;
+    int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) { err = errno; continue; }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0 && errno != EINPROGRESS) {
+      err = errno;
+      close(fd);
+      continue;
+    }
+    // Even a connect that is already done reports through EPOLLOUT
+    c->fd = fd;
+    c->state = CONN_CONNECTING;
+    c->deadline = after_ms(p->connect_timeout_ms);
+    watch(l, c, EPOLL_CTL_ADD, EPOLLOUT);
+    return;
+  }
+  char where[320];
+  snprintf(where, sizeof(where), "connect to %s:%s", p->host, p->port);
+  HttpCall *call = c->call;
+  conn_free(l, c);
+  finish(l, call, message(where, error_text(err)));
+}
+
+static void connect_done(HttpLoop *l, Conn *c){
+  int err = 0;
+  socklen_t elen = sizeof(err);
+  if (getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &elen) != 0) err = errno;
+  if (err) {
+    close(c->fd);
+    c->fd = -1;
+    c->addr = c->addr->ai_next;
+    try_connect(l, c, err);
+    return;
+  }
+  int one = 1;
+  setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  HttpPool *p = c->ep->pool;
+  pthread_mutex_lock(&p->lock);
+  p->connects++;
+  pthread_mutex_unlock(&p->lock);
+  pthread_mutex_lock(&l->lock);
+  l->stats.connects++;
+  pthread_mutex_unlock(&l->lock);
+  begin_send(l, c, c->call);
+}
+
+// On a kept connection of the endpoint, or a new one
+static void start_call(HttpLoop *l, HttpCall *call){
+  Endpoint *ep = endpoint_for(l, call->pool);
+  if (ep->nidle) {
+    Conn *c = ep->idle[--ep->nidle];
+    c->reused = 1;
+    begin_send(l, c, call);
+    return;
+  }
+  if (!ep->addrs) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    int rc = getaddrinfo(call->pool->host, call->pool->port, &hints, &ep->addrs);
+    if (rc != 0) {
+      ep->addrs = NULL;
+      char where[320];
+      snprintf(where, sizeof(where), "connect to %s:%s", call->pool->host, call->pool->port);
+      finish(l, call, message(where, gai_strerror(rc)));
+      return;
+    }
+  }
+  Conn *c = calloc(1, sizeof(Conn));
+  c->fd = -1;
+  c->ep = ep;
+  c->call = call;
+  c->addr = ep->addrs;
+  c->next = l->conns;
+  if (l->conns) l->conns->prev = c;
+  l->conns = c;
+  try_connect(l, c, ECONNREFUSED);
+}
+
+static void on_event(HttpLoop *l, Conn *c){
+  switch (c->state) {
+  case CONN_CONNECTING: connect_done(l, c); break;
+  case CONN_SENDING: do_send(l, c); break;
+  case CONN_READING: do_read(l, c); break;
+  // A kept connection only becomes readable when the server closes it
+  case CONN_IDLE: conn_free(l, c); break;
+  }
+}
+
+// Fails or moves on whatever waited too long. Handling one connection may
+// free others (a call that goes out again can fail on a kept connection),
+// so the walk starts over after each; those handled are gone or have a
+// later deadline.
+static void expire(HttpLoop *l){
+  uint64_t now = now_ns();
+  Conn *c = l->conns;
+  while (c) {
+    if (!c->deadline || c->deadline > now) { c = c->next; continue; }
+    if (c->state == CONN_CONNECTING) {
+      close(c->fd);
+      c->fd = -1;
+      c->addr = c->addr->ai_next;
+      try_connect(l, c, ETIMEDOUT);
+    } else {
+      conn_failed(l, c, c->state == CONN_SENDING ? "sending request" : "reading response", ETIMEDOUT);
+    }
+    c = l->conns;
+  }
+}
+
+static int next_timeout(HttpLoop *l){
+  uint64_t soonest = 0;
+  for (Conn *c = l->conns; c; c = c->next)
+    if (c->deadline && (!soonest || c->deadline < soonest)) soonest = c->deadline;
+  if (!soonest) return -1;
+  uint64_t now = now_ns();
+  return soonest <= now ? 0 : (int)((soonest - now + 999999) / 1000000);
+}
+
+static void *run(void *arg){
+  HttpLoop *l = arg;
+  struct epoll_event events[HTTP_LOOP_EVENTS];
+  int closing = 0;
+  while (!closing) {
+    int n = epoll_wait(l->epfd, events, HTTP_LOOP_EVENTS, next_timeout(l));
+    if (n < 0 && errno != EINTR) break;
+    for (int i = 0; i < n; i++) {
+      Conn *c = events[i].data.ptr;
+      if (c) { on_event(l, c); continue; }
+      uint64_t count;
+      while (read(l->wake, &count, sizeof(count)) > 0) {}
+      pthread_mutex_lock(&l->lock);
+      HttpCall *posted = l->posted;
+      l->posted = NULL;
+      l->posted_tail = &l->posted;
+      closing = l->closing;
+      pthread_mutex_unlock(&l->lock);
+      while (posted) {
+        HttpCall *call = posted;
+        posted = call->next;
+        call->next = NULL;
+        if (closing) finish(l, call, strdup("event loop closed"));
+        else start_call(l, call);
+      }
+    }
+    expire(l);
+  }
+  while (l->conns) {
+    Conn *c = l->conns;
+    HttpCall *call = c->call;
+    conn_free(l, c);
+    if (call) finish(l, call, strdup("event loop closed"));
+  }
+  return NULL;
+}
+
+HttpLoop *http_loop_new(char **errmsg){
+  HttpLoop *l = calloc(1, sizeof(HttpLoop));
+  l->epfd = epoll_create1(EPOLL_CLOEXEC);
+  l->wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  l->posted_tail = &l->posted;
+  pthread_mutex_init(&l->lock, NULL);
+  int err = l->epfd < 0 || l->wake < 0 ? errno : 0;
+  if (!err) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(l->epfd, EPOLL_CTL_ADD, l->wake, &ev) != 0) err = errno;
+  }
+  if (!err) err = pthread_create(&l->thread, NULL, run, l);
+  if (err) {
+    if (errmsg) *errmsg = message("starting the HTTP event loop", strerror(err));
+    if (l->epfd >= 0) close(l->epfd);
+    if (l->wake >= 0) close(l->wake);
+    pthread_mutex_destroy(&l->lock);
+    free(l);
+    return NULL;
+  }
+  return l;
+}
+
+static void wake_up(HttpLoop *l){
+  uint64_t one = 1;
+  ssize_t w;
+  do w = write(l->wake, &one, sizeof(one)); while (w < 0 && errno == EINTR);
+}
+
+void http_loop_free(HttpLoop *l){
+  if (!l) return;
+  pthread_mutex_lock(&l->lock);
+  l->closing = 1;
+  pthread_mutex_unlock(&l->lock);
+  wake_up(l);
+  pthread_join(l->thread, NULL);
+  while (l->endpoints) {
+    Endpoint *ep = l->endpoints;
+    l->endpoints = ep->next;
+    if (ep->addrs) freeaddrinfo(ep->addrs);
+    free(ep);
+  }
+  close(l->epfd);
+  close(l->wake);
+  pthread_mutex_destroy(&l->lock);
+  free(l);
+}
+
+HttpCall *http_loop_post(HttpLoop *l, HttpPool *p, const char *path, const char *content_type, const char *body,
+                         size_t len){
+  HttpCall *c = calloc(1, sizeof(HttpCall));
+  c->loop = l;
+  c->pool = p;
+  pthread_cond_init(&c->finished, NULL);
+  int hlen = snprintf(NULL, 0,
+                      "POST %s%s HTTP/1.1\r\nHost: %s:%s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                      "Connection: keep-alive\r\n\r\n", p->prefix, path, p->host, p->port, content_type, len);
+  c->len = (size_t)hlen + len;
+  c->request = malloc(c->len + 1);
+  snprintf(c->request, (size_t)hlen + 1,
+           "POST %s%s HTTP/1.1\r\nHost: %s:%s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+           "Connection: keep-alive\r\n\r\n", p->prefix, path, p->host, p->port, content_type, len);
+  if (len) memcpy(c->request + hlen, body, len);
+  pthread_mutex_lock(&l->lock);
+  *l->posted_tail = c;
+  l->posted_tail = &c->next;
+  l->stats.requests++;
+  if (++l->stats.in_flight > l->stats.peak) l->stats.peak = l->stats.in_flight;
+  pthread_mutex_unlock(&l->lock);
+  wake_up(l);
+  return c;
+}
+
+void http_loop_stats(HttpLoop *l, HttpLoopStats *out){
+  pthread_mutex_lock(&l->lock);
+  *out = l->stats;
+  pthread_mutex_unlock(&l->lock);
+}
+
+int http_call_done(HttpCall *c){
+  pthread_mutex_lock(&c->loop->lock);
+  int done = c->done;
+  pthread_mutex_unlock(&c->loop->lock);
+  return done;
+}
+
+int http_call_wait(HttpCall *c, HttpResponse *out, char **errmsg){
+  HttpLoop *l = c->loop;
+  pthread_mutex_lock(&l->lock);
+  while (!c->done) pthread_cond_wait(&c->finished, &l->lock);
+  pthread_mutex_unlock(&l->lock);
+  int ok = c->error == NULL;
+  if (ok) *out = c->response;
+  else memset(out, 0, sizeof(*out));
+  if (!ok && errmsg) *errmsg = c->error;
+  else free(c->error);
+  pthread_cond_destroy(&c->finished);
+  free(c->request);
+  free(c);
+  return ok;
+}
+
+#else
+
+HttpLoop *http_loop_new(char **errmsg){
+  if (errmsg) *errmsg = message("starting the HTTP event loop", "needs epoll (Linux)");
+  return NULL;
+}
+
+void http_loop_free(HttpLoop *l){
+  (void)l;
+}
+
+void http_loop_stats(HttpLoop *l, HttpLoopStats *out){
+  (void)l;
+  memset(out, 0, sizeof(*out));
+}
+
+HttpCall *http_loop_post(HttpLoop *l, HttpPool *p, const char *path, const char *content_type, const char *body,
+                         size_t len){
+  (void)l; (void)p; (void)path; (void)content_type; (void)body; (void)len;
+  return NULL;
+}
+
+int http_call_done(HttpCall *c){
+  (void)c;
+  return 1;
+}
+
+int http_call_wait(HttpCall *c, HttpResponse *out, char **errmsg){
+  (void)c;
+  memset(out, 0, sizeof(*out));
+  if (errmsg) *errmsg = message("HTTP event loop", "needs epoll (Linux)");
+  return 0;
+}
+
+#endif
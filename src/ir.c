@@ -1,15 +1,17 @@
 #define _POSIX_C_SOURCE 200809L
 #include "liminal/ir.h"
 #include "liminal/symtab.h"
+#include "liminal/alloc.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/mman.h>
 
-static void *xmalloc(size_t n) { void *p = malloc(n); if (!p) { fprintf(stderr,"OOM\n"); exit(1);} memset(p,0,n); return p; }
+static void *xmalloc(size_t n) { void *p = lm_malloc(n); if (!p) { fprintf(stderr,"OOM\n"); exit(1);} memset(p,0,n); return p; }
 
-static const char *op_name(IrOp op) {
+const char *ir_op_name(IrOp op) {
   switch (op) {
   case IR_NOP: return "NOP";
   case IR_CONST_INT: return "CONST_INT";
@@ -51,10 +53,44 @@ static const char *op_name(IrOp op) {
   case IR_CONST_BOOL: return "CONST_BOOL";
   case IR_CONST_OPTIONAL_NONE: return "CONST_OPTIONAL_NONE";
   case IR_INDEX: return "INDEX";
+  case IR_STREAM_OPEN: return "STREAM_OPEN";
+  case IR_STREAM_NEXT: return "STREAM_NEXT";
+  case IR_FORK: return "FORK";
+  case IR_JOIN: return "JOIN";
+  case IR_ASK_START: return "ASK_START";
+  case IR_AWAIT: return "AWAIT";
+  case IR_ARITH_CONST: return "ARITH_CONST";
+  case IR_INC_VAR: return "INC_VAR";
+  case IR_ADD_STORE: return "ADD_STORE";
+  case IR_CMP_BRANCH: return "CMP_BRANCH";
+  case IR_CMP_CONST_BRANCH: return "CMP_CONST_BRANCH";
   }
   return "?";
 }
 
+int ir_instr_temp_refs(IrInstr *ins, int *refs[3]) {
+  int n = 0;
+  switch (ins->op) {
+  case IR_CONST_INT: case IR_CONST_REAL: case IR_CONST_STRING: case IR_CONST_BOOL: case IR_CONST_OPTIONAL_NONE:
+  case IR_LOAD_VAR:
+    refs[n++] = &ins->dest; break;
+  case IR_STORE_VAR: case IR_JUMP_IF_FALSE: case IR_RET: case IR_PRINT: case IR_PRINTLN: case IR_CMP_CONST_BRANCH:
+    refs[n++] = &ins->arg1; break;
+  case IR_JUMP: case IR_LABEL: case IR_READLN: case IR_NOP: case IR_FORK: case IR_JOIN:
+    break;
+  case IR_WRITE_FILE: case IR_CMP_BRANCH:
+    refs[n++] = &ins->arg1; refs[n++] = &ins->arg2; break;
+  case IR_READ_FILE: case IR_RESULT_IS_OK: case IR_RESULT_UNWRAP_ERR: case IR_MAKE_RESULT_OK: case IR_MAKE_RESULT_ERR:
+  case IR_ARITH_CONST: case IR_INC_VAR: case IR_STREAM_OPEN: case IR_STREAM_NEXT: case IR_AWAIT:
+    refs[n++] = &ins->dest; refs[n++] = &ins->arg1; break;
+  case IR_INDEX:
+    refs[n++] = &ins->dest; refs[n++] = &ins->arg2; break;
+  default:
+    refs[n++] = &ins->dest; refs[n++] = &ins->arg1; refs[n++] = &ins->arg2; break;
+  }
+  return n;
+}
+
 IrProgram *ir_program_new(void) {
   IrProgram *p = xmalloc(sizeof(IrProgram));
   memset(p, 0, sizeof(IrProgram));
@@ -64,7 +100,7 @@ IrProgram *ir_program_new(void) {
 static void ir_instr_vec_push(IrInstrVec *v, IrInstr instr) {
   if (v->len == v->cap) {
     v->cap = v->cap ? v->cap * 2 : 8;
-    v->items = realloc(v->items, v->cap * sizeof(IrInstr));
+    v->items = lm_realloc(v->items, v->cap * sizeof(IrInstr));
   }
   v->items[v->len++] = instr;
 }
@@ -72,7 +108,7 @@ static void ir_instr_vec_push(IrInstrVec *v, IrInstr instr) {
 static void ir_func_vec_push(IrFuncVec *v, IrFunc f) {
   if (v->len == v->cap) {
     v->cap = v->cap ? v->cap * 2 : 4;
-    v->items = realloc(v->items, v->cap * sizeof(IrFunc));
+    v->items = lm_realloc(v->items, v->cap * sizeof(IrFunc));
   }
   v->items[v->len++] = f;
 }
@@ -81,26 +117,179 @@ void ir_program_add_func(IrProgram *prog, IrFunc func) {
   ir_func_vec_push(&prog->funcs, func);
 }
 
-static void free_instrs(IrInstrVec *v) {
-  for (size_t i = 0; i < v->len; ++i) {
-    free(v->items[i].s);
-    free(v->items[i].s2);
+static void free_instrs(IrInstrVec *v, int borrowed) {
+  for (size_t i = 0; i < v->len && !borrowed; ++i) {
+    lm_free(v->items[i].s);
+    lm_free(v->items[i].s2);
   }
-  free(v->items);
+  lm_free(v->items);
+}
+
+static char *own_str(const char *s) { return s ? lm_strdup(s) : NULL; }
+
+void ir_program_own_strings(IrProgram *prog) {
+  if (!prog || !prog->image) return;
+  for (size_t i = 0; i < prog->funcs.len; ++i) {
+    IrFunc *f = &prog->funcs.items[i];
+    f->name = own_str(f->name);
+    for (int j = 0; j < f->param_count; ++j) f->params[j] = own_str(f->params[j]);
+    for (size_t j = 0; j < f->instrs.len; ++j) {
+      f->instrs.items[j].s = own_str(f->instrs.items[j].s);
+      f->instrs.items[j].s2 = own_str(f->instrs.items[j].s2);
+    }
+  }
+  munmap(prog->image, prog->image_len);
+  prog->image = NULL;
+  prog->image_len = 0;
 }
 
 void ir_program_free(IrProgram *prog) {
   if (!prog) return;
+  // strings of a mapped image live in its string pool
+  int borrowed = prog->image != NULL;
   for (size_t i = 0; i < prog->funcs.len; ++i) {
-    free(prog->funcs.items[i].name);
-    for (int j = 0; j < prog->funcs.items[i].param_count; ++j) free(prog->funcs.items[i].params[j]);
-    free(prog->funcs.items[i].params);
-    free_instrs(&prog->funcs.items[i].instrs);
+    if (!borrowed) {
+      lm_free(prog->funcs.items[i].name);
+      for (int j = 0; j < prog->funcs.items[i].param_count; ++j) lm_free(prog->funcs.items[i].params[j]);
+    }
+    lm_free(prog->funcs.items[i].params);
+    free_instrs(&prog->funcs.items[i].instrs, borrowed);
+    lm_free(prog->funcs.items[i].lines.items);
   }
-  free(prog->funcs.items);
+  lm_free(prog->funcs.items);
   for (size_t i = 0; i < prog->schemas.len; ++i) type_free(prog->schemas.items[i]);
-  free(prog->schemas.items);
-  free(prog);
+  lm_free(prog->schemas.items);
+  for (size_t i = 0; i < prog->owned_types.len; ++i) {
+    Type *t = prog->owned_types.items[i];
+    // tuple items are tracked here too, so free only the tuple itself
+    if (t->kind == TYPEK_TUPLE) { lm_free(t->as.tuple.items); lm_free(t); }
+    else type_free(t);
+  }
+  lm_free(prog->owned_types.items);
+  if (prog->image) munmap(prog->image, prog->image_len);
+  lm_free(prog);
+}
+
+// One instruction as ir_program_print shows it; snprintf semantics
+static int format_instr(char *out, size_t cap, const IrInstr *ins) {
+  int n = 0;
+  switch (ins->op) {
+  case IR_CONST_INT:
+    n = snprintf(out, cap, "  t%d = %s %d\n", ins->dest, ir_op_name(ins->op), ins->arg1);
+    break;
+  case IR_CONST_REAL:
+    n = snprintf(out, cap, "  t%d = %s %g\n", ins->dest, ir_op_name(ins->op), ins->f);
+    break;
+  case IR_CONST_STRING:
+    n = snprintf(out, cap, "  t%d = %s \"%s\"\n", ins->dest, ir_op_name(ins->op), ins->s ? ins->s : "");
+    break;
+  case IR_CONST_OPTIONAL_NONE:
+    n = snprintf(out, cap, "  t%d = CONST_NONE\n", ins->dest);
+    break;
+  case IR_CONST_BOOL:
+    n = snprintf(out, cap, "  t%d = %s %d\n", ins->dest, ir_op_name(ins->op), ins->arg1);
+    break;
+  case IR_INDEX:
+    n = snprintf(out, cap, "  t%d = %s %s t%d\n", ins->dest, ir_op_name(ins->op), ins->s?ins->s:"", ins->arg2);
+    break;
+  case IR_LOAD_VAR:
+    n = snprintf(out, cap, "  t%d = %s %s\n", ins->dest, ir_op_name(ins->op), ins->s);
+    break;
+  case IR_STORE_VAR:
+    n = snprintf(out, cap, "  %s = t%d\n", ins->s, ins->arg1);
+    break;
+  case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_MOD:
+  case IR_EQ: case IR_NEQ: case IR_LT: case IR_GT: case IR_LE: case IR_GE:
+    n = snprintf(out, cap, "  t%d = %s t%d, t%d\n", ins->dest, ir_op_name(ins->op), ins->arg1, ins->arg2);
+    break;
+  case IR_JUMP: case IR_FORK:
+    n = snprintf(out, cap, "  %s L%s\n", ir_op_name(ins->op), ins->s);
+    break;
+  case IR_JOIN:
+    n = snprintf(out, cap, "  %s\n", ir_op_name(ins->op));
+    break;
+  case IR_JUMP_IF_FALSE:
+    n = snprintf(out, cap, "  %s t%d, L%s\n", ir_op_name(ins->op), ins->arg1, ins->s);
+    break;
+  case IR_LABEL:
+    n = snprintf(out, cap, "L%s:\n", ins->s);
+    break;
+  case IR_RET:
+    n = snprintf(out, cap, "  RET t%d\n", ins->arg1);
+    break;
+  case IR_PRINT:
+    n = snprintf(out, cap, "  %s t%d\n", ir_op_name(ins->op), ins->arg1);
+    break;
+  case IR_PRINTLN:
+    if (ins->arg1 >= 0) n = snprintf(out, cap, "  %s t%d\n", ir_op_name(ins->op), ins->arg1);
+    else n = snprintf(out, cap, "  %s\n", ir_op_name(ins->op));
+    break;
+  case IR_READLN:
+    n = snprintf(out, cap, "  %s %s\n", ir_op_name(ins->op), ins->s);
+    break;
+  case IR_READ_FILE:
+    n = snprintf(out, cap, "  t%d = %s t%d\n", ins->dest, ir_op_name(ins->op), ins->arg1);
+    break;
+  case IR_WRITE_FILE:
+    n = snprintf(out, cap, "  %s t%d, t%d\n", ir_op_name(ins->op), ins->arg1, ins->arg2);
+    break;
+  case IR_ASK: case IR_ASK_START:
+    if (ins->s2 && ins->s2[0])
+      n = snprintf(out, cap, "  t%d = %s t%d, fallback t%d oracle %s schema %s\n", ins->dest, ir_op_name(ins->op), ins->arg1, ins->arg2, ins->s ? ins->s : "", ins->s2);
+    else
+      n = snprintf(out, cap, "  t%d = %s t%d, fallback t%d oracle %s\n", ins->dest, ir_op_name(ins->op), ins->arg1, ins->arg2, ins->s ? ins->s : "");
+    break;
+  case IR_STREAM_OPEN:
+    n = snprintf(out, cap, "  t%d = %s t%d oracle %s\n", ins->dest, ir_op_name(ins->op), ins->arg1, ins->s ? ins->s : "");
+    break;
+  case IR_STREAM_NEXT: case IR_AWAIT:
+    n = snprintf(out, cap, "  t%d = %s t%d\n", ins->dest, ir_op_name(ins->op), ins->arg1);
+    break;
+  case IR_RESULT_UNWRAP:
+    n = snprintf(out, cap, "  t%d = %s t%d, t%d\n", ins->dest, ir_op_name(ins->op), ins->arg1, ins->arg2);
+    break;
+  case IR_RESULT_UNWRAP_ERR:
+    n = snprintf(out, cap, "  t%d = %s t%d\n", ins->dest, ir_op_name(ins->op), ins->arg1);
+    break;
+  case IR_RESULT_IS_OK:
+    n = snprintf(out, cap, "  t%d = %s t%d\n", ins->dest, ir_op_name(ins->op), ins->arg1);
+    break;
+  case IR_CONCAT:
+    n = snprintf(out, cap, "  t%d = %s t%d, t%d\n", ins->dest, ir_op_name(ins->op), ins->arg1, ins->arg2);
+    break;
+  case IR_RESULT_OR_FALLBACK:
+    n = snprintf(out, cap, "  t%d = %s t%d, t%d\n", ins->dest, ir_op_name(ins->op), ins->arg1, ins->arg2);
+    break;
+  case IR_AND:
+  case IR_OR:
+    n = snprintf(out, cap, "  t%d = %s t%d, t%d\n", ins->dest, ir_op_name(ins->op), ins->arg1, ins->arg2);
+    break;
+  case IR_CALL:
+    if (ins->arg2 >= 0)
+      n = snprintf(out, cap, "  t%d = %s %s t%d, t%d\n", ins->dest, ir_op_name(ins->op), ins->s ? ins->s : "", ins->arg1, ins->arg2);
+    else
+      n = snprintf(out, cap, "  t%d = %s %s t%d\n", ins->dest, ir_op_name(ins->op), ins->s ? ins->s : "", ins->arg1);
+    break;
+  case IR_ARITH_CONST:
+    n = snprintf(out, cap, "  t%d = %s %s t%d, %d\n", ins->dest, ir_op_name(ins->op), ir_op_name(ins->fused), ins->arg1, ins->arg2);
+    break;
+  case IR_INC_VAR:
+    n = snprintf(out, cap, "  %s = t%d = %s t%d, %d\n", ins->s, ins->dest, ir_op_name(ins->op), ins->arg1, ins->arg2);
+    break;
+  case IR_ADD_STORE:
+    n = snprintf(out, cap, "  %s = t%d = %s t%d, t%d\n", ins->s, ins->dest, ir_op_name(ins->op), ins->arg1, ins->arg2);
+    break;
+  case IR_CMP_BRANCH:
+    n = snprintf(out, cap, "  %s %s t%d, t%d, L%s\n", ir_op_name(ins->op), ir_op_name(ins->fused), ins->arg1, ins->arg2, ins->s);
+    break;
+  case IR_CMP_CONST_BRANCH:
+    n = snprintf(out, cap, "  %s %s t%d, %d, L%s\n", ir_op_name(ins->op), ir_op_name(ins->fused), ins->arg1, ins->arg2, ins->s);
+    break;
+  case IR_NOP:
+  default:
+    n = snprintf(out, cap, "  %s\n", ir_op_name(ins->op));
+  }
+  return n;
 }
 
 char *ir_program_print(const IrProgram *prog) {
@@ -109,17 +298,17 @@ char *ir_program_print(const IrProgram *prog) {
   buf[0] = '\0';
   if (prog->schemas.len > 0) {
     int n = snprintf(buf + len, cap - len, "schemas\n");
-    if (len + n + 1 > cap) { cap *= 2; buf = realloc(buf, cap); n = snprintf(buf + len, cap - len, "schemas\n"); }
+    if (len + n + 1 > cap) { cap *= 2; buf = lm_realloc(buf, cap); n = snprintf(buf + len, cap - len, "schemas\n"); }
     len += n;
     for (size_t si = 0; si < prog->schemas.len; ++si) {
       Type *s = prog->schemas.items[si];
       n = snprintf(buf + len, cap - len, "  %s\n", s->as.schema.name ? s->as.schema.name : "(null)");
-      if (len + n + 1 > cap) { cap *= 2; buf = realloc(buf, cap); n = snprintf(buf + len, cap - len, "  %s\n", s->as.schema.name ? s->as.schema.name : "(null)"); }
+      if (len + n + 1 > cap) { cap *= 2; buf = lm_realloc(buf, cap); n = snprintf(buf + len, cap - len, "  %s\n", s->as.schema.name ? s->as.schema.name : "(null)"); }
       len += n;
       for (size_t fi = 0; fi < s->as.schema.len; ++fi) {
         SchemaField *sf = &s->as.schema.items[fi];
         n = snprintf(buf + len, cap - len, "    %s\n", sf->name ? sf->name : "(null)");
-        if (len + n + 1 > cap) { cap *= 2; buf = realloc(buf, cap); n = snprintf(buf + len, cap - len, "    %s\n", sf->name ? sf->name : "(null)"); }
+        if (len + n + 1 > cap) { cap *= 2; buf = lm_realloc(buf, cap); n = snprintf(buf + len, cap - len, "    %s\n", sf->name ? sf->name : "(null)"); }
         len += n;
       }
     }
@@ -127,120 +316,144 @@ char *ir_program_print(const IrProgram *prog) {
   for (size_t i = 0; i < prog->funcs.len; ++i) {
     const IrFunc *f = &prog->funcs.items[i];
     int n = snprintf(buf + len, cap - len, "func %s\n", f->name);
-    if (len + n + 1 > cap) { cap *= 2; buf = realloc(buf, cap); i--; continue; }
+    if (len + n + 1 > cap) { cap *= 2; buf = lm_realloc(buf, cap); i--; continue; }
     len += n;
     for (size_t j = 0; j < f->instrs.len; ++j) {
-      const IrInstr *ins = &f->instrs.items[j];
-      switch (ins->op) {
-      case IR_CONST_INT:
-        n = snprintf(buf + len, cap - len, "  t%d = %s %d\n", ins->dest, op_name(ins->op), ins->arg1);
-        break;
-      case IR_CONST_REAL:
-        n = snprintf(buf + len, cap - len, "  t%d = %s %g\n", ins->dest, op_name(ins->op), ins->f);
-        break;
-      case IR_CONST_STRING:
-        n = snprintf(buf + len, cap - len, "  t%d = %s \"%s\"\n", ins->dest, op_name(ins->op), ins->s ? ins->s : "");
-        break;
-      case IR_CONST_OPTIONAL_NONE:
-        n = snprintf(buf + len, cap - len, "  t%d = CONST_NONE\n", ins->dest);
-        break;
-    case IR_CONST_BOOL:
-        n = snprintf(buf + len, cap - len, "  t%d = %s %d\n", ins->dest, op_name(ins->op), ins->arg1);
-        break;
-    case IR_INDEX:
-        n = snprintf(buf + len, cap - len, "  t%d = %s %s t%d\n", ins->dest, op_name(ins->op), ins->s?ins->s:"", ins->arg2);
-        break;
-      case IR_LOAD_VAR:
-        n = snprintf(buf + len, cap - len, "  t%d = %s %s\n", ins->dest, op_name(ins->op), ins->s);
-        break;
-      case IR_STORE_VAR:
-        n = snprintf(buf + len, cap - len, "  %s = t%d\n", ins->s, ins->arg1);
-        break;
-      case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_MOD:
-      case IR_EQ: case IR_NEQ: case IR_LT: case IR_GT: case IR_LE: case IR_GE:
-        n = snprintf(buf + len, cap - len, "  t%d = %s t%d, t%d\n", ins->dest, op_name(ins->op), ins->arg1, ins->arg2);
-        break;
-      case IR_JUMP:
-        n = snprintf(buf + len, cap - len, "  %s L%s\n", op_name(ins->op), ins->s);
-        break;
-      case IR_JUMP_IF_FALSE:
-        n = snprintf(buf + len, cap - len, "  %s t%d, L%s\n", op_name(ins->op), ins->arg1, ins->s);
-        break;
-      case IR_LABEL:
-        n = snprintf(buf + len, cap - len, "L%s:\n", ins->s);
-        break;
-      case IR_RET:
-        n = snprintf(buf + len, cap - len, "  RET t%d\n", ins->arg1);
-        break;
-      case IR_PRINT:
-        n = snprintf(buf + len, cap - len, "  %s t%d\n", op_name(ins->op), ins->arg1);
-        break;
-      case IR_PRINTLN:
-        if (ins->arg1 >= 0) n = snprintf(buf + len, cap - len, "  %s t%d\n", op_name(ins->op), ins->arg1);
-        else n = snprintf(buf + len, cap - len, "  %s\n", op_name(ins->op));
-        break;
-      case IR_READLN:
-        n = snprintf(buf + len, cap - len, "  %s %s\n", op_name(ins->op), ins->s);
-        break;
-      case IR_READ_FILE:
-        n = snprintf(buf + len, cap - len, "  t%d = %s t%d\n", ins->dest, op_name(ins->op), ins->arg1);
-        break;
-      case IR_WRITE_FILE:
-        n = snprintf(buf + len, cap - len, "  %s t%d, t%d\n", op_name(ins->op), ins->arg1, ins->arg2);
-        break;
-      case IR_ASK:
-        if (ins->s2 && ins->s2[0])
-          n = snprintf(buf + len, cap - len, "  t%d = %s t%d, fallback t%d oracle %s schema %s\n", ins->dest, op_name(ins->op), ins->arg1, ins->arg2, ins->s ? ins->s : "", ins->s2);
-        else
-          n = snprintf(buf + len, cap - len, "  t%d = %s t%d, fallback t%d oracle %s\n", ins->dest, op_name(ins->op), ins->arg1, ins->arg2, ins->s ? ins->s : "");
-        break;
-      case IR_RESULT_UNWRAP:
-        n = snprintf(buf + len, cap - len, "  t%d = %s t%d, t%d\n", ins->dest, op_name(ins->op), ins->arg1, ins->arg2);
-        break;
-      case IR_RESULT_UNWRAP_ERR:
-        n = snprintf(buf + len, cap - len, "  t%d = %s t%d\n", ins->dest, op_name(ins->op), ins->arg1);
-        break;
-      case IR_RESULT_IS_OK:
-        n = snprintf(buf + len, cap - len, "  t%d = %s t%d\n", ins->dest, op_name(ins->op), ins->arg1);
-        break;
-      case IR_CONCAT:
-        n = snprintf(buf + len, cap - len, "  t%d = %s t%d, t%d\n", ins->dest, op_name(ins->op), ins->arg1, ins->arg2);
-        break;
-      case IR_RESULT_OR_FALLBACK:
-        n = snprintf(buf + len, cap - len, "  t%d = %s t%d, t%d\n", ins->dest, op_name(ins->op), ins->arg1, ins->arg2);
-        break;
-      case IR_AND:
-      case IR_OR:
-        n = snprintf(buf + len, cap - len, "  t%d = %s t%d, t%d\n", ins->dest, op_name(ins->op), ins->arg1, ins->arg2);
-        break;
-      case IR_CALL:
-        if (ins->arg2 >= 0)
-          n = snprintf(buf + len, cap - len, "  t%d = %s %s t%d, t%d\n", ins->dest, op_name(ins->op), ins->s ? ins->s : "", ins->arg1, ins->arg2);
-        else
-          n = snprintf(buf + len, cap - len, "  t%d = %s %s t%d\n", ins->dest, op_name(ins->op), ins->s ? ins->s : "", ins->arg1);
-        break;
-      case IR_NOP:
-      default:
-        n = snprintf(buf + len, cap - len, "  %s\n", op_name(ins->op));
-      }
-      if (len + n + 1 > cap) { cap *= 2; buf = realloc(buf, cap); j--; continue; }
+      n = format_instr(buf + len, cap - len, &f->instrs.items[j]);
+      if (len + n + 1 > cap) { cap *= 2; buf = lm_realloc(buf, cap); j--; continue; }
       len += n;
     }
-    if (len + 2 > cap) { cap *= 2; buf = realloc(buf, cap); }
+    if (len + 2 > cap) { cap *= 2; buf = lm_realloc(buf, cap); }
     buf[len++] = '\n'; buf[len] = '\0';
   }
   return buf;
 }
 
+// Start of each source line, so annotations can quote them
+static const char **line_starts(const char *source, size_t *count) {
+  size_t n = 1, cap = 64;
+  const char **starts = xmalloc(cap * sizeof(char *));
+  starts[0] = source;
+  for (const char *p = source; *p; ++p) {
+    if (*p != '\n') continue;
+    if (n == cap) { cap *= 2; starts = lm_realloc(starts, cap * sizeof(char *)); }
+    starts[n++] = p + 1;
+  }
+  *count = n;
+  return starts;
+}
+
+char *ir_program_print_annotated(const IrProgram *prog, const char *source, uint64_t *const *counts) {
+  char *buf = NULL;
+  size_t len = 0, nlines = 0;
+  FILE *out = open_memstream(&buf, &len);
+  const char **starts = source ? line_starts(source, &nlines) : NULL;
+  if (prog->schemas.len > 0) {
+    fprintf(out, "schemas\n");
+    for (size_t si = 0; si < prog->schemas.len; ++si) {
+      Type *t = prog->schemas.items[si];
+      fprintf(out, "  %s\n", t->as.schema.name ? t->as.schema.name : "(null)");
+      for (size_t fi = 0; fi < t->as.schema.len; ++fi) fprintf(out, "    %s\n", t->as.schema.items[fi].name ? t->as.schema.items[fi].name : "(null)");
+    }
+    fputc('\n', out);
+  }
+  char ins_buf[512];
+  for (size_t i = 0; i < prog->funcs.len; ++i) {
+    const IrFunc *f = &prog->funcs.items[i];
+    fprintf(out, "func %s\n", f->name);
+    int shown = 0;
+    for (size_t j = 0, e = 0; j < f->instrs.len; ++j) {
+      while (e < f->lines.len && f->lines.items[e].start <= j) {
+        int line = f->lines.items[e++].span.line;
+        if (line <= 0 || line == shown) continue;
+        shown = line;
+        if (starts && (size_t)line <= nlines) {
+          const char *text = starts[line - 1];
+          while (*text == ' ' || *text == '\t') text++;
+          int tn = (int)strcspn(text, "\r\n");
+          fprintf(out, "; %d: %.*s\n", line, tn, text);
+        } else {
+          fprintf(out, "; %d\n", line);
+        }
+      }
+      if (counts) fprintf(out, "%12llu ", (unsigned long long)(counts[i] ? counts[i][j] : 0));
+      int n = format_instr(ins_buf, sizeof(ins_buf), &f->instrs.items[j]);
+      if (n >= (int)sizeof(ins_buf)) fprintf(out, "%.*s...\n", (int)sizeof(ins_buf) - 5, ins_buf);
+      else fputs(ins_buf, out);
+    }
+    fputc('\n', out);
+  }
+  fclose(out);
+  lm_free(starts);
+  return buf;
+}
+
 // Builder helpers
 static int ir_func_new_temp(IrFunc *f) { return f->next_temp++; }
 
-static void emit(IrInstrVec *v, IrInstr ins) { ir_instr_vec_push(v, ins); }
+static int same_span(LiminalSpan a, LiminalSpan b) {
+  return a.line == b.line && a.column == b.column && a.offset == b.offset && a.length == b.length;
+}
+
+static void push_line(IrLineVec *v, uint32_t start, LiminalSpan span) {
+  if (v->len == v->cap) {
+    v->cap = v->cap ? v->cap * 2 : 8;
+    v->items = lm_realloc(v->items, v->cap * sizeof(IrLine));
+  }
+  v->items[v->len++] = (IrLine){start, span};
+}
+
+// Opens a new line table entry whenever the span changes
+static void emit(IrFunc *f, IrInstr ins) {
+  IrLineVec *lines = &f->lines;
+  LiminalSpan cur = lines->len ? lines->items[lines->len - 1].span : (LiminalSpan){0};
+  if (!same_span(cur, f->span)) {
+    if (lines->len && lines->items[lines->len - 1].start == f->instrs.len) lines->items[lines->len - 1].span = f->span;
+    else push_line(lines, (uint32_t)f->instrs.len, f->span);
+  }
+  ir_instr_vec_push(&f->instrs, ins);
+}
+
+LiminalSpan ir_func_set_span(IrFunc *f, LiminalSpan span) {
+  LiminalSpan prev = f->span;
+  f->span = span;
+  return prev;
+}
+
+LiminalSpan ir_func_span_at(const IrFunc *f, size_t ip) {
+  // last entry starting at or before ip
+  size_t lo = 0, hi = f->lines.len;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (f->lines.items[mid].start <= ip) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo ? f->lines.items[lo - 1].span : (LiminalSpan){0};
+}
+
+LiminalSpan *ir_func_spans(const IrFunc *f) {
+  LiminalSpan *spans = xmalloc(sizeof(LiminalSpan) * (f->instrs.len ? f->instrs.len : 1));
+  for (size_t i = 0, e = 0; i < f->instrs.len; ++i) {
+    while (e < f->lines.len && f->lines.items[e].start <= i) e++;
+    if (e) spans[i] = f->lines.items[e - 1].span;
+  }
+  return spans;
+}
+
+void ir_func_set_spans(IrFunc *f, const LiminalSpan *spans, size_t n) {
+  f->lines.len = 0;
+  LiminalSpan cur = {0};
+  for (size_t i = 0; i < n; ++i) {
+    if (same_span(cur, spans[i])) continue;
+    push_line(&f->lines, (uint32_t)i, spans[i]);
+    cur = spans[i];
+  }
+}
 
 // Public builder API (used by translator)
 IrFunc ir_func_create(const char *name) {
   IrFunc f = {0};
-  f.name = strdup(name);
+  f.name = lm_strdup(name);
   f.params = NULL;
   f.param_count = 0;
   f.next_temp = 0;
@@ -250,147 +463,357 @@ IrFunc ir_func_create(const char *name) {
 int ir_emit_const_int(IrFunc *f, int value) {
   int t = ir_func_new_temp(f);
   IrInstr ins = {.op = IR_CONST_INT, .dest = t, .arg1 = value};
-  emit(&f->instrs, ins);
+  emit(f, ins);
   return t;
 }
 int ir_emit_const_bool(IrFunc *f, int value) {
   int t = ir_func_new_temp(f);
   IrInstr ins = {.op = IR_CONST_BOOL, .dest = t, .arg1 = value};
-  emit(&f->instrs, ins);
+  emit(f, ins);
   return t;
 }
 int ir_emit_const_optional_none(IrFunc *f) {
   int t = ir_func_new_temp(f);
   IrInstr ins = {.op = IR_CONST_OPTIONAL_NONE, .dest = t};
-  emit(&f->instrs, ins);
+  emit(f, ins);
   return t;
 }
 
 int ir_emit_const_string(IrFunc *f, const char *s) {
   int t = ir_func_new_temp(f);
-  IrInstr ins = {.op = IR_CONST_STRING, .dest = t, .s = strdup(s)};
-  emit(&f->instrs, ins);
+  IrInstr ins = {.op = IR_CONST_STRING, .dest = t, .s = lm_strdup(s)};
+  emit(f, ins);
   return t;
 }
 
 int ir_emit_const_real(IrFunc *f, double value) {
   int t = ir_func_new_temp(f);
   IrInstr ins = {.op = IR_CONST_REAL, .dest = t, .f = value};
-  emit(&f->instrs, ins);
+  emit(f, ins);
   return t;
 }
 
 int ir_emit_binop(IrFunc *f, IrOp op, int lhs, int rhs) {
   int t = ir_func_new_temp(f);
   IrInstr ins = {.op = op, .dest = t, .arg1 = lhs, .arg2 = rhs};
-  emit(&f->instrs, ins);
+  emit(f, ins);
   return t;
 }
 
 int ir_emit_load_var(IrFunc *f, const char *name) {
   int t = ir_func_new_temp(f);
-  IrInstr ins = {.op = IR_LOAD_VAR, .dest = t, .s = strdup(name)};
-  emit(&f->instrs, ins);
+  IrInstr ins = {.op = IR_LOAD_VAR, .dest = t, .s = lm_strdup(name)};
+  emit(f, ins);
   return t;
 }
 
 void ir_emit_store_var(IrFunc *f, const char *name, int src_temp) {
-  IrInstr ins = {.op = IR_STORE_VAR, .s = strdup(name), .arg1 = src_temp};
-  emit(&f->instrs, ins);
+  IrInstr ins = {.op = IR_STORE_VAR, .s = lm_strdup(name), .arg1 = src_temp};
+  emit(f, ins);
 }
 
 void ir_emit_jump(IrFunc *f, const char *label) {
-  IrInstr ins = {.op = IR_JUMP, .s = strdup(label)};
-  emit(&f->instrs, ins);
+  IrInstr ins = {.op = IR_JUMP, .s = lm_strdup(label)};
+  emit(f, ins);
 }
 
 void ir_emit_jump_if_false(IrFunc *f, int cond_temp, const char *label) {
-  IrInstr ins = {.op = IR_JUMP_IF_FALSE, .arg1 = cond_temp, .s = strdup(label)};
-  emit(&f->instrs, ins);
+  IrInstr ins = {.op = IR_JUMP_IF_FALSE, .arg1 = cond_temp, .s = lm_strdup(label)};
+  emit(f, ins);
 }
 
 void ir_emit_label(IrFunc *f, const char *label) {
-  IrInstr ins = {.op = IR_LABEL, .s = strdup(label)};
-  emit(&f->instrs, ins);
+  IrInstr ins = {.op = IR_LABEL, .s = lm_strdup(label)};
+  emit(f, ins);
 }
 
 void ir_emit_ret(IrFunc *f, int temp) {
   IrInstr ins = {.op = IR_RET, .arg1 = temp};
-  emit(&f->instrs, ins);
+  emit(f, ins);
 }
 
 void ir_emit_print(IrFunc *f, int temp, int newline) {
   IrInstr ins = {.op = newline ? IR_PRINTLN : IR_PRINT, .arg1 = temp};
-  emit(&f->instrs, ins);
+  emit(f, ins);
 }
 
 void ir_emit_readln(IrFunc *f, const char *name) {
-  IrInstr ins = {.op = IR_READLN, .s = strdup(name)};
-  emit(&f->instrs, ins);
+  IrInstr ins = {.op = IR_READLN, .s = lm_strdup(name)};
+  emit(f, ins);
 }
 
 int ir_emit_read_file(IrFunc *f, int path_temp) {
   int t = ir_func_new_temp(f);
   IrInstr ins = {.op = IR_READ_FILE, .dest = t, .arg1 = path_temp};
-  emit(&f->instrs, ins);
+  emit(f, ins);
   return t;
 }
 
 void ir_emit_write_file(IrFunc *f, int path_temp, int content_temp) {
   IrInstr ins = {.op = IR_WRITE_FILE, .arg1 = path_temp, .arg2 = content_temp};
-  emit(&f->instrs, ins);
+  emit(f, ins);
 }
 
 int ir_emit_ask(IrFunc *f, int prompt_temp, int fallback_temp, const char *oracle_name, const char *schema_name) {
   int t = ir_func_new_temp(f);
   IrInstr ins = {.op = IR_ASK, .dest = t, .arg1 = prompt_temp, .arg2 = fallback_temp,
-                 .s = oracle_name ? strdup(oracle_name) : NULL,
-                 .s2 = schema_name ? strdup(schema_name) : NULL};
-  emit(&f->instrs, ins);
+                 .s = oracle_name ? lm_strdup(oracle_name) : NULL,
+                 .s2 = schema_name ? lm_strdup(schema_name) : NULL};
+  emit(f, ins);
   return t;
 }
 
+int ir_emit_stream_open(IrFunc *f, int prompt_temp, const char *oracle_name) {
+  IrInstr ins = {.op = IR_STREAM_OPEN, .dest = ir_func_new_temp(f), .arg1 = prompt_temp, .arg2 = -1,
+                 .s = oracle_name ? lm_strdup(oracle_name) : NULL};
+  emit(f, ins);
+  return ins.dest;
+}
+
+int ir_emit_stream_next(IrFunc *f, int stream_temp) {
+  IrInstr ins = {.op = IR_STREAM_NEXT, .dest = ir_func_new_temp(f), .arg1 = stream_temp, .arg2 = -1};
+  emit(f, ins);
+  return ins.dest;
+}
+
 int ir_emit_result_unwrap_err(IrFunc *f, int result_temp) {
   IrInstr ins = {.op = IR_RESULT_UNWRAP_ERR, .dest = ir_func_new_temp(f), .arg1 = result_temp};
-  emit(&f->instrs, ins);
+  emit(f, ins);
   return ins.dest;
 }
 
 int ir_emit_result_unwrap(IrFunc *f, int result_temp, int fallback_temp) {
   int t = ir_func_new_temp(f);
   IrInstr ins = {.op = IR_RESULT_UNWRAP, .dest = t, .arg1 = result_temp, .arg2 = fallback_temp};
-  emit(&f->instrs, ins);
+  emit(f, ins);
   return t;
 }
 
 int ir_emit_result_is_ok(IrFunc *f, int result_temp) {
   int t = ir_func_new_temp(f);
   IrInstr ins = {.op = IR_RESULT_IS_OK, .dest = t, .arg1 = result_temp};
-  emit(&f->instrs, ins);
+  emit(f, ins);
   return t;
 }
 
 int ir_emit_concat(IrFunc *f, int a_temp, int b_temp) {
   int t = ir_func_new_temp(f);
   IrInstr ins = {.op = IR_CONCAT, .dest = t, .arg1 = a_temp, .arg2 = b_temp};
-  emit(&f->instrs, ins);
+  emit(f, ins);
   return t;
 }
 
 int ir_emit_result_or_fallback(IrFunc *f, int result_temp, int fallback_temp) {
   int t = ir_func_new_temp(f);
   IrInstr ins = {.op = IR_RESULT_OR_FALLBACK, .dest = t, .arg1 = result_temp, .arg2 = fallback_temp};
-  emit(&f->instrs, ins);
+  emit(f, ins);
   return t;
 }
 
 int ir_emit_call(IrFunc *f, const char *fname, int arg0_temp, int arg1_temp) {
   int t = ir_func_new_temp(f);
-  IrInstr ins = {.op = IR_CALL, .dest = t, .arg1 = arg0_temp, .arg2 = arg1_temp, .s = fname ? strdup(fname) : NULL};
-  emit(&f->instrs, ins);
+  IrInstr ins = {.op = IR_CALL, .dest = t, .arg1 = arg0_temp, .arg2 = arg1_temp, .s = fname ? lm_strdup(fname) : NULL};
+  emit(f, ins);
   return t;
 }
 
+void ir_emit_fork(IrFunc *f, const char *end_label) {
+  IrInstr ins = {.op = IR_FORK, .dest = -1, .arg1 = -1, .arg2 = -1, .s = lm_strdup(end_label)};
+  emit(f, ins);
+}
+
+void ir_emit_join(IrFunc *f) {
+  IrInstr ins = {.op = IR_JOIN, .dest = -1, .arg1 = -1, .arg2 = -1};
+  emit(f, ins);
+}
+
+long ir_fork_join(const IrFunc *f, size_t ip) {
+  size_t n = f->instrs.len;
+  if (ip >= n || f->instrs.items[ip].op != IR_FORK) return -1;
+  while (ip < n && f->instrs.items[ip].op == IR_FORK) {
+    const char *end = f->instrs.items[ip].s;
+    size_t at = ip + 1;
+    while (at < n && !(f->instrs.items[at].op == IR_LABEL && end && strcmp(f->instrs.items[at].s, end) == 0)) at++;
+    if (at == n) return -1;
+    ip = at + 1;
+  }
+  return ip < n && f->instrs.items[ip].op == IR_JOIN ? (long)ip : -1;
+}
+
+// ===== Asynchronous asks =====
+// An AWAIT must run on every path its ask does, so it only moves down past
+// straight-line code and past closed regions (loops and ifs entered at the
+// top and left at the bottom only). It also stops at anything that may
+// reach an oracle (asks, streams, parallel blocks, calls of functions that
+// do): one ask per frame is in flight, and providers see asks in program
+// order, as they did when every ask waited. An AWAIT carrying a store stops
+// at any access to the stored variable, calls of functions that may read it
+// included. Only stores to whole variables travel with their AWAIT: a
+// record field or array element may also be reached through another
+// record that refers to it (Value.ref), under a name that shares nothing
+// with the store's, so an ask stored there awaits right away.
+
+static long func_index(const IrProgram *prog, const char *name) {
+  for (size_t i = 0; i < prog->funcs.len; ++i) if (name && strcmp(prog->funcs.items[i].name, name) == 0) return (long)i;
+  return -1;
+}
+
+// "R.x" and "R.1" are parts of R
+static int same_root(const char *a, const char *b) {
+  size_t n = strcspn(a, ".");
+  return n == strcspn(b, ".") && strncmp(a, b, n) == 0;
+}
+
+// may[i]: function i asks, streams, or calls a function that may
+static char *oracle_funcs(const IrProgram *prog) {
+  char *may = lm_calloc(prog->funcs.len ? prog->funcs.len : 1, 1);
+  for (int changed = 1; changed; ) {
+    changed = 0;
+    for (size_t fi = 0; fi < prog->funcs.len; ++fi) {
+      const IrFunc *f = &prog->funcs.items[fi];
+      for (size_t i = 0; i < f->instrs.len && !may[fi]; ++i) {
+        const IrInstr *ins = &f->instrs.items[i];
+        long k = ins->op == IR_CALL ? func_index(prog, ins->s) : -1;
+        if (ins->op == IR_ASK || ins->op == IR_ASK_START || ins->op == IR_STREAM_OPEN || (k >= 0 && may[k])) may[fi] = changed = 1;
+      }
+    }
+  }
+  return may;
+}
+
+static int func_reads(const IrProgram *prog, size_t fi, const char *var, char *seen) {
+  if (seen[fi]) return 0;
+  seen[fi] = 1;
+  const IrFunc *f = &prog->funcs.items[fi];
+  for (size_t i = 0; i < f->instrs.len; ++i) {
+    const IrInstr *ins = &f->instrs.items[i];
+    if ((ins->op == IR_LOAD_VAR || ins->op == IR_INDEX) && ins->s && same_root(ins->s, var)) return 1;
+    long k = ins->op == IR_CALL ? func_index(prog, ins->s) : -1;
+    if (k >= 0 && func_reads(prog, (size_t)k, var, seen)) return 1;
+  }
+  return 0;
+}
+
+static int is_const(IrOp op) {
+  return op == IR_CONST_INT || op == IR_CONST_REAL || op == IR_CONST_STRING || op == IR_CONST_BOOL || op == IR_CONST_OPTIONAL_NONE || op == IR_NOP;
+}
+
+static int mentions_temp(const IrInstr *ins, int t) {
+  IrInstr copy = *ins;
+  int *refs[3];
+  int n = ir_instr_temp_refs(&copy, refs);
+  for (int i = 0; i < n; ++i) if (*refs[i] == t) return 1;
+  return 0;
+}
+
+// Whether the AWAIT of temp t, carrying a store to var (or NULL), may move
+// below ins
+static int await_may_pass(const IrProgram *prog, const char *may_ask, const IrInstr *ins, int t, const char *var) {
+  if (mentions_temp(ins, t)) return 0;
+  switch (ins->op) {
+  case IR_LABEL: case IR_JUMP: case IR_JUMP_IF_FALSE: case IR_RET: case IR_CMP_BRANCH: case IR_CMP_CONST_BRANCH:
+  case IR_ASK: case IR_ASK_START: case IR_AWAIT: case IR_STREAM_OPEN: case IR_STREAM_NEXT: case IR_FORK: case IR_JOIN:
+    return 0;
+  case IR_LOAD_VAR: case IR_STORE_VAR: case IR_INDEX: case IR_READLN: case IR_INC_VAR: case IR_ADD_STORE:
+    return !var || !ins->s || !same_root(ins->s, var);
+  case IR_CALL: {
+    long k = func_index(prog, ins->s);
+    if (k < 0) return 1;
+    if (may_ask[k]) return 0;
+    if (!var) return 1;
+    char *seen = lm_calloc(prog->funcs.len, 1);
+    int reads = func_reads(prog, (size_t)k, var, seen);
+    lm_free(seen);
+    return !reads;
+  }
+  default:
+    return 1;
+  }
+}
+
+// One past the smallest closed region starting at k that the AWAIT may
+// move below (adding its instructions other than constants and control to
+// *work), or 0 if a barrier comes first
+static size_t region_end(const IrProgram *prog, const char *may_ask, const IrFunc *f, size_t k, int t, const char *var, size_t *work) {
+  size_t n = f->instrs.len, end = 0, w = 0;
+  long *target = lm_calloc(n ? n : 1, sizeof(long));
+  for (size_t j = 0; j < n; ++j) {
+    const IrInstr *ins = &f->instrs.items[j];
+    target[j] = -1;
+    if (ins->op != IR_JUMP && ins->op != IR_JUMP_IF_FALSE && ins->op != IR_FORK && ins->op != IR_CMP_BRANCH && ins->op != IR_CMP_CONST_BRANCH) continue;
+    target[j] = (long)n; // a missing label counts as outside
+    for (size_t l = 0; l < n; ++l)
+      if (f->instrs.items[l].op == IR_LABEL && strcmp(f->instrs.items[l].s, ins->s) == 0) { target[j] = (long)l; break; }
+  }
+  for (size_t e = k; e < n; ++e) {
+    const IrInstr *ins = &f->instrs.items[e];
+    int control = ins->op == IR_LABEL || ins->op == IR_JUMP || ins->op == IR_JUMP_IF_FALSE;
+    if (control ? mentions_temp(ins, t) : !await_may_pass(prog, may_ask, ins, t, var)) break;
+    if (!control && !is_const(ins->op)) w++;
+    if (ins->op == IR_JUMP) continue;
+    int closed = 1;
+    for (size_t j = 0; j < n && closed; ++j)
+      if (target[j] >= 0) closed = (j >= k && j <= e) == (target[j] >= (long)k && target[j] <= (long)e);
+    if (closed) { end = e + 1; *work += w; break; }
+  }
+  lm_free(target);
+  return end;
+}
+
+size_t ir_defer_awaits(IrProgram *prog) {
+  size_t split = 0;
+  char *may_ask = oracle_funcs(prog);
+  for (size_t fi = 0; fi < prog->funcs.len; ++fi) {
+    IrFunc *f = &prog->funcs.items[fi];
+    LiminalSpan *spans = NULL;
+    for (size_t i = 0; i < f->instrs.len; ++i) {
+      if (f->instrs.items[i].op != IR_ASK || f->instrs.items[i].dest < 0) continue;
+      int t = f->instrs.items[i].dest;
+      size_t c = i + 1 < f->instrs.len && f->instrs.items[i + 1].op == IR_STORE_VAR && f->instrs.items[i + 1].arg1 == t &&
+                 f->instrs.items[i + 1].s && !strchr(f->instrs.items[i + 1].s, '.');
+      IrInstr store = c ? f->instrs.items[i + 1] : (IrInstr){0};
+      size_t k = i + 1 + c;
+      size_t work = 0;
+      for (;;) {
+        if (k < f->instrs.len && await_may_pass(prog, may_ask, &f->instrs.items[k], t, c ? store.s : NULL)) {
+          if (!is_const(f->instrs.items[k++].op)) work++;
+          continue;
+        }
+        size_t e = k < f->instrs.len ? region_end(prog, may_ask, f, k, t, c ? store.s : NULL, &work) : 0;
+        if (!e) break;
+        k = e;
+      }
+      if (!work) continue; // nothing worth a thread before the answer is needed
+      if (f->lines.len && !spans) spans = ir_func_spans(f);
+      // ASK; [store]; <overlapped>; <use>  ->  ASK_START; <overlapped>; AWAIT; [store]; <use>
+      IrInstr await = {.op = IR_AWAIT, .dest = t, .arg1 = ir_func_new_temp(f), .arg2 = -1};
+      f->instrs.items[i].op = IR_ASK_START;
+      f->instrs.items[i].dest = await.arg1;
+      ir_instr_vec_push(&f->instrs, await);
+      IrInstr *it = f->instrs.items;
+      size_t len = f->instrs.len;
+      memmove(&it[k + 1], &it[k], (len - 1 - k) * sizeof(IrInstr));
+      memmove(&it[i + 1], &it[i + 1 + c], (k - i - 1 - c) * sizeof(IrInstr));
+      it[k - c] = await;
+      if (c) it[k] = store;
+      if (spans) {
+        LiminalSpan store_span = spans[i + c];
+        spans = lm_realloc(spans, len * sizeof(LiminalSpan));
+        memmove(&spans[k + 1], &spans[k], (len - 1 - k) * sizeof(LiminalSpan));
+        memmove(&spans[i + 1], &spans[i + 1 + c], (k - i - 1 - c) * sizeof(LiminalSpan));
+        spans[k - c] = spans[i];
+        if (c) spans[k] = store_span;
+      }
+      i = k;
+      split++;
+    }
+    if (spans) ir_func_set_spans(f, spans, f->instrs.len);
+    lm_free(spans);
+  }
+  lm_free(may_ask);
+  return split;
+}
+
 // ===== Validator =====
 static int label_exists(const char *label, char **labels, size_t n) {
   for (size_t i = 0; i < n; ++i) if (strcmp(labels[i], label) == 0) return 1;
@@ -408,31 +831,31 @@ int ir_validate(const IrProgram *prog, char **errmsg) {
         if (label_exists(ins->s, labels, nlabels)) {
           if (errmsg) {
             size_t len = snprintf(NULL, 0, "duplicate label %s in func %s", ins->s, f->name);
-            *errmsg = malloc(len + 1);
+            *errmsg = lm_malloc(len + 1);
             snprintf(*errmsg, len + 1, "duplicate label %s in func %s", ins->s, f->name);
           }
-          free(labels);
+          lm_free(labels);
           return 0;
         }
-        if (nlabels == cap) { cap = cap ? cap * 2 : 8; labels = realloc(labels, cap * sizeof(char *)); }
+        if (nlabels == cap) { cap = cap ? cap * 2 : 8; labels = lm_realloc(labels, cap * sizeof(char *)); }
         labels[nlabels++] = ins->s;
       }
     }
     for (size_t i = 0; i < f->instrs.len; ++i) {
       const IrInstr *ins = &f->instrs.items[i];
-      if (ins->op == IR_JUMP || ins->op == IR_JUMP_IF_FALSE) {
+      if (ins->op == IR_JUMP || ins->op == IR_JUMP_IF_FALSE || ins->op == IR_FORK) {
         if (!label_exists(ins->s, labels, nlabels)) {
           if (errmsg) {
             size_t len = snprintf(NULL, 0, "missing label %s in func %s", ins->s, f->name);
-            *errmsg = malloc(len + 1);
+            *errmsg = lm_malloc(len + 1);
             snprintf(*errmsg, len + 1, "missing label %s in func %s", ins->s, f->name);
           }
-          free(labels);
+          lm_free(labels);
           return 0;
         }
       }
     }
-    free(labels);
+    lm_free(labels);
   }
   return 1;
 }
@@ -475,22 +898,34 @@ static IrOp binop_to_ir(int op) {
   }
 }
 
-static int lower_expr(IrFunc *f, const ASTExpr *e);
-static void lower_stmt(IrFunc *f, const ASTStmt *s);
+static int lower_expr(const LiminalContext *ctx, IrFunc *f, const ASTExpr *e);
+static void lower_stmt(const LiminalContext *ctx, IrFunc *f, const ASTStmt *s);
 
 int ir_emit_make_result_ok(IrFunc *f, int arg_temp) {
   IrInstr ins = {.op = IR_MAKE_RESULT_OK, .dest = ir_func_new_temp(f), .arg1 = arg_temp};
-  emit(&f->instrs, ins);
+  emit(f, ins);
   return ins.dest;
 }
 int ir_emit_make_result_err(IrFunc *f, int arg_temp) {
   IrInstr ins = {.op = IR_MAKE_RESULT_ERR, .dest = ir_func_new_temp(f), .arg1 = arg_temp};
-  emit(&f->instrs, ins);
+  emit(f, ins);
   return ins.dest;
 }
 
-static int lower_expr(IrFunc *f, const ASTExpr *e) {
+static int lower_expr_kind(const LiminalContext *ctx, IrFunc *f, const ASTExpr *e);
+
+// Calls and oracle requests get their own span; other expressions share
+// their statement's, which keeps the line table short
+static int lower_expr(const LiminalContext *ctx, IrFunc *f, const ASTExpr *e) {
   if (!e) return -1;
+  int own = e->span.line > 0 && (e->kind == EXPR_CALL || e->kind == EXPR_ASK || e->kind == EXPR_CONSULT);
+  LiminalSpan outer = own ? ir_func_set_span(f, e->span) : f->span;
+  int t = lower_expr_kind(ctx, f, e);
+  ir_func_set_span(f, outer);
+  return t;
+}
+
+static int lower_expr_kind(const LiminalContext *ctx, IrFunc *f, const ASTExpr *e) {
   switch (e->kind) {
   case EXPR_LITERAL: {
     ASTLiteral lit = e->as.literal;
@@ -505,7 +940,7 @@ static int lower_expr(IrFunc *f, const ASTExpr *e) {
     case TK_CHAR: {
       char *s = unquote_string_literal(lit.value);
       int t = ir_emit_const_string(f, s);
-      free(s);
+      lm_free(s);
       return t;
     }
     default:
@@ -514,19 +949,19 @@ static int lower_expr(IrFunc *f, const ASTExpr *e) {
   }
   case EXPR_IDENT: {
     char *name = string_to_cstr(e->as.ident.name);
-    if (getenv("LIMINAL_DEBUG_IR_LOG")) fprintf(stderr, "[ir] ident %s\n", name);
-    if (strcmp(name, "Nothing") == 0) { free(name); return ir_emit_const_optional_none(f); }
+    if (ctx->debug_ir_log) fprintf(stderr, "[ir] ident %s\n", name);
+    if (strcmp(name, "Nothing") == 0) { lm_free(name); return ir_emit_const_optional_none(f); }
     int t = ir_emit_load_var(f, name);
-    free(name);
+    lm_free(name);
     return t;
   }
   case EXPR_INDEX: {
     if (e->as.index.base->kind == EXPR_IDENT && e->as.index.indices.len==1) {
       char *base = string_to_cstr(e->as.index.base->as.ident.name);
-      int idx = lower_expr(f, e->as.index.indices.items[0]);
+      int idx = lower_expr(ctx, f, e->as.index.indices.items[0]);
       // encode base name in s, arg2 is idx
       IrInstr ins = {.op=IR_INDEX, .dest=ir_func_new_temp(f), .arg2=idx, .s=base};
-      emit(&f->instrs, ins);
+      emit(f, ins);
       return ins.dest;
     }
     return ir_emit_const_int(f,0);
@@ -536,7 +971,7 @@ static int lower_expr(IrFunc *f, const ASTExpr *e) {
       char *base = string_to_cstr(e->as.field.base->as.ident.name);
       char *fld = string_to_cstr(e->as.field.field);
       char buf[256]; snprintf(buf,sizeof(buf),"%s.%s", base, fld);
-      free(base); free(fld);
+      lm_free(base); lm_free(fld);
       return ir_emit_load_var(f, buf);
     }
     return ir_emit_const_int(f,0);
@@ -550,20 +985,20 @@ static int lower_expr(IrFunc *f, const ASTExpr *e) {
     if (e->as.ask.into_type && e->as.ask.into_type->kind == TYPE_IDENT) {
       schema_name = string_to_cstr(e->as.ask.into_type->as.ident.name);
     }
-    int prompt_t = lower_expr(f, e->as.ask.input);
+    int prompt_t = lower_expr(ctx, f, e->as.ask.input);
     int fb_t = -1;
-    if (e->as.ask.fallback) fb_t = lower_expr(f, e->as.ask.fallback);
+    if (e->as.ask.fallback) fb_t = lower_expr(ctx, f, e->as.ask.fallback);
     int t = ir_emit_ask(f, prompt_t, fb_t, oracle_name, schema_name);
     if (e->as.ask.with_cost && f->instrs.len > 0) {
       f->instrs.items[f->instrs.len-1].f = 1.0;
     }
-    free(oracle_name);
-    free(schema_name);
+    lm_free(oracle_name);
+    lm_free(schema_name);
     return t;
   }
   case EXPR_CONSULT: {
     char *oracle_name = NULL;
-    if (getenv("LIMINAL_DEBUG_IR_LOG")) fprintf(stderr, "[ir] consult expr\n");
+    if (ctx->debug_ir_log) fprintf(stderr, "[ir] consult expr\n");
     if (e->as.consult.oracle && e->as.consult.oracle->kind == EXPR_IDENT) {
       oracle_name = string_to_cstr(e->as.consult.oracle->as.ident.name);
     }
@@ -571,11 +1006,11 @@ static int lower_expr(IrFunc *f, const ASTExpr *e) {
     if (e->as.consult.into_type && e->as.consult.into_type->kind == TYPE_IDENT) {
       schema_name = string_to_cstr(e->as.consult.into_type->as.ident.name);
     }
-    int prompt_t = lower_expr(f, e->as.consult.input);
+    int prompt_t = lower_expr(ctx, f, e->as.consult.input);
     int fallback_t = -1;
-    if (e->as.consult.fallback) fallback_t = lower_expr(f, e->as.consult.fallback);
+    if (e->as.consult.fallback) fallback_t = lower_expr(ctx, f, e->as.consult.fallback);
     int hint_t = -1;
-    if (e->as.consult.hint) hint_t = lower_expr(f, e->as.consult.hint);
+    if (e->as.consult.hint) hint_t = lower_expr(ctx, f, e->as.consult.hint);
     // vars: _consult_prompt_X, _consult_retries_X
     char bufp[64]; snprintf(bufp, sizeof(bufp), "__consult_prompt_%d", f->next_label);
     char bufr[64]; snprintf(bufr, sizeof(bufr), "__consult_retries_%d", f->next_label);
@@ -609,23 +1044,23 @@ static int lower_expr(IrFunc *f, const ASTExpr *e) {
     ir_emit_label(f, done_label);
     int out_t = res_t;
     if (fallback_t >= 0) out_t = ir_emit_result_or_fallback(f, res_t, fallback_t);
-    free(oracle_name);
-    free(schema_name);
+    lm_free(oracle_name);
+    lm_free(schema_name);
     return out_t;
   }
   case EXPR_BINARY: {
-    int lhs = lower_expr(f, e->as.binary.lhs);
-    int rhs = lower_expr(f, e->as.binary.rhs);
+    int lhs = lower_expr(ctx, f, e->as.binary.lhs);
+    int rhs = lower_expr(ctx, f, e->as.binary.rhs);
     IrOp op = binop_to_ir(e->as.binary.op);
     return ir_emit_binop(f, op, lhs, rhs);
   }
   case EXPR_CONCAT: {
-    int lhs = lower_expr(f, e->as.concat.lhs);
-    int rhs = lower_expr(f, e->as.concat.rhs);
+    int lhs = lower_expr(ctx, f, e->as.concat.lhs);
+    int rhs = lower_expr(ctx, f, e->as.concat.rhs);
     return ir_emit_concat(f, lhs, rhs);
   }
   case EXPR_UNARY: {
-    int inner = lower_expr(f, e->as.unary.expr);
+    int inner = lower_expr(ctx, f, e->as.unary.expr);
     if (e->as.unary.op == TK_MINUS) {
       int zero = ir_emit_const_int(f, 0);
       return ir_emit_binop(f, IR_SUB, zero, inner);
@@ -640,43 +1075,42 @@ static int lower_expr(IrFunc *f, const ASTExpr *e) {
     // Builtins first (ident callee)
     if (callee->kind == EXPR_IDENT) {
       char *name = string_to_cstr(callee->as.ident.name);
-      const char *dbg_call = getenv("LIMINAL_DEBUG_IR_CALL");
-      if (dbg_call) fprintf(stderr, "[ir] call %s nargs=%zu\n", name, e->as.call.args.len);
+      if (ctx->debug_ir_call) fprintf(stderr, "[ir] call %s nargs=%zu\n", name, e->as.call.args.len);
       if (strcasecmp(name, "Ok") == 0 && e->as.call.args.len == 1) {
-        int at = lower_expr(f, e->as.call.args.items[0]); free(name); return ir_emit_make_result_ok(f, at);
+        int at = lower_expr(ctx, f, e->as.call.args.items[0]); lm_free(name); return ir_emit_make_result_ok(f, at);
       }
       if (strcasecmp(name, "Err") == 0 && e->as.call.args.len == 1) {
-        int at = lower_expr(f, e->as.call.args.items[0]); free(name); return ir_emit_make_result_err(f, at);
+        int at = lower_expr(ctx, f, e->as.call.args.items[0]); lm_free(name); return ir_emit_make_result_err(f, at);
       }
       if (strcasecmp(name, "Write") == 0 || strcasecmp(name, "WriteLn") == 0) {
         int newline = (strcasecmp(name, "WriteLn") == 0);
         for (size_t i = 0; i < e->as.call.args.len; ++i) {
-          int t = lower_expr(f, e->as.call.args.items[i]);
+          int t = lower_expr(ctx, f, e->as.call.args.items[i]);
           ir_emit_print(f, t, 0);
         }
         if (newline) ir_emit_print(f, -1, 1);
-        free(name);
+        lm_free(name);
         return ir_emit_const_int(f, 0);
       } else if (strcasecmp(name, "ReadLn") == 0) {
         if (e->as.call.args.len == 1 && e->as.call.args.items[0]->kind == EXPR_IDENT) {
           char *var = string_to_cstr(e->as.call.args.items[0]->as.ident.name);
           ir_emit_readln(f, var);
-          free(var);
+          lm_free(var);
         }
-        free(name);
+        lm_free(name);
         return ir_emit_const_int(f, 0);
       } else if (strcasecmp(name, "ReadFile") == 0) {
         if (e->as.call.args.len == 1) {
-          int path = lower_expr(f, e->as.call.args.items[0]);
-          free(name);
+          int path = lower_expr(ctx, f, e->as.call.args.items[0]);
+          lm_free(name);
           return ir_emit_read_file(f, path);
         }
       } else if (strcasecmp(name, "WriteFile") == 0) {
         if (e->as.call.args.len == 2) {
-          int path = lower_expr(f, e->as.call.args.items[0]);
-          int content = lower_expr(f, e->as.call.args.items[1]);
+          int path = lower_expr(ctx, f, e->as.call.args.items[0]);
+          int content = lower_expr(ctx, f, e->as.call.args.items[1]);
           ir_emit_write_file(f, path, content);
-          free(name);
+          lm_free(name);
           return ir_emit_const_int(f, 0);
         }
       } else if (strcasecmp(name, "Ask") == 0) {
@@ -684,23 +1118,23 @@ static int lower_expr(IrFunc *f, const ASTExpr *e) {
         int fallback = -1;
         char *oracle = NULL;
         char *schema_name = NULL;
-        if (e->as.call.args.len >= 1) prompt = lower_expr(f, e->as.call.args.items[0]);
-        if (e->as.call.args.len >= 2) fallback = lower_expr(f, e->as.call.args.items[1]);
+        if (e->as.call.args.len >= 1) prompt = lower_expr(ctx, f, e->as.call.args.items[0]);
+        if (e->as.call.args.len >= 2) fallback = lower_expr(ctx, f, e->as.call.args.items[1]);
         if (e->as.call.args.len >= 3 && e->as.call.args.items[2]->kind == EXPR_IDENT) oracle = string_to_cstr(e->as.call.args.items[2]->as.ident.name);
         if (e->as.call.args.len >= 4 && e->as.call.args.items[3]->kind == EXPR_IDENT) schema_name = string_to_cstr(e->as.call.args.items[3]->as.ident.name);
         int t = ir_emit_ask(f, prompt, fallback, oracle, schema_name);
-        free(oracle);
-        free(schema_name);
-        free(name);
+        lm_free(oracle);
+        lm_free(schema_name);
+        lm_free(name);
         return t;
       }
       // Not a builtin: emit call
       int arg0 = -1;
-      if (e->as.call.args.len > 0) arg0 = lower_expr(f, e->as.call.args.items[0]);
+      if (e->as.call.args.len > 0) arg0 = lower_expr(ctx, f, e->as.call.args.items[0]);
       int arg1 = -1;
-      if (e->as.call.args.len > 1) arg1 = lower_expr(f, e->as.call.args.items[1]);
+      if (e->as.call.args.len > 1) arg1 = lower_expr(ctx, f, e->as.call.args.items[1]);
       int t = ir_emit_call(f, name, arg0, arg1);
-      free(name);
+      lm_free(name);
       return t;
     }
     // handle method calls like result.UnwrapOr(x)
@@ -708,12 +1142,12 @@ static int lower_expr(IrFunc *f, const ASTExpr *e) {
       ASTExpr *base = callee->as.field.base;
       char *fname = string_to_cstr(callee->as.field.field);
       if (strcmp(fname, "UnwrapOr") == 0 && e->as.call.args.len == 1) {
-        int res_t = lower_expr(f, base);
-        int fb_t = lower_expr(f, e->as.call.args.items[0]);
-        free(fname);
+        int res_t = lower_expr(ctx, f, base);
+        int fb_t = lower_expr(ctx, f, e->as.call.args.items[0]);
+        lm_free(fname);
         return ir_emit_result_unwrap(f, res_t, fb_t);
       }
-      free(fname);
+      lm_free(fname);
     }
     return ir_emit_const_int(f, 0);
   }
@@ -725,21 +1159,29 @@ static int lower_expr(IrFunc *f, const ASTExpr *e) {
 static char *fresh_label(IrFunc *f) {
   char buf[32];
   snprintf(buf, sizeof(buf), "%d", f->next_label++);
-  return strdup(buf);
+  return lm_strdup(buf);
 }
 
 int ir_emit_index(IrFunc *f, const char *base, int idx_temp) {
-  IrInstr ins = {.op = IR_INDEX, .dest = ir_func_new_temp(f), .arg2 = idx_temp, .s = strdup(base)};
-  emit(&f->instrs, ins);
+  IrInstr ins = {.op = IR_INDEX, .dest = ir_func_new_temp(f), .arg2 = idx_temp, .s = lm_strdup(base)};
+  emit(f, ins);
   return ins.dest;
 }
 
-static void lower_stmt(IrFunc *f, const ASTStmt *s) {
+static void lower_stmt_kind(const LiminalContext *ctx, IrFunc *f, const ASTStmt *s);
+
+static void lower_stmt(const LiminalContext *ctx, IrFunc *f, const ASTStmt *s) {
   if (!s) return;
+  LiminalSpan outer = s->span.line > 0 ? ir_func_set_span(f, s->span) : f->span;
+  lower_stmt_kind(ctx, f, s);
+  ir_func_set_span(f, outer);
+}
+
+static void lower_stmt_kind(const LiminalContext *ctx, IrFunc *f, const ASTStmt *s) {
   switch (s->kind) {
   case STMT_ASSIGN: {
     ASTExpr *target = s->as.assign.target;
-    if (getenv("LIMINAL_DEBUG_IR_LOG")) {
+    if (ctx->debug_ir_log) {
       if (target && target->kind==EXPR_IDENT) fprintf(stderr, "[ir] assign target ident %s\n", target->as.ident.name.data);
       else fprintf(stderr, "[ir] assign target kind %d\n", target ? (int)target->kind : -1);
     }
@@ -748,9 +1190,9 @@ static void lower_stmt(IrFunc *f, const ASTStmt *s) {
         char *base=string_to_cstr(target->as.field.base->as.ident.name);
         char *fld=string_to_cstr(target->as.field.field);
         char buf[256]; snprintf(buf,sizeof(buf),"%s.%s", base, fld);
-        int val = lower_expr(f, s->as.assign.value);
+        int val = lower_expr(ctx, f, s->as.assign.value);
         ir_emit_store_var(f, buf, val);
-        free(base); free(fld);
+        lm_free(base); lm_free(fld);
       }
       break;
     }
@@ -764,7 +1206,7 @@ static void lower_stmt(IrFunc *f, const ASTStmt *s) {
         if (el->kind == EXPR_RECORD) {
           for (size_t fi=0; fi<el->as.record.fields.len; ++fi) {
             ASTField *fld = &el->as.record.fields.items[fi];
-            int tv = lower_expr(f, fld->value);
+            int tv = lower_expr(ctx, f, fld->value);
             char buf[256]; snprintf(buf,sizeof(buf),"%s.%zu.%s", name, i, fld->key.data);
             ir_emit_store_var(f, buf, tv);
           }
@@ -772,64 +1214,64 @@ static void lower_stmt(IrFunc *f, const ASTStmt *s) {
           char buf0[256]; snprintf(buf0,sizeof(buf0),"%s.%zu", name, i);
           int zero = ir_emit_const_int(f,0); ir_emit_store_var(f, buf0, zero);
         } else {
-          int tv=lower_expr(f, el);
+          int tv=lower_expr(ctx, f, el);
           char buf[256]; snprintf(buf,sizeof(buf),"%s.%zu", name, i);
           ir_emit_store_var(f, buf, tv);
         }
       }
       int zero = ir_emit_const_int(f,0); ir_emit_store_var(f, name, zero);
       char buflen[256]; snprintf(buflen,sizeof(buflen),"%s.len", name); int len_t = ir_emit_const_int(f, (int)len); ir_emit_store_var(f, buflen, len_t);
-      free(name);
+      lm_free(name);
       break;
     }
-    int val = lower_expr(f, s->as.assign.value);
+    int val = lower_expr(ctx, f, s->as.assign.value);
     ir_emit_store_var(f, name, val);
-    free(name);
+    lm_free(name);
     break;
   }
   case STMT_EXPR:
-    lower_expr(f, s->as.expr_stmt.expr);
+    lower_expr(ctx, f, s->as.expr_stmt.expr);
     break;
   case STMT_BLOCK:
-    if (getenv("LIMINAL_DEBUG_IR_LOG")) fprintf(stderr, "[ir] block stmts=%zu\n", s->as.block.stmts.len);
-    for (size_t i = 0; i < s->as.block.stmts.len; ++i) lower_stmt(f, s->as.block.stmts.items[i]);
+    if (ctx->debug_ir_log) fprintf(stderr, "[ir] block stmts=%zu\n", s->as.block.stmts.len);
+    for (size_t i = 0; i < s->as.block.stmts.len; ++i) lower_stmt(ctx, f, s->as.block.stmts.items[i]);
     break;
   case STMT_IF: {
-    int cond = lower_expr(f, s->as.if_stmt.cond);
+    int cond = lower_expr(ctx, f, s->as.if_stmt.cond);
     char *label_else = fresh_label(f);
     char *label_end = fresh_label(f);
     ir_emit_jump_if_false(f, cond, label_else);
-    lower_stmt(f, s->as.if_stmt.then_branch);
+    lower_stmt(ctx, f, s->as.if_stmt.then_branch);
     ir_emit_jump(f, label_end);
     ir_emit_label(f, label_else);
-    if (s->as.if_stmt.else_branch) lower_stmt(f, s->as.if_stmt.else_branch);
+    if (s->as.if_stmt.else_branch) lower_stmt(ctx, f, s->as.if_stmt.else_branch);
     ir_emit_label(f, label_end);
-    free(label_else); free(label_end);
+    lm_free(label_else); lm_free(label_end);
     break;
   }
   case STMT_WHILE: {
     char *label_loop = fresh_label(f);
     char *label_end = fresh_label(f);
     ir_emit_label(f, label_loop);
-    int cond = lower_expr(f, s->as.while_stmt.cond);
+    int cond = lower_expr(ctx, f, s->as.while_stmt.cond);
     ir_emit_jump_if_false(f, cond, label_end);
-    lower_stmt(f, s->as.while_stmt.body);
+    lower_stmt(ctx, f, s->as.while_stmt.body);
     ir_emit_jump(f, label_loop);
     ir_emit_label(f, label_end);
-    free(label_loop); free(label_end);
+    lm_free(label_loop); lm_free(label_end);
     break;
   }
   case STMT_REPEAT: {
     char *label_loop = fresh_label(f);
     ir_emit_label(f, label_loop);
-    lower_stmt(f, s->as.repeat_stmt.body);
-    int cond = lower_expr(f, s->as.repeat_stmt.cond);
+    lower_stmt(ctx, f, s->as.repeat_stmt.body);
+    int cond = lower_expr(ctx, f, s->as.repeat_stmt.cond);
     ir_emit_jump_if_false(f, cond, label_loop);
-    free(label_loop);
+    lm_free(label_loop);
     break;
   }
   case STMT_CASE: {
-    int expr_t = lower_expr(f, s->as.case_stmt.expr);
+    int expr_t = lower_expr(ctx, f, s->as.case_stmt.expr);
     char *label_end = fresh_label(f);
     for (size_t i=0;i<s->as.case_stmt.patterns.len;++i){
       char *lbl = fresh_label(f);
@@ -842,11 +1284,11 @@ static void lower_stmt(IrFunc *f, const ASTStmt *s) {
           int inner_t = ir_emit_result_unwrap(f, expr_t, -1);
           char *varname = string_to_cstr(pat->as.call.args.items[0]->as.ident.name);
           ir_emit_store_var(f, varname, inner_t);
-          free(varname);
-          lower_stmt(f, s->as.case_stmt.branches.items[i]);
+          lm_free(varname);
+          lower_stmt(ctx, f, s->as.case_stmt.branches.items[i]);
           ir_emit_jump(f, label_end);
           ir_emit_label(f, lbl);
-          free(lbl);
+          lm_free(lbl);
           continue;
         }
         if (nm.data && strncasecmp(nm.data,"Err",nm.len)==0 && pat->as.call.args.len==1 && pat->as.call.args.items[0]->kind==EXPR_IDENT) {
@@ -857,25 +1299,25 @@ static void lower_stmt(IrFunc *f, const ASTStmt *s) {
           int err_t = ir_emit_result_unwrap_err(f, expr_t);
           char *varname = string_to_cstr(pat->as.call.args.items[0]->as.ident.name);
           ir_emit_store_var(f, varname, err_t);
-          free(varname);
-          lower_stmt(f, s->as.case_stmt.branches.items[i]);
+          lm_free(varname);
+          lower_stmt(ctx, f, s->as.case_stmt.branches.items[i]);
           ir_emit_jump(f, label_end);
           ir_emit_label(f, lbl);
-          free(lbl);
+          lm_free(lbl);
           continue;
         }
       }
-      int pat_t = lower_expr(f, pat);
+      int pat_t = lower_expr(ctx, f, pat);
       int cmp_t = ir_emit_binop(f, IR_EQ, expr_t, pat_t);
       ir_emit_jump_if_false(f, cmp_t, lbl);
-      lower_stmt(f, s->as.case_stmt.branches.items[i]);
+      lower_stmt(ctx, f, s->as.case_stmt.branches.items[i]);
       ir_emit_jump(f, label_end);
       ir_emit_label(f, lbl);
-      free(lbl);
+      lm_free(lbl);
     }
-    if (s->as.case_stmt.else_branch) lower_stmt(f, s->as.case_stmt.else_branch);
+    if (s->as.case_stmt.else_branch) lower_stmt(ctx, f, s->as.case_stmt.else_branch);
     ir_emit_label(f, label_end);
-    free(label_end);
+    lm_free(label_end);
     break;
   }
   case STMT_FOR_IN: {
@@ -894,40 +1336,72 @@ static void lower_stmt(IrFunc *f, const ASTStmt *s) {
       int elem_t = ir_emit_index(f, iter, cur_idx);
       char *varname = string_to_cstr(s->as.for_in_stmt.var.name);
       ir_emit_store_var(f, varname, elem_t);
-      free(varname);
-      lower_stmt(f, s->as.for_in_stmt.body);
+      lm_free(varname);
+      lower_stmt(ctx, f, s->as.for_in_stmt.body);
       int one = ir_emit_const_int(f,1);
       int inc = ir_emit_binop(f, IR_ADD, cur_idx, one);
       ir_emit_store_var(f, idxname, inc);
       ir_emit_jump(f, label_loop);
       ir_emit_label(f, label_end);
-      free(iter); free(label_loop); free(label_end);
+      lm_free(iter); lm_free(label_loop); lm_free(label_end);
     }
     break;
   }
+  case STMT_STREAM: {
+    // Pulls chunks until the stream ends; the body runs once per chunk while
+    // the oracle is still producing the rest
+    char *oracle = string_to_cstr(s->as.stream_stmt.oracle.name);
+    char *chunk = string_to_cstr(s->as.stream_stmt.chunk.name);
+    int prompt_t = lower_expr(ctx, f, s->as.stream_stmt.prompt);
+    int stream_t = ir_emit_stream_open(f, prompt_t, oracle);
+    char *label_loop = fresh_label(f);
+    char *label_end = fresh_label(f);
+    ir_emit_label(f, label_loop);
+    int next_t = ir_emit_stream_next(f, stream_t);
+    int ok_t = ir_emit_result_is_ok(f, next_t);
+    ir_emit_jump_if_false(f, ok_t, label_end);
+    ir_emit_store_var(f, chunk, ir_emit_result_unwrap(f, next_t, -1));
+    lower_stmt(ctx, f, s->as.stream_stmt.body);
+    ir_emit_jump(f, label_loop);
+    ir_emit_label(f, label_end);
+    lm_free(oracle); lm_free(chunk); lm_free(label_loop); lm_free(label_end);
+    break;
+  }
+  case STMT_PARALLEL:
+    // One task per statement; a task's temps are its own, so it shares only
+    // variables with the code around it
+    for (size_t i = 0; i < s->as.parallel_stmt.body.len; ++i) {
+      char *label_end = fresh_label(f);
+      ir_emit_fork(f, label_end);
+      lower_stmt(ctx, f, s->as.parallel_stmt.body.items[i]);
+      ir_emit_label(f, label_end);
+      lm_free(label_end);
+    }
+    if (s->as.parallel_stmt.body.len) ir_emit_join(f);
+    break;
   case STMT_FOR: {
     char *label_loop = fresh_label(f);
     char *label_end = fresh_label(f);
     char *varname = string_to_cstr(s->as.for_stmt.var.name);
-    int init_t = lower_expr(f, s->as.for_stmt.init);
-    int limit_t = lower_expr(f, s->as.for_stmt.to);
+    int init_t = lower_expr(ctx, f, s->as.for_stmt.init);
+    int limit_t = lower_expr(ctx, f, s->as.for_stmt.to);
     ir_emit_store_var(f, varname, init_t);
     ir_emit_label(f, label_loop);
     int cur_t = ir_emit_load_var(f, varname);
     int cmp_t = ir_emit_binop(f, s->as.for_stmt.descending ? IR_GE : IR_LE, cur_t, limit_t);
     ir_emit_jump_if_false(f, cmp_t, label_end);
-    lower_stmt(f, s->as.for_stmt.body);
+    lower_stmt(ctx, f, s->as.for_stmt.body);
     int one_t = ir_emit_const_int(f, 1);
     int next_t = ir_emit_binop(f, s->as.for_stmt.descending ? IR_SUB : IR_ADD, cur_t, one_t);
     ir_emit_store_var(f, varname, next_t);
     ir_emit_jump(f, label_loop);
     ir_emit_label(f, label_end);
-    free(varname);
-    free(label_loop); free(label_end);
+    lm_free(varname);
+    lm_free(label_loop); lm_free(label_end);
     break;
   }
   case STMT_RETURN: {
-    int val = lower_expr(f, s->as.return_stmt.value);
+    int val = lower_expr(ctx, f, s->as.return_stmt.value);
     ir_emit_ret(f, val);
     break;
   }
@@ -976,8 +1450,9 @@ static Type *ir_type_from_ast(Symtab *st, ASTType *ty) {
   }
 }
 
-static void ir_collect_schemas(IrProgram *p, const ASTNode *node) {
+static void ir_collect_schemas(const LiminalContext *ctx, IrProgram *p, const ASTNode *node) {
   Symtab *st = symtab_create();
+  st->debug = ctx->debug_tc;
   // pass 1: declare schema names
   for (size_t i = 0; i < node->as.program.types.len; ++i) {
     ASTNode *td = node->as.program.types.items[i];
@@ -1004,12 +1479,20 @@ static void ir_collect_schemas(IrProgram *p, const ASTNode *node) {
 }
 
 IrProgram *ir_from_ast(const ASTNode *node) {
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  IrProgram *p = ir_from_ast_ctx(node, &ctx);
+  liminal_context_free(&ctx);
+  return p;
+}
+
+IrProgram *ir_from_ast_ctx(const ASTNode *node, const LiminalContext *ctx) {
   if (!node || node->kind != AST_PROGRAM) return NULL;
   IrProgram *p = ir_program_new();
-  ir_collect_schemas(p, node);
+  ir_collect_schemas(ctx, p, node);
   char *prog_name = string_to_cstr(node->as.program.name);
   IrFunc mainf = ir_func_create(prog_name);
-  free(prog_name);
+  lm_free(prog_name);
   mainf.next_label = 0;
   // initialize enums as constants
   for (size_t i=0;i<node->as.program.types.len;++i){
@@ -1021,29 +1504,30 @@ IrProgram *ir_from_ast(const ASTNode *node) {
         char *nm_c = string_to_cstr(nm);
         int c = ir_emit_const_int(&mainf, (int)ei);
         ir_emit_store_var(&mainf, nm_c, c);
-        free(nm_c);
+        lm_free(nm_c);
       }
     }
   }
-  lower_stmt(&mainf, node->as.program.body);
+  lower_stmt(ctx, &mainf, node->as.program.body);
   ir_program_add_func(p, mainf);
   for (size_t i = 0; i < node->as.program.functions.len; ++i) {
     ASTNode *fn_node = node->as.program.functions.items[i];
     if (fn_node->kind != AST_FUNC_DECL) continue;
     char *fname = string_to_cstr(fn_node->as.func_decl.name);
     IrFunc f = ir_func_create(fname);
-    free(fname);
+    lm_free(fname);
     ASTFunction *afn = &fn_node->as.func_decl;
     if (afn->params.len > 0) {
       f.param_count = (int)afn->params.len;
-      f.params = calloc(f.param_count, sizeof(char*));
+      f.params = lm_calloc(f.param_count, sizeof(char*));
       for (int pi = 0; pi < f.param_count; ++pi) {
         f.params[pi] = string_to_cstr(afn->params.items[pi].name);
       }
     }
     f.next_label = 0;
-    lower_stmt(&f, fn_node->as.func_decl.body);
+    lower_stmt(ctx, &f, fn_node->as.func_decl.body);
     ir_program_add_func(p, f);
   }
+  ir_defer_awaits(p);
   return p;
 }
@@ -0,0 +1,392 @@
+#define _DEFAULT_SOURCE
+#include "liminal/jit.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_X86_64 1
+#include <sys/mman.h>
+#endif
+
+// Hotness: a call counts JIT_CALL_WEIGHT, a loop back-edge counts 1
+#define JIT_DEFAULT_THRESHOLD 200
+#define JIT_CALL_WEIGHT 20
+
+enum { JIT_COLD, JIT_COMPILED, JIT_FAILED };
+
+typedef struct {
+  long hotness;
+  int state;
+  unsigned char *code;
+  size_t code_size;
+  size_t *offsets; // native offset of each instruction, plus the epilogue
+  long *slots;     // LOAD_VAR/STORE_VAR: last env index of the variable
+} JitFunc;
+
+struct JitState {
+  LiminalContext *ctx;
+  const IrProgram *prog;
+  JitFunc *funcs;
+  long threshold;
+};
+
+// Compiled code: entry is an instruction's address inside the same block
+typedef void (*JitCode)(ExecFrame *fr, const unsigned char *entry);
+
+JitState *jit_state_new(LiminalContext *ctx, const IrProgram *prog){
+  JitState *jit = calloc(1, sizeof(JitState));
+  jit->ctx = ctx; jit->prog = prog;
+  jit->funcs = calloc(prog->funcs.len ? prog->funcs.len : 1, sizeof(JitFunc));
+  jit->threshold = ctx->jit_threshold >= 0 ? ctx->jit_threshold : JIT_DEFAULT_THRESHOLD;
+  return jit;
+}
+
+void jit_state_free(JitState *jit){
+  if (!jit) return;
+  for (size_t i = 0; i < jit->prog->funcs.len; ++i) {
+#ifdef JIT_X86_64
+    if (jit->funcs[i].code) munmap(jit->funcs[i].code, jit->funcs[i].code_size);
+#endif
+    free(jit->funcs[i].offsets);
+    free(jit->funcs[i].slots);
+  }
+  free(jit->funcs);
+  free(jit);
+}
+
+#ifdef JIT_X86_64
+
+int jit_supported(void){ return 1; }
+
+typedef struct { unsigned char *items; size_t len; size_t cap; } Code;
+// rel32 at `at` jumps to instruction `target` (its offset is known later)
+typedef struct { size_t at; size_t target; } Fixup;
+typedef struct { Fixup *items; size_t len; size_t cap; } FixupVec;
+
+static void emit(Code *c, const void *bytes, size_t n){
+  if (c->len + n > c->cap) { size_t cap = c->cap ? c->cap : 256; while (cap < c->len + n) cap *= 2; c->items = realloc(c->items, cap); c->cap = cap; }
+  memcpy(c->items + c->len, bytes, n); c->len += n;
+}
+static void emit8(Code *c, unsigned v){ unsigned char b = (unsigned char)v; emit(c, &b, 1); }
+static void emit32(Code *c, uint32_t v){ emit(c, &v, 4); }
+static void emit64(Code *c, uint64_t v){ emit(c, &v, 8); }
+
+static void fixup_add(FixupVec *v, size_t at, size_t target){
+  if (v->len == v->cap) { v->cap = v->cap ? v->cap * 2 : 16; v->items = realloc(v->items, v->cap * sizeof(Fixup)); }
+  v->items[v->len].at = at; v->items[v->len].target = target; v->len++;
+}
+static void patch(Code *c, size_t at, size_t dest){ int32_t rel = (int32_t)((long)dest - (long)(at + 4)); memcpy(c->items + at, &rel, 4); }
+
+// x86 condition codes
+enum { CC_O = 0x0, CC_E = 0x4, CC_NE = 0x5, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF };
+enum { R_EAX = 0, R_ECX = 1, R_EDX = 2 };
+
+// Returns the position of the rel32 to patch
+static size_t emit_jcc(Code *c, int cc){ emit8(c, 0x0F); emit8(c, 0x80 | cc); emit32(c, 0); return c->len - 4; }
+static size_t emit_jmp(Code *c){ emit8(c, 0xE9); emit32(c, 0); return c->len - 4; }
+
+// <op> with a [r12 + disp32] operand; reg is the ModRM reg field (a register
+// or an opcode extension). r12 is the frame's temps array.
+static void emit_mem(Code *c, int wide, unsigned op, int reg, size_t disp){
+  emit8(c, wide ? 0x49 : 0x41); emit8(c, op); emit8(c, 0x84 | (reg << 3)); emit8(c, 0x24); emit32(c, (uint32_t)disp);
+}
+static size_t kind_of(int t){ return (size_t)t * sizeof(Value) + offsetof(Value, kind); }
+static size_t int_of(int t){ return (size_t)t * sizeof(Value) + offsetof(Value, i); }
+static size_t ref_of(int t){ return (size_t)t * sizeof(Value) + offsetof(Value, ref); }
+
+// mov rdi, rbx; mov esi, arg; [movabs rdx, extra;] movabs rax, fn; call rax
+static void emit_call3(Code *c, uint64_t fn, size_t arg, const void *extra){
+  static const unsigned char mov_rdi_rbx[] = {0x48, 0x89, 0xDF};
+  emit(c, mov_rdi_rbx, 3);
+  emit8(c, 0xBE); emit32(c, (uint32_t)arg);
+  if (extra) { emit8(c, 0x48); emit8(c, 0xBA); emit64(c, (uint64_t)(uintptr_t)extra); }
+  emit8(c, 0x48); emit8(c, 0xB8); emit64(c, fn);
+  emit8(c, 0xFF); emit8(c, 0xD0);
+}
+static void emit_call(Code *c, uint64_t fn, size_t arg){ emit_call3(c, fn, arg, NULL); }
+
+static int jit_truthy(ExecFrame *fr, size_t t){ return rt_truthy(fr->temps[t]); }
+
+// Slot hints are shared by every activation of the function, so each use is
+// checked against the current env before it is trusted
+static Var *local_var(Env *env, const char *name, long *slot){
+  if (*slot >= 0 && (size_t)*slot < env->len && strcmp(env->items[*slot].name, name) == 0) return &env->items[*slot];
+  for (size_t i = 0; i < env->len; ++i) if (strcmp(env->items[i].name, name) == 0) { *slot = (long)i; return &env->items[i]; }
+  *slot = -1;
+  return NULL;
+}
+
+// LOAD_VAR of a local Integer/Boolean: the value rt_load_var produces, with
+// the ref borrowed from the instruction instead of strdup'd
+static void jit_load_var(ExecFrame *fr, size_t ip, long *slot){
+  const IrInstr *ins = &fr->f->instrs.items[ip];
+  Var *var = local_var(fr->env, ins->s, slot);
+  if (!var || (var->val.kind != VINT && var->val.kind != VBOOL)) { rt_load_var(fr->ctx, fr->env, &fr->temps[ins->dest], ins->s); return; }
+  Value v = var->val.kind == VINT ? v_int(var->val.i) : v_bool(var->val.i);
+  v.ref = ins->s; v.ref_interned = 1;
+  v_free(fr->ctx, fr->temps[ins->dest]); fr->temps[ins->dest] = v;
+}
+
+// STORE_VAR, or the store half of INC_VAR/ADD_STORE (value in dest)
+static void jit_store_var(ExecFrame *fr, size_t ip, long *slot){
+  const IrInstr *ins = &fr->f->instrs.items[ip];
+  Value v = fr->temps[ins->op == IR_STORE_VAR ? ins->arg1 : ins->dest];
+  if (strchr(ins->s, '.')) { env_set(fr->ctx, fr->env, ins->s, v); return; }
+  local_var(fr->env, ins->s, slot);
+  rt_store_var(fr->ctx, fr->env, ins->s, slot, v);
+}
+
+static uint64_t step_addr(void){ long (*fn)(ExecFrame *, size_t) = exec_step; uint64_t a; memcpy(&a, &fn, sizeof(a)); return a; }
+static uint64_t truthy_addr(void){ int (*fn)(ExecFrame *, size_t) = jit_truthy; uint64_t a; memcpy(&a, &fn, sizeof(a)); return a; }
+static uint64_t var_addr(void (*fn)(ExecFrame *, size_t, long *)){ uint64_t a; memcpy(&a, &fn, sizeof(a)); return a; }
+
+// Slow-path exits of one template, patched to its interpreter stub
+typedef struct { size_t at[8]; int n; } Exits;
+static void exit_if(Code *c, Exits *x, int cc){ x->at[x->n++] = emit_jcc(c, cc); }
+
+// Guard: temp t holds an Integer
+static void guard_int(Code *c, Exits *x, int t){ emit_mem(c, 0, 0x83, 7, kind_of(t)); emit8(c, VINT); exit_if(c, x, CC_NE); }
+// Guard: temp t holds an Integer or Boolean (both compare through .i)
+static void guard_intlike(Code *c, Exits *x, int t){
+  emit_mem(c, 0, 0x8B, R_EAX, kind_of(t));
+  emit8(c, 0x83); emit8(c, 0xF8); emit8(c, VINT); // cmp eax, VINT
+  size_t ok = emit_jcc(c, CC_E);
+  emit8(c, 0x83); emit8(c, 0xF8); emit8(c, VBOOL);
+  exit_if(c, x, CC_NE);
+  patch(c, ok, c->len);
+}
+// Guard: overwriting temp t needs no v_free (Integer/Boolean without a ref),
+// so storing kind and i leaves exactly what v_int/v_bool would
+static void guard_dest(Code *c, Exits *x, int t){
+  guard_intlike(c, x, t);
+  emit_mem(c, 1, 0x83, 7, ref_of(t)); emit8(c, 0); // cmp qword [ref], 0
+  exit_if(c, x, CC_NE);
+}
+static void store_reg(Code *c, int t, ValKind kind, int reg){
+  emit_mem(c, 0, 0xC7, 0, kind_of(t)); emit32(c, (uint32_t)kind);
+  emit_mem(c, 0, 0x89, reg, int_of(t));
+}
+
+// Ends a template: fast path jumps over the stub that every exit lands on
+static void finish_template(Code *c, Exits *x, size_t ip){
+  size_t over = emit_jmp(c);
+  for (int i = 0; i < x->n; ++i) patch(c, x->at[i], c->len);
+  emit_call(c, step_addr(), ip);
+  patch(c, over, c->len);
+}
+
+static long label_index(const IrFunc *f, const char *name){
+  if (!name) return -1;
+  for (size_t i = 0; i < f->instrs.len; ++i) if (f->instrs.items[i].op == IR_LABEL && f->instrs.items[i].s && strcmp(f->instrs.items[i].s, name) == 0) return (long)i;
+  return -1;
+}
+
+// Integer arithmetic on eax and ecx (loaded by the caller); returns the
+// register holding the result
+static int emit_arith(Code *c, Exits *x, IrOp op){
+  if (op == IR_ADD) { emit8(c, 0x01); emit8(c, 0xC8); exit_if(c, x, CC_O); }                 // add eax, ecx
+  else if (op == IR_SUB) { emit8(c, 0x29); emit8(c, 0xC8); exit_if(c, x, CC_O); }            // sub eax, ecx
+  else if (op == IR_MUL) { emit8(c, 0x0F); emit8(c, 0xAF); emit8(c, 0xC1); exit_if(c, x, CC_O); } // imul eax, ecx
+  else {
+    // Truncating idiv agrees with the interpreter's double division for
+    // every divisor but 0 and -1, which take the stub
+    emit8(c, 0x83); emit8(c, 0xF9); emit8(c, 0x00); exit_if(c, x, CC_E);  // cmp ecx, 0
+    emit8(c, 0x83); emit8(c, 0xF9); emit8(c, 0xFF); exit_if(c, x, CC_E);  // cmp ecx, -1
+    emit8(c, 0x99); emit8(c, 0xF7); emit8(c, 0xF9);                        // cdq; idiv ecx
+  }
+  return op == IR_MOD ? R_EDX : R_EAX;
+}
+
+static int compare_cc(IrOp op){
+  switch (op) { case IR_EQ: return CC_E; case IR_NEQ: return CC_NE; case IR_LT: return CC_L; case IR_GT: return CC_G; case IR_LE: return CC_LE; default: return CC_GE; }
+}
+
+// Emits instruction ip; returns 1 when it got a template rather than a stub
+static int emit_instr(Code *c, FixupVec *fix, const IrFunc *f, JitFunc *jf, size_t ip, int maxt){
+  const IrInstr *ins = &f->instrs.items[ip];
+  int d = ins->dest, a = ins->arg1, b = ins->arg2;
+#define TEMP_OK(t) ((t) >= 0 && (t) < maxt)
+  Exits x = {{0}, 0};
+  switch (ins->op) {
+  case IR_LABEL: return 1;
+  case IR_JUMP: {
+    long target = label_index(f, ins->s);
+    if (target >= 0) fixup_add(fix, emit_jmp(c), (size_t)target);
+    return 1; }
+  case IR_JUMP_IF_FALSE: {
+    long target = label_index(f, ins->s);
+    if (target < 0 || !TEMP_OK(a)) break;
+    guard_intlike(c, &x, a);
+    emit_mem(c, 0, 0x83, 7, int_of(a)); emit8(c, 0); // cmp dword [i], 0
+    fixup_add(fix, emit_jcc(c, CC_E), (size_t)target);
+    size_t over = emit_jmp(c);
+    for (int i = 0; i < x.n; ++i) patch(c, x.at[i], c->len);
+    emit_call(c, truthy_addr(), (size_t)a);
+    emit8(c, 0x85); emit8(c, 0xC0); // test eax, eax
+    fixup_add(fix, emit_jcc(c, CC_E), (size_t)target);
+    patch(c, over, c->len);
+    return 1; }
+  case IR_LOAD_VAR:
+    if (!TEMP_OK(d) || !ins->s) break;
+    emit_call3(c, var_addr(jit_load_var), ip, &jf->slots[ip]);
+    return 1;
+  case IR_STORE_VAR:
+    if (!TEMP_OK(a) || !ins->s) break;
+    emit_call3(c, var_addr(jit_store_var), ip, &jf->slots[ip]);
+    return 1;
+  case IR_RET:
+    emit_call(c, step_addr(), ip);
+    fixup_add(fix, emit_jmp(c), f->instrs.len);
+    return 1;
+  case IR_CONST_INT: case IR_CONST_BOOL:
+    if (!TEMP_OK(d)) break;
+    guard_dest(c, &x, d);
+    emit_mem(c, 0, 0xC7, 0, kind_of(d)); emit32(c, ins->op == IR_CONST_INT ? VINT : VBOOL);
+    emit_mem(c, 0, 0xC7, 0, int_of(d)); emit32(c, (uint32_t)(ins->op == IR_CONST_INT ? ins->arg1 : ins->arg1 != 0));
+    finish_template(c, &x, ip);
+    return 1;
+  case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_MOD:
+    if (!TEMP_OK(d) || !TEMP_OK(a) || !TEMP_OK(b)) break;
+    guard_int(c, &x, a); guard_int(c, &x, b); guard_dest(c, &x, d);
+    emit_mem(c, 0, 0x8B, R_EAX, int_of(a));
+    emit_mem(c, 0, 0x8B, R_ECX, int_of(b));
+    store_reg(c, d, VINT, emit_arith(c, &x, ins->op));
+    finish_template(c, &x, ip);
+    return 1;
+  case IR_ARITH_CONST:
+    if (!TEMP_OK(d) || !TEMP_OK(a)) break;
+    if ((ins->fused == IR_DIV || ins->fused == IR_MOD) && (b == 0 || b == -1)) break;
+    guard_int(c, &x, a); guard_dest(c, &x, d);
+    emit_mem(c, 0, 0x8B, R_EAX, int_of(a));
+    emit8(c, 0xB9); emit32(c, (uint32_t)b);                                  // mov ecx, k
+    store_reg(c, d, VINT, emit_arith(c, &x, ins->fused));
+    finish_template(c, &x, ip);
+    return 1;
+  case IR_INC_VAR: case IR_ADD_STORE:
+    // Inline add into dest, then the store helper; any exit reruns both
+    if (!TEMP_OK(d) || !TEMP_OK(a) || !ins->s || (ins->op == IR_ADD_STORE && !TEMP_OK(b))) break;
+    guard_int(c, &x, a); guard_dest(c, &x, d);
+    emit_mem(c, 0, 0x8B, R_EAX, int_of(a));
+    if (ins->op == IR_INC_VAR) { emit8(c, 0xB9); emit32(c, (uint32_t)b); }   // mov ecx, k
+    else { guard_int(c, &x, b); emit_mem(c, 0, 0x8B, R_ECX, int_of(b)); }
+    store_reg(c, d, VINT, emit_arith(c, &x, IR_ADD));
+    emit_call3(c, var_addr(jit_store_var), ip, &jf->slots[ip]);
+    finish_template(c, &x, ip);
+    return 1;
+  case IR_EQ: case IR_NEQ: case IR_LT: case IR_GT: case IR_LE: case IR_GE:
+    if (!TEMP_OK(d) || !TEMP_OK(a) || !TEMP_OK(b)) break;
+    guard_intlike(c, &x, a); guard_intlike(c, &x, b); guard_dest(c, &x, d);
+    emit_mem(c, 0, 0x8B, R_EAX, int_of(a));
+    emit_mem(c, 0, 0x3B, R_EAX, int_of(b));                                  // cmp eax, [b]
+    emit8(c, 0x0F); emit8(c, 0x90 | compare_cc(ins->op)); emit8(c, 0xC0);   // setcc al
+    emit8(c, 0x0F); emit8(c, 0xB6); emit8(c, 0xC0);                         // movzx eax, al
+    store_reg(c, d, VBOOL, R_EAX);
+    finish_template(c, &x, ip);
+    return 1;
+  case IR_FORK: {
+    // The interpreter runs the whole `parallel` block and continues at its
+    // JOIN, so the tasks' own code is skipped here
+    long join = ir_fork_join(f, ip);
+    emit_call(c, step_addr(), ip);
+    if (join >= 0) fixup_add(fix, emit_jmp(c), (size_t)join);
+    return 0; }
+  case IR_CMP_BRANCH: case IR_CMP_CONST_BRANCH: {
+    // Not stubbable as-is: the interpreter's branch decision is its return
+    // value, so the slow path jumps unless it continued at ip + 1
+    long target = label_index(f, ins->s);
+    if (target < 0 || !TEMP_OK(a) || (ins->op == IR_CMP_BRANCH && !TEMP_OK(b))) {
+      emit_call(c, step_addr(), ip);
+      if (target >= 0) { emit8(c, 0x48); emit8(c, 0x3D); emit32(c, (uint32_t)(ip + 1)); fixup_add(fix, emit_jcc(c, CC_NE), (size_t)target); } // cmp rax, ip+1
+      return 0;
+    }
+    if (ins->op == IR_CMP_BRANCH) {
+      guard_intlike(c, &x, a); guard_intlike(c, &x, b);
+      emit_mem(c, 0, 0x8B, R_EAX, int_of(a));
+      emit_mem(c, 0, 0x3B, R_EAX, int_of(b));                                // cmp eax, [b]
+    } else {
+      guard_int(c, &x, a);
+      emit_mem(c, 0, 0x8B, R_EAX, int_of(a));
+      emit8(c, 0x3D); emit32(c, (uint32_t)b);                                // cmp eax, k
+    }
+    fixup_add(fix, emit_jcc(c, compare_cc(ins->fused) ^ 1), (size_t)target); // false: take the branch
+    size_t over = emit_jmp(c);
+    for (int i = 0; i < x.n; ++i) patch(c, x.at[i], c->len);
+    emit_call(c, step_addr(), ip);
+    emit8(c, 0x48); emit8(c, 0x3D); emit32(c, (uint32_t)(ip + 1));          // cmp rax, ip+1
+    fixup_add(fix, emit_jcc(c, CC_NE), (size_t)target);
+    patch(c, over, c->len);
+    return 1; }
+  default: break;
+  }
+#undef TEMP_OK
+  emit_call(c, step_addr(), ip);
+  return 0;
+}
+
+static void compile(JitState *jit, const IrFunc *f, JitFunc *jf){
+  jf->state = JIT_FAILED;
+  Code c = {0}; FixupVec fix = {0};
+  size_t n = f->instrs.len, inlined = 0;
+  int maxt = f->next_temp + 16;
+  jf->offsets = malloc((n + 1) * sizeof(size_t));
+  jf->slots = malloc((n ? n : 1) * sizeof(long));
+  for (size_t i = 0; i < n; ++i) jf->slots[i] = -1;
+  // Prologue: push rbx; push r12; sub rsp, 8; mov rbx, rdi;
+  // mov r12, [rbx + temps]; jmp rsi
+  static const unsigned char prologue[] = {0x53, 0x41, 0x54, 0x48, 0x83, 0xEC, 0x08, 0x48, 0x89, 0xFB, 0x4C, 0x8B, 0xA3};
+  emit(&c, prologue, sizeof(prologue)); emit32(&c, (uint32_t)offsetof(ExecFrame, temps));
+  emit8(&c, 0xFF); emit8(&c, 0xE6);
+  for (size_t ip = 0; ip < n; ++ip) {
+    jf->offsets[ip] = c.len;
+    inlined += (size_t)emit_instr(&c, &fix, f, jf, ip, maxt);
+  }
+  // Epilogue: add rsp, 8; pop r12; pop rbx; ret
+  jf->offsets[n] = c.len;
+  static const unsigned char epilogue[] = {0x48, 0x83, 0xC4, 0x08, 0x41, 0x5C, 0x5B, 0xC3};
+  emit(&c, epilogue, sizeof(epilogue));
+  for (size_t i = 0; i < fix.len; ++i) patch(&c, fix.items[i].at, jf->offsets[fix.items[i].target]);
+  free(fix.items);
+
+  // W^X: fill a writable mapping, then flip it to read+execute
+  void *mem = mmap(NULL, c.len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem != MAP_FAILED) {
+    memcpy(mem, c.items, c.len);
+    if (mprotect(mem, c.len, PROT_READ | PROT_EXEC) == 0) { jf->code = mem; jf->code_size = c.len; jf->state = JIT_COMPILED; }
+    else munmap(mem, c.len);
+  }
+  if (jit->ctx->debug_exec) fprintf(stderr, "[jit] %s %s: %zu instrs (%zu templated) -> %zu bytes\n", jf->state == JIT_COMPILED ? "compiled" : "failed", f->name ? f->name : "?", n, inlined, c.len);
+  if (jf->state == JIT_COMPILED) jit->ctx->jit_compiled++;
+  free(c.items);
+}
+
+#else
+
+int jit_supported(void){ return 0; }
+
+static void compile(JitState *jit, const IrFunc *f, JitFunc *jf){
+  (void)f;
+  jf->state = JIT_FAILED;
+  if (jit->ctx->debug_exec) fprintf(stderr, "[jit] no code generator for this host; interpreting\n");
+}
+
+#endif
+
+int jit_enter(JitState *jit, ExecFrame *fr, size_t ip, int at_call){
+  const IrFunc *base = jit->prog->funcs.items;
+  if (fr->f < base || fr->f >= base + jit->prog->funcs.len) return 0;
+  JitFunc *jf = &jit->funcs[fr->f - base];
+  if (jf->state == JIT_COLD) {
+    jf->hotness += at_call ? JIT_CALL_WEIGHT : 1;
+    if (jf->hotness < jit->threshold) return 0;
+    compile(jit, fr->f, jf);
+  }
+  if (jf->state != JIT_COMPILED) return 0;
+  JitCode code; void *mem = jf->code;
+  memcpy(&code, &mem, sizeof(code));
+  code(fr, jf->code + jf->offsets[ip]);
+  return 1;
+}
@@ -0,0 +1,137 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/json.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char *json_skip_ws(const char *p){
+  while (*p && isspace((unsigned char)*p)) p++;
+  return p;
+}
+
+static void put_utf8(char *out, size_t *n, unsigned long cp){
+  if (cp < 0x80) out[(*n)++] = (char)cp;
+  else if (cp < 0x800) { out[(*n)++] = (char)(0xC0 | (cp >> 6)); out[(*n)++] = (char)(0x80 | (cp & 0x3F)); }
+  else if (cp < 0x10000) { out[(*n)++] = (char)(0xE0 | (cp >> 12)); out[(*n)++] = (char)(0x80 | ((cp >> 6) & 0x3F)); out[(*n)++] = (char)(0x80 | (cp & 0x3F)); }
+  else { out[(*n)++] = (char)(0xF0 | (cp >> 18)); out[(*n)++] = (char)(0x80 | ((cp >> 12) & 0x3F)); out[(*n)++] = (char)(0x80 | ((cp >> 6) & 0x3F)); out[(*n)++] = (char)(0x80 | (cp & 0x3F)); }
+}
+
+static int hex4(const char *p, unsigned long *out){
+  char digits[5];
+  for (int k = 0; k < 4; k++) { if (!isxdigit((unsigned char)p[k])) return 0; digits[k] = p[k]; }
+  digits[4] = '\0';
+  *out = strtoul(digits, NULL, 16);
+  return 1;
+}
+
+char *json_parse_string(const char **pp){
+  const char *p = *pp + 1;
+  size_t cap = 0;
+  for (const char *q = p; *q && *q != '"'; q++) { cap++; if (*q == '\\' && q[1]) q++; }
+  char *out = malloc(cap * 2 + 1); // a \u escape is 6 bytes or more and at most 4 once decoded
+  size_t n = 0;
+  while (*p && *p != '"') {
+    if (*p != '\\') { out[n++] = *p++; continue; }
+    p++;
+    switch (*p) {
+    case '"': case '\\': case '/': out[n++] = *p; break;
+    case 'b': out[n++] = '\b'; break;
+    case 'f': out[n++] = '\f'; break;
+    case 'n': out[n++] = '\n'; break;
+    case 'r': out[n++] = '\r'; break;
+    case 't': out[n++] = '\t'; break;
+    case 'u': {
+      unsigned long cp, lo;
+      if (!hex4(p + 1, &cp)) { free(out); return NULL; }
+      p += 4;
+      if (cp >= 0xD800 && cp < 0xDC00 && p[1] == '\\' && p[2] == 'u' && hex4(p + 3, &lo) && lo >= 0xDC00 && lo < 0xE000) {
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+        p += 6;
+      } else if (cp >= 0xD800 && cp < 0xE000) {
+        cp = 0xFFFD; // half a pair has no UTF-8 form
+      }
+      if (cp == 0) { free(out); return NULL; }
+      put_utf8(out, &n, cp);
+      break; }
+    default: free(out); return NULL;
+    }
+    p++;
+  }
+  if (*p != '"') { free(out); return NULL; }
+  out[n] = '\0';
+  *pp = p + 1;
+  return out;
+}
+
+const char *json_skip_value(const char *p){
+  if (*p == '"') {
+    for (p++; *p && *p != '"'; p++) if (*p == '\\' && !*++p) return NULL;
+    return *p ? p + 1 : NULL;
+  }
+  if (*p == '{' || *p == '[') {
+    char close = *p == '{' ? '}' : ']';
+    p = json_skip_ws(p + 1);
+    if (*p == close) return p + 1;
+    for (;;) {
+      if (close == '}') {
+        if (*p != '"' || !(p = json_skip_value(p))) return NULL;
+        p = json_skip_ws(p);
+        if (*p != ':') return NULL;
+        p = json_skip_ws(p + 1);
+      }
+      if (!(p = json_skip_value(p))) return NULL;
+      p = json_skip_ws(p);
+      if (*p == close) return p + 1;
+      if (*p != ',') return NULL;
+      p = json_skip_ws(p + 1);
+    }
+  }
+  if (strncmp(p, "true", 4) == 0 || strncmp(p, "null", 4) == 0) return p + 4;
+  if (strncmp(p, "false", 5) == 0) return p + 5;
+  char *end;
+  strtod(p, &end);
+  return end == p ? NULL : end;
+}
+
+const char *json_object_member(const char *p, const char *key){
+  size_t klen = strlen(key);
+  p = json_skip_ws(p);
+  if (*p != '{') return NULL;
+  p = json_skip_ws(p + 1);
+  while (*p == '"') {
+    const char *name = p;
+    if (!(p = json_skip_value(p))) return NULL;
+    int match = (size_t)(p - name) == klen + 2 && memcmp(name + 1, key, klen) == 0;
+    p = json_skip_ws(p);
+    if (*p != ':') return NULL;
+    p = json_skip_ws(p + 1);
+    if (match) return p;
+    if (!(p = json_skip_value(p))) return NULL;
+    p = json_skip_ws(p);
+    if (*p != ',') return NULL;
+    p = json_skip_ws(p + 1);
+  }
+  return NULL;
+}
+
+char *json_object_string(const char *p, const char *key){
+  p = json_object_member(p, key);
+  return p && *p == '"' ? json_parse_string(&p) : NULL;
+}
+
+void json_escape(FILE *f, const char *s, size_t len){
+  for (size_t i = 0; i < len; ++i) {
+    unsigned char c = (unsigned char)s[i];
+    switch (c) {
+    case '\\': fputs("\\\\", f); break;
+    case '"': fputs("\\\"", f); break;
+    case '\n': fputs("\\n", f); break;
+    case '\r': fputs("\\r", f); break;
+    case '\t': fputs("\\t", f); break;
+    default:
+      if (c < 0x20) fprintf(f, "\\u%04x", c);
+      else fputc(c, f);
+    }
+  }
+}
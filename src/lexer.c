@@ -1,6 +1,7 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include "liminal/lexer.h"
+#include "liminal/alloc.h"
 
 #include <ctype.h>
 #include <stdio.h>
@@ -99,7 +100,7 @@ static LiminalSpan make_span(size_t start_pos, size_t end_pos, int start_line,
 }
 
 Lexer *lexer_create(const char *input, size_t length) {
-  Lexer *lx = (Lexer *)calloc(1, sizeof(Lexer));
+  Lexer *lx = (Lexer *)lm_calloc(1, sizeof(Lexer));
   lx->src = input;
   lx->len = length;
   lx->pos = 0;
@@ -108,7 +109,7 @@ Lexer *lexer_create(const char *input, size_t length) {
   return lx;
 }
 
-void lexer_destroy(Lexer *lexer) { free(lexer); }
+void lexer_destroy(Lexer *lexer) { lm_free(lexer); }
 
 static int peek(const Lexer *lx) {
   if (lx->pos >= lx->len) return EOF;
@@ -337,6 +338,9 @@ Token lexer_next(Lexer *lx) {
   case '!':
     advance(lx);
     return make_token(lx, TK_BANG, start, lx->pos, start_line, start_col);
+  case '|':
+    advance(lx);
+    return make_token(lx, TK_PIPE, start, lx->pos, start_line, start_col);
   case ':':
     if (peek_next(lx) == '=') {
       advance(lx); advance(lx);
@@ -427,6 +431,7 @@ const char *token_kind_name(TokenKind kind) {
   case TK_NOT: return "NOT";
   case TK_QMARK: return "?";
   case TK_BANG: return "!";
+  case TK_PIPE: return "|";
   case TK_ERROR: return "ERROR";
   }
   return "UNKNOWN";
@@ -0,0 +1,105 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/ngrams.h"
+#include "liminal/exec.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Ops are packed one byte each (op + 1, so 0 means empty), first op lowest
+#define NGRAM_MAX_LEN 6
+
+typedef struct { uint64_t key; size_t count; } NgramSlot;
+
+struct OpNgrams {
+  int max_len;
+  NgramSlot *slots;
+  size_t cap;
+  size_t used;
+  size_t executed;
+};
+
+OpNgrams *op_ngrams_new(int max_len){
+  OpNgrams *ng = calloc(1, sizeof(OpNgrams));
+  ng->max_len = max_len < 2 ? 2 : max_len > NGRAM_MAX_LEN ? NGRAM_MAX_LEN : max_len;
+  ng->cap = 1024;
+  ng->slots = calloc(ng->cap, sizeof(NgramSlot));
+  return ng;
+}
+
+void op_ngrams_free(OpNgrams *ng){
+  if (!ng) return;
+  free(ng->slots);
+  free(ng);
+}
+
+static NgramSlot *slot_for(NgramSlot *slots, size_t cap, uint64_t key){
+  size_t i = (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (cap - 1);
+  while (slots[i].key && slots[i].key != key) i = (i + 1) & (cap - 1);
+  return &slots[i];
+}
+
+static void add(OpNgrams *ng, uint64_t key){
+  if (2 * (ng->used + 1) > ng->cap) {
+    size_t cap = ng->cap * 2;
+    NgramSlot *slots = calloc(cap, sizeof(NgramSlot));
+    for (size_t i = 0; i < ng->cap; ++i) if (ng->slots[i].key) *slot_for(slots, cap, ng->slots[i].key) = ng->slots[i];
+    free(ng->slots);
+    ng->slots = slots; ng->cap = cap;
+  }
+  NgramSlot *s = slot_for(ng->slots, ng->cap, key);
+  if (!s->key) { s->key = key; ng->used++; }
+  s->count++;
+}
+
+void op_ngrams_count(OpNgrams *ng, const IrFunc *f, size_t ip){
+  ng->executed++;
+  if (f->instrs.items[ip].op == IR_LABEL) return;
+  uint64_t key = 0;
+  for (int k = 0; k < ng->max_len && ip + (size_t)k < f->instrs.len; ++k) {
+    IrOp op = f->instrs.items[ip + (size_t)k].op;
+    if (k > 0 && op == IR_LABEL) break;
+    key |= (uint64_t)(op + 1) << (8 * k);
+    if (k > 0) add(ng, key);
+    if (op == IR_JUMP || op == IR_JUMP_IF_FALSE || op == IR_RET) break;
+  }
+}
+
+static int by_count_desc(const void *a, const void *b){
+  const NgramSlot *x = a, *y = b;
+  if (x->count != y->count) return x->count < y->count ? 1 : -1;
+  return x->key < y->key ? -1 : x->key > y->key;
+}
+
+void op_ngrams_report(const OpNgrams *ng, size_t top, FILE *out){
+  NgramSlot *sorted = malloc((ng->used ? ng->used : 1) * sizeof(NgramSlot));
+  size_t n = 0;
+  for (size_t i = 0; i < ng->cap; ++i) if (ng->slots[i].key) sorted[n++] = ng->slots[i];
+  qsort(sorted, n, sizeof(NgramSlot), by_count_desc);
+  for (size_t i = 0; i < n && i < top; ++i) {
+    fprintf(out, "%12zu %6.2f%% ", sorted[i].count, ng->executed ? 100.0 * (double)sorted[i].count / (double)ng->executed : 0.0);
+    for (uint64_t key = sorted[i].key; key; key >>= 8) fprintf(out, " %s", ir_op_name((IrOp)((key & 0xFF) - 1)));
+    fputc('\n', out);
+  }
+  free(sorted);
+}
+
+int liminal_ngrams_files(const char **paths, size_t count, int max_len, size_t top, int raw, FILE *out){
+  OpNgrams *ng = op_ngrams_new(max_len);
+  FILE *sink = fopen("/dev/null", "w");
+  int rc = 0;
+  for (size_t i = 0; i < count; ++i) {
+    LiminalContext ctx;
+    liminal_context_init(&ctx);
+    if (sink) ctx.out = sink;
+    ctx.ngrams = ng;
+    if (raw) ctx.fuse = 0;
+    if (liminal_run_file_ctx(&ctx, paths[i]) != 0) { fprintf(stderr, "%s: run failed\n", paths[i]); rc = 1; }
+    liminal_context_free(&ctx);
+  }
+  if (sink) fclose(sink);
+  fprintf(out, "# %zu instructions executed in %zu program(s)%s; count, share of executed instructions, sequence\n", ng->executed, count, raw ? " (no superinstructions)" : "");
+  op_ngrams_report(ng, top, out);
+  op_ngrams_free(ng);
+  return rc;
+}
@@ -0,0 +1,179 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/oracles.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Answers by prompt hash, open addressing with linear probing; text NULL
+// marks a free slot
+typedef struct {
+  char hash[65];
+  char *text;
+} CacheEntry;
+
+typedef struct {
+  Oracle *inner;
+  CacheEntry *entries;
+  size_t cap;   // a power of two
+  size_t len;
+  size_t hits;
+  size_t misses;
+  pthread_mutex_t lock; // guards entries and the counters
+} OracleCache;
+
+static size_t slot_of(const OracleCache *c, const char *hash) {
+  // The hash is hex SHA-256: its first digits are as good as any
+  size_t h = 0;
+  for (int k = 0; k < 8; ++k) h = h * 16 + (size_t)(hash[k] <= '9' ? hash[k] - '0' : hash[k] - 'a' + 10);
+  size_t i = h & (c->cap - 1);
+  while (c->entries[i].text && strcmp(c->entries[i].hash, hash) != 0) i = (i + 1) & (c->cap - 1);
+  return i;
+}
+
+// A copy of the cached answer, counted as a hit; a miss is counted unless
+// count_miss is 0 (the caller counts it once the request is out)
+static char *cache_get(OracleCache *c, const char *hash, int count_miss) {
+  pthread_mutex_lock(&c->lock);
+  char *text = c->cap ? c->entries[slot_of(c, hash)].text : NULL;
+  text = text ? strdup(text) : NULL;
+  if (text) c->hits++;
+  else c->misses += count_miss != 0;
+  pthread_mutex_unlock(&c->lock);
+  return text;
+}
+
+// Keeps successful answers; the first of two racing answers stays
+static void cache_put(OracleCache *c, const char *hash, const OracleResult *r) {
+  if (!r->ok || !r->text) return;
+  pthread_mutex_lock(&c->lock);
+  if ((c->len + 1) * 2 > c->cap) {
+    CacheEntry *old = c->entries;
+    size_t old_cap = c->cap;
+    c->cap = c->cap ? c->cap * 2 : 64;
+    c->entries = (CacheEntry *)calloc(c->cap, sizeof(CacheEntry));
+    for (size_t i = 0; i < old_cap; ++i) if (old[i].text) c->entries[slot_of(c, old[i].hash)] = old[i];
+    free(old);
+  }
+  CacheEntry *e = &c->entries[slot_of(c, hash)];
+  if (!e->text) {
+    memcpy(e->hash, hash, sizeof(e->hash));
+    e->text = strdup(r->text);
+    c->len++;
+  }
+  pthread_mutex_unlock(&c->lock);
+}
+
+static void prompt_hash(const char *prompt, char hash[65]) {
+  char *canon = oracle_canonicalize_prompt(prompt);
+  oracle_hash_prompt(canon, hash);
+  free(canon);
+}
+
+static OracleResult hit(char *text) {
+  OracleResult r = {0};
+  r.ok = 1;
+  r.text = text;
+  return r;
+}
+
+static OracleResult cache_call(void *impl, const char *prompt) {
+  OracleCache *c = (OracleCache *)impl;
+  char hash[65];
+  prompt_hash(prompt, hash);
+  char *text = cache_get(c, hash, 1);
+  if (text) return hit(text);
+  OracleResult r = oracle_call_text(c->inner, prompt);
+  cache_put(c, hash, &r);
+  return r;
+}
+
+// A cached answer comes as one chunk
+static OracleResult cache_stream(void *impl, const char *prompt, OracleChunkFn on_chunk, void *user) {
+  OracleCache *c = (OracleCache *)impl;
+  char hash[65];
+  prompt_hash(prompt, hash);
+  char *text = cache_get(c, hash, 1);
+  if (text) {
+    if (*text) on_chunk(user, text, strlen(text));
+    return hit(text);
+  }
+  OracleResult r = oracle_stream_text(c->inner, prompt, on_chunk, user);
+  cache_put(c, hash, &r);
+  return r;
+}
+
+// A started call holds either the cached answer or the inner provider's
+// request
+typedef struct {
+  char hash[65];
+  char *text;
+  void *inner;
+} CacheCall;
+
+// A miss counts only once the inner request is out: when it cannot start,
+// the ask goes through cache_call, which looks it up (and counts it) again
+static void *cache_start(void *impl, const char *prompt) {
+  OracleCache *c = (OracleCache *)impl;
+  CacheCall *call = (CacheCall *)calloc(1, sizeof(CacheCall));
+  prompt_hash(prompt, call->hash);
+  call->text = cache_get(c, call->hash, 0);
+  if (call->text) return call;
+  call->inner = oracle_start_text(c->inner, prompt);
+  if (!call->inner) {
+    free(call);
+    return NULL;
+  }
+  pthread_mutex_lock(&c->lock);
+  c->misses++;
+  pthread_mutex_unlock(&c->lock);
+  return call;
+}
+
+static OracleResult cache_finish(void *impl, void *handle) {
+  OracleCache *c = (OracleCache *)impl;
+  CacheCall *call = (CacheCall *)handle;
+  OracleResult r;
+  if (call->text) {
+    r = hit(call->text);
+  } else {
+    r = oracle_finish_text(c->inner, call->inner);
+    cache_put(c, call->hash, &r);
+  }
+  free(call);
+  return r;
+}
+
+static int cache_ready(void *impl, void *handle) {
+  CacheCall *call = (CacheCall *)handle;
+  return call->text || oracle_ready_text(((OracleCache *)impl)->inner, call->inner);
+}
+
+static void cache_destroy(void *impl) {
+  OracleCache *c = (OracleCache *)impl;
+  oracle_free(c->inner);
+  for (size_t i = 0; i < c->cap; ++i) free(c->entries[i].text);
+  free(c->entries);
+  pthread_mutex_destroy(&c->lock);
+  free(c);
+}
+
+Oracle *oracle_with_cache(Oracle *inner) {
+  OracleCache *c = (OracleCache *)calloc(1, sizeof(OracleCache));
+  c->inner = inner;
+  pthread_mutex_init(&c->lock, NULL);
+  Oracle *o = oracle_alloc(inner ? inner->kind : ORACLE_KIND_NONE, c, cache_call, cache_destroy);
+  o->stream_text = cache_stream;
+  o->start_text = cache_start;
+  o->finish_text = cache_finish;
+  o->ready_text = cache_ready;
+  o->inner = inner;
+  return o;
+}
+
+void oracle_cache_stats(Oracle *o, size_t *hits, size_t *misses) {
+  OracleCache *c = o && o->call_text == cache_call ? (OracleCache *)o->impl : NULL;
+  if (c) pthread_mutex_lock(&c->lock);
+  if (hits) *hits = c ? c->hits : 0;
+  if (misses) *misses = c ? c->misses : 0;
+  if (c) pthread_mutex_unlock(&c->lock);
+}
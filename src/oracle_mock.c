@@ -1,7 +1,18 @@
 #define _POSIX_C_SOURCE 200809L
 #include "liminal/oracles.h"
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+typedef struct {
+  char *prompt;
+  char *text;
+  char *error;
+} MockAnswer;
 
 typedef struct {
   char **texts;
@@ -9,27 +20,103 @@ typedef struct {
   size_t len;
   size_t cap;
   size_t idx;
+  MockAnswer *answers;  // by prompt, ahead of the queue
+  size_t nanswers;
+  long latency_ms;
+  pthread_mutex_t lock; // guards the queue, idx and answers
 } OracleMock;
 
-static OracleResult mock_call(void *impl, const char *prompt) {
-  (void)prompt;
-  OracleMock *m = (OracleMock *)impl;
+static uint64_t now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static void sleep_until(uint64_t due) {
+  uint64_t now = now_ms();
+  if (due <= now) return;
+  struct timespec ts = { (time_t)((due - now) / 1000), (long)((due - now) % 1000) * 1000000L };
+  while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+// The answer for prompt, without the latency
+static OracleResult mock_pick(OracleMock *m, const char *prompt) {
   OracleResult r = {0};
-  if (m->idx >= m->len) {
+  pthread_mutex_lock(&m->lock);
+  char *t, *e;
+  size_t a = 0;
+  while (a < m->nanswers && strcmp(m->answers[a].prompt, prompt ? prompt : "") != 0) a++;
+  if (a < m->nanswers) {
+    t = m->answers[a].text;
+    e = m->answers[a].error;
+  } else if (m->idx < m->len) {
+    t = m->texts[m->idx];
+    e = m->errors[m->idx];
+    m->idx++;
+  } else {
+    pthread_mutex_unlock(&m->lock);
     r.ok = 0;
     r.error = strdup("mock: no queued response");
     return r;
   }
-  char *t = m->texts[m->idx];
-  char *e = m->errors[m->idx];
-  m->idx++;
-  if (e) {
-    r.ok = 0;
-    r.error = strdup(e);
-    return r;
+  // Both copied under the lock: oracle_mock_answer may replace them
+  r.text = e ? NULL : t ? strdup(t) : strdup("");
+  r.error = e ? strdup(e) : NULL;
+  pthread_mutex_unlock(&m->lock);
+  r.ok = !e;
+  return r;
+}
+
+static OracleResult mock_call(void *impl, const char *prompt) {
+  OracleMock *m = (OracleMock *)impl;
+  if (m->latency_ms > 0) sleep_until(now_ms() + (uint64_t)m->latency_ms);
+  return mock_pick(m, prompt);
+}
+
+// A started call: the answer is picked at once and held back until due
+typedef struct {
+  OracleResult r;
+  uint64_t due;
+} MockCall;
+
+static void *mock_start(void *impl, const char *prompt) {
+  OracleMock *m = (OracleMock *)impl;
+  MockCall *c = (MockCall *)calloc(1, sizeof(MockCall));
+  c->due = now_ms() + (uint64_t)(m->latency_ms > 0 ? m->latency_ms : 0);
+  c->r = mock_pick(m, prompt);
+  return c;
+}
+
+static int mock_ready(void *impl, void *call) {
+  (void)impl;
+  return now_ms() >= ((MockCall *)call)->due;
+}
+
+static OracleResult mock_finish(void *impl, void *call) {
+  (void)impl;
+  MockCall *c = (MockCall *)call;
+  sleep_until(c->due);
+  OracleResult r = c->r;
+  free(c);
+  return r;
+}
+
+// One word and the whitespace after it per chunk, as a model's tokens arrive
+static OracleResult mock_stream(void *impl, const char *prompt, OracleChunkFn on_chunk, void *user) {
+  OracleResult r = mock_call(impl, prompt);
+  if (!r.ok) return r;
+  const char *p = r.text;
+  while (*p) {
+    const char *end = p;
+    while (*end && isspace((unsigned char)*end)) end++;
+    while (*end && !isspace((unsigned char)*end)) end++;
+    while (*end && isspace((unsigned char)*end)) end++;
+    if (!on_chunk(user, p, (size_t)(end - p))) {
+      r.text[end - r.text] = '\0';
+      break;
+    }
+    p = end;
   }
-  r.ok = 1;
-  r.text = t ? strdup(t) : strdup("");
   return r;
 }
 
@@ -41,17 +128,31 @@ static void mock_destroy(void *impl) {
   }
   free(m->texts);
   free(m->errors);
+  for (size_t i = 0; i < m->nanswers; ++i) {
+    free(m->answers[i].prompt);
+    free(m->answers[i].text);
+    free(m->answers[i].error);
+  }
+  free(m->answers);
+  pthread_mutex_destroy(&m->lock);
   free(m);
 }
 
 Oracle *oracle_create_mock(void) {
   OracleMock *m = (OracleMock *)calloc(1, sizeof(OracleMock));
-  return oracle_alloc(ORACLE_KIND_MOCK, m, mock_call, mock_destroy);
+  pthread_mutex_init(&m->lock, NULL);
+  Oracle *o = oracle_alloc(ORACLE_KIND_MOCK, m, mock_call, mock_destroy);
+  o->stream_text = mock_stream;
+  o->start_text = mock_start;
+  o->finish_text = mock_finish;
+  o->ready_text = mock_ready;
+  return o;
 }
 
 void oracle_mock_queue(Oracle *o, const char *text_or_null, const char *error_or_null) {
   if (!o || o->kind != ORACLE_KIND_MOCK) return;
   OracleMock *m = (OracleMock *)o->impl;
+  pthread_mutex_lock(&m->lock);
   if (m->len == m->cap) {
     m->cap = m->cap ? m->cap * 2 : 4;
     m->texts = (char **)realloc(m->texts, m->cap * sizeof(char *));
@@ -60,4 +161,28 @@ void oracle_mock_queue(Oracle *o, const char *text_or_null, const char *error_or
   m->texts[m->len] = text_or_null ? strdup(text_or_null) : NULL;
   m->errors[m->len] = error_or_null ? strdup(error_or_null) : NULL;
   m->len++;
+  pthread_mutex_unlock(&m->lock);
+}
+
+void oracle_mock_answer(Oracle *o, const char *prompt, const char *text_or_null, const char *error_or_null) {
+  if (!o || o->kind != ORACLE_KIND_MOCK) return;
+  OracleMock *m = (OracleMock *)o->impl;
+  pthread_mutex_lock(&m->lock);
+  size_t a = 0;
+  while (a < m->nanswers && strcmp(m->answers[a].prompt, prompt ? prompt : "") != 0) a++;
+  if (a == m->nanswers) {
+    m->answers = (MockAnswer *)realloc(m->answers, ++m->nanswers * sizeof(MockAnswer));
+    m->answers[a].prompt = strdup(prompt ? prompt : "");
+  } else {
+    free(m->answers[a].text);
+    free(m->answers[a].error);
+  }
+  m->answers[a].text = text_or_null ? strdup(text_or_null) : NULL;
+  m->answers[a].error = error_or_null ? strdup(error_or_null) : NULL;
+  pthread_mutex_unlock(&m->lock);
+}
+
+void oracle_mock_set_latency(Oracle *o, long ms) {
+  if (!o || o->kind != ORACLE_KIND_MOCK) return;
+  ((OracleMock *)o->impl)->latency_ms = ms;
 }
@@ -1,24 +1,27 @@
 #define _POSIX_C_SOURCE 200809L
 #include "liminal/oracles.h"
+#include "liminal/http.h"
+#include "liminal/http_loop.h"
+#include "liminal/json.h"
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 #include <stdio.h>
-#include <unistd.h>
-#include <sys/stat.h>
-
-// Simple availability check: curl must exist
-static int curl_exists(void) {
-  return access("/usr/bin/curl", X_OK) == 0 || access("/bin/curl", X_OK) == 0 || access("curl", X_OK) == 0;
-}
 
+// The HTTP client is built in
 int oracle_ollama_available(void) {
-  return curl_exists();
+  return 1;
 }
 
 typedef struct {
   char *endpoint;
   char *model;
+  HttpPool *http;  // NULL when the endpoint is not a usable URL
+  char *error;     // why http is NULL
+  HttpLoop *loop;  // started with the first ask
+  int loop_failed; // no event loop here: asks use the blocking client
+  pthread_mutex_t lock; // guards loop and loop_failed
 } Ollama;
 
 static char *json_escape_str(const char *s) {
@@ -47,95 +50,190 @@ static char *json_escape_str(const char *s) {
   return out;
 }
 
-static char *run_curl_and_capture(const char *cmd) {
-  FILE *p = popen(cmd, "r");
-  if (!p) return NULL;
-  char *buf = NULL; size_t cap = 0; size_t len = 0;
-  char chunk[512];
-  while (!feof(p)) {
-    size_t n = fread(chunk, 1, sizeof(chunk), p);
-    if (n > 0) {
-      if (len + n + 1 > cap) { cap = cap ? cap * 2 : 1024; while (cap < len + n + 1) cap *= 2; buf = (char *)realloc(buf, cap); }
-      memcpy(buf + len, chunk, n); len += n; buf[len] = '\0';
-    }
-  }
-  pclose(p);
-  return buf;
-}
-
-static char *parse_ollama_response(const char *json) {
-  // Naive parse: find "response":"..."
-  const char *p = strstr(json, "\"response\":");
-  if (!p) return NULL;
-  p += strlen("\"response\":");
-  while (*p && (*p==' ' || *p=='\t')) p++;
-  if (*p != '"') return NULL;
-  p++;
-  const char *start = p;
-  int escapes = 0;
-  while (*p) {
-    if (*p == '\\') { escapes = 1; p += 2; continue; }
-    if (*p == '"') break;
-    p++;
+// The /api/generate request body
+static char *generate_body(const Ollama *o, const char *prompt, int stream, int *len) {
+  char *esc_prompt = json_escape_str(prompt);
+  char *esc_model = json_escape_str(o->model);
+  size_t n = strlen(esc_prompt) + strlen(esc_model) + 48;
+  char *body = (char *)malloc(n);
+  *len = snprintf(body, n, "{\"model\":\"%s\",\"prompt\":\"%s\",\"stream\":%s}", esc_model, esc_prompt,
+                  stream ? "true" : "false");
+  free(esc_prompt); free(esc_model);
+  return body;
+}
+
+static char *status_error(int status, const char *body) {
+  char *why = body ? json_object_string(body, "error") : NULL;
+  size_t m = (why ? strlen(why) : 0) + 32;
+  char *msg = (char *)malloc(m);
+  snprintf(msg, m, "ollama HTTP %d%s%s", status, why ? ": " : "", why ? why : "");
+  free(why);
+  return msg;
+}
+
+// The result of a non-streamed /api/generate request
+static OracleResult answer(int sent, HttpResponse *http, char *err) {
+  OracleResult res = {0};
+  if (!sent) { res.ok=0; res.error=err; return res; }
+  if (http->status != 200) {
+    res.ok = 0;
+    res.error = status_error(http->status, http->body);
+    http_response_free(http);
+    return res;
   }
-  if (*p != '"') return NULL;
-  size_t len = (size_t)(p - start);
-  char *val = (char *)malloc(len + 1);
-  memcpy(val, start, len); val[len] = '\0';
-  if (!escapes) return val;
-  // unescape
-  char *w = val; char *r = val;
-  while (*r) {
-    if (*r == '\\') {
-      r++;
-      switch (*r) {
-      case 'n': *w++='\n'; r++; break;
-      case 'r': *w++='\r'; r++; break;
-      case 't': *w++='\t'; r++; break;
-      case '\\': *w++='\\'; r++; break;
-      case '"': *w++='"'; r++; break;
-      default: *w++='\\'; break;
-      }
-    } else {
-      *w++ = *r++;
-    }
+  char *resp = json_object_string(http->body, "response");
+  http_response_free(http);
+  if (!resp) { res.ok=0; res.error=strdup("ollama parse failed"); return res; }
+  res.ok = 1;
+  res.text = resp;
+  return res;
+}
+
+static HttpLoop *event_loop(Ollama *o) {
+  pthread_mutex_lock(&o->lock);
+  if (!o->loop && !o->loop_failed) {
+    o->loop = http_loop_new(NULL);
+    o->loop_failed = !o->loop;
   }
-  *w = '\0';
-  return val;
+  HttpLoop *loop = o->loop;
+  pthread_mutex_unlock(&o->lock);
+  return loop;
+}
+
+static void *ollama_start(void *impl, const char *prompt) {
+  Ollama *o = (Ollama *)impl;
+  HttpLoop *loop = o->http ? event_loop(o) : NULL;
+  if (!loop) return NULL;
+  int len;
+  char *body = generate_body(o, prompt, 0, &len);
+  HttpCall *c = http_loop_post(loop, o->http, "/api/generate", "application/json", body, (size_t)len);
+  free(body);
+  return c;
+}
+
+static OracleResult ollama_finish(void *impl, void *call) {
+  (void)impl;
+  HttpResponse http;
+  char *err = NULL;
+  int sent = http_call_wait((HttpCall *)call, &http, &err);
+  return answer(sent, &http, err);
+}
+
+static int ollama_ready(void *impl, void *call) {
+  (void)impl;
+  return http_call_done((HttpCall *)call);
 }
 
 static OracleResult ollama_call(void *impl, const char *prompt) {
   Ollama *o = (Ollama *)impl;
   OracleResult res = {0};
-  if (!curl_exists()) { res.ok=0; res.error=strdup("curl not found"); return res; }
-  char *esc_prompt = json_escape_str(prompt);
-  char *esc_model = json_escape_str(o->model);
-  // Write JSON to tmp file
-  char tmpl[] = "/tmp/ollama_req_XXXXXX";
-  int fd = mkstemp(tmpl);
-  if (fd < 0) { free(esc_prompt); free(esc_model); res.ok=0; res.error=strdup("mkstemp failed"); return res; }
-  FILE *f = fdopen(fd, "w");
-  if (!f) { close(fd); unlink(tmpl); free(esc_prompt); free(esc_model); res.ok=0; res.error=strdup("fdopen failed"); return res; }
-  fprintf(f, "{\"model\":\"%s\",\"prompt\":\"%s\",\"stream\":false}\n", esc_model, esc_prompt);
-  fclose(f);
-  char cmd[1024];
-  snprintf(cmd, sizeof(cmd), "curl -s -X POST %s/api/generate -H 'Content-Type: application/json' --data @%s", o->endpoint, tmpl);
-  char *out = run_curl_and_capture(cmd);
-  unlink(tmpl);
-  free(esc_prompt); free(esc_model);
-  if (!out) { res.ok=0; res.error=strdup("curl failed"); return res; }
-  char *resp = parse_ollama_response(out);
-  if (!resp) { res.ok=0; res.error=strdup("ollama parse failed"); free(out); return res; }
-  res.ok = 1;
-  res.text = resp;
-  free(out);
+  if (!o->http) { res.ok=0; res.error=strdup(o->error); return res; }
+  void *call = ollama_start(impl, prompt);
+  if (call) return ollama_finish(impl, call);
+  int len;
+  char *body = generate_body(o, prompt, 0, &len);
+  HttpResponse http;
+  char *err = NULL;
+  int sent = http_post(o->http, "/api/generate", "application/json", body, (size_t)len, &http, &err);
+  free(body);
+  return answer(sent, &http, err);
+}
+
+// With "stream":true the answer is NDJSON, one object per generated piece:
+// {"response":"..","done":false} lines and a final "done":true one. Bytes
+// are cut into lines as they arrive and each piece is passed on at once.
+typedef struct {
+  OracleChunkFn on_chunk;
+  void *user;
+  char *line;           // partial line, or the body of a non-200 answer
+  size_t len, cap;
+  char *text;           // the answer so far
+  size_t text_len, text_cap;
+  char *error;          // an "error" line
+  int done;
+  int stopped;
+} NdjsonReader;
+
+static void grow(char **buf, size_t *cap, size_t need) {
+  if (need <= *cap) return;
+  while (*cap < need) *cap = *cap ? *cap * 2 : 256;
+  *buf = (char *)realloc(*buf, *cap);
+}
+
+// One complete NDJSON line; 0 to stop reading. After "done" the body is
+// still read to its end so the connection can be kept.
+static int ndjson_line(NdjsonReader *nd, const char *line) {
+  if (nd->done || !*line) return 1;
+  char *err = json_object_string(line, "error");
+  if (err) { nd->error = err; return 0; }
+  char *piece = json_object_string(line, "response");
+  if (piece && *piece) {
+    size_t n = strlen(piece);
+    grow(&nd->text, &nd->text_cap, nd->text_len + n + 1);
+    memcpy(nd->text + nd->text_len, piece, n + 1);
+    nd->text_len += n;
+    if (!nd->on_chunk(nd->user, piece, n)) nd->stopped = 1;
+  }
+  free(piece);
+  const char *done = json_object_member(line, "done");
+  if (done && strncmp(done, "true", 4) == 0) nd->done = 1;
+  return !nd->stopped;
+}
+
+static int ndjson_data(void *user, int status, const char *data, size_t len) {
+  NdjsonReader *nd = (NdjsonReader *)user;
+  grow(&nd->line, &nd->cap, nd->len + len + 1);
+  memcpy(nd->line + nd->len, data, len);
+  nd->len += len;
+  nd->line[nd->len] = '\0';
+  if (status != 200) return 1;
+  char *start = nd->line, *nl;
+  int more = 1;
+  while (more && (nl = memchr(start, '\n', (size_t)(nd->line + nd->len - start)))) {
+    *nl = '\0';
+    more = ndjson_line(nd, start);
+    start = nl + 1;
+  }
+  nd->len = (size_t)(nd->line + nd->len - start);
+  memmove(nd->line, start, nd->len + 1);
+  return more;
+}
+
+static OracleResult ollama_stream(void *impl, const char *prompt, OracleChunkFn on_chunk, void *user) {
+  Ollama *o = (Ollama *)impl;
+  OracleResult res = {0};
+  if (!o->http) { res.ok=0; res.error=strdup(o->error); return res; }
+  int len;
+  char *body = generate_body(o, prompt, 1, &len);
+  NdjsonReader nd = {0};
+  nd.on_chunk = on_chunk;
+  nd.user = user;
+  int status = 0;
+  char *err = NULL;
+  int sent = http_post_stream(o->http, "/api/generate", "application/json", body, (size_t)len, ndjson_data, &nd,
+                              &status, &err);
+  free(body);
+  // A last line without its newline
+  if (sent && status == 200 && nd.len && !nd.done && !nd.stopped && !nd.error) ndjson_line(&nd, nd.line);
+  if (!sent) { res.ok=0; res.error=err; }
+  else if (status != 200) { res.ok=0; res.error=status_error(status, nd.line); }
+  else if (nd.error) { res.ok=0; res.error=nd.error; nd.error=NULL; }
+  else if (!nd.done && !nd.stopped) { res.ok=0; res.error=strdup("ollama stream ended early"); }
+  else { res.ok=1; res.text=nd.text ? nd.text : strdup(""); nd.text=NULL; }
+  free(nd.line);
+  free(nd.text);
+  free(nd.error);
   return res;
 }
 
 static void ollama_destroy(void *impl) {
   Ollama *o = (Ollama *)impl;
+  http_loop_free(o->loop);
+  http_pool_free(o->http);
+  pthread_mutex_destroy(&o->lock);
   free(o->endpoint);
   free(o->model);
+  free(o->error);
   free(o);
 }
 
@@ -144,5 +242,20 @@ Oracle *oracle_create_ollama(const char *endpoint, const char *model) {
   Ollama *o = (Ollama *)calloc(1, sizeof(Ollama));
   o->endpoint = strdup(endpoint);
   o->model = strdup(model);
-  return oracle_alloc(ORACLE_KIND_OLLAMA, o, ollama_call, ollama_destroy);
+  o->http = http_pool_new(endpoint, &o->error);
+  pthread_mutex_init(&o->lock, NULL);
+  Oracle *oracle = oracle_alloc(ORACLE_KIND_OLLAMA, o, ollama_call, ollama_destroy);
+  oracle->stream_text = ollama_stream;
+  oracle->start_text = ollama_start;
+  oracle->finish_text = ollama_finish;
+  oracle->ready_text = ollama_ready;
+  oracle_set_max_concurrency(oracle, ORACLE_OLLAMA_MAX_CONCURRENCY);
+  return oracle;
+}
+
+void oracle_ollama_set_timeouts(Oracle *o, long connect_ms, long io_ms) {
+  Ollama *ol = (Ollama *)o->impl;
+  if (!ol->http) return;
+  if (connect_ms > 0) ol->http->connect_timeout_ms = connect_ms;
+  if (io_ms > 0) ol->http->io_timeout_ms = io_ms;
 }
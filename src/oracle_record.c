@@ -1,5 +1,8 @@
 #define _POSIX_C_SOURCE 200809L
 #include "liminal/oracles.h"
+#include "liminal/json.h"
+#include "liminal/recordings.h"
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
@@ -9,22 +12,42 @@ typedef struct {
   Oracle *inner;
   char *mode; // live|record|replay
   char *path;
+  long flush_ms;        // record: how long a record may wait to be written
+  pthread_mutex_t lock; // guards opening writer and store
+  RecordWriter *writer; // record: opened at the first answer
+  ReplayStore *store;   // replay: the recordings, read at the first ask
 } OracleRecord;
 
-static void json_escape(FILE *f, const char *s) {
-  for (const char *p = s; *p; ++p) {
-    unsigned char c = (unsigned char)*p;
-    switch (c) {
-    case '\\': fputs("\\\\", f); break;
-    case '"': fputs("\\\"", f); break;
-    case '\n': fputs("\\n", f); break;
-    case '\r': fputs("\\r", f); break;
-    case '\t': fputs("\\t", f); break;
-    default:
-      if (c < 0x20) fprintf(f, "\\u%04x", c);
-      else fputc(c, f);
-    }
-  }
+static void record_append(OracleRecord *r, const char *hash, const char *canon, const OracleResult *inner) {
+  if (strcasecmp(r->mode, "record") != 0) return;
+  pthread_mutex_lock(&r->lock);
+  char *errmsg = NULL;
+  if (!r->writer) r->writer = record_writer_open(r->path, r->flush_ms, &errmsg);
+  RecordWriter *w = r->writer;
+  pthread_mutex_unlock(&r->lock);
+  // As before the writer, an unwritable recording does not fail the ask
+  free(errmsg);
+  if (w) record_writer_append(w, hash, canon, inner);
+}
+
+static OracleResult failure(char *error) {
+  OracleResult res = {0};
+  res.error = error;
+  return res;
+}
+
+// The store is read once, by whichever ask comes first; a file that is not
+// there yet is looked for again at the next ask
+static OracleResult replay_lookup(OracleRecord *r, const char *hash) {
+  pthread_mutex_lock(&r->lock);
+  char *errmsg = NULL;
+  if (!r->store) r->store = replay_store_open(r->path, &errmsg);
+  ReplayStore *store = r->store;
+  pthread_mutex_unlock(&r->lock);
+  if (!store) return failure(errmsg);
+  OracleResult res;
+  if (!replay_store_find(store, hash, &res)) return failure(strdup("replay: prompt not found"));
+  return res;
 }
 
 static OracleResult record_call(void *impl, const char *prompt) {
@@ -33,77 +56,90 @@ static OracleResult record_call(void *impl, const char *prompt) {
   char hash[65]; oracle_hash_prompt(canon, hash);
 
   if (strcasecmp(r->mode, "replay") == 0) {
-    FILE *f = fopen(r->path, "r");
-    if (!f) {
-      OracleResult res = {0}; res.ok = 0; res.error = strdup("replay file not found"); free(canon); return res;
-    }
-    char line[4096];
-    while (fgets(line, sizeof(line), f)) {
-      char *h = strstr(line, "\"hash\":\"");
-      if (!h) continue;
-      h += 8; // move to after "hash":"
-      char *hend = strchr(h, '"');
-      if (!hend) continue;
-      if ((size_t)(hend - h) != 64) continue;
-      if (strncmp(h, hash, 64) != 0) continue;
-      char *resp = strstr(line, "\"response\":\"");
-      if (!resp) { fclose(f); free(canon); OracleResult res={0}; res.ok=0; res.error=strdup("replay response missing"); return res; }
-      resp += 12; // after "response":"
-      char *rend = strchr(resp, '"');
-      if (!rend) { fclose(f); free(canon); OracleResult res={0}; res.ok=0; res.error=strdup("replay malformed"); return res; }
-      size_t len = (size_t)(rend - resp);
-      char *val = (char *)malloc(len + 1);
-      strncpy(val, resp, len); val[len] = '\0';
-      // naive unescape of common sequences
-      // (we only escape \\ and \", \n, \r, \t)
-      {
-        char *p = val, *w = val;
-        while (*p) {
-          if (*p == '\\') {
-            p++;
-            if (*p == 'n') { *w++ = '\n'; p++; }
-            else if (*p == 'r') { *w++ = '\r'; p++; }
-            else if (*p == 't') { *w++ = '\t'; p++; }
-            else if (*p == '\\') { *w++ = '\\'; p++; }
-            else if (*p == '"') { *w++ = '"'; p++; }
-            else { *w++ = '\\'; }
-          } else {
-            *w++ = *p++;
-          }
-        }
-        *w = '\0';
-      }
-      fclose(f); free(canon);
-      OracleResult res = {0}; res.ok = 1; res.text = val; return res;
-    }
-    fclose(f);
     free(canon);
-    OracleResult res = {0}; res.ok = 0; res.error = strdup("replay: prompt not found"); return res;
+    return replay_lookup(r, hash);
   }
 
   // live/record
   OracleResult inner = oracle_call_text(r->inner, prompt);
-  if (strcasecmp(r->mode, "record") == 0) {
-    FILE *f = fopen(r->path, "a");
-    if (f) {
-      fprintf(f, "{\"hash\":\"%s\",\"prompt\":\"", hash);
-      json_escape(f, canon);
-      fprintf(f, "\",\"response\":\"");
-      if (inner.ok && inner.text) json_escape(f, inner.text);
-      else if (!inner.ok && inner.error) json_escape(f, inner.error);
-      fprintf(f, "\",\"ok\":%s}\n", inner.ok ? "true" : "false");
-      fclose(f);
-    }
+  record_append(r, hash, canon, &inner);
+  free(canon);
+  return inner;
+}
+
+// Live and record pass the chunks through and record the whole answer;
+// replay has it at once and delivers it as one chunk
+static OracleResult record_stream(void *impl, const char *prompt, OracleChunkFn on_chunk, void *user) {
+  OracleRecord *r = (OracleRecord *)impl;
+  if (strcasecmp(r->mode, "replay") == 0) {
+    OracleResult res = record_call(impl, prompt);
+    if (res.ok && res.text && *res.text) on_chunk(user, res.text, strlen(res.text));
+    return res;
   }
+  char *canon = oracle_canonicalize_prompt(prompt);
+  char hash[65]; oracle_hash_prompt(canon, hash);
+  OracleResult inner = oracle_stream_text(r->inner, prompt, on_chunk, user);
+  record_append(r, hash, canon, &inner);
   free(canon);
   return inner;
 }
 
+// Live and record start the inner provider's request when it can and
+// record the answer when it is waited for. Replay looks the answer up at
+// the start, so a replayed ask never needs a thread of its own.
+typedef struct {
+  void *inner;
+  char *canon;
+  char hash[65];
+  int replayed;
+  OracleResult result; // replay: the answer
+} RecordCall;
+
+static void *record_start(void *impl, const char *prompt) {
+  OracleRecord *r = (OracleRecord *)impl;
+  if (strcasecmp(r->mode, "replay") == 0) {
+    RecordCall *c = (RecordCall *)calloc(1, sizeof(RecordCall));
+    c->replayed = 1;
+    c->result = record_call(impl, prompt);
+    return c;
+  }
+  void *inner = oracle_start_text(r->inner, prompt);
+  if (!inner) return NULL;
+  RecordCall *c = (RecordCall *)calloc(1, sizeof(RecordCall));
+  c->inner = inner;
+  c->canon = oracle_canonicalize_prompt(prompt);
+  oracle_hash_prompt(c->canon, c->hash);
+  return c;
+}
+
+static OracleResult record_finish(void *impl, void *call) {
+  OracleRecord *r = (OracleRecord *)impl;
+  RecordCall *c = (RecordCall *)call;
+  if (c->replayed) {
+    OracleResult res = c->result;
+    free(c);
+    return res;
+  }
+  OracleResult inner = oracle_finish_text(r->inner, c->inner);
+  record_append(r, c->hash, c->canon, &inner);
+  free(c->canon);
+  free(c);
+  return inner;
+}
+
+static int record_ready(void *impl, void *call) {
+  RecordCall *c = (RecordCall *)call;
+  return c->replayed || oracle_ready_text(((OracleRecord *)impl)->inner, c->inner);
+}
+
 static void record_destroy(void *impl) {
   OracleRecord *r = (OracleRecord *)impl;
   oracle_free(r->inner);
   free(r->mode);
   free(r->path);
+  record_writer_close(r->writer);
+  replay_store_close(r->store);
+  pthread_mutex_destroy(&r->lock);
   free(r);
 }
 
@@ -112,5 +148,33 @@ Oracle *oracle_with_recording(Oracle *inner, const char *mode, const char *path)
   r->inner = inner;
   r->mode = strdup(mode ? mode : "live");
   r->path = strdup(path ? path : "oracle_recordings.jsonl");
-  return oracle_alloc(inner ? inner->kind : ORACLE_KIND_NONE, r, record_call, record_destroy);
+  r->flush_ms = RECORD_WRITER_FLUSH_MS;
+  pthread_mutex_init(&r->lock, NULL);
+  Oracle *o = oracle_alloc(inner ? inner->kind : ORACLE_KIND_NONE, r, record_call, record_destroy);
+  o->stream_text = record_stream;
+  o->start_text = record_start;
+  o->finish_text = record_finish;
+  o->ready_text = record_ready;
+  o->inner = inner;
+  return o;
+}
+
+// o or the recording wrapper below it
+static OracleRecord *recording_of(Oracle *o) {
+  while (o && o->call_text != record_call) o = o->inner;
+  return o ? (OracleRecord *)o->impl : NULL;
+}
+
+void oracle_recording_set_flush_ms(Oracle *o, long ms) {
+  OracleRecord *r = recording_of(o);
+  if (r) r->flush_ms = ms;
+}
+
+int oracle_recording_flush(Oracle *o) {
+  OracleRecord *r = recording_of(o);
+  if (!r) return 0;
+  pthread_mutex_lock(&r->lock);
+  RecordWriter *w = r->writer;
+  pthread_mutex_unlock(&r->lock);
+  return w ? record_writer_flush(w) : 0;
 }
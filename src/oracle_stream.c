@@ -0,0 +1,162 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/oracles.h"
+#include "liminal/alloc.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  char *text;
+  size_t len;
+} Chunk;
+
+struct OracleStream {
+  Oracle *oracle;
+  char *prompt;
+  pthread_t thread;
+  int threaded;          // 0: the stream already ran in oracle_stream_open
+  pthread_mutex_t lock;  // guards everything below
+  pthread_cond_t ready;  // a chunk was queued or the stream ended
+  Chunk *queue;
+  size_t head, len, cap;
+  int ended;
+  int cancelled;
+  OracleResult result;   // valid once ended
+  AllocStats alloc;      // counted on the producer thread, read after the join
+};
+
+// Runs on the producer thread
+static int queue_chunk(void *user, const char *chunk, size_t len) {
+  OracleStream *s = (OracleStream *)user;
+  pthread_mutex_lock(&s->lock);
+  int keep = !s->cancelled;
+  if (keep) {
+    if (s->head == s->len) s->head = s->len = 0;
+    if (s->len == s->cap) {
+      s->cap = s->cap ? s->cap * 2 : 16;
+      s->queue = (Chunk *)realloc(s->queue, s->cap * sizeof(Chunk));
+    }
+    Chunk *c = &s->queue[s->len++];
+    c->text = (char *)malloc(len + 1);
+    memcpy(c->text, chunk, len);
+    c->text[len] = '\0';
+    c->len = len;
+    pthread_cond_signal(&s->ready);
+  }
+  pthread_mutex_unlock(&s->lock);
+  return keep;
+}
+
+static void *produce(void *arg) {
+  OracleStream *s = (OracleStream *)arg;
+  OracleResult r = oracle_stream_text(s->oracle, s->prompt, queue_chunk, s);
+  pthread_mutex_lock(&s->lock);
+  s->result = r;
+  s->ended = 1;
+  pthread_cond_signal(&s->ready);
+  pthread_mutex_unlock(&s->lock);
+  s->alloc = alloc_stats(); // a thread of its own counts from zero
+  return NULL;
+}
+
+OracleStream *oracle_stream_open(Oracle *o, const char *prompt) {
+  OracleStream *s = (OracleStream *)calloc(1, sizeof(OracleStream));
+  s->oracle = o;
+  s->prompt = strdup(prompt ? prompt : "");
+  pthread_mutex_init(&s->lock, NULL);
+  pthread_cond_init(&s->ready, NULL);
+  s->threaded = pthread_create(&s->thread, NULL, produce, s) == 0;
+  // No thread to spare: run the stream here and hand out its chunks after
+  if (!s->threaded) produce(s);
+  return s;
+}
+
+int oracle_stream_next(OracleStream *s, char **chunk, size_t *len) {
+  pthread_mutex_lock(&s->lock);
+  while (s->head == s->len && !s->ended) pthread_cond_wait(&s->ready, &s->lock);
+  int got = s->head < s->len;
+  if (got) {
+    *chunk = s->queue[s->head].text;
+    *len = s->queue[s->head].len;
+    s->head++;
+  }
+  pthread_mutex_unlock(&s->lock);
+  return got;
+}
+
+const OracleResult *oracle_stream_result(const OracleStream *s) {
+  return &s->result;
+}
+
+void oracle_stream_close(OracleStream *s) {
+  if (!s) return;
+  pthread_mutex_lock(&s->lock);
+  s->cancelled = 1;
+  pthread_mutex_unlock(&s->lock);
+  if (s->threaded) {
+    pthread_join(s->thread, NULL);
+    alloc_merge(s->alloc);
+  }
+  for (size_t i = s->head; i < s->len; i++) free(s->queue[i].text);
+  free(s->queue);
+  oracle_result_free(s->result);
+  pthread_mutex_destroy(&s->lock);
+  pthread_cond_destroy(&s->ready);
+  free(s->prompt);
+  free(s);
+}
+
+struct OracleCall {
+  Oracle *oracle;
+  char *prompt;
+  void *pending;         // in flight through the provider's start_text
+  pthread_t thread;
+  int threaded;          // 0: the call already ran in oracle_call_start
+  OracleResult result;   // written by the thread, read after the join
+  pthread_mutex_t lock;  // guards done
+  int done;              // the thread has its result
+  AllocStats alloc;      // counted on the thread, read after the join
+};
+
+static void *call(void *arg) {
+  OracleCall *c = (OracleCall *)arg;
+  c->result = oracle_call_text(c->oracle, c->prompt);
+  pthread_mutex_lock(&c->lock);
+  c->done = 1;
+  pthread_mutex_unlock(&c->lock);
+  c->alloc = alloc_stats(); // a thread of its own counts from zero
+  return NULL;
+}
+
+OracleCall *oracle_call_start(Oracle *o, const char *prompt) {
+  OracleCall *c = (OracleCall *)calloc(1, sizeof(OracleCall));
+  c->oracle = o;
+  c->pending = oracle_start_text(o, prompt ? prompt : "");
+  if (c->pending) return c;
+  c->prompt = strdup(prompt ? prompt : "");
+  pthread_mutex_init(&c->lock, NULL);
+  c->threaded = pthread_create(&c->thread, NULL, call, c) == 0;
+  if (!c->threaded) call(c);
+  return c;
+}
+
+OracleResult oracle_call_wait(OracleCall *c) {
+  if (c->pending) c->result = oracle_finish_text(c->oracle, c->pending);
+  if (c->threaded) {
+    pthread_join(c->thread, NULL);
+    alloc_merge(c->alloc);
+  }
+  OracleResult r = c->result;
+  if (!c->pending) pthread_mutex_destroy(&c->lock);
+  free(c->prompt);
+  free(c);
+  return r;
+}
+
+int oracle_call_done(OracleCall *c) {
+  if (c->pending) return oracle_ready_text(c->oracle, c->pending);
+  pthread_mutex_lock(&c->lock);
+  int done = c->done;
+  pthread_mutex_unlock(&c->lock);
+  return done;
+}
@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <errno.h>
+#include <pthread.h>
 #include <sys/stat.h>
 
 #include "liminal/sha256.h"
@@ -15,6 +16,58 @@ static Oracle *oracle_new(void) {
   return o;
 }
 
+struct OracleGate {
+  int max;
+  int in_flight;
+  pthread_mutex_t lock;  // guards in_flight
+  pthread_cond_t freed;  // a call finished
+};
+
+static void gate_enter(struct OracleGate *g) {
+  if (!g) return;
+  pthread_mutex_lock(&g->lock);
+  while (g->in_flight >= g->max) pthread_cond_wait(&g->freed, &g->lock);
+  g->in_flight++;
+  pthread_mutex_unlock(&g->lock);
+}
+
+// gate_enter without the wait: 0 when all slots are taken
+static int gate_try_enter(struct OracleGate *g) {
+  if (!g) return 1;
+  pthread_mutex_lock(&g->lock);
+  int entered = g->in_flight < g->max;
+  if (entered) g->in_flight++;
+  pthread_mutex_unlock(&g->lock);
+  return entered;
+}
+
+static void gate_leave(struct OracleGate *g) {
+  if (!g) return;
+  pthread_mutex_lock(&g->lock);
+  g->in_flight--;
+  pthread_cond_signal(&g->freed);
+  pthread_mutex_unlock(&g->lock);
+}
+
+void oracle_set_max_concurrency(Oracle *o, int max) {
+  if (!o) return;
+  if (max <= 0) {
+    if (o->gate) {
+      pthread_mutex_destroy(&o->gate->lock);
+      pthread_cond_destroy(&o->gate->freed);
+      free(o->gate);
+      o->gate = NULL;
+    }
+    return;
+  }
+  if (!o->gate) {
+    o->gate = (struct OracleGate *)calloc(1, sizeof(struct OracleGate));
+    pthread_mutex_init(&o->gate->lock, NULL);
+    pthread_cond_init(&o->gate->freed, NULL);
+  }
+  o->gate->max = max;
+}
+
 OracleResult oracle_call_text(Oracle *o, const char *prompt) {
   if (!o || !o->call_text) {
     OracleResult r = {0};
@@ -22,7 +75,52 @@ OracleResult oracle_call_text(Oracle *o, const char *prompt) {
     r.error = strdup("oracle not available");
     return r;
   }
-  return o->call_text(o->impl, prompt);
+  gate_enter(o->gate);
+  OracleResult r = o->call_text(o->impl, prompt);
+  gate_leave(o->gate);
+  return r;
+}
+
+void *oracle_start_text(Oracle *o, const char *prompt) {
+  // A caller may hold several unfinished calls, so it must not wait here
+  // for a slot only its own finish would free
+  if (!o || !o->start_text || !gate_try_enter(o->gate)) return NULL;
+  void *call = o->start_text(o->impl, prompt);
+  if (!call) gate_leave(o->gate);
+  return call;
+}
+
+OracleResult oracle_finish_text(Oracle *o, void *call) {
+  OracleResult r = o->finish_text(o->impl, call);
+  gate_leave(o->gate);
+  return r;
+}
+
+int oracle_ready_text(Oracle *o, void *call) {
+  return !o->ready_text || o->ready_text(o->impl, call);
+}
+
+int oracle_saturated(Oracle *o) {
+  for (; o; o = o->inner) {
+    if (!o->gate) continue;
+    pthread_mutex_lock(&o->gate->lock);
+    int full = o->gate->in_flight >= o->gate->max;
+    pthread_mutex_unlock(&o->gate->lock);
+    if (full) return 1;
+  }
+  return 0;
+}
+
+OracleResult oracle_stream_text(Oracle *o, const char *prompt, OracleChunkFn on_chunk, void *user) {
+  if (o && o->stream_text) {
+    gate_enter(o->gate);
+    OracleResult r = o->stream_text(o->impl, prompt, on_chunk, user);
+    gate_leave(o->gate);
+    return r;
+  }
+  OracleResult r = oracle_call_text(o, prompt);
+  if (r.ok && r.text && *r.text) on_chunk(user, r.text, strlen(r.text));
+  return r;
 }
 
 void oracle_result_free(OracleResult r) {
@@ -34,9 +132,17 @@ void oracle_result_free(OracleResult r) {
 void oracle_free(Oracle *o) {
   if (!o) return;
   if (o->destroy) o->destroy(o->impl);
+  oracle_set_max_concurrency(o, 0);
   free(o);
 }
 
+void liminal_context_set_oracle(LiminalContext *ctx, Oracle *oracle, int owns) {
+  if (ctx->owns_oracle && ctx->oracle != oracle) oracle_free(ctx->oracle);
+  ctx->oracle = oracle;
+  ctx->owns_oracle = owns;
+  ctx->oracle_release = oracle_free;
+}
+
 // Utilities
 char *oracle_canonicalize_prompt(const char *prompt) {
   if (!prompt) return strdup("");
@@ -96,6 +202,10 @@ typedef struct {
   char model[128];
   char mode[16];
   char recording[256];
+  long connect_timeout_ms;
+  long timeout_ms;
+  long max_concurrency;  // -1: the provider's own cap
+  long record_flush_ms;  // -1: RECORD_WRITER_FLUSH_MS
 } OracleEnvConfig;
 
 static void load_ini(const char *path, OracleEnvConfig *cfg) {
@@ -115,6 +225,10 @@ static void load_ini(const char *path, OracleEnvConfig *cfg) {
     else if (strcmp(key, "model") == 0) strncpy(cfg->model, val, sizeof(cfg->model)-1);
     else if (strcmp(key, "mode") == 0) strncpy(cfg->mode, val, sizeof(cfg->mode)-1);
     else if (strcmp(key, "recording") == 0) strncpy(cfg->recording, val, sizeof(cfg->recording)-1);
+    else if (strcmp(key, "connect_timeout_ms") == 0) cfg->connect_timeout_ms = strtol(val, NULL, 10);
+    else if (strcmp(key, "timeout_ms") == 0) cfg->timeout_ms = strtol(val, NULL, 10);
+    else if (strcmp(key, "max_concurrency") == 0) cfg->max_concurrency = strtol(val, NULL, 10);
+    else if (strcmp(key, "record_flush_ms") == 0) cfg->record_flush_ms = strtol(val, NULL, 10);
   }
   fclose(f);
 }
@@ -127,11 +241,17 @@ int oracle_ollama_available(void);
 
 Oracle *oracle_from_env(void) {
   OracleEnvConfig cfg = {0};
+  cfg.max_concurrency = -1;
+  cfg.record_flush_ms = -1;
   strncpy(cfg.provider, getenv("LIMINAL_ORACLE_PROVIDER") ? getenv("LIMINAL_ORACLE_PROVIDER") : "mock", sizeof(cfg.provider)-1);
   strncpy(cfg.endpoint, getenv("LIMINAL_OLLAMA_ENDPOINT") ? getenv("LIMINAL_OLLAMA_ENDPOINT") : "http://localhost:11434", sizeof(cfg.endpoint)-1);
   strncpy(cfg.model, getenv("LIMINAL_OLLAMA_MODEL") ? getenv("LIMINAL_OLLAMA_MODEL") : "gemma3:12b", sizeof(cfg.model)-1);
   strncpy(cfg.mode, getenv("LIMINAL_ORACLE_MODE") ? getenv("LIMINAL_ORACLE_MODE") : "live", sizeof(cfg.mode)-1);
   strncpy(cfg.recording, getenv("LIMINAL_ORACLE_RECORDING") ? getenv("LIMINAL_ORACLE_RECORDING") : "oracle_recordings.jsonl", sizeof(cfg.recording)-1);
+  if (getenv("LIMINAL_OLLAMA_CONNECT_TIMEOUT_MS")) cfg.connect_timeout_ms = strtol(getenv("LIMINAL_OLLAMA_CONNECT_TIMEOUT_MS"), NULL, 10);
+  if (getenv("LIMINAL_OLLAMA_TIMEOUT_MS")) cfg.timeout_ms = strtol(getenv("LIMINAL_OLLAMA_TIMEOUT_MS"), NULL, 10);
+  if (getenv("LIMINAL_ORACLE_MAX_CONCURRENCY")) cfg.max_concurrency = strtol(getenv("LIMINAL_ORACLE_MAX_CONCURRENCY"), NULL, 10);
+  if (getenv("LIMINAL_ORACLE_RECORD_FLUSH_MS")) cfg.record_flush_ms = strtol(getenv("LIMINAL_ORACLE_RECORD_FLUSH_MS"), NULL, 10);
 
   if (file_exists("liminal.ini")) {
     load_ini("liminal.ini", &cfg);
@@ -142,12 +262,16 @@ Oracle *oracle_from_env(void) {
     base = oracle_create_mock();
   } else if (strcasecmp(cfg.provider, "ollama") == 0) {
     base = oracle_create_ollama(cfg.endpoint, cfg.model);
+    if (base) oracle_ollama_set_timeouts(base, cfg.connect_timeout_ms, cfg.timeout_ms);
   } else {
     base = oracle_create_mock();
   }
   if (!base) return NULL;
+  if (cfg.max_concurrency >= 0) oracle_set_max_concurrency(base, (int)cfg.max_concurrency);
   if (strcasecmp(cfg.mode, "live") == 0) return base;
-  return oracle_with_recording(base, cfg.mode, cfg.recording);
+  Oracle *o = oracle_with_recording(base, cfg.mode, cfg.recording);
+  if (cfg.record_flush_ms >= 0) oracle_recording_set_flush_ms(o, cfg.record_flush_ms);
+  return o;
 }
 
 // Factories used by providers
@@ -1,12 +1,14 @@
 #define _POSIX_C_SOURCE 200809L
 #include "liminal/parser.h"
+#include "liminal/context.h"
+#include "liminal/alloc.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 
-static void *xmalloc(size_t n) { void *p = malloc(n); if (!p) { fprintf(stderr,"OOM\n"); exit(1);} memset(p,0,n); return p; }
+static void *xmalloc(size_t n) { void *p = lm_malloc(n); if (!p) { fprintf(stderr,"OOM\n"); exit(1);} memset(p,0,n); return p; }
 
 struct Parser {
   Lexer *lx;
@@ -16,9 +18,10 @@ struct Parser {
   ParseErrorVec errors;
   const char *src;
   size_t len;
+  int debug; // LIMINAL_DEBUG_PARSER, sampled once at creation
 };
 
-static char *sdup(const char *s, size_t n) { char *p = malloc(n + 1); if (!p) { fprintf(stderr,"OOM\n"); exit(1);} memcpy(p, s, n); p[n] = '\0'; return p; }
+static char *sdup(const char *s, size_t n) { char *p = lm_malloc(n + 1); if (!p) { fprintf(stderr,"OOM\n"); exit(1);} memcpy(p, s, n); p[n] = '\0'; return p; }
 
 static Token peek_token(Parser *p) {
   if (!p->has_lookahead) {
@@ -45,7 +48,7 @@ static int token_is(Token t, TokenKind k) { return t.kind == k; }
 static void add_error(Parser *p, LiminalSpan span, const char *msg) {
   if (p->errors.len == p->errors.cap) {
     p->errors.cap = p->errors.cap ? p->errors.cap * 2 : 4;
-    p->errors.items = realloc(p->errors.items, p->errors.cap * sizeof(ParseError));
+    p->errors.items = lm_realloc(p->errors.items, p->errors.cap * sizeof(ParseError));
   }
   p->errors.items[p->errors.len].span = span;
   size_t n = strlen(msg);
@@ -110,15 +113,15 @@ static ASTExpr *make_concat(ASTExpr *lhs, ASTExpr *rhs) {
   return e;
 }
 
-static ASTExpr *parse_fstring_expr(const char *src, size_t len) {
-  Parser *p2 = parser_create(src, len);
+static ASTExpr *parse_fstring_expr(Parser *p, const char *src, size_t len) {
+  Parser *p2 = parser_create_ctx(NULL, src, len);
+  p2->debug = p->debug;
   ASTExpr *expr = parse_expression(p2, 0);
   parser_destroy(p2);
   return expr;
 }
 
 static ASTExpr *parse_fstring_token(Parser *p, Token t) {
-  (void)p;
   const char *lex = t.lexeme;
   size_t len = t.lexeme_len;
   if (len < 3) return ast_make_literal(t);
@@ -133,11 +136,11 @@ static ASTExpr *parse_fstring_token(Parser *p, Token t) {
       // trailing literal
       if (i > start) {
         size_t seglen = i - start;
-        char *buf = malloc(seglen + 3);
+        char *buf = lm_malloc(seglen + 3);
         buf[0] = '\''; memcpy(buf+1, lex+start, seglen); buf[seglen+1] = '\''; buf[seglen+2] = '\0';
         Token lit = t; lit.kind = TK_STRING; lit.lexeme = buf; lit.lexeme_len = (int)(seglen + 2);
         ASTExpr *litexpr = ast_make_literal(lit);
-        free(buf);
+        lm_free(buf);
         acc = acc ? make_concat(acc, litexpr) : litexpr;
       }
       break;
@@ -146,18 +149,18 @@ static ASTExpr *parse_fstring_token(Parser *p, Token t) {
       // literal before
       if (i > start) {
         size_t seglen = i - start;
-        char *buf = malloc(seglen + 3);
+        char *buf = lm_malloc(seglen + 3);
         buf[0] = '\''; memcpy(buf+1, lex+start, seglen); buf[seglen+1] = '\''; buf[seglen+2] = '\0';
         Token lit = t; lit.kind = TK_STRING; lit.lexeme = buf; lit.lexeme_len = (int)(seglen + 2);
         ASTExpr *litexpr = ast_make_literal(lit);
-        free(buf);
+        lm_free(buf);
         acc = acc ? make_concat(acc, litexpr) : litexpr;
       }
       i++;
       size_t expr_start = i;
       while (i < len && lex[i] != '}') i++;
       size_t expr_len = i - expr_start;
-      ASTExpr *expr = parse_fstring_expr(lex + expr_start, expr_len);
+      ASTExpr *expr = parse_fstring_expr(p, lex + expr_start, expr_len);
       acc = acc ? make_concat(acc, expr) : expr;
       i++; // skip '}'
       start = i;
@@ -570,6 +573,48 @@ static ASTStmt *parse_for(Parser *p, Token for_tok) {
   return s;
 }
 
+// stream Oracle <- prompt do |Chunk| statements end
+static ASTStmt *parse_stream(Parser *p) {
+  Token st = consume_token(p); // stream
+  Token oracle = expect(p, TK_IDENTIFIER, "Expected oracle after stream");
+  expect(p, TK_LT, "Expected <- after stream oracle");
+  expect(p, TK_MINUS, "Expected <- after stream oracle");
+  ASTExpr *prompt = parse_expression(p, 0);
+  expect(p, TK_KEYWORD, "Expected do");
+  expect(p, TK_PIPE, "Expected | before chunk variable");
+  Token chunk = expect(p, TK_IDENTIFIER, "Expected chunk variable");
+  expect(p, TK_PIPE, "Expected | after chunk variable");
+  ASTStmtVec stmts = {0};
+  while (!(peek_token(p).kind == TK_KEYWORD && strncasecmp(peek_token(p).lexeme, "end", peek_token(p).lexeme_len)==0)) {
+    if (peek_token(p).kind == TK_EOF) { add_error(p, peek_token(p).span, "Unexpected EOF in stream"); break; }
+    ast_stmt_vec_push(&stmts, parse_statement(p));
+    match(p, TK_SEMICOLON);
+  }
+  expect(p, TK_KEYWORD, "Expected end");
+  ASTStmt *s = make_stmt(STMT_STREAM, st.span);
+  s->as.stream_stmt.oracle.name.data = sdup(oracle.lexeme, oracle.lexeme_len);
+  s->as.stream_stmt.oracle.name.len = oracle.lexeme_len;
+  s->as.stream_stmt.prompt = prompt;
+  s->as.stream_stmt.chunk.name.data = sdup(chunk.lexeme, chunk.lexeme_len);
+  s->as.stream_stmt.chunk.name.len = chunk.lexeme_len;
+  s->as.stream_stmt.body = ast_make_block(&stmts, st.span);
+  return s;
+}
+
+static ASTStmt *parse_parallel(Parser *p) {
+  Token pt = consume_token(p); // parallel
+  ASTStmtVec stmts = {0};
+  while (!(peek_token(p).kind == TK_KEYWORD && strncasecmp(peek_token(p).lexeme, "end", peek_token(p).lexeme_len)==0)) {
+    if (peek_token(p).kind == TK_EOF) { add_error(p, peek_token(p).span, "Unexpected EOF in parallel"); break; }
+    ast_stmt_vec_push(&stmts, parse_statement(p));
+    match(p, TK_SEMICOLON);
+  }
+  expect(p, TK_KEYWORD, "Expected end");
+  ASTStmt *s = make_stmt(STMT_PARALLEL, pt.span);
+  s->as.parallel_stmt.body = stmts;
+  return s;
+}
+
 static ASTStmt *parse_assignment_or_expr(Parser *p) {
   ASTExpr *lhs = parse_expression(p, 0);
   if (match(p, TK_ASSIGN)) {
@@ -586,13 +631,15 @@ static ASTStmt *parse_assignment_or_expr(Parser *p) {
 
 static ASTStmt *parse_statement(Parser *p) {
   Token t = peek_token(p);
-  if (getenv("LIMINAL_DEBUG_PARSER")) fprintf(stderr, "[parser] stmt at %s\n", t.lexeme);
+  if (p->debug) fprintf(stderr, "[parser] stmt at %s\n", t.lexeme);
   if (t.kind == TK_KEYWORD) {
     if (strncasecmp(t.lexeme, "if", t.lexeme_len)==0) return parse_if(p);
     if (strncasecmp(t.lexeme, "while", t.lexeme_len)==0) return parse_while(p);
     if (strncasecmp(t.lexeme, "repeat", t.lexeme_len)==0) return parse_repeat(p);
     if (strncasecmp(t.lexeme, "for", t.lexeme_len)==0) return parse_for(p, t);
     if (strncasecmp(t.lexeme, "case", t.lexeme_len)==0) return parse_case(p);
+    if (strncasecmp(t.lexeme, "stream", t.lexeme_len)==0) return parse_stream(p);
+    if (strncasecmp(t.lexeme, "parallel", t.lexeme_len)==0) return parse_parallel(p);
     if (strncasecmp(t.lexeme, "break", t.lexeme_len)==0) { consume_token(p); return make_stmt(STMT_BREAK, t.span);} 
     if (strncasecmp(t.lexeme, "continue", t.lexeme_len)==0) { consume_token(p); return make_stmt(STMT_CONTINUE, t.span);} 
     if (strncasecmp(t.lexeme, "begin", t.lexeme_len)==0) {
@@ -745,7 +792,7 @@ static ASTType *parse_type(Parser *p) {
 
 static ASTNode *parse_function(Parser *p) {
   Token fn_tok = expect(p, TK_KEYWORD, "Expected function");
-  if (getenv("LIMINAL_DEBUG_PARSER")) fprintf(stderr, "[parser] function\n");
+  if (p->debug) fprintf(stderr, "[parser] function\n");
   Token fname = expect(p, TK_IDENTIFIER, "Expected function name");
   expect(p, TK_LPAREN, "Expected (");
   ASTParamVec params = {0};
@@ -754,7 +801,7 @@ static ASTNode *parse_function(Parser *p) {
       // Parse a param group: a, b: Type
       String *names=NULL; size_t nlen=0,ncap=0;
       Token first = expect(p, TK_IDENTIFIER, "Expected param name");
-      #define PUSH_PNAME(tok) do { if(nlen==ncap){ncap=ncap? ncap*2:4; names=realloc(names,ncap*sizeof(String));} names[nlen].data=sdup((tok).lexeme,(tok).lexeme_len); names[nlen].len=(tok).lexeme_len; nlen++; } while(0)
+      #define PUSH_PNAME(tok) do { if(nlen==ncap){ncap=ncap? ncap*2:4; names=lm_realloc(names,ncap*sizeof(String));} names[nlen].data=sdup((tok).lexeme,(tok).lexeme_len); names[nlen].len=(tok).lexeme_len; nlen++; } while(0)
       PUSH_PNAME(first);
       while (match(p, TK_COMMA)) { Token nt=expect(p, TK_IDENTIFIER, "Expected param name"); PUSH_PNAME(nt); }
       #undef PUSH_PNAME
@@ -764,7 +811,7 @@ static ASTNode *parse_function(Parser *p) {
         ASTParam param = { .name = names[i], .type = (i==0? ptype : ast_type_clone(ptype)) };
         ast_param_vec_push(&params, param);
       }
-      free(names);
+      lm_free(names);
       if (match(p, TK_SEMICOLON)) continue;
       break;
     }
@@ -781,7 +828,7 @@ static ASTNode *parse_function(Parser *p) {
       // Parse a var decl list: a, b: Type;
       String *names=NULL; size_t nlen=0,ncap=0;
       Token first = expect(p, TK_IDENTIFIER, "Expected var name");
-      #define PUSH_NAME(tok) do { if(nlen==ncap){ncap=ncap? ncap*2:4; names=realloc(names,ncap*sizeof(String));} names[nlen].data=sdup((tok).lexeme,(tok).lexeme_len); names[nlen].len=(tok).lexeme_len; nlen++; } while(0)
+      #define PUSH_NAME(tok) do { if(nlen==ncap){ncap=ncap? ncap*2:4; names=lm_realloc(names,ncap*sizeof(String));} names[nlen].data=sdup((tok).lexeme,(tok).lexeme_len); names[nlen].len=(tok).lexeme_len; nlen++; } while(0)
       PUSH_NAME(first);
       while (match(p, TK_COMMA)) { Token nt=expect(p,TK_IDENTIFIER,"Expected var name"); PUSH_NAME(nt); }
       #undef PUSH_NAME
@@ -794,7 +841,7 @@ static ASTNode *parse_function(Parser *p) {
         ASTVarDecl vd = { .name = names[i], .type = (i==0? vtype : ast_type_clone(vtype)), .init = (init&&i==0)? init : (init? ast_expr_clone(init): NULL)};
         ast_var_decl_vec_push(&locals, vd);
       }
-      free(names);
+      lm_free(names);
     }
     expect(p, TK_KEYWORD, "Expected begin");
   } else {
@@ -844,7 +891,7 @@ static void parse_var_decl_into(Parser *p, ASTNodeVec *out) {
   String *names = NULL; size_t nlen = 0, ncap = 0;
   Token first = expect(p, TK_IDENTIFIER, "Expected var name");
   #define PUSH_NAME(tok) do { \
-    if (nlen == ncap) { ncap = ncap ? ncap * 2 : 4; names = realloc(names, ncap * sizeof(String)); } \
+    if (nlen == ncap) { ncap = ncap ? ncap * 2 : 4; names = lm_realloc(names, ncap * sizeof(String)); } \
     names[nlen].data = sdup((tok).lexeme, (tok).lexeme_len); \
     names[nlen].len = (tok).lexeme_len; \
     nlen++; \
@@ -869,7 +916,7 @@ static void parse_var_decl_into(Parser *p, ASTNodeVec *out) {
     n->as.var_decl.init = (init && i == 0) ? init : (init ? ast_expr_clone(init) : NULL);
     ast_node_vec_push(out, n);
   }
-  free(names);
+  lm_free(names);
 }
 
 static ASTType *parse_schema_type(Parser *p) {
@@ -939,7 +986,7 @@ static ASTNode *parse_oracle_decl(Parser *p) {
 }
 
 static void parse_top_level(Parser *p, ASTNode *prog) {
-  const char *dbg = getenv("LIMINAL_DEBUG_PARSER"); size_t iter=0;
+  int dbg = p->debug; size_t iter=0;
   for (;;) {
     if (++iter > 100000) { fprintf(stderr, "[parser] top_level iter limit\n"); break; }
     Token t = peek_token(p);
@@ -1019,7 +1066,7 @@ static void parse_top_level(Parser *p, ASTNode *prog) {
 
 static ASTNode *parse_program_internal(Parser *p) {
   Token prog = expect(p, TK_KEYWORD, "Expected program");
-  if (getenv("LIMINAL_DEBUG_PARSER")) fprintf(stderr, "[parser] program %.*s\n", (int)prog.lexeme_len, prog.lexeme);
+  if (p->debug) fprintf(stderr, "[parser] program %.*s\n", (int)prog.lexeme_len, prog.lexeme);
   Token name = expect(p, TK_IDENTIFIER, "Expected program name");
   expect(p, TK_SEMICOLON, "Expected ; after program name");
   ASTNode *node = ast_program_new((String){ .data = sdup(name.lexeme, name.lexeme_len), .len = name.lexeme_len });
@@ -1029,7 +1076,15 @@ static ASTNode *parse_program_internal(Parser *p) {
 }
 
 Parser *parser_create(const char *src, size_t len) {
+  const char *dbg = getenv("LIMINAL_DEBUG_PARSER");
+  Parser *p = parser_create_ctx(NULL, src, len);
+  p->debug = dbg && *dbg;
+  return p;
+}
+
+Parser *parser_create_ctx(const LiminalContext *ctx, const char *src, size_t len) {
   Parser *p = xmalloc(sizeof(Parser));
+  p->debug = ctx ? ctx->debug_parser : 0;
   p->lx = lexer_create(src, len);
   p->current.kind = TK_ERROR;
   p->has_lookahead = 0;
@@ -1040,10 +1095,10 @@ Parser *parser_create(const char *src, size_t len) {
 }
 
 void parser_destroy(Parser *p) {
-  for (size_t i = 0; i < p->errors.len; ++i) free(p->errors.items[i].message);
-  free(p->errors.items);
+  for (size_t i = 0; i < p->errors.len; ++i) lm_free(p->errors.items[i].message);
+  lm_free(p->errors.items);
   lexer_destroy(p->lx);
-  free(p);
+  lm_free(p);
 }
 
 ASTNode *parse_program(Parser *p) { return parse_program_internal(p); }
@@ -0,0 +1,85 @@
+#include "liminal/peephole.h"
+#include "liminal/alloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int is_arith(IrOp op){ return op==IR_ADD || op==IR_SUB || op==IR_MUL || op==IR_DIV || op==IR_MOD; }
+static int is_compare(IrOp op){ return op==IR_EQ || op==IR_NEQ || op==IR_LT || op==IR_GT || op==IR_LE || op==IR_GE; }
+
+// Temps an instruction writes or reads
+static int temp_mentions(const IrInstr *ins, int out[3]){
+  IrInstr copy = *ins;
+  int *refs[3];
+  int n = ir_instr_temp_refs(&copy, refs), k = 0;
+  for (int i=0;i<n;++i) if (*refs[i]>=0) out[k++]=*refs[i];
+  return k;
+}
+
+// mentions[t]: how many times temp t appears in the function
+static int *count_mentions(const IrFunc *f){
+  int maxt = f->next_temp, m[3];
+  for (size_t i=0;i<f->instrs.len;++i) { int k=temp_mentions(&f->instrs.items[i], m); for (int j=0;j<k;++j) if (m[j]>=maxt) maxt=m[j]+1; }
+  int *mentions = lm_calloc((size_t)(maxt ? maxt : 1), sizeof(int));
+  for (size_t i=0;i<f->instrs.len;++i) { int k=temp_mentions(&f->instrs.items[i], m); for (int j=0;j<k;++j) mentions[m[j]]++; }
+  return mentions;
+}
+
+// Matches a superinstruction at ins[0..avail); returns instructions consumed
+// (0: no match) and fills *out
+static size_t match(const IrInstr *ins, size_t avail, const int *mentions, IrInstr *out){
+  // CONST_INT k; t = <op> a, k; ... (k private: defined and used once)
+  if (avail>=2 && ins[0].op==IR_CONST_INT && ins[0].dest>=0 && mentions[ins[0].dest]==2 &&
+      (is_arith(ins[1].op) || is_compare(ins[1].op)) && ins[1].arg2==ins[0].dest && ins[1].arg1!=ins[0].dest) {
+    int k = ins[0].arg1;
+    if (ins[1].op==IR_ADD && avail>=3 && ins[2].op==IR_STORE_VAR && ins[2].arg1==ins[1].dest) {
+      *out = (IrInstr){.op=IR_INC_VAR, .dest=ins[1].dest, .arg1=ins[1].arg1, .arg2=k, .s=ins[2].s};
+      return 3;
+    }
+    if (is_compare(ins[1].op) && avail>=3 && ins[2].op==IR_JUMP_IF_FALSE && ins[1].dest>=0 && ins[2].arg1==ins[1].dest && mentions[ins[1].dest]==2) {
+      *out = (IrInstr){.op=IR_CMP_CONST_BRANCH, .dest=-1, .arg1=ins[1].arg1, .arg2=k, .s=ins[2].s, .fused=ins[1].op};
+      return 3;
+    }
+    if (is_arith(ins[1].op)) {
+      *out = (IrInstr){.op=IR_ARITH_CONST, .dest=ins[1].dest, .arg1=ins[1].arg1, .arg2=k, .fused=ins[1].op};
+      return 2;
+    }
+  }
+  // c = <cmp> a, b; JUMP_IF_FALSE c (c private)
+  if (avail>=2 && is_compare(ins[0].op) && ins[1].op==IR_JUMP_IF_FALSE && ins[1].arg1==ins[0].dest && ins[0].dest>=0 && mentions[ins[0].dest]==2) {
+    *out = (IrInstr){.op=IR_CMP_BRANCH, .dest=-1, .arg1=ins[0].arg1, .arg2=ins[0].arg2, .s=ins[1].s, .fused=ins[0].op};
+    return 2;
+  }
+  // t = ADD a, b; STORE_VAR x, t
+  if (avail>=2 && ins[0].op==IR_ADD && ins[1].op==IR_STORE_VAR && ins[1].arg1==ins[0].dest) {
+    *out = (IrInstr){.op=IR_ADD_STORE, .dest=ins[0].dest, .arg1=ins[0].arg1, .arg2=ins[0].arg2, .s=ins[1].s};
+    return 2;
+  }
+  return 0;
+}
+
+size_t ir_fuse_superinstructions(IrProgram *prog){
+  size_t formed = 0;
+  for (size_t fi=0; fi<prog->funcs.len; ++fi) {
+    IrFunc *f = &prog->funcs.items[fi];
+    int *mentions = count_mentions(f);
+    // Fused groups hold no labels and carry over every string they keep
+    // (store names, branch labels), so rewriting in place is safe for
+    // programs whose strings borrow from a mapped image. A fused
+    // instruction keeps the source span of the first one it replaces.
+    LiminalSpan *spans = f->lines.len ? ir_func_spans(f) : NULL;
+    size_t w = 0;
+    for (size_t i=0; i<f->instrs.len; ) {
+      IrInstr fused;
+      size_t used = match(&f->instrs.items[i], f->instrs.len - i, mentions, &fused);
+      if (spans) spans[w] = spans[i];
+      if (used) { f->instrs.items[w++] = fused; i += used; formed++; }
+      else f->instrs.items[w++] = f->instrs.items[i++];
+    }
+    if (spans) ir_func_set_spans(f, spans, w);
+    f->instrs.len = w;
+    lm_free(spans);
+    lm_free(mentions);
+  }
+  return formed;
+}
@@ -0,0 +1,739 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/pgo.h"
+#include "liminal/alloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PGO_BYTE_ORDER_MARK 0x01020304u
+// A call site is inlined once it has run this often, into at most
+// PGO_INLINE_MAX_SITES sites per caller, from callees of at most
+// PGO_INLINE_MAX_INSTRS instructions
+#define PGO_HOT_CALLS 64
+#define PGO_INLINE_MAX_SITES 8
+#define PGO_INLINE_MAX_INSTRS 48
+// An else block is cold when it runs at most once per PGO_COLD_RATIO
+// executions of its if
+#define PGO_COLD_RATIO 16
+
+static int is_branch(IrOp op){ return op==IR_JUMP_IF_FALSE || op==IR_CMP_BRANCH || op==IR_CMP_CONST_BRANCH; }
+
+// ---- Checksum ----
+
+static uint64_t fnv(uint64_t h, const void *data, size_t n){
+  const unsigned char *p = data;
+  for (size_t i=0;i<n;++i) { h ^= p[i]; h *= 1099511628211ull; }
+  return h;
+}
+static uint64_t fnv_str(uint64_t h, const char *s){ return s ? fnv(h, s, strlen(s) + 1) : fnv(h, "\xff", 1); }
+
+uint64_t pgo_checksum(const IrProgram *prog){
+  uint64_t h = 14695981039346656037ull;
+  for (size_t i=0;i<prog->funcs.len;++i) {
+    const IrFunc *f = &prog->funcs.items[i];
+    h = fnv_str(h, f->name);
+    for (int j=0;j<f->param_count;++j) h = fnv_str(h, f->params[j]);
+    for (size_t j=0;j<f->instrs.len;++j) {
+      const IrInstr *ins = &f->instrs.items[j];
+      int32_t w[4] = {(int32_t)ins->op, ins->dest, ins->arg1, ins->arg2};
+      h = fnv(h, w, sizeof(w));
+      h = fnv(h, &ins->f, sizeof(ins->f));
+      h = fnv_str(fnv_str(h, ins->s), ins->s2);
+    }
+  }
+  return h;
+}
+
+// ---- Recording ----
+
+PgoProfile *pgo_profile_new(const IrProgram *prog, uint64_t checksum){
+  PgoProfile *p = lm_calloc(1, sizeof(PgoProfile));
+  p->checksum = checksum;
+  p->prog = prog;
+  p->func_count = prog->funcs.len;
+  p->funcs = lm_calloc(p->func_count ? p->func_count : 1, sizeof(PgoFunc));
+  for (size_t i=0;i<prog->funcs.len;++i) {
+    const IrFunc *f = &prog->funcs.items[i];
+    PgoFunc *pf = &p->funcs[i];
+    pf->name = lm_strdup(f->name ? f->name : "");
+    pf->ordinal = lm_malloc(sizeof(int) * (f->instrs.len ? f->instrs.len : 1));
+    for (size_t j=0;j<f->instrs.len;++j) {
+      IrOp op = f->instrs.items[j].op;
+      pf->ordinal[j] = is_branch(op) ? (int)pf->branch_count++ : op==IR_CALL ? (int)pf->site_count++ : -1;
+    }
+    pf->branches = lm_calloc(pf->branch_count ? pf->branch_count : 1, sizeof(PgoBranch));
+    pf->sites = lm_calloc(pf->site_count ? pf->site_count : 1, sizeof(PgoSite));
+    for (size_t j=0;j<f->instrs.len;++j)
+      if (f->instrs.items[j].op==IR_CALL) pf->sites[pf->ordinal[j]].target = lm_strdup(f->instrs.items[j].s ? f->instrs.items[j].s : "");
+  }
+  return p;
+}
+
+void pgo_profile_free(PgoProfile *profile){
+  if (!profile) return;
+  for (size_t i=0;i<profile->func_count;++i) {
+    PgoFunc *pf = &profile->funcs[i];
+    lm_free(pf->name);
+    lm_free(pf->branches);
+    for (size_t j=0;j<pf->site_count;++j) lm_free(pf->sites[j].target);
+    lm_free(pf->sites);
+    lm_free(pf->ordinal);
+  }
+  lm_free(profile->funcs);
+  lm_free(profile);
+}
+
+static PgoFunc *recorded_func(PgoProfile *p, const IrFunc *f){
+  const IrFunc *base = p->prog ? p->prog->funcs.items : NULL;
+  if (!base || f < base || f >= base + p->func_count) return NULL;
+  return &p->funcs[f - base];
+}
+
+void pgo_enter(PgoProfile *profile, const IrFunc *f){
+  PgoFunc *pf = recorded_func(profile, f);
+  if (pf) pf->calls++;
+}
+
+void pgo_count(PgoProfile *profile, const IrFunc *f, size_t ip, long next){
+  PgoFunc *pf = recorded_func(profile, f);
+  if (!pf || pf->ordinal[ip] < 0) return;
+  if (f->instrs.items[ip].op==IR_CALL) pf->sites[pf->ordinal[ip]].count++;
+  else if (next == (long)ip + 1) pf->branches[pf->ordinal[ip]].not_taken++;
+  else pf->branches[pf->ordinal[ip]].taken++;
+}
+
+static int same_shape(const PgoFunc *a, const PgoFunc *b){
+  if (strcmp(a->name, b->name)!=0 || a->branch_count!=b->branch_count || a->site_count!=b->site_count) return 0;
+  for (size_t j=0;j<a->site_count;++j) if (strcmp(a->sites[j].target, b->sites[j].target)!=0) return 0;
+  return 1;
+}
+
+int pgo_profile_merge(PgoProfile *profile, const PgoProfile *from){
+  if (profile->checksum!=from->checksum || profile->func_count!=from->func_count) return 0;
+  for (size_t i=0;i<profile->func_count;++i) if (!same_shape(&profile->funcs[i], &from->funcs[i])) return 0;
+  for (size_t i=0;i<profile->func_count;++i) {
+    PgoFunc *pf = &profile->funcs[i];
+    const PgoFunc *ff = &from->funcs[i];
+    pf->calls += ff->calls;
+    for (size_t j=0;j<pf->branch_count;++j) { pf->branches[j].taken += ff->branches[j].taken; pf->branches[j].not_taken += ff->branches[j].not_taken; }
+    for (size_t j=0;j<pf->site_count;++j) pf->sites[j].count += ff->sites[j].count;
+  }
+  return 1;
+}
+
+// ---- File format ----
+// magic[8] version:u32 byte_order:u32 checksum:u64 func_count:u32, then per
+// function: name calls:u64 branch_count:u32 {taken:u64 not_taken:u64}*
+// site_count:u32 {target count:u64}*. Strings are u32 length + bytes.
+
+static void put(FILE *f, const void *p, size_t n, int *ok){ if (*ok && fwrite(p, 1, n, f)!=n) *ok = 0; }
+static void put_u32(FILE *f, uint32_t v, int *ok){ put(f, &v, 4, ok); }
+static void put_u64(FILE *f, uint64_t v, int *ok){ put(f, &v, 8, ok); }
+static void put_str(FILE *f, const char *s, int *ok){ uint32_t n = (uint32_t)strlen(s); put_u32(f, n, ok); put(f, s, n, ok); }
+
+int pgo_profile_save(const PgoProfile *profile, const char *path, char **errmsg){
+  size_t tn = strlen(path) + 8;
+  char *tmp = lm_malloc(tn);
+  snprintf(tmp, tn, "%s.XXXXXX", path);
+  int fd = mkstemp(tmp);
+  if (fd < 0) { if (errmsg) *errmsg = lm_strdup("cannot create file"); lm_free(tmp); return 0; }
+  FILE *f = fdopen(fd, "wb");
+  int ok = f != NULL;
+  if (f) {
+    char magic[8] = {0};
+    memcpy(magic, PGO_MAGIC, sizeof(PGO_MAGIC));
+    put(f, magic, sizeof(magic), &ok);
+    put_u32(f, PGO_FORMAT_VERSION, &ok);
+    put_u32(f, PGO_BYTE_ORDER_MARK, &ok);
+    put_u64(f, profile->checksum, &ok);
+    put_u32(f, (uint32_t)profile->func_count, &ok);
+    for (size_t i=0;i<profile->func_count;++i) {
+      const PgoFunc *pf = &profile->funcs[i];
+      put_str(f, pf->name, &ok);
+      put_u64(f, pf->calls, &ok);
+      put_u32(f, (uint32_t)pf->branch_count, &ok);
+      for (size_t j=0;j<pf->branch_count;++j) { put_u64(f, pf->branches[j].taken, &ok); put_u64(f, pf->branches[j].not_taken, &ok); }
+      put_u32(f, (uint32_t)pf->site_count, &ok);
+      for (size_t j=0;j<pf->site_count;++j) { put_str(f, pf->sites[j].target, &ok); put_u64(f, pf->sites[j].count, &ok); }
+    }
+    ok = (fclose(f)==0) && ok;
+  } else close(fd);
+  if (ok) ok = rename(tmp, path)==0;
+  if (!ok) { unlink(tmp); if (errmsg) *errmsg = lm_strdup("write failed"); }
+  lm_free(tmp);
+  return ok;
+}
+
+typedef struct {
+  const unsigned char *data;
+  size_t len;
+  size_t pos;
+  const char *err;
+} Reader;
+
+static int need(Reader *r, size_t n){
+  if (r->err) return 0;
+  if (r->len - r->pos < n) { r->err = "truncated profile"; return 0; }
+  return 1;
+}
+static uint32_t get_u32(Reader *r){ uint32_t v = 0; if (need(r, 4)) { memcpy(&v, r->data + r->pos, 4); r->pos += 4; } return v; }
+static uint64_t get_u64(Reader *r){ uint64_t v = 0; if (need(r, 8)) { memcpy(&v, r->data + r->pos, 8); r->pos += 8; } return v; }
+static char *get_str(Reader *r){
+  uint32_t n = get_u32(r);
+  if (!need(r, n)) return NULL;
+  char *s = lm_malloc((size_t)n + 1);
+  memcpy(s, r->data + r->pos, n);
+  s[n] = '\0';
+  r->pos += n;
+  return s;
+}
+// Counts are bounded by what the remaining bytes could hold
+static size_t get_count(Reader *r, size_t item_size){
+  uint32_t n = get_u32(r);
+  if (!r->err && n > (r->len - r->pos) / item_size) r->err = "bad count";
+  return r->err ? 0 : n;
+}
+
+static void read_func(Reader *r, PgoFunc *pf){
+  pf->name = get_str(r);
+  pf->calls = get_u64(r);
+  pf->branch_count = get_count(r, 16);
+  pf->branches = lm_calloc(pf->branch_count ? pf->branch_count : 1, sizeof(PgoBranch));
+  for (size_t j=0;j<pf->branch_count;++j) { pf->branches[j].taken = get_u64(r); pf->branches[j].not_taken = get_u64(r); }
+  size_t sites = get_count(r, 12);
+  pf->sites = lm_calloc(sites ? sites : 1, sizeof(PgoSite));
+  for (size_t j=0;j<sites && !r->err;++j) {
+    pf->sites[j].target = get_str(r);
+    pf->sites[j].count = get_u64(r);
+    pf->site_count = j + 1;
+  }
+  if (!pf->name && !r->err) r->err = "truncated profile";
+}
+
+PgoProfile *pgo_profile_load(const char *path, char **errmsg){
+  FILE *f = fopen(path, "rb");
+  if (!f) { if (errmsg) *errmsg = lm_strdup("cannot open profile"); return NULL; }
+  unsigned char *data = NULL; size_t len = 0, cap = 0, n;
+  do {
+    if (len == cap) { cap = cap ? cap * 2 : 4096; data = lm_realloc(data, cap); }
+    n = fread(data + len, 1, cap - len, f);
+    len += n;
+  } while (n > 0);
+  fclose(f);
+
+  Reader r = {data, len, 0, NULL};
+  PgoProfile *p = lm_calloc(1, sizeof(PgoProfile));
+  char magic[8] = {0};
+  memcpy(magic, PGO_MAGIC, sizeof(PGO_MAGIC));
+  if (!need(&r, sizeof(magic)) || memcmp(data, magic, sizeof(magic))!=0) r.err = "not a profile";
+  else {
+    r.pos = sizeof(magic);
+    if (get_u32(&r)!=PGO_FORMAT_VERSION && !r.err) r.err = "format version mismatch";
+    if (get_u32(&r)!=PGO_BYTE_ORDER_MARK && !r.err) r.err = "byte order mismatch";
+    p->checksum = get_u64(&r);
+    size_t count = get_count(&r, 20);
+    p->funcs = lm_calloc(count ? count : 1, sizeof(PgoFunc));
+    for (size_t i=0;i<count && !r.err;++i) { p->func_count = i + 1; read_func(&r, &p->funcs[i]); }
+  }
+  lm_free(data);
+  if (r.err) {
+    if (errmsg) *errmsg = lm_strdup(r.err);
+    pgo_profile_free(p);
+    return NULL;
+  }
+  return p;
+}
+
+// ---- Optimization ----
+
+// Instructions with the profile counts of the branch or call each one is
+// (for a call, taken is the number of times it ran) and their source span;
+// passes move both along
+typedef struct {
+  uint64_t taken;
+  uint64_t not_taken;
+  LiminalSpan span; // zero for instructions a pass adds
+} Count;
+
+typedef struct {
+  IrInstr *items;
+  Count *cnt;
+  size_t len;
+  size_t cap;
+} Seq;
+
+static void seq_push(Seq *s, IrInstr ins, Count c){
+  if (s->len == s->cap) {
+    s->cap = s->cap ? s->cap * 2 : 16;
+    s->items = lm_realloc(s->items, s->cap * sizeof(IrInstr));
+    s->cnt = lm_realloc(s->cnt, s->cap * sizeof(Count));
+  }
+  s->items[s->len] = ins;
+  s->cnt[s->len] = c;
+  s->len++;
+}
+
+static void seq_append(Seq *dst, const Seq *src, size_t from, size_t to){
+  for (size_t i=from;i<to;++i) seq_push(dst, src->items[i], src->cnt[i]);
+}
+
+static void seq_replace(Seq *s, Seq *with){ lm_free(s->items); lm_free(s->cnt); *s = *with; }
+
+static const PgoFunc *profile_func(const PgoProfile *profile, const IrFunc *f){
+  for (size_t i=0;i<profile->func_count;++i) {
+    const PgoFunc *pf = &profile->funcs[i];
+    if (strcmp(pf->name, f->name ? f->name : "")!=0) continue;
+    size_t branches = 0, sites = 0;
+    for (size_t j=0;j<f->instrs.len;++j) {
+      const IrInstr *ins = &f->instrs.items[j];
+      if (is_branch(ins->op)) branches++;
+      else if (ins->op==IR_CALL && (sites >= pf->site_count || strcmp(pf->sites[sites++].target, ins->s ? ins->s : "")!=0)) return NULL;
+    }
+    return branches==pf->branch_count && sites==pf->site_count ? pf : NULL;
+  }
+  return NULL;
+}
+
+// Moves f's instructions into a Seq annotated from pf (NULL: no counts)
+static Seq seq_take(IrFunc *f, const PgoFunc *pf){
+  Seq s = {0};
+  size_t branches = 0, sites = 0;
+  LiminalSpan *spans = ir_func_spans(f);
+  for (size_t i=0;i<f->instrs.len;++i) {
+    const IrInstr *ins = &f->instrs.items[i];
+    Count c = {0, 0, spans[i]};
+    if (is_branch(ins->op) && pf) { c.taken = pf->branches[branches].taken; c.not_taken = pf->branches[branches].not_taken; }
+    if (ins->op==IR_CALL && pf) c.taken = pf->sites[sites].count;
+    branches += is_branch(ins->op);
+    sites += ins->op==IR_CALL;
+    seq_push(&s, *ins, c);
+  }
+  lm_free(spans);
+  lm_free(f->instrs.items);
+  f->instrs = (IrInstrVec){0};
+  return s;
+}
+
+// Added instructions take the span of the one before them
+static void seq_give(IrFunc *f, Seq *s){
+  LiminalSpan *spans = lm_malloc((s->len ? s->len : 1) * sizeof(LiminalSpan));
+  for (size_t i=0;i<s->len;++i) spans[i] = s->cnt[i].span.line==0 && i ? spans[i-1] : s->cnt[i].span;
+  ir_func_set_spans(f, spans, s->len);
+  lm_free(spans);
+  f->instrs.items = s->items;
+  f->instrs.len = s->len;
+  f->instrs.cap = s->cap;
+  lm_free(s->cnt);
+  *s = (Seq){0};
+}
+
+static int jumps_to(const IrInstr *ins, const char *label){
+  return (ins->op==IR_JUMP || is_branch(ins->op)) && ins->s && strcmp(ins->s, label)==0;
+}
+
+static long find_label(const Seq *s, const char *label){
+  for (size_t i=0;i<s->len;++i) if (s->items[i].op==IR_LABEL && strcmp(s->items[i].s, label)==0) return (long)i;
+  return -1;
+}
+
+static int label_refs(const Seq *s, const char *label){
+  int n = 0;
+  for (size_t i=0;i<s->len;++i) n += jumps_to(&s->items[i], label);
+  return n;
+}
+
+// A label name unused in s, numbered like the lowering's
+static char *new_label(IrFunc *f, const Seq *s){
+  char buf[32];
+  do snprintf(buf, sizeof(buf), "%d", f->next_label++);
+  while (find_label(s, buf) >= 0 || label_refs(s, buf) > 0);
+  return lm_strdup(buf);
+}
+
+// -- case arm reordering --
+
+// Names the main function sets from an Integer literal before any control
+// flow and that nothing else ever writes: enum members. A case pattern that
+// loads one is as good as the literal.
+typedef struct {
+  const char *name;
+  int value;
+} Constant;
+
+typedef struct {
+  Constant *items;
+  size_t len;
+} Constants;
+
+static int writes_name(const IrInstr *ins, const char *name){
+  if (ins->op!=IR_STORE_VAR && ins->op!=IR_READLN && ins->op!=IR_INC_VAR && ins->op!=IR_ADD_STORE) return 0;
+  // Storing a field creates its record's base variable in that frame
+  size_t n = strlen(name);
+  return ins->s && strncmp(ins->s, name, n)==0 && (ins->s[n]=='\0' || ins->s[n]=='.');
+}
+
+static size_t count_writes(const IrProgram *prog, const char *name){
+  size_t n = 0;
+  for (size_t fi=0;fi<prog->funcs.len;++fi) {
+    const IrFunc *f = &prog->funcs.items[fi];
+    for (int j=0;j<f->param_count;++j) n += strcmp(f->params[j], name)==0;
+    for (size_t i=0;i<f->instrs.len;++i) n += writes_name(&f->instrs.items[i], name);
+  }
+  return n;
+}
+
+static Constants find_constants(const IrProgram *prog){
+  Constants c = {0};
+  if (!prog->funcs.len) return c;
+  const IrFunc *m = &prog->funcs.items[0];
+  c.items = lm_malloc(sizeof(Constant) * (m->instrs.len ? m->instrs.len : 1));
+  for (size_t i=0;i<m->instrs.len;++i) {
+    const IrInstr *ins = &m->instrs.items[i];
+    if (ins->op==IR_LABEL || ins->op==IR_JUMP || is_branch(ins->op) || ins->op==IR_RET || ins->op==IR_CALL) break;
+    if (ins->op!=IR_STORE_VAR || i==0 || strchr(ins->s, '.')) continue;
+    const IrInstr *def = &m->instrs.items[i-1];
+    if (def->op!=IR_CONST_INT || def->dest!=ins->arg1 || count_writes(prog, ins->s)!=1) continue;
+    c.items[c.len++] = (Constant){ins->s, def->arg1};
+  }
+  return c;
+}
+
+static int constant_value(const Constants *c, const char *name, int *value){
+  for (size_t i=0;i<c->len;++i) if (strcmp(c->items[i].name, name)==0) { *value = c->items[i].value; return 1; }
+  return 0;
+}
+
+typedef struct {
+  size_t start, end; // [start, end) ends with the label of the next arm
+  int key;
+  uint64_t hits;
+} Arm;
+
+// p = <constant>; c = EQ e, p; JUMP_IF_FALSE c, next; BODY; JUMP end; next:
+// with the same e and end as the arms before it
+static int match_arm(const Seq *s, size_t i, const Constants *consts, int *e, const char **end, Arm *arm){
+  if (i + 3 > s->len) return 0;
+  const IrInstr *p = &s->items[i], *c = &s->items[i+1], *j = &s->items[i+2];
+  int key;
+  if (p->op==IR_CONST_INT) key = p->arg1;
+  else if (!(p->op==IR_LOAD_VAR && constant_value(consts, p->s, &key))) return 0;
+  if (c->op!=IR_EQ || c->arg2!=p->dest || c->arg1==p->dest || (*e>=0 && c->arg1!=*e)) return 0;
+  if (j->op!=IR_JUMP_IF_FALSE || j->arg1!=c->dest || label_refs(s, j->s)!=1) return 0;
+  long next = find_label(s, j->s);
+  if (next <= (long)i + 3) return 0;
+  const IrInstr *jump = &s->items[next-1];
+  if (jump->op!=IR_JUMP || (*end && strcmp(jump->s, *end)!=0)) return 0;
+  *e = c->arg1;
+  *end = jump->s;
+  *arm = (Arm){i, (size_t)next + 1, key, s->cnt[i+2].not_taken};
+  return 1;
+}
+
+// At most one arm over distinct constants can match, so the order they are
+// tried in is free; the most frequent go first
+static void reorder_cases(Seq *s, const Constants *consts, PgoStats *stats){
+  Arm *arms = lm_malloc(sizeof(Arm) * (s->len ? s->len : 1));
+  for (size_t i=0;i<s->len;++i) {
+    size_t n = 0, at = i;
+    int e = -1;
+    const char *end = NULL;
+    while (match_arm(s, at, consts, &e, &end, &arms[n])) at = arms[n++].end;
+    if (n < 2) continue;
+    int distinct = 1, sorted = 1;
+    for (size_t a=0;a<n;++a) for (size_t b=a+1;b<n;++b) distinct &= arms[a].key!=arms[b].key;
+    for (size_t a=1;a<n;++a) sorted &= arms[a-1].hits >= arms[a].hits;
+    if (!distinct || sorted) continue;
+    for (size_t a=1;a<n;++a) {
+      Arm x = arms[a];
+      size_t b = a;
+      for (; b>0 && arms[b-1].hits < x.hits; --b) arms[b] = arms[b-1];
+      arms[b] = x;
+    }
+    Seq moved = {0};
+    for (size_t a=0;a<n;++a) seq_append(&moved, s, arms[a].start, arms[a].end);
+    memcpy(s->items + i, moved.items, moved.len * sizeof(IrInstr));
+    memcpy(s->cnt + i, moved.cnt, moved.len * sizeof(Count));
+    lm_free(moved.items); lm_free(moved.cnt);
+    stats->cases_reordered++;
+  }
+  lm_free(arms);
+}
+
+// -- hot/cold layout --
+
+static int cold(Count c){ return c.taken + c.not_taken > 0 && c.taken * PGO_COLD_RATIO <= c.taken + c.not_taken; }
+
+// JUMP_IF_FALSE c, else; THEN; JUMP end; else: ELSE; end:  with a cold
+// ELSE becomes  JUMP_IF_FALSE c, else; THEN; end: ... JUMP exit;
+// else: ELSE; JUMP end; exit:  -- the hot path no longer jumps
+static void move_cold_blocks(IrFunc *f, Seq *s, PgoStats *stats){
+  // cold_end[else label] = its end label, for the blocks being moved
+  size_t *cold_end = lm_calloc(s->len ? s->len : 1, sizeof(size_t));
+  size_t moved = 0;
+  for (size_t i=0;i<s->len;++i) {
+    if (cold_end[i]) { i = cold_end[i] - 1; continue; }
+    const IrInstr *ins = &s->items[i];
+    if (ins->op!=IR_JUMP_IF_FALSE || !cold(s->cnt[i]) || label_refs(s, ins->s)!=1) continue;
+    long el = find_label(s, ins->s);
+    if (el <= (long)i + 1 || s->items[el-1].op!=IR_JUMP || label_refs(s, s->items[el-1].s)!=1) continue;
+    long en = find_label(s, s->items[el-1].s);
+    if (en <= el + 1) continue;
+    cold_end[el] = (size_t)en;
+    moved++;
+  }
+  if (moved) {
+    Seq hot = {0}, out = {0};
+    for (size_t i=0;i<s->len;) {
+      if (i + 1 < s->len && cold_end[i+1]) {
+        size_t el = i + 1, en = cold_end[el];
+        seq_append(&out, s, el, en);
+        seq_push(&out, s->items[i], s->cnt[i]);
+        i = en;
+        continue;
+      }
+      seq_push(&hot, s->items[i], s->cnt[i]);
+      i++;
+    }
+    char *exit_label = new_label(f, s);
+    seq_push(&hot, (IrInstr){.op=IR_JUMP, .dest=-1, .arg1=-1, .arg2=-1, .s=lm_strdup(exit_label)}, (Count){0});
+    seq_append(&hot, &out, 0, out.len);
+    seq_push(&hot, (IrInstr){.op=IR_LABEL, .dest=-1, .arg1=-1, .arg2=-1, .s=exit_label}, (Count){0});
+    lm_free(out.items); lm_free(out.cnt);
+    seq_replace(s, &hot);
+    stats->blocks_moved += moved;
+  }
+  lm_free(cold_end);
+}
+
+static int has_fork(const Seq *s){
+  for (size_t i=0;i<s->len;++i) if (s->items[i].op==IR_FORK) return 1;
+  return 0;
+}
+
+// -- inlining --
+
+static int computed(IrOp op){
+  switch (op) {
+  case IR_CONST_INT: case IR_CONST_REAL: case IR_CONST_STRING: case IR_CONST_BOOL:
+  case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_MOD:
+  case IR_EQ: case IR_NEQ: case IR_LT: case IR_GT: case IR_LE: case IR_GE:
+  case IR_AND: case IR_OR: case IR_CONCAT:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+static int defines(const IrInstr *ins, int t){
+  IrInstr copy = *ins;
+  int *refs[3];
+  return ir_instr_temp_refs(&copy, refs) > 0 && refs[0]==&copy.dest && copy.dest==t;
+}
+
+// Every instruction defining temp t computes a fresh value
+static int computed_temp(const Seq *body, int t){
+  int found = 0;
+  for (size_t i=0;i<body->len;++i) {
+    if (!defines(&body->items[i], t)) continue;
+    if (!computed(body->items[i].op)) return 0;
+    found = 1;
+  }
+  return found;
+}
+
+// Small leaf functions whose behaviour does not depend on the frame they run
+// in: no calls, no record fields or indexing (resolved through the frame's
+// refs), no ReadLn or oracle, and every value they return is computed rather
+// than copied from a variable, so it carries no ref
+static int inlinable(const IrFunc *g, const Seq *body){
+  if (body->len > PGO_INLINE_MAX_INSTRS || g->param_count > 2) return 0;
+  for (int j=0;j<g->param_count;++j) if (strchr(g->params[j], '.')) return 0;
+  int returns = 0;
+  for (size_t i=0;i<body->len;++i) {
+    const IrInstr *ins = &body->items[i];
+    if (ins->op==IR_CALL || ins->op==IR_INDEX || ins->op==IR_READLN || ins->op==IR_ASK || ins->op > IR_INDEX) return 0;
+    if ((ins->op==IR_LOAD_VAR || ins->op==IR_STORE_VAR) && strchr(ins->s, '.')) return 0;
+    if ((ins->op==IR_STORE_VAR && strcmp(ins->s, "Result")==0) || ins->op==IR_RET) {
+      if (!computed_temp(body, ins->arg1)) return 0;
+      returns = 1;
+    }
+  }
+  return returns;
+}
+
+// Whether name is stored before anything can read it: its first mention is
+// a store ahead of the first control flow
+static int set_on_entry(const Seq *body, const char *name){
+  for (size_t i=0;i<body->len;++i) {
+    const IrInstr *ins = &body->items[i];
+    if (ins->op==IR_LABEL || ins->op==IR_JUMP || is_branch(ins->op) || ins->op==IR_RET) return 0;
+    if ((ins->op==IR_LOAD_VAR || ins->op==IR_STORE_VAR) && strcmp(ins->s, name)==0) return ins->op==IR_STORE_VAR;
+  }
+  return 0;
+}
+
+typedef struct {
+  char **from;
+  char **to;
+  size_t len;
+} Renames;
+
+static const char *renamed(const Renames *r, const char *name){
+  for (size_t i=0;i<r->len;++i) if (strcmp(r->from[i], name)==0) return r->to[i];
+  return NULL;
+}
+
+static void rename_add(Renames *r, const char *from, char *to, size_t cap){
+  if (renamed(r, from) || r->len==cap) { lm_free(to); return; }
+  r->from[r->len] = (char *)from;
+  r->to[r->len++] = to;
+}
+
+static char *prefixed(const char *prefix, const char *name){
+  size_t n = strlen(prefix) + strlen(name) + 1;
+  char *s = lm_malloc(n);
+  snprintf(s, n, "%s%s", prefix, name);
+  return s;
+}
+
+// Replaces `call` with g's body. The callee's frame becomes variables named
+// <callee>$<serial>$<name> in the caller's: parameters are bound from the
+// arguments, other names it writes start from what the callee would have
+// seen through its parent frame, RET stores Result and leaves, and the call's
+// temp reads Result at the end. The body keeps the callee's source spans;
+// the binding around it takes the call's.
+static void inline_call(IrFunc *caller, const Seq *caller_body, Seq *out, const IrInstr *call, LiminalSpan site, const IrFunc *g, const Seq *body, size_t serial){
+  char prefix[96];
+  snprintf(prefix, sizeof(prefix), "%.64s$%zu$", g->name, serial);
+  size_t cap = (size_t)g->param_count + body->len + 1;
+  Renames vars = {lm_malloc(cap * sizeof(char *)), lm_malloc(cap * sizeof(char *)), 0};
+  Renames labels = {lm_malloc(cap * sizeof(char *)), lm_malloc(cap * sizeof(char *)), 0};
+  for (int j=0;j<g->param_count;++j) rename_add(&vars, g->params[j], prefixed(prefix, g->params[j]), cap);
+  size_t params = vars.len;
+  rename_add(&vars, "Result", prefixed(prefix, "Result"), cap);
+  for (size_t i=0;i<body->len;++i) {
+    const IrInstr *ins = &body->items[i];
+    if (ins->op==IR_STORE_VAR) rename_add(&vars, ins->s, prefixed(prefix, ins->s), cap);
+    if (ins->op==IR_LABEL) rename_add(&labels, ins->s, new_label(caller, caller_body), cap);
+  }
+  int has_ret = 0, maxt = g->next_temp;
+  for (size_t i=0;i<body->len;++i) {
+    IrInstr copy = body->items[i];
+    int *refs[3], n = ir_instr_temp_refs(&copy, refs);
+    for (int k=0;k<n;++k) if (*refs[k] >= maxt) maxt = *refs[k] + 1;
+    has_ret |= copy.op==IR_RET;
+  }
+  int base = caller->next_temp;
+  caller->next_temp += maxt;
+
+  Count none = {0};
+  none.span = site;
+  int args[2] = {call->arg1, call->arg2};
+  for (size_t j=0;j<params;++j)
+    seq_push(out, (IrInstr){.op=IR_STORE_VAR, .dest=-1, .arg1=args[j], .arg2=-1, .s=lm_strdup(vars.to[j])}, none);
+  for (size_t j=params;j<vars.len;++j) {
+    if (set_on_entry(body, vars.from[j])) continue;
+    int t = caller->next_temp++;
+    seq_push(out, (IrInstr){.op=IR_LOAD_VAR, .dest=t, .arg1=-1, .arg2=-1, .s=lm_strdup(vars.from[j])}, none);
+    seq_push(out, (IrInstr){.op=IR_STORE_VAR, .dest=-1, .arg1=t, .arg2=-1, .s=lm_strdup(vars.to[j])}, none);
+  }
+  char *exit_label = has_ret ? new_label(caller, caller_body) : NULL;
+  const char *result = renamed(&vars, "Result");
+  for (size_t i=0;i<body->len;++i) {
+    IrInstr ins = body->items[i];
+    int *refs[3], n = ir_instr_temp_refs(&ins, refs);
+    for (int k=0;k<n;++k) if (*refs[k] >= 0) *refs[k] += base;
+    const char *s = ins.s;
+    if (ins.op==IR_LOAD_VAR || ins.op==IR_STORE_VAR) s = renamed(&vars, ins.s) ? renamed(&vars, ins.s) : ins.s;
+    else if (ins.op==IR_LABEL || ins.op==IR_JUMP || ins.op==IR_JUMP_IF_FALSE) s = renamed(&labels, ins.s);
+    Count at = {0};
+    at.span = body->cnt[i].span;
+    if (ins.op==IR_RET) {
+      seq_push(out, (IrInstr){.op=IR_STORE_VAR, .dest=-1, .arg1=ins.arg1, .arg2=-1, .s=lm_strdup(result)}, at);
+      ins = (IrInstr){.op=IR_JUMP, .dest=-1, .arg1=-1, .arg2=-1};
+      s = exit_label;
+    }
+    ins.s = s ? lm_strdup(s) : NULL;
+    ins.s2 = ins.s2 ? lm_strdup(ins.s2) : NULL;
+    seq_push(out, ins, at);
+  }
+  if (exit_label) seq_push(out, (IrInstr){.op=IR_LABEL, .dest=-1, .arg1=-1, .arg2=-1, .s=exit_label}, none);
+  seq_push(out, (IrInstr){.op=IR_LOAD_VAR, .dest=call->dest, .arg1=-1, .arg2=-1, .s=lm_strdup(result)}, none);
+
+  for (size_t j=0;j<vars.len;++j) lm_free(vars.to[j]);
+  for (size_t j=0;j<labels.len;++j) lm_free(labels.to[j]);
+  lm_free(vars.from); lm_free(vars.to); lm_free(labels.from); lm_free(labels.to);
+}
+
+static long find_func(const IrProgram *prog, const char *name){
+  for (size_t i=0;i<prog->funcs.len;++i) if (strcmp(prog->funcs.items[i].name, name)==0) return (long)i;
+  return -1;
+}
+
+static void inline_hot_calls(IrProgram *prog, Seq *seqs, size_t fi, size_t *serial, PgoStats *stats){
+  IrFunc *caller = &prog->funcs.items[fi];
+  Seq *s = &seqs[fi];
+  // hot[i]: callee index for the sites picked, hottest first
+  long *hot = lm_malloc(sizeof(long) * (s->len ? s->len : 1));
+  size_t picked = 0;
+  for (size_t i=0;i<s->len;++i) {
+    hot[i] = -1;
+    const IrInstr *ins = &s->items[i];
+    if (ins->op!=IR_CALL || s->cnt[i].taken < PGO_HOT_CALLS) continue;
+    long gi = find_func(prog, ins->s ? ins->s : "");
+    if (gi < 0 || (size_t)gi==fi) continue;
+    const IrFunc *g = &prog->funcs.items[gi];
+    if ((g->param_count > 0)!=(ins->arg1 >= 0) || (g->param_count > 1)!=(ins->arg2 >= 0) || !inlinable(g, &seqs[gi])) continue;
+    hot[i] = gi;
+    picked++;
+  }
+  while (picked > PGO_INLINE_MAX_SITES) {
+    size_t coldest = 0; int found = 0;
+    for (size_t i=0;i<s->len;++i) if (hot[i] >= 0 && (!found || s->cnt[i].taken < s->cnt[coldest].taken)) { coldest = i; found = 1; }
+    hot[coldest] = -1;
+    picked--;
+  }
+  if (picked) {
+    Seq out = {0};
+    for (size_t i=0;i<s->len;++i) {
+      if (hot[i] < 0) { seq_push(&out, s->items[i], s->cnt[i]); continue; }
+      inline_call(caller, s, &out, &s->items[i], s->cnt[i].span, &prog->funcs.items[hot[i]], &seqs[hot[i]], ++*serial);
+      lm_free(s->items[i].s);
+      lm_free(s->items[i].s2);
+      stats->inlined++;
+    }
+    seq_replace(s, &out);
+  }
+  lm_free(hot);
+}
+
+int pgo_apply(IrProgram *prog, const PgoProfile *profile, PgoStats *stats, char **errmsg){
+  PgoStats scratch = {0};
+  if (!stats) stats = &scratch;
+  if (pgo_checksum(prog)!=profile->checksum) {
+    if (errmsg) *errmsg = lm_strdup("profile was recorded for a different program");
+    return 0;
+  }
+  ir_program_own_strings(prog);
+  Constants consts = find_constants(prog);
+  size_t n = prog->funcs.len, serial = 0;
+  Seq *seqs = lm_calloc(n ? n : 1, sizeof(Seq));
+  for (size_t fi=0;fi<n;++fi) {
+    IrFunc *f = &prog->funcs.items[fi];
+    const PgoFunc *pf = profile_func(profile, f);
+    seqs[fi] = seq_take(f, pf);
+    if (!pf) continue;
+    reorder_cases(&seqs[fi], &consts, stats);
+    // A `parallel` task is the code between its FORK and end label, which
+    // must stay where it is
+    if (!has_fork(&seqs[fi])) move_cold_blocks(f, &seqs[fi], stats);
+  }
+  // Callees are leaves, so every body copied is final
+  for (size_t fi=0;fi<n;++fi) inline_hot_calls(prog, seqs, fi, &serial, stats);
+  for (size_t fi=0;fi<n;++fi) seq_give(&prog->funcs.items[fi], &seqs[fi]);
+  lm_free(seqs);
+  lm_free(consts.items);
+  return 1;
+}
@@ -0,0 +1,74 @@
+#include "liminal/phases.h"
+#include "liminal/profiler.h"
+
+#include <stdlib.h>
+
+PhaseLog *phase_log_new(void){
+  return calloc(1, sizeof(PhaseLog));
+}
+
+void phase_log_free(PhaseLog *log){
+  if (!log) return;
+  free(log->items);
+  free(log);
+}
+
+PhaseMark phase_mark(void){
+  alloc_reset_peak();
+  return (PhaseMark){ profiler_now_ns(), alloc_stats() };
+}
+
+void phase_log_add(PhaseLog *log, const char *name, PhaseMark mark){
+  uint64_t now = profiler_now_ns();
+  AllocStats a = alloc_stats();
+  if (log->len == log->cap) {
+    log->cap = log->cap ? log->cap * 2 : 16;
+    log->items = realloc(log->items, log->cap * sizeof(PhaseStat));
+  }
+  log->items[log->len++] = (PhaseStat){ name, now - mark.ns, a.allocs - mark.alloc.allocs,
+                                        a.frees - mark.alloc.frees, a.bytes - mark.alloc.bytes, a.peak };
+}
+
+static PhaseStat total(const PhaseLog *log){
+  PhaseStat t = { "total", 0, 0, 0, 0, 0 };
+  for (size_t i = 0; i < log->len; i++) {
+    const PhaseStat *p = &log->items[i];
+    t.ns += p->ns;
+    t.allocs += p->allocs;
+    t.frees += p->frees;
+    t.bytes += p->bytes;
+    if (p->peak > t.peak) t.peak = p->peak;
+  }
+  return t;
+}
+
+static void row(FILE *out, const PhaseStat *p){
+  fprintf(out, "%-12s %10.3f %12llu %12llu %14llu %14llu\n", p->name, (double)p->ns / 1e6,
+          (unsigned long long)p->allocs, (unsigned long long)p->frees,
+          (unsigned long long)p->bytes, (unsigned long long)p->peak);
+}
+
+void phase_log_report(const PhaseLog *log, FILE *out){
+  fprintf(out, "%-12s %10s %12s %12s %14s %14s\n", "phase", "ms", "allocs", "frees", "bytes", "peak bytes");
+  for (size_t i = 0; i < log->len; i++) row(out, &log->items[i]);
+  PhaseStat t = total(log);
+  row(out, &t);
+}
+
+static void json_row(FILE *out, const PhaseStat *p){
+  fprintf(out, "{\"name\":\"%s\",\"ns\":%llu,\"allocs\":%llu,\"frees\":%llu,\"bytes\":%llu,\"peak_bytes\":%llu}",
+          p->name, (unsigned long long)p->ns, (unsigned long long)p->allocs, (unsigned long long)p->frees,
+          (unsigned long long)p->bytes, (unsigned long long)p->peak);
+}
+
+void phase_log_write_json(const PhaseLog *log, FILE *out){
+  fprintf(out, "{\"phases\":[");
+  for (size_t i = 0; i < log->len; i++) {
+    if (i) fputc(',', out);
+    json_row(out, &log->items[i]);
+  }
+  fprintf(out, "],\"total\":");
+  PhaseStat t = total(log);
+  json_row(out, &t);
+  fprintf(out, "}\n");
+}
@@ -0,0 +1,233 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/profiler.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// IrOp values are dense from 0
+#define PROF_OP_COUNT ((size_t)IR_CMP_CONST_BRANCH + 1)
+
+uint64_t profiler_now_ns(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+Profiler *profiler_new(const IrProgram *prog){
+  Profiler *p = calloc(1, sizeof(Profiler));
+  p->prog = prog;
+  p->funcs = calloc(prog->funcs.len ? prog->funcs.len : 1, sizeof(ProfFunc));
+  p->ops = calloc(PROF_OP_COUNT, sizeof(uint64_t));
+  p->counts = calloc(prog->funcs.len ? prog->funcs.len : 1, sizeof(uint64_t *));
+  for (size_t i = 0; i < prog->funcs.len; i++) {
+    size_t n = prog->funcs.items[i].instrs.len;
+    p->counts[i] = calloc(n ? n : 1, sizeof(uint64_t));
+  }
+  p->stack_cap = 64;
+  p->stack = malloc(p->stack_cap * sizeof(ProfFrame));
+  p->start_ns = profiler_now_ns();
+  return p;
+}
+
+void profiler_free(Profiler *p){
+  if (!p) return;
+  for (size_t i = 0; i < p->prog->funcs.len; i++) free(p->counts[i]);
+  free(p->counts);
+  free(p->funcs);
+  free(p->ops);
+  free(p->stack);
+  free(p);
+}
+
+void profiler_enter(Profiler *p, const IrFunc *f){
+  if (p->depth == p->stack_cap) {
+    p->stack_cap *= 2;
+    p->stack = realloc(p->stack, p->stack_cap * sizeof(ProfFrame));
+  }
+  size_t idx = (size_t)(f - p->prog->funcs.items);
+  p->funcs[idx].calls++;
+  p->funcs[idx].depth++;
+  p->stack[p->depth++] = (ProfFrame){ idx, profiler_now_ns(), 0 };
+}
+
+void profiler_exit(Profiler *p){
+  ProfFrame fr = p->stack[--p->depth];
+  uint64_t elapsed = profiler_now_ns() - fr.start_ns;
+  ProfFunc *pf = &p->funcs[fr.func];
+  if (--pf->depth == 0) pf->inclusive_ns += elapsed;
+  pf->exclusive_ns += elapsed > fr.child_ns ? elapsed - fr.child_ns : 0;
+  if (p->depth) p->stack[p->depth - 1].child_ns += elapsed;
+}
+
+void profiler_oracle(Profiler *p, uint64_t start_ns){
+  p->oracle_calls++;
+  profiler_oracle_wait(p, start_ns);
+}
+
+void profiler_oracle_wait(Profiler *p, uint64_t start_ns){
+  uint64_t elapsed = profiler_now_ns() - start_ns;
+  p->oracle_ns += elapsed;
+  if (!p->depth) return;
+  ProfFrame *fr = &p->stack[p->depth - 1];
+  fr->child_ns += elapsed;
+  p->funcs[fr->func].oracle_ns += elapsed;
+}
+
+void profiler_finish(Profiler *p){
+  p->total_ns = profiler_now_ns() - p->start_ns;
+}
+
+// Report rows sort by key, largest first; ties by name so the order is stable
+typedef struct { size_t idx; uint64_t key; const char *name; } ProfRow;
+
+static int by_key(const void *a, const void *b){
+  const ProfRow *x = a, *y = b;
+  if (x->key != y->key) return x->key < y->key ? 1 : -1;
+  return strcmp(x->name, y->name);
+}
+
+static double ms(uint64_t ns){ return (double)ns / 1e6; }
+
+static uint64_t total_instructions(const Profiler *p){
+  uint64_t n = 0;
+  for (size_t i = 0; i < PROF_OP_COUNT; i++) n += p->ops[i];
+  return n;
+}
+
+// Instructions executed per source line, summed over every function whose
+// line table points there (inlined copies included); *max_line is the
+// largest line seen
+static uint64_t *line_counts(const Profiler *p, uint32_t *max_line){
+  const IrProgram *prog = p->prog;
+  uint32_t max = 0;
+  for (size_t i = 0; i < prog->funcs.len; i++) {
+    const IrLineVec *lv = &prog->funcs.items[i].lines;
+    for (size_t j = 0; j < lv->len; j++) if (lv->items[j].span.line > (int)max) max = (uint32_t)lv->items[j].span.line;
+  }
+  uint64_t *lines = calloc((size_t)max + 1, sizeof(uint64_t));
+  for (size_t i = 0; i < prog->funcs.len; i++) {
+    const IrFunc *f = &prog->funcs.items[i];
+    for (size_t j = 0; j < f->lines.len; j++) {
+      size_t end = j + 1 < f->lines.len ? f->lines.items[j + 1].start : f->instrs.len;
+      for (size_t ip = f->lines.items[j].start; ip < end; ip++) lines[f->lines.items[j].span.line] += p->counts[i][ip];
+    }
+  }
+  lines[0] = 0;
+  *max_line = max;
+  return lines;
+}
+
+// "path:line:col" for a known span, "-" otherwise
+static const char *location(const Profiler *p, LiminalSpan sp, char *buf, size_t cap){
+  if (sp.line <= 0) return "-";
+  snprintf(buf, cap, "%s:%d:%d", p->source ? p->source : "", sp.line, sp.column);
+  return buf;
+}
+
+static int by_line(const void *a, const void *b){
+  const ProfRow *x = a, *y = b;
+  if (x->key != y->key) return x->key < y->key ? 1 : -1;
+  return x->idx < y->idx ? -1 : x->idx > y->idx;
+}
+
+#define PROF_HOT_LINES 10
+
+void profiler_report(const Profiler *p, FILE *out){
+  const IrProgram *prog = p->prog;
+  uint64_t executed = total_instructions(p);
+  char loc[512];
+  fprintf(out, "profile: %.3f ms total, %.3f ms in %llu oracle call(s), %llu instructions\n",
+          ms(p->total_ns), ms(p->oracle_ns), (unsigned long long)p->oracle_calls, (unsigned long long)executed);
+
+  ProfRow *rows = malloc((prog->funcs.len > PROF_OP_COUNT ? prog->funcs.len : PROF_OP_COUNT) * sizeof(ProfRow));
+  size_t n = 0;
+  for (size_t i = 0; i < prog->funcs.len; i++)
+    if (p->funcs[i].calls) rows[n++] = (ProfRow){ i, p->funcs[i].exclusive_ns, prog->funcs.items[i].name };
+  qsort(rows, n, sizeof(ProfRow), by_key);
+  fprintf(out, "\n%-24s %10s %12s %12s %12s %14s  %s\n", "function", "calls", "incl ms", "excl ms", "oracle ms", "instructions", "source");
+  for (size_t i = 0; i < n; i++) {
+    const ProfFunc *pf = &p->funcs[rows[i].idx];
+    fprintf(out, "%-24s %10llu %12.3f %12.3f %12.3f %14llu  %s\n", rows[i].name,
+            (unsigned long long)pf->calls, ms(pf->inclusive_ns), ms(pf->exclusive_ns), ms(pf->oracle_ns),
+            (unsigned long long)pf->instructions,
+            location(p, ir_func_span_at(&prog->funcs.items[rows[i].idx], 0), loc, sizeof(loc)));
+  }
+
+  uint32_t max_line = 0;
+  uint64_t *lines = line_counts(p, &max_line);
+  ProfRow *hot = malloc(((size_t)max_line + 1) * sizeof(ProfRow));
+  size_t nhot = 0;
+  for (uint32_t l = 1; l <= max_line; l++) if (lines[l]) hot[nhot++] = (ProfRow){ l, lines[l], NULL };
+  qsort(hot, nhot, sizeof(ProfRow), by_line);
+  if (nhot) fprintf(out, "\n%-32s %14s %8s\n", "line", "instructions", "%");
+  for (size_t i = 0; i < nhot && i < PROF_HOT_LINES; i++) {
+    snprintf(loc, sizeof(loc), "%s:%zu", p->source ? p->source : "", hot[i].idx);
+    fprintf(out, "%-32s %14llu %7.2f%%\n", loc, (unsigned long long)hot[i].key,
+            100.0 * (double)hot[i].key / (double)executed);
+  }
+  free(hot);
+  free(lines);
+
+  n = 0;
+  for (size_t i = 0; i < PROF_OP_COUNT; i++)
+    if (p->ops[i]) rows[n++] = (ProfRow){ i, p->ops[i], ir_op_name((IrOp)i) };
+  qsort(rows, n, sizeof(ProfRow), by_key);
+  fprintf(out, "\n%-24s %14s %8s\n", "op", "count", "%");
+  for (size_t i = 0; i < n; i++)
+    fprintf(out, "%-24s %14llu %7.2f%%\n", rows[i].name, (unsigned long long)rows[i].key,
+            100.0 * (double)rows[i].key / (double)executed);
+  free(rows);
+}
+
+static void json_string(FILE *out, const char *s){
+  fputc('"', out);
+  for (; *s; s++) {
+    unsigned char c = (unsigned char)*s;
+    if (c == '"' || c == '\\') fprintf(out, "\\%c", c);
+    else if (c < 0x20) fprintf(out, "\\u%04x", c);
+    else fputc(c, out);
+  }
+  fputc('"', out);
+}
+
+void profiler_write_json(const Profiler *p, FILE *out){
+  const IrProgram *prog = p->prog;
+  fputc('{', out);
+  if (p->source) { fprintf(out, "\"source\":"); json_string(out, p->source); fputc(',', out); }
+  fprintf(out, "\"total_ns\":%llu,\"oracle_ns\":%llu,\"oracle_calls\":%llu,\"instructions\":%llu,\"functions\":[",
+          (unsigned long long)p->total_ns, (unsigned long long)p->oracle_ns,
+          (unsigned long long)p->oracle_calls, (unsigned long long)total_instructions(p));
+  int first = 1;
+  for (size_t i = 0; i < prog->funcs.len; i++) {
+    const ProfFunc *pf = &p->funcs[i];
+    if (!pf->calls) continue;
+    fprintf(out, "%s{\"name\":", first ? "" : ",");
+    json_string(out, prog->funcs.items[i].name);
+    fprintf(out, ",\"calls\":%llu,\"inclusive_ns\":%llu,\"exclusive_ns\":%llu,\"oracle_ns\":%llu,\"instructions\":%llu",
+            (unsigned long long)pf->calls, (unsigned long long)pf->inclusive_ns, (unsigned long long)pf->exclusive_ns,
+            (unsigned long long)pf->oracle_ns, (unsigned long long)pf->instructions);
+    LiminalSpan sp = ir_func_span_at(&prog->funcs.items[i], 0);
+    if (sp.line > 0) fprintf(out, ",\"line\":%d,\"column\":%d", sp.line, sp.column);
+    fputc('}', out);
+    first = 0;
+  }
+  fprintf(out, "],\"lines\":[");
+  uint32_t max_line = 0;
+  uint64_t *lines = line_counts(p, &max_line);
+  first = 1;
+  for (uint32_t l = 1; l <= max_line; l++) {
+    if (!lines[l]) continue;
+    fprintf(out, "%s{\"line\":%u,\"instructions\":%llu}", first ? "" : ",", l, (unsigned long long)lines[l]);
+    first = 0;
+  }
+  free(lines);
+  fprintf(out, "],\"ops\":{");
+  first = 1;
+  for (size_t i = 0; i < PROF_OP_COUNT; i++) {
+    if (!p->ops[i]) continue;
+    fprintf(out, "%s\"%s\":%llu", first ? "" : ",", ir_op_name((IrOp)i), (unsigned long long)p->ops[i]);
+    first = 0;
+  }
+  fprintf(out, "}}\n");
+}
@@ -0,0 +1,881 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/recordings.h"
+#include "liminal/alloc.h"
+#include "liminal/json.h"
+#include "liminal/sha256.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Binary recordings: the data file is DATA_MAGIC, then records appended one
+// after another, each a RECORD_HEADER (the 32-byte key, the answer's length
+// as a little-endian u32, 1 or 0 for ok, three zero bytes) and the answer
+// (for a failure, the error). The sidecar <file>.idx is INDEX_MAGIC, the
+// length of the data it covers, its slot count (a power of two), its number
+// of keys and the offset of the last record it covers, as little-endian
+// u64s, the keys of the first and the last record it covers, then that many
+// INDEX_SLOT slots (key, offset of the record as a u64; offset 0 marks a
+// free slot) probed linearly from the key's first 8 bytes. The two keys
+// tell an index that belongs to other data, left behind when the file was
+// replaced, from the index of this data.
+static const char DATA_MAGIC[8] = { 'L', 'I', 'M', 'R', 'E', 'C', '1', '\n' };
+static const char INDEX_MAGIC[8] = { 'L', 'I', 'M', 'I', 'D', 'X', '2', '\n' };
+#define RECORD_HEADER 40
+#define INDEX_HEADER 104
+#define INDEX_SLOT 40
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  for (int k = 0; k < 4; ++k) p[k] = (uint8_t)(v >> (8 * k));
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+  uint32_t v = 0;
+  for (int k = 3; k >= 0; --k) v = v << 8 | p[k];
+  return v;
+}
+
+static void put_u64(uint8_t *p, uint64_t v) {
+  for (int k = 0; k < 8; ++k) p[k] = (uint8_t)(v >> (8 * k));
+}
+
+static uint64_t get_u64(const uint8_t *p) {
+  uint64_t v = 0;
+  for (int k = 7; k >= 0; --k) v = v << 8 | p[k];
+  return v;
+}
+
+// Where the record at offset at ends; 0 if the data stops inside it
+static size_t record_end(const uint8_t *data, size_t len, size_t at) {
+  if (len - at < RECORD_HEADER) return 0;
+  uint32_t n = get_u32(data + at + 32);
+  return len - at - RECORD_HEADER < n ? 0 : at + RECORD_HEADER + n;
+}
+
+// One recorded hash. For JSONL, response points at its JSON string in the
+// file's text (NULL: the line had none); for a binary recording, offset is
+// where its record starts. Open addressing with linear probing, used 0
+// marks a free slot.
+typedef struct {
+  uint8_t key[32];
+  const char *response;
+  size_t offset;
+  int ok;
+  int malformed;
+  int used;
+} ReplayEntry;
+
+typedef struct {
+  ReplayEntry *entries;
+  size_t cap; // a power of two
+  size_t len;
+} KeyTable;
+
+struct ReplayStore {
+  char *text;          // JSONL: the whole file, lines NUL-terminated in place
+  const uint8_t *data; // binary: the data file, mapped
+  size_t data_len;
+  const uint8_t *index; // binary: the sidecar, mapped (NULL: none usable)
+  size_t index_len;
+  KeyTable table;       // JSONL records, or binary records past the index
+};
+
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static int parse_key(const char *hex, size_t len, uint8_t key[32]) {
+  if (len != 64) return 0;
+  for (size_t i = 0; i < 32; ++i) {
+    int hi = hex_value(hex[2 * i]), lo = hex_value(hex[2 * i + 1]);
+    if (hi < 0 || lo < 0) return 0;
+    key[i] = (uint8_t)(hi << 4 | lo);
+  }
+  return 1;
+}
+
+static size_t key_home(const uint8_t key[32], size_t cap) {
+  // The key is a SHA-256 digest: its first bytes are as good as any
+  uint64_t h = 0;
+  for (int k = 0; k < 8; ++k) h = h << 8 | key[k];
+  return (size_t)(h & (cap - 1));
+}
+
+static size_t slot_of(const KeyTable *t, const uint8_t key[32]) {
+  size_t i = key_home(key, t->cap);
+  while (t->entries[i].used && memcmp(t->entries[i].key, key, 32) != 0) i = (i + 1) & (t->cap - 1);
+  return i;
+}
+
+static const ReplayEntry *table_find(const KeyTable *t, const uint8_t key[32]) {
+  if (!t->cap) return NULL;
+  const ReplayEntry *e = &t->entries[slot_of(t, key)];
+  return e->used ? e : NULL;
+}
+
+// 0 if the key was already there: the first record with a hash wins
+static int table_put(KeyTable *t, const ReplayEntry *e) {
+  if ((t->len + 1) * 2 > t->cap) {
+    ReplayEntry *old = t->entries;
+    size_t old_cap = t->cap;
+    t->cap = t->cap ? t->cap * 2 : 64;
+    t->entries = (ReplayEntry *)calloc(t->cap, sizeof(ReplayEntry));
+    for (size_t i = 0; i < old_cap; ++i) if (old[i].used) t->entries[slot_of(t, old[i].key)] = old[i];
+    free(old);
+  }
+  ReplayEntry *slot = &t->entries[slot_of(t, e->key)];
+  if (slot->used) return 0;
+  *slot = *e;
+  slot->used = 1;
+  t->len++;
+  return 1;
+}
+
+// Reads one line; 0 for lines without a usable "hash". A record that
+// breaks off after its hash comes back malformed, so its prompt is reported
+// as such instead of as never recorded.
+static int parse_line(const char *p, ReplayEntry *e) {
+  memset(e, 0, sizeof(*e));
+  e->ok = 1;
+  int have_key = 0;
+  p = json_skip_ws(p);
+  if (*p != '{') return 0;
+  p = json_skip_ws(p + 1);
+  while (*p != '}') {
+    const char *name = p, *end;
+    if (*p != '"' || !(end = json_skip_value(p))) break;
+    size_t name_len = (size_t)(end - name);
+    p = json_skip_ws(end);
+    if (*p != ':') break;
+    p = json_skip_ws(p + 1);
+    const char *value = p;
+    if (!(end = json_skip_value(p))) break;
+    p = end;
+    if (name_len == 6 && memcmp(name, "\"hash\"", 6) == 0) {
+      // Hashes are hex: no escapes to undo
+      if (*value != '"' || !parse_key(value + 1, (size_t)(p - value) - 2, e->key)) return 0;
+      have_key = 1;
+    } else if (name_len == 10 && memcmp(name, "\"response\"", 10) == 0) {
+      e->response = *value == '"' ? value : NULL;
+    } else if (name_len == 4 && memcmp(name, "\"ok\"", 4) == 0) {
+      e->ok = strncmp(value, "false", 5) != 0;
+    }
+    p = json_skip_ws(p);
+    if (*p == ',') p = json_skip_ws(p + 1);
+    else if (*p != '}') break;
+  }
+  e->malformed = *p != '}';
+  return have_key;
+}
+
+static char *path_error(const char *what, const char *path) {
+  size_t n = strlen(what) + strlen(path) + strlen(strerror(errno)) + 8;
+  char *msg = (char *)malloc(n);
+  snprintf(msg, n, "%s: %s: %s", what, path, strerror(errno));
+  return msg;
+}
+
+static char *read_file(const char *path, char **errmsg) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    *errmsg = errno == ENOENT ? strdup("replay file not found") : path_error("replay", path);
+    return NULL;
+  }
+  size_t len = 0, cap = 1 << 16;
+  char *text = (char *)malloc(cap);
+  size_t got;
+  while ((got = fread(text + len, 1, cap - len - 1, f)) > 0) {
+    len += got;
+    if (cap - len - 1 == 0) text = (char *)realloc(text, cap *= 2);
+  }
+  int failed = ferror(f);
+  fclose(f);
+  if (failed) {
+    free(text);
+    *errmsg = strdup("replay file unreadable");
+    return NULL;
+  }
+  text[len] = '\0';
+  return text;
+}
+
+// The whole file mapped read-only; NULL with errno set on failure, or with
+// *len 0 for an empty file
+static const uint8_t *map_file(const char *path, size_t *len) {
+  *len = 0;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return NULL;
+  struct stat st;
+  void *p = NULL;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) p = NULL;
+    else *len = (size_t)st.st_size;
+  }
+  close(fd);
+  return (const uint8_t *)p;
+}
+
+static int is_binary(const uint8_t *data, size_t len) {
+  return len >= sizeof(DATA_MAGIC) && memcmp(data, DATA_MAGIC, sizeof(DATA_MAGIC)) == 0;
+}
+
+int recording_is_binary(const char *path) {
+  uint8_t head[sizeof(DATA_MAGIC)];
+  FILE *f = fopen(path, "rb");
+  if (!f) return 0;
+  size_t n = fread(head, 1, sizeof(head), f);
+  fclose(f);
+  return is_binary(head, n);
+}
+
+static char *index_path(const char *path) {
+  size_t n = strlen(path) + 5;
+  char *idx = (char *)malloc(n);
+  snprintf(idx, n, "%s.idx", path);
+  return idx;
+}
+
+// Whether the first and last records the index covers are the data's
+static int index_matches(const uint8_t *index, const uint8_t *data, size_t data_len, uint64_t covered) {
+  uint64_t last = get_u64(index + 32);
+  if (covered == sizeof(DATA_MAGIC)) return last == 0;
+  return last >= sizeof(DATA_MAGIC) && last < covered && record_end(data, data_len, sizeof(DATA_MAGIC)) &&
+         memcmp(data + sizeof(DATA_MAGIC), index + 40, 32) == 0 && record_end(data, data_len, (size_t)last) == covered &&
+         memcmp(data + last, index + 72, 32) == 0;
+}
+
+// The sidecar of the data, if it is one and describes a prefix of this
+// data; the length of that prefix goes in *covers
+static const uint8_t *map_index(const char *path, const uint8_t *data, size_t data_len, size_t *len, size_t *covers) {
+  char *idx = index_path(path);
+  const uint8_t *index = map_file(idx, len);
+  free(idx);
+  if (!index) return NULL;
+  uint64_t covered = *len >= INDEX_HEADER ? get_u64(index + 8) : 0;
+  uint64_t slots = *len >= INDEX_HEADER ? get_u64(index + 16) : 0;
+  if (*len < INDEX_HEADER || memcmp(index, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 || covered < sizeof(DATA_MAGIC) ||
+      covered > data_len || !slots || (slots & (slots - 1)) || slots > (*len - INDEX_HEADER) / INDEX_SLOT ||
+      *len != INDEX_HEADER + slots * INDEX_SLOT || !index_matches(index, data, data_len, covered)) {
+    munmap((void *)index, *len);
+    return NULL;
+  }
+  *covers = (size_t)covered;
+  return index;
+}
+
+// Offset of the key's record in a mapped index; 0 if it is not there
+static size_t index_find(const uint8_t *index, const uint8_t key[32]) {
+  size_t slots = (size_t)get_u64(index + 16);
+  size_t i = key_home(key, slots);
+  for (size_t probes = 0; probes < slots; ++probes, i = (i + 1) & (slots - 1)) {
+    const uint8_t *slot = index + INDEX_HEADER + i * INDEX_SLOT;
+    size_t offset = (size_t)get_u64(slot + 32);
+    if (!offset) return 0;
+    if (memcmp(slot, key, 32) == 0) return offset;
+  }
+  return 0;
+}
+
+static ReplayStore *open_jsonl(const char *path, char **errmsg) {
+  char *text = read_file(path, errmsg);
+  if (!text) return NULL;
+  ReplayStore *s = (ReplayStore *)calloc(1, sizeof(ReplayStore));
+  s->text = text;
+  for (char *line = text; *line;) {
+    char *nl = strchr(line, '\n');
+    if (nl) *nl = '\0';
+    ReplayEntry e;
+    if (parse_line(line, &e)) table_put(&s->table, &e);
+    if (!nl) break;
+    line = nl + 1;
+  }
+  return s;
+}
+
+// Records the index covers are looked up there; any appended after it was
+// written are read into the table
+static ReplayStore *open_binary(const char *path, char **errmsg) {
+  ReplayStore *s = (ReplayStore *)calloc(1, sizeof(ReplayStore));
+  s->data = map_file(path, &s->data_len);
+  if (!s->data) {
+    *errmsg = path_error("replay", path);
+    free(s);
+    return NULL;
+  }
+  size_t at = sizeof(DATA_MAGIC), end;
+  s->index = map_index(path, s->data, s->data_len, &s->index_len, &at);
+  for (; (end = record_end(s->data, s->data_len, at)); at = end) {
+    ReplayEntry e = {0};
+    memcpy(e.key, s->data + at, 32);
+    e.offset = at;
+    e.ok = s->data[at + 36];
+    if (!s->index || !index_find(s->index, e.key)) table_put(&s->table, &e);
+  }
+  return s;
+}
+
+ReplayStore *replay_store_open(const char *path, char **errmsg) {
+  return recording_is_binary(path) ? open_binary(path, errmsg) : open_jsonl(path, errmsg);
+}
+
+void replay_store_close(ReplayStore *s) {
+  if (!s) return;
+  if (s->data) munmap((void *)s->data, s->data_len);
+  if (s->index) munmap((void *)s->index, s->index_len);
+  free(s->table.entries);
+  free(s->text);
+  free(s);
+}
+
+size_t replay_store_count(const ReplayStore *s) {
+  if (!s) return 0;
+  return s->table.len + (s->index ? (size_t)get_u64(s->index + 24) : 0);
+}
+
+static void binary_result(const ReplayStore *s, size_t offset, OracleResult *out) {
+  size_t end = record_end(s->data, s->data_len, offset);
+  if (!end) {
+    out->error = strdup("replay malformed");
+    return;
+  }
+  size_t n = end - offset - RECORD_HEADER;
+  char *text = (char *)malloc(n + 1);
+  memcpy(text, s->data + offset + RECORD_HEADER, n);
+  text[n] = '\0';
+  if (s->data[offset + 36]) {
+    out->ok = 1;
+    out->text = text;
+  } else {
+    out->error = text;
+  }
+}
+
+// Offset of the key's first record, read from the start of the data; 0 if
+// it is not there
+static size_t scan_find(const ReplayStore *s, const uint8_t key[32]) {
+  for (size_t at = sizeof(DATA_MAGIC), end; (end = record_end(s->data, s->data_len, at)); at = end)
+    if (memcmp(s->data + at, key, 32) == 0) return at;
+  return 0;
+}
+
+// An index that passed map_index, together with the table of records after
+// it, answers for every key; only a slot whose record does not carry the
+// key it was looked up by sends the lookup to a read from the start.
+int replay_store_find(const ReplayStore *s, const char *hash, OracleResult *out) {
+  uint8_t key[32];
+  if (!s || !parse_key(hash, strlen(hash), key)) return 0;
+  memset(out, 0, sizeof(*out));
+  size_t offset = s->index ? index_find(s->index, key) : 0;
+  if (offset && (offset >= s->data_len || !record_end(s->data, s->data_len, offset) || memcmp(s->data + offset, key, 32) != 0))
+    offset = scan_find(s, key);
+  if (offset) {
+    binary_result(s, offset, out);
+    return 1;
+  }
+  const ReplayEntry *e = table_find(&s->table, key);
+  if (!e) return 0;
+  if (s->data) {
+    binary_result(s, e->offset, out);
+    return 1;
+  }
+  if (e->malformed) {
+    out->error = strdup("replay malformed");
+    return 1;
+  }
+  if (!e->response) {
+    out->error = strdup("replay response missing");
+    return 1;
+  }
+  const char *p = e->response;
+  char *text = json_parse_string(&p);
+  if (!text) out->error = strdup("replay malformed");
+  else if (!e->ok) out->error = text;
+  else {
+    out->ok = 1;
+    out->text = text;
+  }
+  return 1;
+}
+
+struct RecordWriter {
+  int fd;
+  int binary;
+  long flush_ms;
+  pthread_mutex_t lock; // guards everything below
+  pthread_cond_t wake;    // for the thread: buffer full, flush asked or closing
+  pthread_cond_t flushed; // for record_writer_flush
+  char *buf;            // records queued, whole records only
+  size_t len, cap;
+  char *spare;          // the thread writes one buffer while callers fill the other
+  size_t spare_cap;
+  uint64_t first_ms;    // when the oldest queued record came
+  uint64_t asked, done; // flush requests made and served
+  int closing;
+  int failed;
+  int threaded;
+  pthread_t thread;
+  AllocStats alloc;     // counted on the thread, read after the join
+};
+
+static uint64_t now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+// All of data in one write() when the kernel takes it, under a lock on the
+// whole file so other processes' records cannot land in a short write's gap
+static int write_locked(int fd, const char *data, size_t len) {
+  struct flock fl = {0};
+  fl.l_type = F_WRLCK;
+  fl.l_whence = SEEK_SET;
+  while (fcntl(fd, F_SETLKW, &fl) < 0 && errno == EINTR) {}
+  int rc = 0;
+  while (len > 0) {
+    ssize_t n = write(fd, data, len);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) { rc = -1; break; }
+    data += n;
+    len -= (size_t)n;
+  }
+  fl.l_type = F_UNLCK;
+  fcntl(fd, F_SETLK, &fl);
+  return rc;
+}
+
+static void *writer_main(void *arg) {
+  RecordWriter *w = (RecordWriter *)arg;
+  pthread_mutex_lock(&w->lock);
+  for (;;) {
+    while (!w->closing && w->asked == w->done && w->len < RECORD_WRITER_BUFFER &&
+           !(w->len && now_ms() >= w->first_ms + (uint64_t)w->flush_ms)) {
+      if (!w->len) {
+        pthread_cond_wait(&w->wake, &w->lock);
+        continue;
+      }
+      uint64_t due = w->first_ms + (uint64_t)w->flush_ms;
+      struct timespec ts;
+      ts.tv_sec = (time_t)(due / 1000u);
+      ts.tv_nsec = (long)(due % 1000u) * 1000000L;
+      pthread_cond_timedwait(&w->wake, &w->lock, &ts);
+    }
+    uint64_t asked = w->asked;
+    if (w->len) {
+      char *out = w->buf;
+      size_t len = w->len, cap = w->cap;
+      w->buf = w->spare;
+      w->cap = w->spare_cap;
+      w->len = 0;
+      pthread_mutex_unlock(&w->lock);
+      int rc = write_locked(w->fd, out, len);
+      pthread_mutex_lock(&w->lock);
+      w->spare = out;
+      w->spare_cap = cap;
+      if (rc < 0) w->failed = 1;
+    }
+    w->done = asked;
+    pthread_cond_broadcast(&w->flushed);
+    if (w->closing && !w->len) break;
+  }
+  pthread_mutex_unlock(&w->lock);
+  w->alloc = alloc_stats(); // a thread of its own counts from zero
+  return NULL;
+}
+
+RecordWriter *record_writer_open(const char *path, long flush_ms, char **errmsg) {
+  int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+  if (fd < 0) {
+    size_t n = strlen(path) + strlen(strerror(errno)) + 16;
+    *errmsg = (char *)malloc(n);
+    snprintf(*errmsg, n, "record: %s: %s", path, strerror(errno));
+    return NULL;
+  }
+  RecordWriter *w = (RecordWriter *)calloc(1, sizeof(RecordWriter));
+  w->fd = fd;
+  // A file that has records keeps its format; a new one is binary if its
+  // name says so
+  struct stat st;
+  size_t n = strlen(path);
+  if (fstat(fd, &st) == 0 && st.st_size > 0) w->binary = recording_is_binary(path);
+  else w->binary = n >= 5 && strcmp(path + n - 5, RECORDING_BINARY_EXT) == 0;
+  if (w->binary) {
+    // Another writer may be starting the same file: the lock decides who
+    // writes the magic
+    struct flock fl = {0};
+    fl.l_type = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    while (fcntl(fd, F_SETLKW, &fl) < 0 && errno == EINTR) {}
+    if (fstat(fd, &st) == 0 && st.st_size == 0) {
+      // An index left from a file of the same name describes other data
+      char *idx = index_path(path);
+      unlink(idx);
+      free(idx);
+      if (write(fd, DATA_MAGIC, sizeof(DATA_MAGIC)) != (ssize_t)sizeof(DATA_MAGIC)) w->failed = 1;
+    }
+    fl.l_type = F_UNLCK;
+    fcntl(fd, F_SETLK, &fl);
+  }
+  w->flush_ms = flush_ms;
+  pthread_mutex_init(&w->lock, NULL);
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&w->wake, &attr);
+  pthread_condattr_destroy(&attr);
+  pthread_cond_init(&w->flushed, NULL);
+  if (flush_ms > 0) w->threaded = pthread_create(&w->thread, NULL, writer_main, w) == 0;
+  return w;
+}
+
+// A binary record: no prompt, only its key
+static char *binary_record(const char *hash, const char *body, size_t n, int ok, size_t *len) {
+  uint8_t *rec = (uint8_t *)calloc(1, RECORD_HEADER + n);
+  if (!parse_key(hash, strlen(hash), rec)) {
+    free(rec);
+    return NULL;
+  }
+  put_u32(rec + 32, (uint32_t)n);
+  rec[36] = ok ? 1 : 0;
+  if (n) memcpy(rec + RECORD_HEADER, body, n);
+  *len = RECORD_HEADER + n;
+  return (char *)rec;
+}
+
+static char *jsonl_record(const char *hash, const char *prompt, const char *body, size_t n, int ok, size_t *len) {
+  char *line = NULL;
+  FILE *f = open_memstream(&line, len);
+  if (!f) return NULL;
+  fprintf(f, "{\"hash\":\"%s\"", hash);
+  if (prompt) {
+    fputs(",\"prompt\":\"", f);
+    json_escape(f, prompt, strlen(prompt));
+    fputc('"', f);
+  }
+  fputs(",\"response\":\"", f);
+  if (body) json_escape(f, body, n);
+  fprintf(f, "\",\"ok\":%s}\n", ok ? "true" : "false");
+  fclose(f);
+  return line;
+}
+
+void record_writer_append(RecordWriter *w, const char *hash, const char *prompt, const OracleResult *r) {
+  const char *body = r->ok ? r->text : r->error;
+  size_t n = body ? strlen(body) : 0, len = 0;
+  char *line = w->binary ? binary_record(hash, body, n, r->ok, &len) : jsonl_record(hash, prompt, body, n, r->ok, &len);
+  if (!line) return;
+  pthread_mutex_lock(&w->lock);
+  if (!w->threaded) {
+    if (write_locked(w->fd, line, len) < 0) w->failed = 1;
+  } else {
+    if (w->len + len > w->cap) {
+      w->cap = w->len + len > RECORD_WRITER_BUFFER ? w->len + len : RECORD_WRITER_BUFFER;
+      w->buf = (char *)realloc(w->buf, w->cap);
+    }
+    if (!w->len) w->first_ms = now_ms();
+    memcpy(w->buf + w->len, line, len);
+    w->len += len;
+    // The thread is waiting on an empty queue or on the oldest record's age
+    if (w->len == len || w->len >= RECORD_WRITER_BUFFER) pthread_cond_signal(&w->wake);
+  }
+  pthread_mutex_unlock(&w->lock);
+  free(line);
+}
+
+int record_writer_flush(RecordWriter *w) {
+  pthread_mutex_lock(&w->lock);
+  if (w->threaded) {
+    uint64_t ticket = ++w->asked;
+    pthread_cond_signal(&w->wake);
+    while (w->done < ticket) pthread_cond_wait(&w->flushed, &w->lock);
+  }
+  int rc = w->failed ? -1 : 0;
+  pthread_mutex_unlock(&w->lock);
+  return rc;
+}
+
+int record_writer_close(RecordWriter *w) {
+  if (!w) return 0;
+  if (w->threaded) {
+    pthread_mutex_lock(&w->lock);
+    w->closing = 1;
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+    alloc_merge(w->alloc);
+  }
+  int rc = w->failed ? -1 : 0;
+  if (close(w->fd) < 0) rc = -1;
+  pthread_cond_destroy(&w->wake);
+  pthread_cond_destroy(&w->flushed);
+  pthread_mutex_destroy(&w->lock);
+  free(w->buf);
+  free(w->spare);
+  free(w);
+  return rc;
+}
+
+// One record as the tools see it, in either format
+typedef struct {
+  const uint8_t *key;
+  int ok;
+  const char *body;
+  size_t len;
+  size_t offset; // binary: where the record starts
+} RecordView;
+
+typedef void (*RecordFn)(void *user, const RecordView *r);
+
+// Calls fn on each whole record of path in file order. *skipped counts the
+// JSONL lines that are not readable records, or the bytes of a binary
+// recording's torn last record.
+static int each_record(const char *path, RecordFn fn, void *user, size_t *skipped, char **errmsg) {
+  *skipped = 0;
+  if (access(path, R_OK) != 0) {
+    *errmsg = path_error("recordings", path);
+    return -1;
+  }
+  if (recording_is_binary(path)) {
+    size_t len, at = sizeof(DATA_MAGIC), end;
+    const uint8_t *data = map_file(path, &len);
+    if (!data) {
+      *errmsg = path_error("recordings", path);
+      return -1;
+    }
+    for (; (end = record_end(data, len, at)); at = end) {
+      RecordView r = { data + at, data[at + 36], (const char *)data + at + RECORD_HEADER, end - at - RECORD_HEADER, at };
+      fn(user, &r);
+    }
+    *skipped = len - at;
+    munmap((void *)data, len);
+    return 0;
+  }
+  char *text = read_file(path, errmsg);
+  if (!text) return -1;
+  for (char *line = text; *line;) {
+    char *nl = strchr(line, '\n');
+    if (nl) *nl = '\0';
+    ReplayEntry e;
+    const char *p = NULL;
+    char *body = NULL;
+    if (parse_line(line, &e) && !e.malformed && e.response) p = e.response;
+    if (p && (body = json_parse_string(&p))) {
+      RecordView r = { e.key, e.ok, body, strlen(body), 0 };
+      fn(user, &r);
+      free(body);
+    } else if (*json_skip_ws(line)) {
+      (*skipped)++;
+    }
+    if (!nl) break;
+    line = nl + 1;
+  }
+  free(text);
+  return 0;
+}
+
+typedef struct {
+  RecordingStats *st;
+  KeyTable keys;
+  size_t covers; // binary: data the index covers (0: no index)
+} StatsScan;
+
+static void count_record(void *user, const RecordView *r) {
+  StatsScan *scan = (StatsScan *)user;
+  ReplayEntry e = {0};
+  memcpy(e.key, r->key, 32);
+  scan->st->records++;
+  scan->st->distinct += (size_t)table_put(&scan->keys, &e);
+  if (!r->ok) scan->st->failures++;
+  scan->st->answer_bytes += r->len;
+  if (r->offset && r->offset >= scan->covers) scan->st->unindexed++;
+}
+
+int recordings_stats(const char *path, RecordingStats *st, char **errmsg) {
+  memset(st, 0, sizeof(*st));
+  StatsScan scan = { st, { NULL, 0, 0 }, 0 };
+  struct stat fs;
+  if (stat(path, &fs) == 0) st->file_bytes = (size_t)fs.st_size;
+  st->binary = recording_is_binary(path);
+  size_t data_len;
+  const uint8_t *data = st->binary ? map_file(path, &data_len) : NULL;
+  if (data) {
+    size_t len;
+    const uint8_t *index = map_index(path, data, data_len, &len, &scan.covers);
+    if (index) {
+      st->indexed = 1;
+      munmap((void *)index, len);
+    }
+    munmap((void *)data, data_len);
+  }
+  int rc = each_record(path, count_record, &scan, &st->skipped, errmsg);
+  free(scan.keys.entries);
+  return rc;
+}
+
+typedef struct {
+  FILE *f;
+  size_t at;
+  KeyTable keys;     // where each key's first record went
+  int keep_repeats;  // 0: only a key's first record is written
+  uint8_t first[32]; // keys of the first and last record written
+  uint8_t last[32];
+  size_t last_at;
+} BinaryOut;
+
+static void write_record(void *user, const RecordView *r) {
+  BinaryOut *out = (BinaryOut *)user;
+  ReplayEntry e = {0};
+  memcpy(e.key, r->key, 32);
+  e.offset = out->at;
+  if (!table_put(&out->keys, &e) && !out->keep_repeats) return;
+  uint8_t head[RECORD_HEADER] = {0};
+  memcpy(head, r->key, 32);
+  put_u32(head + 32, (uint32_t)r->len);
+  head[36] = r->ok ? 1 : 0;
+  fwrite(head, 1, sizeof(head), out->f);
+  fwrite(r->body, 1, r->len, out->f);
+  if (!out->last_at) memcpy(out->first, r->key, 32);
+  memcpy(out->last, r->key, 32);
+  out->last_at = out->at;
+  out->at += RECORD_HEADER + r->len;
+}
+
+// Lays the keys out afresh in the fewest slots that keep probes short
+static int write_index(const char *path, const BinaryOut *out) {
+  const KeyTable *keys = &out->keys;
+  KeyTable t = { NULL, 1, 0 };
+  while (t.cap < keys->len * 2) t.cap *= 2;
+  t.entries = (ReplayEntry *)calloc(t.cap, sizeof(ReplayEntry));
+  for (size_t i = 0; i < keys->cap; ++i) if (keys->entries[i].used) table_put(&t, &keys->entries[i]);
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    free(t.entries);
+    return -1;
+  }
+  uint8_t head[INDEX_HEADER];
+  memcpy(head, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  put_u64(head + 8, out->at);
+  put_u64(head + 16, t.cap);
+  put_u64(head + 24, t.len);
+  put_u64(head + 32, out->last_at);
+  memcpy(head + 40, out->first, 32);
+  memcpy(head + 72, out->last, 32);
+  fwrite(head, 1, sizeof(head), f);
+  for (size_t i = 0; i < t.cap; ++i) {
+    uint8_t slot[INDEX_SLOT] = {0};
+    if (t.entries[i].used) {
+      memcpy(slot, t.entries[i].key, 32);
+      put_u64(slot + 32, t.entries[i].offset);
+    }
+    fwrite(slot, 1, sizeof(slot), f);
+  }
+  free(t.entries);
+  int failed = ferror(f);
+  return fclose(f) != 0 || failed ? -1 : 0;
+}
+
+static char *suffixed(const char *path, const char *suffix) {
+  size_t n = strlen(path) + strlen(suffix) + 1;
+  char *p = (char *)malloc(n);
+  snprintf(p, n, "%s%s", path, suffix);
+  return p;
+}
+
+// Writes from's records as a binary recording and its index next to each
+// other under temporary names, then moves them over path. The old index
+// goes first, so a reader never pairs the new data with it.
+static int write_binary(const char *path, const char *from, int keep_repeats, char **errmsg) {
+  char *tmp = suffixed(path, ".tmp"), *idx = index_path(path), *idx_tmp = suffixed(idx, ".tmp");
+  BinaryOut out = { fopen(tmp, "wb"), sizeof(DATA_MAGIC), { NULL, 0, 0 }, keep_repeats, {0}, {0}, 0 };
+  int rc = -1;
+  size_t skipped;
+  if (!out.f) {
+    *errmsg = path_error("recordings", tmp);
+  } else {
+    fwrite(DATA_MAGIC, 1, sizeof(DATA_MAGIC), out.f);
+    rc = each_record(from, write_record, &out, &skipped, errmsg);
+    int failed = ferror(out.f);
+    if (fclose(out.f) != 0 || failed) {
+      if (rc == 0) *errmsg = path_error("recordings", tmp);
+      rc = -1;
+    }
+    if (rc == 0 && write_index(idx_tmp, &out) != 0) {
+      *errmsg = path_error("recordings", idx_tmp);
+      rc = -1;
+    }
+    if (rc == 0) {
+      unlink(idx);
+      if (rename(tmp, path) != 0 || rename(idx_tmp, idx) != 0) {
+        *errmsg = path_error("recordings", path);
+        rc = -1;
+      }
+    }
+    if (rc != 0) {
+      unlink(tmp);
+      unlink(idx_tmp);
+    }
+  }
+  free(out.keys.entries);
+  free(tmp);
+  free(idx);
+  free(idx_tmp);
+  return rc;
+}
+
+static void write_line(void *user, const RecordView *r) {
+  char hex[65];
+  sha256_hex(r->key, hex);
+  size_t len = 0;
+  char *line = jsonl_record(hex, NULL, r->body, r->len, r->ok, &len);
+  if (line) fwrite(line, 1, len, (FILE *)user);
+  free(line);
+}
+
+int recordings_convert(const char *in, const char *out, char **errmsg) {
+  if (strcmp(in, out) == 0) {
+    *errmsg = strdup("convert: input and output are the same file");
+    return -1;
+  }
+  if (!recording_is_binary(in)) return write_binary(out, in, 1, errmsg);
+  char *tmp = suffixed(out, ".tmp");
+  FILE *f = fopen(tmp, "w");
+  if (!f) {
+    *errmsg = path_error("recordings", tmp);
+    free(tmp);
+    return -1;
+  }
+  size_t skipped;
+  int rc = each_record(in, write_line, f, &skipped, errmsg);
+  int failed = ferror(f);
+  if ((fclose(f) != 0 || failed) && rc == 0) {
+    *errmsg = path_error("recordings", tmp);
+    rc = -1;
+  }
+  if (rc == 0 && rename(tmp, out) != 0) {
+    *errmsg = path_error("recordings", out);
+    rc = -1;
+  }
+  if (rc != 0) unlink(tmp);
+  free(tmp);
+  return rc;
+}
+
+int recordings_compact(const char *path, char **errmsg) {
+  if (!recording_is_binary(path)) {
+    if (access(path, R_OK) != 0) *errmsg = path_error("recordings", path);
+    else *errmsg = suffixed(path, " is not a binary recording; convert it first");
+    return -1;
+  }
+  return write_binary(path, path, 0, errmsg);
+}
@@ -5,8 +5,9 @@
 #include <stdlib.h>
 #include <string.h>
 
-static size_t g_allocs = 0;
-static size_t g_frees = 0;
+// Counters are per thread so concurrent runs never share mutable state.
+static _Thread_local size_t g_allocs = 0;
+static _Thread_local size_t g_frees = 0;
 
 void runtime_reset_counters(void) { g_allocs = 0; g_frees = 0; }
 size_t runtime_alloc_count(void) { return g_allocs; }
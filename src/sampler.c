@@ -0,0 +1,160 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/sampler.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+static volatile sig_atomic_t ticks;
+static volatile sig_atomic_t owned;
+static struct sigaction previous;
+
+static void on_sigprof(int sig){
+  (void)sig;
+  ticks++;
+}
+
+Sampler *sampler_new(const IrProgram *prog){
+  Sampler *s = calloc(1, sizeof(Sampler));
+  s->prog = prog;
+  s->stack_cap = 64;
+  s->stack = malloc(s->stack_cap * sizeof(SampleFrame));
+  s->ticks = &ticks;
+  s->seen = ticks;
+  s->cap = 256;
+  s->stacks = calloc(s->cap, sizeof(SampleStack));
+  return s;
+}
+
+void sampler_free(Sampler *s){
+  if (!s) return;
+  if (s->running) sampler_stop(s);
+  for (size_t i = 0; i < s->cap; i++) free(s->stacks[i].funcs);
+  free(s->stacks);
+  free(s->stack);
+  free(s);
+}
+
+int sampler_start(Sampler *s, long hz, char **errmsg){
+  if (hz <= 0 || hz > 1000000) { if (errmsg) *errmsg = strdup("sample rate must be 1-1000000 Hz"); return 0; }
+  if (owned) { if (errmsg) *errmsg = strdup("another sampler is running"); return 0; }
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = on_sigprof;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  if (sigaction(SIGPROF, &sa, &previous) != 0) { if (errmsg) *errmsg = strdup(strerror(errno)); return 0; }
+  struct itimerval it;
+  it.it_interval.tv_sec = hz == 1 ? 1 : 0;
+  it.it_interval.tv_usec = hz == 1 ? 0 : 1000000 / hz;
+  it.it_value = it.it_interval;
+  if (setitimer(ITIMER_PROF, &it, NULL) != 0) {
+    if (errmsg) *errmsg = strdup(strerror(errno));
+    sigaction(SIGPROF, &previous, NULL);
+    return 0;
+  }
+  owned = 1;
+  s->running = 1;
+  s->seen = ticks;
+  return 1;
+}
+
+void sampler_stop(Sampler *s){
+  if (!s->running) return;
+  struct itimerval off;
+  memset(&off, 0, sizeof(off));
+  setitimer(ITIMER_PROF, &off, NULL);
+  sigaction(SIGPROF, &previous, NULL);
+  owned = 0;
+  s->running = 0;
+}
+
+void sampler_enter(Sampler *s, const IrFunc *f){
+  if (s->depth == s->stack_cap) {
+    s->stack_cap *= 2;
+    s->stack = realloc(s->stack, s->stack_cap * sizeof(SampleFrame));
+  }
+  s->stack[s->depth++] = (SampleFrame){ (uint32_t)(f - s->prog->funcs.items), 0 };
+}
+
+// The leaf is its source line when known, so instructions of one line merge
+static uint32_t leaf_key(const SampleFrame *frames, size_t depth, uint32_t line){
+  return line ? line | 0x80000000u : frames[depth - 1].ip;
+}
+
+static uint64_t hash_stack(const SampleFrame *frames, size_t depth, uint32_t line){
+  uint64_t h = 1469598103934665603ull;
+  for (size_t i = 0; i < depth; i++) h = (h ^ frames[i].func) * 1099511628211ull;
+  return (h ^ leaf_key(frames, depth, line)) * 1099511628211ull;
+}
+
+static int same_stack(const SampleStack *st, const SampleFrame *frames, size_t depth, uint32_t line){
+  if (st->depth != depth || st->line != line || (!line && st->ip != frames[depth - 1].ip)) return 0;
+  for (size_t i = 0; i < depth; i++) if (st->funcs[i] != frames[i].func) return 0;
+  return 1;
+}
+
+static SampleStack *slot_for(SampleStack *stacks, size_t cap, uint64_t hash, const SampleFrame *frames, size_t depth, uint32_t line){
+  size_t i = (size_t)hash & (cap - 1);
+  while (stacks[i].funcs && (stacks[i].hash != hash || (frames && !same_stack(&stacks[i], frames, depth, line))))
+    i = (i + 1) & (cap - 1);
+  return &stacks[i];
+}
+
+static void grow(Sampler *s){
+  size_t cap = s->cap * 2;
+  SampleStack *stacks = calloc(cap, sizeof(SampleStack));
+  for (size_t i = 0; i < s->cap; i++)
+    if (s->stacks[i].funcs) *slot_for(stacks, cap, s->stacks[i].hash, NULL, 0, 0) = s->stacks[i];
+  free(s->stacks);
+  s->stacks = stacks;
+  s->cap = cap;
+}
+
+// Every tick since the last poll counts against the current stack, so an
+// instruction that ran for several periods gets all of them
+void sampler_take(Sampler *s){
+  sig_atomic_t now = *s->ticks;
+  uint64_t weight = (uint64_t)(unsigned)(now - s->seen);
+  s->seen = now;
+  if (!s->depth || !weight) return;
+  if ((s->used + 1) * 2 > s->cap) grow(s);
+  const SampleFrame *top = &s->stack[s->depth - 1];
+  LiminalSpan sp = ir_func_span_at(&s->prog->funcs.items[top->func], top->ip);
+  uint32_t line = sp.line > 0 ? (uint32_t)sp.line : 0;
+  uint64_t h = hash_stack(s->stack, s->depth, line);
+  SampleStack *st = slot_for(s->stacks, s->cap, h, s->stack, s->depth, line);
+  if (!st->funcs) {
+    st->hash = h;
+    st->depth = (uint32_t)s->depth;
+    st->ip = top->ip;
+    st->line = line;
+    st->funcs = malloc(s->depth * sizeof(uint32_t));
+    for (size_t i = 0; i < s->depth; i++) st->funcs[i] = s->stack[i].func;
+    s->used++;
+  }
+  st->count += weight;
+  s->samples += weight;
+}
+
+static int by_count(const void *a, const void *b){
+  const SampleStack *x = *(const SampleStack *const *)a, *y = *(const SampleStack *const *)b;
+  if (x->count != y->count) return x->count < y->count ? 1 : -1;
+  return x->hash < y->hash ? -1 : x->hash > y->hash;
+}
+
+void sampler_write_folded(const Sampler *s, FILE *out){
+  const SampleStack **order = malloc((s->used ? s->used : 1) * sizeof(SampleStack *));
+  size_t n = 0;
+  for (size_t i = 0; i < s->cap; i++) if (s->stacks[i].funcs) order[n++] = &s->stacks[i];
+  qsort(order, n, sizeof(SampleStack *), by_count);
+  for (size_t i = 0; i < n; i++) {
+    const SampleStack *st = order[i];
+    for (uint32_t d = 0; d < st->depth; d++) fprintf(out, "%s;", s->prog->funcs.items[st->funcs[d]].name);
+    const IrFunc *leaf = &s->prog->funcs.items[st->funcs[st->depth - 1]];
+    if (st->line) fprintf(out, "%s:%u %llu\n", s->source ? s->source : "", st->line, (unsigned long long)st->count);
+    else fprintf(out, "%s@%u %llu\n", ir_op_name(leaf->instrs.items[st->ip].op), st->ip, (unsigned long long)st->count);
+  }
+  free(order);
+}
@@ -35,7 +35,7 @@ static void sha256_transform(SHA256_CTX *ctx, const uint8_t data[]) {
     uint32_t a,b,c,d,e,f,g,h,i,j,t1,t2,m[64];
 
     for (i=0,j=0; i < 16; ++i, j += 4)
-        m[i] = (data[j] << 24) | (data[j+1] << 16) | (data[j+2] << 8) | (data[j+3]);
+        m[i] = ((uint32_t)data[j] << 24) | ((uint32_t)data[j+1] << 16) | ((uint32_t)data[j+2] << 8) | ((uint32_t)data[j+3]);
     for ( ; i < 64; ++i)
         m[i] = SIG1(m[i-2]) + m[i-7] + SIG0(m[i-15]) + m[i-16];
 
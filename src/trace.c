@@ -0,0 +1,150 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/trace.h"
+#include "liminal/profiler.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_FLUSH 65536
+
+static void flush(Tracer *t){
+  if (t->len && fwrite(t->buf, 1, t->len, t->out) != t->len) t->failed = 1;
+  t->len = 0;
+}
+
+static void reserve(Tracer *t, size_t n){
+  if (t->len + n <= t->cap) return;
+  flush(t);
+  if (n > t->cap) {
+    t->cap = n;
+    t->buf = realloc(t->buf, t->cap);
+  }
+}
+
+static void put(Tracer *t, const char *fmt, ...){
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(t->buf + t->len, t->cap - t->len, fmt, ap);
+  va_end(ap);
+  if (n < 0) return;
+  if ((size_t)n >= t->cap - t->len) {
+    reserve(t, (size_t)n + 1);
+    va_start(ap, fmt);
+    vsnprintf(t->buf + t->len, t->cap - t->len, fmt, ap);
+    va_end(ap);
+  }
+  t->len += (size_t)n;
+}
+
+static void put_string(Tracer *t, const char *s){
+  reserve(t, strlen(s) * 6 + 3);
+  t->buf[t->len++] = '"';
+  for (; *s; s++) {
+    unsigned char c = (unsigned char)*s;
+    if (c == '"' || c == '\\') { t->buf[t->len++] = '\\'; t->buf[t->len++] = (char)c; }
+    else if (c < 0x20) t->len += (size_t)snprintf(t->buf + t->len, 7, "\\u%04x", c);
+    else t->buf[t->len++] = (char)c;
+  }
+  t->buf[t->len++] = '"';
+}
+
+// Opens an event up to its args object; the caller adds args and closes it
+static void begin_event(Tracer *t, const char *name, const char *cat, uint64_t start_ns, uint64_t end_ns){
+  put(t, "%s{\"name\":", t->events ? ",\n" : "\n");
+  put_string(t, name);
+  put(t, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1,\"args\":{",
+      cat, (double)(start_ns - t->start_ns) / 1e3, (double)(end_ns - start_ns) / 1e3);
+  t->events++;
+}
+
+static void end_event(Tracer *t){
+  put(t, "}}");
+  if (t->len >= TRACE_FLUSH) flush(t);
+}
+
+Tracer *tracer_open(const char *path, uint64_t min_ns, char **errmsg){
+  FILE *out = fopen(path, "w");
+  if (!out) { if (errmsg) *errmsg = strdup(strerror(errno)); return NULL; }
+  Tracer *t = calloc(1, sizeof(Tracer));
+  t->out = out;
+  t->cap = TRACE_FLUSH * 2;
+  t->buf = malloc(t->cap);
+  t->min_ns = min_ns;
+  t->stack_cap = 64;
+  t->stack = malloc(t->stack_cap * sizeof(TraceFrame));
+  t->start_ns = profiler_now_ns();
+  put(t, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  return t;
+}
+
+int tracer_close(Tracer *t){
+  if (!t) return 1;
+  put(t, "\n]}\n");
+  flush(t);
+  if (fclose(t->out) != 0) t->failed = 1;
+  int ok = !t->failed;
+  free(t->buf);
+  free(t->stack);
+  free(t);
+  return ok;
+}
+
+void tracer_span(Tracer *t, const char *name, const char *cat, uint64_t start_ns){
+  begin_event(t, name, cat, start_ns, profiler_now_ns());
+  end_event(t);
+}
+
+void tracer_enter(Tracer *t, const IrFunc *f){
+  if (t->depth == t->stack_cap) {
+    t->stack_cap *= 2;
+    t->stack = realloc(t->stack, t->stack_cap * sizeof(TraceFrame));
+  }
+  t->stack[t->depth++] = (TraceFrame){ f, profiler_now_ns(), 0, -1, 0 };
+}
+
+void tracer_exit(Tracer *t){
+  TraceFrame fr = t->stack[--t->depth];
+  uint64_t now = profiler_now_ns();
+  if (now - fr.start_ns < t->min_ns) return;
+  begin_event(t, fr.func->name, "call", fr.start_ns, now);
+  LiminalSpan sp = ir_func_span_at(fr.func, 0);
+  if (sp.line > 0) {
+    char loc[512];
+    snprintf(loc, sizeof(loc), "%s:%d", t->source ? t->source : "", sp.line);
+    put(t, "\"source\":");
+    put_string(t, loc);
+  }
+  end_event(t);
+}
+
+// A consult asks again from the same instruction with one attempt fewer
+// left; anything else starts over at attempt 1
+static int consult_attempt(Tracer *t, size_t ip, long left){
+  if (!t->depth) return 1;
+  TraceFrame *fr = &t->stack[t->depth - 1];
+  if (fr->consult_left >= 0 && fr->consult_ip == ip && left < fr->consult_left) fr->consult_attempt++;
+  else fr->consult_attempt = 1;
+  fr->consult_ip = ip;
+  fr->consult_left = left;
+  return fr->consult_attempt;
+}
+
+void tracer_ask(Tracer *t, uint64_t start_ns, size_t ip, const char *oracle, const char *prompt,
+                const OracleResult *r, long left){
+  uint64_t now = profiler_now_ns();
+  int attempt = left >= 0 ? consult_attempt(t, ip, left) : 0;
+  begin_event(t, left < 0 ? "ask" : attempt > 1 ? "consult retry" : "consult", "oracle", start_ns, now);
+  char *canon = oracle_canonicalize_prompt(prompt);
+  char hash[65];
+  oracle_hash_prompt(canon, hash);
+  free(canon);
+  put(t, "\"oracle\":");
+  put_string(t, oracle);
+  put(t, ",\"prompt_hash\":\"%s\",\"prompt_bytes\":%zu,\"ok\":%s,\"response_bytes\":%zu",
+      hash, strlen(prompt), r->ok ? "true" : "false", r->text ? strlen(r->text) : (size_t)0);
+  if (attempt) put(t, ",\"attempt\":%d", attempt);
+  if (!r->ok && r->error) { put(t, ",\"error\":"); put_string(t, r->error); }
+  end_event(t);
+}
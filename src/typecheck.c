@@ -1,22 +1,28 @@
 #define _POSIX_C_SOURCE 200809L
 #include "liminal/typecheck.h"
+#include "liminal/alloc.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 
-static ASTNode *tc_prog = NULL;
+// Per-call checker state; keeps typecheck_program reentrant.
+typedef struct {
+  TypeCheckResult *res;
+  ASTNode *prog;
+  int debug;
+} TcState;
 
-static char *string_to_cstr_local(String s){ if (!s.data) return strdup(""); return strndup(s.data, s.len); }
+static char *string_to_cstr_local(String s){ if (!s.data) return lm_strdup(""); return lm_strndup(s.data, s.len); }
 
 static void add_error(TypeCheckResult *res, LiminalSpan span, const char *msg) {
   if (res->errors.len == res->errors.cap) {
     res->errors.cap = res->errors.cap ? res->errors.cap * 2 : 4;
-    res->errors.items = realloc(res->errors.items, res->errors.cap * sizeof(TypeCheckError));
+    res->errors.items = lm_realloc(res->errors.items, res->errors.cap * sizeof(TypeCheckError));
   }
   res->errors.items[res->errors.len].span = span;
-  res->errors.items[res->errors.len].message = strdup(msg);
+  res->errors.items[res->errors.len].message = lm_strdup(msg);
   res->errors.len++;
   res->ok = 0;
 }
@@ -60,7 +66,7 @@ static Type *type_from_ast(Symtab *st, ASTType *ty) {
     if (ty->as.constrained_type.base.data) {
       char *cname = string_to_cstr_local(ty->as.constrained_type.base);
       Type *base = resolve_type_ident(st, cname);
-      free(cname);
+      lm_free(cname);
       return base ? base : type_primitive(TYPEK_UNKNOWN);
     }
     return type_primitive(TYPEK_UNKNOWN);
@@ -83,7 +89,7 @@ static Type *type_from_ast(Symtab *st, ASTType *ty) {
     {
       char *cname = string_to_cstr_local(ty->as.ident.name);
       Type *resolved = resolve_type_ident(st, cname);
-      free(cname);
+      lm_free(cname);
       return resolved ? resolved : type_primitive(TYPEK_UNKNOWN);
     }
   case TYPE_ARRAY:
@@ -123,54 +129,54 @@ static Type *type_of_literal(TokenKind kind) {
 }
 
 
-static Type *typecheck_expr(Symtab *st, TypeCheckResult *res, ASTExpr *e) {
+static Type *typecheck_expr(Symtab *st, TcState *tc, ASTExpr *e) {
   if (!e) return type_primitive(TYPEK_UNKNOWN);
   switch (e->kind) {
   case EXPR_LITERAL:
     return type_of_literal(e->as.literal.literal_kind);
   case EXPR_IDENT: {
     if (!e->as.ident.name.data) {
-      add_error(res, e->span, "Undeclared identifier <null>");
+      add_error(tc->res, e->span, "Undeclared identifier <null>");
       return type_primitive(TYPEK_UNKNOWN);
     }
     char *cname = string_to_cstr_local(e->as.ident.name);
     Symbol *sym = symtab_lookup(st, cname);
-    free(cname);
+    lm_free(cname);
     if (!sym) {
       if (strncasecmp(e->as.ident.name.data, "Nothing", e->as.ident.name.len) == 0) {
         return type_optional(type_primitive(TYPEK_UNKNOWN));
       }
       char buf[128]; snprintf(buf, sizeof(buf), "Undeclared identifier %s", e->as.ident.name.data);
-      add_error(res, e->span, buf);
+      add_error(tc->res, e->span, buf);
       return type_primitive(TYPEK_UNKNOWN);
     }
     return sym->type;
   }
   case EXPR_UNARY: {
-    Type *t = typecheck_expr(st, res, e->as.unary.expr);
+    Type *t = typecheck_expr(st, tc, e->as.unary.expr);
     return t;
   }
   case EXPR_BINARY: {
-    Type *lt = typecheck_expr(st, res, e->as.binary.lhs);
-    Type *rt = typecheck_expr(st, res, e->as.binary.rhs);
-    if (getenv("LIMINAL_DEBUG_TC")) {
+    Type *lt = typecheck_expr(st, tc, e->as.binary.lhs);
+    Type *rt = typecheck_expr(st, tc, e->as.binary.rhs);
+    if (tc->debug) {
       char *ls = type_to_string(lt); char *rs = type_to_string(rt);
       fprintf(stderr, "[tc] binop %d : %s , %s\n", e->as.binary.op, ls, rs);
-      free(ls); free(rs);
+      lm_free(ls); lm_free(rs);
     }
     switch (e->as.binary.op) {
     case TK_PLUS:
       if (lt->kind == TYPEK_STRING && (rt->kind == TYPEK_STRING || rt->kind == TYPEK_CHAR)) return type_primitive(TYPEK_STRING);
       if (rt->kind == TYPEK_STRING && (lt->kind == TYPEK_STRING || lt->kind == TYPEK_CHAR)) return type_primitive(TYPEK_STRING);
       if ((lt->kind != TYPEK_INT && lt->kind != TYPEK_REAL) || (rt->kind != TYPEK_INT && rt->kind != TYPEK_REAL)) {
-        add_error(res, e->span, "Arithmetic on non-numeric");
+        add_error(tc->res, e->span, "Arithmetic on non-numeric");
         return type_primitive(TYPEK_UNKNOWN);
       }
       if (lt->kind == TYPEK_REAL || rt->kind == TYPEK_REAL) return type_primitive(TYPEK_REAL);
       return type_primitive(TYPEK_INT);
     case TK_MINUS: case TK_STAR: case TK_SLASH: case TK_DIV: case TK_MOD:
       if ((lt->kind != TYPEK_INT && lt->kind != TYPEK_REAL) || (rt->kind != TYPEK_INT && rt->kind != TYPEK_REAL)) {
-        add_error(res, e->span, "Arithmetic on non-numeric");
+        add_error(tc->res, e->span, "Arithmetic on non-numeric");
         return type_primitive(TYPEK_UNKNOWN);
       }
       if (lt->kind == TYPEK_REAL || rt->kind == TYPEK_REAL) return type_primitive(TYPEK_REAL);
@@ -196,35 +202,35 @@ static Type *typecheck_expr(Symtab *st, TypeCheckResult *res, ASTExpr *e) {
           return type_primitive(TYPEK_STRING);
         }
         if (name.data && strncasecmp(name.data, "Ok", name.len)==0 && e->as.call.args.len==1) {
-          Type *argt = typecheck_expr(st, res, e->as.call.args.items[0]);
+          Type *argt = typecheck_expr(st, tc, e->as.call.args.items[0]);
           Type *tr = type_result(argt, type_primitive(TYPEK_STRING));
-          typevec_push(&res->temp_types, tr);
+          typevec_push(&tc->res->temp_types, tr);
           return tr;
         }
         if (name.data && strncasecmp(name.data, "Err", name.len)==0 && e->as.call.args.len==1) {
           Type *tr = type_result(type_primitive(TYPEK_UNKNOWN), type_primitive(TYPEK_STRING));
-          typevec_push(&res->temp_types, tr);
+          typevec_push(&tc->res->temp_types, tr);
           return tr;
         }
         char *cname = string_to_cstr_local(name);
         Symbol *fsym = symtab_lookup(st, cname);
-        free(cname);
+        lm_free(cname);
         if (fsym) return fsym->type;
-        if (tc_prog) {
-          if (getenv("LIMINAL_DEBUG_TC")) fprintf(stderr,"[tc] fallback functions len=%zu\n", tc_prog->as.program.functions.len);
-          for (size_t fi=0; fi<tc_prog->as.program.functions.len; ++fi) {
-            ASTNode *fn = tc_prog->as.program.functions.items[fi];
+        if (tc->prog) {
+          if (tc->debug) fprintf(stderr,"[tc] fallback functions len=%zu\n", tc->prog->as.program.functions.len);
+          for (size_t fi=0; fi<tc->prog->as.program.functions.len; ++fi) {
+            ASTNode *fn = tc->prog->as.program.functions.items[fi];
             if (fn->as.func_decl.name.data && name.data && strcasecmp(fn->as.func_decl.name.data, name.data)==0) {
-              if (getenv("LIMINAL_DEBUG_TC")) fprintf(stderr,"[tc] fallback fn match %.*s\n", (int)name.len, name.data);
+              if (tc->debug) fprintf(stderr,"[tc] fallback fn match %.*s\n", (int)name.len, name.data);
               if (fn->as.func_decl.result_type) {
                 Type *ft = type_from_ast(st, fn->as.func_decl.result_type);
-                typevec_push(&res->temp_types, ft);
+                typevec_push(&tc->res->temp_types, ft);
                 return ft;
               }
             }
           }
         }
-        if (getenv("LIMINAL_DEBUG_TC")) {
+        if (tc->debug) {
           fprintf(stderr,"[tc] call lookup failed: %.*s\n", (int)name.len, name.data);
         }
       }
@@ -233,17 +239,17 @@ static Type *typecheck_expr(Symtab *st, TypeCheckResult *res, ASTExpr *e) {
   case EXPR_INDEX:
     // array indexing returns element type
     if (e->as.index.base) {
-      Type *bt = typecheck_expr(st, res, e->as.index.base);
+      Type *bt = typecheck_expr(st, tc, e->as.index.base);
       if (bt->kind == TYPEK_ARRAY) return bt->as.array.elem;
     }
     return type_primitive(TYPEK_UNKNOWN);
   case EXPR_TUPLE: {
     TypeVec vec = {0};
     for (size_t i = 0; i < e->as.tuple.elements.len; ++i) {
-      typevec_push(&vec, typecheck_expr(st, res, e->as.tuple.elements.items[i]));
+      typevec_push(&vec, typecheck_expr(st, tc, e->as.tuple.elements.items[i]));
     }
     Type *tt = type_tuple(vec);
-    typevec_push(&res->temp_types, tt);
+    typevec_push(&tc->res->temp_types, tt);
     return tt;
   }
   case EXPR_ARRAY: {
@@ -251,34 +257,34 @@ static Type *typecheck_expr(Symtab *st, TypeCheckResult *res, ASTExpr *e) {
     Type *elem = NULL;
     for (size_t i = 0; i < e->as.array.elements.len; ++i) {
       ASTExpr *el = e->as.array.elements.items[i];
-      if (getenv("LIMINAL_DEBUG_TC")) { fprintf(stderr, "[tc] array elem kind=%d\n", el->kind); }
-      Type *t = typecheck_expr(st, res, el);
-      if (getenv("LIMINAL_DEBUG_TC")) { char *ts = type_to_string(t); fprintf(stderr, "[tc] array elem %zu: %s\n", i, ts); free(ts); }
+      if (tc->debug) { fprintf(stderr, "[tc] array elem kind=%d\n", el->kind); }
+      Type *t = typecheck_expr(st, tc, el);
+      if (tc->debug) { char *ts = type_to_string(t); fprintf(stderr, "[tc] array elem %zu: %s\n", i, ts); lm_free(ts); }
       if (!elem) elem = t;
-      else if (!type_equals(elem, t)) add_error(res, e->span, "Array elements must be same type");
+      else if (!type_equals(elem, t)) add_error(tc->res, e->span, "Array elements must be same type");
     }
     if (!elem) elem = type_primitive(TYPEK_UNKNOWN);
     Type *arr = type_array(elem);
-    if (getenv("LIMINAL_DEBUG_TC")) { char *es = type_to_string(elem); char *as = type_to_string(arr); fprintf(stderr, "[tc] array elem type: %s arr: %s\n", es, as); free(es); free(as);} 
-    typevec_push(&res->temp_types, arr);
+    if (tc->debug) { char *es = type_to_string(elem); char *as = type_to_string(arr); fprintf(stderr, "[tc] array elem type: %s arr: %s\n", es, as); lm_free(es); lm_free(as);} 
+    typevec_push(&tc->res->temp_types, arr);
     return arr;
   }
   case EXPR_RECORD: {
     // record literals: build anonymous record type
     Type *rec = type_schema(NULL);
-    for (size_t i=0;i<e->as.record.fields.len;++i){ ASTField *f=&e->as.record.fields.items[i]; Type *ft=typecheck_expr(st,res,f->value); schema_add_field(rec, f->key.data, ft);} 
+    for (size_t i=0;i<e->as.record.fields.len;++i){ ASTField *f=&e->as.record.fields.items[i]; Type *ft=typecheck_expr(st,tc,f->value); schema_add_field(rec, f->key.data, ft);} 
     rec->kind = TYPEK_RECORD;
-    typevec_push(&res->temp_types, rec);
+    typevec_push(&tc->res->temp_types, rec);
     return rec;
   }
   case EXPR_FIELD: {
-    Type *bt = typecheck_expr(st, res, e->as.field.base);
-    if (getenv("LIMINAL_DEBUG_TC")) { char *bs = type_to_string(bt); fprintf(stderr, "[tc] field base type=%s\n", bs); free(bs);} 
+    Type *bt = typecheck_expr(st, tc, e->as.field.base);
+    if (tc->debug) { char *bs = type_to_string(bt); fprintf(stderr, "[tc] field base type=%s\n", bs); lm_free(bs);} 
     if (bt && (bt->kind==TYPEK_SCHEMA || bt->kind==TYPEK_RECORD)){
       char key[128]; snprintf(key,sizeof(key),"%.*s", (int)e->as.field.field.len, e->as.field.field.data);
-      if (getenv("LIMINAL_DEBUG_TC")) fprintf(stderr,"[tc] field lookup %s\n", key);
+      if (tc->debug) fprintf(stderr,"[tc] field lookup %s\n", key);
       SchemaField *sf = schema_find_field(bt, key);
-      if (getenv("LIMINAL_DEBUG_TC")) fprintf(stderr,"[tc] field found? %p\n", (void*)sf);
+      if (tc->debug) fprintf(stderr,"[tc] field found? %p\n", (void*)sf);
       if (sf) return sf->type;
     }
     return type_primitive(TYPEK_UNKNOWN);
@@ -291,8 +297,8 @@ static Type *typecheck_expr(Symtab *st, TypeCheckResult *res, ASTExpr *e) {
     return type_primitive(TYPEK_STRING);
   case EXPR_CONCAT:
     // string concatenation
-    typecheck_expr(st, res, e->as.concat.lhs);
-    typecheck_expr(st, res, e->as.concat.rhs);
+    typecheck_expr(st, tc, e->as.concat.lhs);
+    typecheck_expr(st, tc, e->as.concat.rhs);
     return type_primitive(TYPEK_STRING);
   case EXPR_EMBED:
     return type_primitive(TYPEK_BYTES);
@@ -303,12 +309,12 @@ static Type *typecheck_expr(Symtab *st, TypeCheckResult *res, ASTExpr *e) {
   }
 }
 
-static void typecheck_stmt(Symtab *st, TypeCheckResult *res, ASTStmt *s) {
+static void typecheck_stmt(Symtab *st, TcState *tc, ASTStmt *s) {
   if (!s) return;
   switch (s->kind) {
   case STMT_ASSIGN: {
-    Type *lt = typecheck_expr(st, res, s->as.assign.target);
-    Type *rt = typecheck_expr(st, res, s->as.assign.value);
+    Type *lt = typecheck_expr(st, tc, s->as.assign.target);
+    Type *rt = typecheck_expr(st, tc, s->as.assign.value);
     if (!type_equals(lt, rt)) {
       int ok = 0;
       if (lt && lt->kind == TYPEK_STRING && rt && rt->kind == TYPEK_CHAR) {
@@ -334,27 +340,27 @@ static void typecheck_stmt(Symtab *st, TypeCheckResult *res, ASTStmt *s) {
         char *ls = type_to_string(lt);
         char *rs = type_to_string(rt);
         char buf[256]; snprintf(buf, sizeof(buf), "Type mismatch: %s := %s", ls, rs);
-        add_error(res, s->span, buf);
-        free(ls); free(rs);
+        add_error(tc->res, s->span, buf);
+        lm_free(ls); lm_free(rs);
       }
     }
     break;
   }
   case STMT_EXPR:
-    typecheck_expr(st, res, s->as.expr_stmt.expr);
+    typecheck_expr(st, tc, s->as.expr_stmt.expr);
     break;
   case STMT_IF:
-    typecheck_expr(st, res, s->as.if_stmt.cond);
-    typecheck_stmt(st, res, s->as.if_stmt.then_branch);
-    typecheck_stmt(st, res, s->as.if_stmt.else_branch);
+    typecheck_expr(st, tc, s->as.if_stmt.cond);
+    typecheck_stmt(st, tc, s->as.if_stmt.then_branch);
+    typecheck_stmt(st, tc, s->as.if_stmt.else_branch);
     break;
   case STMT_WHILE:
-    typecheck_expr(st, res, s->as.while_stmt.cond);
-    typecheck_stmt(st, res, s->as.while_stmt.body);
+    typecheck_expr(st, tc, s->as.while_stmt.cond);
+    typecheck_stmt(st, tc, s->as.while_stmt.body);
     break;
   case STMT_REPEAT:
-    typecheck_stmt(st, res, s->as.repeat_stmt.body);
-    typecheck_expr(st, res, s->as.repeat_stmt.cond);
+    typecheck_stmt(st, tc, s->as.repeat_stmt.body);
+    typecheck_expr(st, tc, s->as.repeat_stmt.cond);
     break;
   case STMT_FOR: {
     // ensure loop var exists; if not, define int
@@ -362,19 +368,30 @@ static void typecheck_stmt(Symtab *st, TypeCheckResult *res, ASTStmt *s) {
     if (!sym) {
       symtab_define(st, SYM_VAR, s->as.for_stmt.var.name.data, type_primitive(TYPEK_INT));
     }
-    typecheck_expr(st, res, s->as.for_stmt.init);
-    typecheck_expr(st, res, s->as.for_stmt.to);
-    typecheck_stmt(st, res, s->as.for_stmt.body);
+    typecheck_expr(st, tc, s->as.for_stmt.init);
+    typecheck_expr(st, tc, s->as.for_stmt.to);
+    typecheck_stmt(st, tc, s->as.for_stmt.body);
     break; }
   case STMT_FOR_IN: {
     Symbol *sym = symtab_lookup(st, s->as.for_in_stmt.var.name.data);
     if (!sym) symtab_define(st, SYM_VAR, s->as.for_in_stmt.var.name.data, type_primitive(TYPEK_INT));
-    typecheck_expr(st, res, s->as.for_in_stmt.iterable);
-    typecheck_stmt(st, res, s->as.for_in_stmt.body);
+    typecheck_expr(st, tc, s->as.for_in_stmt.iterable);
+    typecheck_stmt(st, tc, s->as.for_in_stmt.body);
     break; }
+  case STMT_STREAM:
+    // The chunk variable is a String scoped to the body
+    typecheck_expr(st, tc, s->as.stream_stmt.prompt);
+    symtab_push(st);
+    symtab_define(st, SYM_VAR, s->as.stream_stmt.chunk.name.data, type_primitive(TYPEK_STRING));
+    typecheck_stmt(st, tc, s->as.stream_stmt.body);
+    symtab_pop(st);
+    break;
+  case STMT_PARALLEL:
+    for (size_t i = 0; i < s->as.parallel_stmt.body.len; ++i) typecheck_stmt(st, tc, s->as.parallel_stmt.body.items[i]);
+    break;
   case STMT_BLOCK:
     symtab_push(st);
-    for (size_t i = 0; i < s->as.block.stmts.len; ++i) typecheck_stmt(st, res, s->as.block.stmts.items[i]);
+    for (size_t i = 0; i < s->as.block.stmts.len; ++i) typecheck_stmt(st, tc, s->as.block.stmts.items[i]);
     symtab_pop(st);
     break;
   default:
@@ -389,7 +406,7 @@ static void define_types(Symtab *st, ASTNode *prog, TypeVec *owned_types) {
     Type *ty = type_from_ast(st, td->as.type_decl.type);
     char *cname = string_to_cstr_local(td->as.type_decl.name);
     symtab_define(st, SYM_TYPE, cname, ty);
-    free(cname);
+    lm_free(cname);
     if (ty && ty->kind==TYPEK_ENUM) {
       for (size_t fi=0; fi<ty->as.schema.len; ++fi) {
         SchemaField *sf=&ty->as.schema.items[fi]; symtab_define(st, SYM_VAR, sf->name, type_primitive(TYPEK_INT));
@@ -405,7 +422,7 @@ static void define_globals(Symtab *st, ASTNode *prog, TypeVec *owned_types) {
     Type *ty = type_from_ast(st, vd->as.var_decl.type);
     char *cname = string_to_cstr_local(vd->as.var_decl.name);
     symtab_define(st, SYM_VAR, cname, ty);
-    free(cname);
+    lm_free(cname);
     if (owned_types) {
       int dup = 0;
       for (size_t oi=0; oi<owned_types->len; ++oi) if (owned_types->items[oi]==ty) { dup=1; break; }
@@ -425,7 +442,7 @@ static void define_functions(Symtab *st, ASTNode *prog, TypeVec *owned_types) {
     if (fn->as.func_decl.result_type) fty = type_from_ast(st, fn->as.func_decl.result_type);
     char *cname = string_to_cstr_local(fn->as.func_decl.name);
     symtab_define(st, SYM_FUNC, cname, fty);
-    free(cname);
+    lm_free(cname);
     if (owned_types && fty) {
       int dup = 0;
       for (size_t oi=0; oi<owned_types->len; ++oi) if (owned_types->items[oi]==fty) { dup=1; break; }
@@ -435,11 +452,19 @@ static void define_functions(Symtab *st, ASTNode *prog, TypeVec *owned_types) {
 }
 
 TypeCheckResult typecheck_program(ASTNode *prog) {
+  const char *dbg = getenv("LIMINAL_DEBUG_TC");
+  LiminalContext ctx = {0};
+  ctx.debug_tc = dbg && *dbg;
+  return typecheck_program_ctx(prog, &ctx);
+}
+
+TypeCheckResult typecheck_program_ctx(ASTNode *prog, const LiminalContext *ctx) {
   TypeCheckResult res = {.ok = 1, .errors = {0}, .temp_types = {0}, .owned_types = {0} };
-  tc_prog = prog;
+  TcState tc = {.res = &res, .prog = prog, .debug = ctx ? ctx->debug_tc : 0};
   Symtab *st = symtab_create();
-  if (getenv("LIMINAL_DEBUG_TC")) fprintf(stderr,"[tc] functions len=%zu\n", prog->as.program.functions.len);
-  if (getenv("LIMINAL_DEBUG_TC")) fprintf(stderr,"[tc] types len=%zu\n", prog->as.program.types.len);
+  st->debug = tc.debug;
+  if (tc.debug) fprintf(stderr,"[tc] functions len=%zu\n", prog->as.program.functions.len);
+  if (tc.debug) fprintf(stderr,"[tc] types len=%zu\n", prog->as.program.types.len);
   define_types(st, prog, &res.owned_types);
   define_globals(st, prog, &res.owned_types);
   define_functions(st, prog, &res.owned_types);
@@ -448,16 +473,16 @@ TypeCheckResult typecheck_program(ASTNode *prog) {
     ASTNode *vd = prog->as.program.vars.items[i];
     if (vd->as.var_decl.init) {
       Type *decl = type_from_ast(st, vd->as.var_decl.type);
-      Type *init = typecheck_expr(st, &res, vd->as.var_decl.init);
+      Type *init = typecheck_expr(st, &tc, vd->as.var_decl.init);
       if (!type_equals(decl, init)) {
         char *ds = type_to_string(decl); char *is = type_to_string(init);
         char buf[256]; snprintf(buf, sizeof(buf), "Type mismatch in var init: %s := %s", ds, is);
         add_error(&res, vd->span, buf);
-        free(ds); free(is);
+        lm_free(ds); lm_free(is);
       }
     }
   }
-  typecheck_stmt(st, &res, prog->as.program.body);
+  typecheck_stmt(st, &tc, prog->as.program.body);
   // functions
   for (size_t i = 0; i < prog->as.program.functions.len; ++i) {
     symtab_push(st);
@@ -484,7 +509,7 @@ TypeCheckResult typecheck_program(ASTNode *prog) {
         typevec_push(&res.temp_types, lty);
       }
     }
-    typecheck_stmt(st, &res, fn->as.func_decl.body);
+    typecheck_stmt(st, &tc, fn->as.func_decl.body);
     symtab_pop(st);
   }
   symtab_destroy(st);
@@ -495,17 +520,17 @@ static void type_free_temp(Type *t) {
   if (!t) return;
   switch (t->kind) {
   case TYPEK_ARRAY:
-    free(t);
+    lm_free(t);
     break;
   case TYPEK_TUPLE:
-    free(t->as.tuple.items);
-    free(t);
+    lm_free(t->as.tuple.items);
+    lm_free(t);
     break;
   case TYPEK_OPTIONAL:
-    free(t);
+    lm_free(t);
     break;
   case TYPEK_RESULT:
-    free(t);
+    lm_free(t);
     break;
   default:
     type_free(t);
@@ -514,12 +539,12 @@ static void type_free_temp(Type *t) {
 }
 
 void typecheck_result_free(TypeCheckResult *res) {
-  for (size_t i = 0; i < res->errors.len; ++i) free(res->errors.items[i].message);
-  free(res->errors.items);
+  for (size_t i = 0; i < res->errors.len; ++i) lm_free(res->errors.items[i].message);
+  lm_free(res->errors.items);
   for (size_t i = 0; i < res->temp_types.len; ++i) {
     if (!typevec_contains(&res->owned_types, res->temp_types.items[i])) type_free_temp(res->temp_types.items[i]);
   }
-  free(res->temp_types.items);
+  lm_free(res->temp_types.items);
   for (size_t i = 0; i < res->owned_types.len; ++i) type_free(res->owned_types.items[i]);
-  free(res->owned_types.items);
+  lm_free(res->owned_types.items);
 }
@@ -1,11 +1,12 @@
 #define _POSIX_C_SOURCE 200809L
 #include "liminal/types.h"
+#include "liminal/alloc.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static void *xmalloc(size_t n) { void *p = malloc(n); if (!p) { fprintf(stderr,"OOM\n"); exit(1);} memset(p,0,n); return p; }
+static void *xmalloc(size_t n) { void *p = lm_malloc(n); if (!p) { fprintf(stderr,"OOM\n"); exit(1);} memset(p,0,n); return p; }
 
 static Type singleton_int = {.kind = TYPEK_INT};
 static Type singleton_real = {.kind = TYPEK_REAL};
@@ -65,7 +66,7 @@ Type *type_result(Type *ok, Type *err) {
 Type *type_alias(const char *name, Type *target) {
   Type *t = xmalloc(sizeof(Type));
   t->kind = TYPEK_ALIAS;
-  t->as.alias.name = strdup(name);
+  t->as.alias.name = lm_strdup(name);
   t->as.alias.target = target;
   return t;
 }
@@ -73,7 +74,7 @@ Type *type_alias(const char *name, Type *target) {
 Type *type_schema(const char *name) {
   Type *t = xmalloc(sizeof(Type));
   t->kind = TYPEK_SCHEMA;
-  t->as.schema.name = name ? strdup(name) : NULL;
+  t->as.schema.name = name ? lm_strdup(name) : NULL;
   t->as.schema.items = NULL;
   t->as.schema.len = 0;
   t->as.schema.cap = 0;
@@ -87,11 +88,11 @@ void schema_add_field(Type *schema_type, const char *name, Type *field_type) {
   size_t cap = schema_type->as.schema.cap;
   if (len == cap) {
     cap = cap ? cap * 2 : 4;
-    fields = realloc(fields, cap * sizeof(SchemaField));
+    fields = lm_realloc(fields, cap * sizeof(SchemaField));
     schema_type->as.schema.items = fields;
     schema_type->as.schema.cap = cap;
   }
-  fields[len].name = strdup(name);
+  fields[len].name = lm_strdup(name);
   fields[len].type = field_type;
   schema_type->as.schema.len = len + 1;
 }
@@ -104,16 +105,14 @@ int typevec_contains(TypeVec *vec, Type *t) {
 void typevec_push(TypeVec *vec, Type *t) {
   if (vec->len == vec->cap) {
     vec->cap = vec->cap ? vec->cap * 2 : 4;
-    vec->items = realloc(vec->items, vec->cap * sizeof(Type *));
+    vec->items = lm_realloc(vec->items, vec->cap * sizeof(Type *));
   }
   vec->items[vec->len++] = t;
 }
 
 SchemaField *schema_find_field(Type *schema_type, const char *name) {
   if (!schema_type || (schema_type->kind != TYPEK_SCHEMA && schema_type->kind != TYPEK_RECORD && schema_type->kind != TYPEK_ENUM)) return NULL;
-  if (getenv("LIMINAL_DEBUG_TC")) fprintf(stderr,"[tc] schema_find_field kind=%d len=%zu lookup=%s\n", schema_type->kind, schema_type->as.schema.len, name);
   for (size_t i = 0; i < schema_type->as.schema.len; ++i) {
-    if (getenv("LIMINAL_DEBUG_TC")) fprintf(stderr,"[tc] field[%zu]=%s\n", i, schema_type->as.schema.items[i].name);
     if (strcmp(schema_type->as.schema.items[i].name, name) == 0) return &schema_type->as.schema.items[i];
   }
   return NULL;
@@ -180,52 +179,52 @@ const char *typekind_name(TypeKindSem k) {
 }
 
 char *type_to_string(const Type *t) {
-  if (!t) return strdup("<null>");
-  if (t->kind == TYPEK_ALIAS && t->as.alias.name) return strdup(t->as.alias.name);
+  if (!t) return lm_strdup("<null>");
+  if (t->kind == TYPEK_ALIAS && t->as.alias.name) return lm_strdup(t->as.alias.name);
   const char *base = typekind_name(t->kind);
   if (t->kind == TYPEK_OPTIONAL) {
     char *inner = type_to_string(t->as.optional.inner);
     size_t n = strlen(inner) + 2;
-    char *buf = malloc(n);
+    char *buf = lm_malloc(n);
     snprintf(buf, n, "?%s", inner);
-    free(inner);
+    lm_free(inner);
     return buf;
   }
   if (t->kind == TYPEK_RESULT) {
     char *ok = type_to_string(t->as.result.ok);
     size_t n = strlen(ok) + 2;
-    char *buf = malloc(n);
+    char *buf = lm_malloc(n);
     snprintf(buf, n, "!%s", ok);
-    free(ok);
+    lm_free(ok);
     return buf;
   }
   if (t->kind == TYPEK_ARRAY) {
     char *elem = type_to_string(t->as.array.elem);
     size_t n = strlen(elem) + 8;
-    char *buf = malloc(n);
+    char *buf = lm_malloc(n);
     snprintf(buf, n, "array(%s)", elem);
-    free(elem);
+    lm_free(elem);
     return buf;
   }
   if (t->kind == TYPEK_TUPLE) {
     // emit tuple<a,b>
-    size_t cap = 64; char *buf = malloc(cap); buf[0] = '\0';
+    size_t cap = 64; char *buf = lm_malloc(cap); buf[0] = '\0';
     strcat(buf, "tuple<");
     for (size_t i = 0; i < t->as.tuple.len; ++i) {
       char *s = type_to_string(t->as.tuple.items[i]);
       size_t need = strlen(buf) + strlen(s) + 4;
-      if (need > cap) { cap = need * 2; buf = realloc(buf, cap); }
+      if (need > cap) { cap = need * 2; buf = lm_realloc(buf, cap); }
       strcat(buf, s);
-      free(s);
+      lm_free(s);
       if (i + 1 < t->as.tuple.len) strcat(buf, ",");
     }
     strcat(buf, ">" );
     return buf;
   }
   if (t->kind == TYPEK_SCHEMA) {
-    return strdup("Schema");
+    return lm_strdup("Schema");
   }
-  return strdup(base);
+  return lm_strdup(base);
 }
 
 void type_free(Type *t) {
@@ -240,10 +239,10 @@ void type_free(Type *t) {
     break;
   case TYPEK_TUPLE:
     for (size_t i = 0; i < t->as.tuple.len; ++i) type_free(t->as.tuple.items[i]);
-    free(t->as.tuple.items);
+    lm_free(t->as.tuple.items);
     break;
   case TYPEK_ALIAS:
-    free(t->as.alias.name);
+    lm_free(t->as.alias.name);
     // target not owned
     break;
   case TYPEK_OPTIONAL:
@@ -255,15 +254,15 @@ void type_free(Type *t) {
   case TYPEK_SCHEMA:
   case TYPEK_RECORD:
   case TYPEK_ENUM:
-    if (t->as.schema.name) free(t->as.schema.name);
+    if (t->as.schema.name) lm_free(t->as.schema.name);
     for (size_t i = 0; i < t->as.schema.len; ++i) {
-      if (t->as.schema.items[i].name) free(t->as.schema.items[i].name);
+      if (t->as.schema.items[i].name) lm_free(t->as.schema.items[i].name);
       // field types not owned
     }
-    free(t->as.schema.items);
+    lm_free(t->as.schema.items);
     break;
   default:
     break;
   }
-  free(t);
+  lm_free(t);
 }
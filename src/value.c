@@ -0,0 +1,317 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/value.h"
+#include "liminal/alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+Value v_string(LiminalContext *ctx, const char *s){ Value v={0}; v.kind=VSTRING; v.s=lm_strdup(s?s:"" ); v.owns=1; ctx->allocs++; return v; }
+Value v_result_ok(LiminalContext *ctx, const char *text){ Value v={0}; v.kind=VRESULT; v.res.ok=1; v.res.text=lm_strdup(text?text:""); v.owns=1; ctx->allocs++; return v; }
+Value v_result_err(LiminalContext *ctx, const char *err){ Value v={0}; v.kind=VRESULT; v.res.ok=0; v.res.error=lm_strdup(err?err:""); v.owns=1; ctx->allocs++; return v; }
+Value v_optional_some(LiminalContext *ctx, Value inner){ Value v={0}; v.kind=VOPTIONAL; v.opt.is_some=1; v.opt.inner=lm_malloc(sizeof(Value)); *v.opt.inner = v_copy(ctx, inner); return v; }
+Value v_copy(LiminalContext *ctx, Value v){
+  Value out = v;
+  if (v.kind==VSTRING) { out = v_string(ctx, v.s); }
+  else if (v.kind==VRESULT) { if (v.res.ok) out = v_result_ok(ctx, v.res.text); else out = v_result_err(ctx, v.res.error);}
+  else if (v.kind==VOPTIONAL) { if (v.opt.is_some && v.opt.inner) out = v_optional_some(ctx, *v.opt.inner); else out = v_optional_none(); }
+  else if (v.kind==VBOOL) out = v_bool(v.i);
+  if (v.ref) {
+    out.ref = lm_strdup(v.ref);
+    out.ref_interned = 0;
+    ctx->allocs++;
+  } else {
+    out.ref = NULL;
+    out.ref_interned = 0;
+  }
+  return out;
+}
+void v_free(LiminalContext *ctx, Value v){ if (v.ref && !v.ref_interned) { lm_free(v.ref); ctx->frees++; } if (v.kind==VSTRING){ if (v.owns && v.s) { lm_free(v.s); ctx->frees++; } } else if (v.kind==VRESULT){ if (v.res.text){ lm_free(v.res.text); ctx->frees++; } if (v.res.error){ lm_free(v.res.error); ctx->frees++; } } else if (v.kind==VOPTIONAL){ if (v.opt.inner){ v_free(ctx, *v.opt.inner); lm_free(v.opt.inner);} } }
+static void out_str(LiminalContext *ctx, const char *s){ liminal_context_write(ctx, s, strlen(s)); }
+void print_value(LiminalContext *ctx, Value v){
+  char buf[64];
+  switch(v.kind){
+  case VINT: snprintf(buf, sizeof(buf), "%d", v.i); out_str(ctx, buf); break;
+  case VBOOL: out_str(ctx, v.i?"True":"False"); break;
+  case VREAL: snprintf(buf, sizeof(buf), "%g", v.f); out_str(ctx, buf); break;
+  case VSTRING: out_str(ctx, v.s?v.s:"" ); break;
+  case VRESULT:
+    out_str(ctx, v.res.ok ? "Ok(" : "Err(");
+    out_str(ctx, v.res.ok ? (v.res.text ? v.res.text : "") : (v.res.error ? v.res.error : ""));
+    out_str(ctx, ")");
+    break;
+  case VOPTIONAL:
+    if (v.opt.is_some && v.opt.inner) print_value(ctx, *v.opt.inner);
+    else out_str(ctx, "Nothing");
+    break;
+  }
+}
+
+static int is_number(const char *s){ if(!s||!*s) return 0; size_t i=0; if(s[0]=='-'||s[0]=='+') i++; int hasdigit=0; for(;s[i];i++){ if(s[i]>='0'&&s[i]<='9'){hasdigit=1;continue;} if(s[i]=='.') continue; return 0;} return hasdigit; }
+static int is_integer(const char *s){ if(!s||!*s) return 0; size_t i=0; if(s[0]=='-'||s[0]=='+') i++; int hasdigit=0; for(;s[i];i++){ if(s[i]>='0'&&s[i]<='9'){hasdigit=1;continue;} return 0;} return hasdigit; }
+Value parse_value(LiminalContext *ctx, const char *s){ if(is_integer(s)) return v_int(atoi(s)); if(is_number(s)) return v_real(strtod(s,NULL)); return v_string(ctx, s); }
+
+static char *env_intern_ref(LiminalContext *ctx, Env *env, const char *s){
+  if (!env || !s) return NULL;
+  for(size_t i=0;i<env->refs_len;i++) if (strcmp(env->refs[i], s)==0) return env->refs[i];
+  if (env->refs_len==env->refs_cap){ env->refs_cap = env->refs_cap? env->refs_cap*2:8; env->refs=lm_realloc(env->refs, env->refs_cap*sizeof(char*)); }
+  char *dup = lm_strdup(s); ctx->allocs++; env->refs[env->refs_len++] = dup; return dup;
+}
+Value* env_find(Env *env, const char *name){ for(size_t i=0;i<env->len;i++){ if(strcmp(env->items[i].name,name)==0) return &env->items[i].val;} return NULL; }
+static void env_set_raw(LiminalContext *ctx, Env *env, const char *name, Value vc){
+  for(size_t i=0;i<env->len;i++){ if(strcmp(env->items[i].name,name)==0){ v_free(ctx, env->items[i].val); env->items[i].val=vc; return; }}
+  if(env->len==env->cap){ env->cap=env->cap?env->cap*2:8; env->items=lm_realloc(env->items, env->cap*sizeof(Var)); }
+  env->items[env->len].name=lm_strdup(name); env->items[env->len].val=vc; env->len++;
+}
+static void env_ensure_base_ref(LiminalContext *ctx, Env *env, const char *name){
+  const char *dot = strchr(name, '.');
+  if (!dot) return;
+  char base[128]; size_t blen = (size_t)(dot - name); if (blen >= sizeof(base)) blen = sizeof(base)-1; strncpy(base, name, blen); base[blen]=0;
+  Value *bv = env_find(env, base);
+  if (!bv) {
+    Value v = v_int(0);
+    v.ref = env_intern_ref(ctx, env, base);
+    v.ref_interned = 1;
+    env_set_raw(ctx, env, base, v);
+  } else if (!bv->ref) {
+    bv->ref = env_intern_ref(ctx, env, base);
+    bv->ref_interned = 1;
+  }
+}
+// The copy env_set stores: owned strings, dotted refs interned in env
+static Value env_stored_copy(LiminalContext *ctx, Env *env, Value v){
+  Value vc = v_copy(ctx, v);
+  if (v.kind==VSTRING && vc.s && !vc.owns) { vc.s = lm_strdup(vc.s); vc.owns=1; ctx->allocs++; }
+  if (vc.ref && strchr(vc.ref, '.')) {
+    if (!vc.ref_interned) { lm_free(vc.ref); ctx->frees++; }
+    vc.ref = env_intern_ref(ctx, env, v.ref);
+    vc.ref_interned = 1;
+  }
+  return vc;
+}
+void env_set(LiminalContext *ctx, Env *env, const char *name, Value v){
+  if (ctx->debug_exec) fprintf(stderr,"[env_set] %s kind=%d i=%d ref=%s\n", name, v.kind, v.i, v.ref?v.ref:"<null>");
+  Value vc = env_stored_copy(ctx, env, v);
+  env_ensure_base_ref(ctx, env, name);
+  env_set_raw(ctx, env, name, vc);
+}
+static Value env_get_local(LiminalContext *ctx, Env *env, const char *name){ Value *v = env_find(env,name); if (ctx->debug_exec) fprintf(stderr,"[env_get_local] %s -> %s%s\n", name, v?"hit":"miss", v?"":""); if (v && ctx->debug_exec) fprintf(stderr,"  val kind=%d i=%d ref=%s\n", v->kind, v->i, v->ref?v->ref:"<null>"); if (!v) return v_int(0); return v_copy(ctx, *v); }
+Value env_get(LiminalContext *ctx, Env *env, const char *name){
+  Value *vloc = env_find(env, name);
+  if (vloc) return v_copy(ctx, *vloc);
+  const char *dot = strchr(name, '.');
+  if (dot) {
+    // base name before dot
+    char base[128]; size_t blen = (size_t)(dot - name); if (blen >= sizeof(base)) blen = sizeof(base)-1; strncpy(base, name, blen); base[blen]=0;
+    Value basev = env_get_local(ctx, env, base);
+    if (ctx->debug_exec) fprintf(stderr,"[env_get] base=%s ref=%s\n", base, basev.ref?basev.ref:"<null>");
+    if (basev.ref) {
+      char buf[256]; snprintf(buf,sizeof(buf),"%s%s", basev.ref, dot);
+      Value lv2 = env_get_local(ctx, env, buf);
+      if (!(lv2.kind==VINT && lv2.i==0)) { v_free(ctx, basev); return lv2; }
+      v_free(ctx, lv2);
+      if (env->parent) {
+        Value pv2 = env_get(ctx, env->parent, buf);
+        if (!(pv2.kind==VINT && pv2.i==0)) { v_free(ctx, basev); return pv2; }
+        v_free(ctx, pv2);
+      }
+    }
+    v_free(ctx, basev);
+  }
+  if (env->parent) {
+    Value pv = env_get(ctx, env->parent, name);
+    if (env_find(env->parent, name)) return pv;
+    v_free(ctx, pv);
+    if (dot) {
+      char base[128]; size_t blen = (size_t)(dot - name); if (blen >= sizeof(base)) blen = sizeof(base)-1; strncpy(base, name, blen); base[blen]=0;
+      Value basev = env_get_local(ctx, env, base);
+      if (basev.ref) {
+        char buf[256]; snprintf(buf,sizeof(buf),"%s%s", basev.ref, dot);
+        Value pv2 = env_get(ctx, env->parent, buf);
+        if (env_find(env->parent, buf)) { v_free(ctx, basev); return pv2; }
+        v_free(ctx, pv2);
+      }
+      v_free(ctx, basev);
+      for(size_t i=0;i<env->parent->len;i++){
+        const char *pname = env->parent->items[i].name;
+        const char *pdot = strchr(pname, '.');
+        if (!pdot) continue;
+        if (strcmp(pdot, dot)==0) return v_copy(ctx, env->parent->items[i].val);
+      }
+    }
+  }
+  // also suffix fallback in local env
+  if (dot) {
+    for(size_t i=0;i<env->len;i++){
+      const char *pname = env->items[i].name;
+      const char *pdot = strchr(pname, '.');
+      if (!pdot) continue;
+      if (strcmp(pdot, dot)==0) { Value rv=v_copy(ctx, env->items[i].val); if (ctx->debug_exec) fprintf(stderr,"[env_get suffix local] %s -> %s\n", name, pname); return rv; }
+    }
+  }
+  if (ctx->debug_exec) fprintf(stderr,"[env_get] %s -> miss\n", name);
+  return v_int(0);
+}
+void env_free(LiminalContext *ctx, Env *env){ if (ctx->debug_exec) fprintf(stderr,"[env_free] len=%zu\n", env->len); for(size_t i=0;i<env->len;i++){ if (ctx->debug_exec) fprintf(stderr,"[env_free] %s\n", env->items[i].name); lm_free(env->items[i].name); v_free(ctx, env->items[i].val);} lm_free(env->items); for(size_t i=0;i<env->refs_len;i++){ lm_free(env->refs[i]); ctx->frees++; } lm_free(env->refs); }
+
+static Value *env_slot(Env *env, const char *name, long *slot){
+  if (*slot >= 0) return &env->items[*slot].val;
+  for(size_t i=0;i<env->len;i++){ if(strcmp(env->items[i].name,name)==0){ *slot=(long)i; return &env->items[i].val; } }
+  return NULL;
+}
+Value rt_peek_var(LiminalContext *ctx, Env *env, const char *name, long *slot, Value *scratch){
+  Value *v = env_slot(env, name, slot);
+  if (v) return *v;
+  v_free(ctx, *scratch); *scratch = env_get(ctx, env, name);
+  return *scratch;
+}
+void rt_store_var(LiminalContext *ctx, Env *env, const char *name, long *slot, Value v){
+  Value *dst = env_slot(env, name, slot);
+  if (!dst) { env_set(ctx, env, name, v); return; }
+  if (ctx->debug_exec) fprintf(stderr,"[env_set] %s kind=%d i=%d ref=%s\n", name, v.kind, v.i, v.ref?v.ref:"<null>");
+  Value vc = env_stored_copy(ctx, env, v);
+  v_free(ctx, *dst); *dst = vc;
+}
+
+void rt_load_var(LiminalContext *ctx, Env *env, Value *dst, const char *name){
+  Value v = env_get(ctx, env, name);
+  if (v.ref) { lm_free(v.ref); ctx->frees++; }
+  v.ref=lm_strdup(name); v.ref_interned=0; ctx->allocs++;
+  v_free(ctx, *dst); *dst = v;
+}
+
+void rt_arith_slow(LiminalContext *ctx, IrOp op, Value *dst, Value a, Value b){
+  Value out;
+  if (op==IR_ADD && (a.kind==VSTRING || b.kind==VSTRING)) {
+    char buf_a[64], buf_b[64];
+    const char *sa = (a.kind==VSTRING)? (a.s?a.s:"") : (snprintf(buf_a,sizeof(buf_a),"%g", (a.kind==VREAL)?a.f:(double)a.i), buf_a);
+    const char *sb = (b.kind==VSTRING)? (b.s?b.s:"") : (snprintf(buf_b,sizeof(buf_b),"%g", (b.kind==VREAL)?b.f:(double)b.i), buf_b);
+    size_t lena=strlen(sa), lenb=strlen(sb);
+    char *res=lm_malloc(lena+lenb+1); memcpy(res, sa, lena); memcpy(res+lena, sb, lenb); res[lena+lenb]='\0';
+    out=v_string(ctx, res); lm_free(res);
+  } else {
+    double da=(a.kind==VREAL)?a.f:a.i; double db=(b.kind==VREAL)?b.f:b.i;
+    double r=rt_num_arith(op, da, db);
+    int any_real = (a.kind==VREAL || b.kind==VREAL);
+    out = any_real ? v_real(r) : v_int((int)r);
+  }
+  v_free(ctx, *dst); *dst=out;
+}
+
+void rt_readln(LiminalContext *ctx, Env *env, const char *name){
+  // prompts written so far must be visible before blocking on input
+  liminal_context_flush(ctx);
+  char *line=NULL; size_t n=0; ssize_t r=getline(&line, &n, ctx->in);
+  if(r>0 && line[r-1]=='\n') line[r-1]='\0';
+  // at end of input getline may leave its buffer unterminated
+  if(r<0 && line) line[0]='\0';
+  Value v = parse_value(ctx, line?line:"" ); env_set(ctx, env, name, v); v_free(ctx, v); lm_free(line);
+}
+
+void rt_read_file(LiminalContext *ctx, Value *dst, Value pathv){
+  const char *path = (pathv.kind==VSTRING && pathv.s)?pathv.s:"";
+  Value out;
+  FILE *fpy = fopen(path, "rb");
+  char *buf = NULL;
+  if (fpy) {
+    fseek(fpy,0,SEEK_END); long len=ftell(fpy); rewind(fpy);
+    buf = lm_malloc(len+1);
+    if (buf) { size_t read_n = fread(buf,1,(size_t)len,fpy); buf[read_n]='\0'; }
+    fclose(fpy);
+  }
+  out = v_string(ctx, buf ? buf : ""); lm_free(buf);
+  v_free(ctx, *dst); *dst=out;
+}
+
+void rt_write_file(Value pathv, Value contentv){
+  const char *path = (pathv.kind==VSTRING && pathv.s)?pathv.s:"";
+  const char *content = (contentv.kind==VSTRING && contentv.s)?contentv.s:"";
+  FILE *fpy = fopen(path, "wb"); if(fpy){ fwrite(content,1,strlen(content),fpy); fclose(fpy);}
+}
+
+void rt_result_unwrap(LiminalContext *ctx, Value *dst, Value rv, const Value *fb){
+  Value out;
+  if (rv.kind == VRESULT) {
+    if (rv.res.ok) out = v_string(ctx, rv.res.text ? rv.res.text : "");
+    else if (fb && fb->kind==VSTRING) out = v_string(ctx, fb->s ? fb->s : "");
+    else out = v_string(ctx, "");
+  } else if (rv.kind == VSTRING) {
+    out = v_string(ctx, rv.s ? rv.s : "");
+  } else {
+    out = v_string(ctx, "");
+  }
+  v_free(ctx, *dst); *dst=out;
+}
+
+void rt_result_unwrap_err(LiminalContext *ctx, Value *dst, Value rv){
+  Value out = v_string(ctx, rv.kind==VRESULT && !rv.res.ok && rv.res.error ? rv.res.error : "");
+  v_free(ctx, *dst); *dst=out;
+}
+
+void rt_make_result(LiminalContext *ctx, Value *dst, Value rv, int ok){
+  char buf[64]; const char *s = NULL;
+  if (rv.kind==VSTRING) s = rv.s ? rv.s : "";
+  else if (rv.kind==VINT) { snprintf(buf,sizeof(buf), "%d", rv.i); s=buf; }
+  else if (rv.kind==VREAL) { snprintf(buf,sizeof(buf), "%g", rv.f); s=buf; }
+  else if (rv.kind==VBOOL) s = rv.i?"True":"False";
+  else s = "";
+  Value out = ok ? v_result_ok(ctx, s) : v_result_err(ctx, s);
+  v_free(ctx, *dst); *dst=out;
+}
+
+// Text of a CONCAT operand; buf backs numeric conversions
+static const char *concat_text(Value v, char *buf, size_t cap){
+  switch(v.kind){
+  case VSTRING: return v.s ? v.s : "";
+  case VINT: snprintf(buf,cap,"%d",v.i); return buf;
+  case VREAL: snprintf(buf,cap,"%g",v.f); return buf;
+  case VBOOL: return v.i?"True":"False";
+  case VRESULT: return v.res.ok && v.res.text ? v.res.text : (v.res.error ? v.res.error : "");
+  default: return "";
+  }
+}
+void rt_concat(LiminalContext *ctx, Value *dst, Value a, Value b){
+  char buf_a[64], buf_b[64];
+  const char *sa = concat_text(a, buf_a, sizeof(buf_a)), *sb = concat_text(b, buf_b, sizeof(buf_b));
+  size_t lena=strlen(sa), lenb=strlen(sb);
+  char *res = lm_malloc(lena+lenb+1);
+  memcpy(res, sa, lena); memcpy(res+lena, sb, lenb); res[lena+lenb]='\0';
+  Value out = v_string(ctx, res);
+  lm_free(res);
+  v_free(ctx, *dst); *dst=out;
+}
+
+void rt_result_or_fallback(LiminalContext *ctx, Value *dst, Value rv, const Value *fb){
+  Value out;
+  if (rv.kind == VRESULT) {
+    if (rv.res.ok) out = v_result_ok(ctx, rv.res.text ? rv.res.text : "");
+    else if (fb && fb->kind==VSTRING) out = v_result_ok(ctx, fb->s ? fb->s : "");
+    else out = v_result_err(ctx, rv.res.error ? rv.res.error : "");
+  } else if (rv.kind == VSTRING) {
+    out = v_result_ok(ctx, rv.s ? rv.s : "");
+  } else {
+    out = v_result_err(ctx, "invalid result");
+  }
+  v_free(ctx, *dst); *dst=out;
+}
+
+void rt_index(LiminalContext *ctx, Env *env, Value *dst, const char *base, Value idxv){
+  int idx = (idxv.kind==VREAL)?(int)idxv.f: idxv.i;
+  // fallback: env lookup base.idx
+  if (!base) { v_free(ctx, *dst); *dst=v_int(0); return; }
+  char buf[256]; snprintf(buf,sizeof(buf),"%s.%d", base, idx);
+  Value v = env_get(ctx, env, buf);
+  if (v.ref) { lm_free(v.ref); ctx->frees++; }
+  v.ref = lm_strdup(buf); v.ref_interned = 0; ctx->allocs++;
+  v_free(ctx, *dst); *dst=v;
+}
+
+void rt_finish(LiminalContext *ctx, Env *env, Value *ret_out, Value retval, int had_ret){
+  if (!ret_out) { v_free(ctx, retval); return; }
+  if (!had_ret) {
+    Value rv = env_get(ctx, env, "Result");
+    v_free(ctx, retval);
+    retval = rv;
+  }
+  *ret_out = retval;
+}
@@ -0,0 +1,99 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/workers.h"
+#include "liminal/alloc.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct WorkerPool {
+  pthread_t *threads;
+  size_t nthreads;
+  pthread_mutex_t lock;  // guards everything below
+  pthread_cond_t work;   // a batch started or the pool is closing
+  pthread_cond_t done;   // the last item of the batch finished
+  WorkFn fn;
+  void *arg;
+  size_t next;           // first item not handed out yet
+  size_t len;
+  size_t running;        // items handed out and not finished
+  unsigned long batch;   // bumped per batch, so a sleeping worker notices
+  AllocStats alloc;      // counted on the threads during the batch
+  int closing;
+};
+
+// Takes items of the current batch until none are left; called with lock
+// held and returns with it held
+static void drain(WorkerPool *p) {
+  while (p->next < p->len) {
+    size_t i = p->next++;
+    p->running++;
+    WorkFn fn = p->fn;
+    void *arg = p->arg;
+    pthread_mutex_unlock(&p->lock);
+    fn(arg, i);
+    pthread_mutex_lock(&p->lock);
+    if (--p->running == 0 && p->next == p->len) pthread_cond_broadcast(&p->done);
+  }
+}
+
+static void *worker(void *arg) {
+  WorkerPool *p = (WorkerPool *)arg;
+  unsigned long seen = 0;
+  pthread_mutex_lock(&p->lock);
+  for (;;) {
+    while (!p->closing && p->batch == seen) pthread_cond_wait(&p->work, &p->lock);
+    if (p->closing) break;
+    seen = p->batch;
+    AllocStats mark = alloc_mark();
+    drain(p);
+    alloc_add(&p->alloc, alloc_since(mark));
+  }
+  pthread_mutex_unlock(&p->lock);
+  return NULL;
+}
+
+WorkerPool *worker_pool_new(size_t size) {
+  WorkerPool *p = (WorkerPool *)calloc(1, sizeof(WorkerPool));
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->work, NULL);
+  pthread_cond_init(&p->done, NULL);
+  size_t want = size > 1 ? size - 1 : 0;
+  p->threads = want ? (pthread_t *)calloc(want, sizeof(pthread_t)) : NULL;
+  while (p->nthreads < want && pthread_create(&p->threads[p->nthreads], NULL, worker, p) == 0) p->nthreads++;
+  return p;
+}
+
+void worker_pool_run(WorkerPool *p, WorkFn fn, void *arg, size_t n) {
+  if (!n) return;
+  pthread_mutex_lock(&p->lock);
+  p->fn = fn;
+  p->arg = arg;
+  p->next = 0;
+  p->len = n;
+  p->batch++;
+  if (n > 1) pthread_cond_broadcast(&p->work);
+  drain(p);
+  while (p->running) pthread_cond_wait(&p->done, &p->lock);
+  p->len = p->next = 0;
+  alloc_merge(p->alloc);
+  memset(&p->alloc, 0, sizeof(p->alloc));
+  pthread_mutex_unlock(&p->lock);
+}
+
+size_t worker_pool_threads(const WorkerPool *p) {
+  return p->nthreads;
+}
+
+void worker_pool_free(WorkerPool *p) {
+  if (!p) return;
+  pthread_mutex_lock(&p->lock);
+  p->closing = 1;
+  pthread_cond_broadcast(&p->work);
+  pthread_mutex_unlock(&p->lock);
+  for (size_t i = 0; i < p->nthreads; ++i) pthread_join(p->threads[i], NULL);
+  free(p->threads);
+  pthread_mutex_destroy(&p->lock);
+  pthread_cond_destroy(&p->work);
+  pthread_cond_destroy(&p->done);
+  free(p);
+}
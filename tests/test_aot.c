@@ -0,0 +1,179 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/aot.h"
+#include "liminal/exec.h"
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Compiles deterministic examples with `liminal compile` and checks the
+// native binaries print exactly what the interpreter prints.
+
+static const char *INPUT = "3\n4\n";
+
+// File I/O (03_file_io, t26) and oracle programs are left out
+static const char *PROGRAMS[] = {
+  "examples/01_hello.lim",
+  "examples/02_add.lim",
+  "examples/opus/t01_hello.lim",
+  "examples/opus/t02_int_vars.lim",
+  "examples/opus/t03_int_arith.lim",
+  "examples/opus/t04_real_arith.lim",
+  "examples/opus/t05_booleans.lim",
+  "examples/opus/t06_strings.lim",
+  "examples/opus/t07_comparisons.lim",
+  "examples/opus/t08_if_else.lim",
+  "examples/opus/t09_if_chain.lim",
+  "examples/opus/t10_for_loop.lim",
+  "examples/opus/t11_while.lim",
+  "examples/opus/t12_repeat.lim",
+  "examples/opus/t13_function.lim",
+  "examples/opus/t14_func_params.lim",
+  "examples/opus/t15_recursion.lim",
+  "examples/opus/t16_record.lim",
+  "examples/opus/t17_array.lim",
+  "examples/opus/t18_enum.lim",
+  "examples/opus/t19_case_int.lim",
+  "examples/opus/t20_fstring.lim",
+  "examples/opus/t21_local_vars.lim",
+  "examples/opus/t22_begin_end.lim",
+  "examples/opus/t23_writeln.lim",
+  "examples/opus/t24_nested_calls.lim",
+  "examples/opus/t25_optional.lim",
+  "examples/opus/t27_record_patch.lim",
+  "examples/opus/c01_fibonacci.lim",
+  "examples/opus/c02_person_greet.lim",
+  "examples/opus/c03_traffic_light.lim",
+  "examples/opus/c04_array_ops.lim",
+  "examples/opus/c05_result_types.lim",
+  "examples/opus/c06_data_table.lim",
+  "examples/opus/c07_gcd_lcm.lim",
+  "examples/opus/c08_constraints.lim",
+  "examples/opus/c09_invoice_batch.lim",
+  "examples/opus/c10_shift_alerting.lim",
+};
+#define PROGRAM_COUNT (sizeof(PROGRAMS) / sizeof(PROGRAMS[0]))
+
+static char *read_stream(FILE *f) {
+  char *buf = NULL; size_t len = 0;
+  FILE *out = open_memstream(&buf, &len);
+  char chunk[4096]; size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) fwrite(chunk, 1, n, out);
+  fclose(out);
+  return buf;
+}
+
+static char *interpret(const char *path) {
+  char *buf = NULL; size_t len = 0;
+  FILE *in = fmemopen((void *)INPUT, strlen(INPUT), "r");
+  FILE *out = open_memstream(&buf, &len);
+  liminal_run_file_streams(path, in, out);
+  fclose(in);
+  fclose(out);
+  return buf;
+}
+
+static char *run_binary(const char *bin) {
+  char cmd[512]; snprintf(cmd, sizeof(cmd), "printf '3\\n4\\n' | '%s'", bin);
+  FILE *p = popen(cmd, "r");
+  if (!p) return NULL;
+  char *out = read_stream(p);
+  if (pclose(p) != 0) { free(out); return NULL; }
+  return out;
+}
+
+static IrProgram *load(const char *rel) {
+  char path[512]; snprintf(path, sizeof(path), "%s/%s", SOURCE_DIR, rel);
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  IrProgram *ir = liminal_load_program(&ctx, path);
+  liminal_context_free(&ctx);
+  return ir;
+}
+
+static void test_compiled_matches_interpreter(void) {
+  char dir[] = "/tmp/liminal_aot_XXXXXX";
+  ASSERT_TRUE(mkdtemp(dir) != NULL);
+  size_t mismatches = 0;
+  for (size_t i = 0; i < PROGRAM_COUNT; ++i) {
+    char path[512]; snprintf(path, sizeof(path), "%s/%s", SOURCE_DIR, PROGRAMS[i]);
+    char bin[512]; snprintf(bin, sizeof(bin), "%s/prog%zu", dir, i);
+    char *want = interpret(path);
+    char *got = liminal_compile_file(path, bin, 0, NULL) == 0 ? run_binary(bin) : NULL;
+    if (!got || strcmp(want, got) != 0) {
+      fprintf(stderr, "%s: compiled output differs\n", PROGRAMS[i]);
+      mismatches++;
+    }
+    unlink(bin);
+    free(want); free(got);
+  }
+  rmdir(dir);
+  ASSERT_TRUE(mismatches == 0);
+}
+
+static void test_typed_locals(void) {
+  IrProgram *ir = load("examples/opus/t29_bench_int_hotloop.lim");
+  ASSERT_TRUE(ir != NULL);
+  char *errmsg = NULL;
+  char *c = aot_emit_c(ir, "t29", &errmsg);
+  ASSERT_TRUE(c != NULL);
+  // Constants and the loop condition live in C ints; jumps are gotos
+  ASSERT_CONTAINS(c, "int i");
+  ASSERT_CONTAINS(c, "rt_peek_var(");
+  ASSERT_CONTAINS(c, "goto L");
+  free(c);
+  ir_program_free(ir);
+}
+
+static void test_direct_calls(void) {
+  IrProgram *ir = load("examples/opus/t30_bench_function_calls.lim");
+  ASSERT_TRUE(ir != NULL);
+  char *c = aot_emit_c(ir, "t30", NULL);
+  ASSERT_TRUE(c != NULL);
+  ASSERT_CONTAINS(c, "// func Mix\nstatic int f1(");
+  ASSERT_CONTAINS(c, "f1(ctx, &callee, &rv);");
+  free(c);
+  ir_program_free(ir);
+}
+
+static void test_rejects_oracle_calls(void) {
+  IrProgram *ir = load("examples/07_ask_into.lim");
+  ASSERT_TRUE(ir != NULL);
+  char *errmsg = NULL;
+  char *c = aot_emit_c(ir, "07_ask_into", &errmsg);
+  ASSERT_TRUE(c == NULL);
+  ASSERT_TRUE(errmsg != NULL);
+  ASSERT_CONTAINS(errmsg, "not supported in AOT mode");
+  free(errmsg);
+  ir_program_free(ir);
+}
+
+static void test_string_escapes(void) {
+  IrProgram *prog = ir_program_new();
+  IrFunc f = ir_func_create("Main");
+  int s = ir_emit_const_string(&f, "q\"b\\s?\?=\n\t");
+  ir_emit_print(&f, s, 1);
+  ir_program_add_func(prog, f);
+  char *c = aot_emit_c(prog, "escapes", NULL);
+  ASSERT_TRUE(c != NULL);
+  ASSERT_CONTAINS(c, "\"q\\\"b\\\\s\\?\\?=\\012\\011\"");
+  free(c);
+  ir_program_free(prog);
+}
+
+int main(void) {
+  run_test("compiled_matches_interpreter", test_compiled_matches_interpreter);
+  run_test("typed_locals", test_typed_locals);
+  run_test("direct_calls", test_direct_calls);
+  run_test("rejects_oracle_calls", test_rejects_oracle_calls);
+  run_test("string_escapes", test_string_escapes);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All aot tests passed (%d)\n", get_tests_run());
+  return 0;
+}
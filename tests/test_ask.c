@@ -7,11 +7,16 @@
 #include <stdlib.h>
 #include <string.h>
 
-static void run_fixture(const char *fixture, char **outbuf) {
+static void run_fixture(Oracle *o, const char *fixture, char **outbuf) {
   char path[256]; snprintf(path, sizeof(path), "%s/tests/fixtures/%s", SOURCE_DIR, fixture);
   size_t outlen = 0;
   FILE *out = open_memstream(outbuf, &outlen);
-  int rc = liminal_run_file_streams(path, NULL, out);
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  ctx.out = out;
+  liminal_context_set_oracle(&ctx, o, 0);
+  int rc = liminal_run_file_ctx(&ctx, path);
+  liminal_context_free(&ctx);
   fflush(out); fclose(out);
   ASSERT_TRUE(rc == 0);
 }
@@ -19,48 +24,40 @@ static void run_fixture(const char *fixture, char **outbuf) {
 static void test_ask_ok(void) {
   Oracle *o = oracle_create_mock();
   oracle_mock_queue(o, "hi", NULL);
-  exec_set_global_oracle(o);
   char *out = NULL;
-  run_fixture("ask_ok.lim", &out);
+  run_fixture(o, "ask_ok.lim", &out);
   ASSERT_EQ_STR("Ok(hi)\n", out);
   free(out);
-  exec_set_global_oracle(NULL);
   oracle_free(o);
 }
 
 static void test_ask_else(void) {
   Oracle *o = oracle_create_mock();
   oracle_mock_queue(o, NULL, "boom");
-  exec_set_global_oracle(o);
   char *out = NULL;
-  run_fixture("ask_else.lim", &out);
+  run_fixture(o, "ask_else.lim", &out);
   ASSERT_EQ_STR("Ok(fallback)\n", out);
   free(out);
-  exec_set_global_oracle(NULL);
   oracle_free(o);
 }
 
 static void test_ask_unwrapor(void) {
   Oracle *o = oracle_create_mock();
   oracle_mock_queue(o, NULL, "boom");
-  exec_set_global_oracle(o);
   char *out = NULL;
-  run_fixture("ask_unwrap.lim", &out);
+  run_fixture(o, "ask_unwrap.lim", &out);
   ASSERT_EQ_STR("fb\n", out);
   free(out);
-  exec_set_global_oracle(NULL);
   oracle_free(o);
 }
 
 static void test_ask_err(void) {
   Oracle *o = oracle_create_mock();
   oracle_mock_queue(o, NULL, "boom");
-  exec_set_global_oracle(o);
   char *out = NULL;
-  run_fixture("ask_err.lim", &out);
+  run_fixture(o, "ask_err.lim", &out);
   ASSERT_EQ_STR("Err(boom)\n", out);
   free(out);
-  exec_set_global_oracle(NULL);
   oracle_free(o);
 }
 
@@ -68,36 +65,30 @@ static void test_ask_chain(void) {
   Oracle *o = oracle_create_mock();
   oracle_mock_queue(o, NULL, "boom");
   oracle_mock_queue(o, "hi", NULL);
-  exec_set_global_oracle(o);
   char *out = NULL;
-  run_fixture("ask_chain.lim", &out);
+  run_fixture(o, "ask_chain.lim", &out);
   ASSERT_EQ_STR("Ok(hi)\n", out);
   free(out);
-  exec_set_global_oracle(NULL);
   oracle_free(o);
 }
 
 static void test_ask_into_valid(void) {
   Oracle *o = oracle_create_mock();
   oracle_mock_queue(o, "{\"Name\":\"Bob\",\"Age\":30}", NULL);
-  exec_set_global_oracle(o);
   char *out = NULL;
-  run_fixture("ask_into.lim", &out);
+  run_fixture(o, "ask_into.lim", &out);
   ASSERT_EQ_STR("Ok({\"Name\":\"Bob\",\"Age\":30})\n", out);
   free(out);
-  exec_set_global_oracle(NULL);
   oracle_free(o);
 }
 
 static void test_ask_into_invalid(void) {
   Oracle *o = oracle_create_mock();
   oracle_mock_queue(o, "{\"Name\":123,\"Age\":\"x\"}", NULL);
-  exec_set_global_oracle(o);
   char *out = NULL;
-  run_fixture("ask_into_invalid.lim", &out);
+  run_fixture(o, "ask_into_invalid.lim", &out);
   ASSERT_TRUE(strstr(out, "Err(extraction failed") != NULL || strstr(out, "Err(") != NULL);
   free(out);
-  exec_set_global_oracle(NULL);
   oracle_free(o);
 }
 
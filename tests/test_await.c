@@ -0,0 +1,259 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/exec.h"
+#include "liminal/oracles.h"
+#include "liminal/parser.h"
+#include "test_harness.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Asynchronous asks: where the lowering puts each AWAIT, and that the ask
+// runs while the program does the work before it.
+
+// The instructions' mnemonics, space separated
+static void op_names(const IrFunc *f, char *buf, size_t cap) {
+  size_t n = 0;
+  buf[0] = '\0';
+  for (size_t i = 0; i < f->instrs.len && n < cap; i++)
+    n += (size_t)snprintf(buf + n, cap - n, "%s%s", i ? " " : "", ir_op_name(f->instrs.items[i].op));
+}
+
+static void test_awaits_after_loop(void) {
+  char path[256];
+  snprintf(path, sizeof(path), "%s/tests/fixtures/await_overlap.lim", SOURCE_DIR);
+  FILE *f = fopen(path, "rb");
+  ASSERT_TRUE(f != NULL);
+  char src[2048];
+  size_t n = fread(src, 1, sizeof(src) - 1, f);
+  src[n] = '\0';
+  fclose(f);
+  Parser *p = parser_create(src, n);
+  ASTNode *ast = parse_program(p);
+  IrProgram *ir = ir_from_ast(ast);
+  ASSERT_TRUE(ir_validate(ir, NULL));
+  char *text = ir_program_print(ir);
+  const char *start = strstr(text, "ASK_START");
+  const char *working = strstr(text, "\"working\"");
+  const char *loop_end = strstr(text, "L1:\n");
+  const char *await = strstr(text, "AWAIT");
+  ASSERT_TRUE(start && working && loop_end && await);
+  ASSERT_TRUE(start < working && working < loop_end && loop_end < await);
+  // The store of the answer moves with its AWAIT, right before the load
+  const char *store = strstr(await, "\n  Summary = ");
+  ASSERT_TRUE(store && store == strchr(await, '\n'));
+  const char *next = strchr(store + 1, '\n') + 1;
+  const char *load = strstr(next, "LOAD_VAR Summary");
+  ASSERT_TRUE(load && load < strchr(next, '\n'));
+  ASSERT_TRUE(strstr(await + 1, "AWAIT") != NULL); // the second ask too
+  free(text);
+  ir_program_free(ir);
+  ast_free(ast);
+  parser_destroy(p);
+}
+
+static IrFunc *add_func(IrProgram *prog, const char *name) {
+  ir_program_add_func(prog, ir_func_create(name));
+  return &prog->funcs.items[prog->funcs.len - 1];
+}
+
+// ask; A := answer; <work>; <stop>; A read
+static void ask_then(IrFunc *f, int store) {
+  int t = ir_emit_ask(f, ir_emit_const_string(f, "q"), -1, NULL, NULL);
+  if (store) ir_emit_store_var(f, "A", t);
+  ir_emit_print(f, ir_emit_binop(f, IR_ADD, ir_emit_const_int(f, 1), ir_emit_const_int(f, 2)), 1);
+}
+
+static void test_stops_at_barriers(void) {
+  char ops[512];
+  // The answer read by the next instruction: nothing to overlap
+  IrProgram *prog = ir_program_new();
+  IrFunc *f = add_func(prog, "Main");
+  ir_emit_print(f, ir_emit_ask(f, ir_emit_const_string(f, "q"), -1, NULL, NULL), 1);
+  ASSERT_TRUE(ir_defer_awaits(prog) == 0);
+  ir_program_free(prog);
+
+  // Constants alone are not worth a thread
+  prog = ir_program_new();
+  f = add_func(prog, "Main");
+  int t = ir_emit_ask(f, ir_emit_const_string(f, "q"), -1, NULL, NULL);
+  ir_emit_const_int(f, 7);
+  ir_emit_print(f, t, 1);
+  ASSERT_TRUE(ir_defer_awaits(prog) == 0);
+  ir_program_free(prog);
+
+  // Stops at a read of the stored variable
+  prog = ir_program_new();
+  f = add_func(prog, "Main");
+  ask_then(f, 1);
+  ir_emit_load_var(f, "A.Name");
+  ASSERT_TRUE(ir_defer_awaits(prog) == 1);
+  op_names(&prog->funcs.items[0], ops, sizeof(ops));
+  ASSERT_EQ_STR("CONST_STRING ASK_START CONST_INT CONST_INT ADD PRINTLN AWAIT STORE_VAR LOAD_VAR", ops);
+  ir_program_free(prog);
+
+  // Passes a call of a function that neither asks nor reads A, stops at one
+  // that asks (through another function) and at one that reads A
+  const char *callees[] = { "Pure", "Asks", "Reads" };
+  for (int c = 0; c < 3; c++) {
+    prog = ir_program_new();
+    f = add_func(prog, "Main");
+    ask_then(f, 1);
+    ir_emit_call(f, callees[c], -1, -1);
+    ir_emit_load_var(f, "A");
+    ir_emit_load_var(add_func(prog, "Pure"), "B");
+    ir_emit_call(add_func(prog, "Asks"), "Inner", -1, -1);
+    ir_emit_ask(add_func(prog, "Inner"), -1, -1, NULL, NULL);
+    ir_emit_call(add_func(prog, "Reads"), "Deeper", -1, -1);
+    ir_emit_load_var(add_func(prog, "Deeper"), "A");
+    ASSERT_TRUE(ir_defer_awaits(prog) == 1);
+    op_names(&prog->funcs.items[0], ops, sizeof(ops));
+    ASSERT_EQ_STR(c == 0 ? "CONST_STRING ASK_START CONST_INT CONST_INT ADD PRINTLN CALL AWAIT STORE_VAR LOAD_VAR"
+                         : "CONST_STRING ASK_START CONST_INT CONST_INT ADD PRINTLN AWAIT STORE_VAR CALL LOAD_VAR", ops);
+    // Inner's ask has nothing after it
+    ASSERT_TRUE(prog->funcs.items[3].instrs.items[0].op == IR_ASK);
+    ir_program_free(prog);
+  }
+
+  // Stops at another ask, and at the back edge of the loop the ask is in
+  prog = ir_program_new();
+  f = add_func(prog, "Main");
+  ask_then(f, 0);
+  ir_emit_ask(f, ir_emit_const_string(f, "r"), -1, NULL, NULL);
+  ASSERT_TRUE(ir_defer_awaits(prog) == 1);
+  op_names(&prog->funcs.items[0], ops, sizeof(ops));
+  ASSERT_EQ_STR("CONST_STRING ASK_START CONST_INT CONST_INT ADD PRINTLN CONST_STRING AWAIT ASK", ops);
+  ir_program_free(prog);
+  prog = ir_program_new();
+  f = add_func(prog, "Main");
+  ir_emit_label(f, "head");
+  ir_emit_jump_if_false(f, ir_emit_const_bool(f, 1), "end");
+  ask_then(f, 0);
+  ir_emit_jump(f, "head");
+  ir_emit_label(f, "end");
+  ASSERT_TRUE(ir_defer_awaits(prog) == 1);
+  op_names(&prog->funcs.items[0], ops, sizeof(ops));
+  ASSERT_EQ_STR("LABEL CONST_BOOL JUMP_IF_FALSE CONST_STRING ASK_START CONST_INT CONST_INT ADD PRINTLN AWAIT JUMP LABEL", ops);
+  ir_program_free(prog);
+
+  // A `parallel` task awaits before its end label
+  prog = ir_program_new();
+  f = add_func(prog, "Main");
+  ir_emit_fork(f, "end");
+  ask_then(f, 0);
+  ir_emit_label(f, "end");
+  ir_emit_join(f);
+  ASSERT_TRUE(ir_defer_awaits(prog) == 1);
+  op_names(&prog->funcs.items[0], ops, sizeof(ops));
+  ASSERT_EQ_STR("FORK CONST_STRING ASK_START CONST_INT CONST_INT ADD PRINTLN AWAIT LABEL JOIN", ops);
+  ir_program_free(prog);
+
+  // A loop that is entered from outside is not a closed region
+  prog = ir_program_new();
+  f = add_func(prog, "Main");
+  ir_emit_jump(f, "head");
+  ask_then(f, 0);
+  ir_emit_label(f, "head");
+  ir_emit_print(f, ir_emit_const_int(f, 3), 1);
+  ir_emit_jump(f, "head");
+  ASSERT_TRUE(ir_defer_awaits(prog) == 1);
+  op_names(&prog->funcs.items[0], ops, sizeof(ops));
+  ASSERT_EQ_STR("JUMP CONST_STRING ASK_START CONST_INT CONST_INT ADD PRINTLN AWAIT LABEL CONST_INT PRINTLN JUMP", ops);
+  ir_program_free(prog);
+}
+
+// Answers 'summarize' once the program has written "working" to the pipe
+// (it flushes before it waits), 'late' after two seconds without; fails
+// every other prompt
+typedef struct {
+  int fd;
+  char seen[256];
+  size_t len;
+} PipeWatch;
+
+static OracleResult watch_call(void *impl, const char *prompt) {
+  PipeWatch *w = impl;
+  OracleResult r = {0};
+  if (strcmp(prompt, "summarize") != 0) {
+    r.error = strdup("down");
+    return r;
+  }
+  struct pollfd pfd = { w->fd, POLLIN, 0 };
+  while (!strstr(w->seen, "working") && poll(&pfd, 1, 2000) > 0) {
+    ssize_t got = read(w->fd, w->seen + w->len, sizeof(w->seen) - 1 - w->len);
+    if (got <= 0) break;
+    w->len += (size_t)got;
+    w->seen[w->len] = '\0';
+  }
+  r.ok = 1;
+  r.text = strdup(strstr(w->seen, "working") ? "on time" : "late");
+  return r;
+}
+
+static void watch_destroy(void *impl) {
+  (void)impl;
+}
+
+static void test_overlaps_loop(void) {
+  for (int jit = 0; jit < 2; jit++) {
+    int fds[2];
+    ASSERT_TRUE(pipe(fds) == 0);
+    PipeWatch w = { fds[0], "", 0 };
+    Oracle *o = oracle_alloc(ORACLE_KIND_MOCK, &w, watch_call, watch_destroy);
+    char path[256];
+    snprintf(path, sizeof(path), "%s/tests/fixtures/await_overlap.lim", SOURCE_DIR);
+    FILE *out = fdopen(fds[1], "w");
+    LiminalContext ctx;
+    liminal_context_init(&ctx);
+    ctx.out = out;
+    ctx.jit = jit;
+    ctx.jit_threshold = 0;
+    liminal_context_set_oracle(&ctx, o, 1);
+    ASSERT_TRUE(liminal_run_file_ctx(&ctx, path) == 0);
+    liminal_context_free(&ctx);
+    fclose(out);
+    ssize_t got;
+    while ((got = read(fds[0], w.seen + w.len, sizeof(w.seen) - 1 - w.len)) > 0) w.len += (size_t)got;
+    w.seen[w.len] = '\0';
+    close(fds[0]);
+    ASSERT_EQ_STR("working\n49\nOk(on time)\nmore\nOk(none)\n", w.seen);
+  }
+}
+
+// A record field read under another record's name still sees the answer
+static void test_aliased_field(void) {
+  char path[256];
+  snprintf(path, sizeof(path), "%s/tests/fixtures/await_alias.lim", SOURCE_DIR);
+  for (int jit = 0; jit < 2; jit++) {
+    char *out = NULL;
+    size_t len = 0;
+    LiminalContext ctx;
+    liminal_context_init(&ctx);
+    ctx.out = open_memstream(&out, &len);
+    ctx.jit = jit;
+    ctx.jit_threshold = 0;
+    liminal_context_set_oracle(&ctx, oracle_create_mock(), 1);
+    ASSERT_TRUE(liminal_run_file_ctx(&ctx, path) == 0);
+    FILE *f = ctx.out;
+    liminal_context_free(&ctx);
+    fclose(f);
+    ASSERT_EQ_STR("Ok(fallback)\n1275\n", out);
+    free(out);
+  }
+}
+
+int main(void) {
+  run_test("awaits_after_loop", test_awaits_after_loop);
+  run_test("stops_at_barriers", test_stops_at_barriers);
+  run_test("overlaps_loop", test_overlaps_loop);
+  run_test("aliased_field", test_aliased_field);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All await tests passed (%d)\n", get_tests_run());
+  return 0;
+}
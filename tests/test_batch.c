@@ -0,0 +1,204 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/batch.h"
+#include "liminal/oracles.h"
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Batch runs: reading JSONL records, outputs in input and completion order,
+// and the response cache the records share.
+
+static char *write_temp(const char *text) {
+  char *path = strdup("/tmp/liminal_batchXXXXXX");
+  int fd = mkstemp(path);
+  if (fd < 0) abort();
+  FILE *f = fdopen(fd, "w");
+  fputs(text, f);
+  fclose(f);
+  return path;
+}
+
+static char *read_all(FILE *f) {
+  fflush(f);
+  long len = ftell(f);
+  rewind(f);
+  char *buf = calloc((size_t)len + 1, 1);
+  if (fread(buf, 1, (size_t)len, f) != (size_t)len) buf[0] = '\0';
+  return buf;
+}
+
+static void fixture(char *path, size_t cap) {
+  snprintf(path, cap, "%s/tests/fixtures/batch_greet.lim", SOURCE_DIR);
+}
+
+static void test_reads_records(void) {
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  char *path = write_temp("{\"id\": \"r1\", \"Name\": \"a\\\"b\\u00e9\", \"Count\": 2, \"Rate\": 1.5, \"On\": true, \"Gone\": null}\n"
+                          "\n"
+                          "\"just stdin\\n\"\n"
+                          "{\"stdin\": \"x\\ny\", \"id\": 7}\n");
+  size_t n = 0;
+  char *err = NULL;
+  BatchRecord *rs = batch_read_records(&ctx, path, &n, &err);
+  ASSERT_TRUE(rs != NULL && n == 3);
+  ASSERT_EQ_STR("\"r1\"", rs[0].id);
+  ASSERT_EQ_STR("", rs[0].stdin_text);
+  ASSERT_TRUE(rs[0].vars.len == 4);
+  Value *v = env_find(&rs[0].vars, "Name");
+  ASSERT_TRUE(v && v->kind == VSTRING);
+  ASSERT_EQ_STR("a\"b\xc3\xa9", v->s);
+  v = env_find(&rs[0].vars, "Count");
+  ASSERT_TRUE(v && v->kind == VINT && v->i == 2);
+  v = env_find(&rs[0].vars, "Rate");
+  ASSERT_TRUE(v && v->kind == VREAL && v->f == 1.5);
+  v = env_find(&rs[0].vars, "On");
+  ASSERT_TRUE(v && v->kind == VBOOL && v->i == 1);
+  ASSERT_TRUE(env_find(&rs[0].vars, "Gone") == NULL);
+  // Ids default to the line number
+  ASSERT_EQ_STR("3", rs[1].id);
+  ASSERT_EQ_STR("just stdin\n", rs[1].stdin_text);
+  ASSERT_TRUE(rs[1].vars.len == 0);
+  ASSERT_EQ_STR("7", rs[2].id);
+  ASSERT_EQ_STR("x\ny", rs[2].stdin_text);
+  batch_records_free(&ctx, rs, n);
+  unlink(path);
+  free(path);
+
+  path = write_temp("{\"Name\": \"ok\"}\n{\"Name\": [1]}\n");
+  ASSERT_TRUE(batch_read_records(&ctx, path, &n, &err) == NULL);
+  ASSERT_CONTAINS(err, ":2: only strings, numbers, booleans and null are supported");
+  free(err);
+  unlink(path);
+  free(path);
+  liminal_context_free(&ctx);
+}
+
+// a asks three times, b once: b finishes first
+static const char *RECORDS = "{\"id\":\"a\",\"Name\":\"ada\",\"Count\":3,\"stdin\":\"first\\n\"}\n"
+                             "{\"id\":\"b\",\"Name\":\"bob\",\"Count\":1,\"stdin\":\"second\"}\n";
+
+static char *run_batch(Oracle *o, int owns, const char *records, const BatchOptions *opt, LiminalContext *ctx) {
+  char prog[256];
+  fixture(prog, sizeof(prog));
+  char *inputs = write_temp(records);
+  liminal_context_init(ctx);
+  ctx->out = tmpfile();
+  liminal_context_set_oracle(ctx, o, owns);
+  int rc = liminal_run_batch(ctx, prog, inputs, opt);
+  char *out = rc == 0 ? read_all(ctx->out) : NULL;
+  fclose(ctx->out);
+  ctx->out = NULL;
+  unlink(inputs);
+  free(inputs);
+  return out;
+}
+
+static void test_orders_outputs(void) {
+  Oracle *o = oracle_create_mock();
+  oracle_mock_set_latency(o, 30);
+  oracle_mock_answer(o, "greet ada", "hi ada", NULL);
+  oracle_mock_answer(o, "greet bob", "hi bob", NULL);
+  LiminalContext ctx;
+  BatchOptions opt = { 8, 0 };
+  char *out = run_batch(o, 0, RECORDS, &opt, &ctx);
+  ASSERT_TRUE(out != NULL);
+  ASSERT_EQ_STR("Ok(hi ada)\nOk(hi ada)\nOk(hi ada)\nada first\nOk(hi bob)\nbob second\n", out);
+  free(out);
+  liminal_context_free(&ctx);
+
+  opt.completion_order = 1;
+  out = run_batch(o, 0, RECORDS, &opt, &ctx);
+  ASSERT_TRUE(out != NULL);
+  ASSERT_EQ_STR("{\"id\":\"b\",\"output\":\"Ok(hi bob)\\nbob second\\n\"}\n"
+                "{\"id\":\"a\",\"output\":\"Ok(hi ada)\\nOk(hi ada)\\nOk(hi ada)\\nada first\\n\"}\n",
+                out);
+  free(out);
+  liminal_context_free(&ctx);
+
+  // One at a time, they finish in input order
+  opt.jobs = 1;
+  out = run_batch(o, 0, RECORDS, &opt, &ctx);
+  ASSERT_TRUE(out != NULL);
+  ASSERT_TRUE(strstr(out, "\"id\":\"a\"") < strstr(out, "\"id\":\"b\""));
+  free(out);
+  liminal_context_free(&ctx);
+  oracle_free(o);
+
+  // A malformed record stops the batch before anything runs
+  o = oracle_create_mock();
+  ASSERT_TRUE(run_batch(o, 0, "{\"Name\": }\n", &opt, &ctx) == NULL);
+  liminal_context_free(&ctx);
+  oracle_free(o);
+}
+
+// The provider has one answer; every record after the first gets it from
+// the cache
+static void test_shares_cache(void) {
+  Oracle *o = oracle_create_mock();
+  oracle_mock_queue(o, "only once", NULL);
+  LiminalContext ctx;
+  BatchOptions opt = { 1, 0 };
+  char *out = run_batch(o, 1, "{\"Name\":\"x\",\"Count\":2}\n{\"Name\":\"x\",\"Count\":1}\n{\"Name\":\"x\",\"Count\":2}\n",
+                        &opt, &ctx);
+  ASSERT_TRUE(out != NULL);
+  ASSERT_EQ_STR("Ok(only once)\nOk(only once)\nx \nOk(only once)\nx \nOk(only once)\nOk(only once)\nx \n", out);
+  size_t hits = 0, misses = 0;
+  oracle_cache_stats(ctx.oracle, &hits, &misses);
+  ASSERT_TRUE(hits == 4 && misses == 1);
+  free(out);
+  liminal_context_free(&ctx);
+
+  // Failures are not kept: the next ask reaches the provider again
+  o = oracle_with_cache(oracle_create_mock());
+  oracle_mock_queue(o->inner, NULL, "down");
+  oracle_mock_queue(o->inner, "up", NULL);
+  OracleResult r = oracle_call_text(o, "q");
+  ASSERT_TRUE(!r.ok);
+  oracle_result_free(r);
+  r = oracle_call_text(o, "  q ");
+  ASSERT_TRUE(r.ok);
+  ASSERT_EQ_STR("up", r.text);
+  oracle_result_free(r);
+  r = oracle_call_text(o, "q");
+  ASSERT_EQ_STR("up", r.text);
+  oracle_result_free(r);
+  oracle_cache_stats(o, &hits, &misses);
+  ASSERT_TRUE(hits == 1 && misses == 2);
+  oracle_free(o);
+
+  // A started ask the provider has no slot for runs on a thread, and its
+  // miss is counted once
+  o = oracle_with_cache(oracle_create_mock());
+  oracle_set_max_concurrency(o->inner, 1);
+  oracle_mock_queue(o->inner, "first", NULL);
+  oracle_mock_queue(o->inner, "second", NULL);
+  void *busy = oracle_start_text(o->inner, "busy");
+  ASSERT_TRUE(busy != NULL);
+  OracleCall *call = oracle_call_start(o, "q");
+  r = oracle_finish_text(o->inner, busy);
+  ASSERT_EQ_STR("first", r.text);
+  oracle_result_free(r);
+  r = oracle_call_wait(call);
+  ASSERT_EQ_STR("second", r.text);
+  oracle_result_free(r);
+  oracle_cache_stats(o, &hits, &misses);
+  ASSERT_TRUE(hits == 0 && misses == 1);
+  oracle_free(o);
+}
+
+int main(void) {
+  run_test("reads_records", test_reads_records);
+  run_test("orders_outputs", test_orders_outputs);
+  run_test("shares_cache", test_shares_cache);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All batch tests passed (%d)\n", get_tests_run());
+  return 0;
+}
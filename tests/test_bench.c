@@ -0,0 +1,133 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/bench.h"
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Benchmark harness: the statistics, the JSON round trip and regression
+// verdicts, and an in-process run of an example.
+
+static void test_summarizes(void) {
+  uint64_t ns[10] = {10, 1, 9, 2, 8, 3, 7, 4, 6, 5};
+  BenchResult r = {0};
+  bench_summarize(ns, 10, &r);
+  ASSERT_TRUE(r.iterations == 10);
+  ASSERT_TRUE(r.mean_ns == 5.5);
+  // Sample standard deviation of 1..10
+  ASSERT_TRUE(r.stddev_ns > 3.0276 && r.stddev_ns < 3.0277);
+  ASSERT_TRUE(r.min_ns == 1 && r.max_ns == 10);
+  // Nearest rank
+  ASSERT_TRUE(r.p50_ns == 5);
+  ASSERT_TRUE(r.p90_ns == 9);
+  ASSERT_TRUE(r.p99_ns == 10);
+  uint64_t one = 42;
+  bench_summarize(&one, 1, &r);
+  ASSERT_TRUE(r.stddev_ns == 0 && r.p50_ns == 42 && r.p99_ns == 42);
+}
+
+static BenchResult result(const char *name, uint64_t p50, uint64_t allocs) {
+  BenchResult r = {0};
+  r.name = (char *)name;
+  r.iterations = 3;
+  r.mean_ns = (double)p50;
+  r.min_ns = r.p50_ns = r.p90_ns = r.p99_ns = r.max_ns = p50;
+  r.allocs = allocs;
+  r.instructions = 1000;
+  return r;
+}
+
+static void test_compares_with_baseline(void) {
+  BenchResult base[] = { result("loop", 1000000, 100), result("calls", 2000000, 500) };
+  char path[] = "/tmp/liminal_benchXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_TRUE(fd >= 0);
+  FILE *f = fdopen(fd, "w");
+  BenchOptions opt = { 1, 3, 0 };
+  bench_write_json(base, 2, &opt, f);
+  fclose(f);
+  size_t n = 0;
+  BenchResult *read = bench_read_json(path, &n);
+  unlink(path);
+  ASSERT_TRUE(read != NULL && n == 2);
+  ASSERT_EQ_STR("calls", read[1].name);
+  ASSERT_TRUE(read[1].p50_ns == 2000000 && read[1].allocs == 500 && read[1].instructions == 1000);
+  ASSERT_TRUE(read[0].iterations == 3);
+
+  // loop is 4% slower (within 5%), calls allocates 20% more, fresh is new
+  BenchResult now[] = { result("loop", 1040000, 100), result("calls", 1500000, 600), result("fresh", 1, 1) };
+  char *out = NULL; size_t len = 0;
+  FILE *table = open_memstream(&out, &len);
+  ASSERT_TRUE(bench_compare(read, n, now, 3, 5.0, table) == 1);
+  fclose(table);
+  ASSERT_CONTAINS(out, "+4.0%");
+  ASSERT_CONTAINS(out, "REGRESSED");
+  ASSERT_CONTAINS(out, "+20.0%");
+  ASSERT_CONTAINS(out, "  new\n");
+  free(out);
+  // A looser threshold lets both through
+  table = open_memstream(&out, &len);
+  ASSERT_TRUE(bench_compare(read, n, now, 3, 25.0, table) == 0);
+  fclose(table);
+  free(out);
+  for (size_t i = 0; i < n; i++) bench_result_free(&read[i]);
+  free(read);
+  ASSERT_TRUE(bench_read_json("/nonexistent/base.json", &n) == NULL);
+}
+
+// Names are escaped on the way out and unescaped on the way back, and lines
+// are as long as they need to be
+static void test_json_names_round_trip(void) {
+  char long_name[6000];
+  memset(long_name, 'x', sizeof(long_name) - 1);
+  long_name[sizeof(long_name) - 1] = '\0';
+  BenchResult rs[] = { result("say \"hi\"\\path\n", 7, 8), result(long_name, 9, 10) };
+  char path[] = "/tmp/liminal_benchXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_TRUE(fd >= 0);
+  FILE *f = fdopen(fd, "w");
+  BenchOptions opt = { 1, 3, 0 };
+  bench_write_json(rs, 2, &opt, f);
+  fclose(f);
+  size_t n = 0;
+  BenchResult *read = bench_read_json(path, &n);
+  unlink(path);
+  ASSERT_TRUE(read != NULL && n == 2);
+  ASSERT_EQ_STR("say \"hi\"\\path\n", read[0].name);
+  ASSERT_TRUE(read[0].p50_ns == 7 && read[0].allocs == 8);
+  ASSERT_EQ_STR(long_name, read[1].name);
+  ASSERT_TRUE(read[1].p50_ns == 9 && read[1].allocs == 10 && read[1].instructions == 1000);
+  for (size_t i = 0; i < n; i++) bench_result_free(&read[i]);
+  free(read);
+}
+
+static void test_runs_in_process(void) {
+  char path[512]; snprintf(path, sizeof(path), "%s/examples/opus/c04_array_ops.lim", SOURCE_DIR);
+  BenchOptions opt = { 1, 3, 0 };
+  BenchResult r;
+  ASSERT_TRUE(bench_run(path, &opt, &r));
+  ASSERT_EQ_STR("c04_array_ops", r.name);
+  ASSERT_TRUE(r.iterations == 3);
+  ASSERT_TRUE(r.min_ns > 0 && r.min_ns <= r.p50_ns && r.p50_ns <= r.max_ns);
+  ASSERT_TRUE(r.allocs > 0 && r.bytes > 0);
+  ASSERT_TRUE(r.instructions > 0);
+  bench_result_free(&r);
+  ASSERT_TRUE(!bench_run("/nonexistent/prog.lim", &opt, &r));
+  bench_result_free(&r);
+}
+
+int main(void) {
+  run_test("summarizes", test_summarizes);
+  run_test("compares_with_baseline", test_compares_with_baseline);
+  run_test("json_names_round_trip", test_json_names_round_trip);
+  run_test("runs_in_process", test_runs_in_process);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All bench tests passed (%d)\n", get_tests_run());
+  return 0;
+}
@@ -0,0 +1,206 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/bytecode.h"
+#include "liminal/exec.h"
+#include "liminal/parser.h"
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static char *read_all(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return NULL;
+  fseek(f, 0, SEEK_END);
+  long len = ftell(f);
+  rewind(f);
+  char *buf = malloc(len + 1);
+  size_t n = fread(buf, 1, len, f);
+  buf[n] = '\0';
+  fclose(f);
+  return buf;
+}
+
+static IrProgram *compile_example(const char *rel) {
+  char path[256]; snprintf(path, sizeof(path), "%s/%s", SOURCE_DIR, rel);
+  char *src = read_all(path);
+  if (!src) return NULL;
+  Parser *p = parser_create(src, strlen(src));
+  ASTNode *ast = parse_program(p);
+  IrProgram *ir = ir_from_ast(ast);
+  ast_free(ast);
+  parser_destroy(p);
+  free(src);
+  return ir;
+}
+
+static void assert_roundtrip(const char *rel) {
+  IrProgram *ir = compile_example(rel);
+  ASSERT_TRUE(ir != NULL);
+  size_t len = 0;
+  unsigned char *data = bytecode_serialize(ir, &len);
+  char *errmsg = NULL;
+  IrProgram *back = bytecode_deserialize(data, len, &errmsg);
+  ASSERT_TRUE(back != NULL);
+  char *want = ir_program_print(ir);
+  char *got = ir_program_print(back);
+  ASSERT_EQ_STR(want, got);
+  // Line tables come back with every span
+  for (size_t i = 0; i < ir->funcs.len; ++i) {
+    const IrFunc *a = &ir->funcs.items[i], *b = &back->funcs.items[i];
+    ASSERT_TRUE(a->lines.len == b->lines.len);
+    ASSERT_TRUE(a->lines.len == 0 || memcmp(a->lines.items, b->lines.items, a->lines.len * sizeof(IrLine)) == 0);
+  }
+  // Re-serializing must be byte-identical (schema references preserved)
+  size_t len2 = 0;
+  unsigned char *data2 = bytecode_serialize(back, &len2);
+  ASSERT_TRUE(len == len2 && memcmp(data, data2, len) == 0);
+  free(want); free(got); free(data); free(data2);
+  ir_program_free(ir);
+  ir_program_free(back);
+}
+
+static void test_roundtrip_basic(void) { assert_roundtrip("tests/fixtures/ir_basic.lim"); }
+static void test_roundtrip_schemas(void) { assert_roundtrip("examples/opus/c08_constraints.lim"); }
+static void test_roundtrip_records(void) { assert_roundtrip("examples/opus/c06_data_table.lim"); }
+static void test_roundtrip_stream(void) { assert_roundtrip("tests/fixtures/stream_basic.lim"); }
+static void test_roundtrip_parallel(void) { assert_roundtrip("tests/fixtures/parallel_basic.lim"); }
+
+static void test_rejects_truncated(void) {
+  IrProgram *ir = compile_example("examples/07_ask_into.lim");
+  ASSERT_TRUE(ir != NULL);
+  size_t len = 0;
+  unsigned char *data = bytecode_serialize(ir, &len);
+  ir_program_free(ir);
+  size_t rejected = 0;
+  for (size_t n = 0; n < len; ++n) {
+    char *errmsg = NULL;
+    IrProgram *p = bytecode_deserialize(data, n, &errmsg);
+    if (!p && errmsg) rejected++;
+    ir_program_free(p);
+    free(errmsg);
+  }
+  data[0] = 'X';
+  IrProgram *bad = bytecode_deserialize(data, len, NULL);
+  free(data);
+  ASSERT_TRUE(rejected == len);
+  ASSERT_TRUE(bad == NULL);
+}
+
+static IrProgram *map_image_of(const IrProgram *ir) {
+  char path[] = "/tmp/liminal_img_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) return NULL;
+  size_t len = 0;
+  unsigned char *data = bytecode_serialize(ir, &len);
+  ssize_t wrote = write(fd, data, len);
+  close(fd);
+  free(data);
+  IrProgram *mapped = wrote == (ssize_t)len ? bytecode_map_file(path, NULL) : NULL;
+  unlink(path);
+  return mapped;
+}
+
+static void test_map_borrows_strings(void) {
+  IrProgram *ir = compile_example("examples/07_ask_into.lim");
+  ASSERT_TRUE(ir != NULL);
+  IrProgram *mapped = map_image_of(ir);
+  ASSERT_TRUE(mapped != NULL);
+  ASSERT_TRUE(mapped->image != NULL);
+  const char *lo = (const char *)mapped->image, *hi = lo + mapped->image_len;
+  const char *name = mapped->funcs.items[0].name;
+  ASSERT_TRUE(name >= lo && name < hi);
+  char *want = ir_program_print(ir);
+  char *got = ir_program_print(mapped);
+  ASSERT_EQ_STR(want, got);
+  free(want); free(got);
+  ir_program_free(ir);
+  ir_program_free(mapped);
+}
+
+static void test_string_pool_dedup(void) {
+  IrProgram *ir = compile_example("examples/opus/t11_while.lim");
+  ASSERT_TRUE(ir != NULL);
+  IrProgram *mapped = map_image_of(ir);
+  ir_program_free(ir);
+  ASSERT_TRUE(mapped != NULL);
+  // Every load/store of the loop variable shares one pooled string
+  const IrFunc *f = &mapped->funcs.items[0];
+  const char *first = NULL;
+  size_t uses = 0, shared = 0;
+  for (size_t i = 0; i < f->instrs.len; ++i) {
+    const IrInstr *ins = &f->instrs.items[i];
+    if ((ins->op != IR_LOAD_VAR && ins->op != IR_STORE_VAR) || strcmp(ins->s, "N") != 0) continue;
+    if (!first) first = ins->s;
+    uses++;
+    if (ins->s == first) shared++;
+  }
+  ir_program_free(mapped);
+  ASSERT_TRUE(uses > 2);
+  ASSERT_TRUE(shared == uses);
+}
+
+static void test_cache_key(void) {
+  char a[65], b[65], c[65];
+  bytecode_cache_key("program A;", 10, a);
+  bytecode_cache_key("program A;", 10, b);
+  bytecode_cache_key("program B;", 10, c);
+  ASSERT_EQ_STR(a, b);
+  ASSERT_TRUE(strcmp(a, c) != 0);
+}
+
+static char *run_with_cache(const char *dir, const char *path) {
+  char *buf = NULL; size_t len = 0;
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  free(ctx.cache_dir);
+  ctx.cache_dir = strdup(dir);
+  ctx.out = open_memstream(&buf, &len);
+  int rc = liminal_run_file_ctx(&ctx, path);
+  FILE *out = ctx.out;
+  liminal_context_free(&ctx);
+  fclose(out);
+  if (rc != 0) { free(buf); return NULL; }
+  return buf;
+}
+
+static void test_cache_run(void) {
+  char dir[] = "/tmp/liminal_bc_XXXXXX";
+  ASSERT_TRUE(mkdtemp(dir) != NULL);
+  char path[256]; snprintf(path, sizeof(path), "%s/examples/opus/c04_array_ops.lim", SOURCE_DIR);
+  char *src = read_all(path);
+  char *entry = bytecode_cache_path(dir, src, strlen(src));
+  char *cold = run_with_cache(dir, path);
+  int stored = access(entry, R_OK) == 0;
+  IrProgram *loaded = bytecode_cache_load(dir, src, strlen(src));
+  char *warm = run_with_cache(dir, path);
+  ASSERT_TRUE(cold != NULL && warm != NULL);
+  ASSERT_TRUE(stored);
+  ASSERT_TRUE(loaded != NULL);
+  ASSERT_EQ_STR(cold, warm);
+  ir_program_free(loaded);
+  unlink(entry);
+  rmdir(dir);
+  free(entry); free(src); free(cold); free(warm);
+}
+
+int main(void) {
+  run_test("roundtrip_basic", test_roundtrip_basic);
+  run_test("roundtrip_schemas", test_roundtrip_schemas);
+  run_test("roundtrip_records", test_roundtrip_records);
+  run_test("roundtrip_stream", test_roundtrip_stream);
+  run_test("roundtrip_parallel", test_roundtrip_parallel);
+  run_test("rejects_truncated", test_rejects_truncated);
+  run_test("map_borrows_strings", test_map_borrows_strings);
+  run_test("string_pool_dedup", test_string_pool_dedup);
+  run_test("cache_key", test_cache_key);
+  run_test("cache_run", test_cache_run);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All bytecode tests passed (%d)\n", get_tests_run());
+  return 0;
+}
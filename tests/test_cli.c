@@ -84,11 +84,106 @@ static void test_cli_ask_else(void) {
   free(out);
 }
 
+static void test_cli_ngrams(void) {
+  char path[256]; snprintf(path, sizeof(path), "%s/tests/fixtures/exec_hello.lim", SOURCE_DIR);
+  char *argv[] = {(char *)"liminal", (char *)"ngrams", (char *)"-n", (char *)"2", (char *)"--top", (char *)"3", path, NULL};
+  char *out = capture_stdout(liminal_main, 7, argv);
+  ASSERT_TRUE(out != NULL);
+  ASSERT_CONTAINS(out, "instructions executed in 1 program(s)");
+  free(out);
+}
+
+static void test_cli_profile_round_trip(void) {
+  char path[256]; snprintf(path, sizeof(path), "%s/tests/fixtures/pgo_routing.lim", SOURCE_DIR);
+  char prof[] = "/tmp/liminal_profXXXXXX";
+  int fd = mkstemp(prof);
+  ASSERT_TRUE(fd >= 0);
+  close(fd);
+  unlink(prof);
+  char *record[] = {(char *)"liminal", (char *)"run", (char *)"--profile-out", prof, path, NULL};
+  char *out = capture_stdout(liminal_main, 5, record);
+  ASSERT_TRUE(out != NULL);
+  ASSERT_EQ_STR("total=374\n", out);
+  free(out);
+  ASSERT_TRUE(access(prof, R_OK) == 0);
+  char *use[] = {(char *)"liminal", (char *)"run", (char *)"--profile-in", prof, path, NULL};
+  out = capture_stdout(liminal_main, 5, use);
+  ASSERT_TRUE(out != NULL);
+  ASSERT_EQ_STR("total=374\n", out);
+  free(out);
+  unlink(prof);
+}
+
+static void test_cli_timing_profile(void) {
+  char path[256]; snprintf(path, sizeof(path), "%s/tests/fixtures/pgo_routing.lim", SOURCE_DIR);
+  char json[] = "/tmp/liminal_timingXXXXXX";
+  int fd = mkstemp(json);
+  ASSERT_TRUE(fd >= 0);
+  close(fd);
+  char ann[] = "/tmp/liminal_annotateXXXXXX";
+  fd = mkstemp(ann);
+  ASSERT_TRUE(fd >= 0);
+  close(fd);
+  char *argv[] = {(char *)"liminal", (char *)"run", (char *)"--profile-json", json, (char *)"--annotate", ann, path, NULL};
+  char *out = capture_stdout(liminal_main, 7, argv);
+  ASSERT_TRUE(out != NULL);
+  // The report goes to stderr; the program's output is unchanged
+  ASSERT_EQ_STR("total=374\n", out);
+  free(out);
+  FILE *f = fopen(json, "r");
+  ASSERT_TRUE(f != NULL);
+  char buf[4096] = {0};
+  size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+  fclose(f);
+  ASSERT_TRUE(n > 0);
+  ASSERT_CONTAINS(buf, "{\"name\":\"Scale\",\"calls\":3000,");
+  ASSERT_CONTAINS(buf, "\"oracle_calls\":0,");
+  ASSERT_CONTAINS(buf, "{\"line\":19,\"instructions\":");
+  unlink(json);
+  f = fopen(ann, "r");
+  ASSERT_TRUE(f != NULL);
+  char text[8192] = {0};
+  n = fread(text, 1, sizeof(text) - 1, f);
+  fclose(f);
+  // Scale's body under its source line, each instruction run 3000 times
+  ASSERT_CONTAINS(text, "func Scale\n; 19: Result := (X * 3 + Y) mod 1009;\n        3000   t0 = LOAD_VAR X\n");
+  unlink(ann);
+}
+
+static void test_cli_recordings(void) {
+  char src[256]; snprintf(src, sizeof(src), "%s/tests/recordings/examples.jsonl", SOURCE_DIR);
+  const char *bin = "/tmp/liminal_cli_rec.lrec";
+  char *convert[] = {(char *)"liminal", (char *)"recordings", (char *)"convert", src, (char *)bin, NULL};
+  char *out = capture_stdout(liminal_main, 5, convert);
+  ASSERT_TRUE(out != NULL);
+  free(out);
+  char *stats[] = {(char *)"liminal", (char *)"recordings", (char *)"stats", (char *)bin, NULL};
+  out = capture_stdout(liminal_main, 4, stats);
+  ASSERT_TRUE(out != NULL);
+  ASSERT_CONTAINS(out, "binary recording");
+  ASSERT_CONTAINS(out, "records:  3 (2 distinct prompts, 0 failures)");
+  ASSERT_CONTAINS(out, "index:    covers every record");
+  free(out);
+  char *compact[] = {(char *)"liminal", (char *)"recordings", (char *)"compact", (char *)bin, NULL};
+  out = capture_stdout(liminal_main, 4, compact);
+  free(out);
+  out = capture_stdout(liminal_main, 4, stats);
+  ASSERT_TRUE(out != NULL);
+  ASSERT_CONTAINS(out, "records:  2 (2 distinct prompts, 0 failures)");
+  free(out);
+  unlink(bin);
+  unlink("/tmp/liminal_cli_rec.lrec.idx");
+}
+
 int main(void) {
   run_test("help_option_prints_usage", test_help_option_prints_usage);
   run_test("version_option_prints_version", test_version_option_prints_version);
   run_test("default_shows_help", test_default_shows_help);
   run_test("cli_ask_else", test_cli_ask_else);
+  run_test("cli_ngrams", test_cli_ngrams);
+  run_test("cli_profile_round_trip", test_cli_profile_round_trip);
+  run_test("cli_timing_profile", test_cli_timing_profile);
+  run_test("cli_recordings", test_cli_recordings);
 
   if (get_tests_failed() > 0) {
     fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
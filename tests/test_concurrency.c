@@ -0,0 +1,176 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/exec.h"
+#include "liminal/oracles.h"
+#include "test_harness.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Runs the example suite on several threads at once, each program in its own
+// LiminalContext, all sharing one replay oracle. Build with -DENABLE_TSAN=ON
+// to have ThreadSanitizer check the interpreter for shared mutable state.
+
+#define STRESS_DEFAULT_THREADS 8
+#define STRESS_MAX_THREADS 64
+#define MOCK_CALLS_PER_THREAD 200
+
+// File I/O examples (03_file_io, t26) are left out: they share paths on disk.
+static const char *PROGRAMS[] = {
+  "examples/01_hello.lim",
+  "examples/02_add.lim",
+  "examples/04_ask_basic.lim",
+  "examples/05_ask_with_cost.lim",
+  "examples/06_budget.lim",
+  "examples/07_ask_into.lim",
+  "examples/08_mixed.lim",
+  "examples/09_consult_retry.lim",
+  "examples/opus/t02_int_vars.lim",
+  "examples/opus/t06_strings.lim",
+  "examples/opus/t13_function.lim",
+  "examples/opus/t15_recursion.lim",
+  "examples/opus/t16_record.lim",
+  "examples/opus/t17_array.lim",
+  "examples/opus/t18_enum.lim",
+  "examples/opus/t20_fstring.lim",
+  "examples/opus/t25_optional.lim",
+  "examples/opus/t27_record_patch.lim",
+  "examples/opus/t28_schema_validation_path.lim",
+  "examples/opus/c01_fibonacci.lim",
+  "examples/opus/c04_array_ops.lim",
+  "examples/opus/c06_data_table.lim",
+  "examples/opus/c09_invoice_batch.lim",
+  "examples/opus/c11_ticket_triage_extract.lim",
+  "examples/opus/o02_ask_result.lim",
+  "examples/opus/o05_ask_into.lim",
+  "examples/opus/o08_fallback_chain.lim",
+};
+#define PROGRAM_COUNT (sizeof(PROGRAMS) / sizeof(PROGRAMS[0]))
+
+typedef struct {
+  int rc;
+  char *out;
+} RunOutput;
+
+static RunOutput run_program(Oracle *oracle, const char *rel) {
+  char path[512]; snprintf(path, sizeof(path), "%s/%s", SOURCE_DIR, rel);
+  const char *in_data = "3\n4\n";
+  RunOutput r = {0};
+  size_t len = 0;
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  ctx.in = fmemopen((void *)in_data, strlen(in_data), "r");
+  ctx.out = open_memstream(&r.out, &len);
+  liminal_context_set_oracle(&ctx, oracle, 0);
+  r.rc = liminal_run_file_ctx(&ctx, path);
+  FILE *in = ctx.in, *out = ctx.out;
+  liminal_context_free(&ctx);
+  fclose(in);
+  fclose(out);
+  return r;
+}
+
+typedef struct {
+  size_t id;
+  Oracle *oracle;
+  const RunOutput *expected;
+  size_t mismatches;
+} SuiteWorker;
+
+static void *suite_worker(void *arg) {
+  SuiteWorker *w = (SuiteWorker *)arg;
+  for (size_t i = 0; i < PROGRAM_COUNT; ++i) {
+    // Each thread walks the suite from a different offset
+    size_t k = (i + w->id) % PROGRAM_COUNT;
+    RunOutput got = run_program(w->oracle, PROGRAMS[k]);
+    if (got.rc != w->expected[k].rc || strcmp(got.out, w->expected[k].out) != 0) {
+      fprintf(stderr, "thread %zu: %s diverged (rc=%d)\n", w->id, PROGRAMS[k], got.rc);
+      w->mismatches++;
+    }
+    free(got.out);
+  }
+  return NULL;
+}
+
+static size_t thread_count(void) {
+  const char *v = getenv("LIMINAL_STRESS_THREADS");
+  long n = v ? strtol(v, NULL, 10) : STRESS_DEFAULT_THREADS;
+  if (n < 1) n = 1;
+  if (n > STRESS_MAX_THREADS) n = STRESS_MAX_THREADS;
+  return (size_t)n;
+}
+
+static void test_examples_on_threads(void) {
+  char rec[512]; snprintf(rec, sizeof(rec), "%s/tests/recordings/examples.jsonl", SOURCE_DIR);
+  Oracle *oracle = oracle_with_recording(oracle_create_mock(), "replay", rec);
+
+  RunOutput expected[PROGRAM_COUNT];
+  for (size_t i = 0; i < PROGRAM_COUNT; ++i) expected[i] = run_program(oracle, PROGRAMS[i]);
+
+  size_t n = thread_count();
+  pthread_t threads[STRESS_MAX_THREADS];
+  SuiteWorker workers[STRESS_MAX_THREADS];
+  for (size_t t = 0; t < n; ++t) {
+    workers[t] = (SuiteWorker){.id = t, .oracle = oracle, .expected = expected};
+    pthread_create(&threads[t], NULL, suite_worker, &workers[t]);
+  }
+  size_t mismatches = 0;
+  for (size_t t = 0; t < n; ++t) {
+    pthread_join(threads[t], NULL);
+    mismatches += workers[t].mismatches;
+  }
+
+  for (size_t i = 0; i < PROGRAM_COUNT; ++i) free(expected[i].out);
+  oracle_free(oracle);
+  ASSERT_TRUE(mismatches == 0);
+}
+
+typedef struct {
+  Oracle *oracle;
+  size_t ok;
+} MockWorker;
+
+static void *mock_worker(void *arg) {
+  MockWorker *w = (MockWorker *)arg;
+  for (size_t i = 0; i < MOCK_CALLS_PER_THREAD; ++i) {
+    OracleResult r = oracle_call_text(w->oracle, "p");
+    if (r.ok) w->ok++;
+    oracle_result_free(r);
+  }
+  return NULL;
+}
+
+static void test_mock_oracle_shared(void) {
+  size_t n = thread_count();
+  Oracle *o = oracle_create_mock();
+  // One fewer response than calls: exactly one call must come back empty
+  size_t total = n * MOCK_CALLS_PER_THREAD;
+  for (size_t i = 0; i + 1 < total; ++i) oracle_mock_queue(o, "x", NULL);
+
+  pthread_t threads[STRESS_MAX_THREADS];
+  MockWorker workers[STRESS_MAX_THREADS];
+  for (size_t t = 0; t < n; ++t) {
+    workers[t] = (MockWorker){.oracle = o};
+    pthread_create(&threads[t], NULL, mock_worker, &workers[t]);
+  }
+  size_t ok = 0;
+  for (size_t t = 0; t < n; ++t) {
+    pthread_join(threads[t], NULL);
+    ok += workers[t].ok;
+  }
+  oracle_free(o);
+  ASSERT_TRUE(ok == total - 1);
+}
+
+int main(void) {
+  run_test("examples_on_threads", test_examples_on_threads);
+  run_test("mock_oracle_shared", test_mock_oracle_shared);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All concurrency tests passed (%d)\n", get_tests_run());
+  return 0;
+}
@@ -7,11 +7,16 @@
 #include <stdlib.h>
 #include <string.h>
 
-static void run_fixture(const char *fixture, char **outbuf) {
+static void run_fixture(Oracle *o, const char *fixture, char **outbuf) {
   char path[256]; snprintf(path, sizeof(path), "%s/tests/fixtures/%s", SOURCE_DIR, fixture);
   size_t outlen = 0;
   FILE *out = open_memstream(outbuf, &outlen);
-  int rc = liminal_run_file_streams(path, NULL, out);
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  ctx.out = out;
+  liminal_context_set_oracle(&ctx, o, 0);
+  int rc = liminal_run_file_ctx(&ctx, path);
+  liminal_context_free(&ctx);
   fflush(out); fclose(out);
   ASSERT_TRUE(rc == 0);
 }
@@ -19,39 +24,35 @@ static void run_fixture(const char *fixture, char **outbuf) {
 static void test_consult_basic(void) {
   Oracle *o = oracle_create_mock();
   oracle_mock_queue(o, "hi", NULL);
-  exec_set_global_oracle(o);
-  char *out=NULL; run_fixture("consult_basic.lim", &out);
+  char *out=NULL; run_fixture(o, "consult_basic.lim", &out);
   ASSERT_EQ_STR("Ok(hi)\n", out);
-  free(out); exec_set_global_oracle(NULL); oracle_free(o);
+  free(out); oracle_free(o);
 }
 
 static void test_consult_retry(void) {
   Oracle *o = oracle_create_mock();
   oracle_mock_queue(o, NULL, "boom");
   oracle_mock_queue(o, "hi", NULL);
-  exec_set_global_oracle(o);
-  char *out=NULL; run_fixture("consult_retry.lim", &out);
+  char *out=NULL; run_fixture(o, "consult_retry.lim", &out);
   ASSERT_EQ_STR("Ok(hi)\n", out);
-  free(out); exec_set_global_oracle(NULL); oracle_free(o);
+  free(out); oracle_free(o);
 }
 
 static void test_consult_fallback(void) {
   Oracle *o = oracle_create_mock();
   oracle_mock_queue(o, NULL, "boom");
-  exec_set_global_oracle(o);
-  char *out=NULL; run_fixture("consult_fallback.lim", &out);
+  char *out=NULL; run_fixture(o, "consult_fallback.lim", &out);
   ASSERT_EQ_STR("Ok(fb)\n", out);
-  free(out); exec_set_global_oracle(NULL); oracle_free(o);
+  free(out); oracle_free(o);
 }
 
 static void test_consult_hint(void) {
   Oracle *o = oracle_create_mock();
   oracle_mock_queue(o, "{\"Name\":123,\"Age\":\"x\"}", NULL);
   oracle_mock_queue(o, "{\"Name\":\"Bob\",\"Age\":30}", NULL);
-  exec_set_global_oracle(o);
-  char *out=NULL; run_fixture("consult_hint.lim", &out);
+  char *out=NULL; run_fixture(o, "consult_hint.lim", &out);
   ASSERT_EQ_STR("Ok({\"Name\":\"Bob\",\"Age\":30})\n", out);
-  free(out); exec_set_global_oracle(NULL); oracle_free(o);
+  free(out); oracle_free(o);
 }
 
 int main(void) {
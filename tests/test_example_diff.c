@@ -0,0 +1,175 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/exec.h"
+#include "liminal/jit.h"
+#include "liminal/oracles.h"
+#include "test_harness.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Differential runs of every example: each program runs twice, as a mode
+// sets up its reference run and its run under test, and the outputs must
+// match byte for byte (including programs the front end rejects). Modes are
+// named on the command line, one ctest entry each; with none, all run. The
+// benchmark programs take most of the time and only join in when
+// ENABLE_OPUS_BENCHMARK_TESTS is on.
+
+static const char *INPUT = "3\n4\n";
+
+typedef struct {
+  int rc;
+  char *out;
+  size_t jit_compiled;
+} RunOutput;
+
+typedef struct {
+  const char *name;
+  const char *differs; // what a mismatch is reported as
+  // Set up the reference run (want) and the run under test; tmp is a file
+  // the two may share
+  void (*want)(LiminalContext *ctx, const char *tmp);
+  void (*got)(LiminalContext *ctx, const char *tmp);
+  // An extra check of a matching pair; NULL if none
+  const char *(*check)(const RunOutput *want, const RunOutput *got);
+} DiffMode;
+
+// The interpreter as it runs by default
+static void plain(LiminalContext *ctx, const char *tmp) {
+  (void)ctx;
+  (void)tmp;
+}
+
+static void jit_got(LiminalContext *ctx, const char *tmp) {
+  (void)tmp;
+  ctx->jit = 1;
+  ctx->jit_threshold = 0;
+}
+
+static const char *jit_check(const RunOutput *want, const RunOutput *got) {
+  return jit_supported() && want->rc == 0 && got->jit_compiled == 0 ? "nothing was compiled" : NULL;
+}
+
+static void fused(LiminalContext *ctx, const char *tmp) {
+  (void)tmp;
+  ctx->fuse = 1;
+}
+
+static void quickened(LiminalContext *ctx, const char *tmp) {
+  (void)tmp;
+  ctx->quicken = 1;
+}
+
+// The reference run records a profile of the program; the run under test
+// optimizes against it
+static void pgo_want(LiminalContext *ctx, const char *tmp) {
+  ctx->pgo_out = tmp;
+}
+
+static void pgo_got(LiminalContext *ctx, const char *tmp) {
+  ctx->pgo_in = tmp;
+}
+
+static const DiffMode MODES[] = {
+  { "jit", "--jit output differs", plain, jit_got, jit_check },
+  { "fuse", "output differs with superinstructions", plain, fused, NULL },
+  { "quicken", "output differs when quickened", plain, quickened, NULL },
+  { "pgo", "output differs with its profile applied", pgo_want, pgo_got, NULL },
+};
+
+static const DiffMode *mode;
+
+static RunOutput run_program(Oracle *oracle, const char *path, void (*setup)(LiminalContext *, const char *),
+                             const char *tmp) {
+  RunOutput r = {0};
+  size_t len = 0;
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  ctx.in = fmemopen((void *)INPUT, strlen(INPUT), "r");
+  ctx.out = open_memstream(&r.out, &len);
+  setup(&ctx, tmp);
+  liminal_context_set_oracle(&ctx, oracle, 0);
+  r.rc = liminal_run_file_ctx(&ctx, path);
+  FILE *in = ctx.in, *out = ctx.out;
+  r.jit_compiled = ctx.jit_compiled;
+  liminal_context_free(&ctx);
+  fclose(in);
+  fclose(out);
+  return r;
+}
+
+static size_t diff_directory(Oracle *oracle, const char *rel, size_t *programs) {
+  char dir[512]; snprintf(dir, sizeof(dir), "%s/%s", SOURCE_DIR, rel);
+  DIR *d = opendir(dir);
+  if (!d) return 1;
+  size_t mismatches = 0;
+  struct dirent *e;
+  while ((e = readdir(d)) != NULL) {
+    size_t n = strlen(e->d_name);
+    if (n < 5 || strcmp(e->d_name + n - 4, ".lim") != 0) continue;
+#ifndef EXAMPLE_DIFF_BENCH
+    if (strstr(e->d_name, "_bench_")) continue;
+#endif
+    char path[1024]; snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+    char tmp[] = "/tmp/liminal_diffXXXXXX";
+    int fd = mkstemp(tmp);
+    if (fd >= 0) close(fd);
+    RunOutput want = run_program(oracle, path, mode->want, tmp);
+    RunOutput got = run_program(oracle, path, mode->got, tmp);
+    const char *bad = NULL;
+    if (got.rc != want.rc || strcmp(got.out, want.out) != 0) bad = mode->differs;
+    else if (mode->check) bad = mode->check(&want, &got);
+    if (bad) {
+      fprintf(stderr, "%s/%s: %s\n", rel, e->d_name, bad);
+      mismatches++;
+    }
+    (*programs)++;
+    free(want.out); free(got.out);
+    unlink(tmp);
+  }
+  closedir(d);
+  return mismatches;
+}
+
+static void test_examples_match(void) {
+  char rec[512]; snprintf(rec, sizeof(rec), "%s/tests/recordings/examples.jsonl", SOURCE_DIR);
+  Oracle *oracle = oracle_with_recording(oracle_create_mock(), "replay", rec);
+  // File I/O examples write relative paths; keep them out of the source tree
+  char cwd[1024]; ASSERT_TRUE(getcwd(cwd, sizeof(cwd)) != NULL);
+  char tmp[] = "/tmp/liminal_examples_XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmp) != NULL);
+  ASSERT_TRUE(chdir(tmp) == 0);
+  size_t programs = 0;
+  size_t mismatches = diff_directory(oracle, "examples", &programs) + diff_directory(oracle, "examples/opus", &programs);
+  ASSERT_TRUE(chdir(cwd) == 0);
+  char cmd[128]; snprintf(cmd, sizeof(cmd), "rm -rf '%s'", tmp);
+  ASSERT_TRUE(system(cmd) == 0);
+  oracle_free(oracle);
+  ASSERT_TRUE(programs >= 50);
+  ASSERT_TRUE(mismatches == 0);
+}
+
+int main(int argc, char **argv) {
+  size_t nmodes = sizeof(MODES) / sizeof(MODES[0]);
+  for (size_t k = 0; k < nmodes; k++) {
+    int picked = argc < 2;
+    for (int i = 1; i < argc; i++) picked |= strcmp(argv[i], MODES[k].name) == 0;
+    if (!picked) continue;
+    mode = &MODES[k];
+    char name[64]; snprintf(name, sizeof(name), "examples_match_%s", mode->name);
+    run_test(name, test_examples_match);
+  }
+  if (get_tests_run() == 0) {
+    fprintf(stderr, "no such mode\n");
+    return 1;
+  }
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All example diff tests passed (%d)\n", get_tests_run());
+  return 0;
+}
@@ -1,5 +1,6 @@
 #define _POSIX_C_SOURCE 200809L
 #include "liminal/exec.h"
+#include "liminal/oracles.h"
 #include "test_harness.h"
 
 #include <stdio.h>
@@ -66,12 +67,75 @@ static void test_exec_opus_c07_gcd_lcm_regression(void) {
   free(outbuf);
 }
 
+static void test_exec_context_reentrant(void) {
+  char path[256]; snprintf(path, sizeof(path), "%s/examples/opus/c04_array_ops.lim", SOURCE_DIR);
+  char *buf1 = NULL, *buf2 = NULL; size_t len1 = 0, len2 = 0;
+  LiminalContext a, b;
+  liminal_context_init(&a);
+  liminal_context_init(&b);
+  a.out = open_memstream(&buf1, &len1);
+  b.out = open_memstream(&buf2, &len2);
+  int rc1 = liminal_run_file_ctx(&a, path);
+  int rc2 = liminal_run_file_ctx(&b, path);
+  FILE *out_a = a.out, *out_b = b.out;
+  liminal_context_free(&a);
+  liminal_context_free(&b);
+  fclose(out_a); fclose(out_b);
+  ASSERT_TRUE(rc1 == 0 && rc2 == 0);
+  ASSERT_EQ_STR(buf1, buf2);
+  ASSERT_TRUE(a.allocs > 0);
+  ASSERT_TRUE(a.allocs == a.frees);
+  ASSERT_TRUE(a.allocs == b.allocs);
+  free(buf1); free(buf2);
+}
+
+typedef struct {
+  int rc;
+  char *out;
+  size_t quickened, deopts, allocs, frees;
+} QuickRun;
+
+static QuickRun run_quickened(Oracle *oracle, const char *path, const char *input, int quicken) {
+  QuickRun r = {0};
+  size_t len = 0;
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  ctx.in = fmemopen((void *)input, strlen(input), "r");
+  ctx.out = open_memstream(&r.out, &len);
+  ctx.quicken = quicken;
+  if (oracle) liminal_context_set_oracle(&ctx, oracle, 0);
+  r.rc = liminal_run_file_ctx(&ctx, path);
+  FILE *in = ctx.in, *out = ctx.out;
+  r.quickened = ctx.quickened; r.deopts = ctx.deopts; r.allocs = ctx.allocs; r.frees = ctx.frees;
+  liminal_context_free(&ctx);
+  fclose(in); fclose(out);
+  return r;
+}
+
+// ReadLn values change kind under a quickened loop: Integer, Real, String
+static void test_exec_quicken_deopt(void) {
+  char path[256]; snprintf(path, sizeof(path), "%s/tests/fixtures/exec_readln_kinds.lim", SOURCE_DIR);
+  const char *input = "1\n2\n3\n2.5\nabc\n4\n";
+  QuickRun want = run_quickened(NULL, path, input, 0);
+  QuickRun got = run_quickened(NULL, path, input, 1);
+  ASSERT_TRUE(want.rc == 0 && got.rc == 0);
+  ASSERT_CONTAINS(want.out, "3 6 False\n2.5 8.5 True\n");
+  ASSERT_EQ_STR(want.out, got.out);
+  ASSERT_TRUE(want.quickened == 0);
+  ASSERT_TRUE(got.quickened > 0);
+  ASSERT_TRUE(got.deopts > 0);
+  ASSERT_TRUE(got.allocs == got.frees);
+  free(want.out); free(got.out);
+}
+
 int main(void) {
   run_test("exec_hello", test_exec_hello);
   run_test("exec_add", test_exec_add);
   run_test("exec_opus_t17_array_regression", test_exec_opus_t17_array_regression);
   run_test("exec_opus_c03_traffic_light_regression", test_exec_opus_c03_traffic_light_regression);
   run_test("exec_opus_c07_gcd_lcm_regression", test_exec_opus_c07_gcd_lcm_regression);
+  run_test("exec_context_reentrant", test_exec_context_reentrant);
+  run_test("exec_quicken_deopt", test_exec_quicken_deopt);
 
   if (get_tests_failed() > 0) {
     fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
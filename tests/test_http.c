@@ -0,0 +1,393 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/http.h"
+#include "liminal/oracles.h"
+#include "liminal/profiler.h"
+#include "test_harness.h"
+
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// HTTP client against a local stand-in server: keep-alive reuse, chunked
+// bodies, servers that close, timeouts, and the Ollama provider on top.
+
+typedef enum {
+  SERVE_LENGTH,       // Content-Length, connection kept
+  SERVE_CHUNKED,      // 100 Continue, then a chunked body with a trailer
+  SERVE_CLOSE,        // Connection: close
+  SERVE_DROP,         // kept per the headers, then closed anyway
+  SERVE_SILENT,       // never answers
+  SERVE_OLLAMA,
+  SERVE_OLLAMA_ERROR,
+  SERVE_OLLAMA_STREAM,       // NDJSON; the rest waits until the client saw the first piece
+  SERVE_OLLAMA_STREAM_ERROR, // NDJSON ending in an error line
+} ServeMode;
+
+typedef struct {
+  int listen_fd;
+  int port;
+  ServeMode mode;
+  int accepted;
+  int requests;
+  char last_path[256];
+  char last_body[4096];
+  pthread_t thread;
+  pthread_mutex_t gate_lock;
+  pthread_cond_t gate;
+  int first_seen;       // set by the client on its first streamed piece
+  int gated;            // the server saw first_seen before sending the rest
+} StandIn;
+
+static void send_str(int fd, const char *s) {
+  size_t n = strlen(s);
+  while (n) {
+    ssize_t w = send(fd, s, n, MSG_NOSIGNAL);
+    if (w <= 0) return;
+    s += w;
+    n -= (size_t)w;
+  }
+}
+
+// Reads one request; 0 once the client has closed
+static int read_request(StandIn *st, int fd) {
+  char buf[8192];
+  size_t len = 0;
+  char *end = NULL;
+  while (!end) {
+    ssize_t n = recv(fd, buf + len, sizeof(buf) - 1 - len, 0);
+    if (n <= 0) return 0;
+    len += (size_t)n;
+    buf[len] = '\0';
+    end = strstr(buf, "\r\n\r\n");
+  }
+  sscanf(buf, "POST %255s", st->last_path);
+  const char *cl = strstr(buf, "Content-Length: ");
+  size_t want = cl ? (size_t)atol(cl + 16) : 0;
+  size_t have = len - (size_t)(end + 4 - buf);
+  memcpy(st->last_body, end + 4, have);
+  while (have < want) {
+    ssize_t n = recv(fd, st->last_body + have, want - have, 0);
+    if (n <= 0) return 0;
+    have += (size_t)n;
+  }
+  st->last_body[have] = '\0';
+  st->requests++;
+  return 1;
+}
+
+static void send_chunk(int fd, const char *data) {
+  char size[32];
+  snprintf(size, sizeof(size), "%zx\r\n", strlen(data));
+  send_str(fd, size);
+  send_str(fd, data);
+  send_str(fd, "\r\n");
+}
+
+// Lines split across chunks on purpose
+static void stream_ndjson(StandIn *st, int fd) {
+  send_str(fd, "HTTP/1.1 200 OK\r\nContent-Type: application/x-ndjson\r\nTransfer-Encoding: chunked\r\n\r\n");
+  send_chunk(fd, "{\"model\":\"m\",\"response\":\"Hel\",\"done\":false}\n");
+  struct timespec until;
+  clock_gettime(CLOCK_REALTIME, &until);
+  until.tv_sec += 2;
+  pthread_mutex_lock(&st->gate_lock);
+  while (!st->first_seen && pthread_cond_timedwait(&st->gate, &st->gate_lock, &until) == 0) {}
+  st->gated = st->first_seen;
+  pthread_mutex_unlock(&st->gate_lock);
+  if (st->mode == SERVE_OLLAMA_STREAM_ERROR) {
+    send_chunk(fd, "{\"error\":\"out of memory\"}\n");
+  } else {
+    send_chunk(fd, "{\"model\":\"m\",\"response\":\"lo, \\u003cw\",\"done\":false}\n{\"model\":\"m\",\"resp");
+    send_chunk(fd, "onse\":\"orld\\u003e \\\"done\\\":true\",\"done\":false}\n{\"model\":\"m\",\"response\":\"\",\"done\":true,\"eval_count\":3}\n");
+  }
+  send_str(fd, "0\r\n\r\n");
+}
+
+static void respond(StandIn *st, int fd, int *keep) {
+  char out[8192];
+  // The nested "response" is not the answer; the pair is one code point
+  const char *ollama = "{\"model\":\"m\",\"options\":{\"response\":\"no\"},"
+                       "\"response\":\"pong \\\"quoted\\\" \\u003cb\\u003e \\ud83d\\ude00\",\"done\":true}";
+  switch (st->mode) {
+  case SERVE_LENGTH:
+  case SERVE_DROP:
+    snprintf(out, sizeof(out), "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n\r\necho:%s", strlen(st->last_body) + 5, st->last_body);
+    *keep = st->mode == SERVE_LENGTH;
+    break;
+  case SERVE_CHUNKED:
+    snprintf(out, sizeof(out), "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+             "5;ext=1\r\necho:\r\n%zx\r\n%s\r\n0\r\nX-Trailer: y\r\n\r\n", strlen(st->last_body), st->last_body);
+    break;
+  case SERVE_CLOSE:
+    snprintf(out, sizeof(out), "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 2\r\n\r\nok");
+    *keep = 0;
+    break;
+  case SERVE_SILENT:
+    return;
+  case SERVE_OLLAMA:
+    snprintf(out, sizeof(out), "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n\r\n%s", strlen(ollama), ollama);
+    break;
+  case SERVE_OLLAMA_ERROR:
+    snprintf(out, sizeof(out), "HTTP/1.1 404 Not Found\r\nContent-Length: 32\r\n\r\n{\"error\":\"model 'm' not found\"}\n");
+    break;
+  case SERVE_OLLAMA_STREAM:
+  case SERVE_OLLAMA_STREAM_ERROR:
+    stream_ndjson(st, fd);
+    return;
+  }
+  send_str(fd, out);
+}
+
+static void *serve(void *arg) {
+  StandIn *st = arg;
+  for (;;) {
+    int fd = accept(st->listen_fd, NULL, NULL);
+    if (fd < 0) return NULL;
+    st->accepted++;
+    int keep = 1;
+    while (keep && read_request(st, fd)) respond(st, fd, &keep);
+    close(fd);
+  }
+}
+
+static void stand_in_start(StandIn *st, ServeMode mode) {
+  memset(st, 0, sizeof(*st));
+  st->mode = mode;
+  pthread_mutex_init(&st->gate_lock, NULL);
+  pthread_cond_init(&st->gate, NULL);
+  st->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(st->listen_fd, (struct sockaddr *)&addr, sizeof(addr));
+  listen(st->listen_fd, 8);
+  socklen_t len = sizeof(addr);
+  getsockname(st->listen_fd, (struct sockaddr *)&addr, &len);
+  st->port = ntohs(addr.sin_port);
+  pthread_create(&st->thread, NULL, serve, st);
+}
+
+// Clients must have closed their connections first
+static void stand_in_stop(StandIn *st) {
+  shutdown(st->listen_fd, SHUT_RDWR);
+  close(st->listen_fd);
+  pthread_join(st->thread, NULL);
+  pthread_mutex_destroy(&st->gate_lock);
+  pthread_cond_destroy(&st->gate);
+}
+
+static HttpPool *pool_for(const StandIn *st, const char *path) {
+  char url[128];
+  snprintf(url, sizeof(url), "http://127.0.0.1:%d%s", st->port, path);
+  char *err = NULL;
+  HttpPool *p = http_pool_new(url, &err);
+  free(err);
+  return p;
+}
+
+static void post_ok(HttpPool *p, const char *body, const char *expect) {
+  HttpResponse r;
+  char *err = NULL;
+  ASSERT_TRUE(http_post(p, "/echo", "text/plain", body, strlen(body), &r, &err));
+  ASSERT_TRUE(err == NULL);
+  ASSERT_TRUE(r.status == 200);
+  ASSERT_EQ_STR(expect, r.body);
+  ASSERT_TRUE(r.len == strlen(expect));
+  http_response_free(&r);
+}
+
+static void test_keeps_connection(void) {
+  StandIn st;
+  stand_in_start(&st, SERVE_LENGTH);
+  HttpPool *p = pool_for(&st, "/v1/");
+  ASSERT_EQ_STR("/v1", p->prefix);
+  post_ok(p, "one", "echo:one");
+  post_ok(p, "two", "echo:two");
+  post_ok(p, "", "echo:");
+  ASSERT_EQ_STR("/v1/echo", st.last_path);
+  ASSERT_TRUE(p->connects == 1);
+  ASSERT_TRUE(p->nidle == 1);
+  http_pool_free(p);
+  stand_in_stop(&st);
+  ASSERT_TRUE(st.accepted == 1 && st.requests == 3);
+}
+
+static void test_decodes_chunked(void) {
+  StandIn st;
+  stand_in_start(&st, SERVE_CHUNKED);
+  HttpPool *p = pool_for(&st, "");
+  post_ok(p, "first", "echo:first");
+  post_ok(p, "a longer second body", "echo:a longer second body");
+  ASSERT_TRUE(p->connects == 1);
+  http_pool_free(p);
+  stand_in_stop(&st);
+  ASSERT_TRUE(st.accepted == 1);
+}
+
+static void test_honours_close(void) {
+  StandIn st;
+  stand_in_start(&st, SERVE_CLOSE);
+  HttpPool *p = pool_for(&st, "");
+  post_ok(p, "x", "ok");
+  post_ok(p, "y", "ok");
+  ASSERT_TRUE(p->connects == 2);
+  ASSERT_TRUE(p->nidle == 0);
+  http_pool_free(p);
+  stand_in_stop(&st);
+}
+
+static void test_retries_dropped_connection(void) {
+  StandIn st;
+  stand_in_start(&st, SERVE_DROP);
+  HttpPool *p = pool_for(&st, "");
+  post_ok(p, "a", "echo:a");
+  post_ok(p, "b", "echo:b");
+  post_ok(p, "c", "echo:c");
+  ASSERT_TRUE(p->connects == 3);
+  http_pool_free(p);
+  stand_in_stop(&st);
+  ASSERT_TRUE(st.requests == 3);
+}
+
+static void test_times_out(void) {
+  StandIn st;
+  stand_in_start(&st, SERVE_SILENT);
+  HttpPool *p = pool_for(&st, "");
+  p->io_timeout_ms = 100;
+  HttpResponse r;
+  char *err = NULL;
+  uint64_t t0 = profiler_now_ns();
+  ASSERT_TRUE(!http_post(p, "/", "text/plain", "hi", 2, &r, &err));
+  ASSERT_TRUE(profiler_now_ns() - t0 < 2000000000ull);
+  ASSERT_CONTAINS(err, "timed out");
+  free(err);
+  http_pool_free(p);
+  stand_in_stop(&st);
+}
+
+static void test_reports_connect_errors(void) {
+  // A port nothing listens on
+  StandIn st;
+  stand_in_start(&st, SERVE_LENGTH);
+  stand_in_stop(&st);
+  HttpPool *p = pool_for(&st, "");
+  HttpResponse r;
+  char *err = NULL;
+  ASSERT_TRUE(!http_post(p, "/", "text/plain", "", 0, &r, &err));
+  ASSERT_CONTAINS(err, "connect to 127.0.0.1:");
+  free(err);
+  http_pool_free(p);
+  err = NULL;
+  ASSERT_TRUE(http_pool_new("https://example.com", &err) == NULL);
+  ASSERT_CONTAINS(err, "only http://");
+  free(err);
+  err = NULL;
+  ASSERT_TRUE(http_pool_new("http://host:port", &err) == NULL);
+  ASSERT_CONTAINS(err, "malformed URL");
+  free(err);
+}
+
+static void test_ollama_provider(void) {
+  StandIn st;
+  stand_in_start(&st, SERVE_OLLAMA);
+  char url[64];
+  snprintf(url, sizeof(url), "http://127.0.0.1:%d", st.port);
+  Oracle *o = oracle_create_ollama(url, "m");
+  for (int i = 0; i < 2; i++) {
+    OracleResult r = oracle_call_text(o, "Say \"pong\".\n");
+    ASSERT_TRUE(r.ok);
+    ASSERT_EQ_STR("pong \"quoted\" <b> \xf0\x9f\x98\x80", r.text);
+    oracle_result_free(r);
+  }
+  ASSERT_EQ_STR("/api/generate", st.last_path);
+  ASSERT_EQ_STR("{\"model\":\"m\",\"prompt\":\"Say \\\"pong\\\".\\n\",\"stream\":false}", st.last_body);
+  st.mode = SERVE_OLLAMA_ERROR;
+  OracleResult r = oracle_call_text(o, "again");
+  ASSERT_TRUE(!r.ok);
+  ASSERT_EQ_STR("ollama HTTP 404: model 'm' not found", r.error);
+  oracle_result_free(r);
+  oracle_free(o);
+  stand_in_stop(&st);
+  // One connection for all three asks
+  ASSERT_TRUE(st.accepted == 1);
+
+  o = oracle_create_ollama("https://localhost:11434", "m");
+  r = oracle_call_text(o, "x");
+  ASSERT_TRUE(!r.ok);
+  ASSERT_CONTAINS(r.error, "only http://");
+  oracle_result_free(r);
+  oracle_free(o);
+}
+
+typedef struct {
+  StandIn *st;
+  char text[128];
+  int chunks;
+} Received;
+
+static int open_gate(void *user, const char *chunk, size_t len) {
+  Received *rc = user;
+  snprintf(rc->text + strlen(rc->text), sizeof(rc->text) - strlen(rc->text), "%.*s|", (int)len, chunk);
+  if (rc->chunks++ == 0) {
+    pthread_mutex_lock(&rc->st->gate_lock);
+    rc->st->first_seen = 1;
+    pthread_cond_signal(&rc->st->gate);
+    pthread_mutex_unlock(&rc->st->gate_lock);
+  }
+  return 1;
+}
+
+static void test_ollama_streams(void) {
+  StandIn st;
+  stand_in_start(&st, SERVE_OLLAMA_STREAM);
+  char url[64];
+  snprintf(url, sizeof(url), "http://127.0.0.1:%d", st.port);
+  Oracle *o = oracle_create_ollama(url, "m");
+  Received rc = { &st, "", 0 };
+  OracleResult r = oracle_stream_text(o, "hi", open_gate, &rc);
+  ASSERT_TRUE(r.ok);
+  // A piece that reads like the end is still only text
+  ASSERT_EQ_STR("Hello, <world> \"done\":true", r.text);
+  ASSERT_EQ_STR("Hel|lo, <w|orld> \"done\":true|", rc.text);
+  // The first piece arrived while the server still held back the rest
+  ASSERT_TRUE(st.gated);
+  ASSERT_EQ_STR("{\"model\":\"m\",\"prompt\":\"hi\",\"stream\":true}", st.last_body);
+  oracle_result_free(r);
+
+  st.mode = SERVE_OLLAMA_STREAM_ERROR;
+  st.first_seen = 0;
+  Received again = { &st, "", 0 };
+  r = oracle_stream_text(o, "hi", open_gate, &again);
+  ASSERT_TRUE(!r.ok);
+  ASSERT_EQ_STR("out of memory", r.error);
+  ASSERT_EQ_STR("Hel|", again.text);
+  oracle_result_free(r);
+  oracle_free(o);
+  stand_in_stop(&st);
+  // The finished stream left its connection for the next ask
+  ASSERT_TRUE(st.accepted == 1);
+}
+
+int main(void) {
+  run_test("keeps_connection", test_keeps_connection);
+  run_test("decodes_chunked", test_decodes_chunked);
+  run_test("honours_close", test_honours_close);
+  run_test("retries_dropped_connection", test_retries_dropped_connection);
+  run_test("times_out", test_times_out);
+  run_test("reports_connect_errors", test_reports_connect_errors);
+  run_test("ollama_provider", test_ollama_provider);
+  run_test("ollama_streams", test_ollama_streams);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All http tests passed (%d)\n", get_tests_run());
+  return 0;
+}
@@ -0,0 +1,410 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/http_loop.h"
+#include "liminal/oracles.h"
+#include "liminal/profiler.h"
+#include "test_harness.h"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// The HTTP event loop against a mock server that answers every request a
+// set latency after reading it, however many are waiting: hundreds of
+// requests in flight on the loop's one thread, kept connections, bodies
+// that trickle in, failures, and Ollama asks started without threads.
+
+#define MOCK_CONNS 512
+
+typedef struct {
+  int fd;
+  char in[8192];
+  size_t in_len;
+  uint64_t due;          // ns; answers once it passes, 0 when none is waiting
+  char *out;             // answer being sent
+  size_t out_len, out_pos;
+} MockConn;
+
+typedef struct {
+  int listen_fd;
+  int port;
+  long latency_ms;
+  int trickle;           // send answers a few bytes at a time
+  int close_after;       // claim keep-alive, then close after each answer
+  int stop[2];
+  pthread_t thread;
+  MockConn conns[MOCK_CONNS];
+  size_t nconns;
+  // Counted by the server thread; read after mock_stop
+  int accepted, requests, waiting, peak_waiting;
+} MockServer;
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// The answer to a complete request: Ollama JSON echoing the prompt for
+// /api/generate, a chunked echo after a 100 Continue for /chunked, and a
+// Content-Length echo for anything else
+static char *answer_for(const char *path, const char *body) {
+  char *out = malloc(16384);
+  if (strcmp(path, "/api/generate") == 0) {
+    const char *p = strstr(body, "\"prompt\":\"");
+    int n = p ? (int)strcspn(p + 10, "\"") : 0;
+    char json[4096];
+    int len = snprintf(json, sizeof(json), "{\"model\":\"m\",\"response\":\"re %.*s\",\"done\":true}", n, p ? p + 10 : "");
+    snprintf(out, 16384, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n%s", len, json);
+  } else if (strcmp(path, "/chunked") == 0) {
+    snprintf(out, 16384, "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+             "5;ext=1\r\necho:\r\n%zx\r\n%s\r\n0\r\nX-Trailer: y\r\n\r\n", strlen(body), body);
+  } else {
+    snprintf(out, 16384, "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n\r\necho:%s", strlen(body) + 5, body);
+  }
+  return out;
+}
+
+static void drop_conn(MockServer *s, size_t i) {
+  if (s->conns[i].due) s->waiting--;
+  close(s->conns[i].fd);
+  free(s->conns[i].out);
+  s->conns[i] = s->conns[--s->nconns];
+}
+
+// Takes a whole request off the buffer once it is in
+static void read_request(MockServer *s, MockConn *c) {
+  c->in[c->in_len] = '\0';
+  char *end = strstr(c->in, "\r\n\r\n");
+  if (!end || c->due || c->out) return;
+  const char *cl = strstr(c->in, "Content-Length: ");
+  size_t want = cl ? (size_t)atol(cl + 16) : 0;
+  size_t head = (size_t)(end + 4 - c->in);
+  if (c->in_len < head + want) return;
+  char path[256] = "";
+  sscanf(c->in, "POST %255s", path);
+  char body[4096];
+  memcpy(body, c->in + head, want);
+  body[want] = '\0';
+  c->out = answer_for(path, body);
+  c->out_len = strlen(c->out);
+  c->out_pos = 0;
+  c->in_len -= head + want;
+  memmove(c->in, c->in + head + want, c->in_len);
+  c->due = now_ns() + (uint64_t)s->latency_ms * 1000000ull;
+  s->requests++;
+  if (++s->waiting > s->peak_waiting) s->peak_waiting = s->waiting;
+}
+
+static void *serve(void *arg) {
+  MockServer *s = arg;
+  struct pollfd pfds[MOCK_CONNS + 2];
+  for (;;) {
+    uint64_t now = now_ns();
+    int timeout = -1;
+    pfds[0] = (struct pollfd){ s->stop[0], POLLIN, 0 };
+    pfds[1] = (struct pollfd){ s->listen_fd, POLLIN, 0 };
+    for (size_t i = 0; i < s->nconns; i++) {
+      MockConn *c = &s->conns[i];
+      int sending = c->out && !c->due;
+      pfds[i + 2] = (struct pollfd){ c->fd, (short)(sending ? POLLOUT : POLLIN), 0 };
+      int ms = c->due ? (c->due <= now ? 0 : (int)((c->due - now) / 1000000 + 1)) : sending && s->trickle ? 1 : -1;
+      if (ms >= 0 && (timeout < 0 || ms < timeout)) timeout = ms;
+    }
+    size_t n = s->nconns;
+    if (poll(pfds, n + 2, timeout) < 0) continue;
+    if (pfds[0].revents) break;
+    now = now_ns();
+    for (size_t i = n; i-- > 0;) {
+      MockConn *c = &s->conns[i];
+      if (c->due && c->due <= now) {
+        c->due = 0;
+        s->waiting--;
+      }
+      if (pfds[i + 2].revents & POLLIN) {
+        ssize_t got = recv(c->fd, c->in + c->in_len, sizeof(c->in) - 1 - c->in_len, 0);
+        if (got <= 0) { drop_conn(s, i); continue; }
+        c->in_len += (size_t)got;
+        read_request(s, c);
+      } else if (c->out && !c->due && (pfds[i + 2].revents & POLLOUT)) {
+        size_t take = c->out_len - c->out_pos;
+        if (s->trickle && take > 7) take = 7;
+        ssize_t w = send(c->fd, c->out + c->out_pos, take, MSG_NOSIGNAL);
+        if (w > 0) c->out_pos += (size_t)w;
+        if (c->out_pos == c->out_len) {
+          free(c->out);
+          c->out = NULL;
+          if (s->close_after) { drop_conn(s, i); continue; }
+          read_request(s, c);
+        }
+      }
+    }
+    if ((pfds[1].revents & POLLIN) && s->nconns < MOCK_CONNS) {
+      int fd = accept(s->listen_fd, NULL, NULL);
+      if (fd >= 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        memset(&s->conns[s->nconns], 0, sizeof(MockConn));
+        s->conns[s->nconns++].fd = fd;
+        s->accepted++;
+      }
+    }
+  }
+  while (s->nconns) drop_conn(s, s->nconns - 1);
+  return NULL;
+}
+
+static MockServer *mock_start(long latency_ms) {
+  MockServer *s = calloc(1, sizeof(MockServer));
+  s->latency_ms = latency_ms;
+  if (pipe(s->stop) != 0) abort();
+  s->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(s->listen_fd, (struct sockaddr *)&addr, sizeof(addr));
+  listen(s->listen_fd, MOCK_CONNS);
+  socklen_t len = sizeof(addr);
+  getsockname(s->listen_fd, (struct sockaddr *)&addr, &len);
+  s->port = ntohs(addr.sin_port);
+  pthread_create(&s->thread, NULL, serve, s);
+  return s;
+}
+
+static void mock_stop(MockServer *s) {
+  ssize_t w = write(s->stop[1], "x", 1);
+  (void)w;
+  pthread_join(s->thread, NULL);
+  close(s->listen_fd);
+  close(s->stop[0]);
+  close(s->stop[1]);
+}
+
+static HttpPool *pool_for(const MockServer *s) {
+  char url[64];
+  snprintf(url, sizeof(url), "http://127.0.0.1:%d", s->port);
+  return http_pool_new(url, NULL);
+}
+
+static HttpLoop *loop_new(void) {
+  char *err = NULL;
+  HttpLoop *l = http_loop_new(&err);
+  free(err);
+  return l;
+}
+
+static void expect_echo(HttpCall *c, const char *expect) {
+  HttpResponse r;
+  char *err = NULL;
+  ASSERT_TRUE(http_call_wait(c, &r, &err));
+  ASSERT_TRUE(err == NULL);
+  ASSERT_TRUE(r.status == 200);
+  ASSERT_EQ_STR(expect, r.body);
+  ASSERT_TRUE(r.len == strlen(expect));
+  http_response_free(&r);
+}
+
+static void test_multiplexes_requests(void) {
+  enum { N = 200 };
+  MockServer *s = mock_start(200);
+  HttpPool *p = pool_for(s);
+  HttpLoop *l = loop_new();
+  ASSERT_TRUE(l != NULL);
+  HttpCall *calls[N];
+  char body[32], expect[32];
+  uint64_t t0 = profiler_now_ns();
+  for (int i = 0; i < N; i++) {
+    snprintf(body, sizeof(body), "n%d", i);
+    calls[i] = http_loop_post(l, p, "/echo", "text/plain", body, strlen(body));
+  }
+  for (int i = 0; i < N; i++) {
+    snprintf(expect, sizeof(expect), "echo:n%d", i);
+    expect_echo(calls[i], expect);
+  }
+  // One after the other they would take 40 s
+  ASSERT_TRUE(profiler_now_ns() - t0 < 3000000000ull);
+  HttpLoopStats st;
+  http_loop_stats(l, &st);
+  ASSERT_TRUE(st.peak == N && st.in_flight == 0 && st.connects == N);
+
+  // A second round reuses the kept connections
+  for (int i = 0; i < HTTP_LOOP_IDLE; i++) calls[i] = http_loop_post(l, p, "/echo", "text/plain", "again", 5);
+  for (int i = 0; i < HTTP_LOOP_IDLE; i++) expect_echo(calls[i], "echo:again");
+  http_loop_stats(l, &st);
+  ASSERT_TRUE(st.requests == N + HTTP_LOOP_IDLE && st.connects == N);
+  ASSERT_TRUE(p->connects == N);
+  http_loop_free(l);
+  http_pool_free(p);
+  mock_stop(s);
+  ASSERT_TRUE(s->accepted == N && s->requests == N + HTTP_LOOP_IDLE);
+  ASSERT_TRUE(s->peak_waiting >= N / 2);
+  free(s);
+}
+
+typedef struct {
+  HttpCall *call;
+  char body[64];
+  int ok;
+} Waiter;
+
+static void *wait_elsewhere(void *arg) {
+  Waiter *w = arg;
+  HttpResponse r;
+  w->ok = http_call_wait(w->call, &r, NULL);
+  if (w->ok) snprintf(w->body, sizeof(w->body), "%s", r.body);
+  http_response_free(&r);
+  return NULL;
+}
+
+static void test_hands_off_completions(void) {
+  MockServer *s = mock_start(100);
+  HttpPool *p = pool_for(s);
+  HttpLoop *l = loop_new();
+  Waiter w = { http_loop_post(l, p, "/echo", "text/plain", "handed", 6), "", 0 };
+  ASSERT_TRUE(!http_call_done(w.call));
+  pthread_t t;
+  pthread_create(&t, NULL, wait_elsewhere, &w);
+  pthread_join(t, NULL);
+  ASSERT_TRUE(w.ok);
+  ASSERT_EQ_STR("echo:handed", w.body);
+  HttpCall *c = http_loop_post(l, p, "/echo", "text/plain", "polled", 6);
+  while (!http_call_done(c)) {
+    struct timespec ts = { 0, 5000000 };
+    nanosleep(&ts, NULL);
+  }
+  expect_echo(c, "echo:polled");
+  ASSERT_TRUE(p->connects == 1);
+  http_loop_free(l);
+  http_pool_free(p);
+  mock_stop(s);
+  free(s);
+}
+
+static void test_parses_trickled_bodies(void) {
+  MockServer *s = mock_start(0);
+  s->trickle = 1;
+  HttpPool *p = pool_for(s);
+  HttpLoop *l = loop_new();
+  expect_echo(http_loop_post(l, p, "/chunked", "text/plain", "first", 5), "echo:first");
+  expect_echo(http_loop_post(l, p, "/echo", "text/plain", "", 0), "echo:");
+  expect_echo(http_loop_post(l, p, "/chunked", "text/plain", "a longer second body", 20), "echo:a longer second body");
+  ASSERT_TRUE(p->connects == 1);
+  http_loop_free(l);
+  http_pool_free(p);
+  mock_stop(s);
+  ASSERT_TRUE(s->accepted == 1 && s->requests == 3);
+  free(s);
+}
+
+static void test_reports_failures(void) {
+  // A server that closes what it said it would keep
+  MockServer *s = mock_start(0);
+  s->close_after = 1;
+  HttpPool *p = pool_for(s);
+  HttpLoop *l = loop_new();
+  const char *bodies[] = { "a", "b", "c" };
+  for (int i = 0; i < 3; i++) {
+    char expect[16];
+    snprintf(expect, sizeof(expect), "echo:%s", bodies[i]);
+    expect_echo(http_loop_post(l, p, "/echo", "text/plain", bodies[i], 1), expect);
+  }
+  ASSERT_TRUE(p->connects == 3);
+  http_loop_free(l);
+  http_pool_free(p);
+  mock_stop(s);
+  free(s);
+
+  // One that takes too long, on a kept connection: the request is not sent
+  // again, since the server may still be working on it
+  s = mock_start(300);
+  p = pool_for(s);
+  p->io_timeout_ms = 5000;
+  l = loop_new();
+  expect_echo(http_loop_post(l, p, "/echo", "text/plain", "hi", 2), "echo:hi");
+  p->io_timeout_ms = 100;
+  HttpResponse r;
+  char *err = NULL;
+  uint64_t t0 = profiler_now_ns();
+  ASSERT_TRUE(!http_call_wait(http_loop_post(l, p, "/echo", "text/plain", "hi", 2), &r, &err));
+  ASSERT_TRUE(profiler_now_ns() - t0 < 2000000000ull);
+  ASSERT_EQ_STR("reading response: timed out", err);
+  ASSERT_TRUE(r.body == NULL);
+  ASSERT_TRUE(p->connects == 1);
+  free(err);
+
+  // And none at all
+  int port = s->port;
+  http_loop_free(l);
+  http_pool_free(p);
+  mock_stop(s);
+  ASSERT_TRUE(s->requests == 2);
+  free(s);
+  char url[64];
+  snprintf(url, sizeof(url), "http://127.0.0.1:%d", port);
+  p = http_pool_new(url, NULL);
+  l = loop_new();
+  err = NULL;
+  ASSERT_TRUE(!http_call_wait(http_loop_post(l, p, "/", "text/plain", "", 0), &r, &err));
+  ASSERT_CONTAINS(err, "connect to 127.0.0.1:");
+  free(err);
+  http_loop_free(l);
+  http_pool_free(p);
+}
+
+static void test_ollama_asks_in_flight(void) {
+  enum { N = 100 };
+  MockServer *s = mock_start(200);
+  char url[64];
+  snprintf(url, sizeof(url), "http://127.0.0.1:%d", s->port);
+  Oracle *o = oracle_create_ollama(url, "m");
+  oracle_set_max_concurrency(o, 0);
+  OracleCall *calls[N];
+  char prompt[32], expect[32];
+  uint64_t t0 = profiler_now_ns();
+  for (int i = 0; i < N; i++) {
+    snprintf(prompt, sizeof(prompt), "q%d", i);
+    calls[i] = oracle_call_start(o, prompt);
+  }
+  for (int i = 0; i < N; i++) {
+    OracleResult r = oracle_call_wait(calls[i]);
+    snprintf(expect, sizeof(expect), "re q%d", i);
+    ASSERT_TRUE(r.ok);
+    ASSERT_EQ_STR(expect, r.text);
+    oracle_result_free(r);
+  }
+  ASSERT_TRUE(profiler_now_ns() - t0 < 3000000000ull);
+
+  // The cap still holds: 8 asks, 4 at a time, take two rounds
+  oracle_set_max_concurrency(o, ORACLE_OLLAMA_MAX_CONCURRENCY);
+  t0 = profiler_now_ns();
+  for (int i = 0; i < 8; i++) calls[i] = oracle_call_start(o, "capped");
+  for (int i = 0; i < 8; i++) oracle_result_free(oracle_call_wait(calls[i]));
+  ASSERT_TRUE(profiler_now_ns() - t0 >= 400000000ull);
+  oracle_free(o);
+  mock_stop(s);
+  ASSERT_TRUE(s->accepted == N);
+  ASSERT_TRUE(s->peak_waiting >= N / 2);
+  free(s);
+}
+
+int main(void) {
+  run_test("multiplexes_requests", test_multiplexes_requests);
+  run_test("hands_off_completions", test_hands_off_completions);
+  run_test("parses_trickled_bodies", test_parses_trickled_bodies);
+  run_test("reports_failures", test_reports_failures);
+  run_test("ollama_asks_in_flight", test_ollama_asks_in_flight);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All http loop tests passed (%d)\n", get_tests_run());
+  return 0;
+}
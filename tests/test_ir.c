@@ -49,10 +49,57 @@ static void test_ir_basic(void) { assert_ir_matches("ir_basic"); }
 static void test_ir_if(void) { assert_ir_matches("ir_if"); }
 static void test_ir_ask(void) { assert_ir_matches("ir_ask"); }
 
+// Lowering records the statement each instruction came from; the annotated
+// print shows the source line above its instructions
+static void test_ir_line_table(void) {
+  char path[256]; snprintf(path, sizeof(path), "%s/tests/fixtures/ir_basic.lim", SOURCE_DIR);
+  char *src = read_all(path);
+  ASSERT_TRUE(src != NULL);
+  Parser *p = parser_create(src, strlen(src));
+  ASTNode *prog = parse_program(p);
+  IrProgram *ir = ir_from_ast(prog);
+  const IrFunc *f = &ir->funcs.items[0];
+  // One run for the whole assignment, not one entry per instruction
+  ASSERT_TRUE(f->lines.len == 1);
+  for (size_t i = 0; i < f->instrs.len; ++i) {
+    LiminalSpan sp = ir_func_span_at(f, i);
+    ASSERT_TRUE(sp.line == 5 && sp.column == 3);
+  }
+  ASSERT_TRUE(ir_func_span_at(f, f->instrs.len + 4).line == 5);
+  char *annotated = ir_program_print_annotated(ir, src, NULL);
+  ASSERT_CONTAINS(annotated, "func Basic\n; 5: X := 1 + 2 * 3;\n  t0 = CONST_INT 1\n");
+  free(annotated);
+  free(src);
+  ir_program_free(ir);
+  ast_free(prog);
+  parser_destroy(p);
+}
+
+// Spans set by hand survive a full replacement, with equal runs merged
+static void test_ir_set_spans(void) {
+  IrFunc f = ir_func_create("Main");
+  ir_emit_const_int(&f, 1);
+  ir_emit_const_int(&f, 2);
+  ir_emit_const_int(&f, 3);
+  ASSERT_TRUE(f.lines.len == 0 && ir_func_span_at(&f, 1).line == 0);
+  LiminalSpan spans[3] = {{2, 1, 10, 4}, {2, 1, 10, 4}, {7, 3, 40, 5}};
+  ir_func_set_spans(&f, spans, 3);
+  ASSERT_TRUE(f.lines.len == 2);
+  ASSERT_TRUE(ir_func_span_at(&f, 1).line == 2 && ir_func_span_at(&f, 2).line == 7);
+  LiminalSpan *back = ir_func_spans(&f);
+  ASSERT_TRUE(memcmp(back, spans, sizeof(spans)) == 0);
+  free(back);
+  IrProgram *prog = ir_program_new();
+  ir_program_add_func(prog, f);
+  ir_program_free(prog);
+}
+
 int main(void) {
   run_test("ir_basic", test_ir_basic);
   run_test("ir_if", test_ir_if);
   run_test("ir_ask", test_ir_ask);
+  run_test("ir_line_table", test_ir_line_table);
+  run_test("ir_set_spans", test_ir_set_spans);
 
   if (get_tests_failed() > 0) {
     fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
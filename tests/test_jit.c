@@ -0,0 +1,126 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/exec.h"
+#include "liminal/jit.h"
+#include "liminal/oracles.h"
+#include "liminal/peephole.h"
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// `liminal run --jit`: guards falling back to the interpreter and the call
+// threshold. The examples run with and without the JIT in
+// liminal_example_diff_tests.
+
+static const char *INPUT = "3\n4\n";
+
+typedef struct {
+  int rc;
+  char *out;
+  size_t compiled;
+} RunOutput;
+
+static void context_open(LiminalContext *ctx, char **out, size_t *len, int jit) {
+  liminal_context_init(ctx);
+  ctx->in = fmemopen((void *)INPUT, strlen(INPUT), "r");
+  ctx->out = open_memstream(out, len);
+  ctx->jit = jit;
+  ctx->jit_threshold = 0;
+}
+
+static void context_close(LiminalContext *ctx, RunOutput *r) {
+  FILE *in = ctx->in, *out = ctx->out;
+  r->compiled = ctx->jit_compiled;
+  liminal_context_free(ctx);
+  fclose(in);
+  fclose(out);
+}
+
+static RunOutput run_ir(const IrProgram *prog, int jit) {
+  RunOutput r = {0};
+  size_t len = 0;
+  LiminalContext ctx;
+  context_open(&ctx, &r.out, &len, jit);
+  r.rc = ir_execute(prog, &ctx);
+  context_close(&ctx, &r);
+  return r;
+}
+
+// Loop whose arithmetic leaves the templates' fast paths: Real and String
+// operands, division by 0 and -1, a branch on Reals (guards and the
+// interpreter stub)
+static void test_guards_fall_back(void) {
+  IrProgram *prog = ir_program_new();
+  IrFunc f = ir_func_create("Main");
+  ir_emit_store_var(&f, "N", ir_emit_const_int(&f, 5));
+  ir_emit_label(&f, "L0");
+  int n = ir_emit_load_var(&f, "N");
+  ir_emit_jump_if_false(&f, ir_emit_binop(&f, IR_GT, n, ir_emit_const_int(&f, 0)), "L1");
+  ir_emit_print(&f, ir_emit_binop(&f, IR_ADD, n, ir_emit_const_real(&f, 0.5)), 1);
+  ir_emit_print(&f, ir_emit_binop(&f, IR_DIV, n, ir_emit_const_int(&f, 0)), 1);
+  int minus = ir_emit_const_int(&f, -1);
+  ir_emit_print(&f, ir_emit_binop(&f, IR_DIV, n, minus), 1);
+  ir_emit_print(&f, ir_emit_binop(&f, IR_MOD, n, minus), 1);
+  ir_emit_print(&f, ir_emit_binop(&f, IR_MOD, ir_emit_const_int(&f, 17), n), 1);
+  ir_emit_print(&f, ir_emit_binop(&f, IR_ADD, ir_emit_const_string(&f, "n="), n), 1);
+  int half = ir_emit_binop(&f, IR_ADD, n, ir_emit_const_real(&f, 0.5));
+  ir_emit_jump_if_false(&f, ir_emit_binop(&f, IR_LT, half, ir_emit_const_real(&f, 3.0)), "L2");
+  ir_emit_print(&f, ir_emit_const_string(&f, "small"), 1);
+  ir_emit_label(&f, "L2");
+  ir_emit_store_var(&f, "N", ir_emit_binop(&f, IR_SUB, n, ir_emit_const_int(&f, 1)));
+  ir_emit_jump(&f, "L0");
+  ir_emit_label(&f, "L1");
+  ir_program_add_func(prog, f);
+
+  RunOutput want = run_ir(prog, 0);
+  RunOutput got = run_ir(prog, 1);
+  ASSERT_CONTAINS(want.out, "5.5\n0\n-5\n0\n2\nn=5\n");
+  ASSERT_CONTAINS(want.out, "n=2\nsmall\n");
+  ASSERT_EQ_STR(want.out, got.out);
+  ASSERT_TRUE(got.compiled == (jit_supported() ? 1u : 0u));
+  free(got.out);
+  // Same loop through the superinstruction templates; the Real compare is a
+  // fused branch whose guard fails in both directions
+  ASSERT_TRUE(ir_fuse_superinstructions(prog) > 0);
+  got = run_ir(prog, 1);
+  ASSERT_EQ_STR(want.out, got.out);
+  free(want.out); free(got.out);
+  ir_program_free(prog);
+}
+
+// With the default threshold only hot code is compiled
+static void test_hot_functions_only(void) {
+  char path[512]; snprintf(path, sizeof(path), "%s/examples/opus/t30_bench_function_calls.lim", SOURCE_DIR);
+  RunOutput r = {0};
+  size_t len = 0;
+  LiminalContext ctx;
+  context_open(&ctx, &r.out, &len, 1);
+  ctx.jit_threshold = -1;
+  r.rc = liminal_run_file_ctx(&ctx, path);
+  context_close(&ctx, &r);
+  ASSERT_TRUE(r.rc == 0);
+  // Mix is called in a loop, then the loop itself gets hot in the main body
+  ASSERT_TRUE(r.compiled == (jit_supported() ? 2u : 0u));
+  free(r.out);
+
+  snprintf(path, sizeof(path), "%s/examples/01_hello.lim", SOURCE_DIR);
+  context_open(&ctx, &r.out, &len, 1);
+  ctx.jit_threshold = -1;
+  r.rc = liminal_run_file_ctx(&ctx, path);
+  context_close(&ctx, &r);
+  ASSERT_TRUE(r.compiled == 0);
+  free(r.out);
+}
+
+int main(void) {
+  run_test("guards_fall_back", test_guards_fall_back);
+  run_test("hot_functions_only", test_hot_functions_only);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All jit tests passed (%d)\n", get_tests_run());
+  return 0;
+}
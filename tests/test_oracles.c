@@ -1,10 +1,14 @@
 #define _POSIX_C_SOURCE 200809L
 #include "liminal/oracles.h"
+#include "liminal/recordings.h"
 #include "test_harness.h"
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 static void test_mock_success(void) {
@@ -44,7 +48,453 @@ static void test_record_replay(void) {
   ASSERT_TRUE(r2.ok == 1);
   ASSERT_EQ_STR("world", r2.text);
   oracle_result_free(r2);
+  // Started asks have their answer at once, found or not
+  void *call = oracle_start_text(rep, "Hello World");
+  ASSERT_TRUE(call != NULL);
+  ASSERT_TRUE(oracle_ready_text(rep, call));
+  r2 = oracle_finish_text(rep, call);
+  ASSERT_TRUE(r2.ok == 1);
+  ASSERT_EQ_STR("world", r2.text);
+  oracle_result_free(r2);
+  call = oracle_start_text(rep, "never recorded");
+  ASSERT_TRUE(call != NULL && oracle_ready_text(rep, call));
+  r2 = oracle_finish_text(rep, call);
+  ASSERT_TRUE(r2.ok == 0);
+  ASSERT_EQ_STR("replay: prompt not found", r2.error);
+  oracle_result_free(r2);
+  oracle_free(rep);
+}
+
+static void hash_of(const char *prompt, char hash[65]) {
+  char *canon = oracle_canonicalize_prompt(prompt);
+  oracle_hash_prompt(canon, hash);
+  free(canon);
+}
+
+// Long answers, escapes, failures and repeated hashes, as a recording holds
+// them
+static void test_replay_store(void) {
+  const char *path = "/tmp/oracle_replay_store_test.jsonl";
+  char h_long[65], h_esc[65], h_fail[65], h_twice[65], h_bare[65], h_cut[65];
+  hash_of("long", h_long);
+  hash_of("escapes", h_esc);
+  hash_of("fails", h_fail);
+  hash_of("twice", h_twice);
+  hash_of("bare", h_bare);
+  hash_of("cut", h_cut);
+  FILE *f = fopen(path, "w");
+  ASSERT_TRUE(f != NULL);
+  fputs("{\"hash\":\"", f);
+  fputs(h_long, f);
+  fputs("\",\"response\":\"", f);
+  for (int i = 0; i < 10000; i++) fputc('a' + i % 26, f);
+  fputs("\",\"ok\":true}\n", f);
+  fprintf(f, "not a record\n\n");
+  fprintf(f, "{\"ok\":true,\"response\":\"q\\\"t\\\\ \\u00e9\\ud83d\\ude00\\n\",\"extra\":[1,{\"a\":2}],\"hash\":\"%s\"}\n", h_esc);
+  fprintf(f, "{\"hash\":\"%s\",\"prompt\":\"fails\",\"response\":\"timed out\",\"ok\":false}\n", h_fail);
+  fprintf(f, "{\"hash\":\"%s\",\"response\":\"first\",\"ok\":true}\n", h_twice);
+  fprintf(f, "{\"hash\":\"%s\",\"response\":\"second\",\"ok\":true}\n", h_twice);
+  fprintf(f, "{\"hash\":\"%s\",\"ok\":true}\n", h_bare);
+  fprintf(f, "{\"hash\":\"%s\",\"response\":\"no end", h_cut);
+  fclose(f);
+
+  char *err = NULL;
+  ReplayStore *s = replay_store_open(path, &err);
+  ASSERT_TRUE(s != NULL);
+  ASSERT_TRUE(replay_store_count(s) == 6);
+  OracleResult r;
+  ASSERT_TRUE(replay_store_find(s, h_long, &r) && r.ok);
+  ASSERT_TRUE(strlen(r.text) == 10000 && r.text[9999] == 'a' + 9999 % 26);
+  oracle_result_free(r);
+  ASSERT_TRUE(replay_store_find(s, h_esc, &r) && r.ok);
+  ASSERT_EQ_STR("q\"t\\ \xc3\xa9\xf0\x9f\x98\x80\n", r.text);
+  oracle_result_free(r);
+  ASSERT_TRUE(replay_store_find(s, h_fail, &r) && !r.ok);
+  ASSERT_EQ_STR("timed out", r.error);
+  oracle_result_free(r);
+  ASSERT_TRUE(replay_store_find(s, h_twice, &r) && r.ok);
+  ASSERT_EQ_STR("first", r.text);
+  oracle_result_free(r);
+  ASSERT_TRUE(replay_store_find(s, h_bare, &r) && !r.ok);
+  ASSERT_EQ_STR("replay response missing", r.error);
+  oracle_result_free(r);
+  ASSERT_TRUE(replay_store_find(s, h_cut, &r) && !r.ok);
+  ASSERT_EQ_STR("replay malformed", r.error);
+  oracle_result_free(r);
+  char h_none[65];
+  hash_of("never asked", h_none);
+  ASSERT_TRUE(!replay_store_find(s, h_none, &r));
+  replay_store_close(s);
+
+  // Through the oracle, a recorded failure is a failure again
+  Oracle *rep = oracle_with_recording(NULL, "replay", path);
+  r = oracle_call_text(rep, "fails");
+  ASSERT_TRUE(!r.ok);
+  ASSERT_EQ_STR("timed out", r.error);
+  oracle_result_free(r);
+  r = oracle_call_text(rep, "never asked");
+  ASSERT_EQ_STR("replay: prompt not found", r.error);
+  oracle_result_free(r);
+  oracle_free(rep);
+  unlink(path);
+
+  ASSERT_TRUE(replay_store_open(path, &err) == NULL);
+  ASSERT_EQ_STR("replay file not found", err);
+  free(err);
+}
+
+// Many records: each found by its own hash
+static void test_replay_store_many(void) {
+  const char *path = "/tmp/oracle_replay_many_test.jsonl";
+  Oracle *base = oracle_create_mock();
+  char prompt[32], text[32];
+  for (int i = 0; i < 5000; i++) {
+    snprintf(text, sizeof(text), "answer %d", i);
+    oracle_mock_queue(base, text, NULL);
+  }
+  unlink(path);
+  Oracle *rec = oracle_with_recording(base, "record", path);
+  for (int i = 0; i < 5000; i++) {
+    snprintf(prompt, sizeof(prompt), "prompt %d", i);
+    oracle_result_free(oracle_call_text(rec, prompt));
+  }
+  oracle_free(rec);
+  Oracle *rep = oracle_with_recording(NULL, "replay", path);
+  for (int i = 4999; i >= 0; i--) {
+    snprintf(prompt, sizeof(prompt), "prompt %d", i);
+    snprintf(text, sizeof(text), "answer %d", i);
+    OracleResult r = oracle_call_text(rep, prompt);
+    ASSERT_TRUE(r.ok);
+    ASSERT_EQ_STR(text, r.text);
+    oracle_result_free(r);
+  }
+  oracle_free(rep);
+  unlink(path);
+}
+
+static long file_size(const char *path) {
+  struct stat st;
+  return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+// Polls for up to 5 s until path has grown past size
+static int grows_past(const char *path, long size) {
+  struct timespec tick = { 0, 10000000 };
+  for (int i = 0; i < 500 && file_size(path) <= size; i++) nanosleep(&tick, NULL);
+  return file_size(path) > size;
+}
+
+static void append_answer(RecordWriter *w, const char *prompt, const char *text) {
+  char hash[65];
+  hash_of(prompt, hash);
+  OracleResult r = {0};
+  r.ok = 1;
+  r.text = (char *)text;
+  record_writer_append(w, hash, prompt, &r);
+}
+
+// Records wait in the buffer until it fills, the oldest is flush_ms old or
+// a flush is asked for
+static void test_record_writer(void) {
+  const char *path = "/tmp/oracle_writer_test.jsonl";
+  unlink(path);
+  char *err = NULL;
+  RecordWriter *w = record_writer_open(path, 60000, &err);
+  ASSERT_TRUE(w != NULL);
+  append_answer(w, "one", "1");
+  append_answer(w, "two", "2");
+  OracleResult fail = {0};
+  fail.error = "down";
+  char hash[65];
+  hash_of("three", hash);
+  record_writer_append(w, hash, "three", &fail);
+  ASSERT_TRUE(file_size(path) == 0);
+  ASSERT_TRUE(record_writer_flush(w) == 0);
+  ReplayStore *s = replay_store_open(path, &err);
+  ASSERT_TRUE(s && replay_store_count(s) == 3);
+  OracleResult r;
+  ASSERT_TRUE(replay_store_find(s, hash, &r) && !r.ok);
+  ASSERT_EQ_STR("down", r.error);
+  oracle_result_free(r);
+  replay_store_close(s);
+
+  // A full buffer is written without waiting out the interval
+  long before = file_size(path);
+  char text[1024];
+  memset(text, 'x', sizeof(text) - 1);
+  text[sizeof(text) - 1] = '\0';
+  char prompt[32];
+  for (int i = 0; i < 80; i++) {
+    snprintf(prompt, sizeof(prompt), "big %d", i);
+    append_answer(w, prompt, text);
+  }
+  ASSERT_TRUE(grows_past(path, before));
+  ASSERT_TRUE(record_writer_close(w) == 0);
+  s = replay_store_open(path, &err);
+  ASSERT_TRUE(s && replay_store_count(s) == 83);
+  replay_store_close(s);
+
+  // So is a record older than the interval
+  w = record_writer_open(path, 50, &err);
+  before = file_size(path);
+  append_answer(w, "late", "l");
+  ASSERT_TRUE(grows_past(path, before));
+  record_writer_close(w);
+  unlink(path);
+
+  ASSERT_TRUE(record_writer_open("/nonexistent/dir/rec.jsonl", 0, &err) == NULL);
+  ASSERT_CONTAINS(err, "/nonexistent/dir/rec.jsonl");
+  free(err);
+}
+
+typedef struct {
+  RecordWriter *w;
+  int id;
+} WriterArg;
+
+static void *append_many(void *arg) {
+  WriterArg *a = (WriterArg *)arg;
+  char prompt[32], text[600];
+  for (int i = 0; i < 500; i++) {
+    snprintf(prompt, sizeof(prompt), "w%d p%d", a->id, i);
+    memset(text, 'a' + a->id, sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+    append_answer(a->w, prompt, text);
+  }
+  return NULL;
+}
+
+// Threads sharing a writer and a second writer on the same file, as another
+// process would have: every line comes out whole
+static void test_record_writer_shared(void) {
+  const char *path = "/tmp/oracle_writer_shared_test.jsonl";
+  unlink(path);
+  char *err = NULL;
+  RecordWriter *buffered = record_writer_open(path, 20, &err);
+  RecordWriter *direct = record_writer_open(path, 0, &err);
+  ASSERT_TRUE(buffered && direct);
+  pthread_t threads[8];
+  WriterArg args[8];
+  for (int i = 0; i < 8; i++) {
+    args[i].w = i % 4 == 3 ? direct : buffered;
+    args[i].id = i;
+    pthread_create(&threads[i], NULL, append_many, &args[i]);
+  }
+  for (int i = 0; i < 8; i++) pthread_join(threads[i], NULL);
+  ASSERT_TRUE(record_writer_close(buffered) == 0);
+  ASSERT_TRUE(record_writer_close(direct) == 0);
+  ReplayStore *s = replay_store_open(path, &err);
+  ASSERT_TRUE(s && replay_store_count(s) == 4000);
+  char hash[65];
+  hash_of("w3 p499", hash);
+  OracleResult r;
+  ASSERT_TRUE(replay_store_find(s, hash, &r) && r.ok && strlen(r.text) == 599 && r.text[0] == 'd');
+  oracle_result_free(r);
+  replay_store_close(s);
+  unlink(path);
+}
+
+// Recording writes behind the ask; a flush or freeing the oracle puts it in
+// the file
+static void test_recording_flush(void) {
+  const char *path = "/tmp/oracle_rec_flush_test.jsonl";
+  unlink(path);
+  Oracle *base = oracle_create_mock();
+  oracle_mock_queue(base, "kept", NULL);
+  Oracle *rec = oracle_with_recording(base, "record", path);
+  oracle_recording_set_flush_ms(rec, 60000);
+  oracle_result_free(oracle_call_text(rec, "q"));
+  ASSERT_TRUE(file_size(path) == 0);
+  ASSERT_TRUE(oracle_recording_flush(rec) == 0);
+  ASSERT_TRUE(file_size(path) > 0);
+  ASSERT_TRUE(oracle_recording_flush(base) == 0);
+  oracle_free(rec);
+  unlink(path);
+}
+
+static OracleResult replay(ReplayStore *s, const char *prompt) {
+  char hash[65];
+  hash_of(prompt, hash);
+  OracleResult r = {0};
+  if (!replay_store_find(s, hash, &r)) r.error = strdup("not found");
+  return r;
+}
+
+// Recording to a *.lrec file writes the binary format; convert and compact
+// keep every answer findable and the index covering them
+static void test_binary_recordings(void) {
+  const char *path = "/tmp/oracle_binary_test.lrec", *idx = "/tmp/oracle_binary_test.lrec.idx";
+  const char *jsonl = "/tmp/oracle_binary_test.jsonl";
+  unlink(path);
+  unlink(idx);
+  Oracle *base = oracle_create_mock();
+  oracle_mock_queue(base, "first", NULL);
+  oracle_mock_queue(base, NULL, "down");
+  oracle_mock_queue(base, "again", NULL);
+  oracle_mock_queue(base, "", NULL);
+  Oracle *rec = oracle_with_recording(base, "record", path);
+  const char *prompts[] = { "a", "b", "a", "empty" };
+  for (int i = 0; i < 4; i++) oracle_result_free(oracle_call_text(rec, prompts[i]));
+  oracle_free(rec);
+  ASSERT_TRUE(recording_is_binary(path));
+
+  // No index yet: every record is read
+  char *err = NULL;
+  RecordingStats st;
+  ASSERT_TRUE(recordings_stats(path, &st, &err) == 0);
+  ASSERT_TRUE(st.binary && st.records == 4 && st.distinct == 3 && st.failures == 1 && !st.indexed);
+  ReplayStore *s = replay_store_open(path, &err);
+  ASSERT_TRUE(s && replay_store_count(s) == 3);
+  OracleResult r = replay(s, "a");
+  ASSERT_TRUE(r.ok);
+  ASSERT_EQ_STR("first", r.text);
+  oracle_result_free(r);
+  r = replay(s, "b");
+  ASSERT_TRUE(!r.ok);
+  ASSERT_EQ_STR("down", r.error);
+  oracle_result_free(r);
+  r = replay(s, "empty");
+  ASSERT_TRUE(r.ok);
+  ASSERT_EQ_STR("", r.text);
+  oracle_result_free(r);
+  replay_store_close(s);
+
+  // Compacting drops the repeat and indexes the rest; records appended
+  // afterwards are found past the index
+  ASSERT_TRUE(recordings_compact(path, &err) == 0);
+  ASSERT_TRUE(access(idx, R_OK) == 0);
+  base = oracle_create_mock();
+  oracle_mock_queue(base, "later", NULL);
+  rec = oracle_with_recording(base, "record", path);
+  oracle_recording_set_flush_ms(rec, 0);
+  oracle_result_free(oracle_call_text(rec, "c"));
+  oracle_free(rec);
+  ASSERT_TRUE(recordings_stats(path, &st, &err) == 0);
+  ASSERT_TRUE(st.records == 4 && st.distinct == 4 && st.indexed && st.unindexed == 1);
+  Oracle *rep = oracle_with_recording(NULL, "replay", path);
+  r = oracle_call_text(rep, "c");
+  ASSERT_TRUE(r.ok);
+  ASSERT_EQ_STR("later", r.text);
+  oracle_result_free(r);
+  r = oracle_call_text(rep, "a");
+  ASSERT_EQ_STR("first", r.text);
+  oracle_result_free(r);
+  oracle_free(rep);
+
+  // To JSONL and back
+  ASSERT_TRUE(recordings_convert(path, jsonl, &err) == 0);
+  ASSERT_TRUE(!recording_is_binary(jsonl));
+  unlink(path);
+  unlink(idx);
+  ASSERT_TRUE(recordings_convert(jsonl, path, &err) == 0);
+  ASSERT_TRUE(recordings_stats(path, &st, &err) == 0);
+  ASSERT_TRUE(st.records == 4 && st.failures == 1 && st.indexed && st.unindexed == 0);
+  ASSERT_TRUE(recordings_compact(jsonl, &err) != 0);
+  ASSERT_CONTAINS(err, "not a binary recording");
+  free(err);
+  unlink(jsonl);
+
+  // A torn last record is skipped, and compact cuts it off
+  FILE *f = fopen(path, "ab");
+  fwrite("partial", 1, 7, f);
+  fclose(f);
+  s = replay_store_open(path, &err);
+  ASSERT_TRUE(s && replay_store_count(s) == 4);
+  replay_store_close(s);
+  ASSERT_TRUE(recordings_stats(path, &st, &err) == 0 && st.skipped == 7);
+  ASSERT_TRUE(recordings_compact(path, &err) == 0);
+  ASSERT_TRUE(recordings_stats(path, &st, &err) == 0 && st.skipped == 0 && st.records == 4);
+  unlink(path);
+  unlink(idx);
+}
+
+static void record_answers(const char *path, const char **prompts, const char **answers, int n) {
+  Oracle *base = oracle_create_mock();
+  for (int i = 0; i < n; i++) oracle_mock_queue(base, answers[i], NULL);
+  Oracle *rec = oracle_with_recording(base, "record", path);
+  for (int i = 0; i < n; i++) oracle_result_free(oracle_call_text(rec, prompts[i]));
+  oracle_free(rec);
+}
+
+static char *file_bytes(const char *path, size_t *len) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return NULL;
+  fseek(f, 0, SEEK_END);
+  *len = (size_t)ftell(f);
+  rewind(f);
+  char *buf = malloc(*len ? *len : 1);
+  *len = fread(buf, 1, *len, f);
+  fclose(f);
+  return buf;
+}
+
+static void put_file(const char *path, const char *bytes, size_t len) {
+  FILE *f = fopen(path, "wb");
+  fwrite(bytes, 1, len, f);
+  fclose(f);
+}
+
+// An index that describes other data is not trusted: not one left behind
+// by a replaced file, nor one whose records moved under it
+static void test_stale_index(void) {
+  const char *path = "/tmp/oracle_stale_test.lrec", *idx = "/tmp/oracle_stale_test.lrec.idx";
+  unlink(path);
+  unlink(idx);
+  const char *prompts[] = { "a", "b", "c", "d" }, *answers[] = { "1", "bbb", "ccccc", "4" };
+  record_answers(path, prompts, answers, 4);
+  char *err = NULL;
+  ASSERT_TRUE(recordings_compact(path, &err) == 0);
+
+  // Swap b and c: the first and last records stay where the index has them
+  size_t len, idx_len;
+  char *data = file_bytes(path, &len);
+  ASSERT_TRUE(data && len == 8 + 4 * 40 + 1 + 3 + 5 + 1);
+  char *swapped = malloc(len);
+  memcpy(swapped, data, 49);
+  memcpy(swapped + 49, data + 92, 45);
+  memcpy(swapped + 94, data + 49, 43);
+  memcpy(swapped + 137, data + 137, len - 137);
+  put_file(path, swapped, len);
+  free(swapped);
+  free(data);
+  ReplayStore *s = replay_store_open(path, &err);
+  ASSERT_TRUE(s != NULL);
+  for (int i = 0; i < 4; i++) {
+    OracleResult r = replay(s, prompts[i]);
+    ASSERT_TRUE(r.ok);
+    ASSERT_EQ_STR(answers[i], r.text);
+    oracle_result_free(r);
+  }
+  // A key neither the index nor the records after it have is not there
+  OracleResult miss;
+  ASSERT_TRUE(!replay_store_find(s, "0000000000000000000000000000000000000000000000000000000000000000", &miss));
+  replay_store_close(s);
+
+  // Recording afresh under the same name drops the old index; one put back
+  // is not used
+  char *old_index = file_bytes(idx, &idx_len);
+  ASSERT_TRUE(old_index != NULL);
+  unlink(path);
+  const char *fresh[] = { "x" }, *fresh_answers[] = { "new" };
+  record_answers(path, fresh, fresh_answers, 1);
+  ASSERT_TRUE(access(idx, F_OK) != 0);
+  put_file(idx, old_index, idx_len);
+  free(old_index);
+  RecordingStats st;
+  ASSERT_TRUE(recordings_stats(path, &st, &err) == 0);
+  ASSERT_TRUE(st.records == 1 && !st.indexed && st.unindexed == 1);
+  Oracle *rep = oracle_with_recording(NULL, "replay", path);
+  OracleResult r = oracle_call_text(rep, "x");
+  ASSERT_TRUE(r.ok);
+  ASSERT_EQ_STR("new", r.text);
+  oracle_result_free(r);
+  r = oracle_call_text(rep, "a");
+  ASSERT_TRUE(!r.ok);
+  ASSERT_EQ_STR("replay: prompt not found", r.error);
+  oracle_result_free(r);
   oracle_free(rep);
+  unlink(path);
+  unlink(idx);
 }
 
 static void test_env_loader_mock(void) {
@@ -81,6 +531,13 @@ int main(void) {
   run_test("mock_success", test_mock_success);
   run_test("mock_failure", test_mock_failure);
   run_test("record_replay", test_record_replay);
+  run_test("replay_store", test_replay_store);
+  run_test("replay_store_many", test_replay_store_many);
+  run_test("record_writer", test_record_writer);
+  run_test("record_writer_shared", test_record_writer_shared);
+  run_test("recording_flush", test_recording_flush);
+  run_test("binary_recordings", test_binary_recordings);
+  run_test("stale_index", test_stale_index);
   run_test("env_loader_mock", test_env_loader_mock);
   run_test("ollama_integration", test_ollama_integration);
 
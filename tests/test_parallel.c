@@ -0,0 +1,206 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/exec.h"
+#include "liminal/oracles.h"
+#include "liminal/parser.h"
+#include "liminal/workers.h"
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// `parallel` blocks: the worker pool, the join's ordering and isolation, and
+// the provider cap.
+
+static long now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void nap_ms(long ms) {
+  struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+  nanosleep(&ts, NULL);
+}
+
+static void doubled(void *arg, size_t i) {
+  ((size_t *)arg)[i] = i * 2;
+}
+
+static void napping(void *arg, size_t i) {
+  (void)arg; (void)i;
+  nap_ms(50);
+}
+
+static void test_pool_runs_every_item(void) {
+  for (size_t size = 0; size < 4; size++) {
+    WorkerPool *p = worker_pool_new(size);
+    ASSERT_TRUE(worker_pool_threads(p) == (size > 1 ? size - 1 : 0));
+    for (int batch = 0; batch < 3; batch++) {
+      size_t out[100];
+      memset(out, 0xff, sizeof(out));
+      worker_pool_run(p, doubled, out, 100);
+      int all = 1;
+      for (size_t i = 0; i < 100; i++) all = all && out[i] == i * 2;
+      ASSERT_TRUE(all);
+    }
+    worker_pool_free(p);
+  }
+}
+
+static void test_pool_overlaps(void) {
+  WorkerPool *p = worker_pool_new(4);
+  long start = now_ms();
+  worker_pool_run(p, napping, NULL, 4);
+  ASSERT_TRUE(now_ms() - start < 150);
+  worker_pool_free(p);
+}
+
+static int run_fixture(Oracle *o, const char *fixture, int jit, long workers, char **buf) {
+  char path[256];
+  snprintf(path, sizeof(path), "%s/tests/fixtures/%s", SOURCE_DIR, fixture);
+  size_t len = 0;
+  FILE *out = open_memstream(buf, &len);
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  ctx.out = out;
+  ctx.jit = jit;
+  ctx.jit_threshold = 0; // compiled on entry, so the JIT's FORK is the one run
+  ctx.parallel_workers = workers;
+  liminal_context_set_oracle(&ctx, o, 0);
+  int rc = liminal_run_file_ctx(&ctx, path);
+  liminal_context_free(&ctx);
+  fclose(out);
+  return rc;
+}
+
+static void test_lowers_to_fork_join(void) {
+  char path[256];
+  snprintf(path, sizeof(path), "%s/tests/fixtures/parallel_five.lim", SOURCE_DIR);
+  FILE *f = fopen(path, "rb");
+  ASSERT_TRUE(f != NULL);
+  char src[1024];
+  size_t n = fread(src, 1, sizeof(src) - 1, f);
+  src[n] = '\0';
+  fclose(f);
+  Parser *p = parser_create(src, n);
+  ASTNode *ast = parse_program(p);
+  IrProgram *ir = ir_from_ast(ast);
+  const IrFunc *main = &ir->funcs.items[0];
+  size_t forks = 0, first = 0;
+  for (size_t i = 0; i < main->instrs.len; i++) {
+    if (main->instrs.items[i].op != IR_FORK) continue;
+    if (!forks++) first = i;
+  }
+  ASSERT_TRUE(forks == 5);
+  long join = ir_fork_join(main, first);
+  ASSERT_TRUE(join > (long)first && main->instrs.items[join].op == IR_JOIN);
+  ASSERT_TRUE(ir_fork_join(main, first + 1) == -1);
+  ASSERT_TRUE(ir_validate(ir, NULL));
+  ir_program_free(ir);
+  ast_free(ast);
+  parser_destroy(p);
+}
+
+// Output and writes land in source order, each task reads the variables as
+// they were before the block, and one failed ask leaves the others intact
+static void test_joins_in_source_order(void) {
+  for (int jit = 0; jit < 2; jit++) {
+    Oracle *o = oracle_create_mock();
+    oracle_mock_answer(o, "first", "alpha", NULL);
+    oracle_mock_answer(o, "second", NULL, "boom");
+    oracle_mock_answer(o, "third", "gamma", NULL);
+    oracle_mock_set_latency(o, 20);
+    char *out = NULL;
+    ASSERT_TRUE(run_fixture(o, "parallel_basic.lim", jit, 8, &out) == 0);
+    ASSERT_EQ_STR("third asked\nreads N\nOk(alpha)\nErr(boom)\nOk(gamma)\n101\n1\n", out);
+    free(out);
+    oracle_free(o);
+  }
+}
+
+static void test_single_worker_same_result(void) {
+  Oracle *o = oracle_create_mock();
+  oracle_mock_answer(o, "first", "alpha", NULL);
+  oracle_mock_answer(o, "second", NULL, "boom");
+  oracle_mock_answer(o, "third", "gamma", NULL);
+  char *out = NULL;
+  ASSERT_TRUE(run_fixture(o, "parallel_basic.lim", 0, 1, &out) == 0);
+  ASSERT_EQ_STR("third asked\nreads N\nOk(alpha)\nErr(boom)\nOk(gamma)\n101\n1\n", out);
+  free(out);
+  oracle_free(o);
+}
+
+static Oracle *five_answers(long latency_ms) {
+  Oracle *o = oracle_create_mock();
+  const char *prompts[] = { "one", "two", "three", "four", "five" };
+  for (int i = 0; i < 5; i++) {
+    char text[8];
+    snprintf(text, sizeof(text), "%d", i + 1);
+    oracle_mock_answer(o, prompts[i], text, NULL);
+  }
+  oracle_mock_set_latency(o, latency_ms);
+  return o;
+}
+
+// Five 100 ms asks take about 100 ms side by side, 500 ms one at a time
+static void time_five(Oracle *o, long workers, long *took) {
+  char *out = NULL;
+  long start = now_ms();
+  int rc = run_fixture(o, "parallel_five.lim", 0, workers, &out);
+  *took = now_ms() - start;
+  ASSERT_TRUE(rc == 0);
+  ASSERT_EQ_STR("Ok(1)\nOk(2)\nOk(3)\nOk(4)\nOk(5)\n", out);
+  free(out);
+}
+
+static void test_asks_overlap(void) {
+  Oracle *o = five_answers(100);
+  long took;
+  time_five(o, 8, &took);
+  ASSERT_TRUE(took < 300);
+  time_five(o, 1, &took);
+  ASSERT_TRUE(took >= 500);
+  oracle_free(o);
+}
+
+static void test_provider_cap(void) {
+  Oracle *o = five_answers(100);
+  long took;
+  oracle_set_max_concurrency(o, 2);
+  time_five(o, 8, &took);
+  ASSERT_TRUE(took >= 300);
+  oracle_set_max_concurrency(o, 0);
+  time_five(o, 8, &took);
+  ASSERT_TRUE(took < 300);
+  oracle_free(o);
+}
+
+// A block inside a task runs its tasks in turn, joining into the task
+static void test_nested_blocks(void) {
+  for (int jit = 0; jit < 2; jit++) {
+    char *out = NULL;
+    ASSERT_TRUE(run_fixture(NULL, "parallel_nested.lim", jit, 8, &out) == 0);
+    ASSERT_EQ_STR("10\n7\ninner\n", out);
+    free(out);
+  }
+}
+
+int main(void) {
+  run_test("pool_runs_every_item", test_pool_runs_every_item);
+  run_test("pool_overlaps", test_pool_overlaps);
+  run_test("lowers_to_fork_join", test_lowers_to_fork_join);
+  run_test("joins_in_source_order", test_joins_in_source_order);
+  run_test("single_worker_same_result", test_single_worker_same_result);
+  run_test("asks_overlap", test_asks_overlap);
+  run_test("provider_cap", test_provider_cap);
+  run_test("nested_blocks", test_nested_blocks);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All parallel tests passed (%d)\n", get_tests_run());
+  return 0;
+}
@@ -0,0 +1,165 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/exec.h"
+#include "liminal/ngrams.h"
+#include "liminal/oracles.h"
+#include "liminal/peephole.h"
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Superinstruction pass: the shapes it fuses and the temps it must keep. The
+// examples run with and without it in liminal_example_diff_tests.
+
+typedef struct {
+  int rc;
+  char *out;
+} RunOutput;
+
+static RunOutput run_ir(const IrProgram *prog) {
+  RunOutput r = {0};
+  size_t len = 0;
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  ctx.out = open_memstream(&r.out, &len);
+  r.rc = ir_execute(prog, &ctx);
+  FILE *out = ctx.out;
+  liminal_context_free(&ctx);
+  fclose(out);
+  return r;
+}
+
+// I := 0; S := 0; N := 10; while I < N do begin I := I + 1; X := I mod 3;
+// if X = 0 then S := S + I end; print S -- in the order the lowering emits
+static IrProgram *counting_loop(void) {
+  IrProgram *prog = ir_program_new();
+  IrFunc f = ir_func_create("Main");
+  ir_emit_store_var(&f, "I", ir_emit_const_int(&f, 0));
+  ir_emit_store_var(&f, "S", ir_emit_const_int(&f, 0));
+  ir_emit_store_var(&f, "N", ir_emit_const_int(&f, 10));
+  ir_emit_label(&f, "0");
+  int i = ir_emit_load_var(&f, "I");
+  int n = ir_emit_load_var(&f, "N");
+  ir_emit_jump_if_false(&f, ir_emit_binop(&f, IR_LT, i, n), "1");
+  i = ir_emit_load_var(&f, "I");
+  int k = ir_emit_const_int(&f, 1);
+  ir_emit_store_var(&f, "I", ir_emit_binop(&f, IR_ADD, i, k));
+  i = ir_emit_load_var(&f, "I");
+  k = ir_emit_const_int(&f, 3);
+  ir_emit_store_var(&f, "X", ir_emit_binop(&f, IR_MOD, i, k));
+  int x = ir_emit_load_var(&f, "X");
+  k = ir_emit_const_int(&f, 0);
+  ir_emit_jump_if_false(&f, ir_emit_binop(&f, IR_EQ, x, k), "2");
+  int sum = ir_emit_load_var(&f, "S");
+  i = ir_emit_load_var(&f, "I");
+  ir_emit_store_var(&f, "S", ir_emit_binop(&f, IR_ADD, sum, i));
+  ir_emit_label(&f, "2");
+  ir_emit_jump(&f, "0");
+  ir_emit_label(&f, "1");
+  ir_emit_print(&f, ir_emit_load_var(&f, "S"), 1);
+  ir_program_add_func(prog, f);
+  return prog;
+}
+
+static void test_fuses_loop_shapes(void) {
+  IrProgram *prog = counting_loop();
+  RunOutput want = run_ir(prog);
+  ASSERT_TRUE(ir_fuse_superinstructions(prog) == 5);
+  char *printed = ir_program_print(prog);
+  ASSERT_CONTAINS(printed, "CMP_BRANCH LT");
+  ASSERT_CONTAINS(printed, "INC_VAR");
+  ASSERT_CONTAINS(printed, "ARITH_CONST MOD");
+  ASSERT_CONTAINS(printed, "CMP_CONST_BRANCH EQ");
+  ASSERT_CONTAINS(printed, "ADD_STORE");
+  ASSERT_TRUE(strstr(printed, "JUMP_IF_FALSE") == NULL);
+  char *err = NULL;
+  ASSERT_TRUE(ir_validate(prog, &err));
+  free(err);
+  RunOutput got = run_ir(prog);
+  ASSERT_EQ_STR("18\n", want.out);
+  ASSERT_EQ_STR(want.out, got.out);
+  // Nothing left to fuse the second time
+  ASSERT_TRUE(ir_fuse_superinstructions(prog) == 0);
+  free(printed); free(want.out); free(got.out);
+  ir_program_free(prog);
+}
+
+// Temps that something outside the group still reads are never dropped
+static void test_keeps_shared_temps(void) {
+  IrProgram *prog = ir_program_new();
+  IrFunc f = ir_func_create("Main");
+  int k = ir_emit_const_int(&f, 2);
+  int c = ir_emit_binop(&f, IR_GT, k, ir_emit_const_int(&f, 1));
+  ir_emit_jump_if_false(&f, c, "L0");
+  ir_emit_print(&f, c, 1);
+  ir_emit_print(&f, ir_emit_binop(&f, IR_MUL, ir_emit_const_int(&f, 5), k), 1);
+  ir_emit_label(&f, "L0");
+  ir_emit_print(&f, k, 1);
+  ir_program_add_func(prog, f);
+
+  RunOutput want = run_ir(prog);
+  ir_fuse_superinstructions(prog);
+  char *printed = ir_program_print(prog);
+  // c is printed, so the compare and the branch stay apart
+  ASSERT_TRUE(strstr(printed, "CMP_BRANCH") == NULL);
+  ASSERT_CONTAINS(printed, "JUMP_IF_FALSE");
+  // k is read three times, so it is never folded into an immediate
+  ASSERT_CONTAINS(printed, "CONST_INT 2");
+  RunOutput got = run_ir(prog);
+  ASSERT_EQ_STR("True\n10\n2\n", want.out);
+  ASSERT_EQ_STR(want.out, got.out);
+  free(printed); free(want.out); free(got.out);
+  ir_program_free(prog);
+}
+
+// A fused instruction keeps the span of the first one it replaces
+static void test_keeps_source_spans(void) {
+  IrProgram *prog = ir_program_new();
+  IrFunc f = ir_func_create("Main");
+  ir_func_set_span(&f, (LiminalSpan){3, 3, 20, 7});
+  ir_emit_store_var(&f, "I", ir_emit_const_int(&f, 0));
+  ir_func_set_span(&f, (LiminalSpan){4, 3, 30, 11});
+  int i = ir_emit_load_var(&f, "I");
+  ir_emit_store_var(&f, "I", ir_emit_binop(&f, IR_ADD, i, ir_emit_const_int(&f, 1)));
+  ir_emit_print(&f, ir_emit_load_var(&f, "I"), 1);
+  ir_program_add_func(prog, f);
+
+  ASSERT_TRUE(ir_fuse_superinstructions(prog) == 1);
+  const IrFunc *g = &prog->funcs.items[0];
+  ASSERT_TRUE(g->instrs.len == 6 && g->instrs.items[3].op == IR_INC_VAR);
+  ASSERT_TRUE(g->lines.len == 2);
+  ASSERT_TRUE(ir_func_span_at(g, 1).line == 3);
+  for (size_t k = 2; k < g->instrs.len; ++k) ASSERT_TRUE(ir_func_span_at(g, k).line == 4);
+  ir_program_free(prog);
+}
+
+static void test_ngrams_report(void) {
+  char path[512]; snprintf(path, sizeof(path), "%s/examples/opus/t10_for_loop.lim", SOURCE_DIR);
+  const char *paths[] = {path};
+  char *out = NULL; size_t len = 0;
+  FILE *f = open_memstream(&out, &len);
+  ASSERT_TRUE(liminal_ngrams_files(paths, 1, 3, 5, 1, f) == 0);
+  fclose(f);
+  ASSERT_CONTAINS(out, "program(s) (no superinstructions)");
+  ASSERT_CONTAINS(out, "LOAD_VAR");
+  // Header plus at most `top` rows
+  size_t lines = 0;
+  for (const char *p = out; *p; ++p) lines += *p == '\n';
+  ASSERT_TRUE(lines >= 2 && lines <= 6);
+  free(out);
+}
+
+int main(void) {
+  run_test("fuses_loop_shapes", test_fuses_loop_shapes);
+  run_test("keeps_shared_temps", test_keeps_shared_temps);
+  run_test("keeps_source_spans", test_keeps_source_spans);
+  run_test("ngrams_report", test_ngrams_report);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All peephole tests passed (%d)\n", get_tests_run());
+  return 0;
+}
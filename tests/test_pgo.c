@@ -0,0 +1,274 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/exec.h"
+#include "liminal/oracles.h"
+#include "liminal/pgo.h"
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Profile-guided optimization: what a recording counts, the file round trip,
+// each rewrite on a skewed program, and a differential run of every example
+// optimized with its own profile.
+
+static const char *INPUT = "3\n4\n";
+
+typedef struct {
+  int rc;
+  char *out;
+} RunOutput;
+
+static RunOutput run_program(Oracle *oracle, const char *path, const char *pgo_in, const char *pgo_out) {
+  RunOutput r = {0};
+  size_t len = 0;
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  ctx.in = fmemopen((void *)INPUT, strlen(INPUT), "r");
+  ctx.out = open_memstream(&r.out, &len);
+  ctx.pgo_in = pgo_in;
+  ctx.pgo_out = pgo_out;
+  if (oracle) liminal_context_set_oracle(&ctx, oracle, 0);
+  r.rc = liminal_run_file_ctx(&ctx, path);
+  FILE *in = ctx.in, *out = ctx.out;
+  liminal_context_free(&ctx);
+  fclose(in);
+  fclose(out);
+  return r;
+}
+
+// Runs prog, recording its profile when profile is not NULL
+static RunOutput run_ir(const IrProgram *prog, PgoProfile *profile) {
+  RunOutput r = {0};
+  size_t len = 0;
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  ctx.out = open_memstream(&r.out, &len);
+  ctx.pgo = profile;
+  r.rc = ir_execute(prog, &ctx);
+  FILE *out = ctx.out;
+  liminal_context_free(&ctx);
+  fclose(out);
+  return r;
+}
+
+static void temp_path(char *buf, size_t n) {
+  snprintf(buf, n, "/tmp/liminal_pgoXXXXXX");
+  int fd = mkstemp(buf);
+  if (fd >= 0) close(fd);
+  unlink(buf);
+}
+
+static void fixture(char *buf, size_t n) {
+  snprintf(buf, n, "%s/tests/fixtures/pgo_routing.lim", SOURCE_DIR);
+}
+
+static const PgoFunc *func_named(const PgoProfile *p, const char *name) {
+  for (size_t i = 0; i < p->func_count; ++i)
+    if (strcmp(p->funcs[i].name, name) == 0) return &p->funcs[i];
+  return NULL;
+}
+
+static void test_records_counts(void) {
+  char path[512], prof[64];
+  fixture(path, sizeof(path));
+  temp_path(prof, sizeof(prof));
+  RunOutput r = run_program(NULL, path, NULL, prof);
+  ASSERT_TRUE(r.rc == 0);
+  ASSERT_EQ_STR("total=374\n", r.out);
+  free(r.out);
+
+  char *err = NULL;
+  PgoProfile *p = pgo_profile_load(prof, &err);
+  ASSERT_TRUE(p != NULL);
+  free(err);
+  const PgoFunc *main_f = func_named(p, "PgoRouting");
+  const PgoFunc *weight = func_named(p, "Weight");
+  ASSERT_TRUE(main_f && weight && func_named(p, "Scale"));
+  ASSERT_TRUE(main_f->calls == 1 && weight->calls == 3000);
+  // for-loop exit, then `if I mod 100 <> 0` (its else runs 30 times)
+  ASSERT_TRUE(main_f->branch_count == 2);
+  ASSERT_TRUE(main_f->branches[0].taken == 1 && main_f->branches[0].not_taken == 3000);
+  ASSERT_TRUE(main_f->branches[1].taken == 30 && main_f->branches[1].not_taken == 2970);
+  ASSERT_TRUE(main_f->site_count == 2);
+  ASSERT_EQ_STR("Weight", main_f->sites[0].target);
+  ASSERT_EQ_STR("Scale", main_f->sites[1].target);
+  ASSERT_TRUE(main_f->sites[1].count == 3000);
+  // The Page arm, tried last, matches 2970 times
+  ASSERT_TRUE(weight->branch_count == 4 && weight->branches[3].not_taken == 2970);
+  pgo_profile_free(p);
+
+  // A second run of the same program adds to the file
+  r = run_program(NULL, path, NULL, prof);
+  free(r.out);
+  p = pgo_profile_load(prof, NULL);
+  ASSERT_TRUE(p != NULL);
+  ASSERT_TRUE(func_named(p, "Weight")->calls == 6000);
+  pgo_profile_free(p);
+  unlink(prof);
+}
+
+static void test_rejects_bad_files(void) {
+  char prof[64];
+  temp_path(prof, sizeof(prof));
+  char *err = NULL;
+  ASSERT_TRUE(pgo_profile_load(prof, &err) == NULL);
+  free(err); err = NULL;
+  FILE *f = fopen(prof, "wb");
+  ASSERT_TRUE(f != NULL);
+  fputs("LIMPGO\0\0\1", f);
+  fclose(f);
+  ASSERT_TRUE(pgo_profile_load(prof, &err) == NULL);
+  ASSERT_TRUE(err != NULL);
+  free(err);
+  unlink(prof);
+}
+
+static void test_optimizes_fixture(void) {
+  char path[512], prof[64];
+  fixture(path, sizeof(path));
+  temp_path(prof, sizeof(prof));
+  RunOutput r = run_program(NULL, path, NULL, prof);
+  free(r.out);
+
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  IrProgram *ir = liminal_load_program(&ctx, path);
+  liminal_context_free(&ctx);
+  ASSERT_TRUE(ir != NULL);
+  PgoProfile *p = pgo_profile_load(prof, NULL);
+  ASSERT_TRUE(p != NULL);
+  PgoStats stats = {0};
+  char *err = NULL;
+  ASSERT_TRUE(pgo_apply(ir, p, &stats, &err));
+  // Both calls inlined, Weight's Page arm first, the Info reset out of line
+  ASSERT_TRUE(stats.inlined == 2);
+  ASSERT_TRUE(stats.cases_reordered == 1);
+  ASSERT_TRUE(stats.blocks_moved == 1);
+  ASSERT_TRUE(ir_validate(ir, &err));
+  char *printed = ir_program_print(ir);
+  const char *weight = strstr(printed, "func Weight");
+  ASSERT_TRUE(weight != NULL);
+  const char *page = strstr(weight, "LOAD_VAR Page"), *info = strstr(weight, "LOAD_VAR Info");
+  ASSERT_TRUE(page && info && page < info);
+  ASSERT_TRUE(strstr(printed, "CALL") == NULL);
+  ASSERT_CONTAINS(printed, "Scale$2$Result");
+  RunOutput got = run_ir(ir, NULL);
+  ASSERT_EQ_STR("total=374\n", got.out);
+  free(got.out); free(printed); free(err);
+  pgo_profile_free(p);
+  ir_program_free(ir);
+
+  // The profile belongs to this program only
+  snprintf(path, sizeof(path), "%s/examples/opus/t30_bench_function_calls.lim", SOURCE_DIR);
+  liminal_context_init(&ctx);
+  ir = liminal_load_program(&ctx, path);
+  liminal_context_free(&ctx);
+  p = pgo_profile_load(prof, NULL);
+  char *before = ir_program_print(ir);
+  err = NULL;
+  ASSERT_TRUE(!pgo_apply(ir, p, NULL, &err));
+  ASSERT_CONTAINS(err, "different program");
+  char *after = ir_program_print(ir);
+  ASSERT_EQ_STR(before, after);
+  free(before); free(after); free(err);
+  pgo_profile_free(p);
+  ir_program_free(ir);
+  unlink(prof);
+}
+
+// Y := 5; S := 0; T := 0; I := 0; while I < 100 do begin S := S + F(I);
+// T := T + G(I); I := I + 1 end; print S, T, Y -- where F reads the caller's
+// Y, then writes its own, and G leaves through `return` on one path
+static IrProgram *frame_program(void) {
+  IrProgram *prog = ir_program_new();
+  IrFunc m = ir_func_create("Main");
+  ir_emit_store_var(&m, "Y", ir_emit_const_int(&m, 5));
+  ir_emit_store_var(&m, "S", ir_emit_const_int(&m, 0));
+  ir_emit_store_var(&m, "T", ir_emit_const_int(&m, 0));
+  ir_emit_store_var(&m, "I", ir_emit_const_int(&m, 0));
+  ir_emit_label(&m, "0");
+  int i = ir_emit_load_var(&m, "I");
+  int n = ir_emit_const_int(&m, 100);
+  ir_emit_jump_if_false(&m, ir_emit_binop(&m, IR_LT, i, n), "1");
+  int s = ir_emit_load_var(&m, "S");
+  i = ir_emit_load_var(&m, "I");
+  int call = ir_emit_call(&m, "F", i, -1);
+  ir_emit_store_var(&m, "S", ir_emit_binop(&m, IR_ADD, s, call));
+  int t = ir_emit_load_var(&m, "T");
+  i = ir_emit_load_var(&m, "I");
+  call = ir_emit_call(&m, "G", i, -1);
+  ir_emit_store_var(&m, "T", ir_emit_binop(&m, IR_ADD, t, call));
+  i = ir_emit_load_var(&m, "I");
+  int one = ir_emit_const_int(&m, 1);
+  ir_emit_store_var(&m, "I", ir_emit_binop(&m, IR_ADD, i, one));
+  ir_emit_jump(&m, "0");
+  ir_emit_label(&m, "1");
+  ir_emit_print(&m, ir_emit_load_var(&m, "S"), 1);
+  ir_emit_print(&m, ir_emit_load_var(&m, "T"), 1);
+  ir_emit_print(&m, ir_emit_load_var(&m, "Y"), 1);
+  ir_program_add_func(prog, m);
+
+  IrFunc f = ir_func_create("F");
+  f.params = malloc(sizeof(char *));
+  f.params[0] = strdup("N");
+  f.param_count = 1;
+  int y = ir_emit_load_var(&f, "Y");
+  n = ir_emit_load_var(&f, "N");
+  ir_emit_store_var(&f, "Y", ir_emit_binop(&f, IR_ADD, y, n));
+  y = ir_emit_load_var(&f, "Y");
+  int two = ir_emit_const_int(&f, 2);
+  ir_emit_store_var(&f, "Result", ir_emit_binop(&f, IR_MUL, y, two));
+  ir_program_add_func(prog, f);
+
+  IrFunc g = ir_func_create("G");
+  g.params = malloc(sizeof(char *));
+  g.params[0] = strdup("N");
+  g.param_count = 1;
+  n = ir_emit_load_var(&g, "N");
+  int half = ir_emit_const_int(&g, 50);
+  ir_emit_jump_if_false(&g, ir_emit_binop(&g, IR_LT, n, half), "0");
+  ir_emit_ret(&g, ir_emit_const_int(&g, 1));
+  ir_emit_label(&g, "0");
+  ir_emit_store_var(&g, "Result", ir_emit_const_int(&g, 2));
+  ir_program_add_func(prog, g);
+  return prog;
+}
+
+static void test_inlining_keeps_frames(void) {
+  IrProgram *prog = frame_program();
+  PgoProfile *p = pgo_profile_new(prog, pgo_checksum(prog));
+  RunOutput want = run_ir(prog, p);
+  ASSERT_EQ_STR("10900\n150\n5\n", want.out);
+  PgoStats stats = {0};
+  ASSERT_TRUE(pgo_apply(prog, p, &stats, NULL));
+  ASSERT_TRUE(stats.inlined == 2);
+  char *err = NULL;
+  ASSERT_TRUE(ir_validate(prog, &err));
+  free(err);
+  char *printed = ir_program_print(prog);
+  // F's own Y starts from the caller's; G's return leaves through a jump
+  ASSERT_CONTAINS(printed, "F$1$Y");
+  ASSERT_CONTAINS(printed, "G$2$Result");
+  ASSERT_TRUE(strstr(printed, "CALL") == NULL);
+  RunOutput got = run_ir(prog, NULL);
+  ASSERT_EQ_STR(want.out, got.out);
+  free(printed); free(want.out); free(got.out);
+  pgo_profile_free(p);
+  ir_program_free(prog);
+}
+
+int main(void) {
+  run_test("records_counts", test_records_counts);
+  run_test("rejects_bad_files", test_rejects_bad_files);
+  run_test("optimizes_fixture", test_optimizes_fixture);
+  run_test("inlining_keeps_frames", test_inlining_keeps_frames);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All PGO tests passed (%d)\n", get_tests_run());
+  return 0;
+}
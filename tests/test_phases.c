@@ -0,0 +1,183 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/alloc.h"
+#include "liminal/exec.h"
+#include "liminal/phases.h"
+#include "liminal/workers.h"
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Phase report: the counting allocator, and --time-phases over a real run
+// in both the table and the JSON form.
+
+static void test_counts_allocations(void) {
+  AllocStats before = alloc_stats();
+  char *a = lm_malloc(100);
+  char *b = lm_strdup("phase");
+  a = lm_realloc(a, 1 << 20);  // large enough to move
+  AllocStats mid = alloc_stats();
+  ASSERT_TRUE(mid.allocs - before.allocs >= 2);
+  ASSERT_TRUE(mid.bytes - before.bytes >= 6 + (1 << 20));  // a realloc adds its growth
+  ASSERT_TRUE(mid.live - before.live >= (1 << 20));
+  ASSERT_TRUE(mid.peak >= mid.live);
+  lm_free(a);
+  lm_free(b);
+  lm_free(NULL);
+  AllocStats after = alloc_stats();
+  ASSERT_TRUE(after.frees - before.frees == 2);
+  ASSERT_TRUE(after.live == before.live);
+  // The peak stays until it is reset to what is live now
+  ASSERT_TRUE(after.peak >= mid.live);
+  alloc_reset_peak();
+  ASSERT_TRUE(alloc_stats().peak == after.live);
+}
+
+static void alloc_item(void *arg, size_t i) {
+  ((char **)arg)[i] = lm_malloc(1000);
+}
+
+// Items that run on the pool's threads count on the thread that ran the batch
+static void test_counts_worker_allocations(void) {
+  WorkerPool *pool = worker_pool_new(4);
+  char *items[64];
+  AllocStats before = alloc_stats();
+  worker_pool_run(pool, alloc_item, items, 64);
+  AllocStats mid = alloc_stats();
+  ASSERT_TRUE(mid.allocs - before.allocs == 64);
+  ASSERT_TRUE(mid.bytes - before.bytes >= 64 * 1000);
+  ASSERT_TRUE(mid.live - before.live >= 64 * 1000);
+  ASSERT_TRUE(mid.peak >= mid.live);
+  for (size_t i = 0; i < 64; i++) lm_free(items[i]);
+  AllocStats after = alloc_stats();
+  ASSERT_TRUE(after.frees - before.frees == 64);
+  ASSERT_TRUE(after.live == before.live);
+  worker_pool_free(pool);
+}
+
+static void test_marks_phases(void) {
+  PhaseLog *log = phase_log_new();
+  PhaseMark m = phase_mark();
+  void *p = lm_calloc(64, 64);
+  phase_log_add(log, "first", m);
+  m = phase_mark();
+  lm_free(p);
+  phase_log_add(log, "second", m);
+  ASSERT_TRUE(log->len == 2);
+  ASSERT_EQ_STR("first", log->items[0].name);
+  ASSERT_TRUE(log->items[0].allocs == 1 && log->items[0].bytes >= 4096);
+  ASSERT_TRUE(log->items[0].peak >= 4096);
+  ASSERT_TRUE(log->items[1].allocs == 0 && log->items[1].frees == 1);
+  char *out = NULL; size_t len = 0;
+  FILE *f = open_memstream(&out, &len);
+  phase_log_report(log, f);
+  fclose(f);
+  ASSERT_CONTAINS(out, "peak bytes");
+  ASSERT_CONTAINS(out, "\nfirst ");
+  ASSERT_CONTAINS(out, "\ntotal ");
+  free(out);
+  phase_log_free(log);
+}
+
+static char *slurp(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) return NULL;
+  char *buf = calloc(1, 65536);
+  fread(buf, 1, 65535, f);
+  fclose(f);
+  return buf;
+}
+
+// The count after "key": in the JSON object for phase name
+static long long phase_field(const char *json, const char *name, const char *key) {
+  char pat[64];
+  snprintf(pat, sizeof(pat), "{\"name\":\"%s\"", name);
+  const char *at = strstr(json, pat);
+  if (!at) return -1;
+  snprintf(pat, sizeof(pat), "\"%s\":", key);
+  const char *v = strstr(at, pat);
+  return v ? atoll(v + strlen(pat)) : -1;
+}
+
+static void test_run_writes_json(void) {
+  char path[512]; snprintf(path, sizeof(path), "%s/examples/opus/c04_array_ops.lim", SOURCE_DIR);
+  char json[] = "/tmp/liminal_phasesXXXXXX";
+  int fd = mkstemp(json);
+  ASSERT_TRUE(fd >= 0);
+  close(fd);
+  FILE *out = fopen("/dev/null", "w");
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  ctx.out = out;
+  ctx.time_phases = 1;
+  ctx.time_phases_json = json;
+  ASSERT_TRUE(liminal_run_file_ctx(&ctx, path) == 0);
+  ASSERT_TRUE(ctx.phases == NULL);
+  liminal_context_free(&ctx);
+  fclose(out);
+  char *text = slurp(json);
+  unlink(json);
+  ASSERT_TRUE(text != NULL);
+  ASSERT_TRUE(strncmp(text, "{\"phases\":[", 11) == 0);
+  const char *names[] = {"read", "parse", "typecheck", "lower", "validate", "execute"};
+  for (size_t i = 0; i < sizeof(names) / sizeof(*names); i++)
+    ASSERT_TRUE(phase_field(text, names[i], "ns") >= 0);
+  // The front end allocates its tree and IR; the source buffer is read
+  ASSERT_TRUE(phase_field(text, "read", "bytes") > 0);
+  ASSERT_TRUE(phase_field(text, "parse", "allocs") > 0);
+  ASSERT_TRUE(phase_field(text, "lower", "allocs") > 0);
+  ASSERT_TRUE(phase_field(text, "parse", "peak_bytes") > 0);
+  ASSERT_TRUE(phase_field(text, "total", "allocs") >= phase_field(text, "parse", "allocs"));
+  ASSERT_CONTAINS(text, "}],\"total\":{\"name\":\"total\"");
+  free(text);
+}
+
+static void test_reports_failed_compile(void) {
+  char path[] = "/tmp/liminal_phases_badXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_TRUE(fd >= 0);
+  const char *src = "program Bad;\nvar\n  X: Integer;\nbegin\n  X := 'no';\nend.\n";
+  ASSERT_TRUE(write(fd, src, strlen(src)) == (ssize_t)strlen(src));
+  close(fd);
+  char errs[] = "/tmp/liminal_phases_errXXXXXX";
+  int efd = mkstemp(errs);
+  ASSERT_TRUE(efd >= 0);
+  int stderr_fd = dup(STDERR_FILENO);
+  fflush(stderr);
+  dup2(efd, STDERR_FILENO);
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  ctx.time_phases = 1;
+  int rc = liminal_run_file_ctx(&ctx, path);
+  liminal_context_free(&ctx);
+  fflush(stderr);
+  dup2(stderr_fd, STDERR_FILENO);
+  close(stderr_fd);
+  close(efd);
+  char *err = slurp(errs);
+  unlink(errs);
+  unlink(path);
+  ASSERT_TRUE(rc != 0);
+  // Phases up to the failure are still reported
+  ASSERT_CONTAINS(err, "\nparse ");
+  ASSERT_CONTAINS(err, "\ntypecheck ");
+  ASSERT_TRUE(strstr(err, "\nexecute ") == NULL);
+  free(err);
+}
+
+int main(void) {
+  run_test("counts_allocations", test_counts_allocations);
+  run_test("counts_worker_allocations", test_counts_worker_allocations);
+  run_test("marks_phases", test_marks_phases);
+  run_test("run_writes_json", test_run_writes_json);
+  run_test("reports_failed_compile", test_reports_failed_compile);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All phases tests passed (%d)\n", get_tests_run());
+  return 0;
+}
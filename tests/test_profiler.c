@@ -0,0 +1,164 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/exec.h"
+#include "liminal/oracles.h"
+#include "liminal/profiler.h"
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Timing profiler: call counts and op counts are exact, times add up across
+// recursion, oracle time is split from the interpreter's, and counts map
+// back to source lines.
+
+// Answers every prompt after a fixed delay
+static OracleResult slow_call(void *impl, const char *prompt) {
+  (void)impl; (void)prompt;
+  struct timespec ts = {0, 5 * 1000000};
+  nanosleep(&ts, NULL);
+  OracleResult r = {0};
+  r.ok = 1;
+  r.text = strdup("ok");
+  return r;
+}
+
+static void slow_destroy(void *impl) { (void)impl; }
+
+// Main: print Fact(4); ask "hi"                      (fact.lim line 2)
+// Fact(N): if N <= 1 then return 1; return N * Fact(N - 1)  (lines 5, 6, 7)
+static IrProgram *fact_program(void) {
+  IrProgram *prog = ir_program_new();
+  IrFunc m = ir_func_create("Main");
+  ir_func_set_span(&m, (LiminalSpan){2, 3, 20, 30});
+  ir_emit_print(&m, ir_emit_call(&m, "Fact", ir_emit_const_int(&m, 4), -1), 1);
+  ir_emit_ask(&m, ir_emit_const_string(&m, "hi"), -1, NULL, NULL);
+  ir_program_add_func(prog, m);
+
+  IrFunc f = ir_func_create("Fact");
+  f.params = malloc(sizeof(char *));
+  f.params[0] = strdup("N");
+  f.param_count = 1;
+  ir_func_set_span(&f, (LiminalSpan){5, 3, 60, 20});
+  int n = ir_emit_load_var(&f, "N");
+  ir_emit_jump_if_false(&f, ir_emit_binop(&f, IR_LE, n, ir_emit_const_int(&f, 1)), "0");
+  ir_func_set_span(&f, (LiminalSpan){6, 5, 85, 9});
+  ir_emit_ret(&f, ir_emit_const_int(&f, 1));
+  ir_func_set_span(&f, (LiminalSpan){7, 3, 95, 24});
+  ir_emit_label(&f, "0");
+  n = ir_emit_load_var(&f, "N");
+  int m1 = ir_emit_binop(&f, IR_SUB, ir_emit_load_var(&f, "N"), ir_emit_const_int(&f, 1));
+  ir_emit_ret(&f, ir_emit_binop(&f, IR_MUL, n, ir_emit_call(&f, "Fact", m1, -1)));
+  ir_program_add_func(prog, f);
+  return prog;
+}
+
+static Profiler *profile_run(const IrProgram *prog, char **out) {
+  size_t len = 0;
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  ctx.out = open_memstream(out, &len);
+  liminal_context_set_oracle(&ctx, oracle_alloc(ORACLE_KIND_MOCK, NULL, slow_call, slow_destroy), 1);
+  ctx.profiler = profiler_new(prog);
+  ctx.profiler->source = "fact.lim";
+  ir_execute(prog, &ctx);
+  profiler_finish(ctx.profiler);
+  Profiler *p = ctx.profiler;
+  FILE *f = ctx.out;
+  liminal_context_free(&ctx);
+  fclose(f);
+  return p;
+}
+
+static void test_counts_and_times(void) {
+  IrProgram *prog = fact_program();
+  char *out = NULL;
+  Profiler *p = profile_run(prog, &out);
+  ASSERT_EQ_STR("24\n", out);
+  const ProfFunc *main = &p->funcs[0], *fact = &p->funcs[1];
+  ASSERT_TRUE(main->calls == 1);
+  ASSERT_TRUE(fact->calls == 4);
+  ASSERT_TRUE(p->ops[IR_CALL] == 4);
+  ASSERT_TRUE(p->ops[IR_ASK] == 1);
+  ASSERT_TRUE(p->ops[IR_MUL] == 3);
+  ASSERT_TRUE(main->instructions == 5 && fact->instructions == 3 * 12 + 6);
+  // Recursion is timed once; Fact runs inside Main
+  ASSERT_TRUE(fact->exclusive_ns <= fact->inclusive_ns);
+  ASSERT_TRUE(fact->inclusive_ns <= main->inclusive_ns);
+  // The oracle's 5ms belongs to Main but not to its exclusive time
+  ASSERT_TRUE(p->oracle_calls == 1);
+  ASSERT_TRUE(p->oracle_ns >= 5000000);
+  ASSERT_TRUE(main->oracle_ns == p->oracle_ns && fact->oracle_ns == 0);
+  ASSERT_TRUE(main->exclusive_ns + fact->exclusive_ns + p->oracle_ns <= main->inclusive_ns);
+  ASSERT_TRUE(main->inclusive_ns <= p->total_ns);
+  profiler_free(p);
+  free(out);
+  ir_program_free(prog);
+}
+
+static void test_report_and_json(void) {
+  IrProgram *prog = fact_program();
+  char *out = NULL;
+  Profiler *p = profile_run(prog, &out);
+  char *text = NULL, *json = NULL;
+  size_t len = 0;
+  FILE *f = open_memstream(&text, &len);
+  profiler_report(p, f);
+  fclose(f);
+  ASSERT_CONTAINS(text, "in 1 oracle call(s)");
+  ASSERT_CONTAINS(text, "Fact                              4");
+  // Ops are listed most frequent first
+  ASSERT_TRUE(strstr(text, "LOAD_VAR") < strstr(text, "MUL"));
+  f = open_memstream(&json, &len);
+  profiler_write_json(p, f);
+  fclose(f);
+  ASSERT_CONTAINS(json, "\"oracle_calls\":1,\"instructions\":47,");
+  ASSERT_CONTAINS(json, "{\"name\":\"Fact\",\"calls\":4,");
+  ASSERT_CONTAINS(json, "\"CALL\":4");
+  profiler_free(p);
+  free(text); free(json); free(out);
+  ir_program_free(prog);
+}
+
+// Counts per instruction add up per source line through the line tables
+static void test_source_lines(void) {
+  IrProgram *prog = fact_program();
+  char *out = NULL;
+  Profiler *p = profile_run(prog, &out);
+  ASSERT_TRUE(p->counts[1][0] == 4 && p->counts[1][4] == 1 && p->counts[1][11] == 3);
+  char *text = NULL, *json = NULL, *annotated = NULL;
+  size_t len = 0;
+  FILE *f = open_memstream(&text, &len);
+  profiler_report(p, f);
+  fclose(f);
+  ASSERT_CONTAINS(text, "fact.lim:5:3");
+  // Hottest line first: 3 calls x 8 instructions on line 7
+  ASSERT_CONTAINS(text, "\nfact.lim:7                                   24");
+  ASSERT_TRUE(strstr(text, "fact.lim:7 ") < strstr(text, "fact.lim:5 "));
+  f = open_memstream(&json, &len);
+  profiler_write_json(p, f);
+  fclose(f);
+  ASSERT_CONTAINS(json, "{\"source\":\"fact.lim\",");
+  ASSERT_CONTAINS(json, "\"instructions\":42,\"line\":5,\"column\":3}");
+  ASSERT_CONTAINS(json, "\"lines\":[{\"line\":2,\"instructions\":5},{\"line\":5,\"instructions\":16},"
+                        "{\"line\":6,\"instructions\":2},{\"line\":7,\"instructions\":24}]");
+  annotated = ir_program_print_annotated(prog, NULL, p->counts);
+  ASSERT_CONTAINS(annotated, "func Fact\n; 5\n           4   t0 = LOAD_VAR N\n");
+  profiler_free(p);
+  free(text); free(json); free(annotated); free(out);
+  ir_program_free(prog);
+}
+
+int main(void) {
+  run_test("counts_and_times", test_counts_and_times);
+  run_test("report_and_json", test_report_and_json);
+  run_test("source_lines", test_source_lines);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All profiler tests passed (%d)\n", get_tests_run());
+  return 0;
+}
@@ -0,0 +1,141 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/exec.h"
+#include "liminal/oracles.h"
+#include "liminal/sampler.h"
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Sampling profiler: stacks are attributed to the right frames and
+// instructions (driven by a fake tick counter), the folded output, and a
+// real SIGPROF run.
+
+static volatile sig_atomic_t fake_ticks;
+
+// Each ask stands in for a timer tick arriving while it runs
+static OracleResult ticking_call(void *impl, const char *prompt) {
+  (void)impl; (void)prompt;
+  fake_ticks++;
+  OracleResult r = {0};
+  r.ok = 1;
+  r.text = strdup("ok");
+  return r;
+}
+
+static void ticking_destroy(void *impl) { (void)impl; }
+
+// Main: Outer(); Outer(); ask
+// Outer: Inner(); Inner: ask (line 7 of nested.lim; the rest has no spans)
+static IrProgram *nested_program(void) {
+  IrProgram *prog = ir_program_new();
+  IrFunc m = ir_func_create("Main");
+  ir_emit_call(&m, "Outer", -1, -1);
+  ir_emit_call(&m, "Outer", -1, -1);
+  ir_emit_ask(&m, ir_emit_const_string(&m, "main"), -1, NULL, NULL);
+  ir_program_add_func(prog, m);
+  IrFunc o = ir_func_create("Outer");
+  ir_emit_call(&o, "Inner", -1, -1);
+  ir_program_add_func(prog, o);
+  IrFunc in = ir_func_create("Inner");
+  ir_func_set_span(&in, (LiminalSpan){7, 3, 60, 12});
+  ir_emit_ask(&in, ir_emit_const_string(&in, "inner"), -1, NULL, NULL);
+  ir_program_add_func(prog, in);
+  return prog;
+}
+
+static char *run_sampled(const IrProgram *prog, Sampler *s) {
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  liminal_context_set_oracle(&ctx, oracle_alloc(ORACLE_KIND_MOCK, NULL, ticking_call, ticking_destroy), 1);
+  ctx.sampler = s;
+  ir_execute(prog, &ctx);
+  liminal_context_free(&ctx);
+  char *out = NULL; size_t len = 0;
+  FILE *f = open_memstream(&out, &len);
+  sampler_write_folded(s, f);
+  fclose(f);
+  return out;
+}
+
+static void test_attributes_stacks(void) {
+  IrProgram *prog = nested_program();
+  Sampler *s = sampler_new(prog);
+  s->source = "nested.lim";
+  s->ticks = &fake_ticks;
+  s->seen = fake_ticks;
+  char *out = run_sampled(prog, s);
+  // Both Outer calls reach the same stack; most samples come first. The
+  // leaf is a source line where there is one, else the instruction.
+  ASSERT_EQ_STR("Main;Outer;Inner;nested.lim:7 2\nMain;ASK@3 1\n", out);
+  ASSERT_TRUE(s->samples == 3);
+  free(out);
+  sampler_free(s);
+  ir_program_free(prog);
+}
+
+static void test_rejects_bad_start(void) {
+  IrProgram *prog = nested_program();
+  Sampler *a = sampler_new(prog), *b = sampler_new(prog);
+  char *err = NULL;
+  ASSERT_TRUE(!sampler_start(a, 0, &err));
+  ASSERT_CONTAINS(err, "sample rate");
+  free(err); err = NULL;
+  ASSERT_TRUE(sampler_start(a, 1000, &err));
+  // The timer is process-wide
+  ASSERT_TRUE(!sampler_start(b, 1000, &err));
+  ASSERT_CONTAINS(err, "another sampler");
+  free(err); err = NULL;
+  sampler_stop(a);
+  ASSERT_TRUE(sampler_start(b, 1000, &err));
+  sampler_free(b);
+  sampler_free(a);
+  ir_program_free(prog);
+}
+
+static void test_samples_busy_loop(void) {
+  char path[512]; snprintf(path, sizeof(path), "%s/examples/opus/t30_bench_function_calls.lim", SOURCE_DIR);
+  char folded[] = "/tmp/liminal_sampleXXXXXX";
+  int fd = mkstemp(folded);
+  ASSERT_TRUE(fd >= 0);
+  FILE *out = fopen("/dev/null", "w");
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  ctx.out = out;
+  ctx.sample_out = folded;
+  ctx.sample_hz = 1000;
+  ASSERT_TRUE(liminal_run_file_ctx(&ctx, path) == 0);
+  liminal_context_free(&ctx);
+  fclose(out);
+  FILE *f = fdopen(fd, "r");
+  char line[512];
+  size_t lines = 0, in_mix = 0;
+  while (fgets(line, sizeof(line), f)) {
+    lines++;
+    // <frames> <count>, frames starting at the program's main function and
+    // ending at a source line
+    ASSERT_TRUE(strncmp(line, "BenchFunctionCalls;", 19) == 0);
+    ASSERT_CONTAINS(line, "t30_bench_function_calls.lim:");
+    ASSERT_TRUE(strrchr(line, ' ') != NULL && atoi(strrchr(line, ' ') + 1) > 0);
+    if (strstr(line, ";Mix;")) in_mix++;
+  }
+  fclose(f);
+  unlink(folded);
+  ASSERT_TRUE(lines > 0);
+  ASSERT_TRUE(in_mix > 0);
+}
+
+int main(void) {
+  run_test("attributes_stacks", test_attributes_stacks);
+  run_test("rejects_bad_start", test_rejects_bad_start);
+  run_test("samples_busy_loop", test_samples_busy_loop);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All sampler tests passed (%d)\n", get_tests_run());
+  return 0;
+}
@@ -0,0 +1,173 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/exec.h"
+#include "liminal/oracles.h"
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Streaming oracles: chunking, early stop, the pull bridge and the `stream`
+// statement.
+
+typedef struct {
+  char seen[8][32];
+  size_t n;
+  size_t stop_after;    // 0: take everything
+} Chunks;
+
+static int collect(void *user, const char *chunk, size_t len) {
+  Chunks *c = user;
+  if (c->n < 8) snprintf(c->seen[c->n], sizeof(c->seen[c->n]), "%.*s", (int)len, chunk);
+  c->n++;
+  return !c->stop_after || c->n < c->stop_after;
+}
+
+static void test_mock_streams_words(void) {
+  Oracle *o = oracle_create_mock();
+  oracle_mock_queue(o, "Once upon  a time\n", NULL);
+  Chunks c = {0};
+  OracleResult r = oracle_stream_text(o, "p", collect, &c);
+  ASSERT_TRUE(r.ok);
+  ASSERT_EQ_STR("Once upon  a time\n", r.text);
+  ASSERT_TRUE(c.n == 4);
+  ASSERT_EQ_STR("Once ", c.seen[0]);
+  ASSERT_EQ_STR("upon  ", c.seen[1]);
+  ASSERT_EQ_STR("a ", c.seen[2]);
+  ASSERT_EQ_STR("time\n", c.seen[3]);
+  oracle_result_free(r);
+  oracle_free(o);
+}
+
+static void test_stops_early(void) {
+  Oracle *o = oracle_create_mock();
+  oracle_mock_queue(o, "one two three four", NULL);
+  oracle_mock_queue(o, NULL, "boom");
+  Chunks c = {0};
+  c.stop_after = 2;
+  OracleResult r = oracle_stream_text(o, "p", collect, &c);
+  ASSERT_TRUE(r.ok && c.n == 2);
+  ASSERT_EQ_STR("one two ", r.text);
+  oracle_result_free(r);
+  Chunks none = {0};
+  r = oracle_stream_text(o, "p", collect, &none);
+  ASSERT_TRUE(!r.ok && none.n == 0);
+  ASSERT_EQ_STR("boom", r.error);
+  oracle_result_free(r);
+  oracle_free(o);
+}
+
+static void test_whole_answer_without_stream_text(void) {
+  Oracle *o = oracle_create_mock();
+  o->stream_text = NULL;
+  oracle_mock_queue(o, "all at once", NULL);
+  Chunks c = {0};
+  OracleResult r = oracle_stream_text(o, "p", collect, &c);
+  ASSERT_TRUE(r.ok && c.n == 1);
+  ASSERT_EQ_STR("all at once", c.seen[0]);
+  oracle_result_free(r);
+  oracle_free(o);
+}
+
+static void test_record_passes_chunks_through(void) {
+  const char *path = "/tmp/liminal_stream_rec.jsonl";
+  remove(path);
+  Oracle *base = oracle_create_mock();
+  oracle_mock_queue(base, "red green", NULL);
+  Oracle *rec = oracle_with_recording(base, "record", path);
+  Chunks c = {0};
+  OracleResult r = oracle_stream_text(rec, "colours", collect, &c);
+  ASSERT_TRUE(r.ok && c.n == 2);
+  oracle_result_free(r);
+  oracle_free(rec);
+  Oracle *rep = oracle_with_recording(NULL, "replay", path);
+  Chunks again = {0};
+  r = oracle_stream_text(rep, "colours", collect, &again);
+  ASSERT_TRUE(r.ok && again.n == 1);
+  ASSERT_EQ_STR("red green", again.seen[0]);
+  oracle_result_free(r);
+  oracle_free(rep);
+  remove(path);
+}
+
+static void test_pull_bridge(void) {
+  Oracle *o = oracle_create_mock();
+  oracle_mock_queue(o, "a b c", NULL);
+  oracle_mock_queue(o, "x y z w", NULL);
+  OracleStream *s = oracle_stream_open(o, "p");
+  char *chunk;
+  size_t len;
+  const char *want[] = { "a ", "b ", "c" };
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(oracle_stream_next(s, &chunk, &len));
+    ASSERT_EQ_STR(want[i], chunk);
+    ASSERT_TRUE(len == strlen(want[i]));
+    free(chunk);
+  }
+  ASSERT_TRUE(!oracle_stream_next(s, &chunk, &len));
+  ASSERT_TRUE(oracle_stream_result(s)->ok);
+  ASSERT_EQ_STR("a b c", oracle_stream_result(s)->text);
+  oracle_stream_close(s);
+  // Closed after one chunk: the producer stops and is joined
+  s = oracle_stream_open(o, "p");
+  ASSERT_TRUE(oracle_stream_next(s, &chunk, &len));
+  ASSERT_EQ_STR("x ", chunk);
+  free(chunk);
+  oracle_stream_close(s);
+  oracle_free(o);
+}
+
+static int run_fixture(Oracle *o, const char *fixture, int jit, char **buf) {
+  char path[256];
+  snprintf(path, sizeof(path), "%s/tests/fixtures/%s", SOURCE_DIR, fixture);
+  size_t len = 0;
+  FILE *out = open_memstream(buf, &len);
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  ctx.out = out;
+  ctx.jit = jit;
+  liminal_context_set_oracle(&ctx, o, 0);
+  int rc = liminal_run_file_ctx(&ctx, path);
+  liminal_context_free(&ctx);
+  fclose(out);
+  return rc;
+}
+
+static void test_stream_statement(void) {
+  for (int jit = 0; jit < 2; jit++) {
+    Oracle *o = oracle_create_mock();
+    oracle_mock_queue(o, "It was a dark night.", NULL);
+    char *out = NULL;
+    ASSERT_TRUE(run_fixture(o, "stream_basic.lim", jit, &out) == 0);
+    ASSERT_EQ_STR("[It ][was ][a ][dark ][night.]\n5\n", out);
+    free(out);
+    oracle_free(o);
+  }
+}
+
+static void test_stream_statement_failure(void) {
+  Oracle *o = oracle_create_mock();
+  oracle_mock_queue(o, NULL, "model unavailable");
+  char *out = NULL;
+  ASSERT_TRUE(run_fixture(o, "stream_basic.lim", 0, &out) == 0);
+  ASSERT_EQ_STR("\n0\n", out);
+  free(out);
+  oracle_free(o);
+}
+
+int main(void) {
+  run_test("mock_streams_words", test_mock_streams_words);
+  run_test("stops_early", test_stops_early);
+  run_test("whole_answer_without_stream_text", test_whole_answer_without_stream_text);
+  run_test("record_passes_chunks_through", test_record_passes_chunks_through);
+  run_test("pull_bridge", test_pull_bridge);
+  run_test("stream_statement", test_stream_statement);
+  run_test("stream_statement_failure", test_stream_statement_failure);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All stream tests passed (%d)\n", get_tests_run());
+  return 0;
+}
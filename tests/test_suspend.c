@@ -0,0 +1,201 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/exec.h"
+#include "liminal/oracles.h"
+#include "liminal/peephole.h"
+#include "liminal/profiler.h"
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Many instances of one program on one thread (ir_execute_many): each
+// suspends at its asks, so their latencies overlap, and each prints what it
+// would have printed run alone.
+
+typedef struct {
+  LiminalContext *ctxs;
+  LiminalContext **ptrs;
+  size_t n;
+  size_t *done_order; // indexes in the order on_done saw them
+  size_t ndone;
+} Batch;
+
+static IrProgram *load(LiminalContext *ctx) {
+  char path[256];
+  snprintf(path, sizeof(path), "%s/tests/fixtures/suspend_many.lim", SOURCE_DIR);
+  IrProgram *ir = liminal_load_program(ctx, path);
+  if (ir) ir_fuse_superinstructions(ir);
+  return ir;
+}
+
+static void name_of(size_t i, char *buf, size_t cap) { snprintf(buf, cap, "user%zu", i); }
+
+// Answers every prompt the fixture asks for these names
+static Oracle *answering_mock(size_t n, long latency_ms) {
+  Oracle *o = oracle_create_mock();
+  oracle_mock_set_latency(o, latency_ms);
+  char name[32], prompt[64], text[80];
+  for (size_t i = 0; i < n; i++) {
+    name_of(i, name, sizeof(name));
+    const char *forms[] = { "hello %s", "hello %s!", "count %s" };
+    for (int k = 0; k < 3; k++) {
+      snprintf(prompt, sizeof(prompt), forms[k], name);
+      snprintf(text, sizeof(text), "re %s", prompt);
+      oracle_mock_answer(o, prompt, text, NULL);
+    }
+  }
+  return o;
+}
+
+// One context per name, reading its name and buffering its output
+static void batch_open(Batch *b, size_t n, Oracle *o) {
+  b->n = n;
+  b->ctxs = calloc(n, sizeof(LiminalContext));
+  b->ptrs = calloc(n, sizeof(LiminalContext *));
+  b->done_order = calloc(n, sizeof(size_t));
+  b->ndone = 0;
+  char line[40];
+  for (size_t i = 0; i < n; i++) {
+    LiminalContext *ctx = &b->ctxs[i];
+    liminal_context_init(ctx);
+    name_of(i, line, sizeof(line) - 1);
+    strcat(line, "\n");
+    ctx->in = fmemopen(NULL, strlen(line) + 1, "w+");
+    fputs(line, ctx->in);
+    rewind(ctx->in);
+    ctx->out = NULL;
+    liminal_context_set_oracle(ctx, o, 0);
+    b->ptrs[i] = ctx;
+  }
+}
+
+static void batch_close(Batch *b) {
+  for (size_t i = 0; i < b->n; i++) {
+    fclose(b->ctxs[i].in);
+    liminal_context_free(&b->ctxs[i]);
+  }
+  free(b->ctxs);
+  free(b->ptrs);
+  free(b->done_order);
+}
+
+static void on_done(void *user, size_t index, int rc) {
+  Batch *b = (Batch *)user;
+  if (rc == 0) b->done_order[b->ndone++] = index;
+}
+
+static int output_is(const LiminalContext *ctx, const char *expected) {
+  return ctx->outbuf_len == strlen(expected) && memcmp(ctx->outbuf, expected, ctx->outbuf_len) == 0;
+}
+
+static void expected_for(size_t i, char *buf, size_t cap) {
+  char name[32];
+  name_of(i, name, sizeof(name));
+  snprintf(buf, cap, "Ok(re hello %s)\nOk(re hello %s!)\n2\n50\n1 Ok(re count %s)\n2 Ok(re count %s)\n", name, name,
+           name, name);
+}
+
+static void test_matches_sequential(void) {
+  const size_t n = 64;
+  Oracle *o = answering_mock(n, 0);
+  Batch seq, many;
+  batch_open(&seq, n, o);
+  batch_open(&many, n, o);
+  IrProgram *ir = load(&seq.ctxs[0]);
+  ASSERT_TRUE(ir != NULL);
+  for (size_t i = 0; i < n; i++) ASSERT_TRUE(ir_execute(ir, &seq.ctxs[i]) == 0);
+  ASSERT_TRUE(ir_execute_many(ir, many.ptrs, n, 0, on_done, &many) == 0);
+  ASSERT_TRUE(many.ndone == n);
+  char expected[256];
+  for (size_t i = 0; i < n; i++) {
+    expected_for(i, expected, sizeof(expected));
+    ASSERT_TRUE(output_is(&seq.ctxs[i], expected));
+    ASSERT_TRUE(output_is(&many.ctxs[i], expected));
+  }
+  // Unanswered asks take their fallbacks
+  oracle_free(o);
+  o = oracle_create_mock();
+  for (size_t i = 0; i < n; i++) liminal_context_set_oracle(&many.ctxs[i], o, 0);
+  many.ndone = 0;
+  for (size_t i = 0; i < n; i++) many.ctxs[i].outbuf_len = 0, rewind(many.ctxs[i].in);
+  ASSERT_TRUE(ir_execute_many(ir, many.ptrs, n, 0, on_done, &many) == 0);
+  ASSERT_TRUE(output_is(&many.ctxs[n - 1], "Ok(none)\nOk(none)\n2\n50\n1 Ok(none)\n2 Ok(none)\n"));
+  ir_program_free(ir);
+  batch_close(&seq);
+  batch_close(&many);
+  oracle_free(o);
+}
+
+// 1000 instances of four 100 ms asks each: 400 s one after another, well
+// under a second with every instance's asks overlapping the others' (the
+// bound leaves room for sanitizer builds)
+static void test_overlaps_asks(void) {
+  const size_t n = 1000;
+  Oracle *o = answering_mock(n, 100);
+  Batch b;
+  batch_open(&b, n, o);
+  IrProgram *ir = load(&b.ctxs[0]);
+  ASSERT_TRUE(ir != NULL);
+  uint64_t t0 = profiler_now_ns();
+  ASSERT_TRUE(ir_execute_many(ir, b.ptrs, n, 0, on_done, &b) == 0);
+  ASSERT_TRUE(profiler_now_ns() - t0 < 10000000000ull);
+  ASSERT_TRUE(b.ndone == n);
+  char expected[256];
+  for (size_t i = 0; i < n; i++) {
+    expected_for(i, expected, sizeof(expected));
+    ASSERT_TRUE(output_is(&b.ctxs[i], expected));
+  }
+  ir_program_free(ir);
+  batch_close(&b);
+  oracle_free(o);
+}
+
+// At most `active` instances at once, started in order; an oracle's cap
+// parks the instances that would go over it instead of blocking the thread
+static void test_limits_instances(void) {
+  const size_t n = 40;
+  Oracle *o = answering_mock(n, 20);
+  Batch b;
+  batch_open(&b, n, o);
+  IrProgram *ir = load(&b.ctxs[0]);
+  ASSERT_TRUE(ir != NULL);
+  // 4 rounds of 10 instances, each instance four 20 ms asks in turn
+  uint64_t t0 = profiler_now_ns();
+  ASSERT_TRUE(ir_execute_many(ir, b.ptrs, n, 10, on_done, &b) == 0);
+  uint64_t took = profiler_now_ns() - t0;
+  ASSERT_TRUE(took >= 320000000ull && took < 2000000000ull);
+  ASSERT_TRUE(b.ndone == n);
+  // Instances finish round by round
+  for (size_t k = 0; k < n; k++) ASSERT_TRUE(b.done_order[k] / 10 == k / 10);
+
+  // 160 asks, 8 at a time: 20 rounds of 20 ms
+  oracle_set_max_concurrency(o, 8);
+  b.ndone = 0;
+  for (size_t i = 0; i < n; i++) b.ctxs[i].outbuf_len = 0, rewind(b.ctxs[i].in);
+  t0 = profiler_now_ns();
+  ASSERT_TRUE(ir_execute_many(ir, b.ptrs, n, 0, on_done, &b) == 0);
+  took = profiler_now_ns() - t0;
+  ASSERT_TRUE(took >= 400000000ull && took < 3000000000ull);
+  char expected[256];
+  for (size_t i = 0; i < n; i++) {
+    expected_for(i, expected, sizeof(expected));
+    ASSERT_TRUE(output_is(&b.ctxs[i], expected));
+  }
+  ir_program_free(ir);
+  batch_close(&b);
+  oracle_free(o);
+}
+
+int main(void) {
+  run_test("matches_sequential", test_matches_sequential);
+  run_test("overlaps_asks", test_overlaps_asks);
+  run_test("limits_instances", test_limits_instances);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All suspend tests passed (%d)\n", get_tests_run());
+  return 0;
+}
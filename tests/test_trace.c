@@ -0,0 +1,146 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liminal/exec.h"
+#include "liminal/oracles.h"
+#include "liminal/trace.h"
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Timeline tracer: compile phases, consult attempts, plain asks and the
+// call threshold, read back from the written trace.
+
+static char *read_all(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return NULL;
+  fseek(f, 0, SEEK_END);
+  long len = ftell(f);
+  rewind(f);
+  char *buf = malloc(len + 1);
+  size_t n = fread(buf, 1, len, f);
+  buf[n] = '\0';
+  fclose(f);
+  return buf;
+}
+
+static size_t count(const char *s, const char *needle) {
+  size_t n = 0;
+  for (const char *p = strstr(s, needle); p; p = strstr(p + 1, needle)) n++;
+  return n;
+}
+
+// Runs a file with --trace and returns the trace text
+static char *traced_run(const char *rel, Oracle *o, long min_us) {
+  char path[512]; snprintf(path, sizeof(path), "%s/%s", SOURCE_DIR, rel);
+  char trace[] = "/tmp/liminal_traceXXXXXX";
+  int fd = mkstemp(trace);
+  if (fd < 0) return NULL;
+  close(fd);
+  FILE *out = fopen("/dev/null", "w");
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  ctx.out = out;
+  ctx.trace_out = trace;
+  ctx.trace_min_us = min_us;
+  if (o) liminal_context_set_oracle(&ctx, o, 0);
+  int rc = liminal_run_file_ctx(&ctx, path);
+  liminal_context_free(&ctx);
+  fclose(out);
+  char *text = rc == 0 ? read_all(trace) : NULL;
+  unlink(trace);
+  return text;
+}
+
+static void test_phases_and_consult(void) {
+  Oracle *o = oracle_create_mock();
+  oracle_mock_queue(o, NULL, "boom");
+  oracle_mock_queue(o, "hi", NULL);
+  char *text = traced_run("tests/fixtures/consult_retry.lim", o, 10);
+  oracle_free(o);
+  ASSERT_TRUE(text != NULL);
+  ASSERT_TRUE(strncmp(text, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 39) == 0);
+  ASSERT_TRUE(strlen(text) > 4 && strcmp(text + strlen(text) - 4, "\n]}\n") == 0);
+  const char *phases[] = {"read", "parse", "typecheck", "lower", "validate", "fuse"};
+  for (size_t i = 0; i < sizeof(phases) / sizeof(phases[0]); i++) {
+    char want[64]; snprintf(want, sizeof(want), "{\"name\":\"%s\",\"cat\":\"compile\",\"ph\":\"X\",", phases[i]);
+    ASSERT_CONTAINS(text, want);
+  }
+  ASSERT_CONTAINS(text, "{\"name\":\"execute\",\"cat\":\"run\"");
+  // The failed first attempt, then its retry
+  ASSERT_CONTAINS(text, "{\"name\":\"consult\",\"cat\":\"oracle\"");
+  ASSERT_CONTAINS(text, "\"ok\":false,\"response_bytes\":0,\"attempt\":1,\"error\":\"boom\"}}");
+  ASSERT_CONTAINS(text, "{\"name\":\"consult retry\",\"cat\":\"oracle\"");
+  ASSERT_CONTAINS(text, "\"ok\":true,\"response_bytes\":2,\"attempt\":2}}");
+  ASSERT_CONTAINS(text, "\"oracle\":\"Oracle\",\"prompt_hash\":\"");
+  free(text);
+}
+
+// A plain ask is tagged with the oracle's kind and the prompt hash the
+// recording store uses
+static void test_plain_ask(void) {
+  char trace[] = "/tmp/liminal_traceXXXXXX";
+  int fd = mkstemp(trace);
+  ASSERT_TRUE(fd >= 0);
+  close(fd);
+  IrProgram *prog = ir_program_new();
+  IrFunc m = ir_func_create("Main");
+  ir_emit_ask(&m, ir_emit_const_string(&m, "Hello  oracle"), -1, NULL, NULL);
+  ir_program_add_func(prog, m);
+  Oracle *o = oracle_create_mock();
+  oracle_mock_queue(o, "four", NULL);
+  LiminalContext ctx;
+  liminal_context_init(&ctx);
+  liminal_context_set_oracle(&ctx, o, 1);
+  ctx.tracer = tracer_open(trace, 0, NULL);
+  ASSERT_TRUE(ctx.tracer != NULL);
+  ir_execute(prog, &ctx);
+  ASSERT_TRUE(ctx.tracer->events == 2);
+  ASSERT_TRUE(tracer_close(ctx.tracer));
+  liminal_context_free(&ctx);
+  ir_program_free(prog);
+  char *text = read_all(trace);
+  unlink(trace);
+  char *canon = oracle_canonicalize_prompt("Hello  oracle");
+  char hash[65];
+  oracle_hash_prompt(canon, hash);
+  free(canon);
+  char want[160];
+  snprintf(want, sizeof(want), "\"args\":{\"oracle\":\"mock\",\"prompt_hash\":\"%s\",\"prompt_bytes\":13,\"ok\":true,\"response_bytes\":4}}", hash);
+  ASSERT_CONTAINS(text, "{\"name\":\"ask\",\"cat\":\"oracle\"");
+  ASSERT_CONTAINS(text, want);
+  // Main has no line table, so its span has no source
+  ASSERT_CONTAINS(text, "{\"name\":\"Main\",\"cat\":\"call\",\"ph\":\"X\",");
+  ASSERT_CONTAINS(text, "\"tid\":1,\"args\":{}}");
+  free(text);
+}
+
+// Every call is kept at a zero threshold (enough to go through several
+// buffer flushes) and none at a very high one
+static void test_call_threshold(void) {
+  char *all = traced_run("tests/fixtures/pgo_routing.lim", NULL, 0);
+  char *none = traced_run("tests/fixtures/pgo_routing.lim", NULL, 1000000000L);
+  ASSERT_TRUE(all != NULL && none != NULL);
+  ASSERT_TRUE(strlen(all) > 65536 * 2);
+  ASSERT_TRUE(count(all, "\"cat\":\"call\"") == 1 + 3000 + 3000);
+  ASSERT_CONTAINS(all, "{\"name\":\"Scale\",\"cat\":\"call\"");
+  ASSERT_CONTAINS(all, "\"args\":{\"source\":\"");
+  ASSERT_CONTAINS(all, "pgo_routing.lim:19\"}}");
+  ASSERT_TRUE(count(none, "\"cat\":\"call\"") == 0);
+  ASSERT_CONTAINS(none, "{\"name\":\"execute\"");
+  free(all); free(none);
+}
+
+int main(void) {
+  run_test("phases_and_consult", test_phases_and_consult);
+  run_test("plain_ask", test_plain_ask);
+  run_test("call_threshold", test_call_threshold);
+
+  if (get_tests_failed() > 0) {
+    fprintf(stderr, "%d/%d tests failed\n", get_tests_failed(), get_tests_run());
+    return 1;
+  }
+  fprintf(stdout, "All trace tests passed (%d)\n", get_tests_run());
+  return 0;
+}